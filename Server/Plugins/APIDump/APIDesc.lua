@@ -11912,6 +11912,17 @@ a_Player:OpenWindow(Window);
 					},
 					Notes = "Returns the number of ticks for how long the item would fuel a furnace. Returns zero if not a fuel.",
 				},
+				GetChunkSectionPoolStats =
+				{
+					IsStatic = true,
+					Returns =
+					{
+						{
+							Type = "table",
+						},
+					},
+					Notes = "Returns the statistics of the pool that recycles chunk section memory, as a table with the following number fields: NumLive and LiveBytes (allocations currently in use), NumPooled and PooledBytes (freed allocations kept for reuse), RetentionBytes (the maximum size of the pool, set by SectionPoolRetentionMiB in the [ChunkMemory] section of settings.ini), NumAllocations and NumReused (total allocations since startup, and how many of them were served from the pool). Sample NumAllocations periodically to get the allocation rate.",
+				},
 				GetFurnaceRecipe =
 				{
 					IsStatic = true,
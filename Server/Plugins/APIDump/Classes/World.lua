@@ -2068,7 +2068,7 @@ function OnAllChunksAvailable()</pre> All return values from the callbacks are i
 						Type = "number",
 					},
 				},
-				Notes = "Returns the number of chunks queued up for saving",
+				Notes = "Returns the number of chunks queued up for saving. Note that the storage may keep the chunks that have left the queue in memory for a while (the FlushIntervalMSec setting) before writing them to disk.",
 			},
 			GetTicksUntilWeatherChange =
 			{
@@ -2808,6 +2808,17 @@ function OnAllChunksAvailable()</pre> All return values from the callbacks are i
 					Notes = "Sets the meta for the block at the specified coords. Any call to SetBlockMeta will not generate a simulator update (water, lava, redstone), consider using SetBlock instead.",
 				},
 			},
+			SetBlocks =
+			{
+				Params =
+				{
+					{
+						Name = "BlockChanges",
+						Type = "table",
+					},
+				},
+				Notes = "Sets all the blocks in the BlockChanges table, with the same processing as {{cWorld#SetBlock|SetBlock}}(). Each item is a table of the form { BlockX, BlockY, BlockZ, BlockType, BlockMeta }, the BlockMeta may be omitted and defaults to 0. Each affected chunk is locked and looked up only once and each block is processed only once, so this is much faster than calling SetBlock() for many blocks. Of several changes to the same block, only the last one is applied. Blocks in chunks that are not loaded are ignored.",
+			},
 			SetChunkAlwaysTicked =
 			{
 				Params =
@@ -116,6 +116,23 @@ function(set_global_flags)
 	endif()
 endfunction()
 
+# The noise generators' vectorized kernels must produce the same results as their scalar code, bit for bit,
+# so that a world generates the same on every CPU. That rules out both -ffast-math and FMA contraction for the noise sources.
+# Source file properties are per-directory, call this in each directory that creates a target compiling the noise sources:
+function(set_noise_source_flags)
+	# MSVC doesn't take these options and doesn't need them: set_exe_flags() doesn't ask for /fp:fast,
+	# so MSVC compiles with its default /fp:precise, which neither reorders the operations nor contracts them into FMA.
+	if (MSVC)
+		return ()
+	endif()
+
+	set_source_files_properties(
+		"${CMAKE_SOURCE_DIR}/src/Noise/Noise.cpp"
+		"${CMAKE_SOURCE_DIR}/src/Noise/NoiseKernels.cpp"
+		PROPERTIES COMPILE_OPTIONS "-fno-fast-math;-ffp-contract=off"
+	)
+endfunction()
+
 function(set_exe_flags TARGET)
 	if (MSVC)
 		# TODO: Warnings as errors
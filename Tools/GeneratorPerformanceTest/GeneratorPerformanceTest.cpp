@@ -1,8 +1,443 @@
 
+// GeneratorPerformanceTest.cpp
+
+// Measures the time and the allocations of each stage of generating chunks with the composable generator
+
+/*
+Usage: GeneratorPerformanceTest [-chunks <NumChunks>] [-seed <Seed>] [-ini <WorldIniFile>] [-json <OutputFile>]
+Run it from the Server folder, so that the generator finds its prefabs.
+
+The chunks are generated in a square around chunk [0, 0], with the generator settings from the [Generator] section
+of the INI file, if given, and the defaults otherwise. Each stage of the generator - biomes, shape, composition and
+each finisher by its name - is timed through the generator's stage observer. Once all the chunks are generated,
+each one is lit and serialized the same way the world does it: the lighting uses the world's lighting calculation,
+the serialization writes the terrain into NBT with the Anvil storage's TerrainSerializer and compresses it.
+The chunks outside the generated square are treated as air by the lighting.
+
+For each stage the average, 50th, 90th and 99th percentile and maximum time per chunk is reported,
+along with the average number and size of the heap allocations done in the stage.
+The report is printed, and written as JSON into the output file, if given, so that runs can be compared.
+*/
+
 #include "Globals.h"
-#include "ChunkGenerator.h"
+#include "ChunkData.h"
+#include "ChunkDataCallback.h"
+#include "ChunkLighter.h"
+#include "IniFile.h"
+#include "JsonUtils.h"
+#include "LoggerListeners.h"
+#include "StringCompression.h"
+#include "Generating/ChunkDesc.h"
+#include "Generating/ComposableGenerator.h"
+#include "WorldStorage/FastNBT.h"
+#include "WorldStorage/TerrainSerializer.h"
+#include "json/json.h"
+
+#include <numeric>
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Allocation counting:
+
+/** The number and the total size of all the heap allocations done so far. */
+static std::atomic<size_t> g_NumAllocations(0);
+static std::atomic<size_t> g_NumAllocatedBytes(0);
+
+
+
+
+
+// The array and nothrow variants of the default operators forward to these:
+void * operator new(size_t a_Size)
+{
+	g_NumAllocations.fetch_add(1, std::memory_order_relaxed);
+	g_NumAllocatedBytes.fetch_add(a_Size, std::memory_order_relaxed);
+	auto Res = std::malloc((a_Size > 0) ? a_Size : 1);
+	if (Res == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return Res;
+}
+
+
+
+
+
+void operator delete(void * a_Ptr) noexcept
+{
+	std::free(a_Ptr);
+}
+
+
+
+
+
+void operator delete(void * a_Ptr, size_t a_Size) noexcept
+{
+	UNUSED(a_Size);
+	std::free(a_Ptr);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cStageProfiler:
+
+/** Collects the time and the allocations of each stage, per chunk. */
+class cStageProfiler:
+	public cComposableGenerator::cStageObserver
+{
+public:
+
+	virtual void OnStageBegin(const AString & a_StageName) override
+	{
+		// Find the stage first, so that its allocation is not counted:
+		auto & Stage = GetStage(a_StageName);
+		Stage.m_BeginNumAllocations = g_NumAllocations.load(std::memory_order_relaxed);
+		Stage.m_BeginNumAllocatedBytes = g_NumAllocatedBytes.load(std::memory_order_relaxed);
+		Stage.m_BeginTime = std::chrono::steady_clock::now();
+	}
+
+
+	virtual void OnStageEnd(const AString & a_StageName) override
+	{
+		// Take the measurements before doing anything else:
+		const auto EndTime = std::chrono::steady_clock::now();
+		const auto NumAllocations = g_NumAllocations.load(std::memory_order_relaxed);
+		const auto NumAllocatedBytes = g_NumAllocatedBytes.load(std::memory_order_relaxed);
+
+		auto & Stage = GetStage(a_StageName);
+		Stage.m_Times.push_back(std::chrono::duration<double, std::micro>(EndTime - Stage.m_BeginTime).count());
+		Stage.m_TotalNumAllocations += NumAllocations - Stage.m_BeginNumAllocations;
+		Stage.m_TotalNumAllocatedBytes += NumAllocatedBytes - Stage.m_BeginNumAllocatedBytes;
+	}
+
+
+	/** Measures a_Fn as the specified stage. */
+	template <typename Fn>
+	void Measure(const AString & a_StageName, Fn && a_Fn)
+	{
+		OnStageBegin(a_StageName);
+		a_Fn();
+		OnStageEnd(a_StageName);
+	}
+
+
+	/** Prints the per-stage statistics and returns them as a JSON array. */
+	Json::Value Report(void) const
+	{
+		LOG("%-24s %8s %10s %10s %10s %10s %10s %10s %12s",
+			"Stage", "Chunks", "Total ms", "Avg us", "P50 us", "P90 us", "P99 us", "Max us", "Allocs/chunk"
+		);
+		Json::Value Res(Json::arrayValue);
+		for (const auto & Stage : m_Stages)
+		{
+			if (Stage.m_Times.empty())
+			{
+				continue;
+			}
+			auto Times = Stage.m_Times;
+			std::sort(Times.begin(), Times.end());
+			const auto NumChunks = Times.size();
+			const auto Total = std::accumulate(Times.begin(), Times.end(), 0.0);
+			const auto Avg = Total / NumChunks;
+			const auto AvgNumAllocations = static_cast<double>(Stage.m_TotalNumAllocations) / NumChunks;
+			const auto AvgNumAllocatedBytes = static_cast<double>(Stage.m_TotalNumAllocatedBytes) / NumChunks;
+			LOG("%-24s %8zu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %12.1f",
+				Stage.m_Name, NumChunks, Total / 1000, Avg,
+				Percentile(Times, 50), Percentile(Times, 90), Percentile(Times, 99), Times.back(),
+				AvgNumAllocations
+			);
+
+			Json::Value Entry;
+			Entry["name"] = Stage.m_Name;
+			Entry["chunks"] = static_cast<Json::UInt64>(NumChunks);
+			Entry["totalMs"] = Total / 1000;
+			Entry["avgUs"] = Avg;
+			Entry["p50Us"] = Percentile(Times, 50);
+			Entry["p90Us"] = Percentile(Times, 90);
+			Entry["p99Us"] = Percentile(Times, 99);
+			Entry["maxUs"] = Times.back();
+			Entry["avgAllocations"] = AvgNumAllocations;
+			Entry["avgAllocatedBytes"] = AvgNumAllocatedBytes;
+			Res.append(Entry);
+		}
+		return Res;
+	}
+
+protected:
+
+	struct sStage
+	{
+		AString m_Name;
 
-int main(int argc, char * argv[])
+		/** The time taken by each chunk, in microseconds. */
+		std::vector<double> m_Times;
+
+		/** The allocations done in the stage, over all the chunks. */
+		size_t m_TotalNumAllocations = 0;
+		size_t m_TotalNumAllocatedBytes = 0;
+
+		/** The state when the stage began for the current chunk. */
+		std::chrono::steady_clock::time_point m_BeginTime;
+		size_t m_BeginNumAllocations = 0;
+		size_t m_BeginNumAllocatedBytes = 0;
+
+		explicit sStage(const AString & a_Name):
+			m_Name(a_Name)
+		{
+		}
+	};
+
+	/** The stages, in the order in which they were first seen. */
+	std::vector<sStage> m_Stages;
+
+
+	/** Returns the stage of the specified name, adding it if not seen yet. */
+	sStage & GetStage(const AString & a_StageName)
+	{
+		for (auto & Stage : m_Stages)
+		{
+			if (Stage.m_Name == a_StageName)
+			{
+				return Stage;
+			}
+		}
+		m_Stages.emplace_back(a_StageName);
+		return m_Stages.back();
+	}
+
+
+	/** Returns the nearest-rank percentile of the sorted times. */
+	static double Percentile(const std::vector<double> & a_SortedTimes, int a_Percent)
+	{
+		ASSERT(!a_SortedTimes.empty());
+		const auto Rank = (a_SortedTimes.size() * static_cast<size_t>(a_Percent) + 99) / 100;
+		return a_SortedTimes[std::max<size_t>(Rank, 1) - 1];
+	}
+};
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Chunk storage, lighting and serialization:
+
+/** A generated chunk, in the form the world stores it. */
+struct sGeneratedChunk
 {
-	cChunkGenerator Generator = cChunkGenerator();
+	ChunkBlockData m_BlockData;
+	ChunkLightData m_LightData;
+	cChunkDef::HeightMap m_HeightMap;
+	cChunkDef::BiomeMap m_BiomeMap;
+};
+
+using cGeneratedChunks = std::unordered_map<cChunkCoords, std::unique_ptr<sGeneratedChunk>, cChunkCoordsHash>;
+
+
+
+
+
+/** Converts the generated chunk into the form the world stores it in, same as cWorld::OnChunkGenerated(). */
+static std::unique_ptr<sGeneratedChunk> StoreChunk(cChunkDesc & a_ChunkDesc)
+{
+	auto Res = std::make_unique<sGeneratedChunk>();
+	cChunkDef::BlockNibbles BlockMetas;
+	a_ChunkDesc.CompressBlockMetas(BlockMetas);
+	Res->m_BlockData.SetAll(a_ChunkDesc.GetBlockTypes(), BlockMetas);
+	memcpy(Res->m_HeightMap, a_ChunkDesc.GetHeightMap(), sizeof(Res->m_HeightMap));
+	memcpy(Res->m_BiomeMap, a_ChunkDesc.GetBiomeMap(), sizeof(Res->m_BiomeMap));
+	return Res;
+}
+
+
+
+
+
+/** Serializes the chunk's terrain into NBT the same way NBTChunkSerializer does, through the shared TerrainSerializer,
+and compresses it the way cWSSAnvil does. The generated chunks have no entities, so their lists are written empty.
+Returns the size of the compressed data. */
+static size_t SerializeChunk(cChunkCoords a_Coords, const sGeneratedChunk & a_Chunk, Compression::Compressor & a_Compressor)
+{
+	cFastNBTWriter Writer;
+	Writer.BeginCompound("Level");
+	Writer.AddInt("xPos", a_Coords.m_ChunkX);
+	Writer.AddInt("zPos", a_Coords.m_ChunkZ);
+	Writer.BeginList("Entities", TAG_Compound);
+	Writer.EndList();
+	Writer.BeginList("TileEntities", TAG_Compound);
+	Writer.EndList();
+	TerrainSerializer::WriteBiomes(a_Chunk.m_BiomeMap, Writer);
+	TerrainSerializer::WriteHeightMap(a_Chunk.m_HeightMap, Writer);
+	TerrainSerializer::WriteSections(a_Chunk.m_BlockData, a_Chunk.m_LightData, Writer);
+	Writer.AddByte("MCSIsLightValid", 1);
+	Writer.AddLong("LastUpdate", 0);
+	Writer.AddByte("TerrainPopulated", 1);
+	Writer.EndCompound();  // "Level"
+	Writer.Finish();
+
+	return a_Compressor.CompressZLib(Writer.GetResult()).Size;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// main:
+
+static void PrintUsage(void)
+{
+	LOG("Usage: GeneratorPerformanceTest [-chunks <NumChunks>] [-seed <Seed>] [-ini <WorldIniFile>] [-json <OutputFile>]");
+}
+
+
+
+
+
+int main(int argc, char ** argv)
+{
+	auto consoleLogListener = MakeConsoleListener(false);
+	auto consoleAttachment = cLogger::GetInstance().AttachListener(std::move(consoleLogListener));
+
+	// Parse the commandline:
+	int NumChunks = 400;
+	int Seed = 0;
+	AString IniFileName, JsonFileName;
+	for (int i = 1; i < argc; i++)
+	{
+		const AString Arg(argv[i]);
+		if (i + 1 >= argc)
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+		const AString Value(argv[++i]);
+		bool IsValid = true;
+		if (NoCaseCompare(Arg, "-chunks") == 0)
+		{
+			IsValid = StringToInteger(Value, NumChunks) && (NumChunks > 0);
+		}
+		else if (NoCaseCompare(Arg, "-seed") == 0)
+		{
+			IsValid = StringToInteger(Value, Seed);
+		}
+		else if (NoCaseCompare(Arg, "-ini") == 0)
+		{
+			IniFileName = Value;
+		}
+		else if (NoCaseCompare(Arg, "-json") == 0)
+		{
+			JsonFileName = Value;
+		}
+		else
+		{
+			IsValid = false;
+		}
+		if (!IsValid)
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Create the generator; the seed from the commandline overrides the one in the INI file:
+	cIniFile IniFile;
+	if (!IniFileName.empty() && !IniFile.ReadFile(IniFileName))
+	{
+		LOGERROR("Cannot read the INI file %s", IniFileName);
+		return EXIT_FAILURE;
+	}
+	IniFile.SetValueI("Seed", "Seed", Seed);
+	IniFile.SetValue("Generator", "Generator", "Composable");
+	cComposableGenerator Generator;
+	Generator.Initialize(IniFile);
+	cStageProfiler Profiler;
+	Generator.SetStageObserver(&Profiler);
+
+	// Generate the chunks, row by row in a square around [0, 0]:
+	const auto SquareSize = static_cast<int>(std::ceil(std::sqrt(NumChunks)));
+	const auto MinCoord = -SquareSize / 2;
+	LOG("Generating %d chunks with seed %d...", NumChunks, Seed);
+	cGeneratedChunks Chunks;
+	std::vector<cChunkCoords> Order;
+	const auto GenerationStart = std::chrono::steady_clock::now();
+	for (int i = 0; i < NumChunks; i++)
+	{
+		const cChunkCoords Coords(MinCoord + i % SquareSize, MinCoord + i / SquareSize);
+		cChunkDesc ChunkDesc(Coords);
+		Generator.Generate(ChunkDesc);
+		Chunks[Coords] = StoreChunk(ChunkDesc);
+		Order.push_back(Coords);
+	}
+	const auto GenerationTime = std::chrono::steady_clock::now() - GenerationStart;
+	Generator.SetStageObserver(nullptr);
+
+	// Light and serialize each chunk:
+	static const AString LightingStage("Lighting");
+	static const AString SerializationStage("Serialization");
+	const ChunkLightData NoLight;
+	auto Lighter = std::make_unique<cChunkLighter>();
+	const cChunkLighter::cChunkDataGetter GetChunkData = [&Chunks, &NoLight](cChunkCoords a_Coords, cChunkDataCallback & a_Callback)
+	{
+		const auto itr = Chunks.find(a_Coords);
+		if (itr == Chunks.end())
+		{
+			return false;
+		}
+		a_Callback.ChunkData(itr->second->m_BlockData, NoLight);
+		a_Callback.HeightMap(itr->second->m_HeightMap);
+		return true;
+	};
+	Compression::Compressor Compressor;
+	size_t TotalSerializedSize = 0;
+	for (const auto & Coords : Order)
+	{
+		auto & Chunk = *Chunks[Coords];
+		Profiler.Measure(LightingStage, [&]()
+			{
+				cChunkDef::BlockNibbles BlockLight, SkyLight;
+				Lighter->Light(Coords, GetChunkData, BlockLight, SkyLight);
+				Chunk.m_LightData.SetAll(BlockLight, SkyLight);
+			}
+		);
+		Profiler.Measure(SerializationStage, [&]()
+			{
+				TotalSerializedSize += SerializeChunk(Coords, Chunk, Compressor);
+			}
+		);
+	}
+
+	// Report:
+	const auto GenerationMs = std::chrono::duration<double, std::milli>(GenerationTime).count();
+	LOG("Generated %d chunks in %.1f ms, %.1f chunks per second", NumChunks, GenerationMs, NumChunks * 1000 / GenerationMs);
+	LOG("Serialized size: %zu bytes, %.1f bytes per chunk", TotalSerializedSize, static_cast<double>(TotalSerializedSize) / NumChunks);
+	Json::Value Root;
+	Root["chunks"] = NumChunks;
+	Root["seed"] = Seed;
+	Root["iniFile"] = IniFileName;
+	Root["generationMs"] = GenerationMs;
+	Root["serializedBytes"] = static_cast<Json::UInt64>(TotalSerializedSize);
+	Root["stages"] = Profiler.Report();
+
+	if (!JsonFileName.empty())
+	{
+		const auto Json = JsonUtils::WriteStyledString(Root);
+		cFile f;
+		if (!f.Open(JsonFileName, cFile::fmWrite) || (f.Write(Json) != static_cast<int>(Json.size())))
+		{
+			LOGERROR("Cannot write the JSON output into %s", JsonFileName);
+			return EXIT_FAILURE;
+		}
+		LOG("The results have been written to %s", JsonFileName);
+	}
+
+	return EXIT_SUCCESS;
 }
@@ -0,0 +1,316 @@
+
+// NBTSpeedTest.cpp
+
+// Implements the main app entrypoint
+
+/*
+This program measures the performance of parsing the chunk NBT data and of looking up the tags in it.
+It reads all the chunks from the Anvil region files given on the commandline, so that it works on real world data,
+decompresses them into memory and then times:
+	- parsing only
+	- parsing and the lookups done by the chunk loader, with the linear child search
+	- parsing and the lookups done by the chunk loader, with the hashed child name index
+	- the section lookups done by separate searches vs. a single pass over the section's children
+*/
+
+#include "Globals.h"
+#include "StringCompression.h"
+#include "WorldStorage/FastNBT.h"
+#include "Logger.h"
+#include "LoggerListeners.h"
+
+
+
+
+
+/** The names that the chunk loader looks up in the Level compound. */
+static const char * g_LevelTagNames[] =
+{
+	"xPos", "zPos", "Sections", "Biomes", "HeightMap", "Entities", "TileEntities", "MCSIsLightValid",
+};
+
+/** The names that the chunk loader looks up in each section. */
+static const std::string_view g_SectionTagNames[] = { "Y", "Blocks", "Data", "BlockLight", "SkyLight" };
+
+
+
+
+
+/** Runs the specified function the specified number of times, prints the time it took. */
+template <typename Function>
+static void measure(const char * a_Name, int a_NumIterations, size_t a_NumChunks, Function a_Function)
+{
+	auto timeStart = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < a_NumIterations; ++i)
+	{
+		a_Function();
+	}
+	auto timeEnd = std::chrono::high_resolution_clock::now();
+	auto usec = std::chrono::duration_cast<std::chrono::microseconds>(timeEnd - timeStart);
+	const auto ChunksPerSec = static_cast<double>(a_NumChunks) * a_NumIterations / std::max<double>(1, static_cast<double>(usec.count())) * 1e6;
+	printf("%-32s took %9d microseconds, %9.0f chunks / sec\n", a_Name, static_cast<int>(usec.count()), ChunksPerSec);
+}
+
+
+
+
+
+/** Reads all the chunks from the specified region file, decompresses them and appends them to a_Chunks.
+Returns the number of chunks read. */
+static size_t readRegionFile(const AString & a_FileName, std::vector<ContiguousByteBuffer> & a_Chunks)
+{
+	const auto Contents = cFile::ReadWholeFile(a_FileName);
+	if (Contents.size() < 8192)
+	{
+		printf("Cannot read region file %s, skipping\n", a_FileName.c_str());
+		return 0;
+	}
+	const auto Data = reinterpret_cast<const Byte *>(Contents.data());
+
+	Compression::Extractor Extractor;
+	size_t NumChunks = 0;
+	for (size_t i = 0; i < 1024; i++)
+	{
+		// The header holds the chunk's offset in 4 KiB sectors (3 bytes, big-endian) followed by its size in sectors:
+		const size_t Offset = ((static_cast<size_t>(Data[4 * i]) << 16) | (static_cast<size_t>(Data[4 * i + 1]) << 8) | Data[4 * i + 2]) * 4096;
+		if ((Offset == 0) || (Offset + 5 > Contents.size()))
+		{
+			continue;
+		}
+
+		// The chunk starts with its length (4 bytes, big-endian), including the compression method byte:
+		const size_t Length = (static_cast<size_t>(Data[Offset]) << 24) | (static_cast<size_t>(Data[Offset + 1]) << 16) | (static_cast<size_t>(Data[Offset + 2]) << 8) | Data[Offset + 3];
+		if ((Length < 1) || (Offset + 4 + Length > Contents.size()) || (Data[Offset + 4] != 2))
+		{
+			// Not a valid zlib-compressed chunk
+			continue;
+		}
+
+		try
+		{
+			const auto Extracted = Extractor.ExtractZLib({ reinterpret_cast<const std::byte *>(Data + Offset + 5), Length - 1 });
+			const auto View = Extracted.GetView();
+			a_Chunks.emplace_back(View.begin(), View.end());
+			NumChunks++;
+		}
+		catch (const std::exception & Oops)
+		{
+			printf("Cannot decompress chunk #%u in %s: %s\n", static_cast<unsigned>(i), a_FileName.c_str(), Oops.what());
+		}
+	}
+	return NumChunks;
+}
+
+
+
+
+
+/** Performs the tag lookups that the chunk loader does, each one using FindChildByName().
+Returns the sum of the found tags, so that the lookups cannot be optimized away. */
+static Int64 lookupTags(const cParsedNBT & a_NBT)
+{
+	Int64 Sum = 0;
+	if (!a_NBT.IsValid())
+	{
+		return Sum;
+	}
+	const int Level = a_NBT.FindChildByName(0, "Level");
+	for (const auto Name : g_LevelTagNames)
+	{
+		Sum += a_NBT.FindChildByName(Level, Name);
+	}
+	const int Sections = a_NBT.FindChildByName(Level, "Sections");
+	if ((Sections < 0) || (a_NBT.GetType(Sections) != TAG_List))
+	{
+		return Sum;
+	}
+	for (int Section = a_NBT.GetFirstChild(Sections); Section >= 0; Section = a_NBT.GetNextSibling(Section))
+	{
+		for (const auto Name : g_SectionTagNames)
+		{
+			Sum += a_NBT.FindChildByName(Section, Name);
+		}
+	}
+	return Sum;
+}
+
+
+
+
+
+/** Performs the section lookups that the chunk loader does, using a single pass over each section's children.
+Returns the sum of the found tags, same as lookupTags() for the sections. */
+static Int64 lookupSectionsSinglePass(const cParsedNBT & a_NBT)
+{
+	Int64 Sum = 0;
+	if (!a_NBT.IsValid())
+	{
+		return Sum;
+	}
+	const int Sections = a_NBT.FindTagByPath(0, "Level\\Sections");
+	if ((Sections < 0) || (a_NBT.GetType(Sections) != TAG_List))
+	{
+		return Sum;
+	}
+	for (int Section = a_NBT.GetFirstChild(Sections); Section >= 0; Section = a_NBT.GetNextSibling(Section))
+	{
+		int Tags[std::size(g_SectionTagNames)];
+		a_NBT.FindChildrenByName(Section, g_SectionTagNames, Tags);
+		Sum = std::accumulate(std::begin(Tags), std::end(Tags), Sum);
+	}
+	return Sum;
+}
+
+
+
+
+
+/** Performs the section lookups that the chunk loader used to do, each one using FindChildByName(). */
+static Int64 lookupSectionsSeparately(const cParsedNBT & a_NBT)
+{
+	Int64 Sum = 0;
+	if (!a_NBT.IsValid())
+	{
+		return Sum;
+	}
+	const int Sections = a_NBT.FindTagByPath(0, "Level\\Sections");
+	if ((Sections < 0) || (a_NBT.GetType(Sections) != TAG_List))
+	{
+		return Sum;
+	}
+	for (int Section = a_NBT.GetFirstChild(Sections); Section >= 0; Section = a_NBT.GetNextSibling(Section))
+	{
+		for (const auto Name : g_SectionTagNames)
+		{
+			Sum += a_NBT.FindChildByName(Section, Name);
+		}
+	}
+	return Sum;
+}
+
+
+
+
+
+int main(int argc, char ** argv)
+{
+	auto consoleLogListener = MakeConsoleListener(false);
+	auto consoleAttachment = cLogger::GetInstance().AttachListener(std::move(consoleLogListener));
+
+	if (argc < 2)
+	{
+		printf("Usage: NBTSpeedTest <regionfile.mca> [<regionfile.mca> ...]\n");
+		return EXIT_FAILURE;
+	}
+
+	std::vector<ContiguousByteBuffer> Chunks;
+	size_t TotalSize = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		readRegionFile(argv[i], Chunks);
+	}
+	for (const auto & Chunk : Chunks)
+	{
+		TotalSize += Chunk.size();
+	}
+	if (Chunks.empty())
+	{
+		printf("No chunks found in the region files\n");
+		return EXIT_FAILURE;
+	}
+	printf("Read %u chunks, %u KiB of NBT data\n", static_cast<unsigned>(Chunks.size()), static_cast<unsigned>(TotalSize / 1024));
+
+	// Check that the indexed lookups find the same tags as the linear ones:
+	size_t NumInvalid = 0, NumMismatches = 0;
+	for (const auto & Chunk : Chunks)
+	{
+		cParsedNBT Linear(Chunk);
+		cParsedNBT Indexed(Chunk);
+		Indexed.SetIndexChildNames(true);
+		if (!Linear.IsValid())
+		{
+			NumInvalid++;
+			continue;
+		}
+		if (
+			(lookupTags(Linear) != lookupTags(Indexed)) ||
+			(lookupSectionsSeparately(Linear) != lookupSectionsSinglePass(Linear))
+		)
+		{
+			NumMismatches++;
+		}
+	}
+	printf("Invalid chunks: %u, lookup mismatches: %u\n", static_cast<unsigned>(NumInvalid), static_cast<unsigned>(NumMismatches));
+
+	// Perform each test twice, to account for cache-warmup:
+	const int numIterations = 10;
+	Int64 Checksum = 0;
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		measure("Parse", numIterations, Chunks.size(), [&]()
+			{
+				for (const auto & Chunk : Chunks)
+				{
+					cParsedNBT NBT(Chunk);
+					Checksum += NBT.GetRoot();
+				}
+			}
+		);
+		measure("Parse and look up, linear", numIterations, Chunks.size(), [&]()
+			{
+				for (const auto & Chunk : Chunks)
+				{
+					cParsedNBT NBT(Chunk);
+					Checksum += lookupTags(NBT);
+				}
+			}
+		);
+		measure("Parse and look up, indexed", numIterations, Chunks.size(), [&]()
+			{
+				for (const auto & Chunk : Chunks)
+				{
+					cParsedNBT NBT(Chunk);
+					NBT.SetIndexChildNames(true);
+					Checksum += lookupTags(NBT);
+				}
+			}
+		);
+	}
+
+	// The section lookups are measured on already parsed data, they're a small part of the whole:
+	std::vector<std::unique_ptr<cParsedNBT>> Parsed;
+	Parsed.reserve(Chunks.size());
+	for (const auto & Chunk : Chunks)
+	{
+		Parsed.push_back(std::make_unique<cParsedNBT>(Chunk));
+	}
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		measure("Sections, separate lookups", numIterations * 10, Chunks.size(), [&]()
+			{
+				for (const auto & NBT : Parsed)
+				{
+					Checksum += lookupSectionsSeparately(*NBT);
+				}
+			}
+		);
+		measure("Sections, single pass", numIterations * 10, Chunks.size(), [&]()
+			{
+				for (const auto & NBT : Parsed)
+				{
+					Checksum += lookupSectionsSinglePass(*NBT);
+				}
+			}
+		);
+	}
+
+	// Do not let the optimizer optimize the whole calculation away:
+	printf("Checksum: %lld\n", static_cast<long long>(Checksum));
+
+	// If build on Windows using MSVC, wait for a keypress before ending:
+	#ifdef _MSC_VER
+		getchar();
+	#endif
+
+	return 0;
+}
@@ -0,0 +1,146 @@
+// NibbleSpeedTest.cpp
+
+// Implements the main app entrypoint
+
+/*
+This program compares the performance of the vectorized nibble kernels against their scalar reference implementation.
+The data sizes match the typical usage: whole-chunk light arrays for the plain expand and compress,
+and the middle chunk of the lighting thread's 3x3-chunk XZY blob for the strided gather and scatter.
+*/
+
+#include "Globals.h"
+#include "NibbleKernels.h"
+
+
+
+
+
+/** The size of the 3x3-chunk blob the lighting thread works on. */
+static const size_t BLOB_ROW_STRIDE = cChunkDef::Width * 3;
+static const size_t BLOB_SIZE = cChunkDef::NumBlocks * 9;
+
+
+
+
+
+/** Runs the specified function the specified number of times, prints the time it took. */
+template <typename Function>
+static void measure(const char * a_Name, int a_NumIterations, size_t a_NumNibbles, Function a_Function)
+{
+	auto timeStart = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < a_NumIterations; ++i)
+	{
+		a_Function();
+	}
+	auto timeEnd = std::chrono::high_resolution_clock::now();
+	auto usec = std::chrono::duration_cast<std::chrono::microseconds>(timeEnd - timeStart);
+	const auto NibblesPerSec = static_cast<double>(a_NumNibbles) * a_NumIterations / std::max<double>(1, static_cast<double>(usec.count())) * 1e6;
+	printf("%-28s took %7d microseconds, %8.1f MiNibbles / sec\n", a_Name, static_cast<int>(usec.count()), NibblesPerSec / (1024 * 1024));
+}
+
+
+
+
+
+/** Strided gather of the middle chunk, using the scalar kernel row by row, the way the lighting thread used to. */
+static void scalarGatherCompress(const NIBBLETYPE * a_Blob, NIBBLETYPE * a_Packed)
+{
+	for (size_t y = 0; y < cChunkDef::Height; y++)
+	{
+		for (size_t z = 0; z < cChunkDef::Width; z++)
+		{
+			const auto Row = y * cChunkDef::Width + z;
+			NibbleKernels::Scalar::Compress(
+				a_Blob + cChunkDef::Width * 49 + y * BLOB_ROW_STRIDE * BLOB_ROW_STRIDE + z * BLOB_ROW_STRIDE,
+				a_Packed + Row * cChunkDef::Width / 2, cChunkDef::Width
+			);
+		}
+	}
+}
+
+
+
+
+
+/** Strided gather of the middle chunk using the selected kernels, the way the lighting thread does. */
+static void kernelGatherCompress(const NIBBLETYPE * a_Blob, NIBBLETYPE * a_Packed)
+{
+	for (size_t y = 0; y < cChunkDef::Height; y++)
+	{
+		NibbleKernels::GatherCompress(
+			a_Blob + cChunkDef::Width * 49 + y * BLOB_ROW_STRIDE * BLOB_ROW_STRIDE, cChunkDef::Width, BLOB_ROW_STRIDE, cChunkDef::Width,
+			a_Packed + y * cChunkDef::Width * cChunkDef::Width / 2
+		);
+	}
+}
+
+
+
+
+
+/** Strided scatter into the middle chunk using the selected kernels. */
+static void kernelExpandScatter(const NIBBLETYPE * a_Packed, NIBBLETYPE * a_Blob)
+{
+	for (size_t y = 0; y < cChunkDef::Height; y++)
+	{
+		NibbleKernels::ExpandScatter(
+			a_Packed + y * cChunkDef::Width * cChunkDef::Width / 2, cChunkDef::Width, BLOB_ROW_STRIDE, cChunkDef::Width,
+			a_Blob + cChunkDef::Width * 49 + y * BLOB_ROW_STRIDE * BLOB_ROW_STRIDE
+		);
+	}
+}
+
+
+
+
+
+int main(int argc, char ** argv)
+{
+	int numIterations = 1000;
+	if (argc > 1)
+	{
+		numIterations = std::atoi(argv[1]);
+		if (numIterations < 10)
+		{
+			printf("Invalid number of iterations, using 1000 instead\n");
+			numIterations = 1000;
+		}
+	}
+
+	printf("Using the %s nibble kernels\n", NibbleKernels::GetImplementationName());
+
+	std::vector<NIBBLETYPE> packed(cChunkDef::NumBlocks / 2);
+	std::vector<NIBBLETYPE> expanded(cChunkDef::NumBlocks);
+	std::vector<NIBBLETYPE> blob(BLOB_SIZE);
+	std::minstd_rand random(1);
+	for (auto & Value : packed)
+	{
+		Value = static_cast<NIBBLETYPE>(random());
+	}
+	for (auto & Value : blob)
+	{
+		Value = static_cast<NIBBLETYPE>(random() % 16);
+	}
+
+	// Perform each test twice, to account for cache-warmup:
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		measure("Scalar expand",  numIterations, cChunkDef::NumBlocks, [&]() { NibbleKernels::Scalar::Expand(packed.data(), expanded.data(), cChunkDef::NumBlocks); });
+		measure("Kernel expand",  numIterations, cChunkDef::NumBlocks, [&]() { NibbleKernels::Expand(packed.data(), expanded.data(), cChunkDef::NumBlocks); });
+		measure("Scalar compress", numIterations, cChunkDef::NumBlocks, [&]() { NibbleKernels::Scalar::Compress(expanded.data(), packed.data(), cChunkDef::NumBlocks); });
+		measure("Kernel compress", numIterations, cChunkDef::NumBlocks, [&]() { NibbleKernels::Compress(expanded.data(), packed.data(), cChunkDef::NumBlocks); });
+		measure("Scalar XZY gather-compress", numIterations, cChunkDef::NumBlocks, [&]() { scalarGatherCompress(blob.data(), packed.data()); });
+		measure("Kernel XZY gather-compress", numIterations, cChunkDef::NumBlocks, [&]() { kernelGatherCompress(blob.data(), packed.data()); });
+		measure("Kernel XZY expand-scatter", numIterations, cChunkDef::NumBlocks, [&]() { kernelExpandScatter(packed.data(), blob.data()); });
+	}
+
+	// Do not let the optimizer optimize the whole calculation away:
+	printf("Checksum: %d\n", std::accumulate(packed.begin(), packed.end(), 0) + std::accumulate(blob.begin(), blob.end(), 0));
+
+	// If build on Windows using MSVC, wait for a keypress before ending:
+	#ifdef _MSC_VER
+		getchar();
+	#endif
+
+	return 0;
+}
@@ -9,11 +9,15 @@ Also, the performance difference between using a float and double as datatype is
 
 The testing is done on a usage of the generator that is typical for the Cuberite's terrain generator: generate a 3D array of numbers with
 not much variance in the coords. The exact sizes and coord ranges were adapted from the cNoise3DComposable generator.
+
+It also compares the vectorized cCubicNoise and cImprovedNoise kernels against their scalar reference implementation,
+both for speed and for producing bit-identical results.
 */
 
 #include "Globals.h"
 #include "Noise/Noise.h"
 #include "Noise/InterpolNoise.h"
+#include "Noise/NoiseKernels.h"
 #include "SimplexNoise.h"
 
 
@@ -87,6 +91,68 @@ template<typename DATATYPE> static void measureSimplexNoise(int a_NumIterations,
 
 
 
+/** Fills a_Out with the noise selected by a_Kind, for the iteration a_Iteration:
+0 = cCubicNoise 2D, 1 = cCubicNoise 3D, 2 = cImprovedNoise 2D, 3 = cImprovedNoise 3D. */
+static void generateKernelNoise(const cCubicNoise & a_Cubic, const cImprovedNoise & a_Improved, int a_Kind, int a_Iteration, NOISE_DATATYPE * a_Out)
+{
+	// Both positive and negative coords, so that FAST_FLOOR's negative branch is exercised, too:
+	int blockX = (a_Iteration - 500) * 16;
+	int blockZ = (a_Iteration - 300) * 16;
+	NOISE_DATATYPE startX = blockX / 40.0f;
+	NOISE_DATATYPE endX = (blockX + 16) / 40.0f;
+	NOISE_DATATYPE startY = 0;
+	NOISE_DATATYPE endY = 257 / 80.0f;
+	NOISE_DATATYPE startZ = blockZ / 40.0f;
+	NOISE_DATATYPE endZ = (blockZ + 16) / 40.0f;
+	switch (a_Kind)
+	{
+		case 0: a_Cubic.Generate2D(a_Out, 16, 16, startX, endX, startZ, endZ); break;
+		case 1: a_Cubic.Generate3D(a_Out, SIZE_X, SIZE_Y, SIZE_Z, startY, endY, startX, endX, startZ, endZ); break;
+		case 2: a_Improved.Generate2D(a_Out, 16, 16, startX, endX, startZ, endZ); break;
+		case 3: a_Improved.Generate3D(a_Out, SIZE_X, SIZE_Y, SIZE_Z, startY, endY, startX, endX, startZ, endZ); break;
+	}
+}
+
+
+
+
+
+/** Measures the scalar and the vectorized noise kernels on the specified kind of noise (see generateKernelNoise()).
+Returns false if their results differ. */
+static bool measureKernelNoise(int a_NumIterations, int a_Kind, const char * a_Name)
+{
+	cCubicNoise cubic(1);
+	cImprovedNoise improved(1);
+	const size_t count = SIZE_X * SIZE_Y * SIZE_Z;
+	std::vector<NOISE_DATATYPE> scalarOut(count * static_cast<size_t>(a_NumIterations));
+	std::vector<NOISE_DATATYPE> vectorOut(count * static_cast<size_t>(a_NumIterations));
+	int msec[2];
+	for (int useVector = 0; useVector < 2; ++useVector)
+	{
+		NoiseKernels::ForceScalar(useVector == 0);
+		auto & out = (useVector == 0) ? scalarOut : vectorOut;
+		auto timeStart = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < a_NumIterations; ++i)
+		{
+			generateKernelNoise(cubic, improved, a_Kind, i, out.data() + count * static_cast<size_t>(i));
+		}
+		auto timeEnd = std::chrono::high_resolution_clock::now();
+		msec[useVector] = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - timeStart).count());
+	}
+	NoiseKernels::ForceScalar(false);
+
+	// Compare the bit patterns, so that even a difference in the sign of a zero is caught:
+	bool isIdentical = (memcmp(scalarOut.data(), vectorOut.data(), scalarOut.size() * sizeof(NOISE_DATATYPE)) == 0);
+	printf("%-18s scalar took %5d milliseconds, %s took %5d milliseconds, results %s\n",
+		a_Name, msec[0], NoiseKernels::GetImplementationName(), msec[1], isIdentical ? "identical" : "DIFFER"
+	);
+	return isIdentical;
+}
+
+
+
+
+
 int main(int argc, char ** argv)
 {
 	int numIterations = 10000;
@@ -108,10 +174,18 @@ int main(int argc, char ** argv)
 	measureSimplexNoise<double>(numIterations, "double");
 	measureSimplexNoise<double>(numIterations, "double");
 
+	// Compare the noise kernels:
+	printf("Using the %s noise kernels\n", NoiseKernels::GetImplementationName());
+	bool areKernelsIdentical = true;
+	areKernelsIdentical = measureKernelNoise(numIterations, 0, "CubicNoise 2D") && areKernelsIdentical;
+	areKernelsIdentical = measureKernelNoise(numIterations, 1, "CubicNoise 3D") && areKernelsIdentical;
+	areKernelsIdentical = measureKernelNoise(numIterations, 2, "ImprovedNoise 2D") && areKernelsIdentical;
+	areKernelsIdentical = measureKernelNoise(numIterations, 3, "ImprovedNoise 3D") && areKernelsIdentical;
+
 	// If build on Windows using MSVC, wait for a keypress before ending:
 	#ifdef _MSC_VER
 		getchar();
 	#endif
 
-	return 0;
+	return areKernelsIdentical ? 0 : 1;
 }
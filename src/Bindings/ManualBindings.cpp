@@ -3534,6 +3534,43 @@ static int tolua_cRoot_GetBrewingRecipe(lua_State * tolua_S)
 
 
 
+static int tolua_cRoot_GetChunkSectionPoolStats(lua_State * tolua_S)
+{
+	// Function signature:
+	// cRoot:GetChunkSectionPoolStats() -> { NumLive = ..., LiveBytes = ..., NumPooled = ..., ... }
+
+	cLuaState L(tolua_S);
+	if (
+		!L.CheckParamStaticSelf("cRoot") ||
+		!L.CheckParamEnd(2)
+	)
+	{
+		return 0;
+	}
+
+	const auto Stats = ChunkSectionPool::GetStats();
+	lua_createtable(tolua_S, 0, 7);
+	L.Push(static_cast<double>(Stats.NumLive));
+	lua_setfield(tolua_S, -2, "NumLive");
+	L.Push(static_cast<double>(Stats.LiveBytes));
+	lua_setfield(tolua_S, -2, "LiveBytes");
+	L.Push(static_cast<double>(Stats.NumPooled));
+	lua_setfield(tolua_S, -2, "NumPooled");
+	L.Push(static_cast<double>(Stats.PooledBytes));
+	lua_setfield(tolua_S, -2, "PooledBytes");
+	L.Push(static_cast<double>(Stats.RetentionBytes));
+	lua_setfield(tolua_S, -2, "RetentionBytes");
+	L.Push(static_cast<double>(Stats.NumAllocations));
+	lua_setfield(tolua_S, -2, "NumAllocations");
+	L.Push(static_cast<double>(Stats.NumReused));
+	lua_setfield(tolua_S, -2, "NumReused");
+	return 1;
+}
+
+
+
+
+
 static int tolua_cRoot_GetFurnaceRecipe(lua_State * tolua_S)
 {
 	cLuaState L(tolua_S);
@@ -4715,6 +4752,7 @@ void cManualBindings::Bind(lua_State * tolua_S)
 			tolua_function(tolua_S, "GetBuildDateTime",    tolua_cRoot_GetBuildDateTime);
 			tolua_function(tolua_S, "GetBuildID",          tolua_cRoot_GetBuildID);
 			tolua_function(tolua_S, "GetBuildSeriesName",  tolua_cRoot_GetBuildSeriesName);
+			tolua_function(tolua_S, "GetChunkSectionPoolStats", tolua_cRoot_GetChunkSectionPoolStats);
 			tolua_function(tolua_S, "GetFurnaceRecipe",    tolua_cRoot_GetFurnaceRecipe);
 		tolua_endmodule(tolua_S);
 
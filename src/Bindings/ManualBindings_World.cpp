@@ -1483,6 +1483,84 @@ static int tolua_cWorld_SetBlock(lua_State * tolua_S)
 
 
 
+static int tolua_cWorld_SetBlocks(lua_State * tolua_S)
+{
+	/* Function signature:
+	World:SetBlocks(BlockChanges)
+	BlockChanges == { {BlockX, BlockY, BlockZ, BlockType, BlockMeta}, ... }, BlockMeta is optional
+	*/
+
+	cLuaState L(tolua_S);
+	if (
+		!L.CheckParamSelf("cWorld") ||
+		!L.CheckParamTable(2) ||
+		!L.CheckParamEnd(3)
+	)
+	{
+		return 0;
+	}
+
+	cWorld * World;
+	cLuaState::cStackTablePtr Changes;
+	if (!L.GetStackValues(1, World, Changes))
+	{
+		return 0;
+	}
+
+	if (World == nullptr)
+	{
+		return cManualBindings::lua_do_error(tolua_S, "Error in function call '#funcname#': Invalid 'self'");
+	}
+
+	// Read all the changes before applying any of them:
+	sSetBlockVector Blocks;
+	int InvalidIndex = 0;
+	Changes->ForEachArrayElement([&Blocks, &InvalidIndex](cLuaState & a_LuaState, int a_Index)
+	{
+		if (!lua_istable(a_LuaState, -1))
+		{
+			InvalidIndex = a_Index;
+			return true;
+		}
+
+		// Push the five fields; each push moves the element table one slot deeper:
+		for (int Field = 1; Field <= 5; Field++)
+		{
+			lua_rawgeti(a_LuaState, -Field, Field);
+		}
+
+		Vector3i Position;
+		BLOCKTYPE Type;
+		NIBBLETYPE Meta = 0;
+		const bool IsValid = (
+			a_LuaState.GetStackValues(-5, Position.x, Position.y, Position.z, Type) &&
+			(lua_isnil(a_LuaState, -1) || a_LuaState.GetStackValue(-1, Meta)) &&
+			cChunkDef::IsValidHeight(Position)
+		);
+		lua_pop(a_LuaState, 5);
+
+		if (!IsValid)
+		{
+			InvalidIndex = a_Index;
+			return true;
+		}
+		Blocks.emplace_back(Position, Type, Meta);
+		return false;
+	});
+
+	if (InvalidIndex != 0)
+	{
+		return cManualBindings::lua_do_error(tolua_S, "Error in function call '#funcname#': Invalid block change #%d, expected {BlockX, BlockY, BlockZ, BlockType, [BlockMeta]}", InvalidIndex);
+	}
+
+	World->SetBlocks(Blocks);
+	return 0;
+}
+
+
+
+
+
 static int tolua_cWorld_SetBlockMeta(lua_State * tolua_S)
 {
 	/* Function signature:
@@ -1817,6 +1895,7 @@ void cManualBindings::BindWorld(lua_State * tolua_S)
 			tolua_function(tolua_S, "ScheduleTask",                 tolua_cWorld_ScheduleTask);
 			tolua_function(tolua_S, "SetBlock",                     tolua_cWorld_SetBlock);
 			tolua_function(tolua_S, "SetBlockMeta",                 tolua_cWorld_SetBlockMeta);
+			tolua_function(tolua_S, "SetBlocks",                    tolua_cWorld_SetBlocks);
 			tolua_function(tolua_S, "SetSignLines",                 tolua_cWorld_SetSignLines);
 			tolua_function(tolua_S, "SetTimeOfDay",                 tolua_cWorld_SetTimeOfDay);
 			tolua_function(tolua_S, "SpawnSplitExperienceOrbs",     tolua_cWorld_SpawnSplitExperienceOrbs);
@@ -26,6 +26,7 @@
 #include "MobSpawner.h"
 #include "BlockInServerPluginInterface.h"
 #include "SetChunkData.h"
+#include "IncrementalLighting.h"
 #include "BoundingBox.h"
 #include "Blocks/ChunkInterface.h"
 
@@ -56,26 +57,18 @@ cChunk::cChunk(
 	m_RedstoneSimulatorData(a_World->GetRedstoneSimulator()->CreateChunkData()),
 	m_AlwaysTicked(0)
 {
-	m_NeighborXM = a_ChunkMap->FindChunk(a_ChunkX - 1, a_ChunkZ);
-	m_NeighborXP = a_ChunkMap->FindChunk(a_ChunkX + 1, a_ChunkZ);
-	m_NeighborZM = a_ChunkMap->FindChunk(a_ChunkX, a_ChunkZ - 1);
-	m_NeighborZP = a_ChunkMap->FindChunk(a_ChunkX, a_ChunkZ + 1);
-
-	if (m_NeighborXM != nullptr)
-	{
-		m_NeighborXM->m_NeighborXP = this;
-	}
-	if (m_NeighborXP != nullptr)
+	// Link with the neighbors both ways:
+	for (int OffsetX = -1; OffsetX <= 1; OffsetX++)
 	{
-		m_NeighborXP->m_NeighborXM = this;
-	}
-	if (m_NeighborZM != nullptr)
-	{
-		m_NeighborZM->m_NeighborZP = this;
-	}
-	if (m_NeighborZP != nullptr)
-	{
-		m_NeighborZP->m_NeighborZM = this;
+		for (int OffsetZ = -1; OffsetZ <= 1; OffsetZ++)
+		{
+			auto Neighbor = ((OffsetX == 0) && (OffsetZ == 0)) ? this : a_ChunkMap->FindChunk(a_ChunkX + OffsetX, a_ChunkZ + OffsetZ);
+			m_Neighbors[OffsetX + 1][OffsetZ + 1] = Neighbor;
+			if (Neighbor != nullptr)
+			{
+				Neighbor->m_Neighbors[1 - OffsetX][1 - OffsetZ] = this;
+			}
+		}
 	}
 }
 
@@ -88,21 +81,16 @@ cChunk::~cChunk()
 	// LOGINFO("### delete cChunk() (%i, %i) from %p, thread 0x%x ###", m_PosX, m_PosZ, this, GetCurrentThreadId());
 
 	// Inform our neighbours that we're no longer valid:
-	if (m_NeighborXM != nullptr)
+	for (int OffsetX = -1; OffsetX <= 1; OffsetX++)
 	{
-		m_NeighborXM->m_NeighborXP = nullptr;
-	}
-	if (m_NeighborXP != nullptr)
-	{
-		m_NeighborXP->m_NeighborXM = nullptr;
-	}
-	if (m_NeighborZM != nullptr)
-	{
-		m_NeighborZM->m_NeighborZP = nullptr;
-	}
-	if (m_NeighborZP != nullptr)
-	{
-		m_NeighborZP->m_NeighborZM = nullptr;
+		for (int OffsetZ = -1; OffsetZ <= 1; OffsetZ++)
+		{
+			const auto Neighbor = m_Neighbors[OffsetX + 1][OffsetZ + 1];
+			if ((Neighbor != nullptr) && (Neighbor != this))
+			{
+				Neighbor->m_Neighbors[1 - OffsetX][1 - OffsetZ] = nullptr;
+			}
+		}
 	}
 
 	delete m_WaterSimulatorData;
@@ -259,6 +247,10 @@ void cChunk::OnUnload()
 
 void cChunk::MarkSaving(void)
 {
+	// Release the sections that have become uniform since loading, before the saver looks at them:
+	m_BlockData.Compact();
+	m_LightData.Compact();
+
 	m_IsSaving = true;
 }
 
@@ -336,6 +328,7 @@ void cChunk::SetAllData(SetChunkData && a_SetChunkData)
 	m_BlockData = std::move(a_SetChunkData.BlockData);
 	m_LightData = std::move(a_SetChunkData.LightData);
 	m_IsLightValid = a_SetChunkData.IsLightValid;
+	m_PendingLightChanges.clear();
 
 	m_PendingSendBlocks.clear();
 	m_PendingSendBlockEntities.clear();
@@ -741,7 +734,15 @@ void cChunk::Tick(std::chrono::milliseconds a_Dt)
 			// This block is very similar to RemoveEntity, except it uses an iterator to avoid scanning the whole m_Entities
 			// The entity moved out of the chunk, move it to the neighbor
 			(*itr)->SetParentChunk(nullptr);
-			MoveEntityToNewChunk(std::move(*itr));
+			if (m_ChunkMap->IsTickingInParallel())
+			{
+				// The destination may be in a region that another thread is ticking, let the chunkmap move it later:
+				m_ChunkMap->DeferEntityMove(*this, std::move(*itr));
+			}
+			else
+			{
+				MoveEntityToNewChunk(std::move(*itr));
+			}
 
 			itr = m_Entities.erase(itr);
 		}
@@ -859,7 +860,7 @@ void cChunk::TickBlocks(void)
 	for (size_t Y = 0; Y < cChunkDef::NumSections; ++Y)
 	{
 		const auto Section = m_BlockData.GetSection(Y);
-		if (Section == nullptr)
+		if ((Section == nullptr) && (m_BlockData.GetSectionFill(Y) == E_BLOCK_AIR))
 		{
 			continue;
 		}
@@ -868,8 +869,9 @@ void cChunk::TickBlocks(void)
 		{
 			const auto Index = Random.RandInt<size_t>(ChunkBlockData::SectionBlockCount - 1);
 			const auto Position = cChunkDef::IndexToCoordinate(Y * ChunkBlockData::SectionBlockCount + Index);
+			const auto BlockType = (Section == nullptr) ? m_BlockData.GetSectionFill(Y) : (*Section)[Index];
 
-			cBlockHandler::For((*Section)[Index]).OnUpdate(ChunkInterface, *m_World, PluginInterface, *this, Position);
+			cBlockHandler::For(BlockType).OnUpdate(ChunkInterface, *m_World, PluginInterface, *this, Position);
 		}
 	}
 }
@@ -1249,14 +1251,15 @@ void cChunk::WakeUpSimulators(void)
 	for (size_t SectionIdx = 0; SectionIdx != cChunkDef::NumSections; ++SectionIdx)
 	{
 		const auto * Section = m_BlockData.GetSection(SectionIdx);
-		if (Section == nullptr)
+		const auto Fill = m_BlockData.GetSectionFill(SectionIdx);
+		if ((Section == nullptr) && (Fill == E_BLOCK_AIR))
 		{
 			continue;
 		}
 
 		for (size_t BlockIdx = 0; BlockIdx != ChunkBlockData::SectionBlockCount; ++BlockIdx)
 		{
-			const auto BlockType = (*Section)[BlockIdx];
+			const auto BlockType = (Section == nullptr) ? Fill : (*Section)[BlockIdx];
 			const auto Position = cChunkDef::IndexToCoordinate(BlockIdx + SectionIdx * ChunkBlockData::SectionBlockCount);
 
 			RedstoneSimulator->AddBlock(*this, Position, BlockType);
@@ -1280,6 +1283,107 @@ void cChunk::SetBlock(Vector3i a_RelPos, BLOCKTYPE a_BlockType, NIBBLETYPE a_Blo
 	// Wake up the simulators for this block:
 	GetWorld()->GetSimulatorManager()->WakeUp(*this, a_RelPos);
 
+	ReplaceBlockEntity(a_RelPos, a_BlockType, a_BlockMeta);
+}
+
+
+
+
+
+void cChunk::SetBlocks(const sSetBlockVector::const_iterator a_Begin, const sSetBlockVector::const_iterator a_End)
+{
+	ASSERT(IsValid());
+
+	// Blocks changed more than once in the batch only need processing once, with their final state.
+	// The merged changes are ordered by their index, so the changes of each section form a single range:
+	const auto Blocks = SetBlockBatch::MergeChunkChanges(a_Begin, a_End);
+	m_PendingSendBlocks.reserve(m_PendingSendBlocks.size() + Blocks.size());
+
+	// The highest changed block at or above each column's height, the column's height is recalculated from there; -1 if none:
+	std::array<int, cChunkDef::Width * cChunkDef::Width> HeightChanges;
+	HeightChanges.fill(-1);
+
+	bool ShouldMarkDirty = false;
+	for (auto SectionBegin = Blocks.cbegin(), End = Blocks.cend(); SectionBegin != End;)
+	{
+		const auto SectionY = SectionBegin->m_RelY / cChunkDef::SectionHeight;
+		const auto SectionEnd = std::find_if(SectionBegin, End, [SectionY](const sSetBlock & a_Block)
+		{
+			return ((a_Block.m_RelY / cChunkDef::SectionHeight) != SectionY);
+		});
+
+		// Do the same checks as FastSetBlock() against the old blocks, then write the whole section at once:
+		for (auto itr = SectionBegin; itr != SectionEnd; ++itr)
+		{
+			const auto RelPos = itr->GetRelativePos();
+			const auto OldBlockType = GetBlock(RelPos);
+			const auto OldBlockMeta = GetMeta(RelPos);
+			if ((OldBlockType == itr->m_BlockType) && (OldBlockMeta == itr->m_BlockMeta))
+			{
+				continue;
+			}
+
+			const bool ReplacingLiquids = IsReplacingLiquids(OldBlockType, itr->m_BlockType);
+			ShouldMarkDirty = ShouldMarkDirty || !ReplacingLiquids;
+			if (ShouldSendBlockChange(OldBlockType, OldBlockMeta, itr->m_BlockType, itr->m_BlockMeta, ReplacingLiquids))
+			{
+				m_PendingSendBlocks.push_back(*itr);
+			}
+			if (DoesChangeLight(OldBlockType, itr->m_BlockType))
+			{
+				QueueLightChange(RelPos);
+			}
+
+			const auto Column = static_cast<size_t>(RelPos.x + RelPos.z * cChunkDef::Width);
+			if (RelPos.y >= m_HeightMap[Column])
+			{
+				// The blocks are ordered by their Y coord, the last one is the highest:
+				HeightChanges[Column] = RelPos.y;
+			}
+		}
+		m_BlockData.SetSectionBlocks(SectionBegin, SectionEnd, static_cast<size_t>(SectionY));
+		SectionBegin = SectionEnd;
+	}
+
+	if (ShouldMarkDirty)
+	{
+		MarkDirty();
+	}
+
+	// Update the heightmap once per column, from the highest changed block down:
+	for (size_t Column = 0; Column < HeightChanges.size(); Column++)
+	{
+		const int RelX = static_cast<int>(Column % cChunkDef::Width);
+		const int RelZ = static_cast<int>(Column / cChunkDef::Width);
+		for (int y = HeightChanges[Column]; y > 0; --y)
+		{
+			if (GetBlock(RelX, y, RelZ) != E_BLOCK_AIR)
+			{
+				m_HeightMap[Column] = static_cast<HEIGHTTYPE>(y);
+				break;
+			}
+		}
+	}
+
+	// Same as in SetBlock(), each block's neighbors are checked and the simulators woken up before its block entity is replaced:
+	const auto SimulatorManager = GetWorld()->GetSimulatorManager();
+	for (const auto & Block : Blocks)
+	{
+		m_BlocksToCheck.push(Block.GetRelativePos());
+		SimulatorManager->WakeUp(*this, Block.GetRelativePos());
+	}
+	for (const auto & Block : Blocks)
+	{
+		ReplaceBlockEntity(Block.GetRelativePos(), Block.m_BlockType, Block.m_BlockMeta);
+	}
+}
+
+
+
+
+
+void cChunk::ReplaceBlockEntity(const Vector3i a_RelPos, const BLOCKTYPE a_BlockType, const NIBBLETYPE a_BlockMeta)
+{
 	// If there was a block entity, remove it:
 	if (const auto FindResult = m_BlockEntities.find(cChunkDef::MakeIndex(a_RelPos)); FindResult != m_BlockEntities.end())
 	{
@@ -1315,12 +1419,7 @@ void cChunk::FastSetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockT
 		return;
 	}
 
-	bool ReplacingLiquids = (
-		((OldBlockType == E_BLOCK_STATIONARY_WATER) && (a_BlockType == E_BLOCK_WATER)) ||             // Replacing stationary water with water
-		((OldBlockType == E_BLOCK_WATER)            && (a_BlockType == E_BLOCK_STATIONARY_WATER)) ||  // Replacing water with stationary water
-		((OldBlockType == E_BLOCK_STATIONARY_LAVA)  && (a_BlockType == E_BLOCK_LAVA)) ||              // Replacing stationary lava with lava
-		((OldBlockType == E_BLOCK_LAVA)             && (a_BlockType == E_BLOCK_STATIONARY_LAVA))      // Replacing lava with stationary lava
-	);
+	bool ReplacingLiquids = IsReplacingLiquids(OldBlockType, a_BlockType);
 
 	if (!ReplacingLiquids)
 	{
@@ -1329,16 +1428,7 @@ void cChunk::FastSetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockT
 
 	m_BlockData.SetBlock({ a_RelX, a_RelY, a_RelZ }, a_BlockType);
 
-	// Queue block to be sent only if ...
-	if (
-		!(                                // ... the old and new blocktypes AREN'T leaves (because the client doesn't need meta updates)
-			((OldBlockType == E_BLOCK_LEAVES) && (a_BlockType == E_BLOCK_LEAVES)) ||
-			((OldBlockType == E_BLOCK_NEW_LEAVES) && (a_BlockType == E_BLOCK_NEW_LEAVES))
-		) &&                              // ... AND ...
-		(
-			(OldBlockMeta != a_BlockMeta) || (!ReplacingLiquids)
-		)
-	)
+	if (ShouldSendBlockChange(OldBlockType, OldBlockMeta, a_BlockType, a_BlockMeta, ReplacingLiquids))
 	{
 		m_PendingSendBlocks.emplace_back(m_PosX, m_PosZ, a_RelX, a_RelY, a_RelZ, a_BlockType, a_BlockMeta);
 	}
@@ -1346,13 +1436,9 @@ void cChunk::FastSetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockT
 	m_BlockData.SetMeta({ a_RelX, a_RelY, a_RelZ }, a_BlockMeta);
 
 	// ONLY recalculate lighting if it's necessary!
-	if (
-		(cBlockInfo::GetLightValue        (OldBlockType) != cBlockInfo::GetLightValue        (a_BlockType)) ||
-		(cBlockInfo::GetSpreadLightFalloff(OldBlockType) != cBlockInfo::GetSpreadLightFalloff(a_BlockType)) ||
-		(cBlockInfo::IsTransparent        (OldBlockType) != cBlockInfo::IsTransparent        (a_BlockType))
-	)
+	if (DoesChangeLight(OldBlockType, a_BlockType))
 	{
-		m_IsLightValid = false;
+		QueueLightChange({ a_RelX, a_RelY, a_RelZ });
 	}
 
 	// Update heightmap, if needed:
@@ -1380,6 +1466,73 @@ void cChunk::FastSetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockT
 
 
 
+void cChunk::QueueLightChange(const Vector3i a_RelPos)
+{
+	if (!m_IsLightValid)
+	{
+		// The whole chunk will be relit anyway
+		return;
+	}
+
+	// Too many changes at once (e.g. a large area fill) are cheaper to relight as a whole:
+	if (m_PendingLightChanges.size() >= cIncrementalLighting::MaxChanges)
+	{
+		m_PendingLightChanges.clear();
+		m_IsLightValid = false;
+		return;
+	}
+	m_PendingLightChanges.push_back(a_RelPos);
+}
+
+
+
+
+
+bool cChunk::IsReplacingLiquids(const BLOCKTYPE a_OldBlockType, const BLOCKTYPE a_NewBlockType)
+{
+	return (
+		((a_OldBlockType == E_BLOCK_STATIONARY_WATER) && (a_NewBlockType == E_BLOCK_WATER)) ||             // Replacing stationary water with water
+		((a_OldBlockType == E_BLOCK_WATER)            && (a_NewBlockType == E_BLOCK_STATIONARY_WATER)) ||  // Replacing water with stationary water
+		((a_OldBlockType == E_BLOCK_STATIONARY_LAVA)  && (a_NewBlockType == E_BLOCK_LAVA)) ||              // Replacing stationary lava with lava
+		((a_OldBlockType == E_BLOCK_LAVA)             && (a_NewBlockType == E_BLOCK_STATIONARY_LAVA))      // Replacing lava with stationary lava
+	);
+}
+
+
+
+
+
+bool cChunk::ShouldSendBlockChange(const BLOCKTYPE a_OldBlockType, const NIBBLETYPE a_OldBlockMeta, const BLOCKTYPE a_NewBlockType, const NIBBLETYPE a_NewBlockMeta, const bool a_ReplacingLiquids)
+{
+	// Send only if ...
+	return (
+		!(                                // ... the old and new blocktypes AREN'T leaves (because the client doesn't need meta updates)
+			((a_OldBlockType == E_BLOCK_LEAVES) && (a_NewBlockType == E_BLOCK_LEAVES)) ||
+			((a_OldBlockType == E_BLOCK_NEW_LEAVES) && (a_NewBlockType == E_BLOCK_NEW_LEAVES))
+		) &&                              // ... AND ...
+		(
+			(a_OldBlockMeta != a_NewBlockMeta) || (!a_ReplacingLiquids)
+		)
+	);
+}
+
+
+
+
+
+bool cChunk::DoesChangeLight(const BLOCKTYPE a_OldBlockType, const BLOCKTYPE a_NewBlockType)
+{
+	return (
+		(cBlockInfo::GetLightValue        (a_OldBlockType) != cBlockInfo::GetLightValue        (a_NewBlockType)) ||
+		(cBlockInfo::GetSpreadLightFalloff(a_OldBlockType) != cBlockInfo::GetSpreadLightFalloff(a_NewBlockType)) ||
+		(cBlockInfo::IsTransparent        (a_OldBlockType) != cBlockInfo::IsTransparent        (a_NewBlockType))
+	);
+}
+
+
+
+
+
 void cChunk::SendBlockTo(int a_RelX, int a_RelY, int a_RelZ, cClientHandle * a_Client)
 {
 	const auto BlockEntity = GetBlockEntityRel({ a_RelX, a_RelY, a_RelZ });
@@ -1827,65 +1980,18 @@ cChunk * cChunk::GetNeighborChunk(int a_BlockX, int a_BlockZ)
 
 cChunk * cChunk::GetRelNeighborChunk(int a_RelX, int a_RelZ)
 {
-	// If the relative coords are too far away, use the parent's chunk lookup instead:
-	if ((a_RelX < -128) || (a_RelX > 128) || (a_RelZ < -128) || (a_RelZ > 128))
-	{
-		int BlockX = m_PosX * cChunkDef::Width + a_RelX;
-		int BlockZ = m_PosZ * cChunkDef::Width + a_RelZ;
-		int ChunkX, ChunkZ;
-		cChunkDef::BlockToChunk(BlockX, BlockZ, ChunkX, ChunkZ);
-		return m_ChunkMap->FindChunk(ChunkX, ChunkZ);
-	}
-
-	// Walk the neighbors:
-	bool ReturnThis = true;
-	if (a_RelX < 0)
-	{
-		if (m_NeighborXM != nullptr)
-		{
-			cChunk * Candidate = m_NeighborXM->GetRelNeighborChunk(a_RelX + cChunkDef::Width, a_RelZ);
-			if (Candidate != nullptr)
-			{
-				return Candidate;
-			}
-		}
-		// Going X first failed, but if the request is crossing Z as well, let's try the Z first later on.
-		ReturnThis = false;
-	}
-	else if (a_RelX >= cChunkDef::Width)
-	{
-		if (m_NeighborXP != nullptr)
-		{
-			cChunk * Candidate = m_NeighborXP->GetRelNeighborChunk(a_RelX - cChunkDef::Width, a_RelZ);
-			if (Candidate != nullptr)
-			{
-				return Candidate;
-			}
-		}
-		// Going X first failed, but if the request is crossing Z as well, let's try the Z first later on.
-		ReturnThis = false;
-	}
+	const int OffsetX = FAST_FLOOR_DIV(a_RelX, cChunkDef::Width);
+	const int OffsetZ = FAST_FLOOR_DIV(a_RelZ, cChunkDef::Width);
 
-	if (a_RelZ < 0)
-	{
-		if (m_NeighborZM != nullptr)
-		{
-			return m_NeighborZM->GetRelNeighborChunk(a_RelX, a_RelZ + cChunkDef::Width);
-			// For requests crossing both X and Z, the X-first way has been already tried
-		}
-		return nullptr;
-	}
-	else if (a_RelZ >= cChunkDef::Width)
+	// The common case, a block in this chunk or one of the directly surrounding ones:
+	if ((std::abs(OffsetX) <= 1) && (std::abs(OffsetZ) <= 1))
 	{
-		if (m_NeighborZP != nullptr)
-		{
-			return m_NeighborZP->GetRelNeighborChunk(a_RelX, a_RelZ - cChunkDef::Width);
-			// For requests crossing both X and Z, the X-first way has been already tried
-		}
-		return nullptr;
+		return m_Neighbors[OffsetX + 1][OffsetZ + 1];
 	}
 
-	return (ReturnThis ? this : nullptr);
+	// Further away, use the parent's chunk lookup instead:
+	m_ChunkMap->AccessFarChunks();
+	return m_ChunkMap->FindChunk(m_PosX + OffsetX, m_PosZ + OffsetZ);
 }
 
 
@@ -1908,25 +2014,26 @@ cChunk * cChunk::GetRelNeighborChunkAdjustCoords(Vector3i & a_RelPos) const
 	// Request for a different chunk, calculate chunk offset:
 	int RelX = a_RelPos.x;  // Make a local copy of the coords (faster access)
 	int RelZ = a_RelPos.z;
-	while ((RelX >= cChunkDef::Width) && (ToReturn != nullptr))
-	{
-		RelX -= cChunkDef::Width;
-		ToReturn = ToReturn->m_NeighborXP;
-	}
-	while ((RelX < 0) && (ToReturn != nullptr))
-	{
-		RelX += cChunkDef::Width;
-		ToReturn = ToReturn->m_NeighborXM;
-	}
-	while ((RelZ >= cChunkDef::Width) && (ToReturn != nullptr))
+	if (
+		(RelX < -cChunkDef::Width) || (RelX >= 2 * cChunkDef::Width) ||
+		(RelZ < -cChunkDef::Width) || (RelZ >= 2 * cChunkDef::Width)
+	)
 	{
-		RelZ -= cChunkDef::Width;
-		ToReturn = ToReturn->m_NeighborZP;
+		// Walking beyond the direct neighbours:
+		m_ChunkMap->AccessFarChunks();
 	}
-	while ((RelZ < 0) && (ToReturn != nullptr))
+	while (ToReturn != nullptr)
 	{
-		RelZ += cChunkDef::Width;
-		ToReturn = ToReturn->m_NeighborZM;
+		// Step towards the target, diagonally where it crosses both X and Z:
+		const int StepX = (RelX < 0) ? -1 : ((RelX >= cChunkDef::Width) ? 1 : 0);
+		const int StepZ = (RelZ < 0) ? -1 : ((RelZ >= cChunkDef::Width) ? 1 : 0);
+		if ((StepX == 0) && (StepZ == 0))
+		{
+			break;
+		}
+		RelX -= StepX * cChunkDef::Width;
+		RelZ -= StepZ * cChunkDef::Width;
+		ToReturn = ToReturn->m_Neighbors[StepX + 1][StepZ + 1];
 	}
 	if (ToReturn != nullptr)
 	{
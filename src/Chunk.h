@@ -137,6 +137,11 @@ public:
 	void SetBlock(Vector3i a_RelBlockPos, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta);
 	// SetBlock() does a lot of work (heightmap, tickblocks, blockentities) so a BlockIdx version doesn't make sense
 
+	/** Sets all the blocks in the range, with the same effects as SetBlock() for each of them; all of them must lie in this chunk.
+	A block changed more than once is set only once, to its final state. The blocks are written section by section,
+	the heightmap is updated once per column, then the simulators are woken up and the block entities replaced. */
+	void SetBlocks(sSetBlockVector::const_iterator a_Begin, sSetBlockVector::const_iterator a_End);
+
 	void FastSetBlock(int a_RelX, int a_RelY, int a_RelZ, BLOCKTYPE a_BlockType, BLOCKTYPE a_BlockMeta);  // Doesn't force block updates on neighbors, use for simple changes such as grass growing etc.
 	void FastSetBlock(Vector3i a_RelPos, BLOCKTYPE a_BlockType, BLOCKTYPE a_BlockMeta)
 	{
@@ -178,8 +183,9 @@ public:
 	Will return self if appropriate. Returns nullptr if not reachable through neighbors. */
 	cChunk * GetNeighborChunk(int a_BlockX, int a_BlockZ);
 
-	/** Returns the chunk into which the relatively-specified block belongs, by walking the neighbors.
-	Will return self if appropriate. Returns nullptr if not reachable through neighbors. */
+	/** Returns the chunk into which the relatively-specified block belongs.
+	Uses the cached neighbor pointers for the directly surrounding chunks, the chunkmap index for anything further.
+	Will return self if appropriate. Returns nullptr if the chunk is not loaded. */
 	cChunk * GetRelNeighborChunk(int a_RelX, int a_RelZ);
 
 	/** Returns the chunk into which the relatively-specified block belongs.
@@ -480,6 +486,11 @@ private:
 	ePresence m_Presence;
 
 	bool m_IsLightValid;   // True if the blocklight and skylight are calculated
+
+	/** Blocks changed in a way that affects the light, since the light was last valid.
+	The light around them is updated incrementally by the chunkmap after the chunks are ticked. */
+	std::vector<Vector3i> m_PendingLightChanges;
+
 	bool m_IsDirty;        // True if the chunk has changed since it was last saved
 	bool m_IsSaving;       // True if the chunk is being saved
 
@@ -519,10 +530,10 @@ private:
 	Plugins can use this to force a tick in a specific block, using cWorld:SetNextBlockToTick() API. */
 	Vector3i m_BlockToTick;
 
-	cChunk * m_NeighborXM;  // Neighbor at [X - 1, Z]
-	cChunk * m_NeighborXP;  // Neighbor at [X + 1, Z]
-	cChunk * m_NeighborZM;  // Neighbor at [X,     Z - 1]
-	cChunk * m_NeighborZP;  // Neighbor at [X,     Z + 1]
+	/** The eight surrounding chunks, indexed by [OffsetX + 1][OffsetZ + 1]; nullptr where the neighbor isn't loaded.
+	The center entry points to this chunk, so that any offset in the range [-1, 1] can be looked up directly.
+	Maintained by the constructor and destructor of each chunk. */
+	cChunk * m_Neighbors[3][3];
 
 	// Per-chunk simulator data:
 	cFireSimulatorChunkData m_FireSimulatorData;
@@ -543,6 +554,22 @@ private:
 	/** Takes ownership of a block entity, which MUST actually reside in this chunk. */
 	void AddBlockEntity(OwnedBlockEntity a_BlockEntity);
 
+	/** Destroys the block entity at the specified position, if any, and creates a new one if the new block type needs it. */
+	void ReplaceBlockEntity(Vector3i a_RelPos, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta);
+
+	/** Queues a block changed in a way that affects the light, for the incremental light update.
+	If the light is to be recalculated for the whole chunk instead, does nothing. */
+	void QueueLightChange(Vector3i a_RelPos);
+
+	/** Returns true if the block change only switches a liquid between its flowing and stationary variant, which doesn't need saving. */
+	static bool IsReplacingLiquids(BLOCKTYPE a_OldBlockType, BLOCKTYPE a_NewBlockType);
+
+	/** Returns true if the block change needs sending to the clients. */
+	static bool ShouldSendBlockChange(BLOCKTYPE a_OldBlockType, NIBBLETYPE a_OldBlockMeta, BLOCKTYPE a_NewBlockType, NIBBLETYPE a_NewBlockMeta, bool a_ReplacingLiquids);
+
+	/** Returns true if the block change affects the light, so that it needs to be queued for the light update. */
+	static bool DoesChangeLight(BLOCKTYPE a_OldBlockType, BLOCKTYPE a_NewBlockType);
+
 	/** Wakes up each simulator for its specific blocks; through all the blocks in the chunk */
 	void WakeUpSimulators(void);
 
@@ -30,20 +30,67 @@ namespace
 		};
 	}
 
-	bool IsCompressed(const size_t ElementCount)
+	constexpr bool IsCompressed(const size_t ElementCount)
 	{
 		return ElementCount != ChunkBlockData::SectionBlockCount;
 	}
 
+	/** Returns the element value of a section filled with the specified flat array value. */
 	template <size_t ElementCount, typename ValueType>
-	ValueType UnpackDefaultValue(const ValueType DefaultValue)
+	ValueType UnpackFillValue(const ValueType a_Fill)
 	{
 		if (IsCompressed(ElementCount))
 		{
-			return DefaultValue & 0xF;
+			return a_Fill & 0xF;
 		}
 
-		return DefaultValue;
+		return a_Fill;
+	}
+
+	/** Returns true if all the elements in the flat array hold the same value.
+	For nibble arrays both nibbles of each byte need to be equal, too. */
+	template <size_t ElementCount, typename ValueType>
+	bool IsUniformArray(const ValueType * a_Source, const size_t a_Size)
+	{
+		const auto First = a_Source[0];
+		if (IsCompressed(ElementCount) && ((First >> 4) != (First & 0x0F)))
+		{
+			return false;
+		}
+
+		return std::all_of(a_Source + 1, a_Source + a_Size, [First](const ValueType a_Value) { return a_Value == First; });
+	}
+
+	/** One free list of ChunkSectionPool, holding allocations of a single size. */
+	struct PoolSizeClass
+	{
+		std::mutex Mutex;
+
+		/** Singly linked list of freed allocations, the link is stored in the first bytes of each. */
+		void * FreeList = nullptr;
+
+		size_t NumPooled = 0;
+		size_t NumLive = 0;
+	};
+
+	/** Size classes in steps of ChunkSectionPool::PoolGranularity, up to ChunkSectionPool::MaxPooledSize. */
+	constexpr size_t NumPoolSizeClasses = ChunkSectionPool::MaxPooledSize / ChunkSectionPool::PoolGranularity;
+
+	PoolSizeClass g_PoolSizeClasses[NumPoolSizeClasses];
+	std::atomic<size_t> g_PoolRetention{ 64 * 1024 * 1024 };
+	std::atomic<size_t> g_PoolPooledBytes{ 0 };
+	std::atomic<UInt64> g_PoolNumAllocations{ 0 };
+	std::atomic<UInt64> g_PoolNumReused{ 0 };
+
+	/** Returns the index of the smallest size class that can hold the specified size. */
+	size_t PoolSizeClassIndex(const size_t a_Size)
+	{
+		return (a_Size == 0) ? 0 : ((a_Size - 1) / ChunkSectionPool::PoolGranularity);
+	}
+
+	size_t PoolClassSize(const size_t a_Index)
+	{
+		return (a_Index + 1) * ChunkSectionPool::PoolGranularity;
 	}
 }  // namespace (anonymous)
 
@@ -51,18 +98,394 @@ namespace
 
 
 
-template<class ElementType, size_t ElementCount, ElementType DefaultValue>
-void ChunkDataStore<ElementType, ElementCount, DefaultValue>::Assign(const ChunkDataStore<ElementType, ElementCount, DefaultValue> & a_Other)
+////////////////////////////////////////////////////////////////////////////////
+// ChunkSectionPool:
+
+void * ChunkSectionPool::Allocate(const size_t a_Size)
 {
-	for (size_t Y = 0; Y != cChunkDef::NumSections; Y++)
+	if (a_Size > MaxPooledSize)
+	{
+		return ::operator new(a_Size);
+	}
+
+	g_PoolNumAllocations.fetch_add(1, std::memory_order_relaxed);
+	const auto Index = PoolSizeClassIndex(a_Size);
+	auto & Class = g_PoolSizeClasses[Index];
+	{
+		std::lock_guard<std::mutex> Lock(Class.Mutex);
+		Class.NumLive++;
+		if (Class.FreeList != nullptr)
+		{
+			auto Ptr = Class.FreeList;
+			Class.FreeList = *static_cast<void **>(Ptr);
+			Class.NumPooled--;
+			g_PoolPooledBytes.fetch_sub(PoolClassSize(Index), std::memory_order_relaxed);
+			g_PoolNumReused.fetch_add(1, std::memory_order_relaxed);
+			return Ptr;
+		}
+	}
+
+	return ::operator new(PoolClassSize(Index));
+}
+
+
+
+
+
+void ChunkSectionPool::Free(void * const a_Ptr, const size_t a_Size)
+{
+	if (a_Ptr == nullptr)
+	{
+		return;
+	}
+
+	if (a_Size > MaxPooledSize)
+	{
+		::operator delete(a_Ptr);
+		return;
+	}
+
+	const auto Index = PoolSizeClassIndex(a_Size);
+	const auto ClassSize = PoolClassSize(Index);
+	auto & Class = g_PoolSizeClasses[Index];
+	{
+		std::lock_guard<std::mutex> Lock(Class.Mutex);
+		ASSERT(Class.NumLive > 0);
+		Class.NumLive--;
+		if (g_PoolPooledBytes.load(std::memory_order_relaxed) + ClassSize <= g_PoolRetention.load(std::memory_order_relaxed))
+		{
+			*static_cast<void **>(a_Ptr) = Class.FreeList;
+			Class.FreeList = a_Ptr;
+			Class.NumPooled++;
+			g_PoolPooledBytes.fetch_add(ClassSize, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	::operator delete(a_Ptr);
+}
+
+
+
+
+
+void ChunkSectionPool::SetRetention(const size_t a_MaxPooledBytes)
+{
+	g_PoolRetention = a_MaxPooledBytes;
+
+	// Release the largest allocations first, until the pool fits the new limit:
+	for (size_t Index = NumPoolSizeClasses; Index-- > 0;)
+	{
+		auto & Class = g_PoolSizeClasses[Index];
+		std::lock_guard<std::mutex> Lock(Class.Mutex);
+		while ((Class.FreeList != nullptr) && (g_PoolPooledBytes.load(std::memory_order_relaxed) > a_MaxPooledBytes))
+		{
+			auto Ptr = Class.FreeList;
+			Class.FreeList = *static_cast<void **>(Ptr);
+			Class.NumPooled--;
+			g_PoolPooledBytes.fetch_sub(PoolClassSize(Index), std::memory_order_relaxed);
+			::operator delete(Ptr);
+		}
+	}
+}
+
+
+
+
+
+ChunkSectionPool::Stats ChunkSectionPool::GetStats(void)
+{
+	Stats Result{};
+	for (size_t Index = 0; Index != NumPoolSizeClasses; Index++)
+	{
+		auto & Class = g_PoolSizeClasses[Index];
+		std::lock_guard<std::mutex> Lock(Class.Mutex);
+		Result.NumLive += Class.NumLive;
+		Result.LiveBytes += Class.NumLive * PoolClassSize(Index);
+		Result.NumPooled += Class.NumPooled;
+		Result.PooledBytes += Class.NumPooled * PoolClassSize(Index);
+	}
+	Result.RetentionBytes = g_PoolRetention;
+	Result.NumAllocations = g_PoolNumAllocations;
+	Result.NumReused = g_PoolNumReused;
+	return Result;
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// PalettedBlockSection:
+
+PalettedBlockSection::PalettedBlockSection(const BLOCKTYPE a_Fill) :
+	m_BitsShift(0),
+	m_PaletteSize(1),
+	m_Palette{ a_Fill },
+	m_Data(AllocateData(0))
+{
+}
+
+
+
+
+
+PalettedBlockSection::PalettedBlockSection(const BLOCKTYPE (& a_Source)[Count]) :
+	m_BitsShift(0),
+	m_PaletteSize(0),
+	m_Palette{}
+{
+	Assign(a_Source);
+}
+
+
+
+
+
+PalettedBlockSection::PalettedBlockSection(const PalettedBlockSection & a_Other) :
+	m_BitsShift(a_Other.m_BitsShift),
+	m_PaletteSize(a_Other.m_PaletteSize),
+	m_Palette(a_Other.m_Palette),
+	m_Data(ChunkSectionPool::AllocateArray<UInt64>(GetWordCount(a_Other.m_BitsShift)))
+{
+	std::copy_n(a_Other.m_Data.get(), GetWordCount(m_BitsShift), m_Data.get());
+}
+
+
+
+
+
+PalettedBlockSection & PalettedBlockSection::operator = (const PalettedBlockSection & a_Other)
+{
+	if (this != &a_Other)
+	{
+		if (m_BitsShift != a_Other.m_BitsShift)
+		{
+			m_Data = ChunkSectionPool::AllocateArray<UInt64>(GetWordCount(a_Other.m_BitsShift));
+		}
+		m_BitsShift = a_Other.m_BitsShift;
+		m_PaletteSize = a_Other.m_PaletteSize;
+		m_Palette = a_Other.m_Palette;
+		std::copy_n(a_Other.m_Data.get(), GetWordCount(m_BitsShift), m_Data.get());
+	}
+	return *this;
+}
+
+
+
+
+
+void PalettedBlockSection::Set(const size_t a_Index, const BLOCKTYPE a_Value)
+{
+	ASSERT(a_Index < Count);
+
+	if (!IsDirect())
 	{
-		Store[Y].reset();
+		const auto PaletteEnd = m_Palette.begin() + m_PaletteSize;
+		const auto Found = std::find(m_Palette.begin(), PaletteEnd, a_Value);
+		if (Found != PaletteEnd)
+		{
+			const auto Entry = static_cast<unsigned>(Found - m_Palette.begin());
+			StoreEntry(m_Data.get(), m_BitsShift, a_Index, Entry);
+			return;
+		}
 
-		if (const auto & Other = a_Other.Store[Y]; Other != nullptr)
+		// The palette is not shrunk when a block type disappears from the section, Assign() re-packs:
+		if (m_PaletteSize == (1U << GetBitsPerEntry()))
 		{
-			Store[Y] = std::make_unique<Type>(*Other);
+			Widen();
 		}
 	}
+
+	if (IsDirect())
+	{
+		StoreEntry(m_Data.get(), m_BitsShift, a_Index, a_Value);
+		return;
+	}
+
+	m_Palette[m_PaletteSize] = a_Value;
+	StoreEntry(m_Data.get(), m_BitsShift, a_Index, m_PaletteSize);
+	m_PaletteSize++;
+}
+
+
+
+
+
+void PalettedBlockSection::Assign(const BLOCKTYPE (& a_Source)[Count])
+{
+	// Collect the palette, giving up once there are too many block types for the 4-bit representation:
+	std::array<unsigned char, 256> Lookup;
+	std::array<bool, 256> IsPresent{};
+	std::array<BLOCKTYPE, 16> Palette;
+	size_t PaletteSize = 0;
+	for (const auto Block : a_Source)
+	{
+		if (IsPresent[Block])
+		{
+			continue;
+		}
+		if (PaletteSize == Palette.size())
+		{
+			PaletteSize = Palette.size() + 1;
+			break;
+		}
+		IsPresent[Block] = true;
+		Lookup[Block] = static_cast<unsigned char>(PaletteSize);
+		Palette[PaletteSize++] = Block;
+	}
+
+	unsigned char BitsShift;
+	if (PaletteSize <= 2)
+	{
+		BitsShift = 0;
+	}
+	else if (PaletteSize <= 4)
+	{
+		BitsShift = 1;
+	}
+	else if (PaletteSize <= 16)
+	{
+		BitsShift = 2;
+	}
+	else
+	{
+		BitsShift = 3;
+	}
+
+	if ((m_Data == nullptr) || (BitsShift != m_BitsShift))
+	{
+		m_Data = AllocateData(BitsShift);
+	}
+	else
+	{
+		std::fill_n(m_Data.get(), GetWordCount(BitsShift), 0);
+	}
+	m_BitsShift = BitsShift;
+
+	if (IsDirect())
+	{
+		m_PaletteSize = 0;
+		for (size_t i = 0; i != Count; i++)
+		{
+			StoreEntry(m_Data.get(), m_BitsShift, i, a_Source[i]);
+		}
+		return;
+	}
+
+	m_PaletteSize = static_cast<unsigned char>(PaletteSize);
+	m_Palette = Palette;
+	for (size_t i = 0; i != Count; i++)
+	{
+		StoreEntry(m_Data.get(), m_BitsShift, i, Lookup[a_Source[i]]);
+	}
+}
+
+
+
+
+
+void PalettedBlockSection::CopyTo(BLOCKTYPE (& a_Destination)[Count]) const
+{
+	for (size_t i = 0; i != Count; i++)
+	{
+		a_Destination[i] = (*this)[i];
+	}
+}
+
+
+
+
+
+bool PalettedBlockSection::IsUniform(void) const
+{
+	if (!IsDirect() && (m_PaletteSize == 1))
+	{
+		return true;
+	}
+
+	// The section is uniform exactly when every word holds the first entry repeated:
+	const auto EntryMask = (UInt64(1) << GetBitsPerEntry()) - 1;
+	const auto Pattern = (~UInt64(0) / EntryMask) * (m_Data[0] & EntryMask);
+	const auto End = m_Data.get() + GetWordCount(m_BitsShift);
+	return std::all_of(m_Data.get(), End, [Pattern](const UInt64 a_Word) { return a_Word == Pattern; });
+}
+
+
+
+
+
+ChunkSectionPool::ArrayPtr<UInt64> PalettedBlockSection::AllocateData(const unsigned a_BitsShift)
+{
+	const auto WordCount = GetWordCount(a_BitsShift);
+	auto Data = ChunkSectionPool::AllocateArray<UInt64>(WordCount);
+	std::fill_n(Data.get(), WordCount, 0);
+	return Data;
+}
+
+
+
+
+
+void PalettedBlockSection::StoreEntry(UInt64 * const a_Data, const unsigned a_BitsShift, const size_t a_Index, const unsigned a_Entry)
+{
+	ASSERT(a_Index < Count);
+	ASSERT(a_Entry < (1U << (1U << a_BitsShift)));
+
+	auto & Word = a_Data[a_Index >> (6 - a_BitsShift)];
+	const auto Shift = (a_Index & ((64U >> a_BitsShift) - 1)) << a_BitsShift;
+	const auto Mask = (UInt64(1) << (1U << a_BitsShift)) - 1;
+	Word = (Word & ~(Mask << Shift)) | (static_cast<UInt64>(a_Entry) << Shift);
+}
+
+
+
+
+
+void PalettedBlockSection::Widen(void)
+{
+	ASSERT(!IsDirect());
+
+	const unsigned char NewBitsShift = m_BitsShift + 1;
+	const bool ToDirect = (NewBitsShift == 3);
+	auto NewData = AllocateData(NewBitsShift);
+
+	for (size_t i = 0; i != Count; i++)
+	{
+		const auto Entry = GetEntry(i);
+		StoreEntry(NewData.get(), NewBitsShift, i, ToDirect ? m_Palette[Entry] : Entry);
+	}
+
+	m_Data = std::move(NewData);
+	m_BitsShift = NewBitsShift;
+	if (ToDirect)
+	{
+		m_PaletteSize = 0;
+	}
+}
+
+
+
+
+
+template<class ElementType, size_t ElementCount, ElementType DefaultValue>
+ChunkDataStore<ElementType, ElementCount, DefaultValue>::ChunkDataStore(void)
+{
+	std::fill(std::begin(Fill), std::end(Fill), DefaultValue);
+}
+
+
+
+
+
+template<class ElementType, size_t ElementCount, ElementType DefaultValue>
+void ChunkDataStore<ElementType, ElementCount, DefaultValue>::Assign(const ChunkDataStore<ElementType, ElementCount, DefaultValue> & a_Other)
+{
+	for (size_t Y = 0; Y != cChunkDef::NumSections; Y++)
+	{
+		Store[Y] = a_Other.Store[Y];
+		Fill[Y] = a_Other.Fill[Y];
+	}
 }
 
 
@@ -77,7 +500,7 @@ ElementType ChunkDataStore<ElementType, ElementCount, DefaultValue>::Get(const V
 
 	if (Section != nullptr)
 	{
-		if (IsCompressed(ElementCount))
+		if constexpr (IsCompressed(ElementCount))
 		{
 			return cChunkDef::ExpandNibble(Section->data(), Indices.Index);
 		}
@@ -87,7 +510,7 @@ ElementType ChunkDataStore<ElementType, ElementCount, DefaultValue>::Get(const V
 		}
 	}
 
-	return UnpackDefaultValue<ElementCount>(DefaultValue);
+	return UnpackFillValue<ElementCount>(Fill[Indices.Section]);
 }
 
 
@@ -95,7 +518,7 @@ ElementType ChunkDataStore<ElementType, ElementCount, DefaultValue>::Get(const V
 
 
 template<class ElementType, size_t ElementCount, ElementType DefaultValue>
-typename ChunkDataStore<ElementType, ElementCount, DefaultValue>::Type * ChunkDataStore<ElementType, ElementCount, DefaultValue>::GetSection(const size_t a_Y) const
+const typename ChunkDataStore<ElementType, ElementCount, DefaultValue>::Type * ChunkDataStore<ElementType, ElementCount, DefaultValue>::GetSection(const size_t a_Y) const
 {
 	return Store[a_Y].get();
 }
@@ -112,22 +535,35 @@ void ChunkDataStore<ElementType, ElementCount, DefaultValue>::Set(const Vector3i
 
 	if (Section == nullptr)
 	{
-		if (a_Value == UnpackDefaultValue<ElementCount>(DefaultValue))
+		const auto SectionFill = Fill[Indices.Section];
+		if (a_Value == UnpackFillValue<ElementCount>(SectionFill))
 		{
 			return;
 		}
 
-		Section = cpp20::make_unique_for_overwrite<Type>();
-		std::fill(Section->begin(), Section->end(), DefaultValue);
+		// Expand the uniform section:
+		if constexpr (IsCompressed(ElementCount))
+		{
+			Section = SharedSection<Type>::Make();
+			auto & Writable = Section.GetWritable();
+			std::fill(Writable.begin(), Writable.end(), SectionFill);
+		}
+		else
+		{
+			Section = SharedSection<Type>::Make(SectionFill);
+		}
 	}
 
-	if (IsCompressed(ElementCount))
+	// Clones the section if a snapshot still refers to it:
+	auto & Writable = Section.GetWritable();
+
+	if constexpr (IsCompressed(ElementCount))
 	{
-		cChunkDef::PackNibble(Section->data(), Indices.Index, a_Value);
+		cChunkDef::PackNibble(Writable.data(), Indices.Index, a_Value);
 	}
 	else
 	{
-		(*Section)[Indices.Index] = a_Value;
+		Writable.Set(Indices.Index, a_Value);
 	}
 }
 
@@ -141,14 +577,34 @@ void ChunkDataStore<ElementType, ElementCount, DefaultValue>::SetSection(const E
 	auto & Section = Store[a_Y];
 	const auto SourceEnd = std::end(a_Source);
 
-	if (Section != nullptr)
+	if (IsUniformArray<ElementCount>(a_Source, ElementCount))
 	{
-		std::copy(a_Source, SourceEnd, Section->begin());
+		Section.reset();
+		Fill[a_Y] = a_Source[0];
 	}
-	else if (std::any_of(a_Source, SourceEnd, [](const auto Value) { return Value != DefaultValue; }))
+	else if ((Section != nullptr) && !Section.IsShared())
 	{
-		Section = cpp20::make_unique_for_overwrite<Type>();
-		std::copy(a_Source, SourceEnd, Section->begin());
+		if constexpr (IsCompressed(ElementCount))
+		{
+			std::copy(a_Source, SourceEnd, Section.GetWritable().begin());
+		}
+		else
+		{
+			Section.GetWritable().Assign(a_Source);
+		}
+	}
+	else
+	{
+		// Either there's no section yet, or it is shared with a snapshot and gets replaced rather than cloned and overwritten:
+		if constexpr (IsCompressed(ElementCount))
+		{
+			Section = SharedSection<Type>::Make();
+			std::copy(a_Source, SourceEnd, Section.GetWritable().begin());
+		}
+		else
+		{
+			Section = SharedSection<Type>::Make(a_Source);
+		}
 	}
 }
 
@@ -169,10 +625,169 @@ void ChunkDataStore<ElementType, ElementCount, DefaultValue>::SetAll(const Eleme
 
 
 
+template<class ElementType, size_t ElementCount, ElementType DefaultValue>
+void ChunkDataStore<ElementType, ElementCount, DefaultValue>::Compact(void)
+{
+	for (size_t Y = 0; Y != cChunkDef::NumSections; Y++)
+	{
+		const auto & Section = Store[Y];
+		if (Section == nullptr)
+		{
+			continue;
+		}
+
+		if constexpr (IsCompressed(ElementCount))
+		{
+			if (IsUniformArray<ElementCount>(Section->data(), Section->size()))
+			{
+				Fill[Y] = (*Section)[0];
+				Store[Y].reset();
+			}
+		}
+		else
+		{
+			if (Section->IsUniform())
+			{
+				Fill[Y] = (*Section)[0];
+				Store[Y].reset();
+			}
+		}
+	}
+}
+
+
+
+
+
+ChunkSectionVersions::ChunkSectionVersions(void) :
+	m_IsShared(false),
+	m_Changes()
+{
+	Reidentify();
+}
+
+
+
+
+
+ChunkSectionVersions::ChunkSectionVersions(const ChunkSectionVersions & a_Other) noexcept
+{
+	Assign(a_Other);
+}
+
+
+
+
+
+ChunkSectionVersions & ChunkSectionVersions::operator = (const ChunkSectionVersions & a_Other) noexcept
+{
+	Assign(a_Other);
+	return *this;
+}
+
+
+
+
+
+ChunkSectionVersions::ChunkSectionVersions(ChunkSectionVersions && a_Other) noexcept
+{
+	MoveFrom(a_Other);
+}
+
+
+
+
+
+ChunkSectionVersions & ChunkSectionVersions::operator = (ChunkSectionVersions && a_Other) noexcept
+{
+	if (this != &a_Other)
+	{
+		MoveFrom(a_Other);
+	}
+	return *this;
+}
+
+
+
+
+
+void ChunkSectionVersions::Assign(const ChunkSectionVersions & a_Other) noexcept
+{
+	m_Identity = a_Other.m_Identity;
+	m_IsShared = true;
+	std::copy(std::begin(a_Other.m_Changes), std::end(a_Other.m_Changes), std::begin(m_Changes));
+}
+
+
+
+
+
+void ChunkSectionVersions::Reidentify(void) noexcept
+{
+	static std::atomic<UInt64> NextIdentity(1);
+	m_Identity = NextIdentity.fetch_add(1, std::memory_order_relaxed);
+	m_IsShared = false;
+}
+
+
+
+
+
+void ChunkSectionVersions::MoveFrom(ChunkSectionVersions & a_Other) noexcept
+{
+	m_Identity = a_Other.m_Identity;
+	m_IsShared = a_Other.m_IsShared;
+	std::copy(std::begin(a_Other.m_Changes), std::end(a_Other.m_Changes), std::begin(m_Changes));
+
+	// The source may still be modified and then reused, it mustn't produce the versions that this object now produces:
+	a_Other.Reidentify();
+}
+
+
+
+
+
 void ChunkBlockData::Assign(const ChunkBlockData & a_Other)
 {
 	m_Blocks.Assign(a_Other.m_Blocks);
 	m_Metas.Assign(a_Other.m_Metas);
+	m_Versions.Assign(a_Other.m_Versions);
+}
+
+
+
+
+
+void ChunkBlockData::SetBlock(const Vector3i a_Position, const BLOCKTYPE a_Block)
+{
+	m_Blocks.Set(a_Position, a_Block);
+	m_Versions.MarkChanged(static_cast<size_t>(a_Position.y / cChunkDef::SectionHeight));
+}
+
+
+
+
+
+void ChunkBlockData::SetMeta(const Vector3i a_Position, const NIBBLETYPE a_Meta)
+{
+	m_Metas.Set(a_Position, a_Meta);
+	m_Versions.MarkChanged(static_cast<size_t>(a_Position.y / cChunkDef::SectionHeight));
+}
+
+
+
+
+
+void ChunkBlockData::SetSectionBlocks(const sSetBlockVector::const_iterator a_Begin, const sSetBlockVector::const_iterator a_End, const size_t a_Y)
+{
+	for (auto itr = a_Begin; itr != a_End; ++itr)
+	{
+		const auto Position = itr->GetRelativePos();
+		ASSERT(static_cast<size_t>(Position.y / cChunkDef::SectionHeight) == a_Y);
+		m_Blocks.Set(Position, itr->m_BlockType);
+		m_Metas.Set(Position, itr->m_BlockMeta);
+	}
+	m_Versions.MarkChanged(a_Y);
 }
 
 
@@ -183,6 +798,10 @@ void ChunkBlockData::SetAll(const cChunkDef::BlockTypes & a_BlockSource, const c
 {
 	m_Blocks.SetAll(a_BlockSource);
 	m_Metas.SetAll(a_MetaSource);
+	for (size_t Y = 0; Y < cChunkDef::NumSections; ++Y)
+	{
+		m_Versions.MarkChanged(Y);
+	}
 }
 
 
@@ -193,6 +812,17 @@ void ChunkBlockData::SetSection(const SectionType & a_BlockSource, const Section
 {
 	m_Blocks.SetSection(a_BlockSource, a_Y);
 	m_Metas.SetSection(a_MetaSource, a_Y);
+	m_Versions.MarkChanged(a_Y);
+}
+
+
+
+
+
+void ChunkBlockData::Compact(void)
+{
+	m_Blocks.Compact();
+	m_Metas.Compact();
 }
 
 
@@ -203,6 +833,27 @@ void ChunkLightData::Assign(const ChunkLightData & a_Other)
 {
 	m_BlockLights.Assign(a_Other.m_BlockLights);
 	m_SkyLights.Assign(a_Other.m_SkyLights);
+	m_Versions.Assign(a_Other.m_Versions);
+}
+
+
+
+
+
+void ChunkLightData::SetBlockLight(const Vector3i a_Position, const NIBBLETYPE a_Value)
+{
+	m_BlockLights.Set(a_Position, a_Value);
+	m_Versions.MarkChanged(static_cast<size_t>(a_Position.y / cChunkDef::SectionHeight));
+}
+
+
+
+
+
+void ChunkLightData::SetSkyLight(const Vector3i a_Position, const NIBBLETYPE a_Value)
+{
+	m_SkyLights.Set(a_Position, a_Value);
+	m_Versions.MarkChanged(static_cast<size_t>(a_Position.y / cChunkDef::SectionHeight));
 }
 
 
@@ -213,6 +864,10 @@ void ChunkLightData::SetAll(const cChunkDef::BlockNibbles & a_BlockLightSource,
 {
 	m_BlockLights.SetAll(a_BlockLightSource);
 	m_SkyLights.SetAll(a_SkyLightSource);
+	for (size_t Y = 0; Y < cChunkDef::NumSections; ++Y)
+	{
+		m_Versions.MarkChanged(Y);
+	}
 }
 
 
@@ -223,6 +878,17 @@ void ChunkLightData::SetSection(const SectionType & a_BlockLightSource, const Se
 {
 	m_BlockLights.SetSection(a_BlockLightSource, a_Y);
 	m_SkyLights.SetSection(a_SkyLightSource, a_Y);
+	m_Versions.MarkChanged(a_Y);
+}
+
+
+
+
+
+void ChunkLightData::Compact(void)
+{
+	m_BlockLights.Compact();
+	m_SkyLights.Compact();
 }
 
 
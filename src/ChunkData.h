@@ -16,36 +16,405 @@
 
 
 
+/** Recycles the memory used by chunk sections, so that the constant loading and unloading of chunks doesn't fragment the heap.
+Allocations are rounded up to a multiple of PoolGranularity bytes, freed blocks are kept on a per-size free list until the retention limit is reached.
+The pool is process-wide and thread-safe, sections freely move between the worlds' threads, the lighting thread and the generator. */
+class ChunkSectionPool
+{
+public:
+
+	/** The largest allocation size that is pooled; larger requests go straight to the heap. */
+	static constexpr size_t MaxPooledSize = 4096;
+
+	/** The pooled allocation sizes are multiples of this, with one free list per multiple (64, 128, 192 ... 4096 bytes). */
+	static constexpr size_t PoolGranularity = 64;
+
+	struct Stats
+	{
+		/** Number of allocations currently in use, and the bytes they occupy. */
+		size_t NumLive;
+		size_t LiveBytes;
+
+		/** Number of freed allocations kept for reuse, and the bytes they occupy. */
+		size_t NumPooled;
+		size_t PooledBytes;
+
+		/** The maximum number of bytes kept for reuse. */
+		size_t RetentionBytes;
+
+		/** Total number of allocations since startup, and how many of those were satisfied from the pool. */
+		UInt64 NumAllocations;
+		UInt64 NumReused;
+	};
+
+	/** Frees a pooled array, remembering its size. */
+	struct Deleter
+	{
+		size_t m_Size = 0;
+
+		void operator () (void * a_Ptr) const { Free(a_Ptr, m_Size); }
+	};
+
+	template <typename T>
+	using ArrayPtr = std::unique_ptr<T[], Deleter>;
+
+	/** Returns uninitialised memory of at least the specified size. */
+	static void * Allocate(size_t a_Size);
+
+	/** Returns memory obtained by Allocate() of the same size back to the pool. */
+	static void Free(void * a_Ptr, size_t a_Size);
+
+	/** Allocates an uninitialised array of trivial elements from the pool. */
+	template <typename T>
+	static ArrayPtr<T> AllocateArray(size_t a_Count)
+	{
+		static_assert(std::is_trivial_v<T>, "Only trivial types can be stored in pooled arrays");
+		const auto Size = a_Count * sizeof(T);
+		return ArrayPtr<T>(static_cast<T *>(Allocate(Size)), Deleter{ Size });
+	}
+
+	/** Sets the maximum number of bytes kept for reuse, releasing anything over the new limit back to the heap. */
+	static void SetRetention(size_t a_MaxPooledBytes);
+
+	static Stats GetStats(void);
+};
+
+
+
+
+
+/** Owning pointer to a reference counted chunk section, whose memory comes from ChunkSectionPool.
+Copying the pointer shares the section, so that snapshots of a chunk only bump the reference counts.
+A shared section is never modified, GetWritable() clones it first (copy-on-write). */
+template <class SectionType>
+class SharedSection
+{
+	struct Holder
+	{
+		/** Default-initialises the section; plain arrays are left uninitialised. */
+		Holder(void) :
+			RefCount(1)
+		{
+		}
+
+		template <typename... Args>
+		explicit Holder(Args &&... a_Args) :
+			RefCount(1),
+			Section(std::forward<Args>(a_Args)...)
+		{
+		}
+
+		static void * operator new(size_t a_Size) { return ChunkSectionPool::Allocate(a_Size); }
+		static void operator delete(void * a_Ptr, size_t a_Size) { ChunkSectionPool::Free(a_Ptr, a_Size); }
+
+		std::atomic<unsigned> RefCount;
+		SectionType Section;
+	};
+
+public:
+
+	SharedSection(void) = default;
+
+	SharedSection(const SharedSection & a_Other) :
+		m_Holder(a_Other.m_Holder)
+	{
+		if (m_Holder != nullptr)
+		{
+			m_Holder->RefCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	SharedSection(SharedSection && a_Other) noexcept :
+		m_Holder(std::exchange(a_Other.m_Holder, nullptr))
+	{
+	}
+
+	SharedSection & operator = (SharedSection a_Other) noexcept
+	{
+		std::swap(m_Holder, a_Other.m_Holder);
+		return *this;
+	}
+
+	~SharedSection()
+	{
+		reset();
+	}
+
+	/** Creates a new unshared section, passing the arguments to its constructor. */
+	template <typename... Args>
+	static SharedSection Make(Args &&... a_Args)
+	{
+		SharedSection Result;
+		Result.m_Holder = new Holder(std::forward<Args>(a_Args)...);
+		return Result;
+	}
+
+	/** Releases this reference, freeing the section if it was the last one. */
+	void reset(void)
+	{
+		// The release pairs with the acquire in IsShared(), so that all reads through other references finish before a write:
+		if ((m_Holder != nullptr) && (m_Holder->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1))
+		{
+			delete m_Holder;
+		}
+		m_Holder = nullptr;
+	}
+
+	const SectionType * get(void) const { return (m_Holder == nullptr) ? nullptr : &m_Holder->Section; }
+	const SectionType * operator -> (void) const { return get(); }
+	const SectionType & operator * (void) const { return m_Holder->Section; }
+
+	bool operator == (std::nullptr_t) const { return m_Holder == nullptr; }
+	bool operator != (std::nullptr_t) const { return m_Holder != nullptr; }
+
+	/** Returns true if the section is referenced from elsewhere, such as a snapshot held by another thread. */
+	bool IsShared(void) const
+	{
+		return (m_Holder != nullptr) && (m_Holder->RefCount.load(std::memory_order_acquire) > 1);
+	}
+
+	/** Returns the section for modification, first replacing it with a private clone if it is shared. */
+	SectionType & GetWritable(void)
+	{
+		ASSERT(m_Holder != nullptr);
+		if (IsShared())
+		{
+			*this = Make(m_Holder->Section);
+		}
+		return m_Holder->Section;
+	}
+
+private:
+
+	Holder * m_Holder = nullptr;
+};
+
+
+
+
+
+/** Stores the block types of a single chunk section as indices into a palette of the block types present in the section.
+Uses 1, 2 or 4 bits per block while the palette has up to 2, 4 or 16 entries.
+Once a block type that doesn't fit the palette is set, the section widens itself; at 8 bits per block the block types are stored directly. */
+class PalettedBlockSection
+{
+public:
+
+	static constexpr size_t Count = cChunkDef::SectionHeight * cChunkDef::Width * cChunkDef::Width;
+
+	/** Creates a section filled with a single block type. */
+	explicit PalettedBlockSection(BLOCKTYPE a_Fill);
+
+	/** Creates a section holding a copy of the specified block types, using the narrowest representation that fits them. */
+	explicit PalettedBlockSection(const BLOCKTYPE (& a_Source)[Count]);
+
+	PalettedBlockSection(const PalettedBlockSection & a_Other);
+	PalettedBlockSection & operator = (const PalettedBlockSection & a_Other);
+
+	/** Returns the block type at the specified index within the section. */
+	BLOCKTYPE operator [] (size_t a_Index) const
+	{
+		const auto Entry = GetEntry(a_Index);
+		return IsDirect() ? static_cast<BLOCKTYPE>(Entry) : m_Palette[Entry];
+	}
+
+	/** Sets the block type at the specified index, widening the section if the block type doesn't fit the palette. */
+	void Set(size_t a_Index, BLOCKTYPE a_Value);
+
+	/** Replaces the whole contents of the section with the specified block types, re-packing into the narrowest representation. */
+	void Assign(const BLOCKTYPE (& a_Source)[Count]);
+
+	/** Expands the section into a flat array of block types. */
+	void CopyTo(BLOCKTYPE (& a_Destination)[Count]) const;
+
+	/** Returns true if all the blocks in the section are of the same type. */
+	bool IsUniform(void) const;
+
+	/** Returns the number of bits used for storing each block, 1, 2, 4 or 8. */
+	unsigned GetBitsPerEntry(void) const { return 1U << m_BitsShift; }
+
+	/** Returns the number of bytes allocated for the packed block indices. */
+	size_t GetDataSize(void) const { return GetWordCount(m_BitsShift) * sizeof(UInt64); }
+
+	static constexpr size_t size(void) { return Count; }
+
+private:
+
+	/** Base-2 logarithm of the number of bits per entry. */
+	unsigned char m_BitsShift;
+
+	/** Number of used entries in m_Palette. Not used in the direct (8-bit) mode. */
+	unsigned char m_PaletteSize;
+
+	/** Maps the packed indices to block types. */
+	std::array<BLOCKTYPE, 16> m_Palette;
+
+	/** The packed indices, each 64-bit word holds (64 >> m_BitsShift) entries. */
+	ChunkSectionPool::ArrayPtr<UInt64> m_Data;
+
+
+	static constexpr size_t GetWordCount(unsigned a_BitsShift) { return (Count << a_BitsShift) / 64; }
+
+	/** Allocates zeroed storage for the packed indices at the specified number of bits per entry. */
+	static ChunkSectionPool::ArrayPtr<UInt64> AllocateData(unsigned a_BitsShift);
+
+	/** Returns true if the entries are block types themselves, rather than indices into m_Palette. */
+	bool IsDirect(void) const { return m_BitsShift == 3; }
+
+	/** Returns the packed entry at the specified index. */
+	unsigned GetEntry(size_t a_Index) const
+	{
+		ASSERT(a_Index < Count);
+		const auto Bits = 1U << m_BitsShift;
+		const auto Word = m_Data[a_Index >> (6 - m_BitsShift)];
+		const auto Shift = (a_Index & ((64U >> m_BitsShift) - 1)) << m_BitsShift;
+		return static_cast<unsigned>((Word >> Shift) & ((1U << Bits) - 1));
+	}
+
+	/** Stores the packed entry at the specified index into a packed array using the specified number of bits per entry.
+	Any previous value of the entry is overwritten. */
+	static void StoreEntry(UInt64 * a_Data, unsigned a_BitsShift, size_t a_Index, unsigned a_Entry);
+
+	/** Re-packs the section with one more bit-width step per entry, keeping the contents. */
+	void Widen(void);
+};
+
+
+
+
+
 template <class ElementType, size_t ElementCount, ElementType DefaultValue>
 struct ChunkDataStore
 {
-	using Type = std::array<ElementType, ElementCount>;
-
-	/** Copy assign from another ChunkDataStore. */
+	/** Block type sections are paletted, nibble sections (metas and lights) are plain arrays. */
+	using Type = std::conditional_t<
+		ElementCount == PalettedBlockSection::Count,
+		PalettedBlockSection,
+		std::array<ElementType, ElementCount>
+	>;
+
+	/** Creates a store with all sections uniformly filled with DefaultValue. */
+	ChunkDataStore(void);
+
+	/** Copy assign from another ChunkDataStore.
+	The sections are shared rather than copied, whichever store is modified first clones the affected section. */
 	void Assign(const ChunkDataStore<ElementType, ElementCount, DefaultValue> & a_Other);
 
 	/** Gets one value at the given position.
-	Returns DefaultValue if the section is not allocated. */
+	Returns the section's fill value if the section is not allocated. */
 	ElementType Get(Vector3i a_Position) const;
 
 	/** Returns a raw pointer to the internal representation of the specified section.
-	Will be nullptr if the section is not allocated. */
-	Type * GetSection(size_t a_Y) const;
+	Will be nullptr if the section is uniform, use GetSectionFill() to get its contents then.
+	Block type sections are a PalettedBlockSection, use its operator [] or CopyTo() to read the block types. */
+	const Type * GetSection(size_t a_Y) const;
+
+	/** Returns the value of every element in the flat array representation of a uniform section.
+	For nibble sections this is the packed byte, with both nibbles equal.
+	Only meaningful when GetSection() returns nullptr. */
+	ElementType GetSectionFill(size_t a_Y) const { return Fill[a_Y]; }
+
+	/** Returns true if the section is uniform and filled with DefaultValue, i.e. holds no data worth sending or saving. */
+	bool IsSectionDefault(size_t a_Y) const { return (Store[a_Y] == nullptr) && (Fill[a_Y] == DefaultValue); }
 
 	/** Sets one value at the given position.
-	Allocates a section if needed for the operation. */
+	Expands a uniform section into an allocated one if the value differs from its fill. */
 	void Set(Vector3i a_Position, ElementType a_Value);
 
 	/** Copies the data from the specified flat section array into the internal representation.
-	Allocates a section if needed for the operation. */
+	If all the elements are the same, the section is made uniform instead of being allocated. */
 	void SetSection(const ElementType (& a_Source)[ElementCount], size_t a_Y);
 
 	/** Copies the data from the specified flat array into the internal representation.
 	Allocates sections that are needed for the operation. */
 	void SetAll(const ElementType (& a_Source)[cChunkDef::NumSections * ElementCount]);
 
-	/** Contains all the sections this ChunkDataStore manages. */
-	std::unique_ptr<Type> Store[cChunkDef::NumSections];
+	/** Releases the allocated sections that have become uniform through individual writes, replacing them with their fill value. */
+	void Compact(void);
+
+	/** Contains all the sections this ChunkDataStore manages; a nullptr section is uniform. */
+	SharedSection<Type> Store[cChunkDef::NumSections];
+
+	/** The value of every element of each uniform section, in the packed form for nibble sections. */
+	ElementType Fill[cChunkDef::NumSections];
+};
+
+
+
+
+
+/** Identifies the contents of one section of a ChunkBlockData or ChunkLightData.
+Equal versions guarantee equal contents, so encodings of a section can be cached keyed by its version. */
+struct ChunkSectionVersion
+{
+	/** Process-wide unique identity of the data the section belongs to. */
+	UInt64 Identity;
+
+	/** Number of modifications of the section under this identity. */
+	UInt64 Changes;
+
+	bool operator == (const ChunkSectionVersion & a_Other) const
+	{
+		return (Identity == a_Other.Identity) && (Changes == a_Other.Changes);
+	}
+
+	bool operator != (const ChunkSectionVersion & a_Other) const
+	{
+		return !(*this == a_Other);
+	}
+};
+
+
+
+
+
+/** Tracks the per-section versions of a ChunkBlockData or ChunkLightData.
+A copy made with Assign() takes over the identity and counters of its source, so unchanged sections keep their versions.
+The first modification of such a copy switches it to a fresh identity, so that it can never produce a version that its source also produces. */
+class ChunkSectionVersions
+{
+public:
+
+	/** Creates versions with a fresh identity and all counters zeroed. */
+	ChunkSectionVersions(void);
+
+	/** Copies share the identity the same way as with Assign(). */
+	ChunkSectionVersions(const ChunkSectionVersions & a_Other) noexcept;
+	ChunkSectionVersions & operator = (const ChunkSectionVersions & a_Other) noexcept;
+
+	/** Moving takes over the identity and counters as they are, the source switches to a fresh identity.
+	Must not throw, so that the chunk data containing the versions is moved rather than copied by the containers. */
+	ChunkSectionVersions(ChunkSectionVersions && a_Other) noexcept;
+	ChunkSectionVersions & operator = (ChunkSectionVersions && a_Other) noexcept;
+
+	void Assign(const ChunkSectionVersions & a_Other) noexcept;
+
+	ChunkSectionVersion Get(size_t a_Y) const { return { m_Identity, m_Changes[a_Y] }; }
+
+	/** Bumps the version of the specified section. Not thread-safe, same as the modification it accompanies. */
+	void MarkChanged(size_t a_Y)
+	{
+		if (m_IsShared)
+		{
+			Reidentify();
+		}
+		++m_Changes[a_Y];
+	}
+
+private:
+
+	UInt64 m_Identity;
+
+	/** Set when the identity has been taken over from another object by Assign(). */
+	bool m_IsShared;
+
+	UInt64 m_Changes[cChunkDef::NumSections];
+
+	/** Switches to a fresh identity, keeping the counters. */
+	void Reidentify(void) noexcept;
+
+	/** Takes over the identity, sharing state and counters of a_Other, which switches to a fresh identity. */
+	void MoveFrom(ChunkSectionVersions & a_Other) noexcept;
 };
 
 
@@ -69,6 +438,7 @@ private:
 
 	ChunkDataStore<BLOCKTYPE, SectionBlockCount, DefaultValue> m_Blocks;
 	ChunkDataStore<NIBBLETYPE, SectionMetaCount, DefaultMetaValue> m_Metas;
+	ChunkSectionVersions m_Versions;
 
 public:
 
@@ -80,14 +450,30 @@ public:
 	BLOCKTYPE GetBlock(Vector3i a_Position) const { return m_Blocks.Get(a_Position); }
 	NIBBLETYPE GetMeta(Vector3i a_Position) const { return m_Metas.Get(a_Position); }
 
-	BlockArray * GetSection(size_t a_Y) const { return m_Blocks.GetSection(a_Y); }
-	MetaArray * GetMetaSection(size_t a_Y) const { return m_Metas.GetSection(a_Y); }
+	const BlockArray * GetSection(size_t a_Y) const { return m_Blocks.GetSection(a_Y); }
+	const MetaArray * GetMetaSection(size_t a_Y) const { return m_Metas.GetSection(a_Y); }
+
+	BLOCKTYPE GetSectionFill(size_t a_Y) const { return m_Blocks.GetSectionFill(a_Y); }
+	NIBBLETYPE GetMetaSectionFill(size_t a_Y) const { return m_Metas.GetSectionFill(a_Y); }
+
+	/** Returns true if the section is all air with zero metas. */
+	bool IsSectionDefault(size_t a_Y) const { return m_Blocks.IsSectionDefault(a_Y) && m_Metas.IsSectionDefault(a_Y); }
+
+	/** Returns the version of the block types and metas of the section, which changes with every modification of the section. */
+	ChunkSectionVersion GetSectionVersion(size_t a_Y) const { return m_Versions.Get(a_Y); }
 
-	void SetBlock(Vector3i a_Position, BLOCKTYPE a_Block) { m_Blocks.Set(a_Position, a_Block); }
-	void SetMeta(Vector3i a_Position, NIBBLETYPE a_Meta) { m_Metas.Set(a_Position, a_Meta); }
+	void SetBlock(Vector3i a_Position, BLOCKTYPE a_Block);
+	void SetMeta(Vector3i a_Position, NIBBLETYPE a_Meta);
+
+	/** Sets the block types and metas of all the changes in the range, which must all lie in the section a_Y.
+	The section's version is bumped once for the whole range, rather than twice per block. */
+	void SetSectionBlocks(sSetBlockVector::const_iterator a_Begin, sSetBlockVector::const_iterator a_End, size_t a_Y);
 
 	void SetAll(const cChunkDef::BlockTypes & a_BlockSource, const cChunkDef::BlockNibbles & a_MetaSource);
 	void SetSection(const SectionType & a_BlockSource, const SectionMetaType & a_MetaSource, size_t a_Y);
+
+	/** Collapses the sections that hold a single value into the uniform representation. */
+	void Compact(void);
 };
 
 
@@ -109,6 +495,7 @@ private:
 
 	ChunkDataStore<NIBBLETYPE, SectionLightCount, DefaultBlockLightValue> m_BlockLights;
 	ChunkDataStore<NIBBLETYPE, SectionLightCount, DefaultSkyLightValue> m_SkyLights;
+	ChunkSectionVersions m_Versions;
 
 public:
 
@@ -119,30 +506,46 @@ public:
 	NIBBLETYPE GetBlockLight(Vector3i a_Position) const { return m_BlockLights.Get(a_Position); }
 	NIBBLETYPE GetSkyLight(Vector3i a_Position) const { return m_SkyLights.Get(a_Position); }
 
-	LightArray * GetBlockLightSection(size_t a_Y) const { return m_BlockLights.GetSection(a_Y); }
-	LightArray * GetSkyLightSection(size_t a_Y) const { return m_SkyLights.GetSection(a_Y); }
+	const LightArray * GetBlockLightSection(size_t a_Y) const { return m_BlockLights.GetSection(a_Y); }
+	const LightArray * GetSkyLightSection(size_t a_Y) const { return m_SkyLights.GetSection(a_Y); }
+
+	NIBBLETYPE GetBlockLightSectionFill(size_t a_Y) const { return m_BlockLights.GetSectionFill(a_Y); }
+	NIBBLETYPE GetSkyLightSectionFill(size_t a_Y) const { return m_SkyLights.GetSectionFill(a_Y); }
+
+	/** Returns true if the section has no block light and full sky light. */
+	bool IsSectionDefault(size_t a_Y) const { return m_BlockLights.IsSectionDefault(a_Y) && m_SkyLights.IsSectionDefault(a_Y); }
+
+	/** Returns the version of the block and sky light of the section, which changes with every modification of the section. */
+	ChunkSectionVersion GetSectionVersion(size_t a_Y) const { return m_Versions.Get(a_Y); }
+
+	void SetBlockLight(Vector3i a_Position, NIBBLETYPE a_Value);
+	void SetSkyLight(Vector3i a_Position, NIBBLETYPE a_Value);
 
 	void SetAll(const cChunkDef::BlockNibbles & a_BlockLightSource, const cChunkDef::BlockNibbles & a_SkyLightSource);
 	void SetSection(const SectionType & a_BlockLightSource, const SectionType & a_SkyLightSource, size_t a_Y);
+
+	/** Collapses the sections that hold a single value into the uniform representation. */
+	void Compact(void);
 };
 
 
 
 
 
-/** Invokes the callback functor for every chunk section containing at least one present block or light section data.
+/** Invokes the callback functor for every chunk section containing any block or light data other than the defaults.
 This is used to collect all data for all sections.
+Any of the section pointers may be nullptr for a uniform section, the callback must use the matching Get*SectionFill() value then.
 In macro form to work around a Visual Studio 2017 ICE bug. */
 #define ChunkDef_ForEachSection(BlockData, LightData, Callback) \
 	do \
 	{ \
 		for (size_t Y = 0; Y < cChunkDef::NumSections; ++Y) \
 		{ \
-			const auto Blocks = BlockData.GetSection(Y); \
-			const auto Metas = BlockData.GetMetaSection(Y); \
-			const auto BlockLights = LightData.GetBlockLightSection(Y); \
-			const auto SkyLights = LightData.GetSkyLightSection(Y); \
-			if ((Blocks != nullptr) || (Metas != nullptr) || (BlockLights != nullptr) || (SkyLights != nullptr)) \
+			[[maybe_unused]] const auto Blocks = BlockData.GetSection(Y); \
+			[[maybe_unused]] const auto Metas = BlockData.GetMetaSection(Y); \
+			[[maybe_unused]] const auto BlockLights = LightData.GetBlockLightSection(Y); \
+			[[maybe_unused]] const auto SkyLights = LightData.GetSkyLightSection(Y); \
+			if (!BlockData.IsSectionDefault(Y) || !LightData.IsSectionDefault(Y)) \
 			{ \
 				Callback \
 			} \
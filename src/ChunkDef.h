@@ -440,6 +440,71 @@ struct sSetBlock
 
 typedef std::vector<sSetBlock> sSetBlockVector;
 
+
+
+
+
+/** Splits a batch of block changes into the changes of the individual chunks, used by cWorld::SetBlocks(). */
+namespace SetBlockBatch
+{
+	/** Returns true if the changes are ordered by their chunk, so that each chunk's changes form a single range. */
+	inline bool IsSortedByChunk(const sSetBlockVector & a_Blocks)
+	{
+		return std::is_sorted(a_Blocks.begin(), a_Blocks.end(), [](const sSetBlock & a_Lhs, const sSetBlock & a_Rhs)
+		{
+			return std::make_pair(a_Lhs.m_ChunkX, a_Lhs.m_ChunkZ) < std::make_pair(a_Rhs.m_ChunkX, a_Rhs.m_ChunkZ);
+		});
+	}
+
+
+	/** Orders the changes by their chunk; the changes within a chunk keep their order. */
+	inline void SortByChunk(sSetBlockVector & a_Blocks)
+	{
+		std::stable_sort(a_Blocks.begin(), a_Blocks.end(), [](const sSetBlock & a_Lhs, const sSetBlock & a_Rhs)
+		{
+			return std::make_pair(a_Lhs.m_ChunkX, a_Lhs.m_ChunkZ) < std::make_pair(a_Rhs.m_ChunkX, a_Rhs.m_ChunkZ);
+		});
+	}
+
+
+	/** Returns the end of the range of changes that lie in the same chunk as a_Begin. */
+	inline sSetBlockVector::const_iterator FindChunkEnd(sSetBlockVector::const_iterator a_Begin, sSetBlockVector::const_iterator a_End)
+	{
+		return std::find_if(a_Begin, a_End, [a_Begin](const sSetBlock & a_Block)
+		{
+			return (a_Block.m_ChunkX != a_Begin->m_ChunkX) || (a_Block.m_ChunkZ != a_Begin->m_ChunkZ);
+		});
+	}
+
+
+	/** Returns the blocks changed by the changes in the range, all of which lie in the same chunk.
+	Each block is listed once, with its final type and meta; the blocks are ordered by their index in the chunk,
+	so that the blocks of each section are adjacent. */
+	inline sSetBlockVector MergeChunkChanges(sSetBlockVector::const_iterator a_Begin, sSetBlockVector::const_iterator a_End)
+	{
+		sSetBlockVector Res(a_Begin, a_End);
+		std::stable_sort(Res.begin(), Res.end(), [](const sSetBlock & a_Lhs, const sSetBlock & a_Rhs)
+		{
+			return cChunkDef::MakeIndex(a_Lhs.GetRelativePos()) < cChunkDef::MakeIndex(a_Rhs.GetRelativePos());
+		});
+
+		// Keep only the last change of each block, which is the block's final state:
+		auto Out = Res.begin();
+		for (auto itr = Res.begin(); itr != Res.end(); ++itr)
+		{
+			ASSERT((itr->m_ChunkX == a_Begin->m_ChunkX) && (itr->m_ChunkZ == a_Begin->m_ChunkZ));
+			const auto Next = std::next(itr);
+			if ((Next != Res.end()) && (Next->GetRelativePos() == itr->GetRelativePos()))
+			{
+				continue;
+			}
+			*Out++ = *itr;
+		}
+		Res.erase(Out, Res.end());
+		return Res;
+	}
+}
+
 typedef std::list<cChunkCoords> cChunkCoordsList;
 typedef std::vector<cChunkCoords> cChunkCoordsVector;
 
@@ -454,7 +519,10 @@ class cChunkCoordsHash
 public:
 	size_t operator () (const cChunkCoords & a_Coords) const
 	{
-		return (static_cast<size_t>(a_Coords.m_ChunkX) << 16) ^ static_cast<size_t>(a_Coords.m_ChunkZ);
+		// Pack both coords into one 64-bit key and mix it, so that nearby chunks spread over the buckets:
+		const auto Key = (static_cast<UInt64>(static_cast<UInt32>(a_Coords.m_ChunkX)) << 32) | static_cast<UInt32>(a_Coords.m_ChunkZ);
+		const auto Mixed = Key * 0x9e3779b97f4a7c15ULL;
+		return static_cast<size_t>(Mixed ^ (Mixed >> 32));
 	}
 };
 
@@ -1,5 +1,6 @@
 #include "Globals.h"
 #include "ChunkGeneratorThread.h"
+#include "Generating/ChunkDataCache.h"
 #include "Generating/ChunkGenerator.h"
 #include "Generating/ChunkDesc.h"
 
@@ -18,8 +19,13 @@ const size_t QUEUE_SKIP_LIMIT = 500;
 
 
 cChunkGeneratorThread::cChunkGeneratorThread(void) :
-	Super("Chunk Generator"),
 	m_Generator(nullptr),
+	m_Seed(0),
+	m_ShouldTerminate(false),
+	m_NumChunksGenerated(0),
+	m_NumTotalGenerated(0),
+	m_GenerationStart(std::chrono::steady_clock::now()),
+	m_LastReport(m_GenerationStart),
 	m_PluginInterface(nullptr),
 	m_ChunkSink(nullptr)
 {
@@ -38,17 +44,33 @@ cChunkGeneratorThread::~cChunkGeneratorThread()
 
 
 
-bool cChunkGeneratorThread::Initialize(cPluginInterface & a_PluginInterface, cChunkSink & a_ChunkSink, cIniFile & a_IniFile)
+bool cChunkGeneratorThread::Initialize(cPluginInterface & a_PluginInterface, cChunkSink & a_ChunkSink, cIniFile & a_IniFile, unsigned a_NumWorkers)
 {
 	m_PluginInterface = &a_PluginInterface;
 	m_ChunkSink = &a_ChunkSink;
 
-	m_Generator = cChunkGenerator::CreateFromIniFile(a_IniFile);
+	// All the generators share the biome and height caches:
+	m_Caches = std::make_shared<cGeneratorCaches>();
+	m_Generator = cChunkGenerator::CreateFromIniFile(a_IniFile, m_Caches);
 	if (m_Generator == nullptr)
 	{
 		LOGERROR("Generator could not start, aborting the server");
 		return false;
 	}
+	m_Seed = m_Generator->GetSeed();
+
+	// The first generator has stored any defaults (such as a random seed) into the INI file, so the workers' generators are identical:
+	m_Workers.clear();
+	for (size_t i = 0; i < std::max(a_NumWorkers, 1U); i++)
+	{
+		auto Generator = cChunkGenerator::CreateFromIniFile(a_IniFile, m_Caches);
+		if (Generator == nullptr)
+		{
+			LOGERROR("Generator could not start, aborting the server");
+			return false;
+		}
+		m_Workers.push_back(std::make_unique<cWorker>(*this, i, std::move(Generator)));
+	}
 	return true;
 }
 
@@ -56,12 +78,29 @@ bool cChunkGeneratorThread::Initialize(cPluginInterface & a_PluginInterface, cCh
 
 
 
+void cChunkGeneratorThread::Start(void)
+{
+	for (auto & Worker : m_Workers)
+	{
+		Worker->Start();
+	}
+}
+
+
+
+
+
 void cChunkGeneratorThread::Stop(void)
 {
 	m_ShouldTerminate = true;
-	m_Event.Set();
+	for (auto & Worker : m_Workers)
+	{
+		Worker->Stop();
+	}
 	m_evtRemoved.Set();  // Wake up anybody waiting for empty queue
-	Super::Stop();
+	m_Workers.clear();
+
+	cCSLock Lock(m_CSGenerator);
 	m_Generator.reset();
 }
 
@@ -85,6 +124,14 @@ void cChunkGeneratorThread::QueueGenerateChunk(
 		{
 			LOGWARN("WARNING: Adding chunk %s to generation queue; Queue is too big! (%zu)", a_Coords.ToString().c_str(), m_Queue.size());
 		}
+
+		// When the queue starts to fill, restart the performance stats, so that waiting for the queue is not counted into the total time:
+		if (m_Queue.empty() && m_InProgress.empty())
+		{
+			m_NumChunksGenerated = 0;
+			m_GenerationStart = std::chrono::steady_clock::now();
+			m_LastReport = m_GenerationStart;
+		}
 		m_Queue.emplace_back(a_Coords, a_ForceRegeneration, a_Callback);
 	}
 
@@ -97,6 +144,7 @@ void cChunkGeneratorThread::QueueGenerateChunk(
 
 void cChunkGeneratorThread::GenerateBiomes(cChunkCoords a_Coords, cChunkDef::BiomeMap & a_BiomeMap)
 {
+	cCSLock Lock(m_CSGenerator);
 	if (m_Generator != nullptr)
 	{
 		m_Generator->GenerateBiomes(a_Coords, a_BiomeMap);
@@ -133,7 +181,7 @@ size_t cChunkGeneratorThread::GetQueueLength(void) const
 
 int cChunkGeneratorThread::GetSeed() const
 {
-	return m_Generator->GetSeed();
+	return m_Seed;
 }
 
 
@@ -142,6 +190,7 @@ int cChunkGeneratorThread::GetSeed() const
 
 EMCSBiome cChunkGeneratorThread::GetBiomeAt(int a_BlockX, int a_BlockZ)
 {
+	cCSLock Lock(m_CSGenerator);
 	ASSERT(m_Generator != nullptr);
 	return m_Generator->GetBiomeAt(a_BlockX, a_BlockZ);
 }
@@ -150,110 +199,210 @@ EMCSBiome cChunkGeneratorThread::GetBiomeAt(int a_BlockX, int a_BlockZ)
 
 
 
-void cChunkGeneratorThread::Execute(void)
+size_t cChunkGeneratorThread::GetNumWorkers(void) const
 {
-	// To be able to display performance information, the generator counts the chunks generated.
-	// When the queue gets empty, the count is reset, so that waiting for the queue is not counted into the total time.
-	int NumChunksGenerated = 0;  // Number of chunks generated since the queue was last empty
-	clock_t GenerationStart = clock();  // Clock tick when the queue started to fill
-	clock_t LastReportTick = clock();  // Clock tick of the last report made (so that performance isn't reported too often)
+	return m_Workers.size();
+}
+
+
 
-	while (!m_ShouldTerminate)
+
+
+size_t cChunkGeneratorThread::GetNumGenerated(void) const
+{
+	cCSLock Lock(m_CS);
+	return m_NumTotalGenerated;
+}
+
+
+
+
+
+cGeneratorCaches::sStatistics cChunkGeneratorThread::GetCacheStatistics(void) const
+{
+	if (m_Caches == nullptr)
 	{
-		cCSLock Lock(m_CS);
-		while (m_Queue.empty())
+		return {};
+	}
+	return m_Caches->GetStatistics();
+}
+
+
+
+
+
+bool cChunkGeneratorThread::GetNextItem(QueueItem & a_Item, bool & a_SkipEnabled)
+{
+	cCSLock Lock(m_CS);
+	for (;;)
+	{
+		if (m_ShouldTerminate)
 		{
-			if ((NumChunksGenerated > 16) && (clock() - LastReportTick > CLOCKS_PER_SEC))
+			// Pass the wakeup on to the next waiting worker:
+			m_Event.Set();
+			return false;
+		}
+
+		// Find the first item that isn't next to a chunk being generated by another worker:
+		auto itr = std::find_if(m_Queue.begin(), m_Queue.end(), [this](const QueueItem & a_QueueItem)
 			{
-				/* LOG("Chunk generator performance: %.2f ch / sec (%d ch total)",
-					static_cast<double>(NumChunksGenerated) * CLOCKS_PER_SEC/ (clock() - GenerationStart),
-					NumChunksGenerated
-				); */
+				return std::none_of(m_InProgress.begin(), m_InProgress.end(), [&a_QueueItem](const cChunkCoords & a_InProgress)
+					{
+						return (
+							(std::abs(a_InProgress.m_ChunkX - a_QueueItem.m_Coords.m_ChunkX) <= 1) &&
+							(std::abs(a_InProgress.m_ChunkZ - a_QueueItem.m_Coords.m_ChunkZ) <= 1)
+						);
+					}
+				);
 			}
-			cCSUnlock Unlock(Lock);
-			m_Event.Wait();
-			if (m_ShouldTerminate)
+		);
+		if (itr != m_Queue.end())
+		{
+			a_Item = *itr;
+			a_SkipEnabled = (m_Queue.size() > QUEUE_SKIP_LIMIT);
+			m_Queue.erase(itr);
+			m_InProgress.push_back(a_Item.m_Coords);
+			if (!m_Queue.empty())
 			{
-				return;
+				// Let another worker pick up the rest of the queue:
+				m_Event.Set();
 			}
-			NumChunksGenerated = 0;
-			GenerationStart = clock();
-			LastReportTick = clock();
+			break;
 		}
 
-		if (m_Queue.empty())
-		{
-			// Sometimes the queue remains empty
-			// If so, we can't do any front() operations on it!
-			continue;
-		}
+		// Either the queue is empty or all of it is waiting for chunks in progress, wait for a change:
+		cCSUnlock Unlock(Lock);
+		m_Event.Wait();
+	}
+	Lock.Unlock();
+	m_evtRemoved.Set();
+	return true;
+}
+
+
 
-		auto item = m_Queue.front();  // Get next chunk from the queue
-		bool SkipEnabled = (m_Queue.size() > QUEUE_SKIP_LIMIT);
-		m_Queue.erase(m_Queue.begin());  // Remove the item from the queue
-		Lock.Unlock();  // Unlock ASAP
-		m_evtRemoved.Set();
+
+
+void cChunkGeneratorThread::FinishItem(cChunkCoords a_Coords, bool a_WasGenerated)
+{
+	{
+		cCSLock Lock(m_CS);
+		m_InProgress.erase(std::find(m_InProgress.begin(), m_InProgress.end(), a_Coords));
 
 		// Display perf info once in a while:
-		if ((NumChunksGenerated > 512) && (clock() - LastReportTick > 2 * CLOCKS_PER_SEC))
+		if (a_WasGenerated)
 		{
-			LOG("Chunk generator performance: %.2f ch / sec (%d ch total)",
-				static_cast<double>(NumChunksGenerated) * CLOCKS_PER_SEC / (clock() - GenerationStart),
-				NumChunksGenerated
-			);
-			LastReportTick = clock();
+			m_NumChunksGenerated++;
+			m_NumTotalGenerated++;
+			const auto Now = std::chrono::steady_clock::now();
+			if ((m_NumChunksGenerated > 512) && (Now - m_LastReport > std::chrono::seconds(2)))
+			{
+				const auto Seconds = std::chrono::duration<double>(Now - m_GenerationStart).count();
+				LOG("Chunk generator performance: %.2f ch / sec (%d ch total, %zu threads)",
+					static_cast<double>(m_NumChunksGenerated) / Seconds, m_NumChunksGenerated, m_Workers.size()
+				);
+				m_LastReport = Now;
+			}
 		}
+	}
+
+	// Items queued next to the finished chunk may now be available:
+	m_Event.Set();
+}
+
+
+
+
 
+////////////////////////////////////////////////////////////////////////////////
+// cChunkGeneratorThread::cWorker:
+
+cChunkGeneratorThread::cWorker::cWorker(cChunkGeneratorThread & a_Parent, size_t a_Index, std::unique_ptr<cChunkGenerator> a_Generator) :
+	Super(fmt::format(FMT_STRING("Chunk Generator #{}"), a_Index + 1)),
+	m_Parent(a_Parent),
+	m_Generator(std::move(a_Generator))
+{
+}
+
+
+
+
+
+void cChunkGeneratorThread::cWorker::Stop(void)
+{
+	m_ShouldTerminate = true;
+	m_Parent.m_Event.Set();
+	Super::Stop();
+}
+
+
+
+
+
+void cChunkGeneratorThread::cWorker::Execute(void)
+{
+	QueueItem Item({0, 0}, false, nullptr);
+	bool SkipEnabled = false;
+	while (!m_ShouldTerminate && m_Parent.GetNextItem(Item, SkipEnabled))
+	{
 		// Skip the chunk if it's already generated and regeneration is not forced. Report as success:
-		if (!item.m_ForceRegeneration && m_ChunkSink->IsChunkValid(item.m_Coords))
+		if (!Item.m_ForceRegeneration && m_Parent.m_ChunkSink->IsChunkValid(Item.m_Coords))
 		{
-			LOGD("Chunk %s already generated, skipping generation", item.m_Coords.ToString().c_str());
-			if (item.m_Callback != nullptr)
+			LOGD("Chunk %s already generated, skipping generation", Item.m_Coords.ToString().c_str());
+			m_Parent.FinishItem(Item.m_Coords, false);
+			if (Item.m_Callback != nullptr)
 			{
-				item.m_Callback->Call(item.m_Coords, true);
+				Item.m_Callback->Call(Item.m_Coords, true);
 			}
 			continue;
 		}
 
 		// Skip the chunk if the generator is overloaded:
-		if (SkipEnabled && !m_ChunkSink->HasChunkAnyClients(item.m_Coords))
+		if (SkipEnabled && !m_Parent.m_ChunkSink->HasChunkAnyClients(Item.m_Coords))
 		{
-			LOGWARNING("Chunk generator overloaded, skipping chunk %s", item.m_Coords.ToString().c_str());
-			if (item.m_Callback != nullptr)
+			LOGWARNING("Chunk generator overloaded, skipping chunk %s", Item.m_Coords.ToString().c_str());
+			m_Parent.FinishItem(Item.m_Coords, false);
+			if (Item.m_Callback != nullptr)
 			{
-				item.m_Callback->Call(item.m_Coords, false);
+				Item.m_Callback->Call(Item.m_Coords, false);
 			}
 			continue;
 		}
 
 		// Generate the chunk:
-		DoGenerate(item.m_Coords);
-		if (item.m_Callback != nullptr)
+		DoGenerate(Item.m_Coords);
+		m_Parent.FinishItem(Item.m_Coords, true);
+		if (Item.m_Callback != nullptr)
 		{
-			item.m_Callback->Call(item.m_Coords, true);
+			Item.m_Callback->Call(Item.m_Coords, true);
 		}
-		NumChunksGenerated++;
-	}  // while (!bStop)
+	}
 }
 
 
 
 
 
-void cChunkGeneratorThread::DoGenerate(cChunkCoords a_Coords)
+void cChunkGeneratorThread::cWorker::DoGenerate(cChunkCoords a_Coords)
 {
-	ASSERT(m_PluginInterface != nullptr);
-	ASSERT(m_ChunkSink != nullptr);
+	ASSERT(m_Parent.m_PluginInterface != nullptr);
+	ASSERT(m_Parent.m_ChunkSink != nullptr);
 
 	cChunkDesc ChunkDesc(a_Coords);
-	m_PluginInterface->CallHookChunkGenerating(ChunkDesc);
+	{
+		cCSLock Lock(m_Parent.m_CSPluginHooks);
+		m_Parent.m_PluginInterface->CallHookChunkGenerating(ChunkDesc);
+	}
 	m_Generator->Generate(ChunkDesc);
-	m_PluginInterface->CallHookChunkGenerated(ChunkDesc);
+	{
+		cCSLock Lock(m_Parent.m_CSPluginHooks);
+		m_Parent.m_PluginInterface->CallHookChunkGenerated(ChunkDesc);
+	}
 
 	#ifndef NDEBUG
 		// Verify that the generator has produced valid data:
 		ChunkDesc.VerifyHeightmap();
 	#endif
 
-	m_ChunkSink->OnChunkGenerated(ChunkDesc);
+	m_Parent.m_ChunkSink->OnChunkGenerated(ChunkDesc);
 }
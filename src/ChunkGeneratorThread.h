@@ -2,6 +2,7 @@
 
 #include "OSSupport/IsThread.h"
 #include "ChunkDef.h"
+#include "Generating/ChunkDataCache.h"
 
 
 
@@ -15,17 +16,19 @@ class cChunkGenerator;
 
 
 
-/** Takes requests for generating chunks and processes them in a separate thread one by one.
+/** Takes requests for generating chunks and processes them in a pool of worker threads.
 The requests are not added to the queue if there is already a request with the same coords.
-Before generating, the thread checks if the chunk hasn't been already generated.
-It is theoretically possible to have multiple generator threads by having multiple instances of this object,
-but then it MAY happen that the chunk is generated twice.
+Before generating, the worker checks if the chunk hasn't been already generated.
+Each worker has its own cChunkGenerator instance, created from the same INI settings, so that the sub-generators
+need no locking; only the biome and height caches are shared by all the instances.
+The generators are a pure function of the seed and the chunk coords, so the generated chunks are the same
+regardless of the number of workers and the order in which they are processed.
+A worker never picks a chunk next to one that another worker is generating, so that a chunk and its neighbors
+are always handed to the chunk sink in the order they were taken from the queue.
+The plugin hooks are called by a single worker at a time, only the generating itself runs in parallel.
 If the generator queue is overloaded, the generator skips chunks with no clients in them. */
-class cChunkGeneratorThread :
-	public cIsThread
+class cChunkGeneratorThread
 {
-	using Super = cIsThread;
-
 public:
 
 	/** The interface through which the plugins are called for their OnChunkGenerating / OnChunkGenerated hooks. */
@@ -74,10 +77,13 @@ public:
 
 
 	cChunkGeneratorThread (void);
-	virtual ~cChunkGeneratorThread() override;
+	~cChunkGeneratorThread();
+
+	/** Read settings from the ini file and initialize in preperation for being started.
+	Creates a_NumWorkers generator workers (at least one), each with its own generator. */
+	bool Initialize(cPluginInterface & a_PluginInterface, cChunkSink & a_ChunkSink, cIniFile & a_IniFile, unsigned a_NumWorkers);
 
-	/** Read settings from the ini file and initialize in preperation for being started. */
-	bool Initialize(cPluginInterface & a_PluginInterface, cChunkSink & a_ChunkSink, cIniFile & a_IniFile);
+	void Start(void);
 
 	void Stop(void);
 
@@ -100,9 +106,46 @@ public:
 	/** Returns the biome at the specified coords. Used by ChunkMap if an invalid chunk is queried for biome */
 	EMCSBiome GetBiomeAt(int a_BlockX, int a_BlockZ);
 
+	/** Returns the number of the generator worker threads. */
+	size_t GetNumWorkers(void) const;
+
+	/** Returns the number of chunks generated since the start, for measuring the throughput. */
+	size_t GetNumGenerated(void) const;
+
+	/** Returns the statistics of the biome and height caches shared by all the generators. */
+	cGeneratorCaches::sStatistics GetCacheStatistics(void) const;
+
 
 private:
 
+	/** A single generator thread, with its own generator instance. */
+	class cWorker :
+		public cIsThread
+	{
+		using Super = cIsThread;
+
+	public:
+
+		cWorker(cChunkGeneratorThread & a_Parent, size_t a_Index, std::unique_ptr<cChunkGenerator> a_Generator);
+
+		/** Signals the thread to terminate and waits until it's finished. */
+		void Stop(void);
+
+	protected:
+
+		cChunkGeneratorThread & m_Parent;
+
+		/** The generator engine used by this worker only. */
+		std::unique_ptr<cChunkGenerator> m_Generator;
+
+		// cIsThread override:
+		virtual void Execute(void) override;
+
+		/** Generates the specified chunk and sets it into the chunksink. */
+		void DoGenerate(cChunkCoords a_Coords);
+	};
+
+
 	struct QueueItem
 	{
 		/** The chunk coords */
@@ -125,21 +168,53 @@ private:
 	using Queue = std::list<QueueItem>;
 
 
-	/** CS protecting access to the queue. */
+	/** CS protecting access to the queue, the chunks in progress and the performance counters. */
 	mutable cCriticalSection m_CS;
 
 	/** Queue of the chunks to be generated. Protected against multithreaded access by m_CS. */
 	Queue m_Queue;
 
-	/** Set when an item is added to the queue or the thread should terminate. */
+	/** The chunks currently being generated by the workers. Protected against multithreaded access by m_CS. */
+	std::vector<cChunkCoords> m_InProgress;
+
+	/** Set when an item is added to the queue, a chunk is finished, or the workers should terminate. */
 	cEvent m_Event;
 
 	/** Set when an item is removed from the queue. */
 	cEvent m_evtRemoved;
 
-	/** The actual chunk generator engine used. */
+	/** The caches shared by all the generators, so that the workers and the direct calls share their results. */
+	std::shared_ptr<cGeneratorCaches> m_Caches;
+
+	/** Serializes the direct calls, they may come from any thread. */
+	cCriticalSection m_CSGenerator;
+
+	/** Serializes the plugin hook calls, the plugins don't expect their generator hooks to run in parallel. */
+	cCriticalSection m_CSPluginHooks;
+
+	/** The generator engine used for the direct (non-queued) calls, such as GenerateBiomes() and GetBiomeAt(). Protected by m_CSGenerator. */
 	std::unique_ptr<cChunkGenerator> m_Generator;
 
+	std::vector<std::unique_ptr<cWorker>> m_Workers;
+
+	/** The world seed, stored on initialization so that it can be queried after the generators are destroyed. */
+	int m_Seed;
+
+	/** Set when stopping, makes the workers terminate. */
+	std::atomic<bool> m_ShouldTerminate;
+
+	/** Number of chunks generated since the queue was last empty, for the performance reports. Protected by m_CS. */
+	int m_NumChunksGenerated;
+
+	/** Number of chunks generated since the start. Protected by m_CS. */
+	size_t m_NumTotalGenerated;
+
+	/** Time when the queue started to fill. Protected by m_CS. */
+	std::chrono::steady_clock::time_point m_GenerationStart;
+
+	/** Time of the last performance report, so that the performance isn't reported too often. Protected by m_CS. */
+	std::chrono::steady_clock::time_point m_LastReport;
+
 	/** The plugin interface that may modify the generated chunks */
 	cPluginInterface * m_PluginInterface;
 
@@ -147,11 +222,13 @@ private:
 	cChunkSink * m_ChunkSink;
 
 
-	// cIsThread override:
-	virtual void Execute(void) override;
+	/** Takes the first queued item that doesn't neighbor any chunk in progress, marks its chunk as in progress.
+	Blocks until there is such an item; returns false if the workers are terminating.
+	a_SkipEnabled is set if the queue is overloaded and chunks without clients may be skipped. */
+	bool GetNextItem(QueueItem & a_Item, bool & a_SkipEnabled);
 
-	/** Generates the specified chunk and sets it into the chunksink. */
-	void DoGenerate(cChunkCoords a_Coords);
+	/** Removes the chunk from the chunks in progress, counts it into the performance stats if it was generated. */
+	void FinishItem(cChunkCoords a_Coords, bool a_WasGenerated);
 };
 
 
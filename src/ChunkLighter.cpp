@@ -0,0 +1,459 @@
+
+// ChunkLighter.cpp
+
+// Implements the cChunkLighter class that calculates the blocklight and skylight of a single chunk
+
+#include "Globals.h"
+#include "ChunkLighter.h"
+#include "BlockInfo.h"
+#include "BlockType.h"
+#include "ChunkDataCallback.h"
+#include "NibbleKernels.h"
+
+
+
+
+
+/** Chunk data callback that takes the chunk data and puts them into cChunkLighter's m_BlockTypes[] / m_HeightMap[]: */
+class cReader :
+	public cChunkDataCallback
+{
+	virtual void ChunkData(const ChunkBlockData & a_BlockData, const ChunkLightData &) override
+	{
+		BLOCKTYPE * OutputRows = m_BlockTypes;
+		int OutputIdx = m_ReadingChunkX + m_ReadingChunkZ * cChunkDef::Width * 3;
+		ChunkBlockData::SectionType Blocks;
+		for (size_t i = 0; i != cChunkDef::NumSections; ++i)
+		{
+			const auto Section = a_BlockData.GetSection(i);
+			if (Section == nullptr)
+			{
+				const auto Fill = a_BlockData.GetSectionFill(i);
+				if (Fill == E_BLOCK_AIR)
+				{
+					// Skip to the next section
+					OutputIdx += 9 * cChunkDef::SectionHeight * cChunkDef::Width;
+					continue;
+				}
+
+				std::fill(std::begin(Blocks), std::end(Blocks), Fill);
+			}
+			else
+			{
+				// Unpack the paletted section so that whole rows can be copied:
+				Section->CopyTo(Blocks);
+			}
+
+			for (size_t OffsetY = 0; OffsetY != cChunkDef::SectionHeight; ++OffsetY)
+			{
+				for (size_t Z = 0; Z != cChunkDef::Width; ++Z)
+				{
+					auto InPtr = Blocks + Z * cChunkDef::Width + OffsetY * cChunkDef::Width * cChunkDef::Width;
+					std::copy_n(InPtr, cChunkDef::Width, OutputRows + OutputIdx * cChunkDef::Width);
+
+					OutputIdx += 3;
+				}
+				// Skip into the next y-level in the 3x3 chunk blob; each level has cChunkDef::Width * 9 rows
+				// We've already walked cChunkDef::Width * 3 in the "for z" cycle, that makes cChunkDef::Width * 6 rows left to skip
+				OutputIdx += cChunkDef::Width * 6;
+			}
+		}
+	}  // BlockTypes()
+
+
+	virtual void HeightMap(const cChunkDef::HeightMap & a_Heightmap) override
+	{
+		// Copy the entire heightmap, distribute it into the 3x3 chunk blob:
+		typedef struct {HEIGHTTYPE m_Row[16]; } ROW;
+		const ROW * InputRows  = reinterpret_cast<const ROW *>(a_Heightmap);
+		ROW * OutputRows = reinterpret_cast<ROW *>(m_HeightMap);
+		int InputIdx = 0;
+		int OutputIdx = m_ReadingChunkX + m_ReadingChunkZ * cChunkDef::Width * 3;
+		for (int z = 0; z < cChunkDef::Width; z++)
+		{
+			OutputRows[OutputIdx] = InputRows[InputIdx++];
+			OutputIdx += 3;
+		}  // for z
+
+		// Find the highest block in the entire chunk, use it as a base for m_MaxHeight:
+		HEIGHTTYPE MaxHeight = m_MaxHeight;
+		for (size_t i = 0; i < ARRAYCOUNT(a_Heightmap); i++)
+		{
+			if (a_Heightmap[i] > MaxHeight)
+			{
+				MaxHeight = a_Heightmap[i];
+			}
+		}
+		m_MaxHeight = MaxHeight;
+	}
+
+public:
+	int m_ReadingChunkX;  // 0, 1 or 2; x-offset of the chunk we're reading from the BlockTypes start
+	int m_ReadingChunkZ;  // 0, 1 or 2; z-offset of the chunk we're reading from the BlockTypes start
+	HEIGHTTYPE m_MaxHeight;  // Maximum value in this chunk's heightmap
+	BLOCKTYPE * m_BlockTypes;  // 3x3 chunks of block types, organized as a single XZY blob of data (instead of 3x3 XZY blobs)
+	HEIGHTTYPE * m_HeightMap;  // 3x3 chunks of height map,  organized as a single XZY blob of data (instead of 3x3 XZY blobs)
+
+	cReader(BLOCKTYPE * a_BlockTypes, HEIGHTTYPE * a_HeightMap) :
+		m_ReadingChunkX(0),
+		m_ReadingChunkZ(0),
+		m_MaxHeight(0),
+		m_BlockTypes(a_BlockTypes),
+		m_HeightMap(a_HeightMap)
+	{
+		std::fill_n(m_BlockTypes, cChunkDef::NumBlocks * 9, E_BLOCK_AIR);
+	}
+} ;
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cChunkLighter:
+
+cChunkLighter::cChunkLighter(void):
+	m_MaxHeight(0),
+	m_BlockLightTop(0),
+	m_SkyLightTop(0),
+	m_NumSeeds(0)
+{
+	// The calc steps only clear the seeds they have processed, start with clean buffers:
+	memset(m_IsSeed1, 0, sizeof(m_IsSeed1));
+	memset(m_IsSeed2, 0, sizeof(m_IsSeed2));
+}
+
+
+
+
+
+void cChunkLighter::Light(
+	cChunkCoords a_Coords,
+	const cChunkDataGetter & a_GetChunkData,
+	cChunkDef::BlockNibbles & a_BlockLight,
+	cChunkDef::BlockNibbles & a_SkyLight
+)
+{
+	ReadChunks(a_Coords, a_GetChunkData);
+
+	PrepareBlockLight();
+	CalcLight(m_BlockLight, m_BlockLightTop);
+
+	PrepareSkyLight();
+
+	/*
+	// DEBUG: Save chunk data with highlighted seeds for visual inspection:
+	cFile f4;
+	if (
+		f4.Open(fmt::format(FMT_STRING("Chunk_{}_{}_seeds.grab"), a_Coords.m_ChunkX, a_Coords.m_ChunkZ), cFile::fmWrite)
+	)
+	{
+		for (int z = 0; z < cChunkDef::Width * 3; z++)
+		{
+			for (int y = cChunkDef::Height / 2; y >= 0; y--)
+			{
+				unsigned char Seeds     [cChunkDef::Width * 3];
+				memcpy(Seeds, m_BlockTypes + y * BlocksPerYLayer + z * cChunkDef::Width * 3, cChunkDef::Width * 3);
+				for (int x = 0; x < cChunkDef::Width * 3; x++)
+				{
+					if (m_IsSeed1[y * BlocksPerYLayer + z * cChunkDef::Width * 3 + x])
+					{
+						Seeds[x] = E_BLOCK_DIAMOND_BLOCK;
+					}
+				}
+				f4.Write(Seeds, cChunkDef::Width * 3);
+			}
+		}
+		f4.Close();
+	}
+	//*/
+
+	CalcLight(m_SkyLight, m_SkyLightTop);
+
+	/*
+	// DEBUG: Save XY slices of the chunk data and lighting for visual inspection:
+	cFile f1, f2, f3;
+	if (
+		f1.Open(fmt::format(FMT_STRING("Chunk_{}_{}_data.grab"), a_Coords.m_ChunkX, a_Coords.m_ChunkZ), cFile::fmWrite) &&
+		f2.Open(fmt::format(FMT_STRING("Chunk_{}_{}_sky.grab"),  a_Coords.m_ChunkX, a_Coords.m_ChunkZ), cFile::fmWrite) &&
+		f3.Open(fmt::format(FMT_STRING("Chunk_{}_{}_glow.grab"), a_Coords.m_ChunkX, a_Coords.m_ChunkZ), cFile::fmWrite)
+	)
+	{
+		for (int z = 0; z < cChunkDef::Width * 3; z++)
+		{
+			for (int y = cChunkDef::Height / 2; y >= 0; y--)
+			{
+				f1.Write(m_BlockTypes + y * BlocksPerYLayer + z * cChunkDef::Width * 3, cChunkDef::Width * 3);
+				unsigned char SkyLight  [cChunkDef::Width * 3];
+				unsigned char BlockLight[cChunkDef::Width * 3];
+				for (int x = 0; x < cChunkDef::Width * 3; x++)
+				{
+					SkyLight[x]   = m_SkyLight  [y * BlocksPerYLayer + z * cChunkDef::Width * 3 + x] << 4;
+					BlockLight[x] = m_BlockLight[y * BlocksPerYLayer + z * cChunkDef::Width * 3 + x] << 4;
+				}
+				f2.Write(SkyLight,   cChunkDef::Width * 3);
+				f3.Write(BlockLight, cChunkDef::Width * 3);
+			}
+		}
+		f1.Close();
+		f2.Close();
+		f3.Close();
+	}
+	//*/
+
+	CompressLight(m_BlockLight, m_BlockLightTop, 0, a_BlockLight);
+	CompressLight(m_SkyLight, m_SkyLightTop, 15, a_SkyLight);
+}
+
+
+
+
+
+void cChunkLighter::ReadChunks(cChunkCoords a_Coords, const cChunkDataGetter & a_GetChunkData)
+{
+	// The neighbors that are not available stay air, with zero height:
+	std::fill(std::begin(m_HeightMap), std::end(m_HeightMap), static_cast<HEIGHTTYPE>(0));
+	cReader Reader(m_BlockTypes, m_HeightMap);
+
+	for (int z = 0; z < 3; z++)
+	{
+		Reader.m_ReadingChunkZ = z;
+		for (int x = 0; x < 3; x++)
+		{
+			Reader.m_ReadingChunkX = x;
+			a_GetChunkData({a_Coords.m_ChunkX + x - 1, a_Coords.m_ChunkZ + z - 1}, Reader);
+		}  // for z
+	}  // for x
+
+	m_MaxHeight = Reader.m_MaxHeight;
+
+	// Only the sections up to the highest block need any work, the rest is air in full skylight.
+	// Skylight needs one layer above the highest block for its seeds; blocklight can rise up to 14 layers above the highest emitter.
+	const auto RoundUpToSection = [](int a_NumLayers)
+	{
+		const auto NumSections = (a_NumLayers + cChunkDef::SectionHeight - 1) / cChunkDef::SectionHeight;
+		return std::min(NumSections * cChunkDef::SectionHeight, static_cast<int>(cChunkDef::Height));
+	};
+	m_SkyLightTop = RoundUpToSection(m_MaxHeight + 2);
+	m_BlockLightTop = RoundUpToSection(m_MaxHeight + 15);
+
+	std::fill_n(m_BlockLight, m_BlockLightTop * BlocksPerYLayer, static_cast<NIBBLETYPE>(0));
+	std::fill_n(m_SkyLight, m_SkyLightTop * BlocksPerYLayer, static_cast<NIBBLETYPE>(0));
+}
+
+
+
+
+
+void cChunkLighter::PrepareSkyLight(void)
+{
+	m_NumSeeds = 0;
+
+	// Fill the top of the calculated sections with all-light, the sections above are never looked at:
+	if (m_MaxHeight + 1 < m_SkyLightTop)
+	{
+		std::fill(m_SkyLight + (m_MaxHeight + 1) * BlocksPerYLayer, m_SkyLight + m_SkyLightTop * BlocksPerYLayer, static_cast<NIBBLETYPE>(15));
+	}
+
+	// Walk every column that has all XZ neighbors
+	for (int z = 1; z < cChunkDef::Width * 3 - 1; z++)
+	{
+		int BaseZ = z * cChunkDef::Width * 3;
+		for (int x = 1; x < cChunkDef::Width * 3 - 1; x++)
+		{
+			int idx = BaseZ + x;
+			// Find the lowest block in this column that receives full sunlight (go through transparent blocks):
+			int Current = m_HeightMap[idx];
+			ASSERT(Current < cChunkDef::Height);
+			while (
+				(Current >= 0) &&
+				cBlockInfo::IsTransparent(m_BlockTypes[idx + Current * BlocksPerYLayer]) &&
+				!cBlockInfo::IsSkylightDispersant(m_BlockTypes[idx + Current * BlocksPerYLayer])
+			)
+			{
+				Current -= 1;  // Sunlight goes down unchanged through this block
+			}
+			Current += 1;  // Point to the last sunlit block, rather than the first non-transparent one
+			// The other neighbors don't need transparent-block-checking. At worst we'll have a few dud seeds above the ground.
+			int Neighbor1 = m_HeightMap[idx + 1] + 1;  // X + 1
+			int Neighbor2 = m_HeightMap[idx - 1] + 1;  // X - 1
+			int Neighbor3 = m_HeightMap[idx + cChunkDef::Width * 3] + 1;  // Z + 1
+			int Neighbor4 = m_HeightMap[idx - cChunkDef::Width * 3] + 1;  // Z - 1
+			int MaxNeighbor = std::max(std::max(Neighbor1, Neighbor2), std::max(Neighbor3, Neighbor4));  // Maximum of the four neighbors
+
+			// Fill the column from m_MaxHeight to Current with all-light:
+			for (int y = m_MaxHeight, Index = idx + y * BlocksPerYLayer; y >= Current; y--, Index -= BlocksPerYLayer)
+			{
+				m_SkyLight[Index] = 15;
+			}
+
+			// Add Current as a seed:
+			if (Current < m_SkyLightTop)
+			{
+				int CurrentIdx = idx + Current * BlocksPerYLayer;
+				m_IsSeed1[CurrentIdx] = true;
+				m_SeedIdx1[m_NumSeeds++] = static_cast<UInt32>(CurrentIdx);
+			}
+
+			// Add seed from Current up to the highest neighbor:
+			for (int y = Current + 1, Index = idx + y * BlocksPerYLayer; y < MaxNeighbor; y++, Index += BlocksPerYLayer)
+			{
+				m_IsSeed1[Index] = true;
+				m_SeedIdx1[m_NumSeeds++] = static_cast<UInt32>(Index);
+			}
+		}
+	}
+}
+
+
+
+
+
+void cChunkLighter::PrepareBlockLight()
+{
+	m_NumSeeds = 0;
+
+	// Add each emissive block into the seeds; there are no blocks above m_MaxHeight:
+	for (int Idx = 0; Idx < ((m_MaxHeight + 1) * BlocksPerYLayer); ++Idx)
+	{
+		if (cBlockInfo::GetLightValue(m_BlockTypes[Idx]) == 0)
+		{
+			// Not a light-emissive block
+			continue;
+		}
+
+		// Add current block as a seed:
+		m_IsSeed1[Idx] = true;
+		m_SeedIdx1[m_NumSeeds++] = static_cast<UInt32>(Idx);
+
+		// Light it up:
+		m_BlockLight[Idx] = cBlockInfo::GetLightValue(m_BlockTypes[Idx]);
+	}
+}
+
+
+
+
+
+void cChunkLighter::CalcLight(NIBBLETYPE * a_Light, int a_Top)
+{
+	size_t NumSeeds2 = 0;
+	while (m_NumSeeds > 0)
+	{
+		// Buffer 1 -> buffer 2
+		NumSeeds2 = 0;
+		CalcLightStep(a_Light, a_Top, m_NumSeeds, m_IsSeed1, m_SeedIdx1, NumSeeds2, m_IsSeed2, m_SeedIdx2);
+		m_NumSeeds = 0;
+		if (NumSeeds2 == 0)
+		{
+			return;
+		}
+
+		// Buffer 2 -> buffer 1
+		CalcLightStep(a_Light, a_Top, NumSeeds2, m_IsSeed2, m_SeedIdx2, m_NumSeeds, m_IsSeed1, m_SeedIdx1);
+	}
+}
+
+
+
+
+
+void cChunkLighter::CalcLightStep(
+	NIBBLETYPE * a_Light, int a_Top,
+	size_t a_NumSeedsIn,    unsigned char * a_IsSeedIn,  unsigned int * a_SeedIdxIn,
+	size_t & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
+)
+{
+	const auto TopLayerIdx = static_cast<UInt32>((a_Top - 1) * BlocksPerYLayer);
+	size_t NumSeedsOut = 0;
+	for (size_t i = 0; i < a_NumSeedsIn; i++)
+	{
+		UInt32 SeedIdx = static_cast<UInt32>(a_SeedIdxIn[i]);
+		a_IsSeedIn[SeedIdx] = false;
+		int SeedX = SeedIdx % (cChunkDef::Width * 3);
+		int SeedZ = (SeedIdx / (cChunkDef::Width * 3)) % (cChunkDef::Width * 3);
+
+		// Propagate seed:
+		if (SeedX < cChunkDef::Width * 3 - 1)
+		{
+			PropagateLight(a_Light, SeedIdx, SeedIdx + 1, NumSeedsOut, a_IsSeedOut, a_SeedIdxOut);
+		}
+		if (SeedX > 0)
+		{
+			PropagateLight(a_Light, SeedIdx, SeedIdx - 1, NumSeedsOut, a_IsSeedOut, a_SeedIdxOut);
+		}
+		if (SeedZ < cChunkDef::Width * 3 - 1)
+		{
+			PropagateLight(a_Light, SeedIdx, SeedIdx + cChunkDef::Width * 3, NumSeedsOut, a_IsSeedOut, a_SeedIdxOut);
+		}
+		if (SeedZ > 0)
+		{
+			PropagateLight(a_Light, SeedIdx, SeedIdx - cChunkDef::Width * 3, NumSeedsOut, a_IsSeedOut, a_SeedIdxOut);
+		}
+		if (SeedIdx < TopLayerIdx)
+		{
+			PropagateLight(a_Light, SeedIdx, SeedIdx + BlocksPerYLayer, NumSeedsOut, a_IsSeedOut, a_SeedIdxOut);
+		}
+		if (SeedIdx >= BlocksPerYLayer)
+		{
+			PropagateLight(a_Light, SeedIdx, SeedIdx - BlocksPerYLayer, NumSeedsOut, a_IsSeedOut, a_SeedIdxOut);
+		}
+	}  // for i - a_SeedIdxIn[]
+	a_NumSeedsOut = NumSeedsOut;
+}
+
+
+
+
+
+void cChunkLighter::CompressLight(NIBBLETYPE * a_LightArray, int a_Top, NIBBLETYPE a_AboveTop, NIBBLETYPE * a_ChunkLight)
+{
+	// Each y-level of the middle chunk is 16 rows, one every 3 chunk widths in the 3x3 chunk blob:
+	const int FirstIdx = cChunkDef::Width * 49;  // Index to the first nibble of the middle chunk in the a_LightArray
+	const int BytesPerChunkLayer = cChunkDef::Width * cChunkDef::Width / 2;
+	for (int y = 0; y < a_Top; y++)
+	{
+		NibbleKernels::GatherCompress(
+			a_LightArray + FirstIdx + y * BlocksPerYLayer, cChunkDef::Width, cChunkDef::Width * 3, cChunkDef::Width,
+			a_ChunkLight + y * BytesPerChunkLayer
+		);
+	}
+
+	// The trivially lit sections above; ChunkLightData stores them as uniform sections without any per-block data:
+	std::fill(
+		a_ChunkLight + a_Top * BytesPerChunkLayer, a_ChunkLight + cChunkDef::Height * BytesPerChunkLayer,
+		static_cast<NIBBLETYPE>(a_AboveTop | (a_AboveTop << 4))
+	);
+}
+
+
+
+
+
+void cChunkLighter::PropagateLight(
+	NIBBLETYPE * a_Light,
+	unsigned int a_SrcIdx, unsigned int a_DstIdx,
+	size_t & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
+)
+{
+	ASSERT(a_SrcIdx < ARRAYCOUNT(m_SkyLight));
+	ASSERT(a_DstIdx < ARRAYCOUNT(m_BlockTypes));
+
+	if (a_Light[a_SrcIdx] <= a_Light[a_DstIdx] + cBlockInfo::GetSpreadLightFalloff(m_BlockTypes[a_DstIdx]))
+	{
+		// We're not offering more light than the dest block already has
+		return;
+	}
+
+	a_Light[a_DstIdx] = a_Light[a_SrcIdx] - cBlockInfo::GetSpreadLightFalloff(m_BlockTypes[a_DstIdx]);
+	if (!a_IsSeedOut[a_DstIdx])
+	{
+		a_IsSeedOut[a_DstIdx] = true;
+		a_SeedIdxOut[a_NumSeedsOut++] = a_DstIdx;
+	}
+}
+
+
+
+
+
@@ -0,0 +1,129 @@
+
+// ChunkLighter.h
+
+// Declares the cChunkLighter class that calculates the blocklight and skylight of a single chunk
+
+/*
+Lighting is done on whole chunks. For each chunk to be lighted, the whole 3x3 chunk area around it is read,
+then it is processed, so that the middle chunk area has valid lighting.
+Lighting is calculated in full char arrays instead of nibbles, so that accessing the arrays is fast.
+Lighting is calculated in a flood-fill fashion:
+1. Generate seeds from where the light spreads (full skylight / light-emitting blocks)
+2. For each seed:
+	- Spread the light 1 block in each of the 6 cardinal directions, if the blocktype allows
+	- If the recipient block has had lower lighting value than that being spread, make it a new seed
+3. Repeat step 2, until there are no more seeds
+The seeds need two fast operations:
+	- Check if a block at [x, y, z] is already a seed
+	- Get the next seed in the row
+For that reason it is stored in two arrays, one stores a bool saying a seed is in that position,
+the other is an array of seed coords, encoded as a single int.
+Step 2 needs two separate storages for old seeds and new seeds, so there are two actual storages for that purpose,
+their content is swapped after each full step-2-cycle.
+
+The calculation doesn't touch any world; the chunk data is read through a callback, so that the lighting thread
+can read it from the world and the tools can read it from chunks they generated themselves.
+*/
+
+
+
+
+
+#pragma once
+
+#include "ChunkDef.h"
+
+
+
+
+
+// fwd: "ChunkDataCallback.h"
+class cChunkDataCallback;
+
+
+
+
+
+class cChunkLighter
+{
+public:
+
+	/** Provides the data of the specified chunk to the callback. Returns false if the chunk is not available. */
+	using cChunkDataGetter = std::function<bool(cChunkCoords a_Coords, cChunkDataCallback & a_Callback)>;
+
+	/** The buffers are several MiB in size, allocate the lighter on the heap. */
+	cChunkLighter(void);
+
+	/** Calculates the light of the specified chunk into a_BlockLight and a_SkyLight.
+	The 3x3 chunk area around the chunk is read through a_GetChunkData; the neighbors that are not available are treated as air. */
+	void Light(
+		cChunkCoords a_Coords,
+		const cChunkDataGetter & a_GetChunkData,
+		cChunkDef::BlockNibbles & a_BlockLight,
+		cChunkDef::BlockNibbles & a_SkyLight
+	);
+
+protected:
+
+	/** The highest block in the current 3x3 chunk data */
+	HEIGHTTYPE m_MaxHeight;
+
+	/** Number of Y layers, in whole sections, that the blocklight / skylight calculation works on.
+	Everything above is trivially lit - no blocks, no blocklight and full skylight - and is never seeded nor propagated into. */
+	int m_BlockLightTop;
+	int m_SkyLightTop;
+
+
+	// Buffers for the 3x3 chunk data
+	// These buffers alone are 1.7 MiB in size, therefore they cannot be located on the stack safely - some architectures may have only 1 MiB for stack, or even less
+	// The blobs are XZY organized as a whole, instead of 3x3 XZY-organized subarrays ->
+	//  -> This means data has to be scatterred when reading and gathered when writing!
+	static const int BlocksPerYLayer = cChunkDef::Width * cChunkDef::Width * 3 * 3;
+	BLOCKTYPE  m_BlockTypes[BlocksPerYLayer * cChunkDef::Height];
+	NIBBLETYPE m_BlockLight[BlocksPerYLayer * cChunkDef::Height];
+	NIBBLETYPE m_SkyLight  [BlocksPerYLayer * cChunkDef::Height];
+	HEIGHTTYPE m_HeightMap [BlocksPerYLayer];
+
+	// Seed management (5.7 MiB)
+	// Two buffers, in each calc step one is set as input and the other as output, then in the next step they're swapped
+	// Each seed is represented twice in this structure - both as a "list" and as a "position".
+	// "list" allows fast traversal from seed to seed
+	// "position" allows fast checking if a coord is already a seed
+	// The "position" buffers are all-zero between the calc steps, each step clears the input seeds it has processed
+	unsigned char m_IsSeed1 [BlocksPerYLayer * cChunkDef::Height];
+	unsigned int  m_SeedIdx1[BlocksPerYLayer * cChunkDef::Height];
+	unsigned char m_IsSeed2 [BlocksPerYLayer * cChunkDef::Height];
+	unsigned int  m_SeedIdx2[BlocksPerYLayer * cChunkDef::Height];
+	size_t m_NumSeeds;
+
+
+	/** Prepares m_BlockTypes and m_HeightMap data; calculates the light bounds and zeroes out the light arrays below them */
+	void ReadChunks(cChunkCoords a_Coords, const cChunkDataGetter & a_GetChunkData);
+
+	/** Uses m_HeightMap to initialize the m_SkyLight[] data; fills in seeds for the skylight */
+	void PrepareSkyLight(void);
+
+	/** Uses m_BlockTypes to initialize the m_BlockLight[] data; fills in seeds for the blocklight */
+	void PrepareBlockLight(void);
+
+	/** Calculates light in the light array specified, using stored seeds.
+	The light doesn't propagate to a_Top or above. */
+	void CalcLight(NIBBLETYPE * a_Light, int a_Top);
+
+	/** Does one step in the light calculation - one seed propagation and seed recalculation */
+	void CalcLightStep(
+		NIBBLETYPE * a_Light, int a_Top,
+		size_t a_NumSeedsIn,    unsigned char * a_IsSeedIn,  unsigned int * a_SeedIdxIn,
+		size_t & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
+	);
+
+	/** Compresses from 1-block-per-byte (faster calc) into 2-blocks-per-byte (MC storage).
+	The layers from a_Top up are filled with a_AboveTop instead of being read from a_LightArray. */
+	void CompressLight(NIBBLETYPE * a_LightArray, int a_Top, NIBBLETYPE a_AboveTop, NIBBLETYPE * a_ChunkLight);
+
+	void PropagateLight(
+		NIBBLETYPE * a_Light,
+		unsigned int a_SrcIdx, unsigned int a_DstIdx,
+		size_t & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
+	);
+};
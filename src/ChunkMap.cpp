@@ -28,8 +28,21 @@
 // cChunkMap:
 
 cChunkMap::cChunkMap(cWorld * a_World) :
-	m_World(a_World)
+	m_World(a_World),
+	m_IsTickingInParallel(false)
 {
+	// Contention on the chunkmap is reported by the chunkstats console command:
+	m_CSChunks.EnableStatistics();
+}
+
+
+
+
+
+cChunkMap::~cChunkMap()
+{
+	// Stop the tick workers before the chunks go away:
+	m_TickWorkers.reset();
 }
 
 
@@ -38,6 +51,9 @@ cChunkMap::cChunkMap(cWorld * a_World) :
 
 cChunk & cChunkMap::ConstructChunk(int a_ChunkX, int a_ChunkZ)
 {
+	// The tick workers hold pointers to the chunks and iterators; the chunks must be constructed in the merge phase instead, see DeferIfMissing():
+	ASSERT(!m_IsTickingInParallel || (FindChunk(a_ChunkX, a_ChunkZ) != nullptr));
+
 	// If not exists insert. Then, return the chunk at these coordinates:
 	return m_Chunks.try_emplace(
 		{ a_ChunkX, a_ChunkZ },
@@ -292,7 +308,7 @@ bool cChunkMap::GetChunkData(cChunkCoords a_Coords, cChunkDataCallback & a_Callb
 
 bool cChunkMap::IsChunkQueued(int a_ChunkX, int a_ChunkZ) const
 {
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(a_ChunkX, a_ChunkZ);
 	return (Chunk != nullptr) && Chunk->IsQueued();
 }
@@ -306,7 +322,7 @@ bool cChunkMap::IsWeatherSunnyAt(int a_BlockX, int a_BlockZ) const
 	int ChunkX, ChunkZ, BlockY = 0;
 	cChunkDef::AbsoluteToRelative(a_BlockX, BlockY, a_BlockZ, ChunkX, ChunkZ);
 
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(ChunkX, ChunkZ);
 	if ((Chunk == nullptr) || !Chunk->IsValid())
 	{
@@ -325,7 +341,7 @@ bool cChunkMap::IsWeatherWetAt(int a_BlockX, int a_BlockZ) const
 	int ChunkX, ChunkZ, BlockY = 0;
 	cChunkDef::AbsoluteToRelative(a_BlockX, BlockY, a_BlockZ, ChunkX, ChunkZ);
 
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(ChunkX, ChunkZ);
 	if ((Chunk == nullptr) || !Chunk->IsValid())
 	{
@@ -344,7 +360,7 @@ bool cChunkMap::IsWeatherWetAt(const Vector3i a_Position) const
 	const auto ChunkPosition = cChunkDef::BlockToChunk(a_Position);
 	const auto Position = cChunkDef::AbsoluteToRelative(a_Position, ChunkPosition);
 
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(ChunkPosition.m_ChunkX, ChunkPosition.m_ChunkZ);
 	if ((Chunk == nullptr) || !Chunk->IsValid())
 	{
@@ -360,7 +376,7 @@ bool cChunkMap::IsWeatherWetAt(const Vector3i a_Position) const
 
 bool cChunkMap::IsChunkValid(int a_ChunkX, int a_ChunkZ) const
 {
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(a_ChunkX, a_ChunkZ);
 	return (Chunk != nullptr) && Chunk->IsValid();
 }
@@ -371,7 +387,7 @@ bool cChunkMap::IsChunkValid(int a_ChunkX, int a_ChunkZ) const
 
 bool cChunkMap::HasChunkAnyClients(int a_ChunkX, int a_ChunkZ) const
 {
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(a_ChunkX, a_ChunkZ);
 	return (Chunk != nullptr) && Chunk->HasAnyClients();
 }
@@ -383,7 +399,7 @@ bool cChunkMap::HasChunkAnyClients(int a_ChunkX, int a_ChunkZ) const
 std::optional<int> cChunkMap::GetHeight(int a_BlockX, int a_BlockZ)
 {
 	// Returns std::nullopt if chunk not loaded / generated.
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	int ChunkX, ChunkZ, BlockY = 0;
 	cChunkDef::AbsoluteToRelative(a_BlockX, BlockY, a_BlockZ, ChunkX, ChunkZ);
 	const auto Chunk = FindChunk(ChunkX, ChunkZ);
@@ -460,7 +476,7 @@ BLOCKTYPE cChunkMap::GetBlock(Vector3i a_BlockPos) const
 	auto relPos = cChunkDef::AbsoluteToRelative(a_BlockPos, chunkPos);
 
 	// Query the chunk, if loaded:
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(chunkPos.m_ChunkX, chunkPos.m_ChunkZ);
 	if ((Chunk != nullptr) && Chunk->IsValid())
 	{
@@ -484,7 +500,7 @@ NIBBLETYPE cChunkMap::GetBlockMeta(Vector3i a_BlockPos) const
 	auto relPos = cChunkDef::AbsoluteToRelative(a_BlockPos, chunkPos);
 
 	// Query the chunk, if loaded:
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(chunkPos.m_ChunkX, chunkPos.m_ChunkZ);
 	if ((Chunk != nullptr) && Chunk->IsValid())
 	{
@@ -503,7 +519,7 @@ NIBBLETYPE cChunkMap::GetBlockSkyLight(Vector3i a_BlockPos) const
 	auto relPos = cChunkDef::AbsoluteToRelative(a_BlockPos, chunkPos);
 
 	// Query the chunk, if loaded:
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(chunkPos.m_ChunkX, chunkPos.m_ChunkZ);
 	if ((Chunk != nullptr) && Chunk->IsValid())
 	{
@@ -522,7 +538,7 @@ NIBBLETYPE cChunkMap::GetBlockBlockLight(Vector3i a_BlockPos) const
 	auto relPos = cChunkDef::AbsoluteToRelative(a_BlockPos, chunkPos);
 
 	// Query the chunk, if loaded:
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(chunkPos.m_ChunkX, chunkPos.m_ChunkZ);
 	if ((Chunk != nullptr) && Chunk->IsValid())
 	{
@@ -570,6 +586,35 @@ void cChunkMap::SetBlock(Vector3i a_BlockPos, BLOCKTYPE a_BlockType, NIBBLETYPE
 
 
 
+void cChunkMap::SetBlocks(const sSetBlockVector & a_Blocks)
+{
+	// Only sort a copy if the caller didn't already; the sort keeps the order of changes to the same block:
+	sSetBlockVector Sorted;
+	const auto * Blocks = &a_Blocks;
+	if (!SetBlockBatch::IsSortedByChunk(a_Blocks))
+	{
+		Sorted = a_Blocks;
+		SetBlockBatch::SortByChunk(Sorted);
+		Blocks = &Sorted;
+	}
+
+	cCSLock Lock(m_CSChunks);
+	for (auto itr = Blocks->begin(), end = Blocks->end(); itr != end;)
+	{
+		const auto ChunkEnd = SetBlockBatch::FindChunkEnd(itr, end);
+		const auto Chunk = FindChunk(itr->m_ChunkX, itr->m_ChunkZ);
+		if ((Chunk != nullptr) && Chunk->IsValid())
+		{
+			Chunk->SetBlocks(itr, ChunkEnd);
+		}
+		itr = ChunkEnd;
+	}
+}
+
+
+
+
+
 bool cChunkMap::GetBlockTypeMeta(Vector3i a_BlockPos, BLOCKTYPE & a_BlockType, NIBBLETYPE & a_BlockMeta) const
 {
 	if (!cChunkDef::IsValidHeight(a_BlockPos))
@@ -583,7 +628,7 @@ bool cChunkMap::GetBlockTypeMeta(Vector3i a_BlockPos, BLOCKTYPE & a_BlockType, N
 	auto chunkCoord = cChunkDef::BlockToChunk(a_BlockPos);
 	auto relPos = cChunkDef::AbsoluteToRelative(a_BlockPos, chunkCoord);
 
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(chunkCoord.m_ChunkX, chunkCoord.m_ChunkZ);
 	if ((Chunk != nullptr) && Chunk->IsValid())
 	{
@@ -607,7 +652,7 @@ bool cChunkMap::GetBlockInfo(Vector3i a_BlockPos, BLOCKTYPE & a_BlockType, NIBBL
 	auto relPos = cChunkDef::AbsoluteToRelative(a_BlockPos, chunkPos);
 
 	// Query the chunk, if loaded:
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(chunkPos.m_ChunkX, chunkPos.m_ChunkZ);
 	if ((Chunk != nullptr) && Chunk->IsValid())
 	{
@@ -661,7 +706,7 @@ EMCSBiome cChunkMap::GetBiomeAt(int a_BlockX, int a_BlockZ) const
 	int ChunkX, ChunkZ, X = a_BlockX, Y = 0, Z = a_BlockZ;
 	cChunkDef::AbsoluteToRelative(X, Y, Z, ChunkX, ChunkZ);
 
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(ChunkX, ChunkZ);
 	if ((Chunk != nullptr) && Chunk->IsValid())
 	{
@@ -1118,6 +1163,10 @@ void cChunkMap::PrepareChunk(int a_ChunkX, int a_ChunkZ, std::unique_ptr<cChunkC
 void cChunkMap::GenerateChunk(int a_ChunkX, int a_ChunkZ)
 {
 	cCSLock Lock(m_CSChunks);
+	if (DeferIfMissing(a_ChunkX, a_ChunkZ, [this, a_ChunkX, a_ChunkZ]() { GenerateChunk(a_ChunkX, a_ChunkZ); }))
+	{
+		return;
+	}
 	GetChunk(a_ChunkX, a_ChunkZ);  // Touches the chunk, loading or generating it
 }
 
@@ -1140,6 +1189,10 @@ void cChunkMap::ChunkLoadFailed(int a_ChunkX, int a_ChunkZ)
 void cChunkMap::MarkChunkRegenerating(int a_ChunkX, int a_ChunkZ)
 {
 	cCSLock Lock(m_CSChunks);
+	if (DeferIfMissing(a_ChunkX, a_ChunkZ, [this, a_ChunkX, a_ChunkZ]() { MarkChunkRegenerating(a_ChunkX, a_ChunkZ); }))
+	{
+		return;
+	}
 	ConstructChunk(a_ChunkX, a_ChunkZ).MarkRegenerating();
 }
 
@@ -1149,7 +1202,7 @@ void cChunkMap::MarkChunkRegenerating(int a_ChunkX, int a_ChunkZ)
 
 bool cChunkMap::IsChunkLighted(int a_ChunkX, int a_ChunkZ)
 {
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	const auto Chunk = FindChunk(a_ChunkX, a_ChunkZ);
 	if (Chunk == nullptr)
 	{
@@ -1254,7 +1307,7 @@ void cChunkMap::GetChunkStats(int & a_NumChunksValid, int & a_NumChunksDirty) co
 {
 	a_NumChunksValid = 0;
 	a_NumChunksDirty = 0;
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	for (const auto & Chunk : m_Chunks)
 	{
 		a_NumChunksValid++;
@@ -1343,18 +1396,44 @@ void cChunkMap::Tick(std::chrono::milliseconds a_Dt)
 {
 	cCSLock Lock(m_CSChunks);
 
-	// Do the magic of updating the world:
+	// Ticking may construct chunks (an entity moving into an unloaded chunk), which may rehash m_Chunks and
+	// invalidate its iterators. The chunks themselves never move, so tick them through a list of pointers:
+	cChunkTickWorkers<cChunk>::cChunks ChunksToTick;
+	ChunksToTick.reserve(m_Chunks.size());
 	for (auto & Chunk : m_Chunks)
 	{
 		if (Chunk.second.ShouldBeTicked())
 		{
-			Chunk.second.Tick(a_Dt);
+			ChunksToTick.emplace_back(Chunk.first, &Chunk.second);
+		}
+	}
+
+	// Do the magic of updating the world:
+	if (m_TickWorkers != nullptr)
+	{
+		TickInParallel(ChunksToTick, a_Dt);
+	}
+	else
+	{
+		for (const auto & Chunk : ChunksToTick)
+		{
+			Chunk.second->Tick(a_Dt);
 		}
 	}
 
-	// Finally, only after all chunks are ticked, tell the client about all aggregated changes:
+	// Finally, only after all chunks are ticked, update the light around the changed blocks and tell the client about all aggregated changes:
 	for (auto & Chunk : m_Chunks)
 	{
+		auto & LightChanges = Chunk.second.m_PendingLightChanges;
+		if (!LightChanges.empty())
+		{
+			if (!RelightChanges(Chunk.second))
+			{
+				// Some neighbor isn't ready, relight the whole chunk once it is:
+				Chunk.second.m_IsLightValid = false;
+			}
+			LightChanges.clear();
+		}
 		Chunk.second.BroadcastPendingChanges();
 	}
 }
@@ -1363,6 +1442,129 @@ void cChunkMap::Tick(std::chrono::milliseconds a_Dt)
 
 
 
+bool cChunkMap::RelightChanges(cChunk & a_Chunk)
+{
+	cIncrementalLighting::cNeighborhood Chunks;
+	for (size_t x = 0; x < 3; x++)
+	{
+		for (size_t z = 0; z < 3; z++)
+		{
+			const auto Neighbor = a_Chunk.m_Neighbors[x][z];
+			if ((Neighbor == nullptr) || !Neighbor->IsValid() || !Neighbor->IsLightValid())
+			{
+				return false;
+			}
+			Chunks[x][z] = { &Neighbor->m_BlockData, &Neighbor->m_LightData, false };
+		}
+	}
+
+	if (!m_IncrementalLighting.Relight(Chunks, a_Chunk.m_PendingLightChanges))
+	{
+		return false;
+	}
+
+	for (size_t x = 0; x < 3; x++)
+	{
+		for (size_t z = 0; z < 3; z++)
+		{
+			if (Chunks[x][z].m_IsChanged)
+			{
+				a_Chunk.m_Neighbors[x][z]->MarkDirty();
+			}
+		}
+	}
+	return true;
+}
+
+
+
+
+
+void cChunkMap::SetNumTickThreads(unsigned a_NumThreads)
+{
+	cCSLock Lock(m_CSChunks);
+	if (a_NumThreads <= 1)
+	{
+		m_TickWorkers.reset();
+		return;
+	}
+	m_TickWorkers = std::make_unique<cChunkTickWorkers<cChunk>>(m_CSChunks, a_NumThreads);
+}
+
+
+
+
+
+void cChunkMap::TickInParallel(const cChunkTickWorkers<cChunk>::cChunks & a_Chunks, std::chrono::milliseconds a_Dt)
+{
+	ASSERT(m_CSChunks.IsLockedByCurrentThread());
+
+	m_IsTickingInParallel = true;
+	m_TickWorkers->Tick(a_Chunks, a_Dt);
+	m_IsTickingInParallel = false;
+
+	// Merge phase: move the entities that changed chunks into their new chunks, then apply the deferred chunkmap changes.
+	// Either may construct chunks now that no worker holds any pointers:
+	for (auto & Move : m_DeferredEntityMoves)
+	{
+		Move.first->MoveEntityToNewChunk(std::move(Move.second));
+	}
+	m_DeferredEntityMoves.clear();
+
+	// The changes may defer nothing anymore, but may still add more changes to the list (in theory), hence the index loop:
+	for (size_t i = 0; i < m_DeferredChanges.size(); i++)
+	{
+		auto Change = std::move(m_DeferredChanges[i]);
+		Change();
+	}
+	m_DeferredChanges.clear();
+}
+
+
+
+
+
+void cChunkMap::AccessFarChunks(void)
+{
+	if (m_IsTickingInParallel)
+	{
+		// Locking the borrowed CS makes this thread run alone until it finishes ticking its current chunk:
+		cCSLock Lock(m_CSChunks);
+	}
+}
+
+
+
+
+
+void cChunkMap::DeferEntityMove(cChunk & a_Chunk, OwnedEntity a_Entity)
+{
+	ASSERT(m_IsTickingInParallel);
+
+	std::scoped_lock Lock(m_CSDeferred);
+	m_DeferredEntityMoves.emplace_back(&a_Chunk, std::move(a_Entity));
+}
+
+
+
+
+
+bool cChunkMap::DeferIfMissing(int a_ChunkX, int a_ChunkZ, std::function<void()> a_Change)
+{
+	if (!m_IsTickingInParallel || (FindChunk(a_ChunkX, a_ChunkZ) != nullptr))
+	{
+		return false;
+	}
+
+	std::scoped_lock Lock(m_CSDeferred);
+	m_DeferredChanges.push_back(std::move(a_Change));
+	return true;
+}
+
+
+
+
+
 void cChunkMap::TickBlock(const Vector3i a_BlockPos)
 {
 	auto ChunkPos = cChunkDef::BlockToChunk(a_BlockPos);
@@ -1396,6 +1598,9 @@ void cChunkMap::UnloadUnusedChunks(void)
 			// Notify entities within the chunk, while everything's still valid:
 			itr->second.OnUnload();
 
+			// Let the storage keep the chunk's data around, in case the chunk is needed again soon:
+			m_World->GetStorage().ChunkUnloaded(itr->first);
+
 			// Kill the chunk:
 			itr = m_Chunks.erase(itr);
 		}
@@ -1428,7 +1633,7 @@ void cChunkMap::SaveAllChunks(void) const
 
 size_t cChunkMap::GetNumChunks(void) const
 {
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	return m_Chunks.size();
 }
 
@@ -1438,7 +1643,7 @@ size_t cChunkMap::GetNumChunks(void) const
 
 size_t cChunkMap::GetNumUnusedDirtyChunks(void) const
 {
-	cCSLock Lock(m_CSChunks);
+	cCSSharedLock Lock(m_CSChunks);
 	size_t res = 0;
 	for (const auto & Chunk : m_Chunks)
 	{
@@ -1466,6 +1671,10 @@ void cChunkMap::ChunkValidated(void)
 void cChunkMap::SetChunkAlwaysTicked(int a_ChunkX, int a_ChunkZ, bool a_AlwaysTicked)
 {
 	cCSLock Lock(m_CSChunks);
+	if (DeferIfMissing(a_ChunkX, a_ChunkZ, [this, a_ChunkX, a_ChunkZ, a_AlwaysTicked]() { SetChunkAlwaysTicked(a_ChunkX, a_ChunkZ, a_AlwaysTicked); }))
+	{
+		return;
+	}
 	GetChunk(a_ChunkX, a_ChunkZ).SetAlwaysTicked(a_AlwaysTicked);
 }
 
@@ -1495,6 +1704,18 @@ void cChunkMap::AddChunkStay(cChunkStay & a_ChunkStay)
 {
 	cCSLock Lock(m_CSChunks);
 
+	// During a parallel tick, the chunks must exist already, or the whole chunkstay waits for the merge phase:
+	if (m_IsTickingInParallel)
+	{
+		for (const auto & Coords : a_ChunkStay.GetChunks())
+		{
+			if (DeferIfMissing(Coords.m_ChunkX, Coords.m_ChunkZ, [this, &a_ChunkStay]() { AddChunkStay(a_ChunkStay); }))
+			{
+				return;
+			}
+		}
+	}
+
 	// Add it to the list:
 	ASSERT(std::find(m_ChunkStays.begin(), m_ChunkStays.end(), &a_ChunkStay) == m_ChunkStays.end());  // Has not yet been added
 	m_ChunkStays.push_back(&a_ChunkStay);
@@ -8,8 +8,10 @@
 #include <optional>
 
 #include "ChunkDataCallback.h"
+#include "ChunkTickWorkers.h"
 #include "EffectID.h"
 #include "FunctionRef.h"
+#include "IncrementalLighting.h"
 
 
 
@@ -41,6 +43,7 @@ class cChunkMap
 public:
 
 	cChunkMap(cWorld * a_World);
+	~cChunkMap();
 
 	/** Sends the block entity, if it is at the coords specified, to a_Client */
 	void SendBlockEntity(int a_BlockX, int a_BlockY, int a_BlockZ, cClientHandle & a_Client);
@@ -83,6 +86,7 @@ public:
 	);
 
 	/** Calls the callback with the chunk's data, if available (with ChunkCS locked).
+	The CS is locked exclusively, the callback gets mutable pointers to the entities and block entities.
 	Returns true if the chunk was reported successfully, false if not (chunk not present or callback failed). */
 	bool GetChunkData(cChunkCoords a_Coords, cChunkDataCallback & a_Callback) const;
 
@@ -117,6 +121,11 @@ public:
 	void SetBlockMeta(Vector3i a_BlockPos, NIBBLETYPE a_BlockMeta);
 
 	void SetBlock          (Vector3i a_BlockPos, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta);
+
+	/** Sets all the specified blocks, with the same processing as SetBlock().
+	The changes are grouped by chunk, so that each chunk is looked up once under a single lock.
+	Of several changes to the same block only the last one is applied. Blocks in chunks that aren't valid are ignored. */
+	void SetBlocks(const sSetBlockVector & a_Blocks);
 	/** Get the block type and meta at the specified coords
 	Will always initialise a_BlockType and a_BlockMeta if called.
 	Returns false if the data could not be retrieved, either because the chunk is invalid or the height is invalid.
@@ -259,6 +268,18 @@ public:
 
 	void Tick(std::chrono::milliseconds a_Dt);
 
+	/** Sets the number of threads that tick the chunks in Tick().
+	With a single thread (the default), all chunks are ticked serially in the calling thread.
+	With more threads, the chunks are grouped into 2x2-chunk regions that are coloured in a checkerboard pattern,
+	and all regions of a single colour are ticked in parallel, so that no two neighbouring chunks are ever ticked at the same time.
+	A chunk tick that locks the chunkmap, or reaches beyond the directly neighbouring chunks, runs alone until that chunk is ticked.
+	Chunks are never constructed while the workers run; the changes that need a chunk that doesn't exist yet are deferred till all are ticked. */
+	void SetNumTickThreads(unsigned a_NumThreads);
+
+	/** Returns true while Tick() is ticking chunks in multiple threads.
+	Effects that can reach farther than a neighbouring chunk must lock the chunkmap or call AccessFarChunks() first while this is set. */
+	bool IsTickingInParallel(void) const { return m_IsTickingInParallel; }
+
 	/** Ticks a single block. Used by cWorld::TickQueuedBlocks() to tick the queued blocks */
 	void TickBlock(const Vector3i a_BlockPos);
 
@@ -274,7 +295,8 @@ public:
 
 	void ChunkValidated(void);  // Called by chunks that have become valid
 
-	/** Returns the CS for locking the chunkmap; only cWorld::cLock may use this function! */
+	/** Returns the CS for locking the chunkmap; only cWorld::cLock may use this function for locking!
+	The read-only queries that run no callbacks lock it shared, so that the generator, lighting, sender and storage threads don't block each other. */
 	cCriticalSection & GetCS(void) const { return m_CSChunks; }
 
 	/** Increments (a_AlwaysTicked == true) or decrements (false) the m_AlwaysTicked counter for the specified chunk.
@@ -302,9 +324,13 @@ private:
 
 	mutable cCriticalSection m_CSChunks;
 
-	/** A map of chunk coordinates to chunks.
-	Uses a map (as opposed to unordered_map) because sorted maps are apparently faster. */
-	std::map<cChunkCoords, cChunk> m_Chunks;
+	/** A hash map of chunk coordinates to chunks.
+	This used to be a map (as opposed to unordered_map) because sorted maps were apparently faster; with the neighbors cached
+	in each chunk, the remaining lookups are mostly for far-away chunks, where hashing wins.
+	Chunks never move once constructed, so the pointers cached by their neighbors stay valid, but unlike with a map,
+	constructing a chunk may rehash and invalidate the iterators. Loops that may construct chunks (ticking) must not
+	iterate the map directly. */
+	std::unordered_map<cChunkCoords, cChunk, cChunkCoordsHash> m_Chunks;
 
 	cEvent m_evtChunkValid;  // Set whenever any chunk becomes valid, via ChunkValidated()
 
@@ -313,6 +339,27 @@ private:
 	/** The cChunkStay descendants that are currently enabled in this chunkmap */
 	cChunkStays m_ChunkStays;
 
+	/** Updates the light around the blocks changed during a tick. Used only with m_CSChunks locked. */
+	cIncrementalLighting m_IncrementalLighting;
+
+	/** The worker threads for parallel chunk ticking.
+	nullptr if the chunks are ticked serially in the tick thread. */
+	std::unique_ptr<cChunkTickWorkers<cChunk>> m_TickWorkers;
+
+	/** Set while the chunks are being ticked by m_TickWorkers. */
+	bool m_IsTickingInParallel;
+
+	/** Protects m_DeferredEntityMoves and m_DeferredChanges while the chunks are being ticked in parallel. */
+	std::mutex m_CSDeferred;
+
+	/** Entities that moved out of their chunk during a parallel tick, together with the chunk they are leaving.
+	Moved into their new chunks in the merge phase of Tick(). */
+	std::vector<std::pair<cChunk *, OwnedEntity>> m_DeferredEntityMoves;
+
+	/** The chunkmap changes that needed to construct a chunk during a parallel tick, see DeferIfMissing().
+	Applied in the merge phase of Tick(). */
+	std::vector<std::function<void()>> m_DeferredChanges;
+
 	/** Returns or creates and returns a chunk pointer corresponding to the given chunk coordinates.
 	Emplaces this chunk in the chunk map. */
 	cChunk & ConstructChunk(int a_ChunkX, int a_ChunkZ);
@@ -326,6 +373,27 @@ private:
 	/** Locates a chunk ptr in the chunkmap; doesn't create it when not found; assumes m_CSChunks is locked. To be called only from cChunkMap. */
 	const cChunk * FindChunk(int a_ChunkX, int a_ChunkZ) const;
 
+	/** Updates the light around the chunk's pending light changes using m_IncrementalLighting, marks the chunks whose light changed dirty.
+	Returns false if any of the 3x3 chunks around it isn't valid and lit, or there are too many changes; the whole chunk needs relighting then.
+	Assumes m_CSChunks is locked. */
+	bool RelightChanges(cChunk & a_Chunk);
+
+	/** Ticks the specified chunks in parallel, using m_TickWorkers.
+	Processes the deferred cross-region effects and chunkmap changes afterwards. Assumes m_CSChunks is locked. */
+	void TickInParallel(const cChunkTickWorkers<cChunk>::cChunks & a_Chunks, std::chrono::milliseconds a_Dt);
+
+	/** Called by a chunk being ticked before it accesses chunks beyond its direct neighbours without locking the chunkmap.
+	During a parallel tick, waits until the other ticking threads finish their current chunks and keeps them waiting until the current chunk is ticked. */
+	void AccessFarChunks(void);
+
+	/** Stores an entity that has left a_Chunk during a parallel tick, to be moved into its new chunk in the merge phase. */
+	void DeferEntityMove(cChunk & a_Chunk, OwnedEntity a_Entity);
+
+	/** If the chunks are being ticked in parallel and the specified chunk doesn't exist, stores a_Change to be applied in the merge phase
+	and returns true; constructing the chunk could rehash m_Chunks and relink the neighbor pointers that the tick workers are using.
+	Otherwise returns false, and the caller should apply the change itself. Assumes m_CSChunks is locked. */
+	bool DeferIfMissing(int a_ChunkX, int a_ChunkZ, std::function<void()> a_Change);
+
 	/** Adds a new cChunkStay descendant to the internal list of ChunkStays; loads its chunks.
 	To be used only by cChunkStay; others should use cChunkStay::Enable() instead */
 	void AddChunkStay(cChunkStay & a_ChunkStay);
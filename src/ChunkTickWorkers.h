@@ -0,0 +1,203 @@
+
+// ChunkTickWorkers.h
+
+// Declares the cChunkTickWorkers class template that ticks chunks in a pool of threads, used by cChunkMap
+
+#pragma once
+
+#include "ChunkDef.h"
+
+
+
+
+
+/** A pool of threads that tick chunks on behalf of the world tick thread.
+The chunks are grouped into 2x2-chunk regions that are coloured in a 2x2 checkerboard pattern; all the regions of a single colour
+are ticked in parallel, each region by a single thread, and the colours one after another.
+Regions of the same colour are separated by at least one region (two chunks) of a different colour,
+so a chunk ticked in one of them may touch its direct neighbours without racing another thread.
+The tick thread holds the chunkmap CS for the whole duration and lends it to the workers and itself. Anything that reaches further
+goes through the CS, which makes the worker run alone until it finishes ticking that chunk.
+The chunks must not be added to or removed from the chunkmap while the workers run.
+A template only so that the scheduling can be tested without a world; ChunkType needs a Tick(std::chrono::milliseconds) function. */
+template <class ChunkType>
+class cChunkTickWorkers
+{
+public:
+
+	/** The chunks to be ticked, with their coords. */
+	using cChunks = std::vector<std::pair<cChunkCoords, ChunkType *>>;
+
+
+	/** Creates the worker threads; the thread calling Tick() is one of the a_NumThreads. */
+	cChunkTickWorkers(cCriticalSection & a_CS, unsigned a_NumThreads) :
+		m_CS(a_CS),
+		m_Groups(nullptr),
+		m_NextGroup(0),
+		m_NumBusy(0),
+		m_Generation(0),
+		m_ShouldTerminate(false)
+	{
+		for (unsigned i = 1; i < a_NumThreads; i++)
+		{
+			m_Threads.emplace_back(&cChunkTickWorkers::Execute, this);
+		}
+	}
+
+
+	~cChunkTickWorkers()
+	{
+		{
+			std::scoped_lock Lock(m_Mutex);
+			m_ShouldTerminate = true;
+		}
+		m_WorkAvailable.notify_all();
+		for (auto & Thread : m_Threads)
+		{
+			Thread.join();
+		}
+	}
+
+
+	/** Ticks all the chunks, using the worker threads and the calling thread.
+	The calling thread must hold the CS. Returns once all the chunks have been ticked. */
+	void Tick(const cChunks & a_Chunks, std::chrono::milliseconds a_Dt)
+	{
+		ASSERT(m_CS.IsLockedByCurrentThread());
+
+		// Group the chunks into 2x2-chunk regions:
+		std::unordered_map<cChunkCoords, cChunkGroup, cChunkCoordsHash> Regions;
+		for (const auto & Chunk : a_Chunks)
+		{
+			Regions[{ FAST_FLOOR_DIV(Chunk.first.m_ChunkX, 2), FAST_FLOOR_DIV(Chunk.first.m_ChunkZ, 2) }].push_back(Chunk.second);
+		}
+
+		// Colour the regions:
+		std::array<std::vector<cChunkGroup *>, 4> Colours;
+		for (auto & Region : Regions)
+		{
+			const auto Colour = static_cast<size_t>((Region.first.m_ChunkX & 1) | ((Region.first.m_ChunkZ & 1) << 1));
+			Colours[Colour].push_back(&Region.second);
+		}
+
+		for (const auto & Colour : Colours)
+		{
+			TickGroups(Colour, a_Dt);
+		}
+	}
+
+private:
+
+	using cChunkGroup = std::vector<ChunkType *>;
+
+	/** The CS protecting the chunks, held by the tick thread and lent to the workers. */
+	cCriticalSection & m_CS;
+
+	std::vector<std::thread> m_Threads;
+
+	/** Protects the members describing the current work item against multithreaded access. */
+	std::mutex m_Mutex;
+
+	/** Signalled when a new batch of groups is available, or the workers should terminate. */
+	std::condition_variable m_WorkAvailable;
+
+	/** Signalled when the last worker has finished the current batch. */
+	std::condition_variable m_WorkDone;
+
+	/** The groups in the batch currently being ticked. */
+	const std::vector<cChunkGroup *> * m_Groups;
+
+	/** The time to tick the chunks by. */
+	std::chrono::milliseconds m_Dt;
+
+	/** Index into m_Groups of the next group to be picked up by a thread. */
+	std::atomic<size_t> m_NextGroup;
+
+	/** Number of worker threads that haven't finished the current batch yet. */
+	size_t m_NumBusy;
+
+	/** Incremented with each new batch, so that the workers can tell a new batch from a spurious wakeup. */
+	unsigned m_Generation;
+
+	bool m_ShouldTerminate;
+
+
+	/** Ticks all chunks in the specified groups, using the worker threads and the calling thread.
+	Each group is ticked by a single thread, different groups must not touch each other's chunks.
+	Returns once all the groups have been ticked. */
+	void TickGroups(const std::vector<cChunkGroup *> & a_Groups, std::chrono::milliseconds a_Dt)
+	{
+		if (a_Groups.empty())
+		{
+			return;
+		}
+
+		{
+			std::scoped_lock Lock(m_Mutex);
+			m_Groups = &a_Groups;
+			m_Dt = a_Dt;
+			m_NextGroup = 0;
+			m_NumBusy = m_Threads.size();
+			m_Generation += 1;
+		}
+		m_WorkAvailable.notify_all();
+
+		m_CS.BorrowFromOwner();
+		TickAvailableGroups();
+		m_CS.ReturnToOwner();
+
+		std::unique_lock Lock(m_Mutex);
+		m_WorkDone.wait(Lock, [this] { return m_NumBusy == 0; });
+		m_Groups = nullptr;
+	}
+
+
+	/** The worker thread's main loop. */
+	void Execute()
+	{
+		unsigned LastGeneration = 0;
+		std::unique_lock Lock(m_Mutex);
+		for (;;)
+		{
+			m_WorkAvailable.wait(Lock, [this, LastGeneration] { return m_ShouldTerminate || (m_Generation != LastGeneration); });
+			if (m_ShouldTerminate)
+			{
+				return;
+			}
+			LastGeneration = m_Generation;
+
+			Lock.unlock();
+			m_CS.BorrowFromOwner();
+			TickAvailableGroups();
+			m_CS.ReturnToOwner();
+			Lock.lock();
+
+			m_NumBusy -= 1;
+			if (m_NumBusy == 0)
+			{
+				m_WorkDone.notify_one();
+			}
+		}
+	}
+
+
+	/** Picks up groups from the current batch and ticks them, until there are none left. */
+	void TickAvailableGroups()
+	{
+		for (;;)
+		{
+			const auto Index = m_NextGroup++;
+			if (Index >= m_Groups->size())
+			{
+				return;
+			}
+			for (auto Chunk : *(*m_Groups)[Index])
+			{
+				Chunk->Tick(m_Dt);
+
+				// The chunk is done, no pointers obtained while running alone are used anymore:
+				m_CS.YieldToBorrowers();
+			}
+		}
+	}
+};
@@ -175,9 +175,10 @@ void cDeadlockDetect::ListTrackedCSs(void)
 	cCSLock lock(m_CS);
 	for (const auto & cs: m_TrackedCriticalSections)
 	{
-		LOG("CS at %p, %s: RecursionCount = %d, ThreadIDHash = %04llx",
+		LOG("CS at %p, %s: RecursionCount = %d, ThreadIDHash = %04llx, SharedHolders = %d",
 			static_cast<void *>(cs.first), cs.second.c_str(),
-			cs.first->m_RecursionCount, static_cast<UInt64>(std::hash<std::thread::id>()(cs.first->m_OwningThreadID))
+			cs.first->m_RecursionCount, static_cast<UInt64>(std::hash<std::thread::id>()(cs.first->m_OwningThreadID.load())),
+			cs.first->m_NumSharedHolders.load()
 		);
 	}
 }
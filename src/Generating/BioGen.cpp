@@ -56,19 +56,12 @@ void cBioGenConstant::InitializeBiomeGen(cIniFile & a_IniFile)
 ////////////////////////////////////////////////////////////////////////////////
 // cBioGenCache:
 
-cBioGenCache::cBioGenCache(cBiomeGen & a_BioGenToCache, size_t a_CacheSize) :
-	m_BioGenToCache(a_BioGenToCache),
-	m_CacheSize(a_CacheSize),
-	m_NumHits(0),
-	m_NumMisses(0),
-	m_TotalChain(0)
+cBioGenCache::cBioGenCache(std::unique_ptr<cBiomeGen> a_BioGenToCache, std::shared_ptr<cBiomeMapCache> a_Cache) :
+	m_BioGenToCache(std::move(a_BioGenToCache)),
+	m_Cache(std::move(a_Cache))
 {
-	m_CacheData.resize(m_CacheSize);
-	m_CacheOrder.resize(m_CacheSize);
-	for (size_t i = 0; i < m_CacheSize; i++)
-	{
-		m_CacheOrder[i] = i;
-	}
+	ASSERT(m_BioGenToCache != nullptr);
+	ASSERT(m_Cache != nullptr);
 }
 
 
@@ -77,49 +70,14 @@ cBioGenCache::cBioGenCache(cBiomeGen & a_BioGenToCache, size_t a_CacheSize) :
 
 void cBioGenCache::GenBiomes(cChunkCoords a_ChunkCoords, cChunkDef::BiomeMap & a_BiomeMap)
 {
-	if (((m_NumHits + m_NumMisses) % 1024) == 10)
-	{
-		// LOGD("BioGenCache: %u hits, %u misses, saved %.2f %%", static_cast<unsigned>(m_NumHits), static_cast<unsigned>(m_NumMisses), 100.0 * m_NumHits / (m_NumHits + m_NumMisses));
-		// LOGD("BioGenCache: Avg cache chain length: %.2f", static_cast<double>(m_TotalChain) / m_NumHits);
-	}
-
-	for (size_t i = 0; i < m_CacheSize; i++)
+	if (m_Cache->Get(a_ChunkCoords, a_BiomeMap))
 	{
-		if (m_CacheData[m_CacheOrder[i]].m_Coords != a_ChunkCoords)
-		{
-			continue;
-		}
-		// Found it in the cache
-		size_t Idx = m_CacheOrder[i];
-
-		// Move to front:
-		for (size_t j = i; j > 0; j--)
-		{
-			m_CacheOrder[j] = m_CacheOrder[j - 1];
-		}
-		m_CacheOrder[0] = Idx;
-
-		// Use the cached data:
-		memcpy(a_BiomeMap, m_CacheData[Idx].m_BiomeMap, sizeof(a_BiomeMap));
-
-		m_NumHits++;
-		m_TotalChain += i;
 		return;
-	}  // for i - cache
-
-	// Not in the cache:
-	m_NumMisses++;
-	m_BioGenToCache.GenBiomes(a_ChunkCoords, a_BiomeMap);
+	}
 
-	// Insert it as the first item in the MRU order:
-	size_t Idx = m_CacheOrder[m_CacheSize - 1];
-	for (size_t i = m_CacheSize - 1; i > 0; i--)
-	{
-		m_CacheOrder[i] = m_CacheOrder[i - 1];
-	}  // for i - m_CacheOrder[]
-	m_CacheOrder[0] = Idx;
-	memcpy(m_CacheData[Idx].m_BiomeMap, a_BiomeMap, sizeof(a_BiomeMap));
-	m_CacheData[Idx].m_Coords = a_ChunkCoords;
+	// Not in the cache, generate and store:
+	m_BioGenToCache->GenBiomes(a_ChunkCoords, a_BiomeMap);
+	m_Cache->Put(a_ChunkCoords, a_BiomeMap);
 }
 
 
@@ -129,48 +87,7 @@ void cBioGenCache::GenBiomes(cChunkCoords a_ChunkCoords, cChunkDef::BiomeMap & a
 void cBioGenCache::InitializeBiomeGen(cIniFile & a_IniFile)
 {
 	Super::InitializeBiomeGen(a_IniFile);
-	m_BioGenToCache.InitializeBiomeGen(a_IniFile);
-}
-
-
-
-
-////////////////////////////////////////////////////////////////////////////////
-// cBioGenMulticache:
-
-cBioGenMulticache::cBioGenMulticache(std::unique_ptr<cBiomeGen> a_BioGenToCache, size_t a_SubCacheSize, size_t a_NumSubCaches) :
-	m_NumSubCaches(a_NumSubCaches),
-	m_Underlying(std::move(a_BioGenToCache))
-{
-	m_Caches.reserve(a_NumSubCaches);
-	for (size_t i = 0; i < a_NumSubCaches; i++)
-	{
-		m_Caches.push_back(std::make_unique<cBioGenCache>(*m_Underlying, a_SubCacheSize));
-	}
-}
-
-
-
-
-
-void cBioGenMulticache::GenBiomes(cChunkCoords a_ChunkCoords, cChunkDef::BiomeMap & a_BiomeMap)
-{
-	const size_t coefficient = 3;
-	const size_t cacheIdx = (static_cast<size_t>(a_ChunkCoords.m_ChunkX) + coefficient * static_cast<size_t>(a_ChunkCoords.m_ChunkZ)) % m_NumSubCaches;
-
-	m_Caches[cacheIdx]->GenBiomes(a_ChunkCoords, a_BiomeMap);
-}
-
-
-
-
-
-void cBioGenMulticache::InitializeBiomeGen(cIniFile & a_IniFile)
-{
-	for (auto & itr : m_Caches)
-	{
-		itr->InitializeBiomeGen(a_IniFile);
-	}
+	m_BioGenToCache->InitializeBiomeGen(a_IniFile);
 }
 
 
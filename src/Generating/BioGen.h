@@ -15,6 +15,7 @@ Interfaces to the various biome generators:
 #pragma once
 
 #include "ComposableGenerator.h"
+#include "ChunkDataCache.h"
 #include "../Noise/Noise.h"
 #include "../VoronoiMap.h"
 
@@ -42,6 +43,9 @@ protected:
 
 
 /** A simple cache that stores N most recently generated chunks' biomes; N being settable upon creation */
+/** Caches the biomes of another generator in a cBiomeMapCache.
+The cache may be shared by several generators' instances (created from the same settings) in different threads;
+the underlying generator is used only by the thread that owns this object. */
 class cBioGenCache:
 	public cBiomeGen
 {
@@ -49,71 +53,19 @@ class cBioGenCache:
 
 public:
 
-	cBioGenCache(cBiomeGen & a_BioGenToCache, size_t a_CacheSize);
+	cBioGenCache(std::unique_ptr<cBiomeGen> a_BioGenToCache, std::shared_ptr<cBiomeMapCache> a_Cache);
 
 protected:
 
-	friend class cBioGenMulticache;
-
-	cBiomeGen & m_BioGenToCache;
-
-	struct sCacheData
-	{
-		cChunkCoords m_Coords;
-		cChunkDef::BiomeMap m_BiomeMap;
-
-		/** Default constructor: Fill in bogus coords so that the item is not used in the cache until properly calculated. */
-		sCacheData():
-			m_Coords(0x7fffffff, 0x7fffffff)
-		{
-		}
-	} ;
-
-	// To avoid moving large amounts of data for the MRU behavior, we MRU-ize indices to an array of the actual data
-	size_t                  m_CacheSize;
-	std::vector<size_t>     m_CacheOrder;  // MRU-ized order, indices into m_CacheData array
-	std::vector<sCacheData> m_CacheData;   // m_CacheData[m_CacheOrder[0]] is the most recently used
-
-	// Cache statistics
-	size_t m_NumHits;
-	size_t m_NumMisses;
-	size_t m_TotalChain;  // Number of cache items walked to get to a hit (only added for hits)
-
-	virtual void GenBiomes(cChunkCoords a_ChunkCoords, cChunkDef::BiomeMap & a_BiomeMap) override;
-	virtual void InitializeBiomeGen(cIniFile & a_IniFile) override;
-} ;
-
-
-
-
-
-class cBioGenMulticache:
-	public cBiomeGen
-{
-	using Super = cBiomeGen;
-
-public:
-	/* Creates a new multicache - a cache that divides the caching into several sub-caches based on the chunk coords.
-	This allows us to use shorter cache depths with faster lookups for more covered area. (#381)
-	a_SubCacheSize defines the size of each sub-cache
-	a_NumSubCaches defines how many sub-caches are used for the multicache. */
-	cBioGenMulticache(std::unique_ptr<cBiomeGen> a_BioGenToCache, size_t a_SubCacheSize, size_t a_NumSubCaches);
-
-protected:
-
-	/** Number of sub-caches. Pulled out of m_Caches.size() for faster access. */
-	size_t m_NumSubCaches;
-
-	/** Individual sub-caches. */
-	std::vector<std::unique_ptr<cBioGenCache>> m_Caches;
-
 	/** The underlying biome generator. */
-	std::unique_ptr<cBiomeGen> m_Underlying;
+	std::unique_ptr<cBiomeGen> m_BioGenToCache;
 
+	/** The cache storing the generated biomes. */
+	std::shared_ptr<cBiomeMapCache> m_Cache;
 
 	virtual void GenBiomes(cChunkCoords a_ChunkCoords, cChunkDef::BiomeMap & a_BiomeMap) override;
 	virtual void InitializeBiomeGen(cIniFile & a_IniFile) override;
-};
+} ;
 
 
 
@@ -0,0 +1,84 @@
+
+// ChunkDataCache.cpp
+
+// Implements the cGeneratorCaches class that holds the caches and the read-only data shared by all generators of a single world
+
+#include "Globals.h"
+#include "ChunkDataCache.h"
+#include "PrefabPiecePool.h"
+
+
+
+
+
+std::shared_ptr<cBiomeMapCache> cGeneratorCaches::GetBiomeCache(size_t a_Capacity)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	if (m_Biomes == nullptr)
+	{
+		m_Biomes = std::make_shared<cBiomeMapCache>(a_Capacity);
+	}
+	return m_Biomes;
+}
+
+
+
+
+
+std::shared_ptr<cHeightMapCache> cGeneratorCaches::GetCompositedHeightCache(size_t a_Capacity)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	if (m_CompositedHeights == nullptr)
+	{
+		m_CompositedHeights = std::make_shared<cHeightMapCache>(a_Capacity);
+	}
+	return m_CompositedHeights;
+}
+
+
+
+
+
+cGeneratorCaches::sStatistics cGeneratorCaches::GetStatistics(void) const
+{
+	std::shared_ptr<cBiomeMapCache> Biomes;
+	std::shared_ptr<cHeightMapCache> CompositedHeights;
+	{
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		Biomes = m_Biomes;
+		CompositedHeights = m_CompositedHeights;
+	}
+
+	sStatistics Res;
+	if (Biomes != nullptr)
+	{
+		Res.m_Biomes = Biomes->GetStatistics();
+	}
+	if (CompositedHeights != nullptr)
+	{
+		Res.m_CompositedHeights = CompositedHeights->GetStatistics();
+	}
+	return Res;
+}
+
+
+
+
+
+std::shared_ptr<const cPrefabPiecePool> cGeneratorCaches::GetPrefabPiecePool(const AString & a_FileName, bool a_LogWarnings)
+{
+	std::lock_guard<std::mutex> Lock(m_CSPrefabPiecePools);
+	auto itr = m_PrefabPiecePools.find(a_FileName);
+	if (itr != m_PrefabPiecePools.end())
+	{
+		return itr->second;
+	}
+
+	auto Pool = std::make_shared<cPrefabPiecePool>();
+	if (!Pool->LoadFromFile(a_FileName, a_LogWarnings))
+	{
+		Pool.reset();
+	}
+	m_PrefabPiecePools.emplace(a_FileName, Pool);
+	return Pool;
+}
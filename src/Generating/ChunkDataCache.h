@@ -0,0 +1,260 @@
+
+// ChunkDataCache.h
+
+// Declares the cChunkDataCache class template, a thread-safe cache of per-chunk generator data, such as biomes or heights
+// Declares the cGeneratorCaches class that holds the caches and the read-only data shared by all generators of a single world
+
+/*
+The cache is split into shards by the chunk coords, each with its own lock, hash index and fixed number of slots,
+so that generator threads working on different chunks rarely wait for each other.
+A full shard evicts using the CLOCK algorithm (an approximation of LRU that doesn't need to reorder anything on hits).
+The cached values are calculated outside the lock; if two threads miss the same chunk at the same time, both calculate
+it and the second store simply overwrites the first with identical data, since the generators are deterministic.
+*/
+
+
+
+
+
+#pragma once
+
+#include "ChunkDef.h"
+
+
+
+
+
+// fwd:
+class cPrefabPiecePool;
+
+
+
+
+
+template <typename DataType>
+class cChunkDataCache
+{
+	static_assert(std::is_trivially_copyable<DataType>::value, "The cached data is copied as raw memory");
+
+public:
+
+	struct sStatistics
+	{
+		size_t m_NumEntries = 0;
+		size_t m_Capacity = 0;
+		size_t m_NumHits = 0;
+		size_t m_NumMisses = 0;
+		size_t m_NumEvictions = 0;
+	};
+
+
+	/** Creates a cache holding at least a_Capacity chunks' data (rounded up to fill all the shards evenly). */
+	explicit cChunkDataCache(size_t a_Capacity):
+		m_Shards(NumShardsForCapacity(a_Capacity))
+	{
+		const auto SlotsPerShard = std::max<size_t>((a_Capacity + m_Shards.size() - 1) / m_Shards.size(), 1);
+		for (auto & Shard : m_Shards)
+		{
+			Shard.m_Slots.resize(SlotsPerShard);
+			Shard.m_Index.reserve(SlotsPerShard);
+		}
+	}
+
+	/** Copies the chunk's cached data into a_Data and returns true, or returns false if the chunk is not cached. */
+	bool Get(cChunkCoords a_Coords, DataType & a_Data)
+	{
+		return Read(a_Coords, [&a_Data](const DataType & a_Cached)
+			{
+				std::memcpy(&a_Data, &a_Cached, sizeof(DataType));
+			}
+		);
+	}
+
+	/** Calls a_Reader with the chunk's cached data (under the shard lock, keep it short) and returns true,
+	or returns false if the chunk is not cached. */
+	template <typename Reader>
+	bool Read(cChunkCoords a_Coords, Reader && a_Reader)
+	{
+		auto & Shard = GetShard(a_Coords);
+		std::lock_guard<std::mutex> Lock(Shard.m_Mutex);
+		const auto itr = Shard.m_Index.find(a_Coords);
+		if (itr == Shard.m_Index.end())
+		{
+			Shard.m_NumMisses += 1;
+			return false;
+		}
+		auto & Slot = Shard.m_Slots[itr->second];
+		Slot.m_IsReferenced = true;
+		Shard.m_NumHits += 1;
+		a_Reader(static_cast<const DataType &>(Slot.m_Data));
+		return true;
+	}
+
+	/** Stores the chunk's data, evicting another chunk's data if the shard is full. */
+	void Put(cChunkCoords a_Coords, const DataType & a_Data)
+	{
+		auto & Shard = GetShard(a_Coords);
+		std::lock_guard<std::mutex> Lock(Shard.m_Mutex);
+		auto itr = Shard.m_Index.find(a_Coords);
+		size_t SlotIdx;
+		if (itr != Shard.m_Index.end())
+		{
+			// Another thread has stored the same chunk in the meantime:
+			SlotIdx = itr->second;
+		}
+		else
+		{
+			SlotIdx = Shard.FindVictim();
+			auto & Victim = Shard.m_Slots[SlotIdx];
+			if (Victim.m_IsUsed)
+			{
+				Shard.m_Index.erase(Victim.m_Coords);
+				Shard.m_NumEvictions += 1;
+			}
+			Victim.m_Coords = a_Coords;
+			Victim.m_IsUsed = true;
+			Shard.m_Index.emplace(a_Coords, SlotIdx);
+		}
+		auto & Slot = Shard.m_Slots[SlotIdx];
+		std::memcpy(&Slot.m_Data, &a_Data, sizeof(DataType));
+		Slot.m_IsReferenced = true;
+	}
+
+	/** Returns the current statistics, summed over all the shards. */
+	sStatistics GetStatistics(void) const
+	{
+		sStatistics Res;
+		for (const auto & Shard : m_Shards)
+		{
+			std::lock_guard<std::mutex> Lock(Shard.m_Mutex);
+			Res.m_NumEntries += Shard.m_Index.size();
+			Res.m_Capacity += Shard.m_Slots.size();
+			Res.m_NumHits += Shard.m_NumHits;
+			Res.m_NumMisses += Shard.m_NumMisses;
+			Res.m_NumEvictions += Shard.m_NumEvictions;
+		}
+		return Res;
+	}
+
+protected:
+
+	struct sSlot
+	{
+		cChunkCoords m_Coords{0, 0};
+		DataType m_Data;
+		bool m_IsUsed = false;
+
+		/** The CLOCK reference bit, set on each use, cleared when the clock hand passes. */
+		bool m_IsReferenced = false;
+	};
+
+	struct sShard
+	{
+		mutable std::mutex m_Mutex;
+		std::vector<sSlot> m_Slots;
+		std::unordered_map<cChunkCoords, size_t, cChunkCoordsHash> m_Index;
+		size_t m_ClockHand = 0;
+		size_t m_NumHits = 0;
+		size_t m_NumMisses = 0;
+		size_t m_NumEvictions = 0;
+
+		/** Returns the index of the slot to store a new chunk into: a free one, or the first unreferenced one from the clock hand. */
+		size_t FindVictim(void)
+		{
+			for (;;)
+			{
+				auto & Slot = m_Slots[m_ClockHand];
+				const auto Idx = m_ClockHand;
+				m_ClockHand = (m_ClockHand + 1) % m_Slots.size();
+				if (!Slot.m_IsUsed || !Slot.m_IsReferenced)
+				{
+					return Idx;
+				}
+				Slot.m_IsReferenced = false;
+			}
+		}
+	};
+
+	/** The maximum number of shards; more threads than this rarely generate at once. */
+	static constexpr size_t MAX_SHARDS = 64;
+
+	/** The minimum number of slots in a shard, so that small caches are not split into tiny ones. */
+	static constexpr size_t MIN_SLOTS_PER_SHARD = 16;
+
+	std::vector<sShard> m_Shards;
+
+
+	/** Returns the number of shards to use for the capacity, a power of two. */
+	static size_t NumShardsForCapacity(size_t a_Capacity)
+	{
+		size_t Res = 1;
+		while ((Res < MAX_SHARDS) && (Res * 2 * MIN_SLOTS_PER_SHARD <= a_Capacity))
+		{
+			Res *= 2;
+		}
+		return Res;
+	}
+
+	/** Returns the shard responsible for the chunk.
+	The hash is mixed again and the shard is picked by the top bits of the result, so that the neighbouring chunks spread
+	over all the shards even where size_t is 32-bit, and the shard doesn't correlate with the index bucket, which uses the bottom bits. */
+	sShard & GetShard(cChunkCoords a_Coords)
+	{
+		// The MurmurHash3 finalizer, each input bit affects all the output bits:
+		auto Hash = static_cast<UInt64>(cChunkCoordsHash()(a_Coords));
+		Hash ^= Hash >> 33;
+		Hash *= 0xff51afd7ed558ccdULL;
+		Hash ^= Hash >> 33;
+		Hash *= 0xc4ceb9fe1a85ec53ULL;
+		Hash ^= Hash >> 33;
+		return m_Shards[static_cast<size_t>(Hash >> 56) & (m_Shards.size() - 1)];
+	}
+};
+
+using cBiomeMapCache  = cChunkDataCache<cChunkDef::BiomeMap>;
+using cHeightMapCache = cChunkDataCache<cChunkDef::HeightMap>;
+
+
+
+
+
+/** The caches shared by all the generator instances of a single world.
+All the instances are created from the same settings and are deterministic, so any of them may use the data calculated by another. */
+class cGeneratorCaches
+{
+public:
+
+	struct sStatistics
+	{
+		cBiomeMapCache::sStatistics m_Biomes;
+		cHeightMapCache::sStatistics m_CompositedHeights;
+	};
+
+	/** Returns the biome cache, creating it with the specified capacity on the first call. */
+	std::shared_ptr<cBiomeMapCache> GetBiomeCache(size_t a_Capacity);
+
+	/** Returns the cache of the composited heightmaps, creating it with the specified capacity on the first call. */
+	std::shared_ptr<cHeightMapCache> GetCompositedHeightCache(size_t a_Capacity);
+
+	/** Returns the statistics of the caches; the ones not created yet are all zero. */
+	sStatistics GetStatistics(void) const;
+
+	/** Returns the piece pool loaded from the specified file, loading it on the first call.
+	Returns nullptr if the file cannot be loaded; the failure is remembered, so that the warnings are logged only once.
+	The pool is never modified, the generators use their own copies made by cPrefabPiecePool::CopyFrom(), which share the pieces' block data. */
+	std::shared_ptr<const cPrefabPiecePool> GetPrefabPiecePool(const AString & a_FileName, bool a_LogWarnings);
+
+protected:
+
+	/** Protects the pointers, not the caches themselves. */
+	mutable std::mutex m_Mutex;
+
+	std::shared_ptr<cBiomeMapCache> m_Biomes;
+	std::shared_ptr<cHeightMapCache> m_CompositedHeights;
+
+	/** Protects m_PrefabPiecePools. Held while loading a pool, so that the other generators wait for it instead of loading it again. */
+	std::mutex m_CSPrefabPiecePools;
+
+	/** The piece pools loaded so far, by their file names. Failed loads are stored as nullptr. */
+	std::map<AString, std::shared_ptr<const cPrefabPiecePool>> m_PrefabPiecePools;
+};
@@ -2,6 +2,7 @@
 #include "Globals.h"
 
 #include "ChunkGenerator.h"
+#include "ChunkDataCache.h"
 #include "ChunkDesc.h"
 #include "ComposableGenerator.h"
 #include "Noise3DGenerator.h"
@@ -14,6 +15,11 @@
 
 void cChunkGenerator::Initialize(cIniFile & a_IniFile)
 {
+	if (m_Caches == nullptr)
+	{
+		m_Caches = std::make_shared<cGeneratorCaches>();
+	}
+
 	// Get the seed; create a new one and log it if not found in the INI file:
 	if (a_IniFile.HasValue("Seed", "Seed"))
 	{
@@ -33,7 +39,7 @@ void cChunkGenerator::Initialize(cIniFile & a_IniFile)
 
 
 
-std::unique_ptr<cChunkGenerator> cChunkGenerator::CreateFromIniFile(cIniFile & a_IniFile)
+std::unique_ptr<cChunkGenerator> cChunkGenerator::CreateFromIniFile(cIniFile & a_IniFile, std::shared_ptr<cGeneratorCaches> a_Caches)
 {
 	// Get the generator engine based on the INI file settings:
 	std::unique_ptr<cChunkGenerator> res;
@@ -57,6 +63,7 @@ std::unique_ptr<cChunkGenerator> cChunkGenerator::CreateFromIniFile(cIniFile & a
 		return nullptr;
 	}
 
+	res->m_Caches = std::move(a_Caches);
 	res->Initialize(a_IniFile);
 	return res;
 }
@@ -8,6 +8,7 @@
 // fwd:
 class cIniFile;
 class cChunkDesc;
+class cGeneratorCaches;
 
 
 
@@ -43,8 +44,10 @@ public:
 	int GetSeed(void) const { return m_Seed; }
 
 	/** Creates and initializes the entire generator based on the settings in the INI file.
-	Initializes the generator, so that it can be used immediately after this call returns. */
-	static std::unique_ptr<cChunkGenerator> CreateFromIniFile(cIniFile & a_IniFile);
+	Initializes the generator, so that it can be used immediately after this call returns.
+	a_Caches are the caches shared with the other generators created from the same settings, if any;
+	if not given, the generator gets caches of its own. */
+	static std::unique_ptr<cChunkGenerator> CreateFromIniFile(cIniFile & a_IniFile, std::shared_ptr<cGeneratorCaches> a_Caches = {});
 
 
 protected:
@@ -54,6 +57,9 @@ protected:
 
 	/** The dimension, read from the INI file. */
 	eDimension m_Dimension;
+
+	/** The caches shared with the other generators created from the same settings. */
+	std::shared_ptr<cGeneratorCaches> m_Caches;
 };
 
 
@@ -118,7 +118,8 @@ std::unique_ptr<cTerrainCompositionGen> cTerrainCompositionGen::CreateCompositio
 cComposableGenerator::cComposableGenerator():
 	m_BiomeGen(),
 	m_ShapeGen(),
-	m_CompositionGen()
+	m_CompositionGen(),
+	m_StageObserver(nullptr)
 {
 }
 
@@ -157,12 +158,19 @@ void cComposableGenerator::GenerateBiomes(cChunkCoords a_ChunkCoords, cChunkDef:
 
 void cComposableGenerator::Generate(cChunkDesc & a_ChunkDesc)
 {
+	static const AString BiomesStage("Biomes");
+	static const AString ShapeStage("Shape");
+	static const AString CompositionStage("Composition");
+
 	if (a_ChunkDesc.IsUsingDefaultBiomes())
 	{
+		BeginStage(BiomesStage);
 		m_BiomeGen->GenBiomes(a_ChunkDesc.GetChunkCoords(), a_ChunkDesc.GetBiomeMap());
+		EndStage(BiomesStage);
 	}
 
 	cChunkDesc::Shape shape;
+	BeginStage(ShapeStage);
 	if (a_ChunkDesc.IsUsingDefaultHeight())
 	{
 		m_ShapeGen->GenShape(a_ChunkDesc.GetChunkCoords(), shape);
@@ -173,18 +181,23 @@ void cComposableGenerator::Generate(cChunkDesc & a_ChunkDesc)
 		// Convert the heightmap in a_ChunkDesc into shape:
 		a_ChunkDesc.GetShapeFromHeight(shape);
 	}
+	EndStage(ShapeStage);
 
 	bool ShouldUpdateHeightmap = false;
 	if (a_ChunkDesc.IsUsingDefaultComposition())
 	{
+		BeginStage(CompositionStage);
 		m_CompositionGen->ComposeTerrain(a_ChunkDesc, shape);
+		EndStage(CompositionStage);
 	}
 
 	if (a_ChunkDesc.IsUsingDefaultFinish())
 	{
-		for (const auto & Finisher : m_FinishGens)
+		for (size_t i = 0; i < m_FinishGens.size(); ++i)
 		{
-			Finisher->GenFinish(a_ChunkDesc);
+			BeginStage(m_FinishGenNames[i]);
+			m_FinishGens[i]->GenFinish(a_ChunkDesc);
+			EndStage(m_FinishGenNames[i]);
 		}
 		ShouldUpdateHeightmap = true;
 	}
@@ -286,7 +299,8 @@ void cComposableGenerator::InitBiomeGen(cIniFile & a_IniFile)
 	m_BiomeGen = cBiomeGen::CreateBiomeGen(a_IniFile, m_Seed, CacheOffByDefault);
 
 	// Add a cache, if requested:
-	// The default is 16 * 128 caches, which is 2 MiB of RAM. Reasonable, for the amount of work this is saving.
+	// The default is 16 * 128 biome maps, which is 2 MiB of RAM. Reasonable, for the amount of work this is saving.
+	// The cache is shared by all the generator instances of the world.
 	int CacheSize = a_IniFile.GetValueSetI("Generator", "BiomeGenCacheSize", CacheOffByDefault ? 0 : 16);
 	if (CacheSize <= 0)
 	{
@@ -300,16 +314,9 @@ void cComposableGenerator::InitBiomeGen(cIniFile & a_IniFile)
 		);
 		CacheSize = 4;
 	}
-	LOGD("Using a cache for biomegen of size %d.", CacheSize);
-	if (MultiCacheLength > 0)
-	{
-		LOGD("Enabling multicache for biomegen of length %d.", MultiCacheLength);
-		m_BiomeGen = std::make_unique<cBioGenMulticache>(std::move(m_BiomeGen), static_cast<size_t>(CacheSize), static_cast<size_t>(MultiCacheLength));
-	}
-	else
-	{
-		m_BiomeGen = std::make_unique<cBioGenMulticache>(std::move(m_BiomeGen), static_cast<size_t>(CacheSize), 1);
-	}
+	const auto Capacity = static_cast<size_t>(CacheSize) * static_cast<size_t>(std::max(MultiCacheLength, 1));
+	LOGD("Using a cache for biomegen of %zu chunks.", Capacity);
+	m_BiomeGen = std::make_unique<cBioGenCache>(std::move(m_BiomeGen), m_Caches->GetBiomeCache(Capacity));
 }
 
 
@@ -367,8 +374,11 @@ void cComposableGenerator::InitCompositionGen(cIniFile & a_IniFile)
 	}
 
 	// Create a cache of the composited heightmaps, so that finishers may use it:
-	m_CompositedHeightCache = std::make_unique<cHeiGenMultiCache>(std::make_unique<cCompositedHeiGen>(*m_BiomeGen, *m_ShapeGen, *m_CompositionGen), 16, 128);
-	// 128 subcaches of depth 16 each = 0.5 MiB of RAM. Acceptable, for the amount of work this saves.
+	// 2048 heightmaps = 0.5 MiB of RAM, shared by all the generator instances of the world. Acceptable, for the amount of work this saves.
+	m_CompositedHeightCache = std::make_unique<cHeiGenCache>(
+		std::make_unique<cCompositedHeiGen>(*m_BiomeGen, *m_ShapeGen, *m_CompositionGen),
+		m_Caches->GetCompositedHeightCache(2048)
+	);
 }
 
 
@@ -552,7 +562,7 @@ void cComposableGenerator::InitFinishGens(cIniFile & a_IniFile)
 			}
 
 			auto Gen = std::make_unique<cPieceStructuresGen>(m_Seed);
-			if (Gen->Initialize(split[1], seaLevel, *m_BiomeGen, *m_CompositedHeightCache))
+			if (Gen->Initialize(split[1], seaLevel, *m_BiomeGen, *m_CompositedHeightCache, *m_Caches))
 			{
 				m_FinishGens.push_back(std::move(Gen));
 			}
@@ -614,7 +624,7 @@ void cComposableGenerator::InitFinishGens(cIniFile & a_IniFile)
 			}
 
 			auto Gen = std::make_unique<cSinglePieceStructuresGen>(m_Seed);
-			if (Gen->Initialize(split[1], seaLevel, *m_BiomeGen, *m_CompositedHeightCache))
+			if (Gen->Initialize(split[1], seaLevel, *m_BiomeGen, *m_CompositedHeightCache, *m_Caches))
 			{
 				m_FinishGens.push_back(std::move(Gen));
 			}
@@ -651,7 +661,7 @@ void cComposableGenerator::InitFinishGens(cIniFile & a_IniFile)
 			int MaxDensity = a_IniFile.GetValueSetI("Generator", "VillageMaxDensity", 80);
 			AString PrefabList = a_IniFile.GetValueSet("Generator", "VillagePrefabs", "PlainsVillage, SandVillage");
 			auto Prefabs = StringSplitAndTrim(PrefabList, ",");
-			m_FinishGens.push_back(std::make_unique<cVillageGen>(m_Seed, GridSize, MaxOffset, MaxDepth, MaxSize, MinDensity, MaxDensity, *m_BiomeGen, *m_CompositedHeightCache, seaLevel, Prefabs));
+			m_FinishGens.push_back(std::make_unique<cVillageGen>(m_Seed, GridSize, MaxOffset, MaxDepth, MaxSize, MinDensity, MaxDensity, *m_BiomeGen, *m_CompositedHeightCache, seaLevel, Prefabs, *m_Caches));
 		}
 		else if (NoCaseCompare(finisher, "Vines") == 0)
 		{
@@ -678,5 +688,8 @@ void cComposableGenerator::InitFinishGens(cIniFile & a_IniFile)
 		{
 			LOGWARNING("Unknown Finisher in the [Generator] section: \"%s\". Ignoring.", finisher.c_str());
 		}
+
+		// Name the finisher(s) just added:
+		m_FinishGenNames.resize(m_FinishGens.size(), finisher);
 	}  // for itr - Str[]
 }
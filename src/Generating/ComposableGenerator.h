@@ -200,8 +200,24 @@ class cComposableGenerator:
 
 public:
 
+	/** Receives the boundaries of the generation stages, for profiling.
+	The stages are "Biomes", "Shape", "Composition" and then each finisher, by its name from the INI file.
+	Called from the generating thread, the stages don't overlap. */
+	class cStageObserver
+	{
+	public:
+		virtual ~cStageObserver() {}  // Force a virtual destructor in descendants
+
+		virtual void OnStageBegin(const AString & a_StageName) = 0;
+		virtual void OnStageEnd(const AString & a_StageName) = 0;
+	};
+
+
 	cComposableGenerator();
 
+	/** Sets the observer to be notified of each stage of the generation, nullptr to disable. Not owned. */
+	void SetStageObserver(cStageObserver * a_Observer) { m_StageObserver = a_Observer; }
+
 	// cChunkGenerator::cGenerator overrides:
 	virtual void Initialize(cIniFile & a_IniFile) override;
 	virtual void GenerateBiomes(cChunkCoords a_ChunkCoords, cChunkDef::BiomeMap & a_BiomeMap) override;
@@ -230,6 +246,12 @@ protected:
 	/** The finisher generators, in the order in which they are applied. */
 	std::vector<std::unique_ptr<cFinishGen>> m_FinishGens;
 
+	/** The names of the finishers in m_FinishGens, as given in the INI file. */
+	AStringVector m_FinishGenNames;
+
+	/** The observer notified of each stage of the generation, nullptr if none. */
+	cStageObserver * m_StageObserver;
+
 
 	/** Reads the BiomeGen settings from the ini and initializes m_BiomeGen accordingly */
 	void InitBiomeGen(cIniFile & a_IniFile);
@@ -242,4 +264,20 @@ protected:
 
 	/** Reads the finishers from the ini and initializes m_FinishGens accordingly */
 	void InitFinishGens(cIniFile & a_IniFile);
+
+	/** Notifies the stage observer, if any, that the specified stage is beginning / has ended. */
+	void BeginStage(const AString & a_StageName)
+	{
+		if (m_StageObserver != nullptr)
+		{
+			m_StageObserver->OnStageBegin(a_StageName);
+		}
+	}
+	void EndStage(const AString & a_StageName)
+	{
+		if (m_StageObserver != nullptr)
+		{
+			m_StageObserver->OnStageEnd(a_StageName);
+		}
+	}
 } ;
@@ -6,7 +6,6 @@
 #include "Globals.h"
 #include "DungeonRoomsFinisher.h"
 #include "../BlockInfo.h"
-#include "../FastRandom.h"
 #include "../BlockEntities/ChestEntity.h"
 #include "../BlockEntities/MobSpawnerEntity.h"
 
@@ -43,7 +42,8 @@ public:
 		m_EndX(a_OriginX + a_HalfSizeX),
 		m_StartZ(a_OriginZ - a_HalfSizeZ),
 		m_EndZ(a_OriginZ + a_HalfSizeZ),
-		m_FloorHeight(a_FloorHeight)
+		m_FloorHeight(a_FloorHeight),
+		m_Noise(a_Noise)
 	{
 		/*
 		Pick coords next to the wall for the chests.
@@ -97,6 +97,9 @@ protected:
 	/** The monster type for the mobspawner entity. */
 	eMonsterType m_MonsterType;
 
+	/** The noise used for the random floor pattern, so that the room looks the same whichever chunk is generated first. */
+	cNoise m_Noise;
+
 
 	/** Decodes the position index along the room walls into a proper 2D position for a chest.
 	The Y coord of the returned vector specifies the chest's meta value. */
@@ -153,8 +156,11 @@ protected:
 
 
 
-	/** Fills the specified area of blocks in the chunk with a random pattern of the specified blocktypes, if they are one of the overwritten block types.
-	The coords are absolute, start coords are inclusive, end coords are exclusive. The first blocktype uses 75% chance, the second 25% chance. */
+	/** Fills the specified area of blocks in the chunk with a pseudorandom pattern of the specified blocktypes, if they are one of the overwritten block types.
+	The coords are absolute, start coords are inclusive, end coords are exclusive. The first blocktype uses 75% chance, the second 25% chance.
+	The pattern comes from m_Noise rather than a random generator, so that it doesn't depend on the order in which the generator threads
+	generate the chunks. This is an intended output change: the floors no longer match the ones generated by the older versions,
+	which were different in each run anyway. */
 	void ReplaceCuboidRandom(cChunkDesc & a_ChunkDesc, int a_StartX, int a_StartY, int a_StartZ, int a_EndX, int a_EndY, int a_EndZ, BLOCKTYPE a_DstBlockType1, BLOCKTYPE a_DstBlockType2)
 	{
 		int BlockX = a_ChunkDesc.GetChunkX() * cChunkDef::Width;
@@ -163,7 +169,6 @@ protected:
 		int RelStartZ = Clamp(a_StartZ - BlockZ, 0, cChunkDef::Width - 1);
 		int RelEndX   = Clamp(a_EndX - BlockX,   0, cChunkDef::Width);
 		int RelEndZ   = Clamp(a_EndZ - BlockZ,   0, cChunkDef::Width);
-		auto & rnd = GetRandomProvider();
 		for (int y = a_StartY; y < a_EndY; y++)
 		{
 			for (int z = RelStartZ; z < RelEndZ; z++)
@@ -172,7 +177,7 @@ protected:
 				{
 					if (cBlockInfo::CanBeTerraformed(a_ChunkDesc.GetBlockType(x, y, z)))
 					{
-						BLOCKTYPE BlockType = rnd.RandBool(0.75) ? a_DstBlockType1 : a_DstBlockType2;
+						BLOCKTYPE BlockType = (((m_Noise.IntNoise3DInt(BlockX + x, y, BlockZ + z) / 7) % 4) != 0) ? a_DstBlockType1 : a_DstBlockType2;
 						a_ChunkDesc.SetBlockType(x, y, z, BlockType);
 					}
 				}  // for x
@@ -108,70 +108,36 @@ void cHeiGenFlat::InitializeHeightGen(cIniFile & a_IniFile)
 
 cHeiGenCache::cHeiGenCache(cTerrainHeightGen & a_HeiGenToCache, size_t a_CacheSize) :
 	m_HeiGenToCache(a_HeiGenToCache),
-	m_CacheSize(a_CacheSize),
-	m_NumHits(0),
-	m_NumMisses(0),
-	m_TotalChain(0)
+	m_Cache(std::make_shared<cHeightMapCache>(a_CacheSize))
 {
-	m_CacheOrder.resize(a_CacheSize);
-	m_CacheData.resize(a_CacheSize);
-	for (size_t i = 0; i < m_CacheSize; i++)
-	{
-		m_CacheOrder[i] = i;
-	}
 }
 
 
 
 
 
-void cHeiGenCache::GenHeightMap(cChunkCoords a_ChunkCoords, cChunkDef::HeightMap & a_HeightMap)
+cHeiGenCache::cHeiGenCache(std::unique_ptr<cTerrainHeightGen> a_HeiGenToCache, std::shared_ptr<cHeightMapCache> a_Cache) :
+	m_Owned(std::move(a_HeiGenToCache)),
+	m_HeiGenToCache(*m_Owned),
+	m_Cache(std::move(a_Cache))
 {
-	/*
-	if (((m_NumHits + m_NumMisses) % 1024) == 10)
-	{
-		LOGD("HeiGenCache: %d hits, %d misses, saved %.2f %%", m_NumHits, m_NumMisses, 100.0 * m_NumHits / (m_NumHits + m_NumMisses));
-		LOGD("HeiGenCache: Avg cache chain length: %.2f", static_cast<double>(m_TotalChain) / m_NumHits);
-	}
-	//*/
+	ASSERT(m_Cache != nullptr);
+}
+
 
-	for (size_t i = 0; i < m_CacheSize; i++)
-	{
-		if (m_CacheData[m_CacheOrder[i]].m_Coords != a_ChunkCoords)
-		{
-			continue;
-		}
-		// Found it in the cache
-		auto Idx = m_CacheOrder[i];
 
-		// Move to front:
-		for (size_t j = i; j > 0; j--)
-		{
-			m_CacheOrder[j] = m_CacheOrder[j - 1];
-		}
-		m_CacheOrder[0] = Idx;
 
-		// Use the cached data:
-		memcpy(a_HeightMap, m_CacheData[Idx].m_HeightMap, sizeof(a_HeightMap));
 
-		m_NumHits++;
-		m_TotalChain += i;
+void cHeiGenCache::GenHeightMap(cChunkCoords a_ChunkCoords, cChunkDef::HeightMap & a_HeightMap)
+{
+	if (m_Cache->Get(a_ChunkCoords, a_HeightMap))
+	{
 		return;
-	}  // for i - cache
+	}
 
-	// Not in the cache:
-	m_NumMisses++;
+	// Not in the cache, generate and store:
 	m_HeiGenToCache.GenHeightMap(a_ChunkCoords, a_HeightMap);
-
-	// Insert it as the first item in the MRU order:
-	auto Idx = m_CacheOrder[m_CacheSize - 1];
-	for (auto i = m_CacheSize - 1; i > 0; i--)
-	{
-		m_CacheOrder[i] = m_CacheOrder[i - 1];
-	}  // for i - m_CacheOrder[]
-	m_CacheOrder[0] = Idx;
-	memcpy(m_CacheData[Idx].m_HeightMap, a_HeightMap, sizeof(a_HeightMap));
-	m_CacheData[Idx].m_Coords = a_ChunkCoords;
+	m_Cache->Put(a_ChunkCoords, a_HeightMap);
 }
 
 
@@ -189,9 +155,10 @@ HEIGHTTYPE cHeiGenCache::GetHeightAt(int a_BlockX, int a_BlockZ)
 		return res;
 	}
 
-	// Chunk not in cache, generate the chunk and ask again:
+	// Chunk not in cache, generate and store the chunk:
 	cChunkDef::HeightMap heightMap;
-	GenHeightMap({chunkX, chunkZ}, heightMap);
+	m_HeiGenToCache.GenHeightMap({chunkX, chunkZ}, heightMap);
+	m_Cache->Put({chunkX, chunkZ}, heightMap);
 	return cChunkDef::GetHeight(heightMap, a_BlockX - chunkX * cChunkDef::Width, a_BlockZ - chunkZ * cChunkDef::Width);
 }
 
@@ -201,81 +168,11 @@ HEIGHTTYPE cHeiGenCache::GetHeightAt(int a_BlockX, int a_BlockZ)
 
 bool cHeiGenCache::GetHeightAt(int a_ChunkX, int a_ChunkZ, int a_RelX, int a_RelZ, HEIGHTTYPE & a_Height)
 {
-	for (size_t i = 0; i < m_CacheSize; i++)
-	{
-		if ((m_CacheData[i].m_Coords.m_ChunkX == a_ChunkX) && (m_CacheData[i].m_Coords.m_ChunkZ == a_ChunkZ))
+	return m_Cache->Read({a_ChunkX, a_ChunkZ}, [&](const cChunkDef::HeightMap & a_HeightMap)
 		{
-			a_Height = cChunkDef::GetHeight(m_CacheData[i].m_HeightMap, a_RelX, a_RelZ);
-			return true;
+			a_Height = cChunkDef::GetHeight(a_HeightMap, a_RelX, a_RelZ);
 		}
-	}  // for i - m_CacheData[]
-	return false;
-}
-
-
-
-
-
-////////////////////////////////////////////////////////////////////////////////
-// cHeiGenMultiCache:
-
-cHeiGenMultiCache::cHeiGenMultiCache(std::unique_ptr<cTerrainHeightGen> a_HeiGenToCache, size_t a_SubCacheSize, size_t a_NumSubCaches):
-	m_NumSubCaches(a_NumSubCaches),
-	m_Underlying(std::move(a_HeiGenToCache))
-{
-	// Create the individual sub-caches:
-	m_SubCaches.reserve(a_NumSubCaches);
-	for (size_t i = 0; i < a_NumSubCaches; i++)
-	{
-		m_SubCaches.push_back(std::make_unique<cHeiGenCache>(*m_Underlying, a_SubCacheSize));
-	}
-}
-
-
-
-
-
-void cHeiGenMultiCache::GenHeightMap(cChunkCoords a_ChunkCoords, cChunkDef::HeightMap & a_HeightMap)
-{
-	// Get the subcache responsible for this chunk:
-	const size_t cacheIdx = (static_cast<size_t>(a_ChunkCoords.m_ChunkX) + m_CoeffZ * static_cast<size_t>(a_ChunkCoords.m_ChunkZ)) % m_NumSubCaches;
-
-	// Ask the subcache:
-	m_SubCaches[cacheIdx]->GenHeightMap(a_ChunkCoords, a_HeightMap);
-}
-
-
-
-
-
-HEIGHTTYPE cHeiGenMultiCache::GetHeightAt(int a_BlockX, int a_BlockZ)
-{
-	// First try if the chunk is already in the cache:
-	int chunkX, chunkZ;
-	cChunkDef::BlockToChunk(a_BlockX, a_BlockZ, chunkX, chunkZ);
-	HEIGHTTYPE res;
-	if (GetHeightAt(chunkX, chunkZ, a_BlockX - chunkX * cChunkDef::Width, a_BlockZ - chunkZ * cChunkDef::Width, res))
-	{
-		return res;
-	}
-
-	// Chunk not in cache, generate the chunk and ask again:
-	cChunkDef::HeightMap heightMap;
-	GenHeightMap({chunkX, chunkZ}, heightMap);
-	return cChunkDef::GetHeight(heightMap, a_BlockX - chunkX * cChunkDef::Width, a_BlockZ - chunkZ * cChunkDef::Width);
-}
-
-
-
-
-
-bool cHeiGenMultiCache::GetHeightAt(int a_ChunkX, int a_ChunkZ, int a_RelX, int a_RelZ, HEIGHTTYPE & a_Height)
-{
-	// Get the subcache responsible for this chunk:
-	const size_t cacheIdx = (static_cast<size_t>(a_ChunkX) + m_CoeffZ * static_cast<size_t>(a_ChunkZ)) % m_NumSubCaches;
-
-	// Ask the subcache:
-	return m_SubCaches[cacheIdx]->GetHeightAt(a_ChunkX, a_ChunkZ, a_RelX, a_RelZ, a_Height);
+	);
 }
 
 
@@ -17,6 +17,7 @@ Also implements the heightmap cache
 #pragma once
 
 #include "ComposableGenerator.h"
+#include "ChunkDataCache.h"
 #include "../Noise/Noise.h"
 
 
@@ -24,12 +25,20 @@ Also implements the heightmap cache
 
 
 /** A simple cache that stores N most recently generated chunks' heightmaps; N being settable upon creation */
+/** Caches the heightmaps of another generator in a cHeightMapCache.
+The cache may be shared by several generators' instances (created from the same settings) in different threads;
+the underlying generator is used only by the thread that owns this object. */
 class cHeiGenCache :
 	public cTerrainHeightGen
 {
 public:
+
+	/** Creates a cache over a generator owned by someone else, with a private cache of the specified number of heightmaps. */
 	cHeiGenCache(cTerrainHeightGen & a_HeiGenToCache, size_t a_CacheSize);
 
+	/** Creates a cache that owns the generator, storing into the specified (possibly shared) cache. */
+	cHeiGenCache(std::unique_ptr<cTerrainHeightGen> a_HeiGenToCache, std::shared_ptr<cHeightMapCache> a_Cache);
+
 	// cTerrainHeightGen overrides:
 	virtual void GenHeightMap(cChunkCoords a_ChunkCoords, cChunkDef::HeightMap & a_HeightMap) override;
 	virtual HEIGHTTYPE GetHeightAt(int a_BlockX, int a_BlockZ) override;
@@ -38,68 +47,21 @@ public:
 	bool GetHeightAt(int a_ChunkX, int a_ChunkZ, int a_RelX, int a_RelZ, HEIGHTTYPE & a_Height);
 
 protected:
-	struct sCacheData
-	{
-		cChunkCoords m_Coords;
-		cChunkDef::HeightMap m_HeightMap;
 
-		/** Default constructor: Fill in bogus coords, so that the item is not used until properly calculated. */
-		sCacheData():
-			m_Coords(0x7fffffff, 0x7fffffff)
-		{}
-	} ;
+	/** The underlying generator, if owned by this object. */
+	std::unique_ptr<cTerrainHeightGen> m_Owned;
 
 	/** The terrain height generator that is being cached. */
 	cTerrainHeightGen & m_HeiGenToCache;
 
-	// To avoid moving large amounts of data for the MRU behavior, we MRU-ize indices to an array of the actual data
-	size_t                  m_CacheSize;
-	std::vector<size_t>     m_CacheOrder;  // MRU-ized order, indices into m_CacheData array
-	std::vector<sCacheData> m_CacheData;   // m_CacheData[m_CacheOrder[0]] is the most recently used
-
-	// Cache statistics
-	size_t m_NumHits;
-	size_t m_NumMisses;
-	size_t m_TotalChain;  // Number of cache items walked to get to a hit (only added for hits)
+	/** The cache storing the generated heightmaps. */
+	std::shared_ptr<cHeightMapCache> m_Cache;
 } ;
 
 
 
 
 
-/** Caches heightmaps in multiple underlying caches to improve the distribution and lower the chain length. */
-class cHeiGenMultiCache:
-	public cTerrainHeightGen
-{
-public:
-	cHeiGenMultiCache(std::unique_ptr<cTerrainHeightGen> a_HeightGenToCache, size_t a_SubCacheSize, size_t a_NumSubCaches);
-
-	// cTerrainHeightGen overrides:
-	virtual void GenHeightMap(cChunkCoords a_ChunkCoords, cChunkDef::HeightMap & a_HeightMap) override;
-	virtual HEIGHTTYPE GetHeightAt(int a_BlockX, int a_BlockZ) override;
-
-	/** Retrieves height at the specified point in the cache, returns true if found, false if not found */
-	bool GetHeightAt(int a_ChunkX, int a_ChunkZ, int a_RelX, int a_RelZ, HEIGHTTYPE & a_Height);
-
-protected:
-
-	/** The coefficient used to turn Z coords into index (x + Coeff * z). */
-	static const size_t m_CoeffZ = 5;
-
-	/** Number of sub-caches, pulled out of m_SubCaches.size() for performance reasons. */
-	size_t m_NumSubCaches;
-
-	/** The individual sub-caches. */
-	std::vector<std::unique_ptr<cHeiGenCache>> m_SubCaches;
-
-	/** The underlying height generator. */
-	std::unique_ptr<cTerrainHeightGen> m_Underlying;
-};
-
-
-
-
-
 class cHeiGenFlat :
 	public cTerrainHeightGen
 {
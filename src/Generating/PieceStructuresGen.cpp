@@ -5,6 +5,7 @@
 
 #include "Globals.h"
 #include "PieceStructuresGen.h"
+#include "ChunkDataCache.h"
 #include "PrefabStructure.h"
 #include "PieceGeneratorBFSTree.h"
 #include "../IniFile.h"
@@ -32,15 +33,17 @@ public:
 
 
 
-	/** Loads the piecepool from a file.
+	/** Loads the piecepool from a file, through the caches shared by the generators of the world.
 	Returns true on success, logs warning and returns false on failure. */
-	bool LoadFromFile(const AString & a_FileName)
+	bool LoadFromFile(const AString & a_FileName, cGeneratorCaches & a_Caches)
 	{
-		// Load the piecepool from the file, log any warnings:
-		if (!m_PiecePool.LoadFromFile(a_FileName, true))
+		// Copy the piecepool loaded from the file, the first generator to load it logs any warnings:
+		auto PiecePool = a_Caches.GetPrefabPiecePool(a_FileName, true);
+		if (PiecePool == nullptr)
 		{
 			return false;
 		}
+		m_PiecePool.CopyFrom(*PiecePool);
 		if (NoCaseCompare(m_PiecePool.GetIntendedUse(), "PieceStructures") != 0)
 		{
 			LOGWARNING("PieceStructures generator: File %s is intended for use in \"%s\", rather than piece structures. Loading the file, but the generator may behave unexpectedly.",
@@ -129,7 +132,7 @@ cPieceStructuresGen::cPieceStructuresGen(int a_Seed):
 
 
 
-bool cPieceStructuresGen::Initialize(const AString & a_Prefabs, int a_SeaLevel, cBiomeGen & a_BiomeGen, cTerrainHeightGen & a_HeightGen)
+bool cPieceStructuresGen::Initialize(const AString & a_Prefabs, int a_SeaLevel, cBiomeGen & a_BiomeGen, cTerrainHeightGen & a_HeightGen, cGeneratorCaches & a_Caches)
 {
 	// Load each piecepool:
 	auto Structures = StringSplitAndTrim(a_Prefabs, "|");
@@ -146,7 +149,7 @@ bool cPieceStructuresGen::Initialize(const AString & a_Prefabs, int a_SeaLevel,
 			}
 		}
 		auto Gen = std::make_shared<cGen>(m_Seed, a_BiomeGen, a_HeightGen, a_SeaLevel, Structure);
-		if (Gen->LoadFromFile(FileName))
+		if (Gen->LoadFromFile(FileName, a_Caches))
 		{
 			m_Gens.push_back(Gen);
 		}
@@ -32,9 +32,10 @@ public:
 
 	/** Initializes the generator based on the specified prefab sets.
 	a_Prefabs contains the list of prefab sets that should be activated, "|"-separated.
+	The prefab sets are loaded through a_Caches, so that all the generators of the world share their block data.
 	All problems are logged to the console and the generator skips over them.
 	Returns true if at least one prefab set is valid (the generator should be kept). */
-	bool Initialize(const AString & a_Prefabs, int a_SeaLevel, cBiomeGen & a_BiomeGen, cTerrainHeightGen & a_HeightGen);
+	bool Initialize(const AString & a_Prefabs, int a_SeaLevel, cBiomeGen & a_BiomeGen, cTerrainHeightGen & a_HeightGen, cGeneratorCaches & a_Caches);
 
 	// cFinishGen override:
 	virtual void GenFinish(cChunkDesc & a_ChunkDesc) override;
@@ -17,6 +17,7 @@ uses a prefabricate in a cBlockArea for drawing itself.
 
 
 cPrefab::cPrefab(const cPrefab::sDef & a_Def) :
+	m_BlockArea(std::make_shared<cBlockAreas>()),
 	m_Size(a_Def.m_SizeX, a_Def.m_SizeY, a_Def.m_SizeZ),
 	m_HitBox(
 		{a_Def.m_HitboxMinX, a_Def.m_HitboxMinY, a_Def.m_HitboxMinZ},
@@ -29,7 +30,7 @@ cPrefab::cPrefab(const cPrefab::sDef & a_Def) :
 	m_AddWeightIfSame(a_Def.m_AddWeightIfSame),
 	m_MoveToGround(a_Def.m_MoveToGround)
 {
-	m_BlockArea[0].Create(m_Size);
+	(*m_BlockArea)[0].Create(m_Size);
 	CharMap cm;
 	ParseCharMap(cm, a_Def.m_CharMap);
 	ParseBlockImage(cm, a_Def.m_Image);
@@ -43,7 +44,27 @@ cPrefab::cPrefab(const cPrefab::sDef & a_Def) :
 
 
 
+cPrefab::cPrefab(const cPrefab & a_Prefab) :
+	m_BlockArea(a_Prefab.m_BlockArea),
+	m_Size(a_Prefab.m_Size),
+	m_HitBox(a_Prefab.m_HitBox),
+	m_Connectors(a_Prefab.m_Connectors),
+	m_AllowedRotations(a_Prefab.m_AllowedRotations),
+	m_MergeStrategy(a_Prefab.m_MergeStrategy),
+	m_ExtendFloorStrategy(a_Prefab.m_ExtendFloorStrategy),
+	m_DefaultWeight(a_Prefab.m_DefaultWeight),
+	m_DepthWeight(a_Prefab.m_DepthWeight),
+	m_AddWeightIfSame(a_Prefab.m_AddWeightIfSame),
+	m_MoveToGround(a_Prefab.m_MoveToGround)
+{
+}
+
+
+
+
+
 cPrefab::cPrefab(const cBlockArea & a_Image, int a_AllowedRotations) :
+	m_BlockArea(std::make_shared<cBlockAreas>()),
 	m_Size(a_Image.GetSize()),
 	m_AllowedRotations(a_AllowedRotations),
 	m_MergeStrategy(cBlockArea::msOverwrite),
@@ -54,7 +75,7 @@ cPrefab::cPrefab(const cBlockArea & a_Image, int a_AllowedRotations) :
 {
 	m_HitBox.p1.Set(0, 0, 0);
 	m_HitBox.p2.Set(m_Size.x - 1, m_Size.y - 1, m_Size.z - 1);
-	m_BlockArea[0].CopyFrom(a_Image);
+	(*m_BlockArea)[0].CopyFrom(a_Image);
 	AddRotatedBlockAreas();
 }
 
@@ -63,6 +84,7 @@ cPrefab::cPrefab(const cBlockArea & a_Image, int a_AllowedRotations) :
 
 
 cPrefab::cPrefab(const cBlockArea & a_Image) :
+	m_BlockArea(std::make_shared<cBlockAreas>()),
 	m_Size(a_Image.GetSize()),
 	m_AllowedRotations(0),
 	m_MergeStrategy(cBlockArea::msOverwrite),
@@ -73,7 +95,7 @@ cPrefab::cPrefab(const cBlockArea & a_Image) :
 {
 	m_HitBox.p1.Set(0, 0, 0);
 	m_HitBox.p2.Set(m_Size.x - 1, m_Size.y - 1, m_Size.z - 1);
-	m_BlockArea[0].CopyFrom(a_Image);
+	(*m_BlockArea)[0].CopyFrom(a_Image);
 }
 
 
@@ -81,6 +103,7 @@ cPrefab::cPrefab(const cBlockArea & a_Image) :
 
 
 cPrefab::cPrefab(const AString & a_BlockDefinitions, const AString & a_BlockData, int a_SizeX, int a_SizeY, int a_SizeZ) :
+	m_BlockArea(std::make_shared<cBlockAreas>()),
 	m_Size(a_SizeX, a_SizeY, a_SizeZ),
 	m_AllowedRotations(0),
 	m_MergeStrategy(cBlockArea::msOverwrite),
@@ -91,7 +114,7 @@ cPrefab::cPrefab(const AString & a_BlockDefinitions, const AString & a_BlockData
 {
 	m_HitBox.p1.Set(0, 0, 0);
 	m_HitBox.p2.Set(m_Size.x - 1, m_Size.y - 1, m_Size.z - 1);
-	m_BlockArea[0].Create(m_Size);
+	(*m_BlockArea)[0].Create(m_Size);
 	CharMap cm;
 	ParseCharMap(cm, a_BlockDefinitions.c_str());
 	ParseBlockImage(cm, a_BlockData.c_str());
@@ -106,23 +129,23 @@ void cPrefab::AddRotatedBlockAreas(void)
 	// 1 CCW rotation:
 	if ((m_AllowedRotations & 0x01) != 0)
 	{
-		m_BlockArea[1].CopyFrom(m_BlockArea[0]);
-		m_BlockArea[1].RotateCCW();
+		(*m_BlockArea)[1].CopyFrom((*m_BlockArea)[0]);
+		(*m_BlockArea)[1].RotateCCW();
 	}
 
 	// 2 rotations are the same as mirroring twice; mirroring is faster because it has no reallocations
 	if ((m_AllowedRotations & 0x02) != 0)
 	{
-		m_BlockArea[2].CopyFrom(m_BlockArea[0]);
-		m_BlockArea[2].MirrorXY();
-		m_BlockArea[2].MirrorYZ();
+		(*m_BlockArea)[2].CopyFrom((*m_BlockArea)[0]);
+		(*m_BlockArea)[2].MirrorXY();
+		(*m_BlockArea)[2].MirrorYZ();
 	}
 
 	// 3 CCW rotations = 1 CW rotation:
 	if ((m_AllowedRotations & 0x04) != 0)
 	{
-		m_BlockArea[3].CopyFrom(m_BlockArea[0]);
-		m_BlockArea[3].RotateCW();
+		(*m_BlockArea)[3].CopyFrom((*m_BlockArea)[0]);
+		(*m_BlockArea)[3].RotateCW();
 	}
 }
 
@@ -146,7 +169,7 @@ void cPrefab::Draw(cChunkDesc & a_Dest, const Vector3i & a_Placement, int a_NumR
 	int ChunkStartX = a_Dest.GetChunkX() * cChunkDef::Width;
 	int ChunkStartZ = a_Dest.GetChunkZ() * cChunkDef::Width;
 	Placement.Move(-ChunkStartX, 0, -ChunkStartZ);
-	const cBlockArea & Image = m_BlockArea[a_NumRotations];
+	const cBlockArea & Image = (*m_BlockArea)[a_NumRotations];
 
 	// If the placement is outside this chunk, bail out:
 	if (
@@ -387,7 +410,7 @@ void cPrefab::ParseBlockImage(const CharMap & a_CharMap, const char * a_BlockIma
 			{
 				const sBlockTypeDef & MappedValue = a_CharMap[BlockImage[x]];
 				ASSERT(MappedValue.m_BlockMeta != 16);  // Using a letter not defined in the CharMap?
-				m_BlockArea[0].SetRelBlockTypeMeta(x, y, z, MappedValue.m_BlockType, MappedValue.m_BlockMeta);
+				(*m_BlockArea)[0].SetRelBlockTypeMeta(x, y, z, MappedValue.m_BlockType, MappedValue.m_BlockMeta);
 			}
 		}
 	}
@@ -99,6 +99,11 @@ public:
 	/** Creates a prefab from the provided definition. */
 	cPrefab(const sDef & a_Def);
 
+	/** Creates a copy of the prefab that shares the block areas with a_Prefab, so that the copy takes next to no memory.
+	The block areas must not be modified after the prefab is copied.
+	The vertical strategy, vertical limit and modifiers are not copied, they bind to a generator and each copy needs its own. */
+	cPrefab(const cPrefab & a_Prefab);
+
 	/** Creates a prefab based on the given BlockArea and allowed rotations. */
 	cPrefab(const cBlockArea & a_Image, int a_AllowedRotations);
 
@@ -156,6 +161,9 @@ public:
 	/** Sets the internal hitbox to the specified value. */
 	void SetHitBox(const cCuboid & a_HitBox) { m_HitBox = a_HitBox; }
 
+	/** Returns the unrotated block area of the prefab. */
+	const cBlockArea & GetBlockArea(void) const { return (*m_BlockArea)[0]; }
+
 protected:
 	/** Packs complete definition of a single block, for per-letter assignment. */
 	struct sBlockTypeDef
@@ -170,10 +178,13 @@ protected:
 	/** Maps generator tree depth to weight. */
 	typedef std::map<int, int> cDepthWeight;
 
+	/** The block areas of all the rotations of the prefab. */
+	typedef std::array<cBlockArea, 4> cBlockAreas;
+
 
-	/** The cBlockArea that contains the block definitions for the prefab.
+	/** The cBlockAreas that contain the block definitions for the prefab, shared by all the copies of the prefab.
 	The index identifies the number of CCW rotations applied (0 = no rotation, 1 = 1 CCW rotation, ...). */
-	cBlockArea m_BlockArea[4];
+	std::shared_ptr<cBlockAreas> m_BlockArea;
 
 	/** The size of the prefab */
 	Vector3i m_Size;
@@ -7,10 +7,23 @@
 #include "PrefabPiecePool.h"
 #include "VerticalStrategy.h"
 #include "../Bindings/LuaState.h"
+#include "../OSSupport/MemoryMappedFile.h"
+#include "../WorldStorage/FastNBT.h"
 #include "../WorldStorage/SchematicFileSerializer.h"
+#include "../FastRandom.h"
 #include "../StringCompression.h"
 
 
+
+
+
+/** Version of the binary cache format, bump whenever the layout of the cache or the interpretation of the cubeset changes. */
+static const Int32 CACHE_FORMAT_VERSION = 1;
+
+
+
+
+
 /** Returns the map of string => eMergeStrategy used when translating cubeset file merge strategies. */
 static std::map<AString, cBlockArea::eMergeStrategy> & GetMergeStrategyMap(void)
 {
@@ -34,6 +47,96 @@ static std::map<AString, cBlockArea::eMergeStrategy> & GetMergeStrategyMap(void)
 
 
 
+/** Returns the 64-bit FNV-1a hash of the data, used for detecting changes in the cubeset files. */
+static UInt64 HashCubesetContents(const AString & a_Contents)
+{
+	UInt64 Hash = 14695981039346656037ULL;
+	for (auto ch: a_Contents)
+	{
+		Hash ^= static_cast<unsigned char>(ch);
+		Hash *= 1099511628211ULL;
+	}
+	return Hash;
+}
+
+
+
+
+
+/** Returns the child tag of the specified name and type, or -1 if there's no such child. */
+static int FindCacheChild(const cParsedNBT & a_NBT, int a_Tag, const char * a_Name, eTagType a_Type)
+{
+	int Child = a_NBT.FindChildByName(a_Tag, a_Name);
+	if ((Child < 0) || (a_NBT.GetType(Child) != a_Type))
+	{
+		return -1;
+	}
+	return Child;
+}
+
+
+
+
+
+/** Reads the specified int-valued child tag into a_Value. Returns false if the tag is missing. */
+static bool ReadCacheInt(const cParsedNBT & a_NBT, int a_Tag, const char * a_Name, int & a_Value)
+{
+	int Child = FindCacheChild(a_NBT, a_Tag, a_Name, TAG_Int);
+	if (Child < 0)
+	{
+		return false;
+	}
+	a_Value = a_NBT.GetInt(Child);
+	return true;
+}
+
+
+
+
+
+/** Reads the specified string-valued child tag into a_Value. Returns false if the tag is missing. */
+static bool ReadCacheString(const cParsedNBT & a_NBT, int a_Tag, const char * a_Name, AString & a_Value)
+{
+	int Child = FindCacheChild(a_NBT, a_Tag, a_Name, TAG_String);
+	if (Child < 0)
+	{
+		return false;
+	}
+	a_Value = a_NBT.GetString(Child);
+	return true;
+}
+
+
+
+
+
+/** Reads the specified int-array child tag into a_Values. Returns false if the tag is missing or doesn't have a_NumValues values.
+If a_NumValues is zero, any number of values is accepted. */
+static bool ReadCacheIntArray(const cParsedNBT & a_NBT, int a_Tag, const char * a_Name, std::vector<int> & a_Values, size_t a_NumValues = 0)
+{
+	int Child = FindCacheChild(a_NBT, a_Tag, a_Name, TAG_IntArray);
+	if (Child < 0)
+	{
+		return false;
+	}
+	size_t NumValues = a_NBT.GetDataLength(Child) / 4;
+	if ((a_NumValues != 0) && (NumValues != a_NumValues))
+	{
+		return false;
+	}
+	a_Values.resize(NumValues);
+	const auto Data = a_NBT.GetData(Child);
+	for (size_t i = 0; i < NumValues; i++)
+	{
+		a_Values[i] = NetworkBufToHost<Int32>(Data + i * 4);
+	}
+	return true;
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cPrefabPiecePool:
 
@@ -73,6 +176,7 @@ cPrefabPiecePool::~cPrefabPiecePool()
 
 void cPrefabPiecePool::Clear(void)
 {
+	m_CubesetPieces.clear();
 	m_PiecesByConnector.clear();
 	for (cPieces::iterator itr = m_AllPieces.begin(), end = m_AllPieces.end(); itr != end; ++itr)
 	{
@@ -137,7 +241,23 @@ bool cPrefabPiecePool::LoadFromFile(const AString & a_FileName, bool a_LogWarnin
 		CONDWARNING(a_LogWarnings, "Cannot read data from file %s", a_FileName.c_str());
 		return false;
 	}
-	return LoadFromString(contents, a_FileName, a_LogWarnings);
+
+	// Use the binary cache, if it was created from this exact file:
+	const auto SourceHash = HashCubesetContents(contents);
+	const auto CacheFileName = a_FileName + ".cache";
+	if (LoadFromCache(a_FileName, CacheFileName, SourceHash, contents.size(), a_LogWarnings))
+	{
+		return true;
+	}
+
+	// Load from the source and (re-)create the cache:
+	const auto FirstPiece = m_CubesetPieces.size();
+	if (!LoadFromString(contents, a_FileName, a_LogWarnings))
+	{
+		return false;
+	}
+	SaveToCache(CacheFileName, SourceHash, contents.size(), FirstPiece);
+	return true;
 }
 
 
@@ -218,6 +338,33 @@ bool cPrefabPiecePool::LoadFromCubeset(const AString & a_Contents, const AString
 
 
 
+void cPrefabPiecePool::CopyFrom(const cPrefabPiecePool & a_Pool)
+{
+	m_IntendedUse = a_Pool.m_IntendedUse;
+	m_MinDensity = a_Pool.m_MinDensity;
+	m_MaxDensity = a_Pool.m_MaxDensity;
+	m_VillageRoadBlockType = a_Pool.m_VillageRoadBlockType;
+	m_VillageRoadBlockMeta = a_Pool.m_VillageRoadBlockMeta;
+	m_VillageWaterRoadBlockType = a_Pool.m_VillageWaterRoadBlockType;
+	m_VillageWaterRoadBlockMeta = a_Pool.m_VillageWaterRoadBlockMeta;
+	m_AllowedBiomes = a_Pool.m_AllowedBiomes;
+	m_Metadata = a_Pool.m_Metadata;
+
+	for (const auto & Piece: a_Pool.m_CubesetPieces)
+	{
+		auto Prefab = std::make_unique<cPrefab>(*Piece.first);
+		auto Props = Piece.second;
+
+		// The problems with the properties have been reported when loading a_Pool:
+		ApplyPlacementProps(AString(), *Prefab, Props, false);
+		AddPiece(std::move(Prefab), std::move(Props));
+	}
+}
+
+
+
+
+
 void cPrefabPiecePool::AddToPerConnectorMap(cPrefab * a_Prefab)
 {
 	cPiece::cConnectors Connectors = (static_cast<const cPiece *>(a_Prefab))->GetConnectors();
@@ -277,14 +424,14 @@ bool cPrefabPiecePool::LoadCubesetPieceVer1(const AString & a_FileName, cLuaStat
 	ASSERT(lua_istable(a_LuaState, -1));
 
 	// The piece name is optional, but useful for debugging messages:
-	AString PieceName;
-	if (!a_LuaState.GetNamedValue("OriginData.ExportName", PieceName))
+	sPieceProps Props;
+	if (!a_LuaState.GetNamedValue("OriginData.ExportName", Props.m_Name))
 	{
-		PieceName = fmt::format(FMT_STRING("Piece #{}"), a_PieceIndex);
+		Props.m_Name = fmt::format(FMT_STRING("Piece #{}"), a_PieceIndex);
 	}
 
 	// Read the hitbox dimensions:
-	cCuboid Hitbox;
+	cCuboid & Hitbox = Props.m_HitBox;
 	if (
 		!a_LuaState.GetNamedValue("Hitbox.MinX", Hitbox.p1.x) ||
 		!a_LuaState.GetNamedValue("Hitbox.MinY", Hitbox.p1.y) ||
@@ -294,62 +441,134 @@ bool cPrefabPiecePool::LoadCubesetPieceVer1(const AString & a_FileName, cLuaStat
 		!a_LuaState.GetNamedValue("Hitbox.MaxZ", Hitbox.p2.z)
 	)
 	{
-		CONDWARNING(a_LogWarnings, "Cannot load piece %s from file %s, it's missing hitbox information", PieceName, a_FileName);
+		CONDWARNING(a_LogWarnings, "Cannot load piece %s from file %s, it's missing hitbox information", Props.m_Name, a_FileName);
 		return false;
 	}
 
 	// Load the prefab data:
-	auto prefab = LoadPrefabFromCubesetVer1(a_FileName, a_LuaState, PieceName, a_LogWarnings);
+	auto prefab = LoadPrefabFromCubesetVer1(a_FileName, a_LuaState, Props, a_LogWarnings);
 	if (prefab == nullptr)
 	{
 		return false;
 	}
-	prefab->SetHitBox(Hitbox);
 
 	// Read the connectors
-	if (!ReadConnectorsCubesetVer1(a_FileName, a_LuaState, PieceName, prefab.get(), a_LogWarnings))
+	if (!ReadConnectorsCubesetVer1(a_FileName, a_LuaState, Props, a_LogWarnings))
 	{
 		return false;
 	}
 
 	// Read the allowed rotations. It is an optional metadata value, default to 0:
-	int AllowedRotations = 0;
-	a_LuaState.GetNamedValue("Metadata.AllowedRotations", AllowedRotations);
-	prefab->SetAllowedRotations(AllowedRotations);
+	a_LuaState.GetNamedValue("Metadata.AllowedRotations", Props.m_AllowedRotations);
 
 	// Read the relevant metadata for the piece:
-	if (!ReadPieceMetadataCubesetVer1(a_FileName, a_LuaState, PieceName, prefab.get(), a_LogWarnings))
+	if (!ReadPieceMetadataCubesetVer1(a_FileName, a_LuaState, Props, a_LogWarnings))
 	{
 		return false;
 	}
 
-	// If the piece is a starting piece, check that it has a vertical strategy:
 	int IsStartingPiece = 0;
 	a_LuaState.GetNamedValue("Metadata.IsStarting", IsStartingPiece);
-	if (IsStartingPiece != 0)
+	Props.m_IsStarting = (IsStartingPiece != 0);
+
+	AddCubesetPiece(a_FileName, std::move(prefab), std::move(Props), a_LogWarnings);
+	return true;
+}
+
+
+
+
+
+void cPrefabPiecePool::AddCubesetPiece(
+	const AString & a_FileName,
+	std::unique_ptr<cPrefab> a_Prefab,
+	sPieceProps && a_Props,
+	bool a_LogWarnings
+)
+{
+	const auto & PieceName = a_Props.m_Name;
+	a_Prefab->SetHitBox(a_Props.m_HitBox);
+	for (const auto & Connector: a_Props.m_Connectors)
+	{
+		a_Prefab->AddConnector(Connector.m_Pos.x, Connector.m_Pos.y, Connector.m_Pos.z, Connector.m_Direction, Connector.m_Type);
+	}
+	a_Prefab->SetAllowedRotations(a_Props.m_AllowedRotations);
+
+	// Apply the metadata:
+	a_Prefab->SetAddWeightIfSame(a_Props.m_AddWeightIfSame);
+	a_Prefab->SetDefaultWeight(a_Props.m_DefaultWeight);
+	a_Prefab->ParseDepthWeight(a_Props.m_DepthWeight.c_str());
+	auto msmap = GetMergeStrategyMap();
+	auto strategy = msmap.find(a_Props.m_MergeStrategy);
+	if (strategy == msmap.end())
 	{
-		if (prefab->GetVerticalStrategy() == nullptr)
+		CONDWARNING(a_LogWarnings, "Unknown merge strategy (\"%s\") specified for piece %s in file %s. Using msSpongePrint instead.",
+			a_Props.m_MergeStrategy.c_str(), PieceName.c_str(), a_FileName.c_str()
+		);
+		a_Prefab->SetMergeStrategy(cBlockArea::msSpongePrint);
+	}
+	else
+	{
+		a_Prefab->SetMergeStrategy(strategy->second);
+	}
+	a_Prefab->SetMoveToGround(a_Props.m_MoveToGround);
+	a_Prefab->SetExtendFloorStrategy(a_Props.m_ExtendFloorStrategy);
+	ApplyPlacementProps(a_FileName, *a_Prefab, a_Props, a_LogWarnings);
+	AddPiece(std::move(a_Prefab), std::move(a_Props));
+}
+
+
+
+
+
+void cPrefabPiecePool::ApplyPlacementProps(const AString & a_FileName, cPrefab & a_Prefab, const sPieceProps & a_Props, bool a_LogWarnings)
+{
+	const auto & PieceName = a_Props.m_Name;
+	if (!a_Props.m_VerticalLimit.empty())
+	{
+		if (!a_Prefab.SetVerticalLimitFromString(a_Props.m_VerticalLimit, a_LogWarnings))
+		{
+			CONDWARNING(a_LogWarnings, "Unknown VerticalLimit (\"%s\") specified for piece %s in file %s. Using no limit instead.",
+				a_Props.m_VerticalLimit.c_str(), PieceName.c_str(), a_FileName.c_str()
+			);
+		}
+	}
+	a_Prefab.SetVerticalStrategyFromString(a_Props.m_VerticalStrategy, a_LogWarnings);
+	if (!a_Props.m_Modifiers.empty())
+	{
+		a_Prefab.SetPieceModifiersFromString(a_Props.m_Modifiers, a_LogWarnings);
+	}
+
+	// If the piece is a starting piece, check that it has a vertical strategy:
+	if (a_Props.m_IsStarting)
+	{
+		if (a_Prefab.GetVerticalStrategy() == nullptr)
 		{
 			CONDWARNING(a_LogWarnings, "Starting prefab %s in file %s doesn't have its VerticalStrategy set. Setting to Fixed|150.",
 				PieceName, a_FileName
 			);
-			VERIFY(prefab->SetVerticalStrategyFromString("Fixed|150", false));
+			VERIFY(a_Prefab.SetVerticalStrategyFromString("Fixed|150", false));
 		}
 	}
+}
+
+
 
-	// Add the prefab into the list of pieces:
-	if (IsStartingPiece != 0)
+
+
+void cPrefabPiecePool::AddPiece(std::unique_ptr<cPrefab> a_Prefab, sPieceProps && a_Props)
+{
+	auto p = a_Prefab.release();
+	if (a_Props.m_IsStarting)
 	{
-		m_StartingPieces.push_back(prefab.release());
+		m_StartingPieces.push_back(p);
 	}
 	else
 	{
-		auto p = prefab.release();
 		m_AllPieces.push_back(p);
 		AddToPerConnectorMap(p);
 	}
-
-	return true;
+	m_CubesetPieces.emplace_back(p, std::move(a_Props));
 }
 
 
@@ -359,14 +578,17 @@ bool cPrefabPiecePool::LoadCubesetPieceVer1(const AString & a_FileName, cLuaStat
 std::unique_ptr<cPrefab> cPrefabPiecePool::LoadPrefabFromCubesetVer1(
 	const AString & a_FileName,
 	cLuaState & a_LuaState,
-	const AString & a_PieceName,
+	sPieceProps & a_Props,
 	bool a_LogWarnings
 )
 {
+	const auto & PieceName = a_Props.m_Name;
+
 	// First try loading a referenced schematic file, if any:
 	AString SchematicFileName;
 	if (a_LuaState.GetNamedValue("SchematicFileName", SchematicFileName))
 	{
+		a_Props.m_IsFromSchematic = true;
 		auto PathEnd = a_FileName.find_last_of("/\\");  // Find the last path separator
 		if (PathEnd != AString::npos)
 		{
@@ -380,7 +602,7 @@ std::unique_ptr<cPrefab> cPrefabPiecePool::LoadPrefabFromCubesetVer1(
 		catch (const std::exception & Oops)
 		{
 			CONDWARNING(a_LogWarnings, "Cannot load schematic file \"%s\" for piece %s in cubeset %s. %s",
-				SchematicFileName.c_str(), a_PieceName.c_str(), a_FileName.c_str(), Oops.what()
+				SchematicFileName.c_str(), PieceName.c_str(), a_FileName.c_str(), Oops.what()
 			);
 			return nullptr;
 		}
@@ -396,7 +618,7 @@ std::unique_ptr<cPrefab> cPrefabPiecePool::LoadPrefabFromCubesetVer1(
 		!a_LuaState.GetNamedValue("BlockData", BlockData)
 	)
 	{
-		CONDWARNING(a_LogWarnings, "Cannot parse block data for piece %s in cubeset %s", a_PieceName.c_str(), a_FileName.c_str());
+		CONDWARNING(a_LogWarnings, "Cannot parse block data for piece %s in cubeset %s", PieceName.c_str(), a_FileName.c_str());
 		return nullptr;
 	}
 
@@ -404,7 +626,7 @@ std::unique_ptr<cPrefab> cPrefabPiecePool::LoadPrefabFromCubesetVer1(
 	AString BlockDefStr;
 	if (!a_LuaState.Call(TableConcat, BlockDefinitions, "\n", cLuaState::Return, BlockDefStr))
 	{
-		CONDWARNING(a_LogWarnings, "Cannot concat block definitions for piece %s in cubeset %s", a_PieceName.c_str(), a_FileName.c_str());
+		CONDWARNING(a_LogWarnings, "Cannot concat block definitions for piece %s in cubeset %s", PieceName.c_str(), a_FileName.c_str());
 		return nullptr;
 	}
 
@@ -412,7 +634,7 @@ std::unique_ptr<cPrefab> cPrefabPiecePool::LoadPrefabFromCubesetVer1(
 	AString BlockDataStr;
 	if (!a_LuaState.Call(TableConcat, BlockData, "", cLuaState::Return, BlockDataStr))
 	{
-		CONDWARNING(a_LogWarnings, "Cannot concat block data for piece %s in cubeset %s", a_PieceName.c_str(), a_FileName.c_str());
+		CONDWARNING(a_LogWarnings, "Cannot concat block data for piece %s in cubeset %s", PieceName.c_str(), a_FileName.c_str());
 		return nullptr;
 	}
 
@@ -424,7 +646,7 @@ std::unique_ptr<cPrefab> cPrefabPiecePool::LoadPrefabFromCubesetVer1(
 		!a_LuaState.GetNamedValue("Size.z", SizeZ)
 	)
 	{
-		CONDWARNING(a_LogWarnings, "Cannot load piece %s from file %s, its size information is missing", a_PieceName.c_str(), a_FileName.c_str());
+		CONDWARNING(a_LogWarnings, "Cannot load piece %s from file %s, its size information is missing", PieceName.c_str(), a_FileName.c_str());
 		return nullptr;
 	}
 
@@ -432,7 +654,7 @@ std::unique_ptr<cPrefab> cPrefabPiecePool::LoadPrefabFromCubesetVer1(
 	if (static_cast<size_t>(SizeX * SizeY * SizeZ) != BlockDataStr.size())
 	{
 		CONDWARNING(a_LogWarnings, "Cannot create piece %s from file %s, its size (%d) doesn't match the blockdata length (%u)",
-			a_PieceName.c_str(), a_FileName.c_str(),
+			PieceName.c_str(), a_FileName.c_str(),
 			SizeX * SizeY * SizeZ, static_cast<unsigned>(BlockDataStr.size())
 		);
 		return nullptr;
@@ -448,16 +670,17 @@ std::unique_ptr<cPrefab> cPrefabPiecePool::LoadPrefabFromCubesetVer1(
 bool cPrefabPiecePool::ReadConnectorsCubesetVer1(
 	const AString & a_FileName,
 	cLuaState & a_LuaState,
-	const AString & a_PieceName,
-	cPrefab * a_Prefab,
+	sPieceProps & a_Props,
 	bool a_LogWarnings
 )
 {
+	const auto & PieceName = a_Props.m_Name;
+
 	// Get the Connectors subtable:
 	auto conns = a_LuaState.WalkToValue("Connectors");
 	if (!conns.IsValid())
 	{
-		CONDWARNING(a_LogWarnings, "Cannot load piece %s from file %s, it has no connectors definition.", a_PieceName.c_str(), a_FileName.c_str());
+		CONDWARNING(a_LogWarnings, "Cannot load piece %s from file %s, it has no connectors definition.", PieceName.c_str(), a_FileName.c_str());
 		return false;
 	}
 
@@ -489,7 +712,7 @@ bool cPrefabPiecePool::ReadConnectorsCubesetVer1(
 			if (a_LogWarnings)
 			{
 				FLOGWARNING("Piece {0} in file {1} has a malformed Connector at index {2} ({3}, type {4}, direction {5}). Skipping the connector.",
-					a_PieceName, a_FileName, idx, Vector3i{RelX, RelY, RelZ}, Type, DirectionStr
+					PieceName, a_FileName, idx, Vector3i{RelX, RelY, RelZ}, Type, DirectionStr
 				);
 			}
 			res = false;
@@ -497,7 +720,7 @@ bool cPrefabPiecePool::ReadConnectorsCubesetVer1(
 			idx += 1;
 			continue;
 		}
-		a_Prefab->AddConnector(RelX, RelY, RelZ, Direction, Type);
+		a_Props.m_Connectors.emplace_back(RelX, RelY, RelZ, Type, Direction);
 		lua_pop(a_LuaState, 1);  // stk: [Connectors]
 		idx += 1;
 	}
@@ -511,8 +734,7 @@ bool cPrefabPiecePool::ReadConnectorsCubesetVer1(
 bool cPrefabPiecePool::ReadPieceMetadataCubesetVer1(
 	const AString & a_FileName,
 	cLuaState & a_LuaState,
-	const AString & a_PieceName,
-	cPrefab * a_Prefab,
+	sPieceProps & a_Props,
 	bool a_LogWarnings
 )
 {
@@ -523,35 +745,17 @@ bool cPrefabPiecePool::ReadPieceMetadataCubesetVer1(
 		return false;
 	}
 
-	// Get the values:
-	int AddWeightIfSame = 0, DefaultWeight = 100, MoveToGround = 0;
-	AString DepthWeight, MergeStrategy, VerticalLimit, VerticalStrategy;
-	a_LuaState.GetNamedValue("AddWeightIfSame",  AddWeightIfSame);
-	a_LuaState.GetNamedValue("DefaultWeight",    DefaultWeight);
-	a_LuaState.GetNamedValue("DepthWeight",      DepthWeight);
-	a_LuaState.GetNamedValue("MergeStrategy",    MergeStrategy);
+	// Get the values, they are applied to the prefab in AddCubesetPiece():
+	int MoveToGround = 0;
+	a_LuaState.GetNamedValue("AddWeightIfSame",  a_Props.m_AddWeightIfSame);
+	a_LuaState.GetNamedValue("DefaultWeight",    a_Props.m_DefaultWeight);
+	a_LuaState.GetNamedValue("DepthWeight",      a_Props.m_DepthWeight);
+	a_LuaState.GetNamedValue("MergeStrategy",    a_Props.m_MergeStrategy);
 	a_LuaState.GetNamedValue("MoveToGround",     MoveToGround);
-	a_LuaState.GetNamedValue("VerticalLimit",    VerticalLimit);
-	a_LuaState.GetNamedValue("VerticalStrategy", VerticalStrategy);
-
-	// Apply the values:
-	a_Prefab->SetAddWeightIfSame(AddWeightIfSame);
-	a_Prefab->SetDefaultWeight(DefaultWeight);
-	a_Prefab->ParseDepthWeight(DepthWeight.c_str());
-	auto msmap = GetMergeStrategyMap();
-	auto strategy = msmap.find(MergeStrategy);
-	if (strategy == msmap.end())
-	{
-		CONDWARNING(a_LogWarnings, "Unknown merge strategy (\"%s\") specified for piece %s in file %s. Using msSpongePrint instead.",
-			MergeStrategy.c_str(), a_PieceName.c_str(), a_FileName.c_str()
-		);
-		a_Prefab->SetMergeStrategy(cBlockArea::msSpongePrint);
-	}
-	else
-	{
-		a_Prefab->SetMergeStrategy(strategy->second);
-	}
-	a_Prefab->SetMoveToGround(MoveToGround != 0);
+	a_LuaState.GetNamedValue("VerticalLimit",    a_Props.m_VerticalLimit);
+	a_LuaState.GetNamedValue("VerticalStrategy", a_Props.m_VerticalStrategy);
+	a_LuaState.GetNamedValue("Modifiers",        a_Props.m_Modifiers);
+	a_Props.m_MoveToGround = (MoveToGround != 0);
 
 	AString ExpandFloorStrategyStr;
 	if (!a_LuaState.GetNamedValue("ExpandFloorStrategy", ExpandFloorStrategyStr))
@@ -561,9 +765,9 @@ bool cPrefabPiecePool::ReadPieceMetadataCubesetVer1(
 		if (a_LuaState.GetNamedValue("ShouldExpandFloor", ShouldExpandFloor))
 		{
 			LOG("Piece \"%s\" in file \"%s\" is using the old \"ShouldExpandFloor\" attribute. Use the new \"ExpandFloorStrategy\" attribute instead for more options.",
-				a_PieceName.c_str(), a_FileName.c_str()
+				a_Props.m_Name.c_str(), a_FileName.c_str()
 			);
-			a_Prefab->SetExtendFloorStrategy((ShouldExpandFloor != 0) ? cPrefab::efsRepeatBottomTillNonAir : cPrefab::efsNone);
+			a_Props.m_ExtendFloorStrategy = (ShouldExpandFloor != 0) ? cPrefab::efsRepeatBottomTillNonAir : cPrefab::efsNone;
 		}
 	}
 	else
@@ -571,39 +775,23 @@ bool cPrefabPiecePool::ReadPieceMetadataCubesetVer1(
 		auto lcExpandFloorStrategyStr = StrToLower(ExpandFloorStrategyStr);
 		if (lcExpandFloorStrategyStr == "repeatbottomtillnonair")
 		{
-			a_Prefab->SetExtendFloorStrategy(cPrefab::efsRepeatBottomTillNonAir);
+			a_Props.m_ExtendFloorStrategy = cPrefab::efsRepeatBottomTillNonAir;
 		}
 		else if (lcExpandFloorStrategyStr == "repeatbottomtillsolid")
 		{
-			a_Prefab->SetExtendFloorStrategy(cPrefab::efsRepeatBottomTillSolid);
+			a_Props.m_ExtendFloorStrategy = cPrefab::efsRepeatBottomTillSolid;
 		}
 		else
 		{
 			if (lcExpandFloorStrategyStr != "none")
 			{
 				LOGWARNING("Piece \"%s\" in file \"%s\" is using an unknown \"ExpandFloorStrategy\" attribute value: \"%s\"",
-					a_PieceName.c_str(), a_FileName.c_str(), ExpandFloorStrategyStr.c_str()
+					a_Props.m_Name.c_str(), a_FileName.c_str(), ExpandFloorStrategyStr.c_str()
 				);
 			}
-			a_Prefab->SetExtendFloorStrategy(cPrefab::efsNone);
-		}
-	}
-	if (!VerticalLimit.empty())
-	{
-		if (!a_Prefab->SetVerticalLimitFromString(VerticalLimit, a_LogWarnings))
-		{
-			CONDWARNING(a_LogWarnings, "Unknown VerticalLimit (\"%s\") specified for piece %s in file %s. Using no limit instead.",
-				VerticalLimit.c_str(), a_PieceName.c_str(), a_FileName.c_str()
-			);
+			a_Props.m_ExtendFloorStrategy = cPrefab::efsNone;
 		}
 	}
-	a_Prefab->SetVerticalStrategyFromString(VerticalStrategy, a_LogWarnings);
-
-	AString ModifiersStr;
-	if (a_LuaState.GetNamedValue("Modifiers", ModifiersStr))
-	{
-		a_Prefab->SetPieceModifiersFromString(ModifiersStr, a_LogWarnings);
-	}
 
 	return true;
 }
@@ -700,6 +888,299 @@ bool cPrefabPiecePool::ReadPoolMetadataCubesetVer1(
 
 
 
+bool cPrefabPiecePool::LoadFromCache(
+	const AString & a_FileName,
+	const AString & a_CacheFileName,
+	UInt64 a_SourceHash,
+	size_t a_SourceSize,
+	bool a_LogWarnings
+)
+{
+	// The NBT is parsed directly from the mapped file, without copying:
+	cMemoryMappedFile File;
+	if (!File.Open(a_CacheFileName))
+	{
+		return false;
+	}
+	cParsedNBT NBT(File.GetView());
+	if (!NBT.IsValid())
+	{
+		LOGD("The prefab cache %s is invalid, ignoring it", a_CacheFileName);
+		return false;
+	}
+
+	// Check that the cache belongs to the current cubeset file:
+	int Version = 0;
+	int HashTag = FindCacheChild(NBT, 0, "SourceHash", TAG_Long);
+	int SizeTag = FindCacheChild(NBT, 0, "SourceSize", TAG_Long);
+	if (
+		!ReadCacheInt(NBT, 0, "Version", Version) ||
+		(Version != CACHE_FORMAT_VERSION) ||
+		(HashTag < 0) || (static_cast<UInt64>(NBT.GetLong(HashTag)) != a_SourceHash) ||
+		(SizeTag < 0) || (static_cast<UInt64>(NBT.GetLong(SizeTag)) != a_SourceSize)
+	)
+	{
+		return false;
+	}
+
+	// Read the pool metadata:
+	int MetadataTag = FindCacheChild(NBT, 0, "Metadata", TAG_Compound);
+	if (MetadataTag < 0)
+	{
+		return false;
+	}
+	AStringMap Metadata;
+	for (int Child = NBT.GetFirstChild(MetadataTag); Child >= 0; Child = NBT.GetNextSibling(Child))
+	{
+		if (NBT.GetType(Child) == TAG_String)
+		{
+			Metadata[NBT.GetName(Child)] = NBT.GetString(Child);
+		}
+	}
+
+	// Read all the pieces before adding any, so that an invalid cache doesn't leave a partially loaded pool:
+	int PiecesTag = FindCacheChild(NBT, 0, "Pieces", TAG_List);
+	if (PiecesTag < 0)
+	{
+		return false;
+	}
+	std::vector<std::pair<std::unique_ptr<cPrefab>, sPieceProps>> Pieces;
+	std::vector<int> Size, HitBox, Palette, Connectors;
+	for (int PieceTag = NBT.GetFirstChild(PiecesTag); PieceTag >= 0; PieceTag = NBT.GetNextSibling(PieceTag))
+	{
+		sPieceProps Props;
+		int IsStarting = 0, MoveToGround = 0, ExtendFloorStrategy = 0;
+		int BlocksTag = FindCacheChild(NBT, PieceTag, "Blocks", TAG_ByteArray);
+		if (
+			(BlocksTag < 0) ||
+			!ReadCacheString  (NBT, PieceTag, "Name",                Props.m_Name) ||
+			!ReadCacheInt     (NBT, PieceTag, "IsStarting",          IsStarting) ||
+			!ReadCacheIntArray(NBT, PieceTag, "Size",                Size, 3) ||
+			!ReadCacheIntArray(NBT, PieceTag, "HitBox",              HitBox, 6) ||
+			!ReadCacheIntArray(NBT, PieceTag, "Palette",             Palette) ||
+			!ReadCacheIntArray(NBT, PieceTag, "Connectors",          Connectors) ||
+			!ReadCacheInt     (NBT, PieceTag, "AllowedRotations",    Props.m_AllowedRotations) ||
+			!ReadCacheInt     (NBT, PieceTag, "AddWeightIfSame",     Props.m_AddWeightIfSame) ||
+			!ReadCacheInt     (NBT, PieceTag, "DefaultWeight",       Props.m_DefaultWeight) ||
+			!ReadCacheString  (NBT, PieceTag, "DepthWeight",         Props.m_DepthWeight) ||
+			!ReadCacheString  (NBT, PieceTag, "MergeStrategy",       Props.m_MergeStrategy) ||
+			!ReadCacheInt     (NBT, PieceTag, "MoveToGround",        MoveToGround) ||
+			!ReadCacheInt     (NBT, PieceTag, "ExtendFloorStrategy", ExtendFloorStrategy) ||
+			!ReadCacheString  (NBT, PieceTag, "VerticalLimit",       Props.m_VerticalLimit) ||
+			!ReadCacheString  (NBT, PieceTag, "VerticalStrategy",    Props.m_VerticalStrategy) ||
+			!ReadCacheString  (NBT, PieceTag, "Modifiers",           Props.m_Modifiers) ||
+			(Size[0] <= 0) || (Size[1] <= 0) || (Size[2] <= 0) ||
+			Palette.empty() ||
+			((Connectors.size() % 5) != 0)
+		)
+		{
+			LOGD("The prefab cache %s is damaged, ignoring it", a_CacheFileName);
+			return false;
+		}
+		Props.m_IsStarting = (IsStarting != 0);
+		Props.m_MoveToGround = (MoveToGround != 0);
+		Props.m_ExtendFloorStrategy = static_cast<cPrefab::eExtendFloorStrategy>(ExtendFloorStrategy);
+		Props.m_HitBox.Assign({HitBox[0], HitBox[1], HitBox[2]}, {HitBox[3], HitBox[4], HitBox[5]});
+		for (size_t i = 0; i < Connectors.size(); i += 5)
+		{
+			Props.m_Connectors.emplace_back(
+				Connectors[i], Connectors[i + 1], Connectors[i + 2],
+				Connectors[i + 3], static_cast<cPiece::cConnector::eDirection>(Connectors[i + 4])
+			);
+		}
+
+		// Expand the paletted blocks, in the same order that cPrefab uses when parsing the block image,
+		// so that the block entities are created the same way:
+		const size_t NumBlocks = static_cast<size_t>(Size[0]) * static_cast<size_t>(Size[1]) * static_cast<size_t>(Size[2]);
+		const size_t IndexSize = (Palette.size() > 256) ? 2 : 1;
+		if (NBT.GetDataLength(BlocksTag) != NumBlocks * IndexSize)
+		{
+			LOGD("The prefab cache %s is damaged, ignoring it", a_CacheFileName);
+			return false;
+		}
+		const auto Blocks = reinterpret_cast<const unsigned char *>(NBT.GetData(BlocksTag));
+		cBlockArea Area;
+		Area.Create(Size[0], Size[1], Size[2]);
+		size_t Idx = 0;
+		for (int y = 0; y < Size[1]; y++)
+		{
+			for (int z = 0; z < Size[2]; z++)
+			{
+				for (int x = 0; x < Size[0]; x++, Idx++)
+				{
+					size_t PaletteIdx = (IndexSize == 1) ? Blocks[Idx] : ((Blocks[2 * Idx] << 8) | Blocks[2 * Idx + 1]);
+					if (PaletteIdx >= Palette.size())
+					{
+						LOGD("The prefab cache %s is damaged, ignoring it", a_CacheFileName);
+						return false;
+					}
+					auto Block = Palette[PaletteIdx];
+					Area.SetRelBlockTypeMeta(x, y, z, static_cast<BLOCKTYPE>(Block >> 4), static_cast<NIBBLETYPE>(Block & 0x0f));
+				}
+			}
+		}
+		Pieces.emplace_back(std::make_unique<cPrefab>(Area), std::move(Props));
+	}
+
+	// The cache is valid, load the pool from it:
+	for (const auto & Item: Metadata)
+	{
+		m_Metadata[Item.first] = Item.second;
+	}
+	ApplyBaseMetadataCubesetVer1(a_FileName, a_LogWarnings);
+	for (auto & Piece: Pieces)
+	{
+		AddCubesetPiece(a_FileName, std::move(Piece.first), std::move(Piece.second), a_LogWarnings);
+	}
+	return true;
+}
+
+
+
+
+
+void cPrefabPiecePool::SaveToCache(const AString & a_CacheFileName, UInt64 a_SourceHash, size_t a_SourceSize, size_t a_FirstPiece)
+{
+	for (size_t i = a_FirstPiece; i < m_CubesetPieces.size(); i++)
+	{
+		if (m_CubesetPieces[i].second.m_IsFromSchematic)
+		{
+			return;
+		}
+	}
+
+	cFastNBTWriter Writer;
+	Writer.AddInt("Version", CACHE_FORMAT_VERSION);
+	Writer.AddLong("SourceHash", static_cast<Int64>(a_SourceHash));
+	Writer.AddLong("SourceSize", static_cast<Int64>(a_SourceSize));
+	Writer.BeginCompound("Metadata");
+	for (const auto & Item: m_Metadata)
+	{
+		Writer.AddString(Item.first, Item.second);
+	}
+	Writer.EndCompound();
+
+	Writer.BeginList("Pieces", TAG_Compound);
+	std::vector<Int32> Palette, Connectors;
+	std::vector<int> PaletteIndices(256 * 16);
+	AString Blocks;
+	for (size_t i = a_FirstPiece; i < m_CubesetPieces.size(); i++)
+	{
+		const auto & Props = m_CubesetPieces[i].second;
+		const auto & Area = m_CubesetPieces[i].first->GetBlockArea();
+		const auto Size = Area.GetSize();
+		const size_t NumBlocks = static_cast<size_t>(Size.x * Size.y * Size.z);
+		const auto BlockTypes = Area.GetBlockTypes();
+		const auto BlockMetas = Area.GetBlockMetas();
+		if (BlockTypes == nullptr)
+		{
+			return;
+		}
+
+		// Build the palette of the type / meta combinations used by the piece; the area stores blocks in the YZX order, same as the cache:
+		Palette.clear();
+		std::fill(PaletteIndices.begin(), PaletteIndices.end(), -1);
+		std::vector<int> Indices(NumBlocks);
+		for (size_t Idx = 0; Idx < NumBlocks; Idx++)
+		{
+			int Block = (BlockTypes[Idx] << 4) | ((BlockMetas == nullptr) ? 0 : (BlockMetas[Idx] & 0x0f));
+			if (PaletteIndices[static_cast<size_t>(Block)] < 0)
+			{
+				PaletteIndices[static_cast<size_t>(Block)] = static_cast<int>(Palette.size());
+				Palette.push_back(Block);
+			}
+			Indices[Idx] = PaletteIndices[static_cast<size_t>(Block)];
+		}
+		Blocks.clear();
+		if (Palette.size() > 256)
+		{
+			Blocks.reserve(2 * NumBlocks);
+			for (auto Index: Indices)
+			{
+				Blocks.push_back(static_cast<char>(Index >> 8));
+				Blocks.push_back(static_cast<char>(Index & 0xff));
+			}
+		}
+		else
+		{
+			Blocks.reserve(NumBlocks);
+			for (auto Index: Indices)
+			{
+				Blocks.push_back(static_cast<char>(Index));
+			}
+		}
+
+		Connectors.clear();
+		for (const auto & Connector: Props.m_Connectors)
+		{
+			Connectors.push_back(Connector.m_Pos.x);
+			Connectors.push_back(Connector.m_Pos.y);
+			Connectors.push_back(Connector.m_Pos.z);
+			Connectors.push_back(Connector.m_Type);
+			Connectors.push_back(static_cast<Int32>(Connector.m_Direction));
+		}
+
+		const Int32 SizeArr[] = { Size.x, Size.y, Size.z };
+		const Int32 HitBoxArr[] =
+		{
+			Props.m_HitBox.p1.x, Props.m_HitBox.p1.y, Props.m_HitBox.p1.z,
+			Props.m_HitBox.p2.x, Props.m_HitBox.p2.y, Props.m_HitBox.p2.z
+		};
+		Writer.BeginCompound("");
+		Writer.AddString  ("Name",                Props.m_Name);
+		Writer.AddInt     ("IsStarting",          Props.m_IsStarting ? 1 : 0);
+		Writer.AddIntArray("Size",                SizeArr, ARRAYCOUNT(SizeArr));
+		Writer.AddIntArray("HitBox",              HitBoxArr, ARRAYCOUNT(HitBoxArr));
+		Writer.AddIntArray("Palette",             Palette.data(), Palette.size());
+		Writer.AddByteArray("Blocks",             Blocks.data(), Blocks.size());
+		Writer.AddIntArray("Connectors",          Connectors.data(), Connectors.size());
+		Writer.AddInt     ("AllowedRotations",    Props.m_AllowedRotations);
+		Writer.AddInt     ("AddWeightIfSame",     Props.m_AddWeightIfSame);
+		Writer.AddInt     ("DefaultWeight",       Props.m_DefaultWeight);
+		Writer.AddString  ("DepthWeight",         Props.m_DepthWeight);
+		Writer.AddString  ("MergeStrategy",       Props.m_MergeStrategy);
+		Writer.AddInt     ("MoveToGround",        Props.m_MoveToGround ? 1 : 0);
+		Writer.AddInt     ("ExtendFloorStrategy", static_cast<Int32>(Props.m_ExtendFloorStrategy));
+		Writer.AddString  ("VerticalLimit",       Props.m_VerticalLimit);
+		Writer.AddString  ("VerticalStrategy",    Props.m_VerticalStrategy);
+		Writer.AddString  ("Modifiers",           Props.m_Modifiers);
+		Writer.EndCompound();
+	}
+	Writer.EndList();
+	Writer.Finish();
+
+	// Write into a temporary file first and then rename it, so that a concurrent load never sees a partial cache:
+	const auto TempFileName = fmt::format(FMT_STRING("{}.{}.tmp"), a_CacheFileName, GetRandomProvider().RandInt<UInt32>());
+	{
+		cFile f;
+		const auto Data = Writer.GetResult();
+		if (
+			!f.Open(TempFileName, cFile::fmWrite) ||
+			(f.Write(Data.data(), Data.size()) != static_cast<int>(Data.size()))
+		)
+		{
+			LOGD("Cannot write the prefab cache %s", a_CacheFileName);
+			f.Close();
+			cFile::DeleteFile(TempFileName);
+			return;
+		}
+	}
+	if (!cFile::Rename(TempFileName, a_CacheFileName))
+	{
+		// Some platforms refuse to rename over an existing file, remove the outdated cache and retry:
+		cFile::DeleteFile(a_CacheFileName);
+		if (!cFile::Rename(TempFileName, a_CacheFileName))
+		{
+			LOGD("Cannot write the prefab cache %s", a_CacheFileName);
+			cFile::DeleteFile(TempFileName);
+		}
+	}
+}
+
+
+
+
+
 AString cPrefabPiecePool::GetMetadata(const AString & a_ParamName) const
 {
 	auto itr = m_Metadata.find(a_ParamName);
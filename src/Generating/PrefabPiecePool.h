@@ -3,6 +3,16 @@
 
 // Declares the cPrefabPiecePool class that represents a cPiecePool descendant that uses cPrefab instances as the pieces
 
+/*
+Loading a cubeset file means running it in a Lua interpreter and building each piece's block area from its text
+definition, which is slow for the larger pools. Therefore once a cubeset file is loaded, the pool is written into
+a binary cache file next to it, "<FileName>.cache". The cache is an NBT structure holding the pool's metadata and,
+for each piece, its properties, connectors and paletted block data. It is keyed by the hash and size of the
+cubeset file's contents, so that an edited cubeset is loaded from the source again. Subsequent loads map the
+cache file into memory and build the pieces directly from it.
+Pools that reference external schematic files are not cached, the schematics may change independently.
+*/
+
 
 
 
@@ -67,6 +77,7 @@ public:
 	);
 
 	/** Loads the pieces from the specified file. Returns true if successful, false on error.
+	Uses the file's binary cache if it is up to date, and writes the cache otherwise.
 	If a_LogWarnings is true, logs a warning to console when loading fails. */
 	bool LoadFromFile(const AString & a_FileName, bool a_LogWarnings);
 
@@ -82,6 +93,11 @@ public:
 	If a_LogWarnings is true, logs a warning to console when loading fails. */
 	bool LoadFromCubeset(const AString & a_Contents, const AString & a_FileName, bool a_LogWarnings);
 
+	/** Adds copies of all the pieces that a_Pool has loaded from cubeset files, and copies a_Pool's metadata.
+	The copies share their block data with a_Pool's pieces, so that a pool loaded once may be used by many generators.
+	Each copy gets its own vertical strategy, limit and modifiers, which are then bound to its generator by AssignGens(). */
+	void CopyFrom(const cPrefabPiecePool & a_Pool);
+
 	/** Returns the number of regular (non-starting) pieces. */
 	size_t GetAllPiecesCount(void) const { return m_AllPieces.size(); }
 
@@ -123,6 +139,29 @@ protected:
 	/** The type used to map a connector type to the list of pieces with that connector */
 	typedef std::map<int, cPieces> cPiecesMap;
 
+	/** The properties of a piece, other than its blocks, as given in the cubeset file. */
+	struct sPieceProps
+	{
+		AString m_Name;
+		bool m_IsStarting = false;
+
+		/** True if the blocks come from an external schematic file, such pieces cannot be cached. */
+		bool m_IsFromSchematic = false;
+
+		cCuboid m_HitBox;
+		cPiece::cConnectors m_Connectors;
+		int m_AllowedRotations = 0;
+		int m_AddWeightIfSame = 0;
+		int m_DefaultWeight = 100;
+		AString m_DepthWeight;
+		AString m_MergeStrategy;
+		bool m_MoveToGround = false;
+		cPrefab::eExtendFloorStrategy m_ExtendFloorStrategy = cPrefab::efsNone;
+		AString m_VerticalLimit;
+		AString m_VerticalStrategy;
+		AString m_Modifiers;
+	};
+
 
 	/** All the pieces that are allowed for building.
 	This is the list that's used for memory allocation and deallocation for the pieces. */
@@ -163,6 +202,10 @@ protected:
 	/** A dictionary of pool-wide metadata, as read from the cubeset file. */
 	AStringMap m_Metadata;
 
+	/** The pieces loaded from cubeset files, with their properties, in the order in which they were loaded.
+	Used for writing the binary cache. The prefabs are owned by m_AllPieces / m_StartingPieces. */
+	std::vector<std::pair<const cPrefab *, sPieceProps>> m_CubesetPieces;
+
 
 	/** Adds the prefab to the m_PiecesByConnector map for all its connectors. */
 	void AddToPerConnectorMap(cPrefab * a_Prefab);
@@ -183,45 +226,66 @@ protected:
 	/** Loads a single piece's prefab from the cubeset file parsed into the specified Lua state.
 	The piece's definition table is expected to be at the top of the Lua stack.
 	Returns the prefab on success, nullptr on failure.
-	a_PieceName is the identification of the piece, used for logging only.
+	a_Props is the piece's properties; its name is used for logging, and it is marked if the prefab comes from a schematic file.
 	If a_LogWarnings is true, logs a warning to console when loading fails. */
 	std::unique_ptr<cPrefab> LoadPrefabFromCubesetVer1(
 		const AString & a_FileName,
 		cLuaState & a_LuaState,
-		const AString & a_PieceName,
+		sPieceProps & a_Props,
 		bool a_LogWarnings
 	);
 
 	/** Reads a single piece's connectors from the cubeset file parsed into the specified Lua state.
 	The piece's definition table is expected to be at the top of the Lua stack.
 	Returns true on success, false on failure.
-	The connectors are added into the a_Prefab object.
+	The connectors are added into a_Props.
 	No Connectors table is considered a failure, empty Connectors table is considered a success.
 	If any of the connectors are malformed, it is considered a failure, although the rest of the connectors will still load.
-	a_PieceName is the identification of the piece, used for logging only.
 	If a_LogWarnings is true, logs a warning to console when loading fails. */
 	bool ReadConnectorsCubesetVer1(
 		const AString & a_FileName,
 		cLuaState & a_LuaState,
-		const AString & a_PieceName,
-		cPrefab * a_Prefab,
+		sPieceProps & a_Props,
 		bool a_LogWarnings
 	);
 
 	/** Reads a single piece's metadata from the cubeset file parsed into the specified Lua state.
 	The piece's definition table is expected to be at the top of the Lua stack.
 	Returns true on success, false on failure.
-	The metadata is applied into the a_Prefab object.
-	a_PieceName is the identification of the piece, used for logging only.
+	The metadata is stored into a_Props.
 	If a_LogWarnings is true, logs a warning to console when loading fails. */
 	bool ReadPieceMetadataCubesetVer1(
 		const AString & a_FileName,
 		cLuaState & a_LuaState,
-		const AString & a_PieceName,
-		cPrefab * a_Prefab,
+		sPieceProps & a_Props,
+		bool a_LogWarnings
+	);
+
+	/** Applies the properties to the prefab and adds it into the pool, as a starting piece or a regular one.
+	The properties are kept in m_CubesetPieces for writing the cache.
+	If a_LogWarnings is true, logs a warning to console about invalid properties. */
+	void AddCubesetPiece(
+		const AString & a_FileName,
+		std::unique_ptr<cPrefab> a_Prefab,
+		sPieceProps && a_Props,
 		bool a_LogWarnings
 	);
 
+	/** Creates the prefab's vertical limit, vertical strategy and modifiers from the properties.
+	If a_LogWarnings is true, logs a warning to console about invalid properties. */
+	void ApplyPlacementProps(const AString & a_FileName, cPrefab & a_Prefab, const sPieceProps & a_Props, bool a_LogWarnings);
+
+	/** Adds the prefab into the pool, as a starting piece or a regular one, and keeps its properties in m_CubesetPieces. */
+	void AddPiece(std::unique_ptr<cPrefab> a_Prefab, sPieceProps && a_Props);
+
+	/** Loads the pool from the binary cache file, if it was created from a cubeset with the specified hash and size.
+	Returns true if successful; false if the cache doesn't exist, is outdated or invalid, in which case nothing is loaded. */
+	bool LoadFromCache(const AString & a_FileName, const AString & a_CacheFileName, UInt64 a_SourceHash, size_t a_SourceSize, bool a_LogWarnings);
+
+	/** Writes the pool's metadata and the pieces in m_CubesetPieces, starting at a_FirstPiece, into the binary cache file.
+	Does nothing if any of the pieces cannot be cached. Failures are not fatal, the cubeset is simply loaded again the next time. */
+	void SaveToCache(const AString & a_CacheFileName, UInt64 a_SourceHash, size_t a_SourceSize, size_t a_FirstPiece);
+
 	/** Reads the metadata for the entire pool from the cubeset file, stores it in the m_Metadata map.
 	Returns true on success, false on failure.
 	If a_LogWarnings is true, logs a warning to console when loading fails. */
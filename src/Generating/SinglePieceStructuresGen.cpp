@@ -1,5 +1,6 @@
 
 #include "SinglePieceStructuresGen.h"
+#include "ChunkDataCache.h"
 
 #include "PrefabStructure.h"
 #include "../IniFile.h"
@@ -25,17 +26,19 @@ public:
 
 
 
-	/** Loads the piecepool from a file.
+	/** Loads the piecepool from a file, through the caches shared by the generators of the world.
 	Returns true on success, logs warning and returns false on failure. */
-	bool LoadFromFile(const AString & a_FileName)
+	bool LoadFromFile(const AString & a_FileName, cGeneratorCaches & a_Caches)
 	{
 		m_PiecePool.Clear();
 
-		// Load the piecepool from the file, log any warnings:
-		if (!m_PiecePool.LoadFromFile(a_FileName, true))
+		// Copy the piecepool loaded from the file, the first generator to load it logs any warnings:
+		auto PiecePool = a_Caches.GetPrefabPiecePool(a_FileName, true);
+		if (PiecePool == nullptr)
 		{
 			return false;
 		}
+		m_PiecePool.CopyFrom(*PiecePool);
 		if (NoCaseCompare(m_PiecePool.GetIntendedUse(), "SinglePieceStructures") != 0)
 		{
 			LOGWARNING("SinglePieceStructures generator: File %s is intended for use in \"%s\", rather than single piece structures. Loading the file, but the generator may behave unexpectedly.",
@@ -160,7 +163,7 @@ cSinglePieceStructuresGen::cSinglePieceStructuresGen(int a_Seed) :
 
 
 
-bool cSinglePieceStructuresGen::Initialize(const AString & a_Prefabs, int a_SeaLevel, cBiomeGen & a_BiomeGen, cTerrainHeightGen & a_HeightGen)
+bool cSinglePieceStructuresGen::Initialize(const AString & a_Prefabs, int a_SeaLevel, cBiomeGen & a_BiomeGen, cTerrainHeightGen & a_HeightGen, cGeneratorCaches & a_Caches)
 {
 	// Load each piecepool:
 	auto Structures = StringSplitAndTrim(a_Prefabs, "|");
@@ -178,7 +181,7 @@ bool cSinglePieceStructuresGen::Initialize(const AString & a_Prefabs, int a_SeaL
 		}
 
 		auto Gen = std::make_shared<cGen>(m_Seed, a_BiomeGen, a_HeightGen, a_SeaLevel, S);
-		if (Gen->LoadFromFile(FileName))
+		if (Gen->LoadFromFile(FileName, a_Caches))
 		{
 			m_Gens.push_back(Gen);
 		}
@@ -5,6 +5,7 @@
 
 #include "Globals.h"
 #include "VillageGen.h"
+#include "ChunkDataCache.h"
 #include "PieceGeneratorBFSTree.h"
 #include "../BlockInfo.h"
 
@@ -340,7 +341,8 @@ cVillageGen::cVillageGen(
 	cBiomeGen & a_BiomeGen,
 	cTerrainHeightGen & a_HeightGen,
 	int a_SeaLevel,
-	const AStringVector & a_PrefabsToLoad
+	const AStringVector & a_PrefabsToLoad,
+	cGeneratorCaches & a_Caches
 ) :
 	Super(a_Seed, a_GridSize, a_GridSize, a_MaxOffset, a_MaxOffset, a_MaxSize, a_MaxSize, 100),
 	m_RandNoise(a_Seed + 1000),
@@ -353,10 +355,12 @@ cVillageGen::cVillageGen(
 {
 	for (const auto & toLoad: a_PrefabsToLoad)
 	{
-		auto prefabs = std::make_shared<cVillagePiecePool>();
 		auto fileName = fmt::format(FMT_STRING("Prefabs{0}Villages{0}{1}.cubeset"), cFile::GetPathSeparator(), toLoad);
-		if (prefabs->LoadFromFile(fileName, true))
+		auto loaded = a_Caches.GetPrefabPiecePool(fileName, true);
+		if (loaded != nullptr)
 		{
+			auto prefabs = std::make_shared<cVillagePiecePool>();
+			prefabs->CopyFrom(*loaded);
 			if (NoCaseCompare(prefabs->GetIntendedUse(), "village") != 0)
 			{
 				LOGWARNING("Village generator: File %s is intended for use in \"%s\", rather than villages. Loading the file, but the generator may behave unexpectedly.",
@@ -30,7 +30,8 @@ class cVillageGen:
 
 public:
 
-	/** Creates a new instance of the generator with the specified parameters. */
+	/** Creates a new instance of the generator with the specified parameters.
+	The prefabs are loaded through a_Caches, so that all the generators of the world share their block data. */
 	cVillageGen(
 		int a_Seed,
 		int a_GridSize,
@@ -41,7 +42,8 @@ public:
 		cBiomeGen & a_BiomeGen,
 		cTerrainHeightGen & a_HeightGen,
 		int a_SeaLevel,
-		const AStringVector & a_PrefabsToLoad
+		const AStringVector & a_PrefabsToLoad,
+		cGeneratorCaches & a_Caches
 	);
 
 protected:
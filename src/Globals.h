@@ -134,6 +134,7 @@
 #include <queue>
 #include <random>
 #include <set>
+#include <shared_mutex>
 #include <string>
 #include <thread>
 #include <type_traits>
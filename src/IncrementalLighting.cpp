@@ -0,0 +1,296 @@
+
+// IncrementalLighting.cpp
+
+// Implements the cIncrementalLighting class that updates the light around individual block changes
+
+#include "Globals.h"
+#include "IncrementalLighting.h"
+#include "BlockInfo.h"
+#include "BlockType.h"
+
+
+
+
+
+namespace
+{
+	/** The six directions light spreads in; the down direction is the last one. */
+	const std::array<Vector3i, 6> Directions =
+	{{
+		{  1,  0,  0 },
+		{ -1,  0,  0 },
+		{  0,  0,  1 },
+		{  0,  0, -1 },
+		{  0,  1,  0 },
+		{  0, -1,  0 },
+	}};
+
+	constexpr size_t DirectionDown = 5;
+}
+
+
+
+
+
+cIncrementalLighting::cIncrementalLighting(void) :
+	m_Chunks(nullptr)
+{
+}
+
+
+
+
+
+bool cIncrementalLighting::Relight(cNeighborhood & a_Chunks, const std::vector<Vector3i> & a_Changes)
+{
+	// Too many changes at once (e.g. a large area fill) are cheaper to relight as a whole:
+	if (a_Changes.size() > MaxChanges)
+	{
+		return false;
+	}
+
+	// All the chunks the light may reach must be present and have valid light to start from:
+	for (auto & Row : a_Chunks)
+	{
+		for (auto & Chunk : Row)
+		{
+			if ((Chunk.m_BlockData == nullptr) || (Chunk.m_LightData == nullptr))
+			{
+				return false;
+			}
+			Chunk.m_IsChanged = false;
+		}
+	}
+
+	m_Chunks = &a_Chunks;
+	RelightType(a_Changes, false);
+	RelightType(a_Changes, true);
+	m_Chunks = nullptr;
+	return true;
+}
+
+
+
+
+
+void cIncrementalLighting::RelightType(const std::vector<Vector3i> & a_Changes, const bool a_IsSkyLight)
+{
+	m_Removals.clear();
+	m_Propagations.clear();
+
+	// Clear the light that may have come through the changed blocks:
+	for (const auto & Change : a_Changes)
+	{
+		const auto Light = GetLight(Change, a_IsSkyLight);
+		if (Light > 0)
+		{
+			SetLight(Change, a_IsSkyLight, 0);
+			m_Removals.push_back({ Change, Light });
+		}
+	}
+	RunRemovals(a_IsSkyLight);
+
+	// Let the light in again, both from the changed blocks themselves and from their neighbors:
+	for (const auto & Change : a_Changes)
+	{
+		const auto Emitted = GetEmittedLight(GetBlock(Change), Change.y, a_IsSkyLight);
+		if (Emitted > GetLight(Change, a_IsSkyLight))
+		{
+			SetLight(Change, a_IsSkyLight, Emitted);
+			m_Propagations.push_back(Change);
+		}
+		for (const auto & Direction : Directions)
+		{
+			if (GetLight(Change + Direction, a_IsSkyLight) > 0)
+			{
+				m_Propagations.push_back(Change + Direction);
+			}
+		}
+	}
+	RunPropagations(a_IsSkyLight);
+}
+
+
+
+
+
+void cIncrementalLighting::RunRemovals(const bool a_IsSkyLight)
+{
+	// The queue grows while being processed, so it's walked by index:
+	for (size_t i = 0; i < m_Removals.size(); i++)
+	{
+		const auto Removal = m_Removals[i];
+		for (size_t d = 0; d < Directions.size(); d++)
+		{
+			const auto Neighbor = Removal.m_Pos + Directions[d];
+			const auto NeighborLight = GetLight(Neighbor, a_IsSkyLight);
+			if (NeighborLight == 0)
+			{
+				continue;
+			}
+
+			// Full skylight below full skylight came straight down through the removed block:
+			const bool IsSkyColumn = a_IsSkyLight && (d == DirectionDown) && (Removal.m_Light == 15) && (NeighborLight == 15);
+			if ((NeighborLight >= Removal.m_Light) && !IsSkyColumn)
+			{
+				// The neighbor is lit from elsewhere, it will spread its light back into the cleared area:
+				m_Propagations.push_back(Neighbor);
+				continue;
+			}
+
+			SetLight(Neighbor, a_IsSkyLight, 0);
+			m_Removals.push_back({ Neighbor, NeighborLight });
+
+			// Light sources in the cleared area keep their own light:
+			const auto Emitted = GetEmittedLight(GetBlock(Neighbor), Neighbor.y, a_IsSkyLight);
+			if (Emitted > 0)
+			{
+				SetLight(Neighbor, a_IsSkyLight, Emitted);
+				m_Propagations.push_back(Neighbor);
+			}
+		}
+	}
+}
+
+
+
+
+
+void cIncrementalLighting::RunPropagations(const bool a_IsSkyLight)
+{
+	// The queue grows while being processed, so it's walked by index:
+	for (size_t i = 0; i < m_Propagations.size(); i++)
+	{
+		const auto Pos = m_Propagations[i];
+		const auto Light = GetLight(Pos, a_IsSkyLight);
+		if (Light == 0)
+		{
+			continue;
+		}
+
+		for (size_t d = 0; d < Directions.size(); d++)
+		{
+			const auto Neighbor = Pos + Directions[d];
+			auto NeighborPos = Neighbor;
+			if (GetChunkAdjustPos(NeighborPos) == nullptr)
+			{
+				continue;
+			}
+
+			const auto NeighborBlock = GetBlock(Neighbor);
+			NIBBLETYPE NewLight;
+			if (a_IsSkyLight && (d == DirectionDown) && (Light == 15) && PassesFullSkyLight(NeighborBlock))
+			{
+				NewLight = 15;
+			}
+			else
+			{
+				const auto Falloff = cBlockInfo::GetSpreadLightFalloff(NeighborBlock);
+				if (Light <= Falloff)
+				{
+					continue;
+				}
+				NewLight = static_cast<NIBBLETYPE>(Light - Falloff);
+			}
+
+			if (NewLight > GetLight(Neighbor, a_IsSkyLight))
+			{
+				SetLight(Neighbor, a_IsSkyLight, NewLight);
+				m_Propagations.push_back(Neighbor);
+			}
+		}
+	}
+}
+
+
+
+
+
+cIncrementalLighting::sChunk * cIncrementalLighting::GetChunkAdjustPos(Vector3i & a_RelPos) const
+{
+	if (
+		(a_RelPos.y < 0) || (a_RelPos.y >= cChunkDef::Height) ||
+		(a_RelPos.x < -cChunkDef::Width) || (a_RelPos.x >= 2 * cChunkDef::Width) ||
+		(a_RelPos.z < -cChunkDef::Width) || (a_RelPos.z >= 2 * cChunkDef::Width)
+	)
+	{
+		return nullptr;
+	}
+
+	const auto OffsetX = (a_RelPos.x + cChunkDef::Width) / cChunkDef::Width;
+	const auto OffsetZ = (a_RelPos.z + cChunkDef::Width) / cChunkDef::Width;
+	a_RelPos.x -= (OffsetX - 1) * cChunkDef::Width;
+	a_RelPos.z -= (OffsetZ - 1) * cChunkDef::Width;
+	return &(*m_Chunks)[static_cast<size_t>(OffsetX)][static_cast<size_t>(OffsetZ)];
+}
+
+
+
+
+
+NIBBLETYPE cIncrementalLighting::GetLight(Vector3i a_RelPos, const bool a_IsSkyLight) const
+{
+	const auto Chunk = GetChunkAdjustPos(a_RelPos);
+	if (Chunk == nullptr)
+	{
+		return 0;
+	}
+	return a_IsSkyLight ? Chunk->m_LightData->GetSkyLight(a_RelPos) : Chunk->m_LightData->GetBlockLight(a_RelPos);
+}
+
+
+
+
+
+BLOCKTYPE cIncrementalLighting::GetBlock(Vector3i a_RelPos) const
+{
+	const auto Chunk = GetChunkAdjustPos(a_RelPos);
+	if (Chunk == nullptr)
+	{
+		return E_BLOCK_STONE;
+	}
+	return Chunk->m_BlockData->GetBlock(a_RelPos);
+}
+
+
+
+
+
+void cIncrementalLighting::SetLight(Vector3i a_RelPos, const bool a_IsSkyLight, const NIBBLETYPE a_Light)
+{
+	const auto Chunk = GetChunkAdjustPos(a_RelPos);
+	ASSERT(Chunk != nullptr);
+
+	if (a_IsSkyLight)
+	{
+		Chunk->m_LightData->SetSkyLight(a_RelPos, a_Light);
+	}
+	else
+	{
+		Chunk->m_LightData->SetBlockLight(a_RelPos, a_Light);
+	}
+	Chunk->m_IsChanged = true;
+}
+
+
+
+
+
+NIBBLETYPE cIncrementalLighting::GetEmittedLight(const BLOCKTYPE a_BlockType, const int a_RelY, const bool a_IsSkyLight)
+{
+	if (!a_IsSkyLight)
+	{
+		return cBlockInfo::GetLightValue(a_BlockType);
+	}
+	return ((a_RelY == cChunkDef::Height - 1) && PassesFullSkyLight(a_BlockType)) ? 15 : 0;
+}
+
+
+
+
+
+bool cIncrementalLighting::PassesFullSkyLight(const BLOCKTYPE a_BlockType)
+{
+	// Same condition as the skylight columns filled by cLightingThread:
+	return cBlockInfo::IsTransparent(a_BlockType) && !cBlockInfo::IsSkylightDispersant(a_BlockType);
+}
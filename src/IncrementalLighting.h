@@ -0,0 +1,108 @@
+// IncrementalLighting.h
+
+// Interfaces to the cIncrementalLighting class that updates the light around individual block changes
+
+/*
+Relighting a whole chunk in cLightingThread means a flood fill over the 3x3 chunk neighborhood, which is far too
+expensive for a single placed or removed block. Instead, the changes are collected in each chunk and processed
+once per tick, in two breadth-first passes over the blocks around them:
+1. Removal: the light around each changed block is cleared, as far as it could have come through that block.
+	The lit blocks at the border of the cleared area are remembered as sources for the next pass.
+2. Propagation: light spreads again from the border sources, from light-emitting blocks, and from the neighbors of
+	the changed blocks, using the same falloff rules as the full calculation.
+Skylight spreads straight down without falloff, through transparent blocks that don't disperse it, same as the
+columns filled by the full calculation.
+Light never travels more than 15 blocks, so all the work stays within the 3x3 chunks around the changed chunk.
+*/
+
+
+
+
+
+#pragma once
+
+#include "ChunkData.h"
+
+
+
+
+
+class cIncrementalLighting
+{
+public:
+
+	/** The number of changes above which the whole chunk is cheaper to relight than to update incrementally. */
+	static constexpr size_t MaxChanges = 1024;
+
+
+	/** The data of one of the 3x3 chunks that the light is updated in. */
+	struct sChunk
+	{
+		/** The chunk's blocks and light; both nullptr if the chunk isn't valid and lit. */
+		const ChunkBlockData * m_BlockData;
+		ChunkLightData * m_LightData;
+
+		/** Set by Relight() if the chunk's light has changed. */
+		bool m_IsChanged;
+	};
+
+	/** The 3x3 chunks around the changed chunk, indexed by [OffsetX + 1][OffsetZ + 1] relative to it. */
+	using cNeighborhood = std::array<std::array<sChunk, 3>, 3>;
+
+
+	cIncrementalLighting(void);
+
+	/** Updates the block light and skylight around the specified blocks of the middle chunk, which have changed since the light was last valid.
+	Light changes are written into the chunks' light data, and their m_IsChanged is set.
+	Returns false without changing anything if any of the chunks isn't valid and lit, or if there are more than MaxChanges changes;
+	the caller should have the whole chunk relit then. */
+	bool Relight(cNeighborhood & a_Chunks, const std::vector<Vector3i> & a_Changes);
+
+private:
+
+	struct sRemoval
+	{
+		Vector3i m_Pos;
+		NIBBLETYPE m_Light;
+	};
+
+	/** The 3x3 chunks being updated, valid only during Relight(). */
+	cNeighborhood * m_Chunks;
+
+	/** Queue of blocks whose light has been cleared, together with the light they had.
+	Kept between calls so that its storage is reused. */
+	std::vector<sRemoval> m_Removals;
+
+	/** Queue of blocks whose light should spread into their neighbors.
+	Kept between calls so that its storage is reused. */
+	std::vector<Vector3i> m_Propagations;
+
+	/** Updates one kind of light around the changes. */
+	void RelightType(const std::vector<Vector3i> & a_Changes, bool a_IsSkyLight);
+
+	/** Clears the light spreading from the queued removals, queues the lit blocks around the cleared area into m_Propagations. */
+	void RunRemovals(bool a_IsSkyLight);
+
+	/** Spreads the light from the blocks queued in m_Propagations. */
+	void RunPropagations(bool a_IsSkyLight);
+
+	/** Returns the chunk containing the position relative to the middle chunk, and adjusts the position to be relative to it.
+	Returns nullptr for positions outside the 3x3 chunks or outside the world vertically. */
+	sChunk * GetChunkAdjustPos(Vector3i & a_RelPos) const;
+
+	/** Returns the light at the position relative to the middle chunk, 0 outside the 3x3 chunks. */
+	NIBBLETYPE GetLight(Vector3i a_RelPos, bool a_IsSkyLight) const;
+
+	/** Returns the block type at the position relative to the middle chunk, stone outside the 3x3 chunks so that no light passes. */
+	BLOCKTYPE GetBlock(Vector3i a_RelPos) const;
+
+	/** Sets the light at the position relative to the middle chunk, the position must be inside the 3x3 chunks. */
+	void SetLight(Vector3i a_RelPos, bool a_IsSkyLight, NIBBLETYPE a_Light);
+
+	/** Returns the light the block emits by itself: its light value for block light,
+	full light for skylight at the top of the world in a block that lets the skylight through. */
+	static NIBBLETYPE GetEmittedLight(BLOCKTYPE a_BlockType, int a_RelY, bool a_IsSkyLight);
+
+	/** Returns true if full skylight passes down through the block without any falloff. */
+	static bool PassesFullSkyLight(BLOCKTYPE a_BlockType);
+};
@@ -7,113 +7,64 @@
 #include "LightingThread.h"
 #include "ChunkMap.h"
 #include "World.h"
-#include "BlockInfo.h"
 
 
 
 
 
-/** Chunk data callback that takes the chunk data and puts them into cLightingThread's m_BlockTypes[] / m_HeightMap[]: */
-class cReader :
-	public cChunkDataCallback
-{
-	virtual void ChunkData(const ChunkBlockData & a_BlockData, const ChunkLightData &) override
-	{
-		BLOCKTYPE * OutputRows = m_BlockTypes;
-		int OutputIdx = m_ReadingChunkX + m_ReadingChunkZ * cChunkDef::Width * 3;
-		for (size_t i = 0; i != cChunkDef::NumSections; ++i)
-		{
-			const auto Section = a_BlockData.GetSection(i);
-			if (Section == nullptr)
-			{
-				// Skip to the next section
-				OutputIdx += 9 * cChunkDef::SectionHeight * cChunkDef::Width;
-				continue;
-			}
+////////////////////////////////////////////////////////////////////////////////
+// cLightingThread:
 
-			for (size_t OffsetY = 0; OffsetY != cChunkDef::SectionHeight; ++OffsetY)
-			{
-				for (size_t Z = 0; Z != cChunkDef::Width; ++Z)
-				{
-					auto InPtr = Section->data() + Z * cChunkDef::Width + OffsetY * cChunkDef::Width * cChunkDef::Width;
-					std::copy_n(InPtr, cChunkDef::Width, OutputRows + OutputIdx * cChunkDef::Width);
-
-					OutputIdx += 3;
-				}
-				// Skip into the next y-level in the 3x3 chunk blob; each level has cChunkDef::Width * 9 rows
-				// We've already walked cChunkDef::Width * 3 in the "for z" cycle, that makes cChunkDef::Width * 6 rows left to skip
-				OutputIdx += cChunkDef::Width * 6;
-			}
-		}
-	}  // BlockTypes()
+cLightingThread::cLightingThread(cWorld & a_World):
+	m_World(a_World),
+	m_ShouldTerminate(false),
+	m_NumLit(0)
+{
+	SetNumWorkers(1);
+}
 
 
-	virtual void HeightMap(const cChunkDef::HeightMap & a_Heightmap) override
-	{
-		// Copy the entire heightmap, distribute it into the 3x3 chunk blob:
-		typedef struct {HEIGHTTYPE m_Row[16]; } ROW;
-		const ROW * InputRows  = reinterpret_cast<const ROW *>(a_Heightmap);
-		ROW * OutputRows = reinterpret_cast<ROW *>(m_HeightMap);
-		int InputIdx = 0;
-		int OutputIdx = m_ReadingChunkX + m_ReadingChunkZ * cChunkDef::Width * 3;
-		for (int z = 0; z < cChunkDef::Width; z++)
-		{
-			OutputRows[OutputIdx] = InputRows[InputIdx++];
-			OutputIdx += 3;
-		}  // for z
 
-		// Find the highest block in the entire chunk, use it as a base for m_MaxHeight:
-		HEIGHTTYPE MaxHeight = m_MaxHeight;
-		for (size_t i = 0; i < ARRAYCOUNT(a_Heightmap); i++)
-		{
-			if (a_Heightmap[i] > MaxHeight)
-			{
-				MaxHeight = a_Heightmap[i];
-			}
-		}
-		m_MaxHeight = MaxHeight;
-	}
 
-public:
-	int m_ReadingChunkX;  // 0, 1 or 2; x-offset of the chunk we're reading from the BlockTypes start
-	int m_ReadingChunkZ;  // 0, 1 or 2; z-offset of the chunk we're reading from the BlockTypes start
-	HEIGHTTYPE m_MaxHeight;  // Maximum value in this chunk's heightmap
-	BLOCKTYPE * m_BlockTypes;  // 3x3 chunks of block types, organized as a single XZY blob of data (instead of 3x3 XZY blobs)
-	HEIGHTTYPE * m_HeightMap;  // 3x3 chunks of height map,  organized as a single XZY blob of data (instead of 3x3 XZY blobs)
-
-	cReader(BLOCKTYPE * a_BlockTypes, HEIGHTTYPE * a_HeightMap) :
-		m_ReadingChunkX(0),
-		m_ReadingChunkZ(0),
-		m_MaxHeight(0),
-		m_BlockTypes(a_BlockTypes),
-		m_HeightMap(a_HeightMap)
-	{
-		std::fill_n(m_BlockTypes, cChunkDef::NumBlocks * 9, E_BLOCK_AIR);
-	}
-} ;
 
+cLightingThread::~cLightingThread()
+{
+	Stop();
+}
 
 
 
 
-////////////////////////////////////////////////////////////////////////////////
-// cLightingThread:
 
-cLightingThread::cLightingThread(cWorld & a_World):
-	Super("Lighting Executor"),
-	m_World(a_World),
-	m_MaxHeight(0),
-	m_NumSeeds(0)
+void cLightingThread::SetNumWorkers(unsigned a_NumWorkers)
 {
+	cCSLock Lock(m_CS);
+
+	// Keep any chunks already queued, they will be distributed among the new workers:
+	cChunkStays Queued;
+	for (auto & Worker : m_Workers)
+	{
+		Queued.splice(Queued.end(), Worker->m_Queue);
+	}
+
+	m_Workers.clear();
+	for (size_t i = 0; i < std::max(a_NumWorkers, 1U); i++)
+	{
+		m_Workers.push_back(std::make_unique<cWorker>(*this, i));
+	}
+	m_Workers.front()->m_Queue = std::move(Queued);
 }
 
 
 
 
 
-cLightingThread::~cLightingThread()
+void cLightingThread::Start(void)
 {
-	Stop();
+	for (auto & Worker : m_Workers)
+	{
+		Worker->Start();
+	}
 }
 
 
@@ -130,17 +81,23 @@ void cLightingThread::Stop(void)
 			delete *itr;
 		}
 		m_PendingQueue.clear();
-		for (cChunkStays::iterator itr = m_Queue.begin(), end = m_Queue.end(); itr != end; ++itr)
+		for (auto & Worker : m_Workers)
 		{
-			(*itr)->Disable();
-			delete *itr;
+			for (auto ChunkStay : Worker->m_Queue)
+			{
+				ChunkStay->Disable();
+				delete ChunkStay;
+			}
+			Worker->m_Queue.clear();
 		}
-		m_Queue.clear();
+		m_ShouldTerminate = true;
 	}
-	m_ShouldTerminate = true;
-	m_evtItemAdded.Set();
 
-	Super::Stop();
+	for (auto & Worker : m_Workers)
+	{
+		Worker->Stop();
+	}
+	m_evtQueueEmpty.SetAll();
 }
 
 
@@ -166,7 +123,7 @@ void cLightingThread::QueueChunk(int a_ChunkX, int a_ChunkZ, std::unique_ptr<cCh
 void cLightingThread::WaitForQueueEmpty(void)
 {
 	cCSLock Lock(m_CS);
-	while (!m_ShouldTerminate && (!m_Queue.empty() || !m_PendingQueue.empty()))
+	while (!m_ShouldTerminate && !IsIdle())
 	{
 		cCSUnlock Unlock(Lock);
 		m_evtQueueEmpty.Wait();
@@ -180,361 +137,173 @@ void cLightingThread::WaitForQueueEmpty(void)
 size_t cLightingThread::GetQueueLength(void)
 {
 	cCSLock Lock(m_CS);
-	return m_Queue.size() + m_PendingQueue.size();
+	size_t Length = m_PendingQueue.size();
+	for (const auto & Worker : m_Workers)
+	{
+		Length += Worker->m_Queue.size();
+	}
+	return Length;
 }
 
 
 
 
 
-void cLightingThread::Execute(void)
+std::vector<size_t> cLightingThread::GetWorkerQueueLengths(void)
 {
-	for (;;)
+	cCSLock Lock(m_CS);
+	std::vector<size_t> Lengths;
+	Lengths.reserve(m_Workers.size());
+	for (const auto & Worker : m_Workers)
 	{
-		{
-			cCSLock Lock(m_CS);
-			if (m_Queue.empty())
-			{
-				cCSUnlock Unlock(Lock);
-				m_evtItemAdded.Wait();
-			}
-		}
-
-		if (m_ShouldTerminate)
-		{
-			return;
-		}
-
-		// Process one items from the queue:
-		cLightingChunkStay * Item;
-		{
-			cCSLock Lock(m_CS);
-			if (m_Queue.empty())
-			{
-				continue;
-			}
-			Item = static_cast<cLightingChunkStay *>(m_Queue.front());
-			m_Queue.pop_front();
-			if (m_Queue.empty())
-			{
-				m_evtQueueEmpty.Set();
-			}
-		}  // CSLock(m_CS)
-
-		LightChunk(*Item);
-		Item->Disable();
-		delete Item;
+		Lengths.push_back(Worker->m_Queue.size() + (Worker->m_IsBusy ? 1 : 0));
 	}
+	return Lengths;
 }
 
 
 
 
 
-void cLightingThread::LightChunk(cLightingChunkStay & a_Item)
+void cLightingThread::QueueChunkStay(cLightingChunkStay & a_ChunkStay)
 {
-	// If the chunk is already lit, skip it (report as success):
-	if (m_World.IsChunkLighted(a_Item.m_ChunkX, a_Item.m_ChunkZ))
+	cWorker * Target;
 	{
-		if (a_Item.m_CallbackAfter != nullptr)
-		{
-			a_Item.m_CallbackAfter->Call({a_Item.m_ChunkX, a_Item.m_ChunkZ}, true);
-		}
-		return;
-	}
-
-	cChunkDef::BlockNibbles BlockLight, SkyLight;
-
-	ReadChunks(a_Item.m_ChunkX, a_Item.m_ChunkZ);
-
-	PrepareBlockLight();
-	CalcLight(m_BlockLight);
-
-	PrepareSkyLight();
+		cCSLock Lock(m_CS);
+		m_PendingQueue.remove(&a_ChunkStay);
 
-	/*
-	// DEBUG: Save chunk data with highlighted seeds for visual inspection:
-	cFile f4;
-	if (
-		f4.Open(fmt::format(FMT_STRING("Chunk_{}_{}_seeds.grab"), a_Item.m_ChunkX, a_Item.m_ChunkZ), cFile::fmWrite)
-	)
-	{
-		for (int z = 0; z < cChunkDef::Width * 3; z++)
-		{
-			for (int y = cChunkDef::Height / 2; y >= 0; y--)
-			{
-				unsigned char Seeds     [cChunkDef::Width * 3];
-				memcpy(Seeds, m_BlockTypes + y * BlocksPerYLayer + z * cChunkDef::Width * 3, cChunkDef::Width * 3);
-				for (int x = 0; x < cChunkDef::Width * 3; x++)
-				{
-					if (m_IsSeed1[y * BlocksPerYLayer + z * cChunkDef::Width * 3 + x])
-					{
-						Seeds[x] = E_BLOCK_DIAMOND_BLOCK;
-					}
-				}
-				f4.Write(Seeds, cChunkDef::Width * 3);
-			}
-		}
-		f4.Close();
-	}
-	//*/
-
-	CalcLight(m_SkyLight);
-
-	/*
-	// DEBUG: Save XY slices of the chunk data and lighting for visual inspection:
-	cFile f1, f2, f3;
-	if (
-		f1.Open(fmt::format(FMT_STRING("Chunk_{}_{}_data.grab"), a_Item.m_ChunkX, a_Item.m_ChunkZ), cFile::fmWrite) &&
-		f2.Open(fmt::format(FMT_STRING("Chunk_{}_{}_sky.grab"),  a_Item.m_ChunkX, a_Item.m_ChunkZ), cFile::fmWrite) &&
-		f3.Open(fmt::format(FMT_STRING("Chunk_{}_{}_glow.grab"), a_Item.m_ChunkX, a_Item.m_ChunkZ), cFile::fmWrite)
-	)
-	{
-		for (int z = 0; z < cChunkDef::Width * 3; z++)
+		// Move the ChunkStay into the queue of the worker with the least work:
+		Target = m_Workers.front().get();
+		size_t TargetLoad = std::numeric_limits<size_t>::max();
+		for (const auto & Worker : m_Workers)
 		{
-			for (int y = cChunkDef::Height / 2; y >= 0; y--)
+			const auto Load = Worker->m_Queue.size() + (Worker->m_IsBusy ? 1 : 0);
+			if (Load < TargetLoad)
 			{
-				f1.Write(m_BlockTypes + y * BlocksPerYLayer + z * cChunkDef::Width * 3, cChunkDef::Width * 3);
-				unsigned char SkyLight  [cChunkDef::Width * 3];
-				unsigned char BlockLight[cChunkDef::Width * 3];
-				for (int x = 0; x < cChunkDef::Width * 3; x++)
-				{
-					SkyLight[x]   = m_SkyLight  [y * BlocksPerYLayer + z * cChunkDef::Width * 3 + x] << 4;
-					BlockLight[x] = m_BlockLight[y * BlocksPerYLayer + z * cChunkDef::Width * 3 + x] << 4;
-				}
-				f2.Write(SkyLight,   cChunkDef::Width * 3);
-				f3.Write(BlockLight, cChunkDef::Width * 3);
+				Target = Worker.get();
+				TargetLoad = Load;
 			}
 		}
-		f1.Close();
-		f2.Close();
-		f3.Close();
-	}
-	//*/
-
-	CompressLight(m_BlockLight, BlockLight);
-	CompressLight(m_SkyLight, SkyLight);
-
-	m_World.ChunkLighted(a_Item.m_ChunkX, a_Item.m_ChunkZ, BlockLight, SkyLight);
-
-	if (a_Item.m_CallbackAfter != nullptr)
-	{
-		a_Item.m_CallbackAfter->Call({a_Item.m_ChunkX, a_Item.m_ChunkZ}, true);
+		Target->m_Queue.push_back(&a_ChunkStay);
 	}
+	Target->Wake();
 }
 
 
 
 
 
-void cLightingThread::ReadChunks(int a_ChunkX, int a_ChunkZ)
+cLightingThread::cLightingChunkStay * cLightingThread::GetNextItem(cWorker & a_Worker)
 {
-	cReader Reader(m_BlockTypes, m_HeightMap);
-
-	for (int z = 0; z < 3; z++)
+	cCSLock Lock(m_CS);
+	a_Worker.m_IsBusy = false;
+	if (IsIdle())
 	{
-		Reader.m_ReadingChunkZ = z;
-		for (int x = 0; x < 3; x++)
-		{
-			Reader.m_ReadingChunkX = x;
-			VERIFY(m_World.GetChunkData({a_ChunkX + x - 1, a_ChunkZ + z - 1}, Reader));
-		}  // for z
-	}  // for x
-
-	memset(m_BlockLight, 0, sizeof(m_BlockLight));
-	memset(m_SkyLight,   0, sizeof(m_SkyLight));
-	m_MaxHeight = Reader.m_MaxHeight;
-}
-
-
-
-
+		m_evtQueueEmpty.SetAll();
+	}
 
-void cLightingThread::PrepareSkyLight(void)
-{
-	// Clear seeds:
-	memset(m_IsSeed1, 0, sizeof(m_IsSeed1));
-	m_NumSeeds = 0;
+	if (m_ShouldTerminate)
+	{
+		return nullptr;
+	}
 
-	// Fill the top of the chunk with all-light:
-	if (m_MaxHeight < cChunkDef::Height - 1)
+	// Take from own queue first:
+	if (!a_Worker.m_Queue.empty())
 	{
-		std::fill(m_SkyLight + (m_MaxHeight + 1) * BlocksPerYLayer, m_SkyLight + ARRAYCOUNT(m_SkyLight), static_cast<NIBBLETYPE>(15));
+		auto Item = static_cast<cLightingChunkStay *>(a_Worker.m_Queue.front());
+		a_Worker.m_Queue.pop_front();
+		a_Worker.m_IsBusy = true;
+		return Item;
 	}
 
-	// Walk every column that has all XZ neighbors
-	for (int z = 1; z < cChunkDef::Width * 3 - 1; z++)
+	// Own queue is empty, take the oldest item from the longest other queue:
+	cWorker * Victim = nullptr;
+	for (const auto & Worker : m_Workers)
 	{
-		int BaseZ = z * cChunkDef::Width * 3;
-		for (int x = 1; x < cChunkDef::Width * 3 - 1; x++)
+		if ((Worker.get() != &a_Worker) && !Worker->m_Queue.empty() && ((Victim == nullptr) || (Worker->m_Queue.size() > Victim->m_Queue.size())))
 		{
-			int idx = BaseZ + x;
-			// Find the lowest block in this column that receives full sunlight (go through transparent blocks):
-			int Current = m_HeightMap[idx];
-			ASSERT(Current < cChunkDef::Height);
-			while (
-				(Current >= 0) &&
-				cBlockInfo::IsTransparent(m_BlockTypes[idx + Current * BlocksPerYLayer]) &&
-				!cBlockInfo::IsSkylightDispersant(m_BlockTypes[idx + Current * BlocksPerYLayer])
-			)
-			{
-				Current -= 1;  // Sunlight goes down unchanged through this block
-			}
-			Current += 1;  // Point to the last sunlit block, rather than the first non-transparent one
-			// The other neighbors don't need transparent-block-checking. At worst we'll have a few dud seeds above the ground.
-			int Neighbor1 = m_HeightMap[idx + 1] + 1;  // X + 1
-			int Neighbor2 = m_HeightMap[idx - 1] + 1;  // X - 1
-			int Neighbor3 = m_HeightMap[idx + cChunkDef::Width * 3] + 1;  // Z + 1
-			int Neighbor4 = m_HeightMap[idx - cChunkDef::Width * 3] + 1;  // Z - 1
-			int MaxNeighbor = std::max(std::max(Neighbor1, Neighbor2), std::max(Neighbor3, Neighbor4));  // Maximum of the four neighbors
-
-			// Fill the column from m_MaxHeight to Current with all-light:
-			for (int y = m_MaxHeight, Index = idx + y * BlocksPerYLayer; y >= Current; y--, Index -= BlocksPerYLayer)
-			{
-				m_SkyLight[Index] = 15;
-			}
-
-			// Add Current as a seed:
-			if (Current < cChunkDef::Height)
-			{
-				int CurrentIdx = idx + Current * BlocksPerYLayer;
-				m_IsSeed1[CurrentIdx] = true;
-				m_SeedIdx1[m_NumSeeds++] = static_cast<UInt32>(CurrentIdx);
-			}
-
-			// Add seed from Current up to the highest neighbor:
-			for (int y = Current + 1, Index = idx + y * BlocksPerYLayer; y < MaxNeighbor; y++, Index += BlocksPerYLayer)
-			{
-				m_IsSeed1[Index] = true;
-				m_SeedIdx1[m_NumSeeds++] = static_cast<UInt32>(Index);
-			}
+			Victim = Worker.get();
 		}
 	}
+	if (Victim == nullptr)
+	{
+		return nullptr;
+	}
+	auto Item = static_cast<cLightingChunkStay *>(Victim->m_Queue.front());
+	Victim->m_Queue.pop_front();
+	a_Worker.m_IsBusy = true;
+	return Item;
 }
 
 
 
 
 
-void cLightingThread::PrepareBlockLight()
+bool cLightingThread::IsIdle(void)
 {
-	// Clear seeds:
-	memset(m_IsSeed1, 0, sizeof(m_IsSeed1));
-	memset(m_IsSeed2, 0, sizeof(m_IsSeed2));
-	m_NumSeeds = 0;
-
-	// Add each emissive block into the seeds:
-	for (int Idx = 0; Idx < (m_MaxHeight * BlocksPerYLayer); ++Idx)
+	ASSERT(m_CS.IsLockedByCurrentThread());
+	if (!m_PendingQueue.empty())
 	{
-		if (cBlockInfo::GetLightValue(m_BlockTypes[Idx]) == 0)
+		return false;
+	}
+	for (const auto & Worker : m_Workers)
+	{
+		if (!Worker->m_Queue.empty() || Worker->m_IsBusy)
 		{
-			// Not a light-emissive block
-			continue;
+			return false;
 		}
-
-		// Add current block as a seed:
-		m_IsSeed1[Idx] = true;
-		m_SeedIdx1[m_NumSeeds++] = static_cast<UInt32>(Idx);
-
-		// Light it up:
-		m_BlockLight[Idx] = cBlockInfo::GetLightValue(m_BlockTypes[Idx]);
 	}
+	return true;
 }
 
 
 
 
 
-void cLightingThread::CalcLight(NIBBLETYPE * a_Light)
-{
-	size_t NumSeeds2 = 0;
-	while (m_NumSeeds > 0)
-	{
-		// Buffer 1 -> buffer 2
-		memset(m_IsSeed2, 0, sizeof(m_IsSeed2));
-		NumSeeds2 = 0;
-		CalcLightStep(a_Light, m_NumSeeds, m_IsSeed1, m_SeedIdx1, NumSeeds2, m_IsSeed2, m_SeedIdx2);
-		if (NumSeeds2 == 0)
-		{
-			return;
-		}
+////////////////////////////////////////////////////////////////////////////////
+// cLightingThread::cWorker:
 
-		// Buffer 2 -> buffer 1
-		memset(m_IsSeed1, 0, sizeof(m_IsSeed1));
-		m_NumSeeds = 0;
-		CalcLightStep(a_Light, NumSeeds2, m_IsSeed2, m_SeedIdx2, m_NumSeeds, m_IsSeed1, m_SeedIdx1);
-	}
+cLightingThread::cWorker::cWorker(cLightingThread & a_Parent, size_t a_Index):
+	Super(fmt::format(FMT_STRING("Lighting Executor #{}"), a_Index + 1)),
+	m_IsBusy(false),
+	m_Parent(a_Parent),
+	m_World(a_Parent.m_World)
+{
 }
 
 
 
 
 
-void cLightingThread::CalcLightStep(
-	NIBBLETYPE * a_Light,
-	size_t a_NumSeedsIn,    unsigned char * a_IsSeedIn,  unsigned int * a_SeedIdxIn,
-	size_t & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
-)
+void cLightingThread::cWorker::Stop(void)
 {
-	UNUSED(a_IsSeedIn);
-	size_t NumSeedsOut = 0;
-	for (size_t i = 0; i < a_NumSeedsIn; i++)
-	{
-		UInt32 SeedIdx = static_cast<UInt32>(a_SeedIdxIn[i]);
-		int SeedX = SeedIdx % (cChunkDef::Width * 3);
-		int SeedZ = (SeedIdx / (cChunkDef::Width * 3)) % (cChunkDef::Width * 3);
-
-		// Propagate seed:
-		if (SeedX < cChunkDef::Width * 3 - 1)
-		{
-			PropagateLight(a_Light, SeedIdx, SeedIdx + 1, NumSeedsOut, a_IsSeedOut, a_SeedIdxOut);
-		}
-		if (SeedX > 0)
-		{
-			PropagateLight(a_Light, SeedIdx, SeedIdx - 1, NumSeedsOut, a_IsSeedOut, a_SeedIdxOut);
-		}
-		if (SeedZ < cChunkDef::Width * 3 - 1)
-		{
-			PropagateLight(a_Light, SeedIdx, SeedIdx + cChunkDef::Width * 3, NumSeedsOut, a_IsSeedOut, a_SeedIdxOut);
-		}
-		if (SeedZ > 0)
-		{
-			PropagateLight(a_Light, SeedIdx, SeedIdx - cChunkDef::Width * 3, NumSeedsOut, a_IsSeedOut, a_SeedIdxOut);
-		}
-		if (SeedIdx < (cChunkDef::Height - 1) * BlocksPerYLayer)
-		{
-			PropagateLight(a_Light, SeedIdx, SeedIdx + BlocksPerYLayer, NumSeedsOut, a_IsSeedOut, a_SeedIdxOut);
-		}
-		if (SeedIdx >= BlocksPerYLayer)
-		{
-			PropagateLight(a_Light, SeedIdx, SeedIdx - BlocksPerYLayer, NumSeedsOut, a_IsSeedOut, a_SeedIdxOut);
-		}
-	}  // for i - a_SeedIdxIn[]
-	a_NumSeedsOut = NumSeedsOut;
+	m_ShouldTerminate = true;
+	m_evtItemAdded.Set();
+	Super::Stop();
 }
 
 
 
 
 
-void cLightingThread::CompressLight(NIBBLETYPE * a_LightArray, NIBBLETYPE * a_ChunkLight)
+void cLightingThread::cWorker::Execute(void)
 {
-	int InIdx = cChunkDef::Width * 49;  // Index to the first nibble of the middle chunk in the a_LightArray
-	int OutIdx = 0;
-	for (int y = 0; y < cChunkDef::Height; y++)
+	for (;;)
 	{
-		for (int z = 0; z < cChunkDef::Width; z++)
+		auto Item = m_Parent.GetNextItem(*this);
+		if (Item == nullptr)
 		{
-			for (int x = 0; x < cChunkDef::Width; x += 2)
+			if (m_ShouldTerminate)
 			{
-				a_ChunkLight[OutIdx++] = static_cast<NIBBLETYPE>(a_LightArray[InIdx + 1] << 4) | a_LightArray[InIdx];
-				InIdx += 2;
+				return;
 			}
-			InIdx += cChunkDef::Width * 2;
+			m_evtItemAdded.Wait();
+			continue;
 		}
-		// Skip into the next y-level in the 3x3 chunk blob; each level has cChunkDef::Width * 9 rows
-		// We've already walked cChunkDef::Width * 3 in the "for z" cycle, that makes cChunkDef::Width * 6 rows left to skip
-		InIdx += cChunkDef::Width * cChunkDef::Width * 6;
+
+		LightChunk(*Item);
+		Item->Disable();
+		delete Item;
 	}
 }
 
@@ -542,42 +311,35 @@ void cLightingThread::CompressLight(NIBBLETYPE * a_LightArray, NIBBLETYPE * a_Ch
 
 
 
-void cLightingThread::PropagateLight(
-	NIBBLETYPE * a_Light,
-	unsigned int a_SrcIdx, unsigned int a_DstIdx,
-	size_t & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
-)
+void cLightingThread::cWorker::LightChunk(cLightingChunkStay & a_Item)
 {
-	ASSERT(a_SrcIdx < ARRAYCOUNT(m_SkyLight));
-	ASSERT(a_DstIdx < ARRAYCOUNT(m_BlockTypes));
-
-	if (a_Light[a_SrcIdx] <= a_Light[a_DstIdx] + cBlockInfo::GetSpreadLightFalloff(m_BlockTypes[a_DstIdx]))
+	// If the chunk is already lit, skip it (report as success):
+	if (m_World.IsChunkLighted(a_Item.m_ChunkX, a_Item.m_ChunkZ))
 	{
-		// We're not offering more light than the dest block already has
+		if (a_Item.m_CallbackAfter != nullptr)
+		{
+			a_Item.m_CallbackAfter->Call({a_Item.m_ChunkX, a_Item.m_ChunkZ}, true);
+		}
 		return;
 	}
 
-	a_Light[a_DstIdx] = a_Light[a_SrcIdx] - cBlockInfo::GetSpreadLightFalloff(m_BlockTypes[a_DstIdx]);
-	if (!a_IsSeedOut[a_DstIdx])
-	{
-		a_IsSeedOut[a_DstIdx] = true;
-		a_SeedIdxOut[a_NumSeedsOut++] = a_DstIdx;
-	}
-}
-
-
-
+	cChunkDef::BlockNibbles BlockLight, SkyLight;
+	m_Lighter.Light({a_Item.m_ChunkX, a_Item.m_ChunkZ},
+		[this](cChunkCoords a_Coords, cChunkDataCallback & a_Callback)
+		{
+			// The ChunkStay keeps all the neighbors loaded:
+			return VERIFY(m_World.GetChunkData(a_Coords, a_Callback));
+		},
+		BlockLight, SkyLight
+	);
 
+	m_World.ChunkLighted(a_Item.m_ChunkX, a_Item.m_ChunkZ, BlockLight, SkyLight);
+	m_Parent.m_NumLit++;
 
-void cLightingThread::QueueChunkStay(cLightingChunkStay & a_ChunkStay)
-{
-	// Move the ChunkStay from the Pending queue to the lighting queue.
+	if (a_Item.m_CallbackAfter != nullptr)
 	{
-		cCSLock Lock(m_CS);
-		m_PendingQueue.remove(&a_ChunkStay);
-		m_Queue.push_back(&a_ChunkStay);
+		a_Item.m_CallbackAfter->Call({a_Item.m_ChunkX, a_Item.m_ChunkZ}, true);
 	}
-	m_evtItemAdded.Set();
 }
 
 
@@ -4,27 +4,14 @@
 // Interfaces to the cLightingThread class representing the thread that processes requests for lighting
 
 /*
-Lighting is done on whole chunks. For each chunk to be lighted, the whole 3x3 chunk area around it is read,
-then it is processed, so that the middle chunk area has valid lighting, and the lighting is copied into the ChunkMap.
-Lighting is calculated in full char arrays instead of nibbles, so that accessing the arrays is fast.
-Lighting is calculated in a flood-fill fashion:
-1. Generate seeds from where the light spreads (full skylight / light-emitting blocks)
-2. For each seed:
-	- Spread the light 1 block in each of the 6 cardinal directions, if the blocktype allows
-	- If the recipient block has had lower lighting value than that being spread, make it a new seed
-3. Repeat step 2, until there are no more seeds
-The seeds need two fast operations:
-	- Check if a block at [x, y, z] is already a seed
-	- Get the next seed in the row
-For that reason it is stored in two arrays, one stores a bool saying a seed is in that position,
-the other is an array of seed coords, encoded as a single int.
-Step 2 needs two separate storages for old seeds and new seeds, so there are two actual storages for that purpose,
-their content is swapped after each full step-2-cycle.
-
-The thread has two queues of chunks that are to be lighted.
-The first queue, m_Queue, is the only one that is publicly visible, chunks get queued there by external requests.
-The second one, m_PostponedQueue, is for chunks that have been taken out of m_Queue and didn't have neighbors ready.
-Chunks from m_PostponedQueue are moved back into m_Queue when their neighbors get valid, using the ChunkReady callback.
+The lighting calculation itself is implemented in cChunkLighter, see ChunkLighter.h for the details.
+Only the chunks that have all the 3x3 neighbors loaded are lit, the neighbors' block types affect the lighting of the middle chunk.
+
+The lighting itself is done by a pool of workers, each a separate thread with its own set of buffers.
+Chunks queued for lighting first wait in m_PendingQueue until their ChunkStay has all the 3x3 neighbors loaded.
+Once ready, each chunk is handed to the worker with the least work queued, into that worker's m_Queue.
+A worker that runs out of work takes the oldest chunk from the longest queue of the other workers.
+Neighboring chunks may be lit in parallel, lighting only reads the block types of the neighbors and writes the light of the middle chunk.
 */
 
 
@@ -33,6 +20,7 @@ Chunks from m_PostponedQueue are moved back into m_Queue when their neighbors ge
 
 #include "OSSupport/IsThread.h"
 #include "ChunkStay.h"
+#include "ChunkLighter.h"
 
 
 
@@ -45,15 +33,18 @@ class cWorld;
 
 
 
-class cLightingThread:
-	public cIsThread
+class cLightingThread
 {
-	using Super = cIsThread;
-
 public:
 
 	cLightingThread(cWorld & a_World);
-	virtual ~cLightingThread() override;
+	~cLightingThread();
+
+	/** Sets the number of worker threads, must be called before Start(). Defaults to a single worker. */
+	void SetNumWorkers(unsigned a_NumWorkers);
+
+	/** Starts the worker threads. */
+	void Start(void);
 
 	void Stop(void);
 
@@ -64,8 +55,15 @@ public:
 	/** Blocks until the queue is empty or the thread is terminated */
 	void WaitForQueueEmpty(void);
 
+	/** Returns the number of chunks waiting for lighting, both those waiting for their neighbors to load and those queued in the workers. */
 	size_t GetQueueLength(void);
 
+	/** Returns the number of chunks queued in each worker, including the one being lit. */
+	std::vector<size_t> GetWorkerQueueLengths(void);
+
+	/** Returns the number of chunks lit since the start, for measuring the throughput. */
+	size_t GetNumLit(void) const { return m_NumLit; }
+
 protected:
 
 	class cLightingChunkStay :
@@ -92,83 +90,79 @@ protected:
 	typedef std::list<cChunkStay *> cChunkStays;
 
 
-	cWorld & m_World;
+	/** A single lighting thread, with its own buffers for the 3x3 chunk data. */
+	class cWorker:
+		public cIsThread
+	{
+		using Super = cIsThread;
 
-	/** The mutex to protect m_Queue and m_PendingQueue */
-	cCriticalSection m_CS;
+	public:
 
-	/** The ChunkStays that are loaded and are waiting to be lit. */
-	cChunkStays m_Queue;
+		cWorker(cLightingThread & a_Parent, size_t a_Index);
 
-	/** The ChunkStays that are waiting for load. Used for stopping the thread. */
-	cChunkStays m_PendingQueue;
+		/** Wakes the worker up to check for work, or to terminate. */
+		void Wake(void) { m_evtItemAdded.Set(); }
 
-	cEvent m_evtItemAdded;    // Set when queue is appended, or to stop the thread
-	cEvent m_evtQueueEmpty;   // Set when the queue gets empty
+		/** Signals the thread to terminate and waits until it's finished. */
+		void Stop(void);
 
-	/** The highest block in the current 3x3 chunk data */
-	HEIGHTTYPE m_MaxHeight;
+		/** The ChunkStays that are loaded and are waiting to be lit by this worker. Protected by the parent's m_CS. */
+		cChunkStays m_Queue;
 
+		/** True while the worker is lighting a chunk. Protected by the parent's m_CS. */
+		bool m_IsBusy;
 
-	// Buffers for the 3x3 chunk data
-	// These buffers alone are 1.7 MiB in size, therefore they cannot be located on the stack safely - some architectures may have only 1 MiB for stack, or even less
-	// Placing the buffers into the object means that this object can light chunks only in one thread!
-	// The blobs are XZY organized as a whole, instead of 3x3 XZY-organized subarrays ->
-	//  -> This means data has to be scatterred when reading and gathered when writing!
-	static const int BlocksPerYLayer = cChunkDef::Width * cChunkDef::Width * 3 * 3;
-	BLOCKTYPE  m_BlockTypes[BlocksPerYLayer * cChunkDef::Height];
-	NIBBLETYPE m_BlockLight[BlocksPerYLayer * cChunkDef::Height];
-	NIBBLETYPE m_SkyLight  [BlocksPerYLayer * cChunkDef::Height];
-	HEIGHTTYPE m_HeightMap [BlocksPerYLayer];
+	protected:
 
-	// Seed management (5.7 MiB)
-	// Two buffers, in each calc step one is set as input and the other as output, then in the next step they're swapped
-	// Each seed is represented twice in this structure - both as a "list" and as a "position".
-	// "list" allows fast traversal from seed to seed
-	// "position" allows fast checking if a coord is already a seed
-	unsigned char m_IsSeed1 [BlocksPerYLayer * cChunkDef::Height];
-	unsigned int  m_SeedIdx1[BlocksPerYLayer * cChunkDef::Height];
-	unsigned char m_IsSeed2 [BlocksPerYLayer * cChunkDef::Height];
-	unsigned int  m_SeedIdx2[BlocksPerYLayer * cChunkDef::Height];
-	size_t m_NumSeeds;
+		cLightingThread & m_Parent;
 
-	virtual void Execute(void) override;
+		cWorld & m_World;
 
-	/** Lights the entire chunk. If neighbor chunks don't exist, touches them and re-queues the chunk */
-	void LightChunk(cLightingChunkStay & a_Item);
+		/** Set when an item is queued for this worker, or to stop the thread */
+		cEvent m_evtItemAdded;
 
-	/** Prepares m_BlockTypes and m_HeightMap data; zeroes out the light arrays */
-	void ReadChunks(int a_ChunkX, int a_ChunkZ);
+		/** The light calculation, with its own set of buffers for the 3x3 chunk data.
+		The buffers are several MiB in size, therefore the workers are allocated on the heap. */
+		cChunkLighter m_Lighter;
 
-	/** Uses m_HeightMap to initialize the m_SkyLight[] data; fills in seeds for the skylight */
-	void PrepareSkyLight(void);
+		virtual void Execute(void) override;
 
-	/** Uses m_BlockTypes to initialize the m_BlockLight[] data; fills in seeds for the blocklight */
-	void PrepareBlockLight(void);
+		/** Lights the entire chunk. If neighbor chunks don't exist, touches them and re-queues the chunk */
+		void LightChunk(cLightingChunkStay & a_Item);
+	};
 
-	/** Calculates light in the light array specified, using stored seeds */
-	void CalcLight(NIBBLETYPE * a_Light);
 
-	/** Does one step in the light calculation - one seed propagation and seed recalculation */
-	void CalcLightStep(
-		NIBBLETYPE * a_Light,
-		size_t a_NumSeedsIn,    unsigned char * a_IsSeedIn,  unsigned int * a_SeedIdxIn,
-		size_t & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
-	);
+	cWorld & m_World;
+
+	/** The mutex to protect m_PendingQueue, m_ShouldTerminate and the workers' queues */
+	cCriticalSection m_CS;
+
+	/** The ChunkStays that are waiting for load. Used for stopping the thread. */
+	cChunkStays m_PendingQueue;
 
-	/** Compresses from 1-block-per-byte (faster calc) into 2-blocks-per-byte (MC storage): */
-	void CompressLight(NIBBLETYPE * a_LightArray, NIBBLETYPE * a_ChunkLight);
+	cEvent m_evtQueueEmpty;   // Set when all the queues get empty
+
+	std::vector<std::unique_ptr<cWorker>> m_Workers;
+
+	/** Set when stopping, makes the workers terminate. */
+	bool m_ShouldTerminate;
+
+	/** Number of chunks lit since the start. */
+	std::atomic<size_t> m_NumLit;
 
-	void PropagateLight(
-		NIBBLETYPE * a_Light,
-		unsigned int a_SrcIdx, unsigned int a_DstIdx,
-		size_t & a_NumSeedsOut, unsigned char * a_IsSeedOut, unsigned int * a_SeedIdxOut
-	);
 
 	/** Queues a chunkstay that has all of its chunks loaded.
 	Called by cLightingChunkStay when all of its chunks are loaded. */
 	void QueueChunkStay(cLightingChunkStay & a_ChunkStay);
 
+	/** Returns the next item for the specified worker to light, taking one from another worker's queue if its own is empty.
+	Blocks until there is an item, returns nullptr if the workers are terminating.
+	The worker is busy until it calls the function again. */
+	cLightingChunkStay * GetNextItem(cWorker & a_Worker);
+
+	/** Returns true if no chunks are waiting or being lit. Must be called with m_CS held. */
+	bool IsIdle(void);
+
 } ;
 
 
@@ -71,6 +71,7 @@ void cNetherPortalScanner::OnChunkAvailable(int a_ChunkX, int a_ChunkZ)
 				const auto Blocks = a_BlockData.GetSection(Y);
 				if (Blocks == nullptr)
 				{
+					// A uniform section can't hold a portal together with its obsidian frame:
 					continue;
 				}
 
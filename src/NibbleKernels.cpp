@@ -0,0 +1,335 @@
+
+// NibbleKernels.cpp
+
+// Implements the bulk conversions between nibble arrays and expanded arrays, with the runtime selection of the vectorized implementation
+
+#include "Globals.h"
+#include "NibbleKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define NIBBLE_KERNELS_X86
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#define NIBBLE_KERNELS_NEON
+	#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+	#define NIBBLE_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+	#define NIBBLE_KERNELS_TARGET_AVX2
+#endif
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// NibbleKernels::Scalar:
+
+void NibbleKernels::Scalar::Expand(const NIBBLETYPE * a_Packed, NIBBLETYPE * a_Expanded, size_t a_NumNibbles)
+{
+	ASSERT((a_NumNibbles % 2) == 0);
+	for (size_t i = 0; i < a_NumNibbles / 2; i++)
+	{
+		a_Expanded[2 * i]     = a_Packed[i] & 0x0f;
+		a_Expanded[2 * i + 1] = static_cast<NIBBLETYPE>(a_Packed[i] >> 4);
+	}
+}
+
+
+
+
+
+void NibbleKernels::Scalar::Compress(const NIBBLETYPE * a_Expanded, NIBBLETYPE * a_Packed, size_t a_NumNibbles)
+{
+	ASSERT((a_NumNibbles % 2) == 0);
+	for (size_t i = 0; i < a_NumNibbles / 2; i++)
+	{
+		a_Packed[i] = static_cast<NIBBLETYPE>((a_Expanded[2 * i] & 0x0f) | (a_Expanded[2 * i + 1] << 4));
+	}
+}
+
+
+
+
+
+namespace
+{
+	using ExpandFunction = void (*)(const NIBBLETYPE *, NIBBLETYPE *, size_t);
+	using CompressFunction = void (*)(const NIBBLETYPE *, NIBBLETYPE *, size_t);
+
+	/** The implementation used for this CPU. */
+	struct Implementation
+	{
+		const char * Name;
+		ExpandFunction Expand;
+		CompressFunction Compress;
+	};
+
+
+
+
+
+#ifdef NIBBLE_KERNELS_X86
+
+	void ExpandSSE2(const NIBBLETYPE * a_Packed, NIBBLETYPE * a_Expanded, size_t a_NumNibbles)
+	{
+		const auto Mask = _mm_set1_epi8(0x0f);
+		size_t i = 0;
+		for (; i + 32 <= a_NumNibbles; i += 32)
+		{
+			const auto Packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a_Packed + i / 2));
+			const auto Low = _mm_and_si128(Packed, Mask);
+			const auto High = _mm_and_si128(_mm_srli_epi16(Packed, 4), Mask);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(a_Expanded + i),      _mm_unpacklo_epi8(Low, High));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(a_Expanded + i + 16), _mm_unpackhi_epi8(Low, High));
+		}
+		if (i + 16 <= a_NumNibbles)
+		{
+			// A single 16-value row, common in the XZY blobs:
+			const auto Packed = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(a_Packed + i / 2));
+			const auto Low = _mm_and_si128(Packed, Mask);
+			const auto High = _mm_and_si128(_mm_srli_epi16(Packed, 4), Mask);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(a_Expanded + i), _mm_unpacklo_epi8(Low, High));
+			i += 16;
+		}
+		NibbleKernels::Scalar::Expand(a_Packed + i / 2, a_Expanded + i, a_NumNibbles - i);
+	}
+
+
+
+
+
+	/** Packs 16 expanded values, given as 8 little-endian 16-bit pairs, into the low bytes of the 16-bit lanes. */
+	inline __m128i PackPairsSSE2(const __m128i a_Pairs)
+	{
+		const auto Masked = _mm_and_si128(a_Pairs, _mm_set1_epi16(0x0f0f));
+		return _mm_and_si128(_mm_or_si128(Masked, _mm_srli_epi16(Masked, 4)), _mm_set1_epi16(0x00ff));
+	}
+
+
+
+
+
+	void CompressSSE2(const NIBBLETYPE * a_Expanded, NIBBLETYPE * a_Packed, size_t a_NumNibbles)
+	{
+		size_t i = 0;
+		for (; i + 32 <= a_NumNibbles; i += 32)
+		{
+			const auto First = PackPairsSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a_Expanded + i)));
+			const auto Second = PackPairsSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a_Expanded + i + 16)));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(a_Packed + i / 2), _mm_packus_epi16(First, Second));
+		}
+		if (i + 16 <= a_NumNibbles)
+		{
+			// A single 16-value row, common in the XZY blobs:
+			const auto Packed = PackPairsSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a_Expanded + i)));
+			_mm_storel_epi64(reinterpret_cast<__m128i *>(a_Packed + i / 2), _mm_packus_epi16(Packed, Packed));
+			i += 16;
+		}
+		NibbleKernels::Scalar::Compress(a_Expanded + i, a_Packed + i / 2, a_NumNibbles - i);
+	}
+
+
+
+
+
+	NIBBLE_KERNELS_TARGET_AVX2 void ExpandAVX2(const NIBBLETYPE * a_Packed, NIBBLETYPE * a_Expanded, size_t a_NumNibbles)
+	{
+		const auto Mask = _mm256_set1_epi8(0x0f);
+		size_t i = 0;
+		for (; i + 64 <= a_NumNibbles; i += 64)
+		{
+			const auto Packed = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a_Packed + i / 2));
+			const auto Low = _mm256_and_si256(Packed, Mask);
+			const auto High = _mm256_and_si256(_mm256_srli_epi16(Packed, 4), Mask);
+
+			// The unpacks work within each 128-bit lane, reorder the lanes afterwards:
+			const auto Lower = _mm256_unpacklo_epi8(Low, High);
+			const auto Upper = _mm256_unpackhi_epi8(Low, High);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(a_Expanded + i),      _mm256_permute2x128_si256(Lower, Upper, 0x20));
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(a_Expanded + i + 32), _mm256_permute2x128_si256(Lower, Upper, 0x31));
+		}
+		ExpandSSE2(a_Packed + i / 2, a_Expanded + i, a_NumNibbles - i);
+	}
+
+
+
+
+
+	NIBBLE_KERNELS_TARGET_AVX2 void CompressAVX2(const NIBBLETYPE * a_Expanded, NIBBLETYPE * a_Packed, size_t a_NumNibbles)
+	{
+		const auto PairMask = _mm256_set1_epi16(0x0f0f);
+		const auto ByteMask = _mm256_set1_epi16(0x00ff);
+		size_t i = 0;
+		for (; i + 64 <= a_NumNibbles; i += 64)
+		{
+			const auto First = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a_Expanded + i)), PairMask);
+			const auto Second = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a_Expanded + i + 32)), PairMask);
+			const auto FirstPacked = _mm256_and_si256(_mm256_or_si256(First, _mm256_srli_epi16(First, 4)), ByteMask);
+			const auto SecondPacked = _mm256_and_si256(_mm256_or_si256(Second, _mm256_srli_epi16(Second, 4)), ByteMask);
+
+			// The pack works within each 128-bit lane, reorder the 64-bit quarters afterwards:
+			const auto Packed = _mm256_packus_epi16(FirstPacked, SecondPacked);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(a_Packed + i / 2), _mm256_permute4x64_epi64(Packed, 0xd8));
+		}
+		CompressSSE2(a_Expanded + i, a_Packed + i / 2, a_NumNibbles - i);
+	}
+
+
+
+
+
+	bool IsAVX2Supported(void)
+	{
+		#if defined(__GNUC__) || defined(__clang__)
+			return __builtin_cpu_supports("avx2");
+		#elif defined(_MSC_VER)
+			// The OS must save the AVX registers (OSXSAVE and XCR0), and the CPU must have AVX2:
+			int Info[4];
+			__cpuid(Info, 1);
+			if (((Info[2] & (1 << 27)) == 0) || ((_xgetbv(0) & 0x06) != 0x06))
+			{
+				return false;
+			}
+			__cpuidex(Info, 7, 0);
+			return (Info[1] & (1 << 5)) != 0;
+		#else
+			return false;
+		#endif
+	}
+
+#endif  // NIBBLE_KERNELS_X86
+
+
+
+
+
+#ifdef NIBBLE_KERNELS_NEON
+
+	void ExpandNEON(const NIBBLETYPE * a_Packed, NIBBLETYPE * a_Expanded, size_t a_NumNibbles)
+	{
+		const auto Mask = vdupq_n_u8(0x0f);
+		size_t i = 0;
+		for (; i + 32 <= a_NumNibbles; i += 32)
+		{
+			const auto Packed = vld1q_u8(a_Packed + i / 2);
+			uint8x16x2_t Interleaved;
+			Interleaved.val[0] = vandq_u8(Packed, Mask);
+			Interleaved.val[1] = vshrq_n_u8(Packed, 4);
+			vst2q_u8(a_Expanded + i, Interleaved);
+		}
+		NibbleKernels::Scalar::Expand(a_Packed + i / 2, a_Expanded + i, a_NumNibbles - i);
+	}
+
+
+
+
+
+	void CompressNEON(const NIBBLETYPE * a_Expanded, NIBBLETYPE * a_Packed, size_t a_NumNibbles)
+	{
+		const auto Mask = vdupq_n_u8(0x0f);
+		size_t i = 0;
+		for (; i + 32 <= a_NumNibbles; i += 32)
+		{
+			const auto Deinterleaved = vld2q_u8(a_Expanded + i);
+			vst1q_u8(a_Packed + i / 2, vorrq_u8(vandq_u8(Deinterleaved.val[0], Mask), vshlq_n_u8(Deinterleaved.val[1], 4)));
+		}
+		NibbleKernels::Scalar::Compress(a_Expanded + i, a_Packed + i / 2, a_NumNibbles - i);
+	}
+
+#endif  // NIBBLE_KERNELS_NEON
+
+
+
+
+
+	Implementation SelectImplementation(void)
+	{
+		#if defined(NIBBLE_KERNELS_X86)
+			if (IsAVX2Supported())
+			{
+				return { "AVX2", &ExpandAVX2, &CompressAVX2 };
+			}
+			return { "SSE2", &ExpandSSE2, &CompressSSE2 };
+		#elif defined(NIBBLE_KERNELS_NEON)
+			return { "NEON", &ExpandNEON, &CompressNEON };
+		#else
+			return { "Scalar", &NibbleKernels::Scalar::Expand, &NibbleKernels::Scalar::Compress };
+		#endif
+	}
+
+
+
+
+
+	const Implementation & GetImplementation(void)
+	{
+		static const Implementation Selected = SelectImplementation();
+		return Selected;
+	}
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// NibbleKernels:
+
+void NibbleKernels::Expand(const NIBBLETYPE * a_Packed, NIBBLETYPE * a_Expanded, size_t a_NumNibbles)
+{
+	ASSERT((a_NumNibbles % 2) == 0);
+	GetImplementation().Expand(a_Packed, a_Expanded, a_NumNibbles);
+}
+
+
+
+
+
+void NibbleKernels::Compress(const NIBBLETYPE * a_Expanded, NIBBLETYPE * a_Packed, size_t a_NumNibbles)
+{
+	ASSERT((a_NumNibbles % 2) == 0);
+	GetImplementation().Compress(a_Expanded, a_Packed, a_NumNibbles);
+}
+
+
+
+
+
+void NibbleKernels::GatherCompress(const NIBBLETYPE * a_Expanded, size_t a_RowLength, size_t a_RowStride, size_t a_NumRows, NIBBLETYPE * a_Packed)
+{
+	ASSERT((a_RowLength % 2) == 0);
+	const auto Compress = GetImplementation().Compress;
+	for (size_t Row = 0; Row < a_NumRows; Row++)
+	{
+		Compress(a_Expanded + Row * a_RowStride, a_Packed + Row * a_RowLength / 2, a_RowLength);
+	}
+}
+
+
+
+
+
+void NibbleKernels::ExpandScatter(const NIBBLETYPE * a_Packed, size_t a_RowLength, size_t a_RowStride, size_t a_NumRows, NIBBLETYPE * a_Expanded)
+{
+	ASSERT((a_RowLength % 2) == 0);
+	const auto Expand = GetImplementation().Expand;
+	for (size_t Row = 0; Row < a_NumRows; Row++)
+	{
+		Expand(a_Packed + Row * a_RowLength / 2, a_Expanded + Row * a_RowStride, a_RowLength);
+	}
+}
+
+
+
+
+
+const char * NibbleKernels::GetImplementationName(void)
+{
+	return GetImplementation().Name;
+}
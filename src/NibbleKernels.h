@@ -0,0 +1,50 @@
+// NibbleKernels.h
+
+// Declares the bulk conversions between nibble arrays (two values per byte) and expanded arrays (one value per byte)
+
+/*
+The nibble order is the same as in cChunkDef::ExpandNibble() / PackNibble(): the even index is in the low nibble.
+Each function has a vectorized implementation, selected on first use by the CPU's capabilities:
+AVX2 (if the CPU supports it) or SSE2 on x86, NEON on ARM, and a plain scalar loop elsewhere.
+*/
+
+
+
+
+
+#pragma once
+
+#include "ChunkDef.h"
+
+
+
+
+
+namespace NibbleKernels
+{
+	/** Expands the packed nibbles into one value per byte.
+	a_NumNibbles is the number of values, a_Packed holds a_NumNibbles / 2 bytes. a_NumNibbles must be even. */
+	void Expand(const NIBBLETYPE * a_Packed, NIBBLETYPE * a_Expanded, size_t a_NumNibbles);
+
+	/** Packs the values, one per byte, into nibbles. Only the low 4 bits of each value are used.
+	a_NumNibbles is the number of values, a_Packed receives a_NumNibbles / 2 bytes. a_NumNibbles must be even. */
+	void Compress(const NIBBLETYPE * a_Expanded, NIBBLETYPE * a_Packed, size_t a_NumNibbles);
+
+	/** Gathers rows of expanded values spread through a larger array (such as a part of an XZY blob) and packs them into contiguous nibbles.
+	Row i starts at a_Expanded + i * a_RowStride and is a_RowLength values long; a_RowLength must be even. */
+	void GatherCompress(const NIBBLETYPE * a_Expanded, size_t a_RowLength, size_t a_RowStride, size_t a_NumRows, NIBBLETYPE * a_Packed);
+
+	/** The inverse of GatherCompress(): expands contiguous nibbles into rows spread through a larger array.
+	The bytes between the rows are left untouched. */
+	void ExpandScatter(const NIBBLETYPE * a_Packed, size_t a_RowLength, size_t a_RowStride, size_t a_NumRows, NIBBLETYPE * a_Expanded);
+
+	/** Returns the name of the implementation selected for this CPU, such as "AVX2". */
+	const char * GetImplementationName(void);
+
+	/** The reference implementation, always available. Used for testing and benchmarking the vectorized ones. */
+	namespace Scalar
+	{
+		void Expand(const NIBBLETYPE * a_Packed, NIBBLETYPE * a_Expanded, size_t a_NumNibbles);
+		void Compress(const NIBBLETYPE * a_Expanded, NIBBLETYPE * a_Packed, size_t a_NumNibbles);
+	}
+}
@@ -2,6 +2,7 @@
 #include "Globals.h"  // NOTE: MSVC stupidness requires this to be the same across all modules
 
 #include "Noise.h"
+#include "NoiseKernels.h"
 
 #define FAST_FLOOR(x) (((x) < 0) ? ((static_cast<int>(x)) - 1) : (static_cast<int>(x)))
 
@@ -190,6 +191,31 @@ void Debug2DNoise(const NOISE_DATATYPE * a_Noise, size_t a_SizeX, size_t a_SizeY
 
 
 
+/** Returns the hash input of cNoise::IntNoise2D(a_X, a_Y), see NoiseKernels::IntNoiseRow(). */
+static int IntNoise2DHashInput(int a_Seed, int a_X, int a_Y)
+{
+	// Calculated in unsigned arithmetic, so that the overflows are well-defined:
+	return static_cast<int>(static_cast<unsigned>(a_X) + static_cast<unsigned>(a_Y) * 57u + static_cast<unsigned>(a_Seed) * 57u * 57u);
+}
+
+
+
+
+
+/** Returns the hash input of cNoise::IntNoise3D(a_X, a_Y, a_Z), see NoiseKernels::IntNoiseRow(). */
+static int IntNoise3DHashInput(int a_Seed, int a_X, int a_Y, int a_Z)
+{
+	// Calculated in unsigned arithmetic, so that the overflows are well-defined:
+	return static_cast<int>(
+		static_cast<unsigned>(a_X) + static_cast<unsigned>(a_Y) * 57u +
+		static_cast<unsigned>(a_Z) * 57u * 57u + static_cast<unsigned>(a_Seed) * 57u * 57u * 57u
+	);
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cCubicCell2D:
 
@@ -217,6 +243,7 @@ public:
 	void Move(int a_NewFloorX, int a_NewFloorY);
 
 protected:
+	/** The random values around the current cell, indexed by [y][x] so that each row along X is contiguous. */
 	typedef NOISE_DATATYPE Workspace[4][4];
 
 	const cNoise & m_Noise;
@@ -268,16 +295,8 @@ void cCubicCell2D::Generate(
 	for (int y = a_FromY; y < a_ToY; y++)
 	{
 		NOISE_DATATYPE Interp[4];
-		NOISE_DATATYPE FracY = m_FracY[y];
-		Interp[0] = cNoise::CubicInterpolate((*m_WorkRnds)[0][0], (*m_WorkRnds)[0][1], (*m_WorkRnds)[0][2], (*m_WorkRnds)[0][3], FracY);
-		Interp[1] = cNoise::CubicInterpolate((*m_WorkRnds)[1][0], (*m_WorkRnds)[1][1], (*m_WorkRnds)[1][2], (*m_WorkRnds)[1][3], FracY);
-		Interp[2] = cNoise::CubicInterpolate((*m_WorkRnds)[2][0], (*m_WorkRnds)[2][1], (*m_WorkRnds)[2][2], (*m_WorkRnds)[2][3], FracY);
-		Interp[3] = cNoise::CubicInterpolate((*m_WorkRnds)[3][0], (*m_WorkRnds)[3][1], (*m_WorkRnds)[3][2], (*m_WorkRnds)[3][3], FracY);
-		int idx = y * m_SizeX + a_FromX;
-		for (int x = a_FromX; x < a_ToX; x++)
-		{
-			m_Array[idx++] = cNoise::CubicInterpolate(Interp[0], Interp[1], Interp[2], Interp[3], m_FracX[x]);
-		}  // for x
+		NoiseKernels::CubicInterpolateLanes((*m_WorkRnds)[0], (*m_WorkRnds)[1], (*m_WorkRnds)[2], (*m_WorkRnds)[3], m_FracY[y], Interp, 4);
+		NoiseKernels::CubicInterpolateRow(Interp, m_FracX + a_FromX, m_Array + y * m_SizeX + a_FromX, a_ToX - a_FromX);
 	}  // for y
 }
 
@@ -289,14 +308,10 @@ void cCubicCell2D::InitWorkRnds(int a_FloorX, int a_FloorY)
 {
 	m_CurFloorX = a_FloorX;
 	m_CurFloorY = a_FloorY;
-	for (int x = 0; x < 4; x++)
+	for (int y = 0; y < 4; y++)
 	{
-		int cx = a_FloorX + x - 1;
-		for (int y = 0; y < 4; y++)
-		{
-			int cy = a_FloorY + y - 1;
-			(*m_WorkRnds)[x][y] = static_cast<NOISE_DATATYPE>(m_Noise.IntNoise2D(cx, cy));
-		}
+		int cy = a_FloorY + y - 1;
+		NoiseKernels::IntNoiseRow(IntNoise2DHashInput(m_Noise.GetSeed(), a_FloorX - 1, cy), (*m_WorkRnds)[y], 4);
 	}
 }
 
@@ -315,21 +330,27 @@ void cCubicCell2D::Move(int a_NewFloorX, int a_NewFloorY)
 	// Reuse as much of the old workspace as possible:
 	int DiffX = OldFloorX - a_NewFloorX;
 	int DiffY = OldFloorY - a_NewFloorY;
-	for (int x = 0; x < 4; x++)
+	for (int y = 0; y < 4; y++)
 	{
-		int cx = a_NewFloorX + x - 1;
-		int OldX = x - DiffX;  // Where would this X be in the old grid?
-		for (int y = 0; y < 4; y++)
+		int cy = a_NewFloorY + y - 1;
+		int OldY = y - DiffY;  // Where would this Y be in the old grid?
+		if ((OldY < 0) || (OldY >= 4))
 		{
-			int cy = a_NewFloorY + y - 1;
-			int OldY = y - DiffY;  // Where would this Y be in the old grid?
-			if ((OldX >= 0) && (OldX < 4) && (OldY >= 0) && (OldY < 4))
+			// The entire row is new:
+			NoiseKernels::IntNoiseRow(IntNoise2DHashInput(m_Noise.GetSeed(), a_NewFloorX - 1, cy), (*m_WorkRnds)[y], 4);
+			continue;
+		}
+		for (int x = 0; x < 4; x++)
+		{
+			int cx = a_NewFloorX + x - 1;
+			int OldX = x - DiffX;  // Where would this X be in the old grid?
+			if ((OldX >= 0) && (OldX < 4))
 			{
-				(*m_WorkRnds)[x][y] = (*OldWorkRnds)[OldX][OldY];
+				(*m_WorkRnds)[y][x] = (*OldWorkRnds)[OldY][OldX];
 			}
 			else
 			{
-				(*m_WorkRnds)[x][y] = static_cast<NOISE_DATATYPE>(m_Noise.IntNoise2D(cx, cy));
+				(*m_WorkRnds)[y][x] = static_cast<NOISE_DATATYPE>(m_Noise.IntNoise2D(cx, cy));
 			}
 		}
 	}
@@ -370,6 +391,7 @@ public:
 	void Move(int a_NewFloorX, int a_NewFloorY, int a_NewFloorZ);
 
 protected:
+	/** The random values around the current cell, indexed by [z][y][x] so that each row along X is contiguous. */
 	typedef NOISE_DATATYPE Workspace[4][4][4];
 
 	const cNoise & m_Noise;
@@ -428,28 +450,16 @@ void cCubicCell3D::Generate(
 	for (int z = a_FromZ; z < a_ToZ; z++)
 	{
 		int idxZ = z * m_SizeX * m_SizeY;
-		NOISE_DATATYPE Interp2[4][4];
-		NOISE_DATATYPE FracZ = m_FracZ[z];
-		for (int x = 0; x < 4; x++)
-		{
-			for (int y = 0; y < 4; y++)
-			{
-				Interp2[x][y] = cNoise::CubicInterpolate((*m_WorkRnds)[x][y][0], (*m_WorkRnds)[x][y][1], (*m_WorkRnds)[x][y][2], (*m_WorkRnds)[x][y][3], FracZ);
-			}
-		}
+		NOISE_DATATYPE Interp2[4][4];  // [y][x]
+		NoiseKernels::CubicInterpolateLanes(
+			&(*m_WorkRnds)[0][0][0], &(*m_WorkRnds)[1][0][0], &(*m_WorkRnds)[2][0][0], &(*m_WorkRnds)[3][0][0],
+			m_FracZ[z], &Interp2[0][0], 16
+		);
 		for (int y = a_FromY; y < a_ToY; y++)
 		{
 			NOISE_DATATYPE Interp[4];
-			NOISE_DATATYPE FracY = m_FracY[y];
-			Interp[0] = cNoise::CubicInterpolate(Interp2[0][0], Interp2[0][1], Interp2[0][2], Interp2[0][3], FracY);
-			Interp[1] = cNoise::CubicInterpolate(Interp2[1][0], Interp2[1][1], Interp2[1][2], Interp2[1][3], FracY);
-			Interp[2] = cNoise::CubicInterpolate(Interp2[2][0], Interp2[2][1], Interp2[2][2], Interp2[2][3], FracY);
-			Interp[3] = cNoise::CubicInterpolate(Interp2[3][0], Interp2[3][1], Interp2[3][2], Interp2[3][3], FracY);
-			int idx = idxZ + y * m_SizeX + a_FromX;
-			for (int x = a_FromX; x < a_ToX; x++)
-			{
-				m_Array[idx++] = cNoise::CubicInterpolate(Interp[0], Interp[1], Interp[2], Interp[3], m_FracX[x]);
-			}  // for x
+			NoiseKernels::CubicInterpolateLanes(Interp2[0], Interp2[1], Interp2[2], Interp2[3], m_FracY[y], Interp, 4);
+			NoiseKernels::CubicInterpolateRow(Interp, m_FracX + a_FromX, m_Array + idxZ + y * m_SizeX + a_FromX, a_ToX - a_FromX);
 		}  // for y
 	}  // for z
 }
@@ -463,17 +473,13 @@ void cCubicCell3D::InitWorkRnds(int a_FloorX, int a_FloorY, int a_FloorZ)
 	m_CurFloorX = a_FloorX;
 	m_CurFloorY = a_FloorY;
 	m_CurFloorZ = a_FloorZ;
-	for (int x = 0; x < 4; x++)
+	for (int z = 0; z < 4; z++)
 	{
-		int cx = a_FloorX + x - 1;
+		int cz = a_FloorZ + z - 1;
 		for (int y = 0; y < 4; y++)
 		{
 			int cy = a_FloorY + y - 1;
-			for (int z = 0; z < 4; z++)
-			{
-				int cz = a_FloorZ + z - 1;
-				(*m_WorkRnds)[x][y][z] = static_cast<NOISE_DATATYPE>(m_Noise.IntNoise3D(cx, cy, cz));
-			}
+			NoiseKernels::IntNoiseRow(IntNoise3DHashInput(m_Noise.GetSeed(), a_FloorX - 1, cy, cz), (*m_WorkRnds)[z][y], 4);
 		}
 	}
 }
@@ -495,29 +501,35 @@ void cCubicCell3D::Move(int a_NewFloorX, int a_NewFloorY, int a_NewFloorZ)
 	int DiffX = OldFloorX - a_NewFloorX;
 	int DiffY = OldFloorY - a_NewFloorY;
 	int DiffZ = OldFloorZ - a_NewFloorZ;
-	for (int x = 0; x < 4; x++)
+	for (int z = 0; z < 4; z++)
 	{
-		int cx = a_NewFloorX + x - 1;
-		int OldX = x - DiffX;  // Where would this X be in the old grid?
+		int cz = a_NewFloorZ + z - 1;
+		int OldZ = z - DiffZ;  // Where would this Z be in the old grid?
 		for (int y = 0; y < 4; y++)
 		{
 			int cy = a_NewFloorY + y - 1;
 			int OldY = y - DiffY;  // Where would this Y be in the old grid?
-			for (int z = 0; z < 4; z++)
+			if ((OldY < 0) || (OldY >= 4) || (OldZ < 0) || (OldZ >= 4))
 			{
-				int cz = a_NewFloorZ + z - 1;
-				int OldZ = z - DiffZ;
-				if ((OldX >= 0) && (OldX < 4) && (OldY >= 0) && (OldY < 4) && (OldZ >= 0) && (OldZ < 4))
+				// The entire row is new:
+				NoiseKernels::IntNoiseRow(IntNoise3DHashInput(m_Noise.GetSeed(), a_NewFloorX - 1, cy, cz), (*m_WorkRnds)[z][y], 4);
+				continue;
+			}
+			for (int x = 0; x < 4; x++)
+			{
+				int cx = a_NewFloorX + x - 1;
+				int OldX = x - DiffX;  // Where would this X be in the old grid?
+				if ((OldX >= 0) && (OldX < 4))
 				{
-					(*m_WorkRnds)[x][y][z] = (*OldWorkRnds)[OldX][OldY][OldZ];
+					(*m_WorkRnds)[z][y][x] = (*OldWorkRnds)[OldZ][OldY][OldX];
 				}
 				else
 				{
-					(*m_WorkRnds)[x][y][z] = static_cast<NOISE_DATATYPE>(m_Noise.IntNoise3D(cx, cy, cz));
+					(*m_WorkRnds)[z][y][x] = static_cast<NOISE_DATATYPE>(m_Noise.IntNoise3D(cx, cy, cz));
 				}
-			}  // for z
+			}  // for x
 		}  // for y
-	}  // for x
+	}  // for z
 	m_CurFloorX = a_NewFloorX;
 	m_CurFloorY = a_NewFloorY;
 	m_CurFloorZ = a_NewFloorZ;
@@ -919,7 +931,6 @@ void cImprovedNoise::Generate2D(
 	NOISE_DATATYPE a_StartY, NOISE_DATATYPE a_EndY
 ) const
 {
-	size_t idx = 0;
 	for (int y = 0; y < a_SizeY; y++)
 	{
 		NOISE_DATATYPE ratioY = static_cast<NOISE_DATATYPE>(y) / (a_SizeY - 1);
@@ -928,30 +939,10 @@ void cImprovedNoise::Generate2D(
 		int yCoord = noiseYInt & 255;
 		NOISE_DATATYPE noiseYFrac = noiseY - noiseYInt;
 		NOISE_DATATYPE fadeY = Fade(noiseYFrac);
-		for (int x = 0; x < a_SizeX; x++)
-		{
-			NOISE_DATATYPE ratioX = static_cast<NOISE_DATATYPE>(x) / (a_SizeX - 1);
-			NOISE_DATATYPE noiseX = Lerp(a_StartX, a_EndX, ratioX);
-			int noiseXInt = FAST_FLOOR(noiseX);
-			int xCoord = noiseXInt & 255;
-			NOISE_DATATYPE noiseXFrac = noiseX - noiseXInt;
-			NOISE_DATATYPE fadeX = Fade(noiseXFrac);
-
-			// Hash the coordinates:
-			int A  = m_Perm[xCoord] + yCoord;
-			int AA = m_Perm[A];
-			int AB = m_Perm[A + 1];
-			int B  = m_Perm[xCoord + 1] + yCoord;
-			int BA = m_Perm[B];
-			int BB = m_Perm[B + 1];
-
-			// Lerp the gradients:
-			a_Array[idx++] = Lerp(
-				Lerp(Grad(m_Perm[AA], noiseXFrac, noiseYFrac,     0), Grad(m_Perm[BA], noiseXFrac - 1, noiseYFrac,     0), fadeX),
-				Lerp(Grad(m_Perm[AB], noiseXFrac, noiseYFrac - 1, 0), Grad(m_Perm[BB], noiseXFrac - 1, noiseYFrac - 1, 0), fadeX),
-				fadeY
-			);
-		}  // for x
+		NoiseKernels::ImprovedNoiseRow2D(
+			m_Perm, a_Array + static_cast<size_t>(y) * static_cast<size_t>(a_SizeX), a_SizeX, a_StartX, a_EndX,
+			yCoord, noiseYFrac, fadeY
+		);
 	}  // for y
 }
 
@@ -984,39 +975,12 @@ void cImprovedNoise::Generate3D(
 			int yCoord = noiseYInt & 255;
 			NOISE_DATATYPE noiseYFrac = noiseY - noiseYInt;
 			NOISE_DATATYPE fadeY = Fade(noiseYFrac);
-			for (int x = 0; x < a_SizeX; x++)
-			{
-				NOISE_DATATYPE ratioX = static_cast<NOISE_DATATYPE>(x) / (a_SizeX - 1);
-				NOISE_DATATYPE noiseX = Lerp(a_StartX, a_EndX, ratioX);
-				int noiseXInt = FAST_FLOOR(noiseX);
-				int xCoord = noiseXInt & 255;
-				NOISE_DATATYPE noiseXFrac = noiseX - noiseXInt;
-				NOISE_DATATYPE fadeX = Fade(noiseXFrac);
-
-				// Hash the coordinates:
-				int A  = m_Perm[xCoord] + yCoord;
-				int AA = m_Perm[A] + zCoord;
-				int AB = m_Perm[A + 1] + zCoord;
-				int B  = m_Perm[xCoord + 1] + yCoord;
-				int BA = m_Perm[B] + zCoord;
-				int BB = m_Perm[B + 1] + zCoord;
-
-				// Lerp the gradients:
-				// TODO: This may be optimized by swapping the coords and recalculating most lerps only "once every x"
-				a_Array[idx++] = Lerp(
-					Lerp(
-						Lerp(Grad(m_Perm[AA], noiseXFrac, noiseYFrac,     noiseZFrac), Grad(m_Perm[BA], noiseXFrac - 1, noiseYFrac,     noiseZFrac), fadeX),
-						Lerp(Grad(m_Perm[AB], noiseXFrac, noiseYFrac - 1, noiseZFrac), Grad(m_Perm[BB], noiseXFrac - 1, noiseYFrac - 1, noiseZFrac), fadeX),
-						fadeY
-					),
-					Lerp(
-						Lerp(Grad(m_Perm[AA + 1], noiseXFrac, noiseYFrac,     noiseZFrac - 1), Grad(m_Perm[BA + 1], noiseXFrac - 1, noiseYFrac,     noiseZFrac - 1), fadeX),
-						Lerp(Grad(m_Perm[AB + 1], noiseXFrac, noiseYFrac - 1, noiseZFrac - 1), Grad(m_Perm[BB + 1], noiseXFrac - 1, noiseYFrac - 1, noiseZFrac - 1), fadeX),
-						fadeY
-					),
-					fadeZ
-				);
-			}  // for x
+			NoiseKernels::ImprovedNoiseRow3D(
+				m_Perm, a_Array + idx, a_SizeX, a_StartX, a_EndX,
+				yCoord, noiseYFrac, fadeY,
+				zCoord, noiseZFrac, fadeZ
+			);
+			idx += static_cast<size_t>(a_SizeX);
 		}  // for y
 	}  // for z
 }
@@ -0,0 +1,959 @@
+
+// NoiseKernels.cpp
+
+// Implements the inner loops of the noise generators, with the runtime selection of the vectorized implementation
+
+#include "Globals.h"
+#include "NoiseKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define NOISE_KERNELS_X86
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+	#define NOISE_KERNELS_TARGET_SSE41 __attribute__((target("sse4.1")))
+	#define NOISE_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+	#define NOISE_KERNELS_TARGET_SSE41
+	#define NOISE_KERNELS_TARGET_AVX2
+#endif
+
+#define FAST_FLOOR(x) (((x) < 0) ? ((static_cast<int>(x)) - 1) : (static_cast<int>(x)))
+
+
+
+
+
+namespace
+{
+	using CubicInterpolateRowFunction = void (*)(const NOISE_DATATYPE (&)[4], const NOISE_DATATYPE *, NOISE_DATATYPE *, int);
+	using CubicInterpolateLanesFunction = void (*)(
+		const NOISE_DATATYPE *, const NOISE_DATATYPE *, const NOISE_DATATYPE *, const NOISE_DATATYPE *,
+		NOISE_DATATYPE, NOISE_DATATYPE *, int
+	);
+	using IntNoiseRowFunction = void (*)(int, NOISE_DATATYPE *, int);
+	using ImprovedNoiseRow2DFunction = void (*)(
+		const int *, NOISE_DATATYPE *, int, NOISE_DATATYPE, NOISE_DATATYPE,
+		int, NOISE_DATATYPE, NOISE_DATATYPE
+	);
+	using ImprovedNoiseRow3DFunction = void (*)(
+		const int *, NOISE_DATATYPE *, int, NOISE_DATATYPE, NOISE_DATATYPE,
+		int, NOISE_DATATYPE, NOISE_DATATYPE,
+		int, NOISE_DATATYPE, NOISE_DATATYPE
+	);
+
+	/** A complete set of the kernels. */
+	struct Implementation
+	{
+		const char * Name;
+		CubicInterpolateRowFunction CubicInterpolateRow;
+		CubicInterpolateLanesFunction CubicInterpolateLanes;
+		IntNoiseRowFunction IntNoiseRow;
+		ImprovedNoiseRow2DFunction ImprovedNoiseRow2D;
+		ImprovedNoiseRow3DFunction ImprovedNoiseRow3D;
+	};
+
+
+
+
+
+	////////////////////////////////////////////////////////////////////////////////
+	// Scalar:
+
+	void CubicInterpolateRowScalar(const NOISE_DATATYPE (& a_Values)[4], const NOISE_DATATYPE * a_Pct, NOISE_DATATYPE * a_Out, int a_Count)
+	{
+		for (int i = 0; i < a_Count; i++)
+		{
+			a_Out[i] = cNoise::CubicInterpolate(a_Values[0], a_Values[1], a_Values[2], a_Values[3], a_Pct[i]);
+		}
+	}
+
+
+
+
+
+	void CubicInterpolateLanesScalar(
+		const NOISE_DATATYPE * a_A, const NOISE_DATATYPE * a_B, const NOISE_DATATYPE * a_C, const NOISE_DATATYPE * a_D,
+		NOISE_DATATYPE a_Pct, NOISE_DATATYPE * a_Out, int a_Count
+	)
+	{
+		for (int i = 0; i < a_Count; i++)
+		{
+			a_Out[i] = cNoise::CubicInterpolate(a_A[i], a_B[i], a_C[i], a_D[i], a_Pct);
+		}
+	}
+
+
+
+
+
+	void IntNoiseRowScalar(int a_Base, NOISE_DATATYPE * a_Out, int a_Count)
+	{
+		// Same as cNoise::IntNoise3D(), done in unsigned arithmetic to have the overflows well-defined:
+		for (int i = 0; i < a_Count; i++)
+		{
+			unsigned n = static_cast<unsigned>(a_Base) + static_cast<unsigned>(i);
+			n = (n << 13) ^ n;
+			const auto Hash = static_cast<int>((n * (n * n * 15731 + 789221) + 1376312589) & 0x7fffffff);
+			a_Out[i] = static_cast<NOISE_DATATYPE>(1) - static_cast<NOISE_DATATYPE>(Hash) / 1073741824.0f;
+		}
+	}
+
+
+
+
+
+	/** Same as cImprovedNoise::Grad(). */
+	inline NOISE_DATATYPE Grad(int a_Hash, NOISE_DATATYPE a_X, NOISE_DATATYPE a_Y, NOISE_DATATYPE a_Z)
+	{
+		int hash = a_Hash % 16;
+		NOISE_DATATYPE u = (hash < 8) ? a_X : a_Y;
+		NOISE_DATATYPE v = (hash < 4) ? a_Y : (((hash == 12) || (hash == 14)) ? a_X : a_Z);
+		return (((hash & 1) == 0) ? u : -u) + (((hash & 2) == 0) ? v : -v);
+	}
+
+
+
+
+
+	/** Same as cImprovedNoise::Fade(). */
+	inline NOISE_DATATYPE Fade(NOISE_DATATYPE a_T)
+	{
+		return a_T * a_T * a_T * (a_T * (a_T * 6 - 15) + 10);
+	}
+
+
+
+
+
+	/** Calculates the values from a_FromX to the end of the row; the vectorized implementations use this for the last few values. */
+	void ImprovedNoiseRow2DFrom(
+		const int * a_Perm, NOISE_DATATYPE * a_Out, int a_FromX, int a_SizeX,
+		NOISE_DATATYPE a_StartX, NOISE_DATATYPE a_EndX,
+		int a_YCoord, NOISE_DATATYPE a_YFrac, NOISE_DATATYPE a_FadeY
+	)
+	{
+		for (int x = a_FromX; x < a_SizeX; x++)
+		{
+			NOISE_DATATYPE ratioX = static_cast<NOISE_DATATYPE>(x) / (a_SizeX - 1);
+			NOISE_DATATYPE noiseX = Lerp(a_StartX, a_EndX, ratioX);
+			int noiseXInt = FAST_FLOOR(noiseX);
+			int xCoord = noiseXInt & 255;
+			NOISE_DATATYPE noiseXFrac = noiseX - noiseXInt;
+			NOISE_DATATYPE fadeX = Fade(noiseXFrac);
+
+			// Hash the coordinates:
+			int A  = a_Perm[xCoord] + a_YCoord;
+			int AA = a_Perm[A];
+			int AB = a_Perm[A + 1];
+			int B  = a_Perm[xCoord + 1] + a_YCoord;
+			int BA = a_Perm[B];
+			int BB = a_Perm[B + 1];
+
+			// Lerp the gradients:
+			a_Out[x] = Lerp(
+				Lerp(Grad(a_Perm[AA], noiseXFrac, a_YFrac,     0), Grad(a_Perm[BA], noiseXFrac - 1, a_YFrac,     0), fadeX),
+				Lerp(Grad(a_Perm[AB], noiseXFrac, a_YFrac - 1, 0), Grad(a_Perm[BB], noiseXFrac - 1, a_YFrac - 1, 0), fadeX),
+				a_FadeY
+			);
+		}  // for x
+	}
+
+
+
+
+
+	void ImprovedNoiseRow2DScalar(
+		const int * a_Perm, NOISE_DATATYPE * a_Out, int a_SizeX,
+		NOISE_DATATYPE a_StartX, NOISE_DATATYPE a_EndX,
+		int a_YCoord, NOISE_DATATYPE a_YFrac, NOISE_DATATYPE a_FadeY
+	)
+	{
+		ImprovedNoiseRow2DFrom(a_Perm, a_Out, 0, a_SizeX, a_StartX, a_EndX, a_YCoord, a_YFrac, a_FadeY);
+	}
+
+
+
+
+
+	/** Calculates the values from a_FromX to the end of the row; the vectorized implementations use this for the last few values. */
+	void ImprovedNoiseRow3DFrom(
+		const int * a_Perm, NOISE_DATATYPE * a_Out, int a_FromX, int a_SizeX,
+		NOISE_DATATYPE a_StartX, NOISE_DATATYPE a_EndX,
+		int a_YCoord, NOISE_DATATYPE a_YFrac, NOISE_DATATYPE a_FadeY,
+		int a_ZCoord, NOISE_DATATYPE a_ZFrac, NOISE_DATATYPE a_FadeZ
+	)
+	{
+		for (int x = a_FromX; x < a_SizeX; x++)
+		{
+			NOISE_DATATYPE ratioX = static_cast<NOISE_DATATYPE>(x) / (a_SizeX - 1);
+			NOISE_DATATYPE noiseX = Lerp(a_StartX, a_EndX, ratioX);
+			int noiseXInt = FAST_FLOOR(noiseX);
+			int xCoord = noiseXInt & 255;
+			NOISE_DATATYPE noiseXFrac = noiseX - noiseXInt;
+			NOISE_DATATYPE fadeX = Fade(noiseXFrac);
+
+			// Hash the coordinates:
+			int A  = a_Perm[xCoord] + a_YCoord;
+			int AA = a_Perm[A] + a_ZCoord;
+			int AB = a_Perm[A + 1] + a_ZCoord;
+			int B  = a_Perm[xCoord + 1] + a_YCoord;
+			int BA = a_Perm[B] + a_ZCoord;
+			int BB = a_Perm[B + 1] + a_ZCoord;
+
+			// Lerp the gradients:
+			a_Out[x] = Lerp(
+				Lerp(
+					Lerp(Grad(a_Perm[AA], noiseXFrac, a_YFrac,     a_ZFrac), Grad(a_Perm[BA], noiseXFrac - 1, a_YFrac,     a_ZFrac), fadeX),
+					Lerp(Grad(a_Perm[AB], noiseXFrac, a_YFrac - 1, a_ZFrac), Grad(a_Perm[BB], noiseXFrac - 1, a_YFrac - 1, a_ZFrac), fadeX),
+					a_FadeY
+				),
+				Lerp(
+					Lerp(Grad(a_Perm[AA + 1], noiseXFrac, a_YFrac,     a_ZFrac - 1), Grad(a_Perm[BA + 1], noiseXFrac - 1, a_YFrac,     a_ZFrac - 1), fadeX),
+					Lerp(Grad(a_Perm[AB + 1], noiseXFrac, a_YFrac - 1, a_ZFrac - 1), Grad(a_Perm[BB + 1], noiseXFrac - 1, a_YFrac - 1, a_ZFrac - 1), fadeX),
+					a_FadeY
+				),
+				a_FadeZ
+			);
+		}  // for x
+	}
+
+
+
+
+
+	void ImprovedNoiseRow3DScalar(
+		const int * a_Perm, NOISE_DATATYPE * a_Out, int a_SizeX,
+		NOISE_DATATYPE a_StartX, NOISE_DATATYPE a_EndX,
+		int a_YCoord, NOISE_DATATYPE a_YFrac, NOISE_DATATYPE a_FadeY,
+		int a_ZCoord, NOISE_DATATYPE a_ZFrac, NOISE_DATATYPE a_FadeZ
+	)
+	{
+		ImprovedNoiseRow3DFrom(a_Perm, a_Out, 0, a_SizeX, a_StartX, a_EndX, a_YCoord, a_YFrac, a_FadeY, a_ZCoord, a_ZFrac, a_FadeZ);
+	}
+
+
+
+
+
+	const Implementation ScalarImplementation =
+	{
+		"Scalar",
+		&CubicInterpolateRowScalar,
+		&CubicInterpolateLanesScalar,
+		&IntNoiseRowScalar,
+		&ImprovedNoiseRow2DScalar,
+		&ImprovedNoiseRow3DScalar,
+	};
+
+
+
+
+
+#ifdef NOISE_KERNELS_X86
+
+	////////////////////////////////////////////////////////////////////////////////
+	// SSE4.1:
+
+	// All the vectorized functions mirror the scalar ones operation by operation, so that the results are bit-identical.
+
+	NOISE_KERNELS_TARGET_SSE41 inline __m128 CubicInterpolateSSE41(__m128 a_A, __m128 a_B, __m128 a_C, __m128 a_D, __m128 a_Pct)
+	{
+		const auto P = _mm_sub_ps(_mm_sub_ps(a_D, a_C), _mm_sub_ps(a_A, a_B));
+		const auto Q = _mm_sub_ps(_mm_sub_ps(a_A, a_B), P);
+		const auto R = _mm_sub_ps(a_C, a_A);
+		return _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(P, a_Pct), Q), a_Pct), R), a_Pct), a_B);
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_SSE41 void CubicInterpolateRowSSE41(const NOISE_DATATYPE (& a_Values)[4], const NOISE_DATATYPE * a_Pct, NOISE_DATATYPE * a_Out, int a_Count)
+	{
+		const auto A = _mm_set1_ps(a_Values[0]);
+		const auto B = _mm_set1_ps(a_Values[1]);
+		const auto C = _mm_set1_ps(a_Values[2]);
+		const auto D = _mm_set1_ps(a_Values[3]);
+		int i = 0;
+		for (; i + 4 <= a_Count; i += 4)
+		{
+			_mm_storeu_ps(a_Out + i, CubicInterpolateSSE41(A, B, C, D, _mm_loadu_ps(a_Pct + i)));
+		}
+		CubicInterpolateRowScalar(a_Values, a_Pct + i, a_Out + i, a_Count - i);
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_SSE41 void CubicInterpolateLanesSSE41(
+		const NOISE_DATATYPE * a_A, const NOISE_DATATYPE * a_B, const NOISE_DATATYPE * a_C, const NOISE_DATATYPE * a_D,
+		NOISE_DATATYPE a_Pct, NOISE_DATATYPE * a_Out, int a_Count
+	)
+	{
+		const auto Pct = _mm_set1_ps(a_Pct);
+		int i = 0;
+		for (; i + 4 <= a_Count; i += 4)
+		{
+			_mm_storeu_ps(a_Out + i, CubicInterpolateSSE41(
+				_mm_loadu_ps(a_A + i), _mm_loadu_ps(a_B + i), _mm_loadu_ps(a_C + i), _mm_loadu_ps(a_D + i), Pct
+			));
+		}
+		CubicInterpolateLanesScalar(a_A + i, a_B + i, a_C + i, a_D + i, a_Pct, a_Out + i, a_Count - i);
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_SSE41 void IntNoiseRowSSE41(int a_Base, NOISE_DATATYPE * a_Out, int a_Count)
+	{
+		const auto One = _mm_set1_ps(1);
+		const auto Divisor = _mm_set1_ps(1073741824.0f);
+		const auto Mask = _mm_set1_epi32(0x7fffffff);
+		auto Base = _mm_add_epi32(_mm_set1_epi32(a_Base), _mm_setr_epi32(0, 1, 2, 3));
+		int i = 0;
+		for (; i + 4 <= a_Count; i += 4)
+		{
+			auto n = _mm_xor_si128(_mm_slli_epi32(Base, 13), Base);
+			auto Hash = _mm_add_epi32(_mm_mullo_epi32(_mm_mullo_epi32(n, n), _mm_set1_epi32(15731)), _mm_set1_epi32(789221));
+			Hash = _mm_and_si128(_mm_add_epi32(_mm_mullo_epi32(n, Hash), _mm_set1_epi32(1376312589)), Mask);
+			_mm_storeu_ps(a_Out + i, _mm_sub_ps(One, _mm_div_ps(_mm_cvtepi32_ps(Hash), Divisor)));
+			Base = _mm_add_epi32(Base, _mm_set1_epi32(4));
+		}
+		IntNoiseRowScalar(static_cast<int>(static_cast<unsigned>(a_Base) + static_cast<unsigned>(i)), a_Out + i, a_Count - i);
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_SSE41 inline __m128i GatherSSE41(const int * a_Table, __m128i a_Idx)
+	{
+		return _mm_setr_epi32(
+			a_Table[_mm_extract_epi32(a_Idx, 0)],
+			a_Table[_mm_extract_epi32(a_Idx, 1)],
+			a_Table[_mm_extract_epi32(a_Idx, 2)],
+			a_Table[_mm_extract_epi32(a_Idx, 3)]
+		);
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_SSE41 inline __m128 LerpSSE41(__m128 a_Val1, __m128 a_Val2, __m128 a_Ratio)
+	{
+		return _mm_add_ps(a_Val1, _mm_mul_ps(_mm_sub_ps(a_Val2, a_Val1), a_Ratio));
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_SSE41 inline __m128 GradSSE41(__m128i a_Hash, __m128 a_X, __m128 a_Y, __m128 a_Z)
+	{
+		const auto Hash = _mm_and_si128(a_Hash, _mm_set1_epi32(15));
+		const auto IsBelow8 = _mm_castsi128_ps(_mm_cmplt_epi32(Hash, _mm_set1_epi32(8)));
+		const auto IsBelow4 = _mm_castsi128_ps(_mm_cmplt_epi32(Hash, _mm_set1_epi32(4)));
+		const auto Is12Or14 = _mm_castsi128_ps(_mm_or_si128(
+			_mm_cmpeq_epi32(Hash, _mm_set1_epi32(12)),
+			_mm_cmpeq_epi32(Hash, _mm_set1_epi32(14))
+		));
+		const auto u = _mm_blendv_ps(a_Y, a_X, IsBelow8);
+		const auto v = _mm_blendv_ps(_mm_blendv_ps(a_Z, a_X, Is12Or14), a_Y, IsBelow4);
+
+		// Negate by flipping the sign bits, according to the hash bits 0 and 1:
+		const auto SignU = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(Hash, _mm_set1_epi32(1)), 31));
+		const auto SignV = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(Hash, _mm_set1_epi32(2)), 30));
+		return _mm_add_ps(_mm_xor_ps(u, SignU), _mm_xor_ps(v, SignV));
+	}
+
+
+
+
+
+	/** The X-axis values of four consecutive columns of the improved noise. */
+	struct sImprovedNoiseColumnsSSE41
+	{
+		__m128i m_Coord;
+		__m128 m_Frac;
+		__m128 m_FracMinus1;
+		__m128 m_Fade;
+	};
+
+
+
+
+
+	NOISE_KERNELS_TARGET_SSE41 inline sImprovedNoiseColumnsSSE41 ImprovedNoiseColumnsSSE41(int a_X, __m128 a_SizeXMinus1, __m128 a_StartX, __m128 a_RangeX)
+	{
+		const auto X = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(a_X), _mm_setr_epi32(0, 1, 2, 3)));
+		const auto NoiseX = _mm_add_ps(a_StartX, _mm_mul_ps(a_RangeX, _mm_div_ps(X, a_SizeXMinus1)));
+
+		// FAST_FLOOR: truncate, then subtract one from the negative values (the mask is -1 for them):
+		const auto NoiseXInt = _mm_add_epi32(_mm_cvttps_epi32(NoiseX), _mm_castps_si128(_mm_cmplt_ps(NoiseX, _mm_setzero_ps())));
+		const auto Frac = _mm_sub_ps(NoiseX, _mm_cvtepi32_ps(NoiseXInt));
+		const auto FadeCubed = _mm_mul_ps(_mm_mul_ps(Frac, Frac), Frac);
+		const auto FadePoly = _mm_add_ps(_mm_mul_ps(Frac, _mm_sub_ps(_mm_mul_ps(Frac, _mm_set1_ps(6)), _mm_set1_ps(15))), _mm_set1_ps(10));
+		return
+		{
+			_mm_and_si128(NoiseXInt, _mm_set1_epi32(255)),
+			Frac,
+			_mm_sub_ps(Frac, _mm_set1_ps(1)),
+			_mm_mul_ps(FadeCubed, FadePoly)
+		};
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_SSE41 void ImprovedNoiseRow2DSSE41(
+		const int * a_Perm, NOISE_DATATYPE * a_Out, int a_SizeX,
+		NOISE_DATATYPE a_StartX, NOISE_DATATYPE a_EndX,
+		int a_YCoord, NOISE_DATATYPE a_YFrac, NOISE_DATATYPE a_FadeY
+	)
+	{
+		const auto SizeXMinus1 = _mm_set1_ps(static_cast<NOISE_DATATYPE>(a_SizeX - 1));
+		const auto StartX = _mm_set1_ps(a_StartX);
+		const auto RangeX = _mm_set1_ps(a_EndX - a_StartX);
+		const auto YCoord = _mm_set1_epi32(a_YCoord);
+		const auto YFrac = _mm_set1_ps(a_YFrac);
+		const auto YFracMinus1 = _mm_set1_ps(a_YFrac - 1);
+		const auto FadeY = _mm_set1_ps(a_FadeY);
+		const auto Zero = _mm_setzero_ps();
+		const auto One = _mm_set1_epi32(1);
+		int x = 0;
+		for (; x + 4 <= a_SizeX; x += 4)
+		{
+			const auto Columns = ImprovedNoiseColumnsSSE41(x, SizeXMinus1, StartX, RangeX);
+
+			// Hash the coordinates:
+			const auto A  = _mm_add_epi32(GatherSSE41(a_Perm, Columns.m_Coord), YCoord);
+			const auto AA = GatherSSE41(a_Perm, A);
+			const auto AB = GatherSSE41(a_Perm, _mm_add_epi32(A, One));
+			const auto B  = _mm_add_epi32(GatherSSE41(a_Perm, _mm_add_epi32(Columns.m_Coord, One)), YCoord);
+			const auto BA = GatherSSE41(a_Perm, B);
+			const auto BB = GatherSSE41(a_Perm, _mm_add_epi32(B, One));
+
+			// Lerp the gradients:
+			_mm_storeu_ps(a_Out + x, LerpSSE41(
+				LerpSSE41(
+					GradSSE41(GatherSSE41(a_Perm, AA), Columns.m_Frac,       YFrac, Zero),
+					GradSSE41(GatherSSE41(a_Perm, BA), Columns.m_FracMinus1, YFrac, Zero),
+					Columns.m_Fade
+				),
+				LerpSSE41(
+					GradSSE41(GatherSSE41(a_Perm, AB), Columns.m_Frac,       YFracMinus1, Zero),
+					GradSSE41(GatherSSE41(a_Perm, BB), Columns.m_FracMinus1, YFracMinus1, Zero),
+					Columns.m_Fade
+				),
+				FadeY
+			));
+		}
+		ImprovedNoiseRow2DFrom(a_Perm, a_Out, x, a_SizeX, a_StartX, a_EndX, a_YCoord, a_YFrac, a_FadeY);
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_SSE41 void ImprovedNoiseRow3DSSE41(
+		const int * a_Perm, NOISE_DATATYPE * a_Out, int a_SizeX,
+		NOISE_DATATYPE a_StartX, NOISE_DATATYPE a_EndX,
+		int a_YCoord, NOISE_DATATYPE a_YFrac, NOISE_DATATYPE a_FadeY,
+		int a_ZCoord, NOISE_DATATYPE a_ZFrac, NOISE_DATATYPE a_FadeZ
+	)
+	{
+		const auto SizeXMinus1 = _mm_set1_ps(static_cast<NOISE_DATATYPE>(a_SizeX - 1));
+		const auto StartX = _mm_set1_ps(a_StartX);
+		const auto RangeX = _mm_set1_ps(a_EndX - a_StartX);
+		const auto YCoord = _mm_set1_epi32(a_YCoord);
+		const auto YFrac = _mm_set1_ps(a_YFrac);
+		const auto YFracMinus1 = _mm_set1_ps(a_YFrac - 1);
+		const auto FadeY = _mm_set1_ps(a_FadeY);
+		const auto ZCoord = _mm_set1_epi32(a_ZCoord);
+		const auto ZFrac = _mm_set1_ps(a_ZFrac);
+		const auto ZFracMinus1 = _mm_set1_ps(a_ZFrac - 1);
+		const auto FadeZ = _mm_set1_ps(a_FadeZ);
+		const auto One = _mm_set1_epi32(1);
+		int x = 0;
+		for (; x + 4 <= a_SizeX; x += 4)
+		{
+			const auto Columns = ImprovedNoiseColumnsSSE41(x, SizeXMinus1, StartX, RangeX);
+
+			// Hash the coordinates:
+			const auto A  = _mm_add_epi32(GatherSSE41(a_Perm, Columns.m_Coord), YCoord);
+			const auto AA = _mm_add_epi32(GatherSSE41(a_Perm, A), ZCoord);
+			const auto AB = _mm_add_epi32(GatherSSE41(a_Perm, _mm_add_epi32(A, One)), ZCoord);
+			const auto B  = _mm_add_epi32(GatherSSE41(a_Perm, _mm_add_epi32(Columns.m_Coord, One)), YCoord);
+			const auto BA = _mm_add_epi32(GatherSSE41(a_Perm, B), ZCoord);
+			const auto BB = _mm_add_epi32(GatherSSE41(a_Perm, _mm_add_epi32(B, One)), ZCoord);
+
+			// Lerp the gradients:
+			_mm_storeu_ps(a_Out + x, LerpSSE41(
+				LerpSSE41(
+					LerpSSE41(
+						GradSSE41(GatherSSE41(a_Perm, AA), Columns.m_Frac,       YFrac, ZFrac),
+						GradSSE41(GatherSSE41(a_Perm, BA), Columns.m_FracMinus1, YFrac, ZFrac),
+						Columns.m_Fade
+					),
+					LerpSSE41(
+						GradSSE41(GatherSSE41(a_Perm, AB), Columns.m_Frac,       YFracMinus1, ZFrac),
+						GradSSE41(GatherSSE41(a_Perm, BB), Columns.m_FracMinus1, YFracMinus1, ZFrac),
+						Columns.m_Fade
+					),
+					FadeY
+				),
+				LerpSSE41(
+					LerpSSE41(
+						GradSSE41(GatherSSE41(a_Perm, _mm_add_epi32(AA, One)), Columns.m_Frac,       YFrac, ZFracMinus1),
+						GradSSE41(GatherSSE41(a_Perm, _mm_add_epi32(BA, One)), Columns.m_FracMinus1, YFrac, ZFracMinus1),
+						Columns.m_Fade
+					),
+					LerpSSE41(
+						GradSSE41(GatherSSE41(a_Perm, _mm_add_epi32(AB, One)), Columns.m_Frac,       YFracMinus1, ZFracMinus1),
+						GradSSE41(GatherSSE41(a_Perm, _mm_add_epi32(BB, One)), Columns.m_FracMinus1, YFracMinus1, ZFracMinus1),
+						Columns.m_Fade
+					),
+					FadeY
+				),
+				FadeZ
+			));
+		}
+		ImprovedNoiseRow3DFrom(a_Perm, a_Out, x, a_SizeX, a_StartX, a_EndX, a_YCoord, a_YFrac, a_FadeY, a_ZCoord, a_ZFrac, a_FadeZ);
+	}
+
+
+
+
+
+	////////////////////////////////////////////////////////////////////////////////
+	// AVX2:
+
+	NOISE_KERNELS_TARGET_AVX2 inline __m256 CubicInterpolateAVX2(__m256 a_A, __m256 a_B, __m256 a_C, __m256 a_D, __m256 a_Pct)
+	{
+		const auto P = _mm256_sub_ps(_mm256_sub_ps(a_D, a_C), _mm256_sub_ps(a_A, a_B));
+		const auto Q = _mm256_sub_ps(_mm256_sub_ps(a_A, a_B), P);
+		const auto R = _mm256_sub_ps(a_C, a_A);
+		return _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(P, a_Pct), Q), a_Pct), R), a_Pct), a_B);
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_AVX2 void CubicInterpolateRowAVX2(const NOISE_DATATYPE (& a_Values)[4], const NOISE_DATATYPE * a_Pct, NOISE_DATATYPE * a_Out, int a_Count)
+	{
+		const auto A = _mm256_set1_ps(a_Values[0]);
+		const auto B = _mm256_set1_ps(a_Values[1]);
+		const auto C = _mm256_set1_ps(a_Values[2]);
+		const auto D = _mm256_set1_ps(a_Values[3]);
+		int i = 0;
+		for (; i + 8 <= a_Count; i += 8)
+		{
+			_mm256_storeu_ps(a_Out + i, CubicInterpolateAVX2(A, B, C, D, _mm256_loadu_ps(a_Pct + i)));
+		}
+		CubicInterpolateRowSSE41(a_Values, a_Pct + i, a_Out + i, a_Count - i);
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_AVX2 void CubicInterpolateLanesAVX2(
+		const NOISE_DATATYPE * a_A, const NOISE_DATATYPE * a_B, const NOISE_DATATYPE * a_C, const NOISE_DATATYPE * a_D,
+		NOISE_DATATYPE a_Pct, NOISE_DATATYPE * a_Out, int a_Count
+	)
+	{
+		const auto Pct = _mm256_set1_ps(a_Pct);
+		int i = 0;
+		for (; i + 8 <= a_Count; i += 8)
+		{
+			_mm256_storeu_ps(a_Out + i, CubicInterpolateAVX2(
+				_mm256_loadu_ps(a_A + i), _mm256_loadu_ps(a_B + i), _mm256_loadu_ps(a_C + i), _mm256_loadu_ps(a_D + i), Pct
+			));
+		}
+		CubicInterpolateLanesSSE41(a_A + i, a_B + i, a_C + i, a_D + i, a_Pct, a_Out + i, a_Count - i);
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_AVX2 void IntNoiseRowAVX2(int a_Base, NOISE_DATATYPE * a_Out, int a_Count)
+	{
+		const auto One = _mm256_set1_ps(1);
+		const auto Divisor = _mm256_set1_ps(1073741824.0f);
+		const auto Mask = _mm256_set1_epi32(0x7fffffff);
+		auto Base = _mm256_add_epi32(_mm256_set1_epi32(a_Base), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		int i = 0;
+		for (; i + 8 <= a_Count; i += 8)
+		{
+			auto n = _mm256_xor_si256(_mm256_slli_epi32(Base, 13), Base);
+			auto Hash = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_mullo_epi32(n, n), _mm256_set1_epi32(15731)), _mm256_set1_epi32(789221));
+			Hash = _mm256_and_si256(_mm256_add_epi32(_mm256_mullo_epi32(n, Hash), _mm256_set1_epi32(1376312589)), Mask);
+			_mm256_storeu_ps(a_Out + i, _mm256_sub_ps(One, _mm256_div_ps(_mm256_cvtepi32_ps(Hash), Divisor)));
+			Base = _mm256_add_epi32(Base, _mm256_set1_epi32(8));
+		}
+		IntNoiseRowSSE41(static_cast<int>(static_cast<unsigned>(a_Base) + static_cast<unsigned>(i)), a_Out + i, a_Count - i);
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_AVX2 inline __m256i GatherAVX2(const int * a_Table, __m256i a_Idx)
+	{
+		return _mm256_i32gather_epi32(a_Table, a_Idx, 4);
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_AVX2 inline __m256 LerpAVX2(__m256 a_Val1, __m256 a_Val2, __m256 a_Ratio)
+	{
+		return _mm256_add_ps(a_Val1, _mm256_mul_ps(_mm256_sub_ps(a_Val2, a_Val1), a_Ratio));
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_AVX2 inline __m256 GradAVX2(__m256i a_Hash, __m256 a_X, __m256 a_Y, __m256 a_Z)
+	{
+		const auto Hash = _mm256_and_si256(a_Hash, _mm256_set1_epi32(15));
+		const auto IsBelow8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), Hash));
+		const auto IsBelow4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), Hash));
+		const auto Is12Or14 = _mm256_castsi256_ps(_mm256_or_si256(
+			_mm256_cmpeq_epi32(Hash, _mm256_set1_epi32(12)),
+			_mm256_cmpeq_epi32(Hash, _mm256_set1_epi32(14))
+		));
+		const auto u = _mm256_blendv_ps(a_Y, a_X, IsBelow8);
+		const auto v = _mm256_blendv_ps(_mm256_blendv_ps(a_Z, a_X, Is12Or14), a_Y, IsBelow4);
+
+		// Negate by flipping the sign bits, according to the hash bits 0 and 1:
+		const auto SignU = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(Hash, _mm256_set1_epi32(1)), 31));
+		const auto SignV = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(Hash, _mm256_set1_epi32(2)), 30));
+		return _mm256_add_ps(_mm256_xor_ps(u, SignU), _mm256_xor_ps(v, SignV));
+	}
+
+
+
+
+
+	/** The X-axis values of eight consecutive columns of the improved noise. */
+	struct sImprovedNoiseColumnsAVX2
+	{
+		__m256i m_Coord;
+		__m256 m_Frac;
+		__m256 m_FracMinus1;
+		__m256 m_Fade;
+	};
+
+
+
+
+
+	NOISE_KERNELS_TARGET_AVX2 inline sImprovedNoiseColumnsAVX2 ImprovedNoiseColumnsAVX2(int a_X, __m256 a_SizeXMinus1, __m256 a_StartX, __m256 a_RangeX)
+	{
+		const auto X = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(a_X), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+		const auto NoiseX = _mm256_add_ps(a_StartX, _mm256_mul_ps(a_RangeX, _mm256_div_ps(X, a_SizeXMinus1)));
+
+		// FAST_FLOOR: truncate, then subtract one from the negative values (the mask is -1 for them):
+		const auto IsNegative = _mm256_castps_si256(_mm256_cmp_ps(NoiseX, _mm256_setzero_ps(), _CMP_LT_OQ));
+		const auto NoiseXInt = _mm256_add_epi32(_mm256_cvttps_epi32(NoiseX), IsNegative);
+		const auto Frac = _mm256_sub_ps(NoiseX, _mm256_cvtepi32_ps(NoiseXInt));
+		const auto FadeCubed = _mm256_mul_ps(_mm256_mul_ps(Frac, Frac), Frac);
+		const auto FadePoly = _mm256_add_ps(_mm256_mul_ps(Frac, _mm256_sub_ps(_mm256_mul_ps(Frac, _mm256_set1_ps(6)), _mm256_set1_ps(15))), _mm256_set1_ps(10));
+		return
+		{
+			_mm256_and_si256(NoiseXInt, _mm256_set1_epi32(255)),
+			Frac,
+			_mm256_sub_ps(Frac, _mm256_set1_ps(1)),
+			_mm256_mul_ps(FadeCubed, FadePoly)
+		};
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_AVX2 void ImprovedNoiseRow2DAVX2(
+		const int * a_Perm, NOISE_DATATYPE * a_Out, int a_SizeX,
+		NOISE_DATATYPE a_StartX, NOISE_DATATYPE a_EndX,
+		int a_YCoord, NOISE_DATATYPE a_YFrac, NOISE_DATATYPE a_FadeY
+	)
+	{
+		const auto SizeXMinus1 = _mm256_set1_ps(static_cast<NOISE_DATATYPE>(a_SizeX - 1));
+		const auto StartX = _mm256_set1_ps(a_StartX);
+		const auto RangeX = _mm256_set1_ps(a_EndX - a_StartX);
+		const auto YCoord = _mm256_set1_epi32(a_YCoord);
+		const auto YFrac = _mm256_set1_ps(a_YFrac);
+		const auto YFracMinus1 = _mm256_set1_ps(a_YFrac - 1);
+		const auto FadeY = _mm256_set1_ps(a_FadeY);
+		const auto Zero = _mm256_setzero_ps();
+		const auto One = _mm256_set1_epi32(1);
+		int x = 0;
+		for (; x + 8 <= a_SizeX; x += 8)
+		{
+			const auto Columns = ImprovedNoiseColumnsAVX2(x, SizeXMinus1, StartX, RangeX);
+
+			// Hash the coordinates:
+			const auto A  = _mm256_add_epi32(GatherAVX2(a_Perm, Columns.m_Coord), YCoord);
+			const auto AA = GatherAVX2(a_Perm, A);
+			const auto AB = GatherAVX2(a_Perm, _mm256_add_epi32(A, One));
+			const auto B  = _mm256_add_epi32(GatherAVX2(a_Perm, _mm256_add_epi32(Columns.m_Coord, One)), YCoord);
+			const auto BA = GatherAVX2(a_Perm, B);
+			const auto BB = GatherAVX2(a_Perm, _mm256_add_epi32(B, One));
+
+			// Lerp the gradients:
+			_mm256_storeu_ps(a_Out + x, LerpAVX2(
+				LerpAVX2(
+					GradAVX2(GatherAVX2(a_Perm, AA), Columns.m_Frac,       YFrac, Zero),
+					GradAVX2(GatherAVX2(a_Perm, BA), Columns.m_FracMinus1, YFrac, Zero),
+					Columns.m_Fade
+				),
+				LerpAVX2(
+					GradAVX2(GatherAVX2(a_Perm, AB), Columns.m_Frac,       YFracMinus1, Zero),
+					GradAVX2(GatherAVX2(a_Perm, BB), Columns.m_FracMinus1, YFracMinus1, Zero),
+					Columns.m_Fade
+				),
+				FadeY
+			));
+		}
+		ImprovedNoiseRow2DFrom(a_Perm, a_Out, x, a_SizeX, a_StartX, a_EndX, a_YCoord, a_YFrac, a_FadeY);
+	}
+
+
+
+
+
+	NOISE_KERNELS_TARGET_AVX2 void ImprovedNoiseRow3DAVX2(
+		const int * a_Perm, NOISE_DATATYPE * a_Out, int a_SizeX,
+		NOISE_DATATYPE a_StartX, NOISE_DATATYPE a_EndX,
+		int a_YCoord, NOISE_DATATYPE a_YFrac, NOISE_DATATYPE a_FadeY,
+		int a_ZCoord, NOISE_DATATYPE a_ZFrac, NOISE_DATATYPE a_FadeZ
+	)
+	{
+		const auto SizeXMinus1 = _mm256_set1_ps(static_cast<NOISE_DATATYPE>(a_SizeX - 1));
+		const auto StartX = _mm256_set1_ps(a_StartX);
+		const auto RangeX = _mm256_set1_ps(a_EndX - a_StartX);
+		const auto YCoord = _mm256_set1_epi32(a_YCoord);
+		const auto YFrac = _mm256_set1_ps(a_YFrac);
+		const auto YFracMinus1 = _mm256_set1_ps(a_YFrac - 1);
+		const auto FadeY = _mm256_set1_ps(a_FadeY);
+		const auto ZCoord = _mm256_set1_epi32(a_ZCoord);
+		const auto ZFrac = _mm256_set1_ps(a_ZFrac);
+		const auto ZFracMinus1 = _mm256_set1_ps(a_ZFrac - 1);
+		const auto FadeZ = _mm256_set1_ps(a_FadeZ);
+		const auto One = _mm256_set1_epi32(1);
+		int x = 0;
+		for (; x + 8 <= a_SizeX; x += 8)
+		{
+			const auto Columns = ImprovedNoiseColumnsAVX2(x, SizeXMinus1, StartX, RangeX);
+
+			// Hash the coordinates:
+			const auto A  = _mm256_add_epi32(GatherAVX2(a_Perm, Columns.m_Coord), YCoord);
+			const auto AA = _mm256_add_epi32(GatherAVX2(a_Perm, A), ZCoord);
+			const auto AB = _mm256_add_epi32(GatherAVX2(a_Perm, _mm256_add_epi32(A, One)), ZCoord);
+			const auto B  = _mm256_add_epi32(GatherAVX2(a_Perm, _mm256_add_epi32(Columns.m_Coord, One)), YCoord);
+			const auto BA = _mm256_add_epi32(GatherAVX2(a_Perm, B), ZCoord);
+			const auto BB = _mm256_add_epi32(GatherAVX2(a_Perm, _mm256_add_epi32(B, One)), ZCoord);
+
+			// Lerp the gradients:
+			_mm256_storeu_ps(a_Out + x, LerpAVX2(
+				LerpAVX2(
+					LerpAVX2(
+						GradAVX2(GatherAVX2(a_Perm, AA), Columns.m_Frac,       YFrac, ZFrac),
+						GradAVX2(GatherAVX2(a_Perm, BA), Columns.m_FracMinus1, YFrac, ZFrac),
+						Columns.m_Fade
+					),
+					LerpAVX2(
+						GradAVX2(GatherAVX2(a_Perm, AB), Columns.m_Frac,       YFracMinus1, ZFrac),
+						GradAVX2(GatherAVX2(a_Perm, BB), Columns.m_FracMinus1, YFracMinus1, ZFrac),
+						Columns.m_Fade
+					),
+					FadeY
+				),
+				LerpAVX2(
+					LerpAVX2(
+						GradAVX2(GatherAVX2(a_Perm, _mm256_add_epi32(AA, One)), Columns.m_Frac,       YFrac, ZFracMinus1),
+						GradAVX2(GatherAVX2(a_Perm, _mm256_add_epi32(BA, One)), Columns.m_FracMinus1, YFrac, ZFracMinus1),
+						Columns.m_Fade
+					),
+					LerpAVX2(
+						GradAVX2(GatherAVX2(a_Perm, _mm256_add_epi32(AB, One)), Columns.m_Frac,       YFracMinus1, ZFracMinus1),
+						GradAVX2(GatherAVX2(a_Perm, _mm256_add_epi32(BB, One)), Columns.m_FracMinus1, YFracMinus1, ZFracMinus1),
+						Columns.m_Fade
+					),
+					FadeY
+				),
+				FadeZ
+			));
+		}
+		ImprovedNoiseRow3DFrom(a_Perm, a_Out, x, a_SizeX, a_StartX, a_EndX, a_YCoord, a_YFrac, a_FadeY, a_ZCoord, a_ZFrac, a_FadeZ);
+	}
+
+
+
+
+
+	bool IsSSE41Supported(void)
+	{
+		#if defined(__GNUC__) || defined(__clang__)
+			return __builtin_cpu_supports("sse4.1");
+		#elif defined(_MSC_VER)
+			int Info[4];
+			__cpuid(Info, 1);
+			return (Info[2] & (1 << 19)) != 0;
+		#else
+			return false;
+		#endif
+	}
+
+
+
+
+
+	bool IsAVX2Supported(void)
+	{
+		#if defined(__GNUC__) || defined(__clang__)
+			return __builtin_cpu_supports("avx2");
+		#elif defined(_MSC_VER)
+			// The OS must save the AVX registers (OSXSAVE and XCR0), and the CPU must have AVX2:
+			int Info[4];
+			__cpuid(Info, 1);
+			if (((Info[2] & (1 << 27)) == 0) || ((_xgetbv(0) & 0x06) != 0x06))
+			{
+				return false;
+			}
+			__cpuidex(Info, 7, 0);
+			return (Info[1] & (1 << 5)) != 0;
+		#else
+			return false;
+		#endif
+	}
+
+#endif  // NOISE_KERNELS_X86
+
+
+
+
+
+	const Implementation & GetSelectedImplementation(void)
+	{
+		static const Implementation Selected = []() -> Implementation
+		{
+			#ifdef NOISE_KERNELS_X86
+				if (IsAVX2Supported())
+				{
+					return { "AVX2", &CubicInterpolateRowAVX2, &CubicInterpolateLanesAVX2, &IntNoiseRowAVX2, &ImprovedNoiseRow2DAVX2, &ImprovedNoiseRow3DAVX2 };
+				}
+				if (IsSSE41Supported())
+				{
+					return { "SSE4.1", &CubicInterpolateRowSSE41, &CubicInterpolateLanesSSE41, &IntNoiseRowSSE41, &ImprovedNoiseRow2DSSE41, &ImprovedNoiseRow3DSSE41 };
+				}
+			#endif
+			return ScalarImplementation;
+		}();
+		return Selected;
+	}
+
+
+
+
+
+	/** The implementation currently in use, normally the selected one. */
+	const Implementation *& CurrentImplementation(void)
+	{
+		static const Implementation * Current = &GetSelectedImplementation();
+		return Current;
+	}
+}
+
+
+
+
+
+void NoiseKernels::CubicInterpolateRow(const NOISE_DATATYPE (& a_Values)[4], const NOISE_DATATYPE * a_Pct, NOISE_DATATYPE * a_Out, int a_Count)
+{
+	CurrentImplementation()->CubicInterpolateRow(a_Values, a_Pct, a_Out, a_Count);
+}
+
+
+
+
+
+void NoiseKernels::CubicInterpolateLanes(
+	const NOISE_DATATYPE * a_A, const NOISE_DATATYPE * a_B, const NOISE_DATATYPE * a_C, const NOISE_DATATYPE * a_D,
+	NOISE_DATATYPE a_Pct, NOISE_DATATYPE * a_Out, int a_Count
+)
+{
+	CurrentImplementation()->CubicInterpolateLanes(a_A, a_B, a_C, a_D, a_Pct, a_Out, a_Count);
+}
+
+
+
+
+
+void NoiseKernels::IntNoiseRow(int a_Base, NOISE_DATATYPE * a_Out, int a_Count)
+{
+	CurrentImplementation()->IntNoiseRow(a_Base, a_Out, a_Count);
+}
+
+
+
+
+
+void NoiseKernels::ImprovedNoiseRow2D(
+	const int * a_Perm, NOISE_DATATYPE * a_Out, int a_SizeX,
+	NOISE_DATATYPE a_StartX, NOISE_DATATYPE a_EndX,
+	int a_YCoord, NOISE_DATATYPE a_YFrac, NOISE_DATATYPE a_FadeY
+)
+{
+	CurrentImplementation()->ImprovedNoiseRow2D(a_Perm, a_Out, a_SizeX, a_StartX, a_EndX, a_YCoord, a_YFrac, a_FadeY);
+}
+
+
+
+
+
+void NoiseKernels::ImprovedNoiseRow3D(
+	const int * a_Perm, NOISE_DATATYPE * a_Out, int a_SizeX,
+	NOISE_DATATYPE a_StartX, NOISE_DATATYPE a_EndX,
+	int a_YCoord, NOISE_DATATYPE a_YFrac, NOISE_DATATYPE a_FadeY,
+	int a_ZCoord, NOISE_DATATYPE a_ZFrac, NOISE_DATATYPE a_FadeZ
+)
+{
+	CurrentImplementation()->ImprovedNoiseRow3D(
+		a_Perm, a_Out, a_SizeX, a_StartX, a_EndX,
+		a_YCoord, a_YFrac, a_FadeY,
+		a_ZCoord, a_ZFrac, a_FadeZ
+	);
+}
+
+
+
+
+
+const char * NoiseKernels::GetImplementationName(void)
+{
+	return CurrentImplementation()->Name;
+}
+
+
+
+
+
+void NoiseKernels::ForceScalar(bool a_UseScalar)
+{
+	CurrentImplementation() = a_UseScalar ? &ScalarImplementation : &GetSelectedImplementation();
+}
@@ -0,0 +1,68 @@
+// NoiseKernels.h
+
+// Declares the inner loops of cCubicNoise and cImprovedNoise, with vectorized implementations selected at runtime
+
+/*
+Each function processes a run of values that the noise generators would otherwise calculate one by one.
+The vectorized implementations (AVX2 if the CPU supports it, otherwise SSE4.1, on x86) do exactly the same
+floating-point operations in the same order as the scalar ones, so they produce bit-identical results and
+a world generates the same regardless of the CPU. For that, Noise.cpp and NoiseKernels.cpp are compiled
+without -ffast-math and without FMA contraction.
+The scalar implementations are the original cCubicNoise and cImprovedNoise loops and give the same results as them
+when compiled with the same flags. The values of the worlds generated before the kernels were introduced differ in the last bits,
+as those were calculated with -ffast-math, whose results depend on the compiler and on the CPU the server was built for.
+*/
+
+
+
+
+
+#pragma once
+
+#include "Noise.h"
+
+
+
+
+
+namespace NoiseKernels
+{
+	/** Fills a_Out[i] with cNoise::CubicInterpolate(a_Values[0], a_Values[1], a_Values[2], a_Values[3], a_Pct[i]), for i in [0, a_Count). */
+	void CubicInterpolateRow(const NOISE_DATATYPE (& a_Values)[4], const NOISE_DATATYPE * a_Pct, NOISE_DATATYPE * a_Out, int a_Count);
+
+	/** Fills a_Out[i] with cNoise::CubicInterpolate(a_A[i], a_B[i], a_C[i], a_D[i], a_Pct), for i in [0, a_Count). */
+	void CubicInterpolateLanes(
+		const NOISE_DATATYPE * a_A, const NOISE_DATATYPE * a_B, const NOISE_DATATYPE * a_C, const NOISE_DATATYPE * a_D,
+		NOISE_DATATYPE a_Pct, NOISE_DATATYPE * a_Out, int a_Count
+	);
+
+	/** Fills a_Out[i] with the cNoise integer noise of the hash input a_Base + i, for i in [0, a_Count).
+	The hash input of cNoise::IntNoise2D(X, Y) is X + Y * 57 + Seed * 57 * 57,
+	the hash input of cNoise::IntNoise3D(X, Y, Z) is X + Y * 57 + Z * 57 * 57 + Seed * 57 * 57 * 57,
+	so a run along the X axis of either is a run of consecutive hash inputs. */
+	void IntNoiseRow(int a_Base, NOISE_DATATYPE * a_Out, int a_Count);
+
+	/** Calculates one row along the X axis of cImprovedNoise::Generate2D().
+	a_Perm is the noise's permutation table, the Y values are the ones shared by the entire row. */
+	void ImprovedNoiseRow2D(
+		const int * a_Perm, NOISE_DATATYPE * a_Out, int a_SizeX,
+		NOISE_DATATYPE a_StartX, NOISE_DATATYPE a_EndX,
+		int a_YCoord, NOISE_DATATYPE a_YFrac, NOISE_DATATYPE a_FadeY
+	);
+
+	/** Calculates one row along the X axis of cImprovedNoise::Generate3D().
+	a_Perm is the noise's permutation table, the Y and Z values are the ones shared by the entire row. */
+	void ImprovedNoiseRow3D(
+		const int * a_Perm, NOISE_DATATYPE * a_Out, int a_SizeX,
+		NOISE_DATATYPE a_StartX, NOISE_DATATYPE a_EndX,
+		int a_YCoord, NOISE_DATATYPE a_YFrac, NOISE_DATATYPE a_FadeY,
+		int a_ZCoord, NOISE_DATATYPE a_ZFrac, NOISE_DATATYPE a_FadeZ
+	);
+
+	/** Returns the name of the implementation selected for this CPU, such as "AVX2". */
+	const char * GetImplementationName(void);
+
+	/** Switches all the functions to the scalar reference implementation (a_UseScalar == true) or back to the one selected for this CPU.
+	Used for testing and benchmarking the vectorized implementations. Not thread-safe, call only while no noise is being generated. */
+	void ForceScalar(bool a_UseScalar);
+}
@@ -6,11 +6,83 @@
 
 
 
+/** The CS that has been lent to the current thread by another thread that holds it, via cCriticalSection::BorrowFromOwner().
+nullptr if there's no such CS. */
+static thread_local cCriticalSection * s_BorrowedCS = nullptr;
+
+/** Number of times that the current thread has locked s_BorrowedCS (levels of recursion). */
+static thread_local int s_BorrowedRecursionCount = 0;
+
+/** Set while the current thread runs alone among the borrowers of s_BorrowedCS. */
+static thread_local bool s_IsBorrowedExclusively = false;
+
+/** A CS held shared by the current thread. */
+struct sSharedHold
+{
+	const cCriticalSection * m_CS;
+	int m_RecursionCount;
+	std::chrono::steady_clock::time_point m_Since;
+};
+
+/** The CSs that the current thread holds shared. Usually empty or a single item. */
+static thread_local std::vector<sSharedHold> s_SharedHolds;
+
+
+
+
+
+static sSharedHold * FindSharedHold(const cCriticalSection * a_CS)
+{
+	for (auto & Hold : s_SharedHolds)
+	{
+		if (Hold.m_CS == a_CS)
+		{
+			return &Hold;
+		}
+	}
+	return nullptr;
+}
+
+
+
+
+
+static UInt64 NanosecondsSince(const std::chrono::steady_clock::time_point a_Since, const std::chrono::steady_clock::time_point a_Now)
+{
+	return static_cast<UInt64>(std::chrono::duration_cast<std::chrono::nanoseconds>(a_Now - a_Since).count());
+}
+
+
+
+
+
+static void UpdateMax(std::atomic<UInt64> & a_Max, const UInt64 a_Value)
+{
+	auto Current = a_Max.load(std::memory_order_relaxed);
+	while ((Current < a_Value) && !a_Max.compare_exchange_weak(Current, a_Value, std::memory_order_relaxed))
+	{
+	}
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cCriticalSection:
 
 cCriticalSection::cCriticalSection():
-	m_RecursionCount(0)
+	m_RecursionCount(0),
+	m_NumSharedHolders(0),
+	m_CollectStatistics(false),
+	m_NumExclusiveLocks(0),
+	m_ExclusiveWaitNs(0),
+	m_ExclusiveHoldNs(0),
+	m_MaxExclusiveHoldNs(0),
+	m_NumSharedLocks(0),
+	m_SharedWaitNs(0),
+	m_SharedHoldNs(0),
+	m_MaxSharedHoldNs(0)
 {
 }
 
@@ -20,10 +92,46 @@ cCriticalSection::cCriticalSection():
 
 void cCriticalSection::Lock()
 {
-	m_Mutex.lock();
+	if (s_BorrowedCS == this)
+	{
+		// The lender is holding the mutex for us, wait until the other borrowers stop touching the shared data.
+		// They stop in YieldToBorrowers() between their work items, or here, if they want to run alone, too:
+		if (!s_IsBorrowedExclusively)
+		{
+			m_BorrowersMutex.unlock_shared();
+			std::lock_guard<std::mutex> Gate(m_BorrowersGate);
+			m_BorrowersMutex.lock();
+			s_IsBorrowedExclusively = true;
+		}
+		s_BorrowedRecursionCount += 1;
+		return;
+	}
+
+	const auto ThisThread = std::this_thread::get_id();
+	if (m_OwningThreadID.load(std::memory_order_relaxed) == ThisThread)
+	{
+		// Recursive lock:
+		m_RecursionCount += 1;
+		return;
+	}
+
+	ASSERT(FindSharedHold(this) == nullptr);  // Upgrading a shared lock would deadlock
+
+	if (m_CollectStatistics.load(std::memory_order_relaxed))
+	{
+		const auto Start = std::chrono::steady_clock::now();
+		LockWriter();
+		m_ExclusiveSince = std::chrono::steady_clock::now();
+		m_ExclusiveWaitNs.fetch_add(NanosecondsSince(Start, m_ExclusiveSince), std::memory_order_relaxed);
+		m_NumExclusiveLocks.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		LockWriter();
+	}
 
-	m_RecursionCount += 1;
-	m_OwningThreadID = std::this_thread::get_id();
+	m_RecursionCount = 1;
+	m_OwningThreadID.store(ThisThread, std::memory_order_relaxed);
 }
 
 
@@ -32,8 +140,28 @@ void cCriticalSection::Lock()
 
 void cCriticalSection::Unlock()
 {
-	ASSERT(IsLockedByCurrentThread());
+	if (s_BorrowedCS == this)
+	{
+		// Keep running alone, the borrower may still hold pointers obtained under the lock; YieldToBorrowers() ends it:
+		ASSERT(s_BorrowedRecursionCount > 0);
+		s_BorrowedRecursionCount -= 1;
+		return;
+	}
+
+	ASSERT(m_OwningThreadID.load(std::memory_order_relaxed) == std::this_thread::get_id());
 	m_RecursionCount -= 1;
+	if (m_RecursionCount > 0)
+	{
+		return;
+	}
+
+	m_OwningThreadID.store(std::thread::id(), std::memory_order_relaxed);
+	if (m_CollectStatistics.load(std::memory_order_relaxed))
+	{
+		const auto Held = NanosecondsSince(m_ExclusiveSince, std::chrono::steady_clock::now());
+		m_ExclusiveHoldNs.fetch_add(Held, std::memory_order_relaxed);
+		UpdateMax(m_MaxExclusiveHoldNs, Held);
+	}
 
 	m_Mutex.unlock();
 }
@@ -42,9 +170,175 @@ void cCriticalSection::Unlock()
 
 
 
+void cCriticalSection::LockShared()
+{
+	if (s_BorrowedCS == this)
+	{
+		// The other borrowers may be modifying the data, reading needs the same exclusion as writing:
+		Lock();
+		return;
+	}
+
+	if (m_OwningThreadID.load(std::memory_order_relaxed) == std::this_thread::get_id())
+	{
+		// Already held exclusively by this thread, lock recursively; UnlockShared() will notice the same:
+		m_RecursionCount += 1;
+		return;
+	}
+
+	if (const auto Hold = FindSharedHold(this); Hold != nullptr)
+	{
+		// Don't touch the mutex, a recursive lock_shared() could block behind a waiting writer:
+		Hold->m_RecursionCount += 1;
+		return;
+	}
+
+	std::chrono::steady_clock::time_point Since;
+	if (m_CollectStatistics.load(std::memory_order_relaxed))
+	{
+		const auto Start = std::chrono::steady_clock::now();
+		LockReader();
+		Since = std::chrono::steady_clock::now();
+		m_SharedWaitNs.fetch_add(NanosecondsSince(Start, Since), std::memory_order_relaxed);
+		m_NumSharedLocks.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		LockReader();
+	}
+
+	m_NumSharedHolders.fetch_add(1, std::memory_order_relaxed);
+	s_SharedHolds.push_back({ this, 1, Since });
+}
+
+
+
+
+
+void cCriticalSection::UnlockShared()
+{
+	if (s_BorrowedCS == this)
+	{
+		Unlock();
+		return;
+	}
+
+	if (m_OwningThreadID.load(std::memory_order_relaxed) == std::this_thread::get_id())
+	{
+		Unlock();
+		return;
+	}
+
+	const auto Hold = FindSharedHold(this);
+	ASSERT(Hold != nullptr);
+	Hold->m_RecursionCount -= 1;
+	if (Hold->m_RecursionCount > 0)
+	{
+		return;
+	}
+
+	if (m_CollectStatistics.load(std::memory_order_relaxed))
+	{
+		const auto Held = NanosecondsSince(Hold->m_Since, std::chrono::steady_clock::now());
+		m_SharedHoldNs.fetch_add(Held, std::memory_order_relaxed);
+		UpdateMax(m_MaxSharedHoldNs, Held);
+	}
+
+	*Hold = s_SharedHolds.back();
+	s_SharedHolds.pop_back();
+	m_NumSharedHolders.fetch_sub(1, std::memory_order_relaxed);
+	m_Mutex.unlock_shared();
+}
+
+
+
+
+
+void cCriticalSection::LockWriter(void)
+{
+	std::lock_guard<std::mutex> Gate(m_WriterGate);
+	m_Mutex.lock();
+}
+
+
+
+
+
+void cCriticalSection::LockReader(void)
+{
+	{
+		// Wait for the writer that is already waiting; the shared holders never need the gate to release the CS:
+		std::lock_guard<std::mutex> Gate(m_WriterGate);
+	}
+	m_Mutex.lock_shared();
+}
+
+
+
+
+
+void cCriticalSection::BorrowFromOwner(void)
+{
+	ASSERT(IsLocked());
+	ASSERT(s_BorrowedCS == nullptr);  // Only one CS can be borrowed at a time
+	m_BorrowersMutex.lock_shared();
+	s_BorrowedCS = this;
+	s_BorrowedRecursionCount = 0;
+	s_IsBorrowedExclusively = false;
+}
+
+
+
+
+
+void cCriticalSection::YieldToBorrowers(void)
+{
+	ASSERT(s_BorrowedCS == this);
+	ASSERT(s_BorrowedRecursionCount == 0);
+	if (s_IsBorrowedExclusively)
+	{
+		s_IsBorrowedExclusively = false;
+		m_BorrowersMutex.unlock();
+	}
+	else
+	{
+		m_BorrowersMutex.unlock_shared();
+	}
+
+	{
+		// Let a borrower that waits to run alone in first; it may be waiting for this very borrower to yield:
+		std::lock_guard<std::mutex> Gate(m_BorrowersGate);
+	}
+	m_BorrowersMutex.lock_shared();
+}
+
+
+
+
+
+void cCriticalSection::ReturnToOwner(void)
+{
+	ASSERT(s_BorrowedCS == this);
+	ASSERT(s_BorrowedRecursionCount == 0);
+	if (s_IsBorrowedExclusively)
+	{
+		s_IsBorrowedExclusively = false;
+		m_BorrowersMutex.unlock();
+	}
+	else
+	{
+		m_BorrowersMutex.unlock_shared();
+	}
+	s_BorrowedCS = nullptr;
+}
+
+
+
+
+
 bool cCriticalSection::IsLocked(void)
 {
-	return (m_RecursionCount > 0);
+	return (m_RecursionCount > 0) || (m_NumSharedHolders.load(std::memory_order_relaxed) > 0);
 }
 
 
@@ -53,7 +347,33 @@ bool cCriticalSection::IsLocked(void)
 
 bool cCriticalSection::IsLockedByCurrentThread(void)
 {
-	return ((m_RecursionCount > 0) && (m_OwningThreadID == std::this_thread::get_id()));
+	if (s_BorrowedCS == this)
+	{
+		return s_IsBorrowedExclusively;
+	}
+
+	return (
+		(m_OwningThreadID.load(std::memory_order_relaxed) == std::this_thread::get_id()) ||
+		(FindSharedHold(this) != nullptr)
+	);
+}
+
+
+
+
+
+cCriticalSection::sStatistics cCriticalSection::GetStatistics(void) const
+{
+	sStatistics Result;
+	Result.m_NumExclusiveLocks = m_NumExclusiveLocks;
+	Result.m_ExclusiveWaitNs = m_ExclusiveWaitNs;
+	Result.m_ExclusiveHoldNs = m_ExclusiveHoldNs;
+	Result.m_MaxExclusiveHoldNs = m_MaxExclusiveHoldNs;
+	Result.m_NumSharedLocks = m_NumSharedLocks;
+	Result.m_SharedWaitNs = m_SharedWaitNs;
+	Result.m_SharedHoldNs = m_SharedHoldNs;
+	Result.m_MaxSharedHoldNs = m_MaxSharedHoldNs;
+	return Result;
 }
 
 
@@ -120,6 +440,28 @@ void cCSLock::Unlock(void)
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+// cCSSharedLock:
+
+cCSSharedLock::cCSSharedLock(cCriticalSection & a_CS) :
+	m_CS(a_CS)
+{
+	m_CS.LockShared();
+}
+
+
+
+
+
+cCSSharedLock::~cCSSharedLock()
+{
+	m_CS.UnlockShared();
+}
+
+
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 // cCSUnlock:
 
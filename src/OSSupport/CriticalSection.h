@@ -10,11 +10,52 @@ class cCriticalSection
 	friend class cDeadlockDetect;  // Allow the DeadlockDetect to read the internals, so that it may output some statistics
 
 public:
+
+	/** Time spent waiting for and holding the CS, counted for the outermost lock of each thread only.
+	Collected only after EnableStatistics() has been called. */
+	struct sStatistics
+	{
+		UInt64 m_NumExclusiveLocks;
+		UInt64 m_ExclusiveWaitNs;
+		UInt64 m_ExclusiveHoldNs;
+		UInt64 m_MaxExclusiveHoldNs;
+
+		UInt64 m_NumSharedLocks;
+		UInt64 m_SharedWaitNs;
+		UInt64 m_SharedHoldNs;
+		UInt64 m_MaxSharedHoldNs;
+	};
+
 	void Lock(void);
 	void Unlock(void);
 
+	/** Locks the CS for reading only. Any number of threads may hold the CS shared at the same time, while Lock() excludes them all.
+	A thread waiting in Lock() has precedence, new shared locks wait until it gets and releases the CS.
+	Recursive; if the calling thread already holds the CS exclusively, this acts as a recursive Lock().
+	A thread holding the CS shared must not call Lock() until it releases the shared lock, that would deadlock. */
+	void LockShared(void);
+	void UnlockShared(void);
+
 	cCriticalSection(void);
 
+	/** Joins the calling thread to the borrowers of this CS, which is held by another thread (the owner) on their behalf.
+	The owner waits for all the borrowers to finish their work and call ReturnToOwner(); it may be a borrower itself.
+	Used for handing the ChunkMap CS to the worker threads of a parallel chunk tick.
+	The borrowers run in parallel while they only touch the data that the owner has partitioned between them.
+	Locking the borrowed CS (exclusive or shared) waits until each other borrower either calls YieldToBorrowers() or locks the CS, too;
+	the calling borrower then keeps running alone until it calls YieldToBorrowers() itself.
+	So a borrower is only ever stopped in the middle of its work item while it waits to lock the CS, all others stop between their items.
+	A borrower must not lock the CS while holding another lock that a borrower running alone might need, that would deadlock. */
+	void BorrowFromOwner(void);
+
+	/** Marks the end of a work item of the calling borrower, a point where it holds no pointers into the shared data.
+	Lets a borrower that waits to run alone in, and the other borrowers run in parallel again if the calling borrower has been running alone.
+	The calling borrower must not hold any lock on the CS. */
+	void YieldToBorrowers(void);
+
+	/** Ends the borrowing started by BorrowFromOwner() on the calling thread. */
+	void ReturnToOwner(void);
+
 	/** Returns true if the CS is currently locked.
 	Note that since it relies on the m_RecursionCount value, it is inherently thread-unsafe, prone to false positives.
 	Also, due to multithreading, the state can change between this when function is evaluated and the returned value is used.
@@ -22,11 +63,17 @@ public:
 	bool IsLocked(void);
 
 	/** Returns true if the CS is currently locked by the thread calling this function.
+	A borrower counts as locking the CS only while it runs alone.
 	Note that since it relies on the m_RecursionCount value, it is inherently thread-unsafe, prone to false positives.
 	Also, due to multithreading, the state can change between this when function is evaluated and the returned value is used.
 	To be used in ASSERT(IsLockedByCurrentThread()) only. */
 	bool IsLockedByCurrentThread(void);
 
+	/** Starts collecting the lock statistics. Adds two clock reads to each outermost lock and unlock. */
+	void EnableStatistics(void) { m_CollectStatistics = true; }
+
+	sStatistics GetStatistics(void) const;
+
 private:
 
 	/** Number of times that this CS is currently locked (levels of recursion). Zero if not locked.
@@ -39,10 +86,47 @@ private:
 	Note that this value should be considered true only when the CS is locked; without the lock, it is UndefinedBehavior to even read it,
 	but making it std::atomic would impose too much of a runtime penalty.
 	When unlocked, the value stored here has no meaning, it may be an ID of a previous holder, or it could be any garbage.
-	It is only ever read without the lock in the DeadlockDetect, where the server is terminating anyway. */
-	std::thread::id m_OwningThreadID;
+	It is only ever read without the lock in the DeadlockDetect, where the server is terminating anyway.
+	Atomic, because each locking thread compares it with its own ID to detect recursion. */
+	std::atomic<std::thread::id> m_OwningThreadID;
+
+	/** Number of threads currently holding the CS shared. */
+	std::atomic<int> m_NumSharedHolders;
+
+	std::shared_mutex m_Mutex;
+
+	/** Held by the thread waiting for an exclusive lock of m_Mutex; the new shared lockers pass through it first.
+	std::shared_mutex may prefer readers, so that a steady stream of shared locks would starve the writers. */
+	std::mutex m_WriterGate;
+
+	/** Excludes the borrowers from each other: held shared by each borrower running in parallel,
+	held exclusively by the borrower running alone. */
+	std::shared_mutex m_BorrowersMutex;
+
+	/** Held by the borrower waiting to lock m_BorrowersMutex exclusively; the borrowers yielding between their work items pass through it
+	before locking m_BorrowersMutex shared again, so that they don't starve the waiting borrower. */
+	std::mutex m_BorrowersGate;
+
+	/** Set by EnableStatistics(). */
+	std::atomic<bool> m_CollectStatistics;
 
-	std::recursive_mutex m_Mutex;
+	/** The time when the current exclusive owner locked the CS, valid only while statistics are collected. */
+	std::chrono::steady_clock::time_point m_ExclusiveSince;
+
+	std::atomic<UInt64> m_NumExclusiveLocks;
+	std::atomic<UInt64> m_ExclusiveWaitNs;
+	std::atomic<UInt64> m_ExclusiveHoldNs;
+	std::atomic<UInt64> m_MaxExclusiveHoldNs;
+	std::atomic<UInt64> m_NumSharedLocks;
+	std::atomic<UInt64> m_SharedWaitNs;
+	std::atomic<UInt64> m_SharedHoldNs;
+	std::atomic<UInt64> m_MaxSharedHoldNs;
+
+	/** Locks m_Mutex exclusively, keeping the new shared lockers out while waiting. */
+	void LockWriter(void);
+
+	/** Locks m_Mutex shared, after any thread already waiting for the exclusive lock. */
+	void LockReader(void);
 };
 
 
@@ -75,6 +159,23 @@ private:
 
 
 
+/** RAII for cCriticalSection - locks the CS shared (for reading) on creation, unlocks on destruction */
+class cCSSharedLock
+{
+	cCriticalSection & m_CS;
+
+public:
+	cCSSharedLock(cCriticalSection & a_CS);
+	~cCSSharedLock();
+
+private:
+	DISALLOW_COPY_AND_ASSIGN(cCSSharedLock);
+} ;
+
+
+
+
+
 /** Temporary RAII unlock for a cCSLock. Useful for unlock-wait-relock scenarios */
 class cCSUnlock
 {
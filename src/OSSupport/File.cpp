@@ -8,6 +8,7 @@
 #include "File.h"
 #include <sys/stat.h>
 #ifdef _WIN32
+	#include <io.h>  // for _commit()
 	#include <share.h>  // for _SH_DENYWRITE
 #else
 	#include <dirent.h>
@@ -701,6 +702,23 @@ void cFile::Flush()
 
 
 
+bool cFile::Sync()
+{
+	if (fflush(m_File) != 0)
+	{
+		return false;
+	}
+	#ifdef _WIN32
+		return (_commit(_fileno(m_File)) == 0);
+	#else
+		return (fsync(fileno(m_File)) == 0);
+	#endif
+}
+
+
+
+
+
 template <class StreamType>
 FileStream<StreamType>::FileStream(const std::string & Path)
 {
@@ -171,6 +171,10 @@ public:
 	/** Flushes all the bufferef output into the file (only when writing) */
 	void Flush();
 
+	/** Flushes the buffered output and waits until the OS has written the file's data to the disk.
+	Returns true on success. */
+	bool Sync();
+
 private:
 	FILE * m_File;
 } ;  // tolua_export
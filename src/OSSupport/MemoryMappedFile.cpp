@@ -0,0 +1,151 @@
+
+// MemoryMappedFile.cpp
+
+// Implements the cMemoryMappedFile class that maps an entire file into memory for reading
+
+#include "Globals.h"
+
+#include "MemoryMappedFile.h"
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+
+
+
+
+cMemoryMappedFile::cMemoryMappedFile(void):
+	m_IsOpen(false),
+	m_Data(nullptr),
+	m_Size(0)
+	#ifdef _WIN32
+		, m_File(INVALID_HANDLE_VALUE),
+		m_Mapping(nullptr)
+	#endif
+{
+}
+
+
+
+
+
+cMemoryMappedFile::cMemoryMappedFile(const AString & a_FileName):
+	cMemoryMappedFile()
+{
+	Open(a_FileName);
+}
+
+
+
+
+
+cMemoryMappedFile::~cMemoryMappedFile()
+{
+	Close();
+}
+
+
+
+
+
+bool cMemoryMappedFile::Open(const AString & a_FileName)
+{
+	Close();
+
+	#ifdef _WIN32
+		m_File = CreateFileA(a_FileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_File == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER Size;
+		if (!GetFileSizeEx(m_File, &Size))
+		{
+			Close();
+			return false;
+		}
+		m_Size = static_cast<size_t>(Size.QuadPart);
+		if (m_Size > 0)
+		{
+			// Empty files cannot be mapped, they are represented by an empty view:
+			m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (m_Mapping == nullptr)
+			{
+				Close();
+				return false;
+			}
+			m_Data = static_cast<const std::byte *>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+			if (m_Data == nullptr)
+			{
+				Close();
+				return false;
+			}
+		}
+	#else
+		int File = open(a_FileName.c_str(), O_RDONLY);
+		if (File < 0)
+		{
+			return false;
+		}
+		struct stat Stat;
+		if (fstat(File, &Stat) != 0)
+		{
+			close(File);
+			return false;
+		}
+		m_Size = static_cast<size_t>(Stat.st_size);
+		if (m_Size > 0)
+		{
+			// Empty files cannot be mapped, they are represented by an empty view:
+			auto Data = mmap(nullptr, m_Size, PROT_READ, MAP_SHARED, File, 0);
+			if (Data == MAP_FAILED)
+			{
+				close(File);
+				m_Size = 0;
+				return false;
+			}
+			m_Data = static_cast<const std::byte *>(Data);
+		}
+
+		// The mapping stays valid after the descriptor is closed:
+		close(File);
+	#endif
+
+	m_IsOpen = true;
+	return true;
+}
+
+
+
+
+
+void cMemoryMappedFile::Close(void)
+{
+	#ifdef _WIN32
+		if (m_Data != nullptr)
+		{
+			UnmapViewOfFile(m_Data);
+		}
+		if (m_Mapping != nullptr)
+		{
+			CloseHandle(m_Mapping);
+			m_Mapping = nullptr;
+		}
+		if (m_File != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(m_File);
+			m_File = INVALID_HANDLE_VALUE;
+		}
+	#else
+		if (m_Data != nullptr)
+		{
+			munmap(const_cast<std::byte *>(m_Data), m_Size);
+		}
+	#endif
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_IsOpen = false;
+}
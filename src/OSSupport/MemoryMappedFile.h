@@ -0,0 +1,63 @@
+
+// MemoryMappedFile.h
+
+// Declares the cMemoryMappedFile class that maps an entire file into memory for reading
+
+/*
+The mapping gives zero-copy access to the file's contents; the OS pages the data in on demand and shares it
+among all the processes mapping the same file.
+The mapping is shared, data written into the file through other handles (and flushed) shows in the view.
+The view covers the file size at the time of mapping, data appended later needs a new mapping.
+The file must not shrink while it is mapped, accessing the pages past its end faults.
+*/
+
+
+
+
+
+#pragma once
+
+
+
+
+
+class cMemoryMappedFile
+{
+public:
+
+	/** Creates an instance with no file mapped. */
+	cMemoryMappedFile(void);
+
+	/** Creates an instance and maps the specified file, check IsOpen() for success. */
+	explicit cMemoryMappedFile(const AString & a_FileName);
+
+	cMemoryMappedFile(const cMemoryMappedFile &) = delete;
+	cMemoryMappedFile & operator = (const cMemoryMappedFile &) = delete;
+
+	~cMemoryMappedFile();
+
+	/** Maps the entire file read-only, unmapping any previous file.
+	Returns false if the file cannot be opened or mapped. An empty file is mapped successfully, with an empty view. */
+	bool Open(const AString & a_FileName);
+
+	/** Unmaps the file, if any. */
+	void Close(void);
+
+	bool IsOpen(void) const { return m_IsOpen; }
+
+	/** Returns the file's contents; valid until the file is closed. */
+	ContiguousByteBufferView GetView(void) const { return { m_Data, m_Size }; }
+
+protected:
+
+	bool m_IsOpen;
+
+	const std::byte * m_Data;
+
+	size_t m_Size;
+
+	#ifdef _WIN32
+		HANDLE m_File;
+		HANDLE m_Mapping;
+	#endif
+};
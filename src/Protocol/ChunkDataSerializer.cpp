@@ -3,6 +3,7 @@
 #include "Protocol_1_8.h"
 #include "Protocol_1_9.h"
 #include "../ClientHandle.h"
+#include "../NibbleKernels.h"
 #include "../WorldStorage/FastNBT.h"
 
 #include "Palettes/Upgrade.h"
@@ -30,6 +31,28 @@ namespace
 		return { Mask, Present };
 	}
 
+	/** Unpacks the block types and metas of the section into one value per block each. */
+	void ExpandBlockSection(const ChunkBlockData & a_BlockData, const size_t a_Y, ChunkBlockData::SectionType & a_BlockTypes, NIBBLETYPE (& a_BlockMetas)[ChunkBlockData::SectionBlockCount])
+	{
+		if (const auto Blocks = a_BlockData.GetSection(a_Y); Blocks != nullptr)
+		{
+			Blocks->CopyTo(a_BlockTypes);
+		}
+		else
+		{
+			std::fill(std::begin(a_BlockTypes), std::end(a_BlockTypes), a_BlockData.GetSectionFill(a_Y));
+		}
+
+		if (const auto Metas = a_BlockData.GetMetaSection(a_Y); Metas != nullptr)
+		{
+			NibbleKernels::Expand(Metas->data(), a_BlockMetas, ChunkBlockData::SectionBlockCount);
+		}
+		else
+		{
+			std::fill(std::begin(a_BlockMetas), std::end(a_BlockMetas), a_BlockData.GetMetaSectionFill(a_Y) & 0x0f);
+		}
+	}
+
 	auto PaletteLegacy(const BLOCKTYPE a_BlockType, const NIBBLETYPE a_Meta)
 	{
 		return (a_BlockType << 4) | a_Meta;
@@ -60,7 +83,8 @@ namespace
 
 cChunkDataSerializer::cChunkDataSerializer(const eDimension a_Dimension) :
 	m_Packet(512 KiB),
-	m_Dimension(a_Dimension)
+	m_Dimension(a_Dimension),
+	m_CurrentVersion(CacheVersion::v47)
 {
 }
 
@@ -142,6 +166,7 @@ inline void cChunkDataSerializer::Serialize(const ClientHandles::value_type & a_
 		return;
 	}
 
+	m_CurrentVersion = a_CacheVersion;
 	switch (a_CacheVersion)
 	{
 		case CacheVersion::v47:
@@ -216,16 +241,18 @@ inline void cChunkDataSerializer::Serialize47(const int a_ChunkX, const int a_Ch
 	// Write the block types to the packet:
 	ChunkDef_ForEachSection(a_BlockData, a_LightData,
 	{
-		const bool BlocksExist = Blocks != nullptr;
-		const bool MetasExist = Metas != nullptr;
+		ChunkBlockData::SectionType BlockTypes;
+		NIBBLETYPE BlockMetas[ChunkBlockData::SectionBlockCount];
+		ExpandBlockSection(a_BlockData, Y, BlockTypes, BlockMetas);
 
+		// Each block is a little-endian (type << 4) | meta:
+		unsigned char Section[ChunkBlockData::SectionBlockCount * 2];
 		for (size_t BlockIdx = 0; BlockIdx != ChunkBlockData::SectionBlockCount; ++BlockIdx)
 		{
-			BLOCKTYPE BlockType = BlocksExist ? (*Blocks)[BlockIdx] : 0;
-			NIBBLETYPE BlockMeta = MetasExist ? cChunkDef::ExpandNibble(Metas->data(), BlockIdx) : 0;
-			m_Packet.WriteBEUInt8(static_cast<unsigned char>(BlockType << 4) | BlockMeta);
-			m_Packet.WriteBEUInt8(static_cast<unsigned char>(BlockType >> 4));
+			Section[2 * BlockIdx]     = static_cast<unsigned char>(BlockTypes[BlockIdx] << 4) | BlockMetas[BlockIdx];
+			Section[2 * BlockIdx + 1] = static_cast<unsigned char>(BlockTypes[BlockIdx] >> 4);
 		}
+		m_Packet.WriteBuf(Section, sizeof(Section));
 	});
 
 	// Write the block lights:
@@ -233,7 +260,7 @@ inline void cChunkDataSerializer::Serialize47(const int a_ChunkX, const int a_Ch
 	{
 		if (BlockLights == nullptr)
 		{
-			m_Packet.WriteBuf(ChunkLightData::SectionLightCount, ChunkLightData::DefaultBlockLightValue);
+			m_Packet.WriteBuf(ChunkLightData::SectionLightCount, a_LightData.GetBlockLightSectionFill(Y));
 		}
 		else
 		{
@@ -246,7 +273,7 @@ inline void cChunkDataSerializer::Serialize47(const int a_ChunkX, const int a_Ch
 	{
 		if (SkyLights == nullptr)
 		{
-			m_Packet.WriteBuf(ChunkLightData::SectionLightCount, ChunkLightData::DefaultSkyLightValue);
+			m_Packet.WriteBuf(ChunkLightData::SectionLightCount, a_LightData.GetSkyLightSectionFill(Y));
 		}
 		else
 		{
@@ -321,8 +348,8 @@ inline void cChunkDataSerializer::Serialize107(const int a_ChunkX, const int a_C
 		m_Packet.WriteBEUInt8(BitsPerEntry);
 		m_Packet.WriteVarInt32(0);  // Palette length is 0
 		m_Packet.WriteVarInt32(static_cast<UInt32>(ChunkSectionDataArraySize));
-		WriteBlockSectionSeamless<&PaletteLegacy>(Blocks, Metas, BitsPerEntry);
-		WriteLightSectionGrouped(BlockLights, SkyLights);
+		WriteBlockSectionSeamless<&PaletteLegacy>(a_BlockData, Y, BitsPerEntry);
+		WriteLightSectionGrouped(a_LightData, Y);
 	});
 
 	// Write the biome data
@@ -379,8 +406,8 @@ inline void cChunkDataSerializer::Serialize110(const int a_ChunkX, const int a_C
 		m_Packet.WriteBEUInt8(BitsPerEntry);
 		m_Packet.WriteVarInt32(0);  // Palette length is 0
 		m_Packet.WriteVarInt32(static_cast<UInt32>(ChunkSectionDataArraySize));
-		WriteBlockSectionSeamless<&PaletteLegacy>(Blocks, Metas, BitsPerEntry);
-		WriteLightSectionGrouped(BlockLights, SkyLights);
+		WriteBlockSectionSeamless<&PaletteLegacy>(a_BlockData, Y, BitsPerEntry);
+		WriteLightSectionGrouped(a_LightData, Y);
 	});
 
 	// Write the biome data
@@ -439,8 +466,8 @@ inline void cChunkDataSerializer::Serialize393(const int a_ChunkX, const int a_C
 	{
 		m_Packet.WriteBEUInt8(BitsPerEntry);
 		m_Packet.WriteVarInt32(static_cast<UInt32>(ChunkSectionDataArraySize));
-		WriteBlockSectionSeamless<Palette>(Blocks, Metas, BitsPerEntry);
-		WriteLightSectionGrouped(BlockLights, SkyLights);
+		WriteBlockSectionSeamless<Palette>(a_BlockData, Y, BitsPerEntry);
+		WriteLightSectionGrouped(a_LightData, Y);
 	});
 
 	// Write the biome data
@@ -505,7 +532,7 @@ inline void cChunkDataSerializer::Serialize477(const int a_ChunkX, const int a_C
 		m_Packet.WriteBEInt16(ChunkBlockData::SectionBlockCount);  // a temp fix to make sure sections don't disappear
 		m_Packet.WriteBEUInt8(BitsPerEntry);
 		m_Packet.WriteVarInt32(static_cast<UInt32>(ChunkSectionDataArraySize));
-		WriteBlockSectionSeamless<&Palette477>(Blocks, Metas, BitsPerEntry);
+		WriteBlockSectionSeamless<&Palette477>(a_BlockData, Y, BitsPerEntry);
 	});
 
 	// Write the biome data
@@ -523,24 +550,88 @@ inline void cChunkDataSerializer::Serialize477(const int a_ChunkX, const int a_C
 
 
 template <auto Palette>
-inline void cChunkDataSerializer::WriteBlockSectionSeamless(const ChunkBlockData::BlockArray * a_Blocks, const ChunkBlockData::MetaArray * a_Metas, const UInt8 a_BitsPerEntry)
+inline void cChunkDataSerializer::WriteBlockSectionSeamless(const ChunkBlockData & a_BlockData, const size_t a_Y, const UInt8 a_BitsPerEntry)
 {
 	// https://wiki.vg/Chunk_Format#Data_structure
 
 	// We shift a UInt64 by a_BitsPerEntry, the latter cannot be too big:
 	ASSERT(a_BitsPerEntry < 64);
 
+	static_assert((ChunkBlockData::SectionBlockCount % 64) == 0, "Section must fit wholly into a 64-bit long array");
+
+	const auto Blocks = a_BlockData.GetSection(a_Y);
+	const auto Metas = a_BlockData.GetMetaSection(a_Y);
+	const BLOCKTYPE BlockFill = a_BlockData.GetSectionFill(a_Y);
+	const NIBBLETYPE MetaFill = a_BlockData.GetMetaSectionFill(a_Y) & 0x0F;
+
+	if ((Blocks == nullptr) && (Metas == nullptr))
+	{
+		// Uniform section, every 64 entries pack into the same a_BitsPerEntry longs.
+		// Pack them once and repeat, instead of translating every block through the palette:
+		const auto Value = static_cast<UInt64>(Palette(BlockFill, MetaFill));
+		UInt64 Period[64] = {};
+		for (size_t Index = 0, Bit = 0; Index != 64; Index++, Bit += a_BitsPerEntry)
+		{
+			const auto Shift = Bit % 64;
+			Period[Bit / 64] |= Value << Shift;
+			if (Shift + a_BitsPerEntry > 64)
+			{
+				Period[Bit / 64 + 1] |= Value >> (64 - Shift);
+			}
+		}
+
+		for (size_t Repeat = 0; Repeat != ChunkBlockData::SectionBlockCount / 64; Repeat++)
+		{
+			for (size_t Word = 0; Word != a_BitsPerEntry; Word++)
+			{
+				m_Packet.WriteBEUInt64(Period[Word]);
+			}
+		}
+		return;
+	}
+
+	// Reuse the encoding of the section if it hasn't changed since it was last sent:
+	const SectionCacheKey Key{ a_BlockData.GetSectionVersion(a_Y), m_CurrentVersion, a_BitsPerEntry };
+	auto Cached = m_SectionCache.find(Key);
+	if (Cached == m_SectionCache.end())
+	{
+		if (m_SectionCache.size() >= MaxCachedSections)
+		{
+			m_SectionCache.clear();
+		}
+		Cached = m_SectionCache.emplace(Key, ContiguousByteBuffer()).first;
+		EncodeBlockSectionSeamless<Palette>(a_BlockData, a_Y, a_BitsPerEntry, Cached->second);
+	}
+
+	m_Packet.WriteBuf(Cached->second.data(), Cached->second.size());
+}
+
+
+
+
+
+template <auto Palette>
+void cChunkDataSerializer::EncodeBlockSectionSeamless(const ChunkBlockData & a_BlockData, const size_t a_Y, const UInt8 a_BitsPerEntry, ContiguousByteBuffer & a_Out)
+{
+	ChunkBlockData::SectionType BlockTypes;
+	NIBBLETYPE BlockMetas[ChunkBlockData::SectionBlockCount];
+	ExpandBlockSection(a_BlockData, a_Y, BlockTypes, BlockMetas);
+
+	a_Out.reserve(ChunkBlockData::SectionBlockCount / 64 * a_BitsPerEntry * sizeof(UInt64));
+	const auto WriteBEUInt64 = [&a_Out](const UInt64 a_Value)
+	{
+		for (int Shift = 56; Shift >= 0; Shift -= 8)
+		{
+			a_Out.push_back(static_cast<std::byte>(a_Value >> Shift));
+		}
+	};
+
 	UInt64 Buffer = 0;  // A buffer to compose multiple smaller bitsizes into one 64-bit number
 	unsigned char BitIndex = 0;  // The bit-position in Buffer that represents where to write next
 
-	const bool BlocksExist = a_Blocks != nullptr;
-	const bool MetasExist = a_Metas != nullptr;
-
 	for (size_t Index = 0; Index != ChunkBlockData::SectionBlockCount; Index++)
 	{
-		const BLOCKTYPE BlockType = BlocksExist ? (*a_Blocks)[Index] : 0;
-		const NIBBLETYPE BlockMeta = MetasExist ? cChunkDef::ExpandNibble(a_Metas->data(), Index) : 0;
-		const auto Value = Palette(BlockType, BlockMeta);
+		const auto Value = Palette(BlockTypes[Index], BlockMetas[Index]);
 
 		// Write as much as possible of Value, starting from BitIndex, into Buffer:
 		Buffer |= static_cast<UInt64>(Value) << BitIndex;
@@ -550,7 +641,7 @@ inline void cChunkDataSerializer::WriteBlockSectionSeamless(const ChunkBlockData
 		if (Remaining >= 0)
 		{
 			// There were some bits remaining: we've filled the buffer. Flush it:
-			m_Packet.WriteBEUInt64(Buffer);
+			WriteBEUInt64(Buffer);
 
 			// And write the remaining bits, setting the new BitIndex:
 			Buffer = static_cast<UInt64>(Value >> (a_BitsPerEntry - Remaining));
@@ -563,7 +654,6 @@ inline void cChunkDataSerializer::WriteBlockSectionSeamless(const ChunkBlockData
 		}
 	}
 
-	static_assert((ChunkBlockData::SectionBlockCount % 64) == 0, "Section must fit wholly into a 64-bit long array");
 	ASSERT(BitIndex == 0);
 	ASSERT(Buffer == 0);
 }
@@ -572,28 +662,31 @@ inline void cChunkDataSerializer::WriteBlockSectionSeamless(const ChunkBlockData
 
 
 
-inline void cChunkDataSerializer::WriteLightSectionGrouped(const ChunkLightData::LightArray * const a_BlockLights, const ChunkLightData::LightArray * const a_SkyLights)
+inline void cChunkDataSerializer::WriteLightSectionGrouped(const ChunkLightData & a_LightData, const size_t a_Y)
 {
-	// Write lighting:
-	if (a_BlockLights == nullptr)
+	const auto BlockLights = a_LightData.GetBlockLightSection(a_Y);
+	const auto SkyLights = a_LightData.GetSkyLightSection(a_Y);
+
+	// Write lighting, uniform sections straight from their fill value:
+	if (BlockLights == nullptr)
 	{
-		m_Packet.WriteBuf(ChunkLightData::SectionLightCount, ChunkLightData::DefaultBlockLightValue);
+		m_Packet.WriteBuf(ChunkLightData::SectionLightCount, a_LightData.GetBlockLightSectionFill(a_Y));
 	}
 	else
 	{
-		m_Packet.WriteBuf(a_BlockLights->data(), a_BlockLights->size());
+		m_Packet.WriteBuf(BlockLights->data(), BlockLights->size());
 	}
 
 	// Skylight is only sent in the overworld; the nether and end do not use it:
 	if (m_Dimension == dimOverworld)
 	{
-		if (a_SkyLights == nullptr)
+		if (SkyLights == nullptr)
 		{
-			m_Packet.WriteBuf(ChunkLightData::SectionLightCount, ChunkLightData::DefaultSkyLightValue);
+			m_Packet.WriteBuf(ChunkLightData::SectionLightCount, a_LightData.GetSkyLightSectionFill(a_Y));
 		}
 		else
 		{
-			m_Packet.WriteBuf(a_SkyLights->data(), a_SkyLights->size());
+			m_Packet.WriteBuf(SkyLights->data(), SkyLights->size());
 		}
 	}
 }
@@ -43,6 +43,32 @@ class cChunkDataSerializer
 		bool Engaged = false;
 	};
 
+	/** Identifies one encoded block section: the section's contents, and the protocol palette and bit width they were encoded with. */
+	struct SectionCacheKey
+	{
+		ChunkSectionVersion Version;
+		CacheVersion Protocol;
+		UInt8 BitsPerEntry;
+
+		bool operator == (const SectionCacheKey & a_Other) const
+		{
+			return (Version == a_Other.Version) && (Protocol == a_Other.Protocol) && (BitsPerEntry == a_Other.BitsPerEntry);
+		}
+	};
+
+	struct SectionCacheKeyHash
+	{
+		size_t operator () (const SectionCacheKey & a_Key) const
+		{
+			const auto Key = (a_Key.Version.Identity * 0x9e3779b97f4a7c15ULL) ^ (a_Key.Version.Changes << 8) ^ (static_cast<UInt64>(a_Key.Protocol) << 4) ^ a_Key.BitsPerEntry;
+			const auto Mixed = Key * 0x9e3779b97f4a7c15ULL;
+			return static_cast<size_t>(Mixed ^ (Mixed >> 32));
+		}
+	};
+
+	/** The maximum number of encoded block sections kept in m_SectionCache, about 7 KiB each. */
+	static constexpr size_t MaxCachedSections = 1024;
+
 public:
 
 	cChunkDataSerializer(eDimension a_Dimension);
@@ -65,12 +91,17 @@ private:
 	inline void Serialize477(int a_ChunkX, int a_ChunkZ, const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, const unsigned char * a_BiomeMap);  // Release 1.14 - 1.14.4
 
 	/** Writes all blocks in a chunk section into a series of Int64.
-	Writes start from the bit directly subsequent to the previous write's end, possibly crossing over to the next Int64. */
+	Writes start from the bit directly subsequent to the previous write's end, possibly crossing over to the next Int64.
+	Uniform sections are packed once per 64 blocks and repeated. */
 	template <auto Palette>
-	inline void WriteBlockSectionSeamless(const ChunkBlockData::BlockArray * a_Blocks, const ChunkBlockData::MetaArray * a_Metas, UInt8 a_BitsPerEntry);
+	inline void WriteBlockSectionSeamless(const ChunkBlockData & a_BlockData, size_t a_Y, UInt8 a_BitsPerEntry);
 
 	/** Copies all lights in a chunk section into the packet, block light followed immediately by sky light. */
-	inline void WriteLightSectionGrouped(const ChunkLightData::LightArray * a_BlockLights, const ChunkLightData::LightArray * a_SkyLights);
+	inline void WriteLightSectionGrouped(const ChunkLightData & a_LightData, size_t a_Y);
+
+	/** Encodes the non-uniform block section into the big-endian longs of the seamless format. */
+	template <auto Palette>
+	static void EncodeBlockSectionSeamless(const ChunkBlockData & a_BlockData, size_t a_Y, UInt8 a_BitsPerEntry, ContiguousByteBuffer & a_Out);
 
 	/** Finalises the data, compresses it if required, and stores it into cache. */
 	inline void CompressPacketInto(ChunkDataCache & a_Cache);
@@ -87,4 +118,12 @@ private:
 	/** A cache, mapping protocol version to a fully serialised chunk.
 	It is used during a single invocation of SendToClients with more than one client. */
 	std::array<ChunkDataCache, static_cast<size_t>(CacheVersion::Last) + 1> m_Cache;
+
+	/** The protocol version currently being serialized, selects the entries of m_SectionCache. */
+	CacheVersion m_CurrentVersion;
+
+	/** Encoded block sections, persistent across SendToClients calls.
+	Resending a chunk, or sending it to a later client, reuses the encoding of each section that hasn't changed since.
+	Keyed by the section version, which never repeats, so stale entries are never hit; the whole cache is dropped once it grows too big. */
+	std::unordered_map<SectionCacheKey, ContiguousByteBuffer, SectionCacheKeyHash> m_SectionCache;
 } ;
@@ -176,6 +176,9 @@ bool cRoot::Run(cSettingsRepositoryInterface & a_OverridesRepo)
 	m_FurnaceRecipe   = new cFurnaceRecipe();
 	m_BrewingRecipes.reset(new cBrewingRecipes());
 
+	const auto SectionPoolRetention = settingsRepo->GetValueSetI("ChunkMemory", "SectionPoolRetentionMiB", 64);
+	ChunkSectionPool::SetRetention(static_cast<size_t>(std::max(SectionPoolRetention, 0)) * 1024 * 1024);
+
 	LOGD("Loading worlds...");
 	LoadWorlds(dd, *settingsRepo, IsNewIniFile);
 
@@ -202,9 +205,18 @@ bool cRoot::Run(cSettingsRepositoryInterface & a_OverridesRepo)
 	settingsRepo->Flush();
 
 	LOGD("Finalising startup...");
-	if (m_Server->Start())
+	const bool IsPregenerating = a_OverridesRepo.HasValue("Server", "Pregenerate");
+	if (IsPregenerating || m_Server->Start())
 	{
-		m_WebAdmin->Start();
+		if (IsPregenerating)
+		{
+			// Headless mode: don't accept any connections, stop once the area is pregenerated:
+			StartPregenerationFromSettings(a_OverridesRepo.GetValue("Server", "Pregenerate"));
+		}
+		else
+		{
+			m_WebAdmin->Start();
+		}
 
 		LOG("Startup complete, took %ldms!", static_cast<long int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - BeginTime).count()));
 
@@ -230,6 +242,9 @@ bool cRoot::Run(cSettingsRepositoryInterface & a_OverridesRepo)
 	LOGD("Stopping world threads...");
 	StopWorlds(dd);
 
+	LOGD("Releasing pooled chunk sections...");
+	ChunkSectionPool::SetRetention(0);
+
 	LOGD("Stopping authenticator...");
 	m_Authenticator.Stop();
 
@@ -942,9 +957,46 @@ void cRoot::LogChunkStats(cCommandOutputCallback & a_Output)
 		a_Output.OutLn(fmt::format(FMT_STRING("  Num loaded chunks: {}"), NumValid));
 		a_Output.OutLn(fmt::format(FMT_STRING("  Num dirty chunks: {}"), NumDirty));
 		a_Output.OutLn(fmt::format(FMT_STRING("  Num chunks in lighting queue: {}"), NumInLighting));
-		a_Output.OutLn(fmt::format(FMT_STRING("  Num chunks in generator queue: {}"), NumInGenerator));
+		AStringVector WorkerQueueLengths;
+		for (const auto Length : World.GetLightingThread().GetWorkerQueueLengths())
+		{
+			WorkerQueueLengths.push_back(fmt::format(FMT_STRING("{}"), Length));
+		}
+		a_Output.OutLn(fmt::format(FMT_STRING("  Num chunks queued in lighting workers: {}"), StringJoin(WorkerQueueLengths, ", ")));
+		a_Output.OutLn(fmt::format(FMT_STRING("  Num chunks in generator queue: {} ({} threads)"), NumInGenerator, World.GetGenerator().GetNumWorkers()));
 		a_Output.OutLn(fmt::format(FMT_STRING("  Num chunks in storage load queue: {}"), NumInLoadQueue));
 		a_Output.OutLn(fmt::format(FMT_STRING("  Num chunks in storage save queue: {}"), NumInSaveQueue));
+		const auto LockStats = World.GetChunkMapLockStatistics();
+		a_Output.OutLn(fmt::format(FMT_STRING("  Chunkmap exclusive locks: {}, waited {} ms, held {} ms (longest {:.3f} ms)"),
+			LockStats.m_NumExclusiveLocks, LockStats.m_ExclusiveWaitNs / 1000000, LockStats.m_ExclusiveHoldNs / 1000000, LockStats.m_MaxExclusiveHoldNs / 1e6
+		));
+		a_Output.OutLn(fmt::format(FMT_STRING("  Chunkmap shared locks: {}, waited {} ms, held {} ms (longest {:.3f} ms)"),
+			LockStats.m_NumSharedLocks, LockStats.m_SharedWaitNs / 1000000, LockStats.m_SharedHoldNs / 1000000, LockStats.m_MaxSharedHoldNs / 1e6
+		));
+		const auto ColdStats = World.GetStorage().GetColdChunkCacheStatistics();
+		a_Output.OutLn(fmt::format(FMT_STRING("  Cold chunk cache: {} chunks, {} KiB (+ {} loaded chunks, {} KiB) of {} KiB, {} hits, {} misses, {} evictions"),
+			ColdStats.m_NumChunks, (ColdStats.m_NumBytes + 1023) / 1024, ColdStats.m_NumKeptChunks, (ColdStats.m_NumKeptBytes + 1023) / 1024,
+			ColdStats.m_BudgetBytes / 1024, ColdStats.m_NumHits, ColdStats.m_NumMisses, ColdStats.m_NumEvictions
+		));
+		const auto FileStats = World.GetStorage().GetFileCacheStatistics();
+		a_Output.OutLn(fmt::format(FMT_STRING("  Region file cache: {} of {} files, {} hits, {} opens, {} evictions"),
+			FileStats.m_NumFiles, FileStats.m_MaxFiles, FileStats.m_NumHits, FileStats.m_NumOpens, FileStats.m_NumEvictions
+		));
+		const auto WriteStats = World.GetStorage().GetWriteStatistics();
+		a_Output.OutLn(fmt::format(FMT_STRING("  Storage writes: {} flushes, {} chunks, {} KiB, flush time avg {:.3f} ms, max {:.3f} ms"),
+			WriteStats.m_NumFlushes, WriteStats.m_NumChunksWritten, (WriteStats.m_BytesWritten + 1023) / 1024,
+			(WriteStats.m_NumFlushes > 0) ? (static_cast<double>(WriteStats.m_TotalFlushNs) / WriteStats.m_NumFlushes / 1e6) : 0.0,
+			WriteStats.m_MaxFlushNs / 1e6
+		));
+		const auto GenCacheStats = World.GetGenerator().GetCacheStatistics();
+		a_Output.OutLn(fmt::format(FMT_STRING("  Generator biome cache: {} of {} chunks, {} hits, {} misses, {} evictions"),
+			GenCacheStats.m_Biomes.m_NumEntries, GenCacheStats.m_Biomes.m_Capacity,
+			GenCacheStats.m_Biomes.m_NumHits, GenCacheStats.m_Biomes.m_NumMisses, GenCacheStats.m_Biomes.m_NumEvictions
+		));
+		a_Output.OutLn(fmt::format(FMT_STRING("  Generator height cache: {} of {} chunks, {} hits, {} misses, {} evictions"),
+			GenCacheStats.m_CompositedHeights.m_NumEntries, GenCacheStats.m_CompositedHeights.m_Capacity,
+			GenCacheStats.m_CompositedHeights.m_NumHits, GenCacheStats.m_CompositedHeights.m_NumMisses, GenCacheStats.m_CompositedHeights.m_NumEvictions
+		));
 		int Mem = NumValid * static_cast<int>(sizeof(cChunk));
 		a_Output.OutLn(fmt::format(FMT_STRING("  Memory used by chunks: {} KiB ({} MiB)"), (Mem + 1023) / 1024, (Mem + 1024 * 1024 - 1) / (1024 * 1024)));
 		SumNumValid += NumValid;
@@ -959,6 +1011,19 @@ void cRoot::LogChunkStats(cCommandOutputCallback & a_Output)
 	a_Output.OutLn(fmt::format(FMT_STRING("  Num chunks in lighting queue: {}"), SumNumInLighting));
 	a_Output.OutLn(fmt::format(FMT_STRING("  Num chunks in generator queue: {}"), SumNumInGenerator));
 	a_Output.OutLn(fmt::format(FMT_STRING("  Memory used by chunks: {} KiB ({} MiB)"), (SumMem + 1023) / 1024, (SumMem + 1024 * 1024 - 1) / (1024 * 1024)));
+
+	const auto PoolStats = ChunkSectionPool::GetStats();
+	const auto Now = std::chrono::steady_clock::now();
+	const auto Elapsed = std::chrono::duration<double>(Now - ((m_LastChunkStatsTime < m_StartTime) ? m_StartTime : m_LastChunkStatsTime)).count();
+	const auto NumAllocationsSince = PoolStats.NumAllocations - m_LastNumSectionAllocations;
+	m_LastNumSectionAllocations = PoolStats.NumAllocations;
+	m_LastChunkStatsTime = Now;
+	a_Output.OutLn("Chunk section pool:");
+	a_Output.OutLn(fmt::format(FMT_STRING("  Live allocations: {} ({} KiB)"), PoolStats.NumLive, (PoolStats.LiveBytes + 1023) / 1024));
+	a_Output.OutLn(fmt::format(FMT_STRING("  Pooled allocations: {} ({} KiB of {} KiB retention)"), PoolStats.NumPooled, (PoolStats.PooledBytes + 1023) / 1024, PoolStats.RetentionBytes / 1024));
+	a_Output.OutLn(fmt::format(FMT_STRING("  Allocations: {} total, {} reused from the pool"), PoolStats.NumAllocations, PoolStats.NumReused));
+	a_Output.OutLn(fmt::format(FMT_STRING("  Allocation rate: {:.1f} per second since the last chunkstats"), (Elapsed > 0) ? (NumAllocationsSince / Elapsed) : 0.0));
+
 	a_Output.OutLn("Per-chunk memory size breakdown:");
 	a_Output.OutLn(fmt::format(FMT_STRING("  block types:    {:06} bytes ({:3} KiB)"), sizeof(cChunkDef::BlockTypes), (sizeof(cChunkDef::BlockTypes) + 1023) / 1024));
 	a_Output.OutLn(fmt::format(FMT_STRING("  block metadata: {:06} bytes ({:3} KiB)"), sizeof(cChunkDef::BlockNibbles), (sizeof(cChunkDef::BlockNibbles) + 1023) / 1024));
@@ -970,6 +1035,72 @@ void cRoot::LogChunkStats(cCommandOutputCallback & a_Output)
 
 
 
+bool cRoot::ExecutePregenerateCommand(const AStringVector & a_Split, cCommandOutputCallback & a_Output, std::function<void()> a_OnFinished)
+{
+	static const char * Usage =
+		"Usage: pregenerate <World> <Radius> [<CenterChunkX> <CenterChunkZ>] | "
+		"pregenerate <World> <MinChunkX> <MinChunkZ> <MaxChunkX> <MaxChunkZ> | "
+		"pregenerate stop <World> | pregenerate status";
+
+	if ((a_Split.size() == 2) && (a_Split[1] == "status"))
+	{
+		bool IsAnyRunning = false;
+		for (const auto & Entry : m_WorldsByName)
+		{
+			auto Status = Entry.second.GetPregenerationStatus();
+			if (!Status.empty())
+			{
+				a_Output.OutLn(Status);
+				IsAnyRunning = true;
+			}
+		}
+		if (!IsAnyRunning)
+		{
+			a_Output.OutLn("No pregeneration is running");
+		}
+		return true;
+	}
+
+	if ((a_Split.size() == 3) && (a_Split[1] == "stop"))
+	{
+		auto World = GetWorld(a_Split[2]);
+		if (World == nullptr)
+		{
+			a_Output.OutLn(fmt::format(FMT_STRING("Unknown world: {}"), a_Split[2]));
+			return false;
+		}
+		World->StopPregeneration();
+		a_Output.OutLn(fmt::format(FMT_STRING("Pregeneration of world {} stopped, run it again to resume"), a_Split[2]));
+		return true;
+	}
+
+	if (a_Split.size() < 3)
+	{
+		a_Output.OutLn(Usage);
+		return false;
+	}
+	auto World = GetWorld(a_Split[1]);
+	if (World == nullptr)
+	{
+		a_Output.OutLn(fmt::format(FMT_STRING("Unknown world: {}"), a_Split[1]));
+		return false;
+	}
+	cWorldPregenerator::sArea Area;
+	if (!cWorldPregenerator::ParseArea(*World, a_Split, 2, Area))
+	{
+		a_Output.OutLn(Usage);
+		return false;
+	}
+	World->StartPregeneration(Area, std::move(a_OnFinished));
+	a_Output.OutLn(fmt::format(FMT_STRING("Pregenerating world {}, chunks [{}, {}] - [{}, {}]; see \"pregenerate status\" for the progress"),
+		a_Split[1], Area.m_MinChunkX, Area.m_MinChunkZ, Area.m_MaxChunkX, Area.m_MaxChunkZ
+	));
+	return true;
+}
+
+
+
+
 
 int cRoot::GetFurnaceFuelBurnTime(const cItem & a_Fuel)
 {
@@ -1094,3 +1225,30 @@ void cRoot::TransitionNextState(NextState a_NextState)
 	WriteConsoleInput(GetStdHandle(STD_INPUT_HANDLE), &Record, 1, &Length);
 #endif
 }
+
+
+
+
+
+void cRoot::StartPregenerationFromSettings(const AString & a_Params)
+{
+	AStringVector Split{ "pregenerate" };
+	for (auto & Param : StringSplit(a_Params, " "))
+	{
+		if (!Param.empty())
+		{
+			Split.push_back(std::move(Param));
+		}
+	}
+
+	cLogCommandOutputCallback Output;
+	if (
+		(Split.size() < 2) || (Split[1] == "status") || (Split[1] == "stop") ||
+		!ExecutePregenerateCommand(Split, Output, &cRoot::Stop)
+	)
+	{
+		LOGWARNING("Invalid --pregenerate parameters: \"%s\", stopping.", a_Params);
+		cRoot::Stop();
+	}
+	Output.Finished();
+}
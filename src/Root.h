@@ -87,6 +87,11 @@ public:
 	/** Writes chunkstats, for each world and totals, to the output callback */
 	void LogChunkStats(cCommandOutputCallback & a_Output);
 
+	/** Executes the "pregenerate" console command, split into words; starts, stops or reports the pregeneration of a world.
+	a_OnFinished, if set, is called once the started pregeneration finishes.
+	Returns false if the command is not valid. */
+	bool ExecutePregenerateCommand(const AStringVector & a_Split, cCommandOutputCallback & a_Output, std::function<void()> a_OnFinished = {});
+
 	cMonsterConfig * GetMonsterConfig(void) { return m_MonsterConfig; }
 
 	cCraftingRecipes * GetCraftingRecipes(void) { return m_CraftingRecipes; }  // tolua_export
@@ -210,6 +215,10 @@ private:
 	/** Performs run state transition, enforcing guarantees about state transitions. */
 	static void TransitionNextState(NextState a_NextState);
 
+	/** Starts the headless pregeneration requested on the command line; the server stops once it finishes.
+	a_Params are the parameters of the pregenerate console command. Stops the server right away if they're not valid. */
+	void StartPregenerationFromSettings(const AString & a_Params);
+
 	cWorld * m_pDefaultWorld;
 	WorldMap m_WorldsByName;
 
@@ -231,6 +240,10 @@ private:
 
 	cHTTPServer m_HTTPServer;
 
+	/** Chunk section allocation counter and time at the previous chunkstats, used for reporting the allocation rate. */
+	UInt64 m_LastNumSectionAllocations = 0;
+	std::chrono::steady_clock::time_point m_LastChunkStatsTime;
+
 	/** The storage for all registered block types. */
 	// BlockTypeRegistry m_BlockTypeRegistry;
 
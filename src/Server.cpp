@@ -571,6 +571,13 @@ void cServer::ExecuteConsoleCommand(const AString & a_Cmd, cCommandOutputCallbac
 		return;
 	}
 
+	else if (split[0].compare("pregenerate") == 0)
+	{
+		cRoot::Get()->ExecutePregenerateCommand(split, a_Output);
+		a_Output.Finished();
+		return;
+	}
+
 	else if (split[0].compare("luastats") == 0)
 	{
 		a_Output.OutLn(cLuaStateTracker::GetStats());
@@ -661,6 +668,7 @@ void cServer::BindBuiltInConsoleCommands(void)
 	PlgMgr->BindConsoleCommand("restart",         nullptr, handler, "Restarts the server cleanly");
 	PlgMgr->BindConsoleCommand("stop",            nullptr, handler, "Stops the server cleanly");
 	PlgMgr->BindConsoleCommand("chunkstats",      nullptr, handler, "Displays detailed chunk memory statistics");
+	PlgMgr->BindConsoleCommand("pregenerate",     nullptr, handler, "Generates, lights and stores an area of a world in the background");
 	PlgMgr->BindConsoleCommand("load",            nullptr, handler, "Adds and enables the specified plugin");
 	PlgMgr->BindConsoleCommand("unload",          nullptr, handler, "Disables the specified plugin");
 	PlgMgr->BindConsoleCommand("destroyentities", nullptr, handler, "Destroys all entities in all worlds");
@@ -65,7 +65,7 @@ protected:
 	int m_AddSlotNum;  // Index into m_Slots[] where to add new blocks in each ChunkData
 	int m_SimSlotNum;  // Index into m_Slots[] where to simulate blocks in each ChunkData
 
-	int m_TotalBlocks;  // Statistics only: the total number of blocks currently queued
+	std::atomic<int> m_TotalBlocks;  // Statistics only: the total number of blocks currently queued; atomic because chunks may be simulated in parallel
 
 	/* Slots:
 	| 0 | 1 | ... | m_AddSlotNum | m_SimSlotNum | ... | m_TickDelay - 1 |
@@ -251,6 +251,17 @@ cWorld::cWorld(
 	}
 	m_UnusedDirtyChunksCap = static_cast<size_t>(UnusedDirtyChunksCap);
 
+	// Number of threads ticking the chunks; 1 ticks them all in the world tick thread:
+	const int ChunkTickThreads = IniFile.GetValueSetI("General", "ChunkTickThreads", 1);
+	m_ChunkMap.SetNumTickThreads(static_cast<unsigned>(Clamp(ChunkTickThreads, 1, 64)));
+
+	// Number of threads lighting the chunks, each uses about 7 MiB of buffers:
+	const int LightingThreads = IniFile.GetValueSetI("General", "LightingThreads", 2);
+	m_Lighting.SetNumWorkers(static_cast<unsigned>(Clamp(LightingThreads, 1, 64)));
+
+	// Number of threads generating the chunks, each has its own instance of the generator:
+	const int GeneratorThreads = IniFile.GetValueSetI("General", "GeneratorThreads", 2);
+
 	m_BroadcastDeathMessages = IniFile.GetValueSetB("Broadcasting", "BroadcastDeathMessages", true);
 	m_BroadcastAchievementMessages = IniFile.GetValueSetB("Broadcasting", "BroadcastAchievementMessages", true);
 
@@ -278,6 +289,13 @@ cWorld::cWorld(
 
 	m_StorageSchema               = IniFile.GetValueSet ("Storage",       "Schema",                      m_StorageSchema);
 	m_StorageCompressionFactor    = IniFile.GetValueSetI("Storage",       "CompressionFactor",           m_StorageCompressionFactor);
+	const int ColdChunkCacheMiB   = IniFile.GetValueSetI("Storage",       "ColdChunkCacheMiB",           32);
+	const auto RegionBackend      = IniFile.GetValueSet ("Storage",       "RegionBackend",               "File");
+	const int StorageLoadThreads  = IniFile.GetValueSetI("Storage",       "LoadThreads",                 2);
+	const int StorageSaveThreads  = IniFile.GetValueSetI("Storage",       "SaveThreads",                 1);
+	const int FlushIntervalMSec   = IniFile.GetValueSetI("Storage",       "FlushIntervalMSec",           1000);
+	const auto StorageSyncPolicy  = IniFile.GetValueSet ("Storage",       "SyncPolicy",                  "None");
+	const int MaxOpenRegionFiles  = IniFile.GetValueSetI("Storage",       "MaxOpenRegionFiles",          32);
 	m_MaxCactusHeight             = IniFile.GetValueSetI("Plants",        "MaxCactusHeight",             3);
 	m_MaxSugarcaneHeight          = IniFile.GetValueSetI("Plants",        "MaxSugarcaneHeight",          3);
 	/* TODO: Enable when functionality exists again
@@ -424,8 +442,18 @@ cWorld::cWorld(
 	m_SimulatorManager->RegisterSimulator(m_SandSimulator.get(), 1);
 	m_SimulatorManager->RegisterSimulator(m_FireSimulator.get(), 1);
 
-	m_Storage.Initialize(*this, m_StorageSchema, m_StorageCompressionFactor);
-	m_Generator.Initialize(m_GeneratorCallbacks, m_GeneratorCallbacks, IniFile);
+	cWorldStorage::sSettings StorageSettings;
+	StorageSettings.m_SchemaName = m_StorageSchema;
+	StorageSettings.m_CompressionFactor = m_StorageCompressionFactor;
+	StorageSettings.m_ColdChunkCacheBytes = static_cast<size_t>(std::max(ColdChunkCacheMiB, 0)) * 1024 * 1024;
+	StorageSettings.m_RegionBackend = RegionBackend;
+	StorageSettings.m_NumLoadThreads = static_cast<size_t>(std::max(StorageLoadThreads, 1));
+	StorageSettings.m_NumSaveThreads = static_cast<size_t>(std::max(StorageSaveThreads, 1));
+	StorageSettings.m_FlushIntervalMSec = static_cast<unsigned>(std::max(FlushIntervalMSec, 0));
+	StorageSettings.m_SyncPolicy = StorageSyncPolicy;
+	StorageSettings.m_MaxOpenRegionFiles = static_cast<size_t>(std::max(MaxOpenRegionFiles, 1));
+	m_Storage.Initialize(*this, StorageSettings);
+	m_Generator.Initialize(m_GeneratorCallbacks, m_GeneratorCallbacks, IniFile, static_cast<unsigned>(Clamp(GeneratorThreads, 1, 64)));
 
 	m_MapManager.LoadMapData();
 
@@ -1021,6 +1049,7 @@ void cWorld::Stop(cDeadlockDetect & a_DeadlockDetect)
 		IniFile.SetValueI("General", "WorldAgeMS", static_cast<Int64>(m_WorldAge.count()));
 	IniFile.WriteFile(m_IniFileName);
 
+	StopPregeneration();
 	m_TickThread.Stop();
 	m_Lighting.Stop();
 	m_Generator.Stop();
@@ -1790,6 +1819,15 @@ void cWorld::SetBlock(Vector3i a_BlockPos, BLOCKTYPE a_BlockType, NIBBLETYPE a_B
 
 
 
+void cWorld::SetBlocks(const sSetBlockVector & a_Blocks)
+{
+	m_ChunkMap.SetBlocks(a_Blocks);
+}
+
+
+
+
+
 void cWorld::SetBlockMeta(Vector3i a_BlockPos, NIBBLETYPE a_MetaData)
 {
 	m_ChunkMap.SetBlockMeta(a_BlockPos, a_MetaData);
@@ -2586,6 +2624,54 @@ void cWorld::PrepareChunk(int a_ChunkX, int a_ChunkZ, std::unique_ptr<cChunkCoor
 
 
 
+void cWorld::StartPregeneration(const cWorldPregenerator::sArea & a_Area, std::function<void()> a_OnFinished)
+{
+	StopPregeneration();
+	auto Pregenerator = std::make_shared<cWorldPregenerator>(*this, a_Area, std::move(a_OnFinished));
+	{
+		cCSLock Lock(m_CSPregenerator);
+		m_Pregenerator = Pregenerator;
+	}
+	Pregenerator->Start();
+}
+
+
+
+
+
+void cWorld::StopPregeneration(void)
+{
+	std::shared_ptr<cWorldPregenerator> Pregenerator;
+	{
+		cCSLock Lock(m_CSPregenerator);
+		std::swap(Pregenerator, m_Pregenerator);
+	}
+
+	// Stop outside the lock, the thread may take a while to notice:
+	if (Pregenerator != nullptr)
+	{
+		Pregenerator->Stop();
+	}
+}
+
+
+
+
+
+AString cWorld::GetPregenerationStatus(void) const
+{
+	cCSLock Lock(m_CSPregenerator);
+	if (m_Pregenerator == nullptr)
+	{
+		return {};
+	}
+	return m_Pregenerator->GetStatus();
+}
+
+
+
+
+
 void cWorld::ChunkLoadFailed(int a_ChunkX, int a_ChunkZ)
 {
 	m_ChunkMap.ChunkLoadFailed(a_ChunkX, a_ChunkZ);
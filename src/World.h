@@ -10,6 +10,7 @@
 #include "ChunkSender.h"
 #include "Defines.h"
 #include "LightingThread.h"
+#include "WorldPregenerator.h"
 #include "IniFile.h"
 #include "Item.h"
 #include "Mobs/Monster.h"
@@ -309,6 +310,17 @@ public:
 	It is legal to call with no callback. */
 	void PrepareChunk(int a_ChunkX, int a_ChunkZ, std::unique_ptr<cChunkCoordCallback> a_CallAfter = {});
 
+	/** Starts generating, lighting and storing all the chunks in the area, in the background.
+	Any pregeneration already running in this world is stopped first.
+	a_OnFinished, if set, is called from the pregenerator's thread once all the chunks are stored. */
+	void StartPregeneration(const cWorldPregenerator::sArea & a_Area, std::function<void()> a_OnFinished = {});
+
+	/** Stops the pregeneration running in this world, if any. Its progress is kept as of the last checkpoint. */
+	void StopPregeneration(void);
+
+	/** Returns the progress of the pregeneration in this world, or an empty string if there's none. */
+	AString GetPregenerationStatus(void) const;
+
 	/** Marks the chunk as failed-to-load: */
 	void ChunkLoadFailed(int a_ChunkX, int a_ChunkZ);
 
@@ -540,6 +552,10 @@ public:
 	/** Retrieves block types of the specified blocks. If a chunk is not loaded, doesn't modify the block. Returns true if all blocks were read. */
 	bool GetBlocks(sSetBlockVector & a_Blocks, bool a_ContinueOnFailure);
 
+	/** Sets all the specified blocks, with the same processing as SetBlock(), but locking and looking up each affected chunk only once.
+	Sorting the changes by chunk beforehand saves a copy. Blocks in chunks that aren't loaded are ignored silently. */
+	void SetBlocks(const sSetBlockVector & a_Blocks);  // Exported in ManualBindings_World.cpp
+
 	using cWorldInterface::SendBlockTo;
 
 	// tolua_begin
@@ -765,6 +781,9 @@ public:
 	/** Returns the number of chunks loaded and dirty, and in the lighting queue */
 	void GetChunkStats(int & a_NumValid, int & a_NumDirty, int & a_NumInLightingQueue);
 
+	/** Returns the wait and hold times of the chunkmap lock. */
+	cCriticalSection::sStatistics GetChunkMapLockStatistics(void) const { return m_ChunkMap.GetCS().GetStatistics(); }
+
 	// Various queues length queries (cannot be const, they lock their CS):
 	inline size_t GetGeneratorQueueLength  (void) { return m_Generator.GetQueueLength();   }    // tolua_export
 	inline size_t GetLightingQueueLength   (void) { return m_Lighting.GetQueueLength();    }    // tolua_export
@@ -1092,6 +1111,10 @@ private:
 	cLightingThread  m_Lighting;
 	cTickThread      m_TickThread;
 
+	/** The pregeneration running in this world, if any; guarded by m_CSPregenerator */
+	std::shared_ptr<cWorldPregenerator> m_Pregenerator;
+	mutable cCriticalSection m_CSPregenerator;
+
 	/** Guards the m_Tasks */
 	cCriticalSection m_CSTasks;
 
@@ -0,0 +1,456 @@
+
+// WorldPregenerator.cpp
+
+// Implements the cWorldPregenerator class that generates, lights and stores a large area of a world ahead of time
+
+#include "Globals.h"
+#include "WorldPregenerator.h"
+#include "IniFile.h"
+#include "World.h"
+#include "ChunkGeneratorThread.h"
+#include "LightingThread.h"
+#include "WorldStorage/WorldStorage.h"
+
+
+
+
+
+/** Passes the result of a queued chunk to the pregenerator, keeping it alive until then. */
+class cWorldPregeneratorCallback:
+	public cChunkCoordCallback
+{
+public:
+
+	cWorldPregeneratorCallback(std::shared_ptr<cWorldPregenerator> a_Pregenerator, int a_Idx):
+		m_Pregenerator(std::move(a_Pregenerator)),
+		m_Idx(a_Idx)
+	{
+		ASSERT(m_Pregenerator != nullptr);
+	}
+
+protected:
+
+	std::shared_ptr<cWorldPregenerator> m_Pregenerator;
+
+	/** Index of the chunk in the pregenerator's processing order. */
+	int m_Idx;
+
+	virtual void Call(cChunkCoords a_Coords, bool a_IsSuccess) override
+	{
+		m_Pregenerator->ChunkPrepared(m_Idx, a_IsSuccess);
+	}
+};
+
+
+
+
+
+cWorldPregenerator::cWorldPregenerator(cWorld & a_World, const sArea & a_Area, std::function<void()> a_OnFinished):
+	Super(fmt::format(FMT_STRING("World pregenerator ({})"), a_World.GetName())),
+	m_World(a_World),
+	m_Area(a_Area),
+	m_NumChunks(a_Area.GetSizeX() * a_Area.GetSizeZ()),
+	m_OnFinished(std::move(a_OnFinished)),
+	m_CheckpointFileName(a_World.GetDataPath() + "/pregenerate.ini"),
+	m_NumDone(0),
+	m_NumInFlight(0),
+	m_NextIdx(0),
+	m_NumCheckpointed(0),
+	m_NumPrepared(0),
+	m_IsFinished(false),
+	m_LastReportCounters()
+{
+	ASSERT(m_Area.GetSizeX() > 0);
+	ASSERT(m_Area.GetSizeZ() > 0);
+}
+
+
+
+
+
+cWorldPregenerator::~cWorldPregenerator()
+{
+	Stop();
+}
+
+
+
+
+
+bool cWorldPregenerator::ParseArea(const cWorld & a_World, const AStringVector & a_Args, size_t a_FirstArg, sArea & a_Area)
+{
+	const auto NumArgs = (a_Args.size() > a_FirstArg) ? (a_Args.size() - a_FirstArg) : 0;
+	Int64 MinX, MinZ, MaxX, MaxZ;
+	if ((NumArgs == 1) || (NumArgs == 3))
+	{
+		int Radius;
+		if (!StringToInteger(a_Args[a_FirstArg], Radius) || (Radius < 0))
+		{
+			return false;
+		}
+		int CenterX, CenterZ;
+		if (NumArgs == 3)
+		{
+			if (!StringToInteger(a_Args[a_FirstArg + 1], CenterX) || !StringToInteger(a_Args[a_FirstArg + 2], CenterZ))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			cChunkDef::BlockToChunk(a_World.GetSpawnX(), a_World.GetSpawnZ(), CenterX, CenterZ);
+		}
+		MinX = static_cast<Int64>(CenterX) - Radius;
+		MinZ = static_cast<Int64>(CenterZ) - Radius;
+		MaxX = static_cast<Int64>(CenterX) + Radius;
+		MaxZ = static_cast<Int64>(CenterZ) + Radius;
+	}
+	else if (NumArgs == 4)
+	{
+		int Coords[4];
+		for (size_t i = 0; i < ARRAYCOUNT(Coords); i++)
+		{
+			if (!StringToInteger(a_Args[a_FirstArg + i], Coords[i]))
+			{
+				return false;
+			}
+		}
+		MinX = std::min(Coords[0], Coords[2]);
+		MinZ = std::min(Coords[1], Coords[3]);
+		MaxX = std::max(Coords[0], Coords[2]);
+		MaxZ = std::max(Coords[1], Coords[3]);
+	}
+	else
+	{
+		return false;
+	}
+
+	// The chunk indices are ints, the area must fit:
+	const Int64 IntMin = std::numeric_limits<int>::min();
+	const Int64 IntMax = std::numeric_limits<int>::max();
+	if ((MinX < IntMin) || (MinZ < IntMin) || (MaxX > IntMax) || (MaxZ > IntMax))
+	{
+		return false;
+	}
+	const auto SizeX = MaxX - MinX + 1;
+	const auto SizeZ = MaxZ - MinZ + 1;
+	if ((SizeX > IntMax) || (SizeZ > IntMax) || (SizeX * SizeZ > IntMax))
+	{
+		return false;
+	}
+
+	a_Area.m_MinChunkX = static_cast<int>(MinX);
+	a_Area.m_MinChunkZ = static_cast<int>(MinZ);
+	a_Area.m_MaxChunkX = static_cast<int>(MaxX);
+	a_Area.m_MaxChunkZ = static_cast<int>(MaxZ);
+	return true;
+}
+
+
+
+
+
+AString cWorldPregenerator::GetStatus(void) const
+{
+	cCSLock Lock(m_CS);
+	if (m_Status.empty())
+	{
+		return fmt::format(FMT_STRING("{}: starting, {} chunks"), m_World.GetName(), m_NumChunks);
+	}
+	return m_Status;
+}
+
+
+
+
+
+void cWorldPregenerator::Execute(void)
+{
+	{
+		cCSLock Lock(m_CS);
+		m_NumDone = ReadCheckpoint();
+		m_NextIdx = m_NumDone;
+		m_NumCheckpointed = m_NumDone;
+	}
+	if (m_NumCheckpointed > 0)
+	{
+		LOG("Pregenerating world \"%s\": resuming at chunk %d of %d", m_World.GetName(), m_NumCheckpointed, m_NumChunks);
+	}
+	else
+	{
+		LOG("Pregenerating world \"%s\": chunks [%d, %d] - [%d, %d], %d chunks",
+			m_World.GetName(), m_Area.m_MinChunkX, m_Area.m_MinChunkZ, m_Area.m_MaxChunkX, m_Area.m_MaxChunkZ, m_NumChunks
+		);
+	}
+	if (!m_World.IsSavingEnabled())
+	{
+		LOGWARNING("Pregenerating world \"%s\": saving is disabled in this world, the chunks will not be stored", m_World.GetName());
+	}
+
+	m_LastReportTime = std::chrono::steady_clock::now();
+	m_LastReportCounters = GetCounters();
+	std::vector<int> ToQueue;
+	while (!m_ShouldTerminate)
+	{
+		// Top up the pipeline, retrying the failed chunks first:
+		int NumDone;
+		{
+			cCSLock Lock(m_CS);
+			NumDone = m_NumDone;
+			ToQueue.clear();
+			while (!m_Failed.empty() && (m_NumInFlight + static_cast<int>(ToQueue.size()) < MAX_IN_FLIGHT))
+			{
+				ToQueue.push_back(m_Failed.back());
+				m_Failed.pop_back();
+			}
+			while ((m_NextIdx < m_NumChunks) && (m_NumInFlight + static_cast<int>(ToQueue.size()) < MAX_IN_FLIGHT))
+			{
+				ToQueue.push_back(m_NextIdx);
+				m_NextIdx += 1;
+			}
+			m_NumInFlight += static_cast<int>(ToQueue.size());
+		}
+
+		// PrepareChunk() may call the callback right away, so it mustn't be called under m_CS:
+		for (const auto Idx : ToQueue)
+		{
+			const auto Coords = DecodeChunkCoords(Idx);
+			m_World.PrepareChunk(Coords.m_ChunkX, Coords.m_ChunkZ, std::make_unique<cWorldPregeneratorCallback>(shared_from_this(), Idx));
+		}
+
+		if (NumDone >= m_NumChunks)
+		{
+			break;
+		}
+
+		if (NumDone - m_NumCheckpointed >= CHECKPOINT_CHUNKS)
+		{
+			if (!Checkpoint())
+			{
+				return;
+			}
+		}
+
+		if (std::chrono::steady_clock::now() - m_LastReportTime >= std::chrono::seconds(5))
+		{
+			Report();
+		}
+
+		m_evtChunkPrepared.Wait(1000);
+	}
+
+	if (m_ShouldTerminate)
+	{
+		return;
+	}
+
+	// All chunks have been prepared, store them:
+	if (!Checkpoint())
+	{
+		return;
+	}
+	Report();
+	LOG("Pregenerating world \"%s\" finished", m_World.GetName());
+	m_IsFinished = true;
+	if (m_OnFinished)
+	{
+		m_OnFinished();
+	}
+}
+
+
+
+
+
+void cWorldPregenerator::ChunkPrepared(int a_Idx, bool a_IsSuccess)
+{
+	{
+		cCSLock Lock(m_CS);
+		if (!a_IsSuccess)
+		{
+			// The generator was too busy and skipped the chunk, queue it again:
+			m_Failed.push_back(a_Idx);
+		}
+		else
+		{
+			m_NumPrepared += 1;
+			if (a_Idx == m_NumDone)
+			{
+				m_NumDone += 1;
+				while (!m_DoneAhead.empty() && (*m_DoneAhead.begin() == m_NumDone))
+				{
+					m_DoneAhead.erase(m_DoneAhead.begin());
+					m_NumDone += 1;
+				}
+			}
+			else
+			{
+				m_DoneAhead.insert(a_Idx);
+			}
+		}
+		m_NumInFlight -= 1;
+	}
+	m_evtChunkPrepared.Set();
+}
+
+
+
+
+
+cChunkCoords cWorldPregenerator::DecodeChunkCoords(int a_Idx) const
+{
+	// Bands of BAND_ROWS rows, each walked column by column, every second column backwards:
+	const Int64 SizeX = m_Area.GetSizeX();
+	const auto BandStart = static_cast<int>((a_Idx / (BAND_ROWS * SizeX)) * BAND_ROWS);
+	const auto BandHeight = std::min(BAND_ROWS, m_Area.GetSizeZ() - BandStart);
+	const auto InBand = a_Idx - BandStart * SizeX;
+	const auto x = static_cast<int>(InBand / BandHeight);
+	auto z = static_cast<int>(InBand % BandHeight);
+	if ((x & 1) != 0)
+	{
+		z = BandHeight - 1 - z;
+	}
+	return { m_Area.m_MinChunkX + x, m_Area.m_MinChunkZ + BandStart + z };
+}
+
+
+
+
+
+int cWorldPregenerator::ReadCheckpoint(void) const
+{
+	cIniFile Checkpoint;
+	if (!Checkpoint.ReadFile(m_CheckpointFileName, false))
+	{
+		return 0;
+	}
+	if (
+		(Checkpoint.GetValueI("Area", "MinChunkX", 0) != m_Area.m_MinChunkX) ||
+		(Checkpoint.GetValueI("Area", "MinChunkZ", 0) != m_Area.m_MinChunkZ) ||
+		(Checkpoint.GetValueI("Area", "MaxChunkX", 0) != m_Area.m_MaxChunkX) ||
+		(Checkpoint.GetValueI("Area", "MaxChunkZ", 0) != m_Area.m_MaxChunkZ)
+	)
+	{
+		// A different area, start anew:
+		return 0;
+	}
+	return Clamp(Checkpoint.GetValueI("Progress", "NumDone", 0), 0, m_NumChunks);
+}
+
+
+
+
+
+bool cWorldPregenerator::Checkpoint(void)
+{
+	int NumDone;
+	{
+		cCSLock Lock(m_CS);
+		NumDone = m_NumDone;
+	}
+
+	// Queue the saving on the world's tick thread and wait for it to be done:
+	auto IsQueued = std::make_shared<cEvent>();
+	m_World.QueueTask([IsQueued](cWorld & a_World)
+		{
+			a_World.SaveAllChunks();
+			IsQueued->Set();
+		}
+	);
+	while (!IsQueued->Wait(1000))
+	{
+		if (m_ShouldTerminate)
+		{
+			return false;
+		}
+	}
+
+	// Wait for the storage to write the chunks:
+	while (m_World.GetStorageSaveQueueLength() > 0)
+	{
+		if (m_ShouldTerminate)
+		{
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+
+	// The schema may keep the saved chunks in memory for a while, write them out before recording them as done:
+	m_World.GetStorage().Flush();
+
+	cIniFile Checkpoint;
+	Checkpoint.AddHeaderComment(" Progress of the world pregeneration, used for resuming it");
+	Checkpoint.SetValueI("Area", "MinChunkX", m_Area.m_MinChunkX);
+	Checkpoint.SetValueI("Area", "MinChunkZ", m_Area.m_MinChunkZ);
+	Checkpoint.SetValueI("Area", "MaxChunkX", m_Area.m_MaxChunkX);
+	Checkpoint.SetValueI("Area", "MaxChunkZ", m_Area.m_MaxChunkZ);
+	Checkpoint.SetValueI("Progress", "NumDone", NumDone);
+	if (!Checkpoint.WriteFile(m_CheckpointFileName))
+	{
+		LOGWARNING("Pregenerating world \"%s\": cannot write the checkpoint file %s", m_World.GetName(), m_CheckpointFileName);
+	}
+	m_NumCheckpointed = NumDone;
+
+	// The stored chunks are no longer needed in memory:
+	m_World.QueueUnloadUnusedChunks();
+	return true;
+}
+
+
+
+
+
+cWorldPregenerator::sCounters cWorldPregenerator::GetCounters(void) const
+{
+	return
+	{
+		m_NumPrepared,
+		m_World.GetGenerator().GetNumGenerated(),
+		m_World.GetLightingThread().GetNumLit(),
+		m_World.GetStorage().GetNumSaved()
+	};
+}
+
+
+
+
+
+void cWorldPregenerator::Report(void)
+{
+	const auto Now = std::chrono::steady_clock::now();
+	const auto Counters = GetCounters();
+	const auto Seconds = std::max(std::chrono::duration<double>(Now - m_LastReportTime).count(), 0.001);
+	const auto Rate = [Seconds](size_t a_Current, size_t a_Last)
+	{
+		return static_cast<double>(a_Current - a_Last) / Seconds;
+	};
+	const auto PreparedRate = Rate(Counters.m_Prepared, m_LastReportCounters.m_Prepared);
+
+	int NumDone;
+	{
+		cCSLock Lock(m_CS);
+		NumDone = m_NumDone;
+	}
+	AString Eta = "unknown";
+	if (PreparedRate > 0)
+	{
+		const auto EtaSeconds = static_cast<Int64>((m_NumChunks - NumDone) / PreparedRate);
+		Eta = fmt::format(FMT_STRING("{}:{:02}:{:02}"), EtaSeconds / 3600, (EtaSeconds / 60) % 60, EtaSeconds % 60);
+	}
+
+	auto Status = fmt::format(
+		FMT_STRING("{}: {:.2f}% ({}/{} chunks, {} stored); {:.1f} chunks / sec; generator {:.1f}, lighting {:.1f}, storage {:.1f} chunks / sec; ETA {}"),
+		m_World.GetName(), 100.0 * NumDone / m_NumChunks, NumDone, m_NumChunks, m_NumCheckpointed,
+		PreparedRate,
+		Rate(Counters.m_Generated, m_LastReportCounters.m_Generated),
+		Rate(Counters.m_Lit,       m_LastReportCounters.m_Lit),
+		Rate(Counters.m_Saved,     m_LastReportCounters.m_Saved),
+		Eta
+	);
+	LOG("Pregenerating %s", Status);
+
+	m_LastReportTime = Now;
+	m_LastReportCounters = Counters;
+	cCSLock Lock(m_CS);
+	m_Status = std::move(Status);
+}
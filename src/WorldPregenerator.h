@@ -0,0 +1,171 @@
+// WorldPregenerator.h
+
+// Declares the cWorldPregenerator class that generates, lights and stores a large area of a world ahead of time
+
+/*
+The pregenerator drives the world's own pipeline: each chunk is prepared (loaded or generated, then lit) through
+cWorld::PrepareChunk(), and the world's storage saves it. Only a bounded number of chunks is in the pipeline at
+any time, and every CHECKPOINT_CHUNKS chunks all the chunks are saved and the unused ones unloaded, so the
+memory use doesn't grow with the area.
+The chunks are processed in bands of BAND_ROWS rows, column by column in a snake pattern, so that most of the
+neighbors the lighting needs are still loaded from the previous column.
+At each checkpoint, once the storage has written everything, the number of finished chunks is written into
+a checkpoint file in the world folder. Pregenerating the same area again resumes from there.
+*/
+
+
+
+
+
+#pragma once
+
+#include "ChunkDef.h"
+#include "OSSupport/IsThread.h"
+
+
+
+
+
+// fwd:
+class cWorld;
+
+
+
+
+
+class cWorldPregenerator:
+	public cIsThread,
+	public std::enable_shared_from_this<cWorldPregenerator>
+{
+	using Super = cIsThread;
+
+public:
+
+	/** The rectangle of chunks to pregenerate, both bounds inclusive. */
+	struct sArea
+	{
+		int m_MinChunkX;
+		int m_MinChunkZ;
+		int m_MaxChunkX;
+		int m_MaxChunkZ;
+
+		int GetSizeX(void) const { return m_MaxChunkX - m_MinChunkX + 1; }
+		int GetSizeZ(void) const { return m_MaxChunkZ - m_MinChunkZ + 1; }
+	};
+
+	/** Creates a pregenerator for the area, call Start() to begin.
+	a_OnFinished, if set, is called from the pregenerator's thread once all the chunks are stored.
+	Must be owned by a shared_ptr, the queued chunks keep the pregenerator alive until they're prepared. */
+	cWorldPregenerator(cWorld & a_World, const sArea & a_Area, std::function<void()> a_OnFinished);
+
+	virtual ~cWorldPregenerator() override;
+
+	/** Parses the area from the arguments of the pregenerate command that follow the world name, starting at a_Args[a_FirstArg].
+	The area is either "<Radius> [<CenterChunkX> <CenterChunkZ>]", centered on the world spawn by default,
+	or "<MinChunkX> <MinChunkZ> <MaxChunkX> <MaxChunkZ>".
+	Returns false if the arguments are not valid. */
+	static bool ParseArea(const cWorld & a_World, const AStringVector & a_Args, size_t a_FirstArg, sArea & a_Area);
+
+	/** Returns the area being pregenerated. */
+	const sArea & GetArea(void) const { return m_Area; }
+
+	/** Returns true once all the chunks have been prepared and stored. */
+	bool IsFinished(void) const { return m_IsFinished; }
+
+	/** Returns a one-line report of the progress and of the throughput of each stage, as of the last report. */
+	AString GetStatus(void) const;
+
+protected:
+
+	/** Number of chunks to be queued in the world's pipeline at once. */
+	static constexpr int MAX_IN_FLIGHT = 128;
+
+	/** Number of rows in a band of the processing order. */
+	static constexpr int BAND_ROWS = 32;
+
+	/** Number of finished chunks between the checkpoints. */
+	static constexpr int CHECKPOINT_CHUNKS = 2048;
+
+	/** The cumulative counters of the pipeline's stages, for calculating the throughput. */
+	struct sCounters
+	{
+		size_t m_Prepared;
+		size_t m_Generated;
+		size_t m_Lit;
+		size_t m_Saved;
+	};
+
+	friend class cWorldPregeneratorCallback;
+
+	cWorld & m_World;
+
+	/** The area being pregenerated. */
+	sArea m_Area;
+
+	/** Number of chunks in m_Area. */
+	int m_NumChunks;
+
+	/** Called once all the chunks are stored. */
+	std::function<void()> m_OnFinished;
+
+	/** Name of the file storing the progress, in the world folder. */
+	AString m_CheckpointFileName;
+
+	/** Protects the progress members below. */
+	mutable cCriticalSection m_CS;
+
+	/** Number of chunks at the start of the processing order that have all been prepared. Protected by m_CS. */
+	int m_NumDone;
+
+	/** Indices of the chunks prepared out of order, all above m_NumDone. Protected by m_CS. */
+	std::set<int> m_DoneAhead;
+
+	/** Indices of the chunks whose preparation failed, to be queued again. Protected by m_CS. */
+	std::vector<int> m_Failed;
+
+	/** Number of chunks queued in the world's pipeline and not yet prepared. Protected by m_CS. */
+	int m_NumInFlight;
+
+	/** The last progress report. Protected by m_CS. */
+	AString m_Status;
+
+	/** Index of the next chunk to be queued. Used only by the pregenerator's thread. */
+	int m_NextIdx;
+
+	/** Number of chunks stored as of the last checkpoint. Used only by the pregenerator's thread. */
+	int m_NumCheckpointed;
+
+	/** Number of chunks prepared since the start. */
+	std::atomic<size_t> m_NumPrepared;
+
+	std::atomic<bool> m_IsFinished;
+
+	/** Set whenever a chunk is prepared, or to stop the thread. */
+	cEvent m_evtChunkPrepared;
+
+	/** Time of the last progress report, and the stage counters at that time. Used only by the pregenerator's thread. */
+	std::chrono::steady_clock::time_point m_LastReportTime;
+	sCounters m_LastReportCounters;
+
+	// cIsThread override:
+	virtual void Execute(void) override;
+
+	/** Called by the pipeline when a queued chunk is prepared, or when its preparation fails. */
+	void ChunkPrepared(int a_Idx, bool a_IsSuccess);
+
+	/** Returns the chunk coords of the specified index in the processing order. */
+	cChunkCoords DecodeChunkCoords(int a_Idx) const;
+
+	/** Reads the checkpoint file; returns the number of chunks stored if it is for the same area, zero otherwise. */
+	int ReadCheckpoint(void) const;
+
+	/** Saves all the world's chunks, waits until the storage writes them, writes the checkpoint and unloads the unused chunks.
+	Returns false if the thread was asked to terminate in the meantime. */
+	bool Checkpoint(void);
+
+	/** Returns the current values of the stage counters. */
+	sCounters GetCounters(void) const;
+
+	/** Updates m_Status from the counters' change since the last report, and logs it. */
+	void Report(void);
+};
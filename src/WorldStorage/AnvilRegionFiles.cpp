@@ -0,0 +1,808 @@
+// AnvilRegionFiles.cpp
+
+// Implements the cAnvilRegionFiles class that reads and writes the chunk data in the Anvil region (MCA) files
+
+#include "Globals.h"
+#include "AnvilRegionFiles.h"
+#include "../Endianness.h"
+
+
+
+
+
+/** If the chunk data queued for writing into a single MCA file exceeds this size, it's written without waiting for the flush interval. */
+#define MAX_MCA_PENDING_BYTES (4 * 1024 * 1024)
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cAnvilRegionFiles:
+
+cAnvilRegionFiles::cAnvilRegionFiles(
+	const AString & a_Folder,
+	size_t a_MaxOpenFiles,
+	unsigned a_FlushIntervalMSec,
+	eSyncPolicy a_SyncPolicy,
+	bool a_UseMemoryMap,
+	cLoadFailedCallback a_OnLoadFailed
+):
+	m_Folder(a_Folder),
+	m_MaxOpenFiles(std::max<size_t>(a_MaxOpenFiles, 1)),
+	m_NumFileHits(0),
+	m_NumFileOpens(0),
+	m_NumFileEvictions(0),
+	m_FlushIntervalMSec(a_FlushIntervalMSec),
+	m_SyncPolicy(a_SyncPolicy),
+	m_UseMemoryMap(a_UseMemoryMap),
+	m_OnLoadFailed(std::move(a_OnLoadFailed)),
+	m_Writer(*this)
+{
+	if (m_FlushIntervalMSec > 0)
+	{
+		m_Writer.Start();
+	}
+}
+
+
+
+
+
+cAnvilRegionFiles::~cAnvilRegionFiles()
+{
+	m_Writer.Stop();
+	Flush();
+
+	cCSLock Lock(m_CS);
+	m_FilesByRegion.clear();
+	m_Files.clear();
+}
+
+
+
+
+
+bool cAnvilRegionFiles::GetChunkData(const cChunkCoords & a_Chunk, sChunkData & a_Data)
+{
+	auto File = LoadMCAFile(a_Chunk);
+	if (File == nullptr)
+	{
+		return false;
+	}
+	return File->GetChunkData(a_Chunk, a_Data);
+}
+
+
+
+
+
+bool cAnvilRegionFiles::SetChunkData(const cChunkCoords & a_Chunk, const ContiguousByteBufferView a_Data)
+{
+	auto File = LoadMCAFile(a_Chunk);
+	if ((File == nullptr) || !File->QueueChunkData(a_Chunk, a_Data))
+	{
+		return false;
+	}
+
+	if (m_FlushIntervalMSec == 0)
+	{
+		// Write each chunk as soon as it's saved; if the write fails, the chunk stays queued for the next write:
+		return WriteFiles({ File });
+	}
+
+	if (File->GetPendingBytes() >= MAX_MCA_PENDING_BYTES)
+	{
+		// Don't keep too much data in memory:
+		m_Writer.WakeUp();
+	}
+	return true;
+}
+
+
+
+
+
+void cAnvilRegionFiles::Flush(void)
+{
+	// Take a snapshot of the cache, the files are written without holding m_CS:
+	std::vector<std::shared_ptr<cMCAFile>> Files;
+	{
+		cCSLock Lock(m_CS);
+		Files.assign(m_Files.begin(), m_Files.end());
+	}
+	WriteFiles(Files);
+}
+
+
+
+
+
+cWSSchema::sWriteStatistics cAnvilRegionFiles::GetWriteStatistics(void) const
+{
+	cCSLock Lock(m_CSWriteStatistics);
+	return m_WriteStatistics;
+}
+
+
+
+
+
+cWSSchema::sFileCacheStatistics cAnvilRegionFiles::GetFileCacheStatistics(void) const
+{
+	cCSLock Lock(m_CS);
+	cWSSchema::sFileCacheStatistics Res;
+	Res.m_NumFiles = m_Files.size();
+	Res.m_MaxFiles = m_MaxOpenFiles;
+	Res.m_NumHits = m_NumFileHits;
+	Res.m_NumOpens = m_NumFileOpens;
+	Res.m_NumEvictions = m_NumFileEvictions;
+	return Res;
+}
+
+
+
+
+
+bool cAnvilRegionFiles::WriteFiles(const std::vector<std::shared_ptr<cMCAFile>> & a_Files)
+{
+	bool Success = true;
+
+	const auto Start = std::chrono::steady_clock::now();
+	size_t NumChunks = 0;
+	UInt64 NumBytes = 0;
+	std::vector<std::shared_ptr<cMCAFile>> WrittenFiles;
+	for (const auto & File : a_Files)
+	{
+		const auto NumChunksBefore = NumChunks;
+		Success = File->WritePendingChunks(m_SyncPolicy, NumChunks, NumBytes) && Success;
+		if (NumChunks > NumChunksBefore)
+		{
+			WrittenFiles.push_back(File);
+		}
+	}
+	if (WrittenFiles.empty())
+	{
+		return Success;
+	}
+
+	// Sync the files only after all of them have been written, so that the OS can write them out together:
+	if (m_SyncPolicy == eSyncPolicy::PerFlush)
+	{
+		for (const auto & File : WrittenFiles)
+		{
+			if (!File->Sync())
+			{
+				LOGWARNING("Cannot sync file \"%s\" to disk", File->GetFileName());
+				Success = false;
+			}
+		}
+	}
+
+	const auto Elapsed = static_cast<UInt64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Start).count());
+	cCSLock Lock(m_CSWriteStatistics);
+	m_WriteStatistics.m_NumFlushes += 1;
+	m_WriteStatistics.m_NumChunksWritten += NumChunks;
+	m_WriteStatistics.m_BytesWritten += NumBytes;
+	m_WriteStatistics.m_TotalFlushNs += Elapsed;
+	m_WriteStatistics.m_MaxFlushNs = std::max(m_WriteStatistics.m_MaxFlushNs, Elapsed);
+	return Success;
+}
+
+
+
+
+
+std::shared_ptr<cAnvilRegionFiles::cMCAFile> cAnvilRegionFiles::LoadMCAFile(const cChunkCoords & a_Chunk)
+{
+	const int RegionX = FAST_FLOOR_DIV(a_Chunk.m_ChunkX, 32);
+	const int RegionZ = FAST_FLOOR_DIV(a_Chunk.m_ChunkZ, 32);
+	ASSERT(a_Chunk.m_ChunkX - RegionX * 32 >= 0);
+	ASSERT(a_Chunk.m_ChunkZ - RegionZ * 32 >= 0);
+	ASSERT(a_Chunk.m_ChunkX - RegionX * 32 < 32);
+	ASSERT(a_Chunk.m_ChunkZ - RegionZ * 32 < 32);
+	const cChunkCoords Region(RegionX, RegionZ);
+
+	cCSLock Lock(m_CS);
+
+	// Is it already cached? Move the file to front and return it:
+	if (const auto itr = m_FilesByRegion.find(Region); itr != m_FilesByRegion.end())
+	{
+		m_Files.splice(m_Files.begin(), m_Files, itr->second);
+		m_NumFileHits++;
+		return m_Files.front();
+	}
+
+	// Load it anew:
+	cFile::CreateFolder(m_Folder);
+	auto FileName = m_Folder + fmt::format(FMT_STRING("/r.{}.{}.mca"), RegionX, RegionZ);
+	auto f = std::make_shared<cMCAFile>(*this, FileName, RegionX, RegionZ, m_UseMemoryMap);
+	m_Files.push_front(f);
+	m_FilesByRegion.emplace(Region, m_Files.begin());
+	m_NumFileOpens++;
+
+	EvictMCAFiles();
+	return f;
+}
+
+
+
+
+
+void cAnvilRegionFiles::EvictMCAFiles(void)
+{
+	ASSERT(m_CS.IsLocked());
+
+	// Walk from the least recently used file:
+	auto itr = m_Files.end();
+	while ((m_Files.size() > m_MaxOpenFiles) && (itr != m_Files.begin()))
+	{
+		--itr;
+
+		// Nobody else can get hold of the file while m_CS is locked, so a single reference means it's not in use.
+		// The chunks still being read through its mappings must be known to the object that writes the file, too:
+		if (((*itr).use_count() > 1) || (*itr)->HasPendingChunks() || (*itr)->HasMappedChunksInUse())
+		{
+			continue;
+		}
+		m_FilesByRegion.erase(cChunkCoords((*itr)->GetRegionX(), (*itr)->GetRegionZ()));
+		itr = m_Files.erase(itr);
+		m_NumFileEvictions++;
+	}
+
+	if (m_Files.size() > m_MaxOpenFiles)
+	{
+		// Some files are only waiting for their chunks to be written, get them written:
+		m_Writer.WakeUp();
+	}
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cAnvilRegionFiles::cMCAFile:
+
+cAnvilRegionFiles::cMCAFile::cMCAFile(cAnvilRegionFiles & a_Parent, const AString & a_FileName, int a_RegionX, int a_RegionZ, bool a_UseMemoryMap) :
+	m_Parent(a_Parent),
+	m_RegionX(a_RegionX),
+	m_RegionZ(a_RegionZ),
+	m_FileName(a_FileName),
+	m_UseMemoryMap(a_UseMemoryMap),
+	m_PendingBytes(0)
+{
+}
+
+
+
+
+
+bool cAnvilRegionFiles::cMCAFile::OpenFile(bool a_IsForReading)
+{
+	bool writeOutNeeded = false;
+
+	if (m_File.IsOpen())
+	{
+		// Already open
+		return true;
+	}
+
+	if (a_IsForReading)
+	{
+		if (!cFile::Exists(m_FileName))
+		{
+			// We want to read and the file doesn't exist. Fail.
+			return false;
+		}
+	}
+
+	if (!m_File.Open(m_FileName, cFile::fmReadWrite))
+	{
+		// The file failed to open
+		return false;
+	}
+
+	// Load the header:
+	if (m_File.Read(m_Header, sizeof(m_Header)) != sizeof(m_Header))
+	{
+		// Cannot read the header - perhaps the file has just been created?
+		// Try writing a nullptr header for chunk offsets:
+		memset(m_Header, 0, sizeof(m_Header));
+		writeOutNeeded = true;
+	}
+
+	// Load the TimeStamps:
+	if (m_File.Read(m_TimeStamps, sizeof(m_TimeStamps)) != sizeof(m_TimeStamps))
+	{
+		// Cannot read the time stamps - perhaps the file has just been created?
+		// Try writing a nullptr header for timestamps:
+		memset(m_TimeStamps, 0, sizeof(m_TimeStamps));
+		writeOutNeeded = true;
+	}
+
+	if (writeOutNeeded)
+	{
+		m_File.Seek(0);
+		if (
+			(m_File.Write(m_Header, sizeof(m_Header)) != sizeof(m_Header)) ||           // Write chunk offsets
+			(m_File.Write(m_TimeStamps, sizeof(m_TimeStamps)) != sizeof(m_TimeStamps))  // Write chunk timestamps
+		)
+		{
+			LOGWARNING("Cannot process MCA header in file \"%s\", chunks in that file will be lost", m_FileName.c_str());
+			m_File.Close();
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+
+
+bool cAnvilRegionFiles::cMCAFile::GetChunkData(const cChunkCoords & a_Chunk, sChunkData & a_Data)
+{
+	cCSLock Lock(m_CS);
+
+	// The chunks that haven't been written yet are read from memory:
+	const auto Pending = m_PendingChunks.find(GetChunkIndex(a_Chunk));
+	if (Pending != m_PendingChunks.end())
+	{
+		a_Data.m_Buffer = Pending->second;
+		return true;
+	}
+
+	if (!OpenFile(true))
+	{
+		return false;
+	}
+
+	unsigned ChunkLocation = ntohl(m_Header[GetChunkIndex(a_Chunk)]);
+	unsigned ChunkOffset = ChunkLocation >> 8;
+	if (ChunkOffset < 2)
+	{
+		return false;
+	}
+
+	if (m_UseMemoryMap)
+	{
+		return GetMappedChunkData(a_Chunk, ChunkOffset, ChunkLocation & 0xff, a_Data);
+	}
+
+	m_File.Seek(static_cast<int>(ChunkOffset * 4096));
+
+	UInt32 ChunkSize = 0;
+	if (m_File.Read(&ChunkSize, 4) != 4)
+	{
+		m_Parent.m_OnLoadFailed(a_Chunk, "Cannot read chunk size", {});
+		return false;
+	}
+	ChunkSize = ntohl(ChunkSize);
+	if (ChunkSize < 1)
+	{
+		// Chunk size too small
+		m_Parent.m_OnLoadFailed(a_Chunk, "Chunk size too small", {});
+		return false;
+	}
+
+	char CompressionType = 0;
+	if (m_File.Read(&CompressionType, 1) != 1)
+	{
+		m_Parent.m_OnLoadFailed(a_Chunk, "Cannot read chunk compression", {});
+		return false;
+	}
+	ChunkSize--;
+
+	a_Data.m_Buffer = m_File.Read(ChunkSize);
+	if (a_Data.m_Buffer.size() != ChunkSize)
+	{
+		m_Parent.m_OnLoadFailed(a_Chunk, "Cannot read entire chunk data", a_Data.m_Buffer);
+		return false;
+	}
+
+	if (CompressionType != 2)
+	{
+		// Chunk is in an unknown compression
+		m_Parent.m_OnLoadFailed(a_Chunk, fmt::format(FMT_STRING("Unknown chunk compression: {}"), CompressionType), a_Data.m_Buffer);
+		return false;
+	}
+	return true;
+}
+
+
+
+
+
+bool cAnvilRegionFiles::cMCAFile::GetMappedChunkData(const cChunkCoords & a_Chunk, unsigned a_ChunkOffset, unsigned a_NumSectors, sChunkData & a_Data)
+{
+	// Map the file, if not already mapped; there may be readers still using the previous mapping, so create a new object:
+	if (m_Mapping == nullptr)
+	{
+		auto Mapping = std::make_shared<cMemoryMappedFile>(m_FileName);
+		if (!Mapping->IsOpen())
+		{
+			LOGWARNING("Cannot map file \"%s\" into memory, chunk [%d, %d] cannot be loaded", m_FileName, a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
+			return false;
+		}
+		m_Mapping = std::move(Mapping);
+	}
+	const auto View = m_Mapping->GetView();
+
+	const size_t Start = static_cast<size_t>(a_ChunkOffset) * 4096;
+	if (View.size() < Start + MCA_CHUNK_HEADER_LENGTH)
+	{
+		m_Parent.m_OnLoadFailed(a_Chunk, "Cannot read chunk size", {});
+		return false;
+	}
+	UInt32 ChunkSize = NetworkBufToHost<UInt32>(View.data() + Start);
+	if (ChunkSize < 1)
+	{
+		// Chunk size too small
+		m_Parent.m_OnLoadFailed(a_Chunk, "Chunk size too small", {});
+		return false;
+	}
+	const auto CompressionType = static_cast<char>(View[Start + 4]);
+	ChunkSize--;
+
+	// Hand out the mapping together with the chunk's sectors, so that they aren't overwritten while the data is in use:
+	if (m_MappedChunks.size() >= 64)
+	{
+		RemoveReleasedMappedChunks();
+	}
+	auto MappedChunk = std::make_shared<sMappedChunk>(sMappedChunk{ m_Mapping, a_ChunkOffset, a_NumSectors });
+	m_MappedChunks.push_back(MappedChunk);
+	a_Data.m_Mapping = std::shared_ptr<cMemoryMappedFile>(MappedChunk, MappedChunk->m_Mapping.get());
+	a_Data.m_MappedData = View.substr(Start + MCA_CHUNK_HEADER_LENGTH, ChunkSize);
+	if (a_Data.m_MappedData.size() != ChunkSize)
+	{
+		m_Parent.m_OnLoadFailed(a_Chunk, "Cannot read entire chunk data", a_Data.m_MappedData);
+		return false;
+	}
+
+	if (CompressionType != 2)
+	{
+		// Chunk is in an unknown compression
+		m_Parent.m_OnLoadFailed(a_Chunk, fmt::format(FMT_STRING("Unknown chunk compression: {}"), CompressionType), a_Data.m_MappedData);
+		return false;
+	}
+	return true;
+}
+
+
+
+
+bool cAnvilRegionFiles::cMCAFile::QueueChunkData(const cChunkCoords & a_Chunk, const ContiguousByteBufferView a_Data)
+{
+	cCSLock Lock(m_CS);
+
+	// The header stores the size as a number of 4 KiB sectors in a single byte:
+	const size_t NumSectors = (a_Data.size() + MCA_CHUNK_HEADER_LENGTH + 4095) / 4096;
+	if (NumSectors > 255)
+	{
+		LOGWARNING("Cannot save chunk [%d, %d], the data is too large (%u KiB, maximum is 1024 KiB). Remove some entities and retry.",
+			a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, static_cast<unsigned>(NumSectors * 4)
+		);
+		return false;
+	}
+
+	// Replace any older data of the same chunk that hasn't been written yet:
+	auto & Pending = m_PendingChunks[GetChunkIndex(a_Chunk)];
+	m_PendingBytes = m_PendingBytes - Pending.size() + a_Data.size();
+	Pending.assign(a_Data.begin(), a_Data.end());
+	return true;
+}
+
+
+
+
+
+bool cAnvilRegionFiles::cMCAFile::WritePendingChunks(const eSyncPolicy a_SyncPolicy, size_t & a_NumChunks, UInt64 & a_NumBytes)
+{
+	cCSLock Lock(m_CS);
+	if (m_PendingChunks.empty())
+	{
+		return true;
+	}
+	if (!OpenFile(false))
+	{
+		LOGWARNING("Cannot save %zu chunks, opening file \"%s\" failed", m_PendingChunks.size(), GetFileName());
+		return false;
+	}
+
+	struct sPlacement
+	{
+		unsigned m_Sector;
+		unsigned m_NumSectors;
+		unsigned m_Index;
+		const ContiguousByteBuffer * m_Data;
+	};
+
+	// The sectors still being read through the file mappings:
+	RemoveReleasedMappedChunks();
+	std::vector<std::pair<unsigned, unsigned>> MappedSectors;
+	for (const auto & MappedChunk : m_MappedChunks)
+	{
+		if (const auto Chunk = MappedChunk.lock(); Chunk != nullptr)
+		{
+			MappedSectors.emplace_back(Chunk->m_Sector, Chunk->m_Sector + Chunk->m_NumSectors);
+		}
+	}
+
+	// The sectors in use: the headers, all the chunks in the header and the mapped ones.
+	// The sectors of the chunks being rewritten are reused only after the header stops pointing to them, in a later write:
+	std::vector<bool> IsSectorUsed(2, true);
+	for (const auto ChunkLocation : m_Header)
+	{
+		const auto Location = ntohl(ChunkLocation);
+		if ((Location >> 8) >= 2)
+		{
+			MarkSectorsUsed(IsSectorUsed, Location >> 8, Location & 0xff);
+		}
+	}
+	for (const auto & Range : MappedSectors)
+	{
+		MarkSectorsUsed(IsSectorUsed, Range.first, Range.second - Range.first);
+	}
+
+	// Chunks that fit their current location stay there, unless it's still being read through a mapping:
+	std::vector<sPlacement> Placements;
+	Placements.reserve(m_PendingChunks.size());
+	std::vector<sPlacement> ToMove;
+	for (const auto & Chunk : m_PendingChunks)
+	{
+		const auto NumSectors = static_cast<unsigned>((Chunk.second.size() + MCA_CHUNK_HEADER_LENGTH + 4095) / 4096);
+		const auto ChunkLocation = ntohl(m_Header[Chunk.first]);
+		const auto Sector = ChunkLocation >> 8;
+		const bool IsMapped = std::any_of(MappedSectors.begin(), MappedSectors.end(), [Sector, NumSectors](const std::pair<unsigned, unsigned> & a_Range)
+			{
+				return (a_Range.first < Sector + NumSectors) && (Sector < a_Range.second);
+			}
+		);
+		if ((Sector >= 2) && (NumSectors <= (ChunkLocation & 0xff)) && !IsMapped)
+		{
+			Placements.push_back({ Sector, NumSectors, Chunk.first, &Chunk.second });
+		}
+		else
+		{
+			ToMove.push_back({ 0, NumSectors, Chunk.first, &Chunk.second });
+		}
+	}
+
+	// The rest goes to the first gap large enough, left by the chunks that have moved or shrunk, or to the end of the file:
+	for (auto & Placement : ToMove)
+	{
+		Placement.m_Sector = FindFreeSectors(IsSectorUsed, Placement.m_NumSectors);
+		MarkSectorsUsed(IsSectorUsed, Placement.m_Sector, Placement.m_NumSectors);
+		Placements.push_back(Placement);
+	}
+	const auto EndSector = static_cast<unsigned>(IsSectorUsed.size());
+
+	std::sort(Placements.begin(), Placements.end(), [](const sPlacement & a_Lhs, const sPlacement & a_Rhs)
+		{
+			return (a_Lhs.m_Sector < a_Rhs.m_Sector);
+		}
+	);
+
+	// Write each run of adjacent chunks in a single operation:
+	ContiguousByteBuffer Run;
+	for (size_t i = 0; i < Placements.size();)
+	{
+		const auto RunSector = Placements[i].m_Sector;
+		Run.clear();
+		do
+		{
+			// The chunk header, the data and zero padding up to the 4 KiB boundary:
+			const auto & Placement = Placements[i];
+			const auto Offset = Run.size();
+			Run.resize(Offset + Placement.m_NumSectors * 4096);
+			const UInt32 ChunkSize = htonl(static_cast<UInt32>(Placement.m_Data->size() + 1));
+			memcpy(Run.data() + Offset, &ChunkSize, 4);
+			Run[Offset + 4] = std::byte(2);  // Compression type: zlib
+			memcpy(Run.data() + Offset + MCA_CHUNK_HEADER_LENGTH, Placement.m_Data->data(), Placement.m_Data->size());
+			i++;
+		} while ((i < Placements.size()) && (Placements[i].m_Sector == Placements[i - 1].m_Sector + Placements[i - 1].m_NumSectors));
+
+		if ((m_File.Seek(static_cast<int>(RunSector * 4096)) < 0) || (m_File.Write(Run.data(), Run.size()) != static_cast<int>(Run.size())))
+		{
+			LOGWARNING("Cannot save %zu chunks, writing data to file \"%s\" failed", m_PendingChunks.size(), GetFileName());
+			return false;
+		}
+	}
+
+	// The header must not point to data that may not be on the disk yet:
+	if ((a_SyncPolicy == eSyncPolicy::PerRegion) && !m_File.Sync())
+	{
+		LOGWARNING("Cannot save %zu chunks, syncing file \"%s\" failed", m_PendingChunks.size(), GetFileName());
+		return false;
+	}
+
+	// Update the header and write it, once for all the chunks:
+	const auto TimeStamp = htonl(static_cast<UInt32>(time(nullptr)));
+	for (const auto & Placement : Placements)
+	{
+		m_Header[Placement.m_Index] = htonl(static_cast<UInt32>((Placement.m_Sector << 8) | Placement.m_NumSectors));
+		m_TimeStamps[Placement.m_Index] = TimeStamp;
+	}
+	if (
+		(m_File.Seek(0) < 0) ||
+		(m_File.Write(m_Header, sizeof(m_Header)) != sizeof(m_Header)) ||
+		(m_File.Write(m_TimeStamps, sizeof(m_TimeStamps)) != sizeof(m_TimeStamps))
+	)
+	{
+		LOGWARNING("Cannot save %zu chunks, writing header to file \"%s\" failed", m_PendingChunks.size(), GetFileName());
+		return false;
+	}
+
+	// Hand the data over to the OS, so that the readers of the file (and its mapping) see it:
+	if (a_SyncPolicy == eSyncPolicy::PerRegion)
+	{
+		if (!m_File.Sync())
+		{
+			LOGWARNING("Cannot sync file \"%s\" to disk", GetFileName());
+		}
+	}
+	else
+	{
+		m_File.Flush();
+	}
+
+	// If the file grew past the mapped size, map it anew on the next read:
+	if ((m_Mapping != nullptr) && (m_Mapping->GetView().size() < static_cast<size_t>(EndSector) * 4096))
+	{
+		m_Mapping.reset();
+	}
+
+	a_NumChunks += Placements.size();
+	for (const auto & Placement : Placements)
+	{
+		a_NumBytes += Placement.m_NumSectors * 4096;
+	}
+	a_NumBytes += sizeof(m_Header) + sizeof(m_TimeStamps);
+
+	m_PendingChunks.clear();
+	m_PendingBytes = 0;
+	return true;
+}
+
+
+
+
+
+bool cAnvilRegionFiles::cMCAFile::Sync(void)
+{
+	cCSLock Lock(m_CS);
+
+	// A file that hasn't been opened has nothing to sync:
+	return !m_File.IsOpen() || m_File.Sync();
+}
+
+
+
+
+
+size_t cAnvilRegionFiles::cMCAFile::GetPendingBytes(void) const
+{
+	cCSLock Lock(m_CS);
+	return m_PendingBytes;
+}
+
+
+
+
+
+bool cAnvilRegionFiles::cMCAFile::HasPendingChunks(void) const
+{
+	cCSLock Lock(m_CS);
+	return !m_PendingChunks.empty();
+}
+
+
+
+
+
+bool cAnvilRegionFiles::cMCAFile::HasMappedChunksInUse(void)
+{
+	cCSLock Lock(m_CS);
+	RemoveReleasedMappedChunks();
+	return !m_MappedChunks.empty();
+}
+
+
+
+
+
+void cAnvilRegionFiles::cMCAFile::RemoveReleasedMappedChunks(void)
+{
+	m_MappedChunks.erase(
+		std::remove_if(m_MappedChunks.begin(), m_MappedChunks.end(), [](const std::weak_ptr<sMappedChunk> & a_Chunk)
+			{
+				return a_Chunk.expired();
+			}
+		),
+		m_MappedChunks.end()
+	);
+}
+
+
+
+
+
+void cAnvilRegionFiles::cMCAFile::MarkSectorsUsed(std::vector<bool> & a_IsSectorUsed, unsigned a_Sector, unsigned a_NumSectors)
+{
+	if (a_IsSectorUsed.size() < a_Sector + a_NumSectors)
+	{
+		a_IsSectorUsed.resize(a_Sector + a_NumSectors, false);
+	}
+	std::fill_n(a_IsSectorUsed.begin() + a_Sector, a_NumSectors, true);
+}
+
+
+
+
+
+unsigned cAnvilRegionFiles::cMCAFile::FindFreeSectors(const std::vector<bool> & a_IsSectorUsed, unsigned a_NumSectors)
+{
+	unsigned RunStart = 0;
+	for (unsigned i = 0; i < a_IsSectorUsed.size(); i++)
+	{
+		if (a_IsSectorUsed[i])
+		{
+			RunStart = i + 1;
+		}
+		else if (i + 1 - RunStart == a_NumSectors)
+		{
+			return RunStart;
+		}
+	}
+
+	// The free sectors at the end of the file, if any, continue past it:
+	return RunStart;
+}
+
+
+
+
+
+unsigned cAnvilRegionFiles::cMCAFile::GetChunkIndex(const cChunkCoords & a_Chunk)
+{
+	// The bitmasks give the non-negative remainder even for negative coords:
+	return static_cast<unsigned>(a_Chunk.m_ChunkX & 31) + 32 * static_cast<unsigned>(a_Chunk.m_ChunkZ & 31);
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cAnvilRegionFiles::cRegionWriter:
+
+cAnvilRegionFiles::cRegionWriter::cRegionWriter(cAnvilRegionFiles & a_Parent):
+	Super("Anvil Region Writer"),
+	m_Parent(a_Parent)
+{
+}
+
+
+
+
+
+void cAnvilRegionFiles::cRegionWriter::Stop(void)
+{
+	m_ShouldTerminate = true;
+	m_Event.Set();
+	Super::Stop();
+}
+
+
+
+
+
+void cAnvilRegionFiles::cRegionWriter::Execute(void)
+{
+	while (!m_ShouldTerminate)
+	{
+		m_Event.Wait(m_Parent.m_FlushIntervalMSec);
+		m_Parent.Flush();
+	}
+}
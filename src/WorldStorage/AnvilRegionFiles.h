@@ -0,0 +1,312 @@
+// AnvilRegionFiles.h
+
+// Declares the cAnvilRegionFiles class that reads and writes the chunk data in the Anvil region (MCA) files
+
+/*
+Each region file holds 32 * 32 chunks. It starts with a 4 KiB header of the chunk locations, each one the chunk's
+offset in 4 KiB sectors (3 bytes) followed by its size in sectors (1 byte), all big-endian, and a 4 KiB header
+of the chunks' timestamps. Each chunk's data is prefixed by its length (4 bytes, big-endian, including the
+compression byte) and the compression type (1 byte, 2 for zlib).
+The saved chunks are queued in memory and written in batches, either right away or periodically by a writer thread.
+Each batch rewrites the chunks in place if they fit; the others fill the gaps left by the earlier batches before the file grows.
+*/
+
+
+
+
+
+#pragma once
+
+#include "WorldStorage.h"
+#include "../OSSupport/Event.h"
+#include "../OSSupport/File.h"
+#include "../OSSupport/MemoryMappedFile.h"
+
+
+
+
+
+/** Keeps a cache of the open region files of a single world and reads and writes the chunk data in them.
+The data is the compressed chunk data; this class doesn't care about its contents. Thread-safe. */
+class cAnvilRegionFiles
+{
+public:
+
+	enum
+	{
+		/** Maximum number of chunks in an MCA file - also the count of the header items */
+		MCA_MAX_CHUNKS = 32 * 32,
+
+		/** The MCA header is 8 KiB */
+		MCA_HEADER_SIZE = MCA_MAX_CHUNKS * 8,
+
+		/** There are 5 bytes of header in front of each chunk */
+		MCA_CHUNK_HEADER_LENGTH = 5,
+	} ;
+
+
+	/** When the region files are synced to disk after writing the saved chunks. */
+	enum class eSyncPolicy
+	{
+		/** Never, the OS writes the data out when it sees fit. */
+		None,
+
+		/** Once per flush; all the regions are written first, then each written file is synced. */
+		PerFlush,
+
+		/** Once per region; each region's chunk data is synced before its header is written, and the header after.
+		A crash never leaves a header pointing to unwritten data. */
+		PerRegion,
+	};
+
+
+	/** The compressed data of a single chunk, as read from an MCA file.
+	The data is either copied into a buffer, or it points directly into a mapping of the file. */
+	struct sChunkData
+	{
+		/** The data read by the File backend. */
+		ContiguousByteBuffer m_Buffer;
+
+		/** The mapping that m_MappedData points into, kept alive while the data is in use. Null for the File backend.
+		Also keeps the chunk's sectors in the file from being overwritten while the data is in use. */
+		std::shared_ptr<cMemoryMappedFile> m_Mapping;
+
+		/** The data, as read by the MemoryMapped backend. */
+		ContiguousByteBufferView m_MappedData;
+
+		/** Returns the chunk's data, regardless of the backend that read it. */
+		ContiguousByteBufferView GetView(void) const
+		{
+			return (m_Mapping != nullptr) ? m_MappedData : ContiguousByteBufferView(m_Buffer);
+		}
+	};
+
+
+	/** Called when a chunk's data in a region file is damaged, with the reason and the data read, if any. */
+	using cLoadFailedCallback = std::function<void(const cChunkCoords & a_Chunk, const AString & a_Reason, ContiguousByteBufferView a_ChunkData)>;
+
+
+	/** Creates the object for the region files in the specified folder; the folder is created on first use.
+	a_MaxOpenFiles is the number of the files kept open.
+	a_FlushIntervalMSec is how long the saved chunks are collected before they're written, zero writes them right away.
+	If a_UseMemoryMap is true, chunks are read through memory mappings of the files instead of being copied into buffers. */
+	cAnvilRegionFiles(
+		const AString & a_Folder,
+		size_t a_MaxOpenFiles,
+		unsigned a_FlushIntervalMSec,
+		eSyncPolicy a_SyncPolicy,
+		bool a_UseMemoryMap,
+		cLoadFailedCallback a_OnLoadFailed
+	);
+
+	/** Stops the writer thread and writes all the chunks still queued. */
+	~cAnvilRegionFiles();
+
+	/** Gets chunk data from the correct file; locks file CS as needed */
+	bool GetChunkData(const cChunkCoords & a_Chunk, sChunkData & a_Data);
+
+	/** Queues the chunk data to be written into the correct file; locks file CS as needed.
+	With a zero flush interval the data is written before returning. */
+	bool SetChunkData(const cChunkCoords & a_Chunk, ContiguousByteBufferView a_Data);
+
+	/** Writes the chunks queued in all the cached files. */
+	void Flush(void);
+
+	cWSSchema::sWriteStatistics GetWriteStatistics(void) const;
+	cWSSchema::sFileCacheStatistics GetFileCacheStatistics(void) const;
+
+protected:
+
+	/** A single MCA file.
+	All the public functions lock the file's own CS, so that different files can be accessed concurrently. */
+	class cMCAFile
+	{
+	public:
+
+		/** Creates the object for the specified file; the file is opened on first use.
+		If a_UseMemoryMap is true, chunks are read through a memory mapping of the file instead of being copied into buffers. */
+		cMCAFile(cAnvilRegionFiles & a_Parent, const AString & a_FileName, int a_RegionX, int a_RegionZ, bool a_UseMemoryMap);
+
+		/** Reads the chunk's data, either from the file or from the chunks queued for writing. */
+		bool GetChunkData  (const cChunkCoords & a_Chunk, sChunkData & a_Data);
+
+		/** Stores a copy of the chunk's data, to be written by the next WritePendingChunks().
+		Returns false if the data is too large to fit a region file. */
+		bool QueueChunkData(const cChunkCoords & a_Chunk, ContiguousByteBufferView a_Data);
+
+		/** Writes all the queued chunks into the file, then writes the header once.
+		The chunks that fit their current location are rewritten in place; the others are written into the first gap large enough,
+		left by the chunks that have moved or shrunk in an earlier write, or at the end of the file. The sectors still being read
+		through the file mappings are never overwritten. The chunks are sorted by their location and the adjacent ones are written in a single operation.
+		Adds the number of chunks and bytes written to the counters. Returns true on success. */
+		bool WritePendingChunks(eSyncPolicy a_SyncPolicy, size_t & a_NumChunks, UInt64 & a_NumBytes);
+
+		/** Waits until the data written into the file is on the disk. */
+		bool Sync(void);
+
+		/** Returns the total size of the chunk data queued for writing. */
+		size_t GetPendingBytes(void) const;
+
+		bool HasPendingChunks(void) const;
+
+		/** Returns true if any chunk data read through the file's mappings is still in use. */
+		bool HasMappedChunksInUse(void);
+
+		int             GetRegionX () const {return m_RegionX; }
+		int             GetRegionZ () const {return m_RegionZ; }
+		const AString & GetFileName() const {return m_FileName; }
+
+	protected:
+
+		/** The sectors of a chunk handed out to a reader through the file mapping. */
+		struct sMappedChunk
+		{
+			std::shared_ptr<cMemoryMappedFile> m_Mapping;
+			unsigned m_Sector;
+			unsigned m_NumSectors;
+		};
+
+		cAnvilRegionFiles & m_Parent;
+
+		/** Protects all the members below against multithreaded access. */
+		mutable cCriticalSection m_CS;
+
+		int     m_RegionX;
+		int     m_RegionZ;
+		cFile   m_File;
+		AString m_FileName;
+
+		// The header, copied from the file so we don't have to seek to it all the time
+		// First 1024 entries are chunk locations - the 3 + 1 byte sector-offset and sector-count
+		unsigned m_Header[MCA_MAX_CHUNKS];
+
+		// Chunk timestamps, following the chunk headers
+		unsigned m_TimeStamps[MCA_MAX_CHUNKS];
+
+		/** If true, the chunks are read through m_Mapping rather than through m_File. Writes always go through m_File. */
+		bool m_UseMemoryMap;
+
+		/** The current read-only mapping of the whole file, created on demand.
+		Dropped when a write extends the file past the mapped size, so that the next read maps the file anew;
+		the chunks still being loaded from the old mapping keep it alive through sChunkData. */
+		std::shared_ptr<cMemoryMappedFile> m_Mapping;
+
+		/** The chunks handed out through the mappings; the readers own them through sChunkData::m_Mapping.
+		The sectors of the chunks still owned are not overwritten, all the mappings share the file's pages. */
+		std::vector<std::weak_ptr<sMappedChunk>> m_MappedChunks;
+
+		/** The data of the chunks waiting to be written, mapped by their index in the header. */
+		std::map<unsigned, ContiguousByteBuffer> m_PendingChunks;
+
+		/** The total size of m_PendingChunks' data. */
+		size_t m_PendingBytes;
+
+		/** Reads the data of the chunk stored at the specified sectors through the file mapping. */
+		bool GetMappedChunkData(const cChunkCoords & a_Chunk, unsigned a_ChunkOffset, unsigned a_NumSectors, sChunkData & a_Data);
+
+		/** Removes the chunks that the readers don't own anymore from m_MappedChunks. */
+		void RemoveReleasedMappedChunks(void);
+
+		/** Marks the sectors as used, growing the map if needed. */
+		static void MarkSectorsUsed(std::vector<bool> & a_IsSectorUsed, unsigned a_Sector, unsigned a_NumSectors);
+
+		/** Returns the first of the first a_NumSectors consecutive free sectors, possibly continuing past the end of the map. */
+		static unsigned FindFreeSectors(const std::vector<bool> & a_IsSectorUsed, unsigned a_NumSectors);
+
+		/** Returns the index of the chunk's entry in the header. */
+		static unsigned GetChunkIndex(const cChunkCoords & a_Chunk);
+
+		/** Opens a MCA file either for a Read operation (fails if doesn't exist) or for a Write operation (creates new if not found) */
+		bool OpenFile(bool a_IsForReading);
+	} ;
+
+	/** Writes the saved chunks into the region files periodically, so that the chunks saved together are written in batches. */
+	class cRegionWriter:
+		public cIsThread
+	{
+		using Super = cIsThread;
+
+	public:
+
+		cRegionWriter(cAnvilRegionFiles & a_Parent);
+
+		/** Signals the thread to terminate and waits until it's finished. */
+		void Stop(void);
+
+		/** Makes the thread write the saved chunks without waiting for the rest of the interval. */
+		void WakeUp(void) { m_Event.Set(); }
+
+	protected:
+
+		/** The sectors of a chunk handed out to a reader through the file mapping. */
+		struct sMappedChunk
+		{
+			std::shared_ptr<cMemoryMappedFile> m_Mapping;
+			unsigned m_Sector;
+			unsigned m_NumSectors;
+		};
+
+		cAnvilRegionFiles & m_Parent;
+
+		/** Set when the thread should write the chunks right away or terminate. */
+		cEvent m_Event;
+
+		// cIsThread override:
+		virtual void Execute(void) override;
+	};
+
+
+	using cMCAFiles = std::list<std::shared_ptr<cMCAFile>>;
+
+
+	/** The folder where the region files are stored. */
+	AString m_Folder;
+
+	/** Protects the cache of the MCA files against multithreaded access.
+	Held only while looking up the files; the chunk I/O locks just the file that it works with. */
+	mutable cCriticalSection m_CS;
+
+	/** A MRU cache of MCA files, the most recently used first. Protected by m_CS. */
+	cMCAFiles m_Files;
+
+	/** Maps the region coords onto their file in m_Files. Protected by m_CS. */
+	std::unordered_map<cChunkCoords, cMCAFiles::iterator, cChunkCoordsHash> m_FilesByRegion;
+
+	/** The number of the MCA files kept open ("MaxOpenRegionFiles" in world.ini). */
+	size_t m_MaxOpenFiles;
+
+	/** The file cache counters, protected by m_CS. */
+	UInt64 m_NumFileHits;
+	UInt64 m_NumFileOpens;
+	UInt64 m_NumFileEvictions;
+
+	/** How long the saved chunks are collected before they're written, zero writes them right away. */
+	unsigned m_FlushIntervalMSec;
+
+	eSyncPolicy m_SyncPolicy;
+
+	/** If true, the MCA files are read through memory mappings ("RegionBackend=MemoryMapped" in world.ini). */
+	bool m_UseMemoryMap;
+
+	/** Reports the chunks whose data is damaged. */
+	cLoadFailedCallback m_OnLoadFailed;
+
+	/** Protects m_WriteStatistics. */
+	mutable cCriticalSection m_CSWriteStatistics;
+
+	cWSSchema::sWriteStatistics m_WriteStatistics;
+
+	/** Writes the chunks queued in the specified files, syncs them according to m_SyncPolicy and updates the write statistics.
+	Returns true if all the files were written successfully. */
+	bool WriteFiles(const std::vector<std::shared_ptr<cMCAFile>> & a_Files);
+
+	/** Gets the correct MCA file either from cache or from disk, manages the m_Files cache; locks m_CS */
+	std::shared_ptr<cMCAFile> LoadMCAFile(const cChunkCoords & a_Chunk);
+
+	/** Drops the least recently used files until the cache fits m_MaxOpenFiles; assumes m_CS is locked.
+	The files still in use or with chunks waiting to be written are kept, so that there's never a second object for the same file. */
+	void EvictMCAFiles(void);
+
+	/** The thread writing the saved chunks, not started if m_FlushIntervalMSec is zero. */
+	cRegionWriter m_Writer;
+} ;
@@ -0,0 +1,173 @@
+
+// ColdChunkCache.cpp
+
+// Implements the cColdChunkCache class that keeps the compressed storage data of recently unloaded chunks in memory
+
+#include "Globals.h"
+#include "ColdChunkCache.h"
+
+
+
+
+
+cColdChunkCache::cColdChunkCache(const size_t a_BudgetBytes) :
+	m_BudgetBytes(a_BudgetBytes),
+	m_NumColdBytes(0),
+	m_NumKeptBytes(0),
+	m_NumHits(0),
+	m_NumMisses(0),
+	m_NumEvictions(0)
+{
+}
+
+
+
+
+
+void cColdChunkCache::SetBudget(const size_t a_BudgetBytes)
+{
+	cCSLock Lock(m_CS);
+	m_BudgetBytes = a_BudgetBytes;
+	Evict();
+}
+
+
+
+
+
+void cColdChunkCache::Keep(const cChunkCoords a_Chunk, const ContiguousByteBufferView a_Data)
+{
+	cCSLock Lock(m_CS);
+
+	// Any previous blob, cold or not, is out of date now:
+	Remove(a_Chunk);
+	if (a_Data.size() > m_BudgetBytes)
+	{
+		// Wouldn't fit at all:
+		return;
+	}
+
+	m_Kept.push_front({ a_Chunk, ContiguousByteBuffer(a_Data), false });
+	m_Index.emplace(a_Chunk, m_Kept.begin());
+	m_NumKeptBytes += a_Data.size();
+
+	Evict();
+}
+
+
+
+
+
+void cColdChunkCache::ChunkUnloaded(const cChunkCoords a_Chunk)
+{
+	cCSLock Lock(m_CS);
+	const auto itr = m_Index.find(a_Chunk);
+	if ((itr == m_Index.end()) || itr->second->m_IsCold)
+	{
+		return;
+	}
+
+	// Move the entry over to the cold ones:
+	auto & Entry = *itr->second;
+	Entry.m_IsCold = true;
+	m_NumKeptBytes -= Entry.m_Data.size();
+	m_NumColdBytes += Entry.m_Data.size();
+	m_Cold.splice(m_Cold.begin(), m_Kept, itr->second);
+
+	Evict();
+}
+
+
+
+
+
+bool cColdChunkCache::Take(const cChunkCoords a_Chunk, ContiguousByteBuffer & a_Data)
+{
+	cCSLock Lock(m_CS);
+	const auto itr = m_Index.find(a_Chunk);
+	if ((itr == m_Index.end()) || !itr->second->m_IsCold)
+	{
+		m_NumMisses++;
+		return false;
+	}
+
+	m_NumHits++;
+	m_NumColdBytes -= itr->second->m_Data.size();
+	a_Data = std::move(itr->second->m_Data);
+	m_Cold.erase(itr->second);
+	m_Index.erase(itr);
+	return true;
+}
+
+
+
+
+
+void cColdChunkCache::Remove(const cChunkCoords a_Chunk)
+{
+	cCSLock Lock(m_CS);
+	const auto itr = m_Index.find(a_Chunk);
+	if (itr == m_Index.end())
+	{
+		return;
+	}
+
+	if (itr->second->m_IsCold)
+	{
+		m_NumColdBytes -= itr->second->m_Data.size();
+		m_Cold.erase(itr->second);
+	}
+	else
+	{
+		m_NumKeptBytes -= itr->second->m_Data.size();
+		m_Kept.erase(itr->second);
+	}
+	m_Index.erase(itr);
+}
+
+
+
+
+
+cColdChunkCache::sStatistics cColdChunkCache::GetStatistics(void) const
+{
+	cCSLock Lock(m_CS);
+	sStatistics Stats;
+	Stats.m_NumChunks = m_Cold.size();
+	Stats.m_NumBytes = m_NumColdBytes;
+	Stats.m_NumKeptChunks = m_Kept.size();
+	Stats.m_NumKeptBytes = m_NumKeptBytes;
+	Stats.m_BudgetBytes = m_BudgetBytes;
+	Stats.m_NumHits = m_NumHits;
+	Stats.m_NumMisses = m_NumMisses;
+	Stats.m_NumEvictions = m_NumEvictions;
+	return Stats;
+}
+
+
+
+
+
+void cColdChunkCache::Evict(void)
+{
+	ASSERT(m_CS.IsLockedByCurrentThread());
+
+	while (m_NumKeptBytes > m_BudgetBytes)
+	{
+		ASSERT(!m_Kept.empty());
+		const auto & Oldest = m_Kept.back();
+		m_NumKeptBytes -= Oldest.m_Data.size();
+		m_Index.erase(Oldest.m_Chunk);
+		m_Kept.pop_back();
+	}
+
+	while (m_NumColdBytes > m_BudgetBytes)
+	{
+		ASSERT(!m_Cold.empty());
+		const auto & Oldest = m_Cold.back();
+		m_NumColdBytes -= Oldest.m_Data.size();
+		m_Index.erase(Oldest.m_Chunk);
+		m_Cold.pop_back();
+		m_NumEvictions++;
+	}
+}
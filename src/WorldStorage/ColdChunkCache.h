@@ -0,0 +1,109 @@
+
+// ColdChunkCache.h
+
+// Declares the cColdChunkCache class that keeps the compressed storage data of recently unloaded chunks in memory
+
+
+
+
+
+#pragma once
+
+#include "../ChunkDef.h"
+#include "../OSSupport/CriticalSection.h"
+
+
+
+
+
+/** Keeps the compressed storage blobs of recently unloaded chunks in memory, so that chunks which are soon needed
+again can be reloaded without touching the region files.
+The blobs come from the storage itself, no chunk is ever read back for the cache: the storage keeps the blob that each chunk
+was loaded from or last saved into, and the blob becomes cold once its chunk is unloaded. Only the cold blobs are returned
+for loading, a cold blob is removed when its chunk is loaded again, so that the cold blobs are the data of the chunks not in memory.
+Both kinds of blobs are kept in a LRU order, each kind within its own copy of the budget, so that the blobs of the chunks in memory
+never push out the cold ones. The least recently unloaded cold blobs, and the least recently loaded or saved kept ones, are evicted first.
+Thread-safe. */
+class cColdChunkCache
+{
+public:
+
+	struct sStatistics
+	{
+		size_t m_NumChunks = 0;
+		size_t m_NumBytes = 0;
+		size_t m_NumKeptChunks = 0;
+		size_t m_NumKeptBytes = 0;
+		size_t m_BudgetBytes = 0;
+		UInt64 m_NumHits = 0;
+		UInt64 m_NumMisses = 0;
+
+		/** Number of cold blobs evicted before their chunk was loaded again. */
+		UInt64 m_NumEvictions = 0;
+	};
+
+
+	/** Creates a cache that holds up to a_BudgetBytes of cold blobs and as much of the kept ones; a zero budget disables the cache. */
+	explicit cColdChunkCache(size_t a_BudgetBytes = 0);
+
+	/** Sets the budget, evicting chunks if the cache holds more than the new budget. */
+	void SetBudget(size_t a_BudgetBytes);
+
+	/** Returns true if the cache is allowed to hold any data. */
+	bool IsEnabled(void) const { return m_BudgetBytes != 0; }
+
+	/** Keeps the blob of a chunk that is in memory, the data that the chunk has just been loaded from or saved into.
+	Replaces any previous blob of the chunk, including a cold one, and marks it as the most recently used.
+	The blob isn't returned by Take() until the chunk is unloaded, see ChunkUnloaded(). */
+	void Keep(cChunkCoords a_Chunk, ContiguousByteBufferView a_Data);
+
+	/** Makes the kept blob of the specified chunk cold, the chunk has been unloaded with no changes since its last save.
+	Does nothing if the chunk's blob has been evicted meanwhile. */
+	void ChunkUnloaded(cChunkCoords a_Chunk);
+
+	/** Moves the cold blob for the specified chunk into a_Data and removes it from the cache.
+	Called when the chunk is being loaded; once loaded, the chunk's data is in memory and soon out of date.
+	Returns false if the chunk has no cold blob in the cache. */
+	bool Take(cChunkCoords a_Chunk, ContiguousByteBuffer & a_Data);
+
+	/** Removes the chunk's blob from the cache, if present. */
+	void Remove(cChunkCoords a_Chunk);
+
+	sStatistics GetStatistics(void) const;
+
+protected:
+
+	struct sEntry
+	{
+		cChunkCoords m_Chunk;
+		ContiguousByteBuffer m_Data;
+
+		/** Set once the chunk has been unloaded, the entry is then in m_Cold instead of m_Kept. */
+		bool m_IsCold;
+	};
+
+	using cEntries = std::list<sEntry>;
+
+
+	mutable cCriticalSection m_CS;
+
+	/** The blobs of the unloaded chunks, the most recently unloaded first. */
+	cEntries m_Cold;
+
+	/** The blobs of the chunks in memory, the most recently loaded or saved first. */
+	cEntries m_Kept;
+
+	/** Maps the chunk coords onto their entry, in either m_Cold or m_Kept. */
+	std::unordered_map<cChunkCoords, cEntries::iterator, cChunkCoordsHash> m_Index;
+
+	size_t m_BudgetBytes;
+	size_t m_NumColdBytes;
+	size_t m_NumKeptBytes;
+	UInt64 m_NumHits;
+	UInt64 m_NumMisses;
+	UInt64 m_NumEvictions;
+
+
+	/** Drops the least recently used blobs of each kind until they fit the budget. Expects m_CS to be locked. */
+	void Evict(void);
+};
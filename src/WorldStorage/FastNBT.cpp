@@ -16,6 +16,10 @@
 	#define NBT_RESERVE_SIZE 200
 #endif  // NBT_RESERVE_SIZE
 
+/** The compounds with fewer children are searched linearly even if the children names are indexed,
+the index wouldn't pay off for them. */
+static const size_t MIN_INDEXED_CHILDREN = 8;
+
 #ifdef _MSC_VER
 	// Dodge a C4127 (conditional expression is constant) for this specific macro usage
 	#define PROPAGATE_ERROR(X) do { auto Err = (X); if (Err != eNBTParseError::npSuccess) return Err; } while ((false, false))
@@ -149,6 +153,7 @@ std::error_code make_error_code(eNBTParseError a_Err) noexcept
 
 cParsedNBT::cParsedNBT(const ContiguousByteBufferView a_Data) :
 	m_Data(a_Data),
+	m_IndexChildNames(false),
 	m_Pos(0)
 {
 	m_Error = Parse();
@@ -372,7 +377,7 @@ eNBTParseError cParsedNBT::ReadTag(void)
 
 
 
-int cParsedNBT::FindChildByName(int a_Tag, const char * a_Name, size_t a_NameLength) const
+int cParsedNBT::FindChildByName(int a_Tag, const std::string_view a_Name) const
 {
 	if (a_Tag < 0)
 	{
@@ -383,16 +388,26 @@ int cParsedNBT::FindChildByName(int a_Tag, const char * a_Name, size_t a_NameLen
 		return -1;
 	}
 
-	if (a_NameLength == 0)
+	if (m_IndexChildNames)
 	{
-		a_NameLength = strlen(a_Name);
+		const auto & Index = GetChildIndex(a_Tag);
+		if (!Index.empty())
+		{
+			const auto Mask = Index.size() - 1;
+			for (auto Slot = std::hash<std::string_view>()(a_Name) & Mask; Index[Slot] >= 0; Slot = (Slot + 1) & Mask)
+			{
+				if (GetNameView(Index[Slot]) == a_Name)
+				{
+					return Index[Slot];
+				}
+			}
+			return -1;
+		}
 	}
+
 	for (int Child = m_Tags[static_cast<size_t>(a_Tag)].m_FirstChild; Child != -1; Child = m_Tags[static_cast<size_t>(Child)].m_NextSibling)
 	{
-		if (
-			(m_Tags[static_cast<size_t>(Child)].m_NameLength == a_NameLength) &&
-			(memcmp(m_Data.data() + m_Tags[static_cast<size_t>(Child)].m_NameStart, a_Name, a_NameLength) == 0)
-		)
+		if (GetNameView(Child) == a_Name)
 		{
 			return Child;
 		}
@@ -438,6 +453,57 @@ int cParsedNBT::FindTagByPath(int a_Tag, const AString & a_Path) const
 
 
 
+const std::vector<int> & cParsedNBT::GetChildIndex(int a_Tag) const
+{
+	auto [itr, IsNew] = m_ChildIndices.try_emplace(a_Tag);
+	auto & Index = itr->second;
+	if (!IsNew)
+	{
+		return Index;
+	}
+
+	const auto FirstChild = m_Tags[static_cast<size_t>(a_Tag)].m_FirstChild;
+	size_t NumChildren = 0;
+	for (int Child = FirstChild; Child != -1; Child = m_Tags[static_cast<size_t>(Child)].m_NextSibling)
+	{
+		NumChildren++;
+	}
+	if (NumChildren < MIN_INDEXED_CHILDREN)
+	{
+		// Leave the index empty, the compound will be searched linearly
+		return Index;
+	}
+
+	// Keep the table at most half full, so that the probe sequences stay short:
+	size_t Size = 16;
+	while (Size < NumChildren * 2)
+	{
+		Size *= 2;
+	}
+	Index.assign(Size, -1);
+	const auto Mask = Size - 1;
+	for (int Child = FirstChild; Child != -1; Child = m_Tags[static_cast<size_t>(Child)].m_NextSibling)
+	{
+		const auto Name = GetNameView(Child);
+		auto Slot = std::hash<std::string_view>()(Name) & Mask;
+		while ((Index[Slot] >= 0) && (GetNameView(Index[Slot]) != Name))
+		{
+			Slot = (Slot + 1) & Mask;
+		}
+
+		// Of the children with the same name, keep the first one, same as the linear search:
+		if (Index[Slot] < 0)
+		{
+			Index[Slot] = Child;
+		}
+	}
+	return Index;
+}
+
+
+
+
+
 size_t cParsedNBT::GetMinTagSize(eTagType a_TagType)
 {
 	switch (a_TagType)
@@ -6,6 +6,7 @@
 #include "NBTChunkSerializer.h"
 #include "EnchantmentSerializer.h"
 #include "NamespaceSerializer.h"
+#include "TerrainSerializer.h"
 #include "../ChunkDataCallback.h"
 #include "../ItemGrid.h"
 #include "../StringCompression.h"
@@ -60,8 +61,8 @@ class SerializerCollector final :
 public:
 
 	// The data collected from the chunk:
-	UInt8 Biomes[cChunkDef::Width * cChunkDef::Width];
-	int Heights[cChunkDef::Width * cChunkDef::Width];
+	cChunkDef::BiomeMap Biomes;
+	cChunkDef::HeightMap Heights;
 
 	/** True if a tag has been opened in the callbacks and not yet closed. */
 	bool mIsTagOpen;
@@ -106,13 +107,7 @@ public:
 
 	virtual void HeightMap(const cChunkDef::HeightMap & a_HeightMap) override
 	{
-		for (int RelZ = 0; RelZ < cChunkDef::Width; RelZ++)
-		{
-			for (int RelX = 0; RelX < cChunkDef::Width; RelX++)
-			{
-				Heights[RelX + RelZ * cChunkDef::Width] = cChunkDef::GetHeight(a_HeightMap, RelX, RelZ);
-			}
-		}
+		std::copy(std::begin(a_HeightMap), std::end(a_HeightMap), std::begin(Heights));
 	}
 
 
@@ -121,20 +116,7 @@ public:
 
 	virtual void BiomeMap(const cChunkDef::BiomeMap & a_BiomeMap) override
 	{
-		for (size_t i = 0; i < ARRAYCOUNT(Biomes); i++)
-		{
-			if (a_BiomeMap[i] < 255)
-			{
-				// Normal MC biome, copy as-is:
-				Biomes[i] = static_cast<Byte>(a_BiomeMap[i]);
-			}
-			else
-			{
-				// TODO: MCS-specific biome, need to map to some basic MC biome:
-				ASSERT(!"Unimplemented MCS-specific biome");
-				return;
-			}
-		}  // for i - mBiomeMap[]
+		std::copy(std::begin(a_BiomeMap), std::end(a_BiomeMap), std::begin(Biomes));
 	}
 
 
@@ -1200,57 +1182,13 @@ void NBTChunkSerializer::Serialize(const cWorld & aWorld, cChunkCoords aCoords,
 	serializer.Finish();  // Close NBT tags
 
 	// Save biomes:
-	aWriter.AddByteArray("Biomes", reinterpret_cast<const char *>(serializer.Biomes), ARRAYCOUNT(serializer.Biomes));
+	TerrainSerializer::WriteBiomes(serializer.Biomes, aWriter);
 
 	// Save heightmap (Vanilla require this):
-	aWriter.AddIntArray("HeightMap", reinterpret_cast<const int *>(serializer.Heights), ARRAYCOUNT(serializer.Heights));
+	TerrainSerializer::WriteHeightMap(serializer.Heights, aWriter);
 
 	// Save blockdata:
-	aWriter.BeginList("Sections", TAG_Compound);
-	ChunkDef_ForEachSection(serializer.m_BlockData, serializer.m_LightData,
-	{
-		aWriter.BeginCompound("");
-
-		if (Blocks != nullptr)
-		{
-			aWriter.AddByteArray("Blocks", reinterpret_cast<const char *>(Blocks->data()), Blocks->size());
-		}
-		else
-		{
-			aWriter.AddByteArray("Blocks", ChunkBlockData::SectionBlockCount, ChunkBlockData::DefaultValue);
-		}
-
-		if (Metas != nullptr)
-		{
-			aWriter.AddByteArray("Data", reinterpret_cast<const char *>(Metas->data()), Metas->size());
-		}
-		else
-		{
-			aWriter.AddByteArray("Data", ChunkBlockData::SectionMetaCount, ChunkBlockData::DefaultMetaValue);
-		}
-
-		if (BlockLights != nullptr)
-		{
-			aWriter.AddByteArray("BlockLight", reinterpret_cast<const char *>(BlockLights->data()), BlockLights->size());
-		}
-		else
-		{
-			aWriter.AddByteArray("BlockLight", ChunkLightData::SectionLightCount, ChunkLightData::DefaultBlockLightValue);
-		}
-
-		if (SkyLights != nullptr)
-		{
-			aWriter.AddByteArray("SkyLight", reinterpret_cast<const char *>(SkyLights->data()), SkyLights->size());
-		}
-		else
-		{
-			aWriter.AddByteArray("SkyLight", ChunkLightData::SectionLightCount, ChunkLightData::DefaultSkyLightValue);
-		}
-
-		aWriter.AddByte("Y", static_cast<unsigned char>(Y));
-		aWriter.EndCompound();
-	});
-	aWriter.EndList();  // "Sections"
+	TerrainSerializer::WriteSections(serializer.m_BlockData, serializer.m_LightData, aWriter);
 
 	// Store the information that the lighting is valid.
 	// For compatibility reason, the default is "invalid" (missing) - this means older data is re-lighted upon loading.
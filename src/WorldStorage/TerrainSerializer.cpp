@@ -0,0 +1,104 @@
+
+// TerrainSerializer.cpp
+
+#include "Globals.h"
+#include "TerrainSerializer.h"
+#include "FastNBT.h"
+#include "../ChunkData.h"
+
+
+
+
+
+void TerrainSerializer::WriteBiomes(const cChunkDef::BiomeMap & a_BiomeMap, cFastNBTWriter & a_Writer)
+{
+	UInt8 Biomes[cChunkDef::Width * cChunkDef::Width] = {};
+	for (size_t i = 0; i < ARRAYCOUNT(Biomes); i++)
+	{
+		if (a_BiomeMap[i] < 255)
+		{
+			// Normal MC biome, copy as-is:
+			Biomes[i] = static_cast<Byte>(a_BiomeMap[i]);
+		}
+		else
+		{
+			// TODO: MCS-specific biome, need to map to some basic MC biome:
+			ASSERT(!"Unimplemented MCS-specific biome");
+			break;
+		}
+	}  // for i - a_BiomeMap[]
+	a_Writer.AddByteArray("Biomes", reinterpret_cast<const char *>(Biomes), ARRAYCOUNT(Biomes));
+}
+
+
+
+
+
+void TerrainSerializer::WriteHeightMap(const cChunkDef::HeightMap & a_HeightMap, cFastNBTWriter & a_Writer)
+{
+	int Heights[cChunkDef::Width * cChunkDef::Width];
+	for (int RelZ = 0; RelZ < cChunkDef::Width; RelZ++)
+	{
+		for (int RelX = 0; RelX < cChunkDef::Width; RelX++)
+		{
+			Heights[RelX + RelZ * cChunkDef::Width] = cChunkDef::GetHeight(a_HeightMap, RelX, RelZ);
+		}
+	}
+	a_Writer.AddIntArray("HeightMap", Heights, ARRAYCOUNT(Heights));
+}
+
+
+
+
+
+void TerrainSerializer::WriteSections(const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, cFastNBTWriter & a_Writer)
+{
+	a_Writer.BeginList("Sections", TAG_Compound);
+	ChunkDef_ForEachSection(a_BlockData, a_LightData,
+	{
+		a_Writer.BeginCompound("");
+
+		// Uniform sections are written straight from their fill value, without expanding them:
+		if (Blocks != nullptr)
+		{
+			ChunkBlockData::SectionType BlockTypes;
+			Blocks->CopyTo(BlockTypes);
+			a_Writer.AddByteArray("Blocks", reinterpret_cast<const char *>(BlockTypes), ARRAYCOUNT(BlockTypes));
+		}
+		else
+		{
+			a_Writer.AddByteArray("Blocks", ChunkBlockData::SectionBlockCount, a_BlockData.GetSectionFill(Y));
+		}
+
+		if (Metas != nullptr)
+		{
+			a_Writer.AddByteArray("Data", reinterpret_cast<const char *>(Metas->data()), Metas->size());
+		}
+		else
+		{
+			a_Writer.AddByteArray("Data", ChunkBlockData::SectionMetaCount, a_BlockData.GetMetaSectionFill(Y));
+		}
+
+		if (BlockLights != nullptr)
+		{
+			a_Writer.AddByteArray("BlockLight", reinterpret_cast<const char *>(BlockLights->data()), BlockLights->size());
+		}
+		else
+		{
+			a_Writer.AddByteArray("BlockLight", ChunkLightData::SectionLightCount, a_LightData.GetBlockLightSectionFill(Y));
+		}
+
+		if (SkyLights != nullptr)
+		{
+			a_Writer.AddByteArray("SkyLight", reinterpret_cast<const char *>(SkyLights->data()), SkyLights->size());
+		}
+		else
+		{
+			a_Writer.AddByteArray("SkyLight", ChunkLightData::SectionLightCount, a_LightData.GetSkyLightSectionFill(Y));
+		}
+
+		a_Writer.AddByte("Y", static_cast<unsigned char>(Y));
+		a_Writer.EndCompound();
+	});
+	a_Writer.EndList();  // "Sections"
+}
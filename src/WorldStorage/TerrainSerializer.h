@@ -0,0 +1,31 @@
+
+// TerrainSerializer.h
+
+// Writes the chunk's terrain (biomes, heightmap and block sections) into NBT in the Anvil format
+// Kept apart from NBTChunkSerializer so that tools can serialize the terrain without linking in the entities
+
+#pragma once
+
+#include "../ChunkDef.h"
+
+class ChunkBlockData;
+class ChunkLightData;
+class cFastNBTWriter;
+
+
+
+
+
+namespace TerrainSerializer
+{
+
+	/** Writes the "Biomes" byte array tag. */
+	void WriteBiomes(const cChunkDef::BiomeMap & a_BiomeMap, cFastNBTWriter & a_Writer);
+
+	/** Writes the "HeightMap" int array tag, required by Vanilla. */
+	void WriteHeightMap(const cChunkDef::HeightMap & a_HeightMap, cFastNBTWriter & a_Writer);
+
+	/** Writes the "Sections" list tag with the blocktypes, metas and lighting of each non-empty section. */
+	void WriteSections(const ChunkBlockData & a_BlockData, const ChunkLightData & a_LightData, cFastNBTWriter & a_Writer);
+
+};
@@ -68,10 +68,45 @@ thus making skylight visible in Minutor's Lighting mode
 */
 // #define DEBUG_SKYLIGHT
 
-/** Maximum number of MCA files that are cached in memory.
-Since only the header is actually in the memory, this number can be high, but still, each file means an OS FS handle.
-*/
-#define MAX_MCA_FILES 32
+
+
+
+
+/** Returns the region file sync policy named in world.ini, warns and returns None for an unknown name. */
+static cAnvilRegionFiles::eSyncPolicy ParseSyncPolicy(const cWorld & a_World, const AString & a_SyncPolicy)
+{
+	if (NoCaseCompare(a_SyncPolicy, "PerFlush") == 0)
+	{
+		return cAnvilRegionFiles::eSyncPolicy::PerFlush;
+	}
+	if (NoCaseCompare(a_SyncPolicy, "PerRegion") == 0)
+	{
+		return cAnvilRegionFiles::eSyncPolicy::PerRegion;
+	}
+	if (NoCaseCompare(a_SyncPolicy, "None") != 0)
+	{
+		LOGWARNING("World \"%s\": Unknown sync policy \"%s\", using \"None\" instead.", a_World.GetName(), a_SyncPolicy);
+	}
+	return cAnvilRegionFiles::eSyncPolicy::None;
+}
+
+
+
+
+
+/** Returns true if the region backend named in world.ini is MemoryMapped, warns about an unknown name. */
+static bool ParseUseMemoryMap(const cWorld & a_World, const AString & a_RegionBackend)
+{
+	if (NoCaseCompare(a_RegionBackend, "MemoryMapped") == 0)
+	{
+		return true;
+	}
+	if (NoCaseCompare(a_RegionBackend, "File") != 0)
+	{
+		LOGWARNING("World \"%s\": Unknown region backend \"%s\", using \"File\" instead.", a_World.GetName(), a_RegionBackend);
+	}
+	return false;
+}
 
 
 
@@ -80,9 +115,21 @@ Since only the header is actually in the memory, this number can be high, but st
 ////////////////////////////////////////////////////////////////////////////////
 // cWSSAnvil:
 
-cWSSAnvil::cWSSAnvil(cWorld * a_World, int a_CompressionFactor):
+cWSSAnvil::cWSSAnvil(cWorld * a_World, const cWorldStorage::sSettings & a_Settings, cColdChunkCache & a_ColdChunkCache):
 	Super(a_World),
-	m_Compressor(a_CompressionFactor)
+	m_CompressionFactor(a_Settings.m_CompressionFactor),
+	m_ColdChunkCache(a_ColdChunkCache),
+	m_RegionFiles(
+		fmt::format(FMT_STRING("{}{}region"), a_World->GetDataPath(), cFile::PathSeparator()),
+		a_Settings.m_MaxOpenRegionFiles,
+		a_Settings.m_FlushIntervalMSec,
+		ParseSyncPolicy(*a_World, a_Settings.m_SyncPolicy),
+		ParseUseMemoryMap(*a_World, a_Settings.m_RegionBackend),
+		[this](const cChunkCoords & a_Chunk, const AString & a_Reason, const ContiguousByteBufferView a_ChunkData)
+		{
+			ChunkLoadFailed(a_Chunk, a_Reason, a_ChunkData);
+		}
+	)
 {
 	// Create a level.dat file for mapping tools, if it doesn't already exist:
 	auto fnam = fmt::format(FMT_STRING("{}{}level.dat"), a_World->GetDataPath(), cFile::PathSeparator());
@@ -120,26 +167,37 @@ cWSSAnvil::cWSSAnvil(cWorld * a_World, int a_CompressionFactor):
 
 
 
-cWSSAnvil::~cWSSAnvil()
+cWSSchema::cChunkDecoder cWSSAnvil::ReadChunk(const cChunkCoords & a_Chunk)
 {
-	cCSLock Lock(m_CS);
-	m_Files.clear();
-}
-
-
-
+	cAnvilRegionFiles::sChunkData ChunkData;
 
+	// A chunk that was unloaded recently is still in memory, skip the MCA file.
+	// Keep the blob while the chunk is loaded; the chunk isn't valid yet, so no save can have replaced the blob meanwhile:
+	if (m_ColdChunkCache.IsEnabled() && m_ColdChunkCache.Take(a_Chunk, ChunkData.m_Buffer))
+	{
+		m_ColdChunkCache.Keep(a_Chunk, ChunkData.m_Buffer);
+		return [this, a_Chunk, ChunkData = std::move(ChunkData)]()
+		{
+			return LoadChunkFromData(a_Chunk, ChunkData.m_Buffer);
+		};
+	}
 
-bool cWSSAnvil::LoadChunk(const cChunkCoords & a_Chunk)
-{
-	ContiguousByteBuffer ChunkData;
-	if (!GetChunkData(a_Chunk, ChunkData))
+	if (!m_RegionFiles.GetChunkData(a_Chunk, ChunkData))
 	{
 		// The reason for failure is already printed in GetChunkData()
-		return false;
+		return {};
 	}
 
-	return LoadChunkFromData(a_Chunk, ChunkData);
+	// Keep the blob here rather than in the decoder, a saver thread may store newer data once the decoder hands the chunk over:
+	if (m_ColdChunkCache.IsEnabled())
+	{
+		m_ColdChunkCache.Keep(a_Chunk, ChunkData.GetView());
+	}
+	return [this, a_Chunk, ChunkData = std::move(ChunkData)]()
+	{
+		// With the MemoryMapped backend, the data is decompressed straight from the mapped file:
+		return LoadChunkFromData(a_Chunk, ChunkData.GetView());
+	};
 }
 
 
@@ -150,15 +208,24 @@ bool cWSSAnvil::SaveChunk(const cChunkCoords & a_Chunk)
 {
 	try
 	{
-		if (!SetChunkData(a_Chunk, SaveChunkToData(a_Chunk).GetView()))
+		const auto Data = SaveChunkToData(a_Chunk);
+		if (!m_RegionFiles.SetChunkData(a_Chunk, Data.GetView()))
 		{
 			LOGWARNING("Cannot store chunk [%d, %d] data", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
+			m_ColdChunkCache.Remove(a_Chunk);
 			return false;
 		}
+
+		// Keep the compressed data, it becomes the chunk's cold blob if the chunk is unloaded before its next save:
+		if (m_ColdChunkCache.IsEnabled())
+		{
+			m_ColdChunkCache.Keep(a_Chunk, Data.GetView());
+		}
 	}
 	catch (const std::exception & Oops)
 	{
 		LOGWARNING("Cannot serialize chunk [%d, %d] into data: %s", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, Oops.what());
+		m_ColdChunkCache.Remove(a_Chunk);
 		return false;
 	}
 
@@ -170,6 +237,43 @@ bool cWSSAnvil::SaveChunk(const cChunkCoords & a_Chunk)
 
 
 
+void cWSSAnvil::Flush(void)
+{
+	m_RegionFiles.Flush();
+}
+
+
+
+
+
+void cWSSAnvil::ChunkUnloaded(const cChunkCoords & a_Chunk)
+{
+	// The chunk's blob was kept by its last save or its load, both of which have already run:
+	m_ColdChunkCache.ChunkUnloaded(a_Chunk);
+}
+
+
+
+
+
+cWSSchema::sWriteStatistics cWSSAnvil::GetWriteStatistics(void) const
+{
+	return m_RegionFiles.GetWriteStatistics();
+}
+
+
+
+
+
+cWSSchema::sFileCacheStatistics cWSSAnvil::GetFileCacheStatistics(void) const
+{
+	return m_RegionFiles.GetFileCacheStatistics();
+}
+
+
+
+
+
 void cWSSAnvil::ChunkLoadFailed(const cChunkCoords a_ChunkCoords, const AString & a_Reason, const ContiguousByteBufferView a_ChunkDataToSave)
 {
 	// Construct the filename for offloading:
@@ -221,94 +325,17 @@ void cWSSAnvil::ChunkLoadFailed(const cChunkCoords a_ChunkCoords, const AString
 
 
 
-bool cWSSAnvil::GetChunkData(const cChunkCoords & a_Chunk, ContiguousByteBuffer & a_Data)
-{
-	cCSLock Lock(m_CS);
-	auto File = LoadMCAFile(a_Chunk);
-	if (File == nullptr)
-	{
-		return false;
-	}
-	return File->GetChunkData(a_Chunk, a_Data);
-}
-
-
-
-
-
-bool cWSSAnvil::SetChunkData(const cChunkCoords & a_Chunk, const ContiguousByteBufferView a_Data)
-{
-	cCSLock Lock(m_CS);
-	auto File = LoadMCAFile(a_Chunk);
-	if (File == nullptr)
-	{
-		return false;
-	}
-	return File->SetChunkData(a_Chunk, a_Data);
-}
-
-
-
-
-
-std::shared_ptr<cWSSAnvil::cMCAFile> cWSSAnvil::LoadMCAFile(const cChunkCoords & a_Chunk)
-{
-	// ASSUME m_CS is locked
-	ASSERT(m_CS.IsLocked());
-
-	const int RegionX = FAST_FLOOR_DIV(a_Chunk.m_ChunkX, 32);
-	const int RegionZ = FAST_FLOOR_DIV(a_Chunk.m_ChunkZ, 32);
-	ASSERT(a_Chunk.m_ChunkX - RegionX * 32 >= 0);
-	ASSERT(a_Chunk.m_ChunkZ - RegionZ * 32 >= 0);
-	ASSERT(a_Chunk.m_ChunkX - RegionX * 32 < 32);
-	ASSERT(a_Chunk.m_ChunkZ - RegionZ * 32 < 32);
-
-	// Is it already cached?
-	for (auto itr = m_Files.begin(); itr != m_Files.end(); ++itr)
-	{
-		if (((*itr) != nullptr) && ((*itr)->GetRegionX() == RegionX) && ((*itr)->GetRegionZ() == RegionZ))
-		{
-			// Move the file to front and return it:
-			auto f = *itr;
-			if (itr != m_Files.begin())
-			{
-				m_Files.erase(itr);
-				m_Files.push_front(f);
-			}
-			return f;
-		}
-	}
-
-	// Load it anew:
-	auto FileName = fmt::format(FMT_STRING("{}{}region"), m_World->GetDataPath(), cFile::PathSeparator());
-	cFile::CreateFolder(FileName);
-	FileName.append(fmt::format(FMT_STRING("/r.{}.{}.mca"), RegionX, RegionZ));
-	auto f = std::make_shared<cMCAFile>(*this, FileName, RegionX, RegionZ);
-	if (f == nullptr)
-	{
-		return nullptr;
-	}
-	m_Files.push_front(f);
-
-	// If there are too many MCA files cached, delete the last one used:
-	if (m_Files.size() > MAX_MCA_FILES)
-	{
-		m_Files.pop_back();
-	}
-	return f;
-}
-
-
-
-
-
 bool cWSSAnvil::LoadChunkFromData(const cChunkCoords & a_Chunk, const ContiguousByteBufferView a_Data)
 {
 	try
 	{
-		const auto Extracted = m_Extractor.ExtractZLib(a_Data);
+		thread_local Compression::Extractor Extractor;
+		const auto Extracted = Extractor.ExtractZLib(a_Data);
 		cParsedNBT NBT(Extracted.GetView());
 
+		// The chunk loading looks up many names in the large compounds, such as Level, have them indexed:
+		NBT.SetIndexChildNames(true);
+
 		if (!NBT.IsValid())
 		{
 			// NBT Parsing failed:
@@ -335,7 +362,8 @@ Compression::Result cWSSAnvil::SaveChunkToData(const cChunkCoords & a_Chunk)
 	NBTChunkSerializer::Serialize(*m_World, a_Chunk, Writer);
 	Writer.Finish();
 
-	return m_Compressor.CompressZLib(Writer.GetResult());
+	thread_local Compression::Compressor Compressor(m_CompressionFactor);
+	return Compressor.CompressZLib(Writer.GetResult());
 }
 
 
@@ -369,7 +397,12 @@ bool cWSSAnvil::LoadChunkFromNBT(const cChunkCoords & a_Chunk, const cParsedNBT
 	}
 	for (int Child = a_NBT.GetFirstChild(Sections); Child >= 0; Child = a_NBT.GetNextSibling(Child))
 	{
-		const int SectionYTag = a_NBT.FindChildByName(Child, "Y");
+		// Find all the section's tags in a single pass over its children:
+		static const std::string_view SectionTagNames[] = { "Y", "Blocks", "Data", "BlockLight", "SkyLight" };
+		int SectionTags[std::size(SectionTagNames)];
+		a_NBT.FindChildrenByName(Child, SectionTagNames, SectionTags);
+
+		const int SectionYTag = SectionTags[0];
 		if ((SectionYTag < 0) || (a_NBT.GetType(SectionYTag) != TAG_Byte))
 		{
 			ChunkLoadFailed(a_Chunk, "NBT tag missing or has wrong: Y", a_RawChunkData);
@@ -384,10 +417,10 @@ bool cWSSAnvil::LoadChunkFromNBT(const cChunkCoords & a_Chunk, const cParsedNBT
 		}
 
 		const auto
-			BlockData = GetSectionData(a_NBT, Child, "Blocks", ChunkBlockData::SectionBlockCount),
-			MetaData = GetSectionData(a_NBT, Child, "Data", ChunkBlockData::SectionMetaCount),
-			BlockLightData = GetSectionData(a_NBT, Child, "BlockLight", ChunkLightData::SectionLightCount),
-			SkyLightData = GetSectionData(a_NBT, Child, "SkyLight", ChunkLightData::SectionLightCount);
+			BlockData = GetSectionData(a_NBT, SectionTags[1], ChunkBlockData::SectionBlockCount),
+			MetaData = GetSectionData(a_NBT, SectionTags[2], ChunkBlockData::SectionMetaCount),
+			BlockLightData = GetSectionData(a_NBT, SectionTags[3], ChunkLightData::SectionLightCount),
+			SkyLightData = GetSectionData(a_NBT, SectionTags[4], ChunkLightData::SectionLightCount);
 		if ((BlockData != nullptr) && (MetaData != nullptr) && (SkyLightData != nullptr) && (BlockLightData != nullptr))
 		{
 			Data.BlockData.SetSection(*reinterpret_cast<const ChunkBlockData::SectionType *>(BlockData), *reinterpret_cast<const ChunkBlockData::SectionMetaType *>(MetaData), static_cast<size_t>(Y));
@@ -3872,274 +3905,11 @@ bool cWSSAnvil::GetBlockEntityNBTPos(const cParsedNBT & a_NBT, int a_TagIdx, Vec
 
 
 
-////////////////////////////////////////////////////////////////////////////////
-// cWSSAnvil::cMCAFile:
-
-cWSSAnvil::cMCAFile::cMCAFile(cWSSAnvil & a_ParentSchema, const AString & a_FileName, int a_RegionX, int a_RegionZ) :
-	m_ParentSchema(a_ParentSchema),
-	m_RegionX(a_RegionX),
-	m_RegionZ(a_RegionZ),
-	m_FileName(a_FileName)
-{
-}
-
-
-
-
-
-bool cWSSAnvil::cMCAFile::OpenFile(bool a_IsForReading)
+const std::byte * cWSSAnvil::GetSectionData(const cParsedNBT & a_NBT, int a_Tag, size_t a_Length)
 {
-	bool writeOutNeeded = false;
-
-	if (m_File.IsOpen())
+	if ((a_Tag >= 0) && (a_NBT.GetType(a_Tag) == TAG_ByteArray) && (a_NBT.GetDataLength(a_Tag) == a_Length))
 	{
-		// Already open
-		return true;
-	}
-
-	if (a_IsForReading)
-	{
-		if (!cFile::Exists(m_FileName))
-		{
-			// We want to read and the file doesn't exist. Fail.
-			return false;
-		}
-	}
-
-	if (!m_File.Open(m_FileName, cFile::fmReadWrite))
-	{
-		// The file failed to open
-		return false;
-	}
-
-	// Load the header:
-	if (m_File.Read(m_Header, sizeof(m_Header)) != sizeof(m_Header))
-	{
-		// Cannot read the header - perhaps the file has just been created?
-		// Try writing a nullptr header for chunk offsets:
-		memset(m_Header, 0, sizeof(m_Header));
-		writeOutNeeded = true;
-	}
-
-	// Load the TimeStamps:
-	if (m_File.Read(m_TimeStamps, sizeof(m_TimeStamps)) != sizeof(m_TimeStamps))
-	{
-		// Cannot read the time stamps - perhaps the file has just been created?
-		// Try writing a nullptr header for timestamps:
-		memset(m_TimeStamps, 0, sizeof(m_TimeStamps));
-		writeOutNeeded = true;
-	}
-
-	if (writeOutNeeded)
-	{
-		m_File.Seek(0);
-		if (
-			(m_File.Write(m_Header, sizeof(m_Header)) != sizeof(m_Header)) ||           // Write chunk offsets
-			(m_File.Write(m_TimeStamps, sizeof(m_TimeStamps)) != sizeof(m_TimeStamps))  // Write chunk timestamps
-		)
-		{
-			LOGWARNING("Cannot process MCA header in file \"%s\", chunks in that file will be lost", m_FileName.c_str());
-			m_File.Close();
-			return false;
-		}
-	}
-	return true;
-}
-
-
-
-
-
-bool cWSSAnvil::cMCAFile::GetChunkData(const cChunkCoords & a_Chunk, ContiguousByteBuffer & a_Data)
-{
-	if (!OpenFile(true))
-	{
-		return false;
-	}
-
-	int LocalX = a_Chunk.m_ChunkX % 32;
-	if (LocalX < 0)
-	{
-		LocalX = 32 + LocalX;
-	}
-	int LocalZ = a_Chunk.m_ChunkZ % 32;
-	if (LocalZ < 0)
-	{
-		LocalZ = 32 + LocalZ;
-	}
-	unsigned ChunkLocation = ntohl(m_Header[LocalX + 32 * LocalZ]);
-	unsigned ChunkOffset = ChunkLocation >> 8;
-	if (ChunkOffset < 2)
-	{
-		return false;
-	}
-
-	m_File.Seek(static_cast<int>(ChunkOffset * 4096));
-
-	UInt32 ChunkSize = 0;
-	if (m_File.Read(&ChunkSize, 4) != 4)
-	{
-		m_ParentSchema.ChunkLoadFailed(a_Chunk, "Cannot read chunk size", {});
-		return false;
-	}
-	ChunkSize = ntohl(ChunkSize);
-	if (ChunkSize < 1)
-	{
-		// Chunk size too small
-		m_ParentSchema.ChunkLoadFailed(a_Chunk, "Chunk size too small", {});
-		return false;
-	}
-
-	char CompressionType = 0;
-	if (m_File.Read(&CompressionType, 1) != 1)
-	{
-		m_ParentSchema.ChunkLoadFailed(a_Chunk, "Cannot read chunk compression", {});
-		return false;
-	}
-	ChunkSize--;
-
-	a_Data = m_File.Read(ChunkSize);
-	if (a_Data.size() != ChunkSize)
-	{
-		m_ParentSchema.ChunkLoadFailed(a_Chunk, "Cannot read entire chunk data", a_Data);
-		return false;
-	}
-
-	if (CompressionType != 2)
-	{
-		// Chunk is in an unknown compression
-		m_ParentSchema.ChunkLoadFailed(a_Chunk, fmt::format(FMT_STRING("Unknown chunk compression: {}"), CompressionType), a_Data);
-		return false;
-	}
-	return true;
-}
-
-
-
-
-
-const std::byte * cWSSAnvil::GetSectionData(const cParsedNBT & a_NBT, int a_Tag, const AString & a_ChildName, size_t a_Length)
-{
-	int Child = a_NBT.FindChildByName(a_Tag, a_ChildName);
-	if ((Child >= 0) && (a_NBT.GetType(Child) == TAG_ByteArray) && (a_NBT.GetDataLength(Child) == a_Length))
-	{
-		return a_NBT.GetData(Child);
+		return a_NBT.GetData(a_Tag);
 	}
 	return nullptr;
 }
-
-
-
-
-
-bool cWSSAnvil::cMCAFile::SetChunkData(const cChunkCoords & a_Chunk, const ContiguousByteBufferView a_Data)
-{
-	if (!OpenFile(false))
-	{
-		LOGWARNING("Cannot save chunk [%d, %d], opening file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
-		return false;
-	}
-
-	int LocalX = a_Chunk.m_ChunkX % 32;
-	if (LocalX < 0)
-	{
-		LocalX = 32 + LocalX;
-	}
-	int LocalZ = a_Chunk.m_ChunkZ % 32;
-	if (LocalZ < 0)
-	{
-		LocalZ = 32 + LocalZ;
-	}
-
-	unsigned ChunkSector = FindFreeLocation(LocalX, LocalZ, a_Data.size());
-
-	// Store the chunk data:
-	m_File.Seek(static_cast<int>(ChunkSector * 4096));
-	UInt32 ChunkSize = htonl(static_cast<UInt32>(a_Data.size() + 1));
-	if (m_File.Write(&ChunkSize, 4) != 4)
-	{
-		LOGWARNING("Cannot save chunk [%d, %d], writing(1) data to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
-		return false;
-	}
-	char CompressionType = 2;
-	if (m_File.Write(&CompressionType, 1) != 1)
-	{
-		LOGWARNING("Cannot save chunk [%d, %d], writing(2) data to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
-		return false;
-	}
-	if (m_File.Write(a_Data.data(), a_Data.size()) != static_cast<int>(a_Data.size()))
-	{
-		LOGWARNING("Cannot save chunk [%d, %d], writing(3) data to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
-		return false;
-	}
-
-	// Add padding to 4K boundary:
-	size_t BytesWritten = a_Data.size() + MCA_CHUNK_HEADER_LENGTH;
-	if (BytesWritten % 4096 != 0)
-	{
-		static const char Padding[4095] = {0};
-		m_File.Write(Padding, 4096 - (BytesWritten % 4096));
-	}
-
-	// Store the header:
-	ChunkSize = (static_cast<UInt32>(a_Data.size()) + MCA_CHUNK_HEADER_LENGTH + 4095) / 4096;  // Round data size up to nearest 4KB sector, make it a sector number
-	if (ChunkSize > 255)
-	{
-		LOGWARNING("Cannot save chunk [%d, %d], the data is too large (%u KiB, maximum is 1024 KiB). Remove some entities and retry.",
-			a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, static_cast<unsigned>(ChunkSize * 4)
-		);
-		return false;
-	}
-
-	// Store the header info in the table
-	m_Header[LocalX + 32 * LocalZ] = htonl(static_cast<UInt32>((ChunkSector << 8) | ChunkSize));
-
-	// Set the modification time
-	m_TimeStamps[LocalX + 32 * LocalZ] =  htonl(static_cast<UInt32>(time(nullptr)));
-
-	if (m_File.Seek(0) < 0)
-	{
-		LOGWARNING("Cannot save chunk [%d, %d], seeking in file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
-		return false;
-	}
-	if (m_File.Write(m_Header, sizeof(m_Header)) != sizeof(m_Header))
-	{
-		LOGWARNING("Cannot save chunk [%d, %d], writing header to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
-		return false;
-	}
-	if (m_File.Write(m_TimeStamps, sizeof(m_TimeStamps)) != sizeof(m_TimeStamps))
-	{
-		LOGWARNING("Cannot save chunk [%d, %d], writing timestamps to file \"%s\" failed", a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ, GetFileName().c_str());
-		return false;
-	}
-
-	return true;
-}
-
-
-
-
-
-unsigned cWSSAnvil::cMCAFile::FindFreeLocation(int a_LocalX, int a_LocalZ, const size_t a_DataSize)
-{
-	// See if it fits the current location:
-	unsigned ChunkLocation = ntohl(m_Header[a_LocalX + 32 * a_LocalZ]);
-	unsigned ChunkLen = ChunkLocation & 0xff;
-	if (a_DataSize + MCA_CHUNK_HEADER_LENGTH <= (ChunkLen * 4096))
-	{
-		return ChunkLocation >> 8;
-	}
-
-	// Doesn't fit, append to the end of file (we're wasting a lot of space, TODO: fix this later)
-	unsigned MaxLocation = 2 << 8;  // Minimum sector is #2 - after the headers
-	for (size_t i = 0; i < ARRAYCOUNT(m_Header); i++)
-	{
-		ChunkLocation = ntohl(m_Header[i]);
-		ChunkLocation = ChunkLocation + ((ChunkLocation & 0xff) << 8);  // Add the number of sectors used; don't care about the 4th byte
-		if (MaxLocation < ChunkLocation)
-		{
-			MaxLocation = ChunkLocation;
-		}
-	}  // for i - m_Header[]
-	return MaxLocation >> 8;
-}
@@ -4,6 +4,7 @@
 #include "WorldStorage.h"
 #include "FastNBT.h"
 #include "StringCompression.h"
+#include "AnvilRegionFiles.h"
 
 
 
@@ -30,81 +31,25 @@ class cWSSAnvil:
 
 public:
 
-	cWSSAnvil(cWorld * a_World, int a_CompressionFactor);
-	virtual ~cWSSAnvil() override;
+	/** Creates the schema for the specified world.
+	The settings select the compression, how the chunks are read from the region files and how the saved chunks are written. */
+	cWSSAnvil(cWorld * a_World, const cWorldStorage::sSettings & a_Settings, cColdChunkCache & a_ColdChunkCache);
 
 protected:
 
-	enum
-	{
-		/** Maximum number of chunks in an MCA file - also the count of the header items */
-		MCA_MAX_CHUNKS = 32 * 32,
+	/** The zlib compression level used for saving.
+	The compressors and extractors are per-thread, the chunks are loaded and saved by several threads at once. */
+	int m_CompressionFactor;
 
-		/** The MCA header is 8 KiB */
-		MCA_HEADER_SIZE = MCA_MAX_CHUNKS * 8,
-
-		/** There are 5 bytes of header in front of each chunk */
-		MCA_CHUNK_HEADER_LENGTH = 5,
-	} ;
-
-
-	class cMCAFile
-	{
-	public:
-
-		cMCAFile(cWSSAnvil & a_ParentSchema, const AString & a_FileName, int a_RegionX, int a_RegionZ);
-
-		bool GetChunkData  (const cChunkCoords & a_Chunk, ContiguousByteBuffer & a_Data);
-		bool SetChunkData  (const cChunkCoords & a_Chunk, ContiguousByteBufferView a_Data);
-
-		int             GetRegionX () const {return m_RegionX; }
-		int             GetRegionZ () const {return m_RegionZ; }
-		const AString & GetFileName() const {return m_FileName; }
-
-	protected:
-
-		cWSSAnvil & m_ParentSchema;
-
-		int     m_RegionX;
-		int     m_RegionZ;
-		cFile   m_File;
-		AString m_FileName;
-
-		// The header, copied from the file so we don't have to seek to it all the time
-		// First 1024 entries are chunk locations - the 3 + 1 byte sector-offset and sector-count
-		unsigned m_Header[MCA_MAX_CHUNKS];
-
-		// Chunk timestamps, following the chunk headers
-		unsigned m_TimeStamps[MCA_MAX_CHUNKS];
-
-		/** Finds a free location large enough to hold a_Data. Returns the sector number. */
-		unsigned FindFreeLocation(int a_LocalX, int a_LocalZ, size_t a_DataSize);
-
-		/** Opens a MCA file either for a Read operation (fails if doesn't exist) or for a Write operation (creates new if not found) */
-		bool OpenFile(bool a_IsForReading);
-	} ;
-
-	/** Protects m_Files against multithreaded access. */
-	cCriticalSection m_CS;
-
-	/** A MRU cache of MCA files.
-	Protected against multithreaded access by m_CS. */
-	std::list<std::shared_ptr<cMCAFile>> m_Files;
-
-	Compression::Extractor m_Extractor;
-	Compression::Compressor m_Compressor;
+	/** The compressed data of the recently loaded, saved and unloaded chunks, kept so that reloading them doesn't need to read the MCA files. */
+	cColdChunkCache & m_ColdChunkCache;
 
 	/** Reports that the specified chunk failed to load and saves the chunk data to an external file. */
 	void ChunkLoadFailed(const cChunkCoords a_ChunkCoords, const AString & a_Reason, ContiguousByteBufferView a_ChunkDataToSave);
 
-	/** Gets chunk data from the correct file; locks file CS as needed */
-	bool GetChunkData(const cChunkCoords & a_Chunk, ContiguousByteBuffer & a_Data);
-
-	/** Copies a_Length bytes of data from the specified NBT Tag's Child into the a_Destination buffer */
-	const std::byte * GetSectionData(const cParsedNBT & a_NBT, int a_Tag, const AString & a_ChildName, size_t a_Length);
-
-	/** Sets chunk data into the correct file; locks file CS as needed */
-	bool SetChunkData(const cChunkCoords & a_Chunk, ContiguousByteBufferView a_Data);
+	/** Returns the data of the specified section byte array tag, pointing into the parsed NBT.
+	Returns nullptr if the tag is missing (-1), isn't a byte array or isn't a_Length bytes long. */
+	const std::byte * GetSectionData(const cParsedNBT & a_NBT, int a_Tag, size_t a_Length);
 
 	/** Loads the chunk from the data (no locking needed) */
 	bool LoadChunkFromData(const cChunkCoords & a_Chunk, ContiguousByteBufferView a_Data);
@@ -293,11 +238,16 @@ protected:
 	/** Helper function for extracting the X, Y, and Z int subtags of a NBT compound; returns true if successful */
 	bool GetBlockEntityNBTPos(const cParsedNBT & a_NBT, int a_TagIdx, Vector3i & a_AbsPos);
 
-	/** Gets the correct MCA file either from cache or from disk, manages the m_MCAFiles cache; assumes m_CS is locked */
-	std::shared_ptr<cMCAFile> LoadMCAFile(const cChunkCoords & a_Chunk);
-
 	// cWSSchema overrides:
-	virtual bool LoadChunk(const cChunkCoords & a_Chunk) override;
+	virtual cChunkDecoder ReadChunk(const cChunkCoords & a_Chunk) override;
 	virtual bool SaveChunk(const cChunkCoords & a_Chunk) override;
+	virtual void Flush(void) override;
+	virtual void ChunkUnloaded(const cChunkCoords & a_Chunk) override;
 	virtual const AString GetName() const override {return "anvil"; }
+	virtual sWriteStatistics GetWriteStatistics(void) const override;
+	virtual sFileCacheStatistics GetFileCacheStatistics(void) const override;
+
+	/** The region files that the chunk data is read from and written into.
+	Declared last, so that it's destroyed, and writes out the queued chunks, while the rest of the schema is still alive. */
+	cAnvilRegionFiles m_RegionFiles;
 } ;
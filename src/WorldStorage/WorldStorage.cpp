@@ -1,7 +1,7 @@
 
 // WorldStorage.cpp
 
-// Implements the cWorldStorage class representing the chunk loading / saving thread
+// Implements the cWorldStorage class representing the chunk loading / saving threads
 
 // To add a new storage schema, implement a cWSSchema descendant and add it to cWorldStorage::InitSchemas()
 
@@ -25,7 +25,7 @@ public:
 
 protected:
 	// cWSSchema overrides:
-	virtual bool LoadChunk(const cChunkCoords & a_Chunk) override {return false; }
+	virtual cChunkDecoder ReadChunk(const cChunkCoords & a_Chunk) override {return {}; }
 	virtual bool SaveChunk(const cChunkCoords & a_Chunk) override {return true; }
 	virtual const AString GetName(void) const override {return "forgetful"; }
 } ;
@@ -40,7 +40,12 @@ protected:
 cWorldStorage::cWorldStorage(void) :
 	Super("World Storage Executor"),
 	m_World(nullptr),
-	m_SaveSchema(nullptr)
+	m_Decoders("World Storage Decoder"),
+	m_Savers("World Storage Saver"),
+	m_NumLoadThreads(1),
+	m_NumSaveThreads(1),
+	m_SaveSchema(nullptr),
+	m_NumSaved(0)
 {
 }
 
@@ -50,6 +55,10 @@ cWorldStorage::cWorldStorage(void) :
 
 cWorldStorage::~cWorldStorage()
 {
+	// The workers may still be using the schemas:
+	m_Decoders.Stop();
+	m_Savers.Stop();
+
 	for (cWSSchemaList::iterator itr = m_Schemas.begin(); itr != m_Schemas.end(); ++itr)
 	{
 		delete *itr;
@@ -60,11 +69,25 @@ cWorldStorage::~cWorldStorage()
 
 
 
-void cWorldStorage::Initialize(cWorld & a_World, const AString & a_StorageSchemaName, int a_StorageCompressionFactor)
+void cWorldStorage::Initialize(cWorld & a_World, const sSettings & a_Settings)
 {
 	m_World = &a_World;
-	m_StorageSchemaName = a_StorageSchemaName;
-	InitSchemas(a_StorageCompressionFactor);
+	m_StorageSchemaName = a_Settings.m_SchemaName;
+	m_ColdChunkCache.SetBudget(a_Settings.m_ColdChunkCacheBytes);
+	m_NumLoadThreads = std::max<size_t>(a_Settings.m_NumLoadThreads, 1);
+	m_NumSaveThreads = std::max<size_t>(a_Settings.m_NumSaveThreads, 1);
+	InitSchemas(a_Settings);
+}
+
+
+
+
+
+void cWorldStorage::Start(void)
+{
+	m_Decoders.Start(m_NumLoadThreads);
+	m_Savers.Start(m_NumSaveThreads);
+	Super::Start();
 }
 
 
@@ -84,18 +107,24 @@ void cWorldStorage::WaitForFinish(void)
 {
 	LOGD("Waiting for the world storage to finish saving");
 
-	{
-		m_LoadQueue.Clear();
-	}
+	// Drop the chunks that haven't started loading yet:
+	m_LoadQueue.Clear();
+	m_Decoders.Clear();
 
 	// Wait for the saving to finish:
 	WaitForSaveQueueEmpty();
 
-	// Wait for the thread to finish:
+	// Wait for the threads to finish:
 	m_ShouldTerminate = true;
 	m_Event.Set();  // Wake up the thread if waiting
 	Super::Stop();
-	LOGD("World storage thread finished");
+	m_Decoders.Clear();
+	m_Decoders.Stop();
+	m_Savers.Stop();
+
+	// Write out the data that the schema still keeps in memory:
+	Flush();
+	LOGD("World storage threads finished");
 }
 
 
@@ -105,6 +134,7 @@ void cWorldStorage::WaitForFinish(void)
 void cWorldStorage::WaitForLoadQueueEmpty(void)
 {
 	m_LoadQueue.BlockTillEmpty();
+	m_Decoders.WaitForEmpty();
 }
 
 
@@ -113,7 +143,7 @@ void cWorldStorage::WaitForLoadQueueEmpty(void)
 
 void cWorldStorage::WaitForSaveQueueEmpty(void)
 {
-	m_SaveQueue.BlockTillEmpty();
+	m_Savers.WaitForEmpty();
 }
 
 
@@ -122,7 +152,7 @@ void cWorldStorage::WaitForSaveQueueEmpty(void)
 
 size_t cWorldStorage::GetLoadQueueLength(void)
 {
-	return m_LoadQueue.Size();
+	return m_LoadQueue.Size() + m_Decoders.GetLength();
 }
 
 
@@ -131,7 +161,45 @@ size_t cWorldStorage::GetLoadQueueLength(void)
 
 size_t cWorldStorage::GetSaveQueueLength(void)
 {
-	return m_SaveQueue.Size();
+	return m_Savers.GetLength();
+}
+
+
+
+
+
+void cWorldStorage::Flush(void)
+{
+	if (m_SaveSchema != nullptr)
+	{
+		m_SaveSchema->Flush();
+	}
+}
+
+
+
+
+
+cWSSchema::sWriteStatistics cWorldStorage::GetWriteStatistics(void) const
+{
+	if (m_SaveSchema == nullptr)
+	{
+		return {};
+	}
+	return m_SaveSchema->GetWriteStatistics();
+}
+
+
+
+
+
+cWSSchema::sFileCacheStatistics cWorldStorage::GetFileCacheStatistics(void) const
+{
+	if (m_SaveSchema == nullptr)
+	{
+		return {};
+	}
+	return m_SaveSchema->GetFileCacheStatistics();
 }
 
 
@@ -156,18 +224,41 @@ void cWorldStorage::QueueSaveChunk(int a_ChunkX, int a_ChunkZ)
 {
 	ASSERT(m_World->IsChunkValid(a_ChunkX, a_ChunkZ));
 
-	m_SaveQueue.EnqueueItem({ a_ChunkX, a_ChunkZ });
-	m_Event.Set();
+	const cChunkCoords Coords(a_ChunkX, a_ChunkZ);
+	m_Savers.Queue(Coords, [this, Coords]()
+		{
+			SaveChunk(Coords);
+		}
+	);
 }
 
 
 
 
 
-void cWorldStorage::InitSchemas(int a_StorageCompressionFactor)
+void cWorldStorage::ChunkUnloaded(cChunkCoords a_Chunk)
+{
+	if (!m_ColdChunkCache.IsEnabled())
+	{
+		return;
+	}
+
+	// Queued with the saves, so that it runs after the chunk's saves have been handed over to the schema:
+	m_Savers.Queue(a_Chunk, [this, a_Chunk]()
+		{
+			m_SaveSchema->ChunkUnloaded(a_Chunk);
+		}
+	);
+}
+
+
+
+
+
+void cWorldStorage::InitSchemas(const sSettings & a_Settings)
 {
 	// The first schema added is considered the default
-	m_Schemas.push_back(new cWSSAnvil    (m_World, a_StorageCompressionFactor));
+	m_Schemas.push_back(new cWSSAnvil    (m_World, a_Settings, m_ColdChunkCache));
 	m_Schemas.push_back(new cWSSForgetful(m_World));
 	// Add new schemas here
 
@@ -205,97 +296,270 @@ void cWorldStorage::Execute(void)
 	while (!m_ShouldTerminate)
 	{
 		m_Event.Wait();
-		// Process both queues until they are empty again:
-		bool Success;
-		do
+
+		// Read the queued chunks until the queue is empty again:
+		cChunkCoords ToLoad(0, 0);
+		while (!m_ShouldTerminate && m_LoadQueue.TryDequeueItem(ToLoad))
 		{
-			if (m_ShouldTerminate)
-			{
-				return;
-			}
+			ReadChunk(ToLoad);
+		}
+	}
+}
+
+
+
+
 
-			Success = LoadOneChunk();
-			Success |= SaveOneChunk();
-		} while (Success);
+void cWorldStorage::ReadChunk(cChunkCoords a_Chunk)
+{
+	ASSERT(m_World->IsChunkQueued(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ));
+
+	// First try the schema that is used for saving
+	auto Decoder = m_SaveSchema->ReadChunk(a_Chunk);
+
+	// If it didn't have the chunk, try all the other schemas:
+	for (auto itr = m_Schemas.begin(); (Decoder == nullptr) && (itr != m_Schemas.end()); ++itr)
+	{
+		if ((*itr) != m_SaveSchema)
+		{
+			Decoder = (*itr)->ReadChunk(a_Chunk);
+		}
+	}
+
+	if (Decoder == nullptr)
+	{
+		// Notify the chunk owner that the chunk failed to load (sets cChunk::m_HasLoadFailed to true):
+		m_World->ChunkLoadFailed(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
+		return;
 	}
+
+	// Decompress and parse the data on the decoder threads:
+	m_Decoders.Queue(a_Chunk, [this, a_Chunk, Decoder = std::move(Decoder)]()
+		{
+			if (!Decoder())
+			{
+				m_World->ChunkLoadFailed(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
+			}
+		}
+	);
 }
 
 
 
 
 
-bool cWorldStorage::LoadOneChunk(void)
+void cWorldStorage::SaveChunk(cChunkCoords a_Chunk)
 {
-	// Dequeue an item, bail out if there's none left:
-	cChunkCoords ToLoad(0, 0);
-	bool ShouldLoad = m_LoadQueue.TryDequeueItem(ToLoad);
-	if (!ShouldLoad)
+	if (!m_World->IsChunkValid(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ))
 	{
-		return false;
+		return;
+	}
+
+	m_World->MarkChunkSaving(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
+	if (m_SaveSchema->SaveChunk(a_Chunk))
+	{
+		m_World->MarkChunkSaved(a_Chunk.m_ChunkX, a_Chunk.m_ChunkZ);
+		m_NumSaved++;
 	}
+}
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cWorldStorage::cWorkerPool:
+
+cWorldStorage::cWorkerPool::cWorkerPool(const AString & a_Name):
+	m_Name(a_Name),
+	m_ShouldTerminate(false)
+{
+}
+
+
+
 
-	// Load the chunk:
-	LoadChunk(ToLoad.m_ChunkX, ToLoad.m_ChunkZ);
 
-	return true;
+cWorldStorage::cWorkerPool::~cWorkerPool()
+{
+	Stop();
 }
 
 
 
 
 
-bool cWorldStorage::SaveOneChunk(void)
+void cWorldStorage::cWorkerPool::Start(size_t a_NumWorkers)
 {
-	// Dequeue one chunk to save:
-	cChunkCoords ToSave(0, 0);
-	bool ShouldSave = m_SaveQueue.TryDequeueItem(ToSave);
-	if (!ShouldSave)
+	ASSERT(m_Workers.empty());
+
+	m_ShouldTerminate = false;
+	for (size_t i = 0; i < a_NumWorkers; i++)
 	{
-		return false;
+		m_Workers.push_back(std::make_unique<cWorker>(*this, i));
+		m_Workers.back()->Start();
 	}
+}
+
+
+
 
-	// Save the chunk, if it's valid:
-	if (m_World->IsChunkValid(ToSave.m_ChunkX, ToSave.m_ChunkZ))
+
+void cWorldStorage::cWorkerPool::Stop(void)
+{
+	m_ShouldTerminate = true;
+	for (auto & Worker : m_Workers)
 	{
-		m_World->MarkChunkSaving(ToSave.m_ChunkX, ToSave.m_ChunkZ);
-		if (m_SaveSchema->SaveChunk(cChunkCoords(ToSave.m_ChunkX, ToSave.m_ChunkZ)))
-		{
-			m_World->MarkChunkSaved(ToSave.m_ChunkX, ToSave.m_ChunkZ);
-		}
+		Worker->Stop();
 	}
+	m_Workers.clear();
+	m_evtFinished.Set();  // Wake up anybody waiting for the jobs to finish
+}
 
-	return true;
+
+
+
+
+void cWorldStorage::cWorkerPool::Queue(cChunkCoords a_Coords, cJob && a_Job)
+{
+	{
+		cCSLock Lock(m_CS);
+		m_Queue.push_back({ a_Coords, std::move(a_Job) });
+	}
+	m_Event.Set();
 }
 
 
 
 
 
-bool cWorldStorage::LoadChunk(int a_ChunkX, int a_ChunkZ)
+void cWorldStorage::cWorkerPool::Clear(void)
 {
-	ASSERT(m_World->IsChunkQueued(a_ChunkX, a_ChunkZ));
+	{
+		cCSLock Lock(m_CS);
+		m_Queue.clear();
+	}
+	m_evtFinished.Set();
+}
 
-	cChunkCoords Coords(a_ChunkX, a_ChunkZ);
 
-	// First try the schema that is used for saving
-	if (m_SaveSchema->LoadChunk(Coords))
+
+
+
+void cWorldStorage::cWorkerPool::WaitForEmpty(void)
+{
+	cCSLock Lock(m_CS);
+	while (!m_ShouldTerminate && (!m_Queue.empty() || !m_InProgress.empty()))
 	{
-		return true;
+		cCSUnlock Unlock(Lock);
+		m_evtFinished.Wait();
 	}
+}
 
-	// If it didn't have the chunk, try all the other schemas:
-	for (cWSSchemaList::iterator itr = m_Schemas.begin(); itr != m_Schemas.end(); ++itr)
+
+
+
+
+size_t cWorldStorage::cWorkerPool::GetLength(void) const
+{
+	cCSLock Lock(m_CS);
+	return m_Queue.size() + m_InProgress.size();
+}
+
+
+
+
+
+bool cWorldStorage::cWorkerPool::GetNextJob(sJob & a_Job)
+{
+	cCSLock Lock(m_CS);
+	for (;;)
 	{
-		if (((*itr) != m_SaveSchema) && (*itr)->LoadChunk(Coords))
+		if (m_ShouldTerminate)
+		{
+			// Pass the wakeup on to the next waiting worker:
+			m_Event.Set();
+			return false;
+		}
+
+		// Find the first job whose chunk isn't being processed by another worker:
+		auto itr = std::find_if(m_Queue.begin(), m_Queue.end(), [this](const sJob & a_QueuedJob)
+			{
+				return (std::find(m_InProgress.begin(), m_InProgress.end(), a_QueuedJob.m_Coords) == m_InProgress.end());
+			}
+		);
+		if (itr != m_Queue.end())
 		{
+			a_Job = std::move(*itr);
+			m_Queue.erase(itr);
+			m_InProgress.push_back(a_Job.m_Coords);
+			if (!m_Queue.empty())
+			{
+				// Let another worker pick up the rest of the queue:
+				m_Event.Set();
+			}
 			return true;
 		}
+
+		// Either the queue is empty or all of it is waiting for chunks in progress, wait for a change:
+		cCSUnlock Unlock(Lock);
+		m_Event.Wait();
+	}
+}
+
+
+
+
+
+void cWorldStorage::cWorkerPool::FinishJob(cChunkCoords a_Coords)
+{
+	{
+		cCSLock Lock(m_CS);
+		m_InProgress.erase(std::find(m_InProgress.begin(), m_InProgress.end(), a_Coords));
 	}
 
-	// Notify the chunk owner that the chunk failed to load (sets cChunk::m_HasLoadFailed to true):
-	m_World->ChunkLoadFailed(a_ChunkX, a_ChunkZ);
+	// Jobs held back for the finished chunk may now be available:
+	m_Event.Set();
+	m_evtFinished.Set();
+}
+
+
 
-	return false;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// cWorldStorage::cWorkerPool::cWorker:
+
+cWorldStorage::cWorkerPool::cWorker::cWorker(cWorkerPool & a_Pool, size_t a_Index):
+	Super(fmt::format(FMT_STRING("{} #{}"), a_Pool.m_Name, a_Index + 1)),
+	m_Pool(a_Pool)
+{
+}
+
+
+
+
+
+void cWorldStorage::cWorkerPool::cWorker::Stop(void)
+{
+	m_ShouldTerminate = true;
+	m_Pool.m_Event.Set();
+	Super::Stop();
+}
+
+
+
+
+
+void cWorldStorage::cWorkerPool::cWorker::Execute(void)
+{
+	sJob Job{ { 0, 0 }, nullptr };
+	while (!m_ShouldTerminate && m_Pool.GetNextJob(Job))
+	{
+		Job.m_Job();
+		Job.m_Job = nullptr;  // Release the job's data before waiting for the next one
+		m_Pool.FinishJob(Job.m_Coords);
+	}
 }
 
 
@@ -1,11 +1,21 @@
 
 // WorldStorage.h
 
-// Interfaces to the cWorldStorage class representing the chunk loading / saving thread
+// Interfaces to the cWorldStorage class representing the chunk loading / saving threads
 // This class decides which storage schema to use for saving; it queries all available schemas for loading
 // Also declares the base class for all storage schemas, cWSSchema
 // Helper serialization class cJsonChunkSerializer is declared as well
 
+/*
+Loading is a two-stage pipeline:
+1. The storage thread takes the chunks off the load queue and reads their raw data from the schemas (file I/O).
+2. A pool of decoder threads decompresses and parses the raw data and hands the chunks over to the world.
+Saving is done by a separate pool of threads, each one serializes, compresses and writes whole chunks.
+A chunk is never processed by two threads of the same pool at once, so its saves are written in the order they were queued.
+The number of the decoder and saver threads is configured in world.ini, [Storage] LoadThreads and SaveThreads.
+The schemas may keep the saved data in memory and write it in batches; it's all written out when the storage stops.
+*/
+
 
 
 
@@ -15,6 +25,7 @@
 #include "../OSSupport/IsThread.h"
 #include "../OSSupport/Queue.h"
 #include "ChunkDef.h"
+#include "ColdChunkCache.h"
 
 
 
@@ -33,10 +44,60 @@ public:
 	cWSSchema(cWorld * a_World) : m_World(a_World) {}
 	virtual ~cWSSchema() {}  // Force the descendants' destructors to be virtual
 
-	virtual bool LoadChunk(const cChunkCoords & a_Chunk) = 0;
+	/** Decodes the raw chunk data that has been read by ReadChunk() and sets the chunk into the world.
+	Returns false if the chunk failed to load. */
+	using cChunkDecoder = std::function<bool()>;
+
+	/** Reads the raw data of the specified chunk, called from the storage thread.
+	Returns the decoder that finishes the load, possibly on another thread; returns an empty decoder if the schema doesn't have the chunk. */
+	virtual cChunkDecoder ReadChunk(const cChunkCoords & a_Chunk) = 0;
+
+	/** Saves the specified chunk. Called from the saver threads, possibly for several chunks at once.
+	The schema may keep the data in memory and write it later, in Flush() at the latest. */
 	virtual bool SaveChunk(const cChunkCoords & a_Chunk) = 0;
+
+	/** Writes out all the saved data that the schema still keeps in memory. */
+	virtual void Flush(void) {}
+
+	/** Called from a saver thread once the chunk has been unloaded and all its saves have finished.
+	The schema may turn the chunk's data that it kept on the last load or save into a cold blob in the cold chunk cache, for a quick reload. */
+	virtual void ChunkUnloaded(const cChunkCoords & a_Chunk) { UNUSED(a_Chunk); }
+
 	virtual const AString GetName(void) const = 0;
 
+	/** The statistics of writing the saved chunks into the storage. */
+	struct sWriteStatistics
+	{
+		/** Number of the writes of a batch of chunks into a single file. */
+		size_t m_NumFlushes = 0;
+
+		size_t m_NumChunksWritten = 0;
+		UInt64 m_BytesWritten = 0;
+
+		/** Total and longest time spent writing a single batch, including the syncs. */
+		UInt64 m_TotalFlushNs = 0;
+		UInt64 m_MaxFlushNs = 0;
+	};
+
+	/** Returns the write statistics, for the schemas that collect them. */
+	virtual sWriteStatistics GetWriteStatistics(void) const { return {}; }
+
+	/** The statistics of the cache of the open storage files. */
+	struct sFileCacheStatistics
+	{
+		size_t m_NumFiles = 0;
+		size_t m_MaxFiles = 0;
+		UInt64 m_NumHits = 0;
+
+		/** Number of the files opened because they weren't in the cache. */
+		UInt64 m_NumOpens = 0;
+
+		UInt64 m_NumEvictions = 0;
+	};
+
+	/** Returns the file cache statistics, for the schemas that keep their files open. */
+	virtual sFileCacheStatistics GetFileCacheStatistics(void) const { return {}; }
+
 protected:
 
 	cWorld * m_World;
@@ -56,6 +117,37 @@ class cWorldStorage:
 
 public:
 
+	/** The storage settings, as read from the [Storage] section of world.ini. */
+	struct sSettings
+	{
+		/** Name of the schema used for saving the chunks, "Default" for the first one. */
+		AString m_SchemaName = "Default";
+
+		int m_CompressionFactor = 6;
+
+		/** The budget for keeping the storage data of unloaded chunks in memory, zero disables the cache. */
+		size_t m_ColdChunkCacheBytes = 0;
+
+		/** How the Anvil schema reads the region files, "File" or "MemoryMapped". */
+		AString m_RegionBackend = "File";
+
+		/** Number of the threads decompressing and parsing the loaded chunks. */
+		size_t m_NumLoadThreads = 2;
+
+		/** Number of the threads saving the chunks. */
+		size_t m_NumSaveThreads = 1;
+
+		/** How long the Anvil schema collects the saved chunks before writing them into the region files, in milliseconds.
+		Zero writes each chunk as soon as it's saved. */
+		unsigned m_FlushIntervalMSec = 1000;
+
+		/** When the Anvil schema syncs the region files to disk: "None", "PerFlush" or "PerRegion". */
+		AString m_SyncPolicy = "None";
+
+		/** The number of the region files that the Anvil schema keeps open. */
+		size_t m_MaxOpenRegionFiles = 32;
+	};
+
 	cWorldStorage();
 	virtual ~cWorldStorage() override;
 
@@ -66,22 +158,148 @@ public:
 	void QueueSaveChunk(int a_ChunkX, int a_ChunkZ);
 
 	/** Initializes the storage schemas, ready to be started. */
-	void Initialize(cWorld & a_World, const AString & a_StorageSchemaName, int a_StorageCompressionFactor);
+	void Initialize(cWorld & a_World, const sSettings & a_Settings);
+	void Start(void);  // Hide the cIsThread's Start() method, we need to start the worker pools
 	void Stop(void);  // Hide the cIsThread's Stop() method, we need to signal the event
 	void WaitForFinish(void);
 	void WaitForLoadQueueEmpty(void);
 	void WaitForSaveQueueEmpty(void);
 
+	/** Returns the number of chunks waiting to be loaded, including those being decoded. */
 	size_t GetLoadQueueLength(void);
+
+	/** Returns the number of chunks waiting to be saved, including those being saved.
+	Note that the schema may still keep the saved chunks in memory after they leave the queue, until Flush(). */
 	size_t GetSaveQueueLength(void);
 
+	/** Writes out the saved chunks that the schema still keeps in memory.
+	Once the save queue is empty, the chunks saved so far are stored when this returns. */
+	void Flush(void);
+
+	/** Returns the number of chunks saved since the start, for measuring the throughput. */
+	size_t GetNumSaved(void) const { return m_NumSaved; }
+
+	/** Returns the statistics of writing the saved chunks into the storage. */
+	cWSSchema::sWriteStatistics GetWriteStatistics(void) const;
+
+	/** Returns the statistics of the storage's open file cache. */
+	cWSSchema::sFileCacheStatistics GetFileCacheStatistics(void) const;
+
+	/** Called by the chunkmap when a chunk is unloaded, queues making its data in the cold chunk cache available for a quick reload.
+	The chunk is clean when unloaded, the data is the one kept by its last save, so the change is queued after that save. */
+	void ChunkUnloaded(cChunkCoords a_Chunk);
+
+	cColdChunkCache::sStatistics GetColdChunkCacheStatistics(void) const { return m_ColdChunkCache.GetStatistics(); }
+
 protected:
 
+	/** A pool of threads processing jobs queued for individual chunks.
+	The jobs are processed in the queued order, except that a job is held back while another job for the same chunk is in progress. */
+	class cWorkerPool
+	{
+	public:
+
+		using cJob = std::function<void()>;
+
+		/** Creates the pool, the threads are named a_Name followed by their number. */
+		cWorkerPool(const AString & a_Name);
+		~cWorkerPool();
+
+		/** Starts the specified number of threads. */
+		void Start(size_t a_NumWorkers);
+
+		/** Stops all the threads, after they finish the jobs in progress. The jobs still in the queue are kept. */
+		void Stop(void);
+
+		/** Queues a job for the specified chunk. */
+		void Queue(cChunkCoords a_Coords, cJob && a_Job);
+
+		/** Removes all the jobs that haven't been started yet. */
+		void Clear(void);
+
+		/** Waits until all the queued jobs are finished, or the pool is stopped. */
+		void WaitForEmpty(void);
+
+		/** Returns the number of the jobs queued or in progress. */
+		size_t GetLength(void) const;
+
+	protected:
+
+		class cWorker:
+			public cIsThread
+		{
+			using Super = cIsThread;
+
+		public:
+
+			cWorker(cWorkerPool & a_Pool, size_t a_Index);
+
+			/** Signals the thread to terminate and waits until it's finished. */
+			void Stop(void);
+
+		protected:
+
+			cWorkerPool & m_Pool;
+
+			// cIsThread override:
+			virtual void Execute(void) override;
+		};
+
+
+		struct sJob
+		{
+			cChunkCoords m_Coords;
+			cJob m_Job;
+		};
+
+
+		AString m_Name;
+
+		/** Protects m_Queue and m_InProgress. */
+		mutable cCriticalSection m_CS;
+
+		/** The jobs waiting to be processed. Protected by m_CS. */
+		std::deque<sJob> m_Queue;
+
+		/** The chunks whose jobs are being processed by the workers. Protected by m_CS. */
+		std::vector<cChunkCoords> m_InProgress;
+
+		/** Set when a job is queued or finished, or the workers should terminate. */
+		cEvent m_Event;
+
+		/** Set when a job is finished or removed from the queue. */
+		cEvent m_evtFinished;
+
+		std::vector<std::unique_ptr<cWorker>> m_Workers;
+
+		/** Set when stopping, makes the workers terminate. */
+		std::atomic<bool> m_ShouldTerminate;
+
+
+		/** Waits for a job that can be processed and moves it into a_Job, marking its chunk as in progress.
+		Returns false if the workers should terminate. */
+		bool GetNextJob(sJob & a_Job);
+
+		/** Marks the chunk's job as finished, releasing the jobs held back for the chunk. */
+		void FinishJob(cChunkCoords a_Coords);
+	};
+
+
 	cWorld * m_World;
 	AString  m_StorageSchemaName;
 
+	/** The chunks waiting for their data to be read by the storage thread. */
 	cQueue<cChunkCoords> m_LoadQueue;
-	cQueue<cChunkCoords> m_SaveQueue;
+
+	/** The threads decoding the chunk data read by the storage thread. */
+	cWorkerPool m_Decoders;
+
+	/** The threads saving the chunks. */
+	cWorkerPool m_Savers;
+
+	/** The number of threads in m_Decoders and m_Savers, as configured. */
+	size_t m_NumLoadThreads;
+	size_t m_NumSaveThreads;
 
 	/** All the storage schemas (all used for loading) */
 	cWSSchemaList m_Schemas;
@@ -89,22 +307,26 @@ protected:
 	/** The one storage schema used for saving */
 	cWSSchema * m_SaveSchema;
 
-	/** Set when there's any addition to the queues */
+	/** Set when there's any addition to the load queue */
 	cEvent m_Event;
 
+	/** The compressed storage data of recently used chunks, consulted by the schemas before the files on disk. */
+	cColdChunkCache m_ColdChunkCache;
 
-	/** Loads the chunk specified; returns true on success, false on failure */
-	bool LoadChunk(int a_ChunkX, int a_ChunkZ);
+	/** Number of chunks saved since the start. */
+	std::atomic<size_t> m_NumSaved;
 
-	void InitSchemas(int a_StorageCompressionFactor);
 
-	virtual void Execute(void) override;
+	/** Reads the data of the chunk specified and queues it for decoding.
+	If none of the schemas has the chunk, reports the chunk as failed to load. */
+	void ReadChunk(cChunkCoords a_Chunk);
 
-	/** Loads one chunk from the queue (if any queued); returns true if there was a chunk in the queue to load */
-	bool LoadOneChunk(void);
+	/** Saves the chunk specified, if it's valid. Called from the saver threads. */
+	void SaveChunk(cChunkCoords a_Chunk);
 
-	/** Saves one chunk from the queue (if any queued); returns true if there was a chunk in the queue to save */
-	bool SaveOneChunk(void);
+	void InitSchemas(const sSettings & a_Settings);
+
+	virtual void Execute(void) override;
 } ;
 
 
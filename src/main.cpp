@@ -38,6 +38,7 @@ static void ParseArguments(int argc, char ** argv, cMemorySettingsRepository & a
 	TCLAP::CmdLine cmd("Cuberite");
 	TCLAP::ValueArg<int> slotsArg    ("s", "max-players",         "Maximum number of slots for the server to use, overrides setting in setting.ini", false, -1, "number", cmd);
 	TCLAP::ValueArg<AString> confArg ("c", "config-file",         "Config file to use", false, "settings.ini", "string", cmd);
+	TCLAP::ValueArg<AString> pregenArg("", "pregenerate",         "Pregenerate an area of a world without accepting any connections, then exit. The value is the same as the parameters of the pregenerate console command, such as \"world 100\"", false, "", "string", cmd);
 	TCLAP::MultiArg<int> portsArg    ("p", "port",                "The port number the server should listen to", false, "port", cmd);
 	TCLAP::SwitchArg commLogArg      ("",  "log-comm",            "Log server client communications to file", cmd);
 	TCLAP::SwitchArg commLogInArg    ("",  "log-comm-in",         "Log inbound server client communications to file", cmd);
@@ -60,6 +61,10 @@ static void ParseArguments(int argc, char ** argv, cMemorySettingsRepository & a
 		AString conf_file = confArg.getValue();
 		a_Settings.AddValue("Server", "ConfigFile", conf_file);
 	}
+	if (pregenArg.isSet())
+	{
+		a_Settings.AddValue("Server", "Pregenerate", pregenArg.getValue());
+	}
 	if (slotsArg.isSet())
 	{
 		int slots = slotsArg.getValue();
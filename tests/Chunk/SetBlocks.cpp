@@ -0,0 +1,394 @@
+
+// SetBlocks.cpp
+
+// Tests that cChunk::SetBlocks() has the same effects as setting the blocks one by one through cChunk::SetBlock()
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "Chunk.h"
+#include "ClientHandle.h"
+#include "DeadlockDetect.h"
+#include "SetChunkData.h"
+#include "World.h"
+#include "BlockEntities/BlockEntity.h"
+#include "Simulator/SimulatorManager.h"
+
+
+
+
+
+/** The positions woken up in the simulators, in the order of the wakeups. */
+static std::vector<Vector3i> g_WokenUp;
+
+/** The block changes sent to the clients, in the order sent. */
+static sSetBlockVector g_SentBlocks;
+
+/** The absolute positions of the block entities destroyed, in the order of destruction. */
+static std::vector<Vector3i> g_DestroyedBlockEntities;
+
+
+
+
+
+void cSimulatorManager::WakeUp(cChunk & a_Chunk, Vector3i a_Position)
+{
+	g_WokenUp.push_back(a_Position);
+}
+
+
+
+
+
+void cClientHandle::SendBlockChanges(int a_ChunkX, int a_ChunkZ, const sSetBlockVector & a_Changes)
+{
+	g_SentBlocks.insert(g_SentBlocks.end(), a_Changes.begin(), a_Changes.end());
+}
+
+
+
+
+
+/** A block entity that remembers its meta and records its destruction. */
+class cTestBlockEntity:
+	public cBlockEntity
+{
+	using Super = cBlockEntity;
+
+public:
+
+	cTestBlockEntity(BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta, Vector3i a_Pos, cWorld * a_World):
+		Super(a_BlockType, a_BlockMeta, a_Pos, a_World)
+	{
+	}
+
+	NIBBLETYPE GetMeta(void) const { return m_BlockMeta; }
+
+	virtual void Destroy(void) override
+	{
+		g_DestroyedBlockEntities.push_back(GetPos());
+	}
+
+	virtual void SendTo(cClientHandle & a_Client) override
+	{
+	}
+
+	virtual bool UsedBy(cPlayer * a_Player) override
+	{
+		return false;
+	}
+};
+
+
+
+
+
+OwnedBlockEntity cBlockEntity::CreateByBlockType(BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta, Vector3i a_Pos, cWorld * a_World)
+{
+	return std::make_unique<cTestBlockEntity>(a_BlockType, a_BlockMeta, a_Pos, a_World);
+}
+
+
+
+
+
+bool cBlockEntity::IsBlockEntityBlockType(BLOCKTYPE a_BlockType)
+{
+	return (a_BlockType == E_BLOCK_CHEST) || (a_BlockType == E_BLOCK_FURNACE) || (a_BlockType == E_BLOCK_SIGN_POST);
+}
+
+
+
+
+
+/** What happened to a chunk while setting the blocks. */
+struct sEffects
+{
+	std::vector<Vector3i> m_WokenUp;
+	sSetBlockVector m_SentBlocks;
+	std::vector<Vector3i> m_DestroyedBlockEntities;
+};
+
+
+
+
+
+/** Owns a chunk in the test world, with stone up to Y = 63 and the initial blocks set on top of it. */
+class cTestChunk
+{
+public:
+
+	cTestChunk(cWorld & a_World, int a_ChunkX, int a_ChunkZ, const sSetBlockVector & a_Initial):
+		m_Chunk(a_ChunkX, a_ChunkZ, a_World.GetChunkMap(), &a_World)
+	{
+		SetChunkData Data({ a_ChunkX, a_ChunkZ });
+		for (int y = 0; y < 64; y++)
+		{
+			for (int z = 0; z < cChunkDef::Width; z++)
+			{
+				for (int x = 0; x < cChunkDef::Width; x++)
+				{
+					Data.BlockData.SetBlock({ x, y, z }, E_BLOCK_STONE);
+				}
+			}
+		}
+		std::fill(std::begin(Data.BiomeMap), std::end(Data.BiomeMap), biPlains);
+		Data.UpdateHeightMap();
+		Data.IsLightValid = false;
+		m_Chunk.SetAllData(std::move(Data));
+
+		for (const auto & Block: a_Initial)
+		{
+			m_Chunk.SetBlock(Block.GetRelativePos(), Block.m_BlockType, Block.m_BlockMeta);
+		}
+
+		// Start recording only once the initial blocks are in place.
+		// The client is never dereferenced, the chunk only passes it to the recorders above:
+		m_Chunk.AddClient(reinterpret_cast<cClientHandle *>(this));
+		m_Chunk.BroadcastPendingChanges();
+		g_WokenUp.clear();
+		g_SentBlocks.clear();
+		g_DestroyedBlockEntities.clear();
+		m_Chunk.MarkSaving();
+		m_Chunk.MarkSaved();
+	}
+
+
+	/** Sets the blocks one by one, returns what happened. */
+	sEffects SetOneByOne(const sSetBlockVector & a_Blocks)
+	{
+		for (const auto & Block: a_Blocks)
+		{
+			m_Chunk.SetBlock(Block.GetRelativePos(), Block.m_BlockType, Block.m_BlockMeta);
+		}
+		return CollectEffects();
+	}
+
+
+	/** Sets the blocks in a single batch, returns what happened. */
+	sEffects SetBatched(const sSetBlockVector & a_Blocks)
+	{
+		m_Chunk.SetBlocks(a_Blocks.begin(), a_Blocks.end());
+		return CollectEffects();
+	}
+
+
+	cChunk m_Chunk;
+
+
+protected:
+
+	sEffects CollectEffects(void)
+	{
+		m_Chunk.BroadcastPendingChanges();
+		sEffects Res;
+		std::swap(Res.m_WokenUp, g_WokenUp);
+		std::swap(Res.m_SentBlocks, g_SentBlocks);
+		std::swap(Res.m_DestroyedBlockEntities, g_DestroyedBlockEntities);
+		return Res;
+	}
+};
+
+
+
+
+
+/** Returns the position of each item, without duplicates, ordered. */
+static std::set<std::tuple<int, int, int>> uniquePositions(const std::vector<Vector3i> & a_Positions)
+{
+	std::set<std::tuple<int, int, int>> Res;
+	for (const auto & Pos: a_Positions)
+	{
+		Res.emplace(Pos.x, Pos.y, Pos.z);
+	}
+	return Res;
+}
+
+
+
+
+
+/** Returns the last state sent for each block position. */
+static std::map<std::tuple<int, int, int>, std::pair<BLOCKTYPE, NIBBLETYPE>> lastSentStates(const sSetBlockVector & a_Sent)
+{
+	std::map<std::tuple<int, int, int>, std::pair<BLOCKTYPE, NIBBLETYPE>> Res;
+	for (const auto & Block: a_Sent)
+	{
+		Res[{ Block.m_RelX, Block.m_RelY, Block.m_RelZ }] = { Block.m_BlockType, Block.m_BlockMeta };
+	}
+	return Res;
+}
+
+
+
+
+
+/** Sets the blocks in one chunk one by one and in another chunk batched, checks that both end up the same.
+Returns the number of blocks sent to the clients by the batch. */
+static size_t testBatch(cWorld & a_World, const sSetBlockVector & a_Initial, const sSetBlockVector & a_Blocks)
+{
+	const int ChunkX = a_Blocks.front().m_ChunkX;
+	const int ChunkZ = a_Blocks.front().m_ChunkZ;
+	cTestChunk OneByOne(a_World, ChunkX, ChunkZ, a_Initial);
+	cTestChunk Batched(a_World, ChunkX, ChunkZ, a_Initial);
+	const auto OneByOneEffects = OneByOne.SetOneByOne(a_Blocks);
+	const auto BatchedEffects = Batched.SetBatched(a_Blocks);
+
+	// The blocks, heights and block entities are the same:
+	for (int y = 0; y < cChunkDef::Height; y++)
+	{
+		for (int z = 0; z < cChunkDef::Width; z++)
+		{
+			for (int x = 0; x < cChunkDef::Width; x++)
+			{
+				TEST_EQUAL(OneByOne.m_Chunk.GetBlock(x, y, z), Batched.m_Chunk.GetBlock(x, y, z));
+				TEST_EQUAL(OneByOne.m_Chunk.GetMeta(x, y, z), Batched.m_Chunk.GetMeta(x, y, z));
+			}
+		}
+	}
+	for (int z = 0; z < cChunkDef::Width; z++)
+	{
+		for (int x = 0; x < cChunkDef::Width; x++)
+		{
+			TEST_EQUAL(OneByOne.m_Chunk.GetHeight(x, z), Batched.m_Chunk.GetHeight(x, z));
+		}
+	}
+	TEST_EQUAL(OneByOne.m_Chunk.IsDirty(), Batched.m_Chunk.IsDirty());
+	for (const auto & Block: a_Blocks)
+	{
+		const auto Expected = static_cast<cTestBlockEntity *>(OneByOne.m_Chunk.GetBlockEntityRel(Block.GetRelativePos()));
+		const auto Actual = static_cast<cTestBlockEntity *>(Batched.m_Chunk.GetBlockEntityRel(Block.GetRelativePos()));
+		TEST_EQUAL((Expected == nullptr), (Actual == nullptr));
+		if (Expected != nullptr)
+		{
+			TEST_EQUAL(Expected->GetBlockType(), Actual->GetBlockType());
+			TEST_EQUAL(Expected->GetMeta(), Actual->GetMeta());
+			TEST_EQUAL(Expected->GetPos(), Actual->GetPos());
+		}
+	}
+
+	// Each block is processed once, the other blocks aren't touched:
+	const auto ChangedPositions = uniquePositions([&a_Blocks]()
+	{
+		std::vector<Vector3i> Res;
+		for (const auto & Block: a_Blocks)
+		{
+			Res.push_back(Block.GetRelativePos());
+		}
+		return Res;
+	}());
+	TEST_EQUAL(BatchedEffects.m_WokenUp.size(), ChangedPositions.size());
+	TEST_TRUE(uniquePositions(BatchedEffects.m_WokenUp) == ChangedPositions);
+	TEST_TRUE(uniquePositions(OneByOneEffects.m_WokenUp) == ChangedPositions);
+
+	// The batch destroys only the block entities that were there before it, each once:
+	std::set<std::tuple<int, int, int>> InitialBlockEntities;
+	for (const auto & Block: a_Initial)
+	{
+		const auto Pos = Block.GetAbsolutePos();
+		if (cBlockEntity::IsBlockEntityBlockType(Block.m_BlockType) && (ChangedPositions.count({ Block.m_RelX, Block.m_RelY, Block.m_RelZ }) > 0))
+		{
+			InitialBlockEntities.emplace(Pos.x, Pos.y, Pos.z);
+		}
+	}
+	TEST_EQUAL(BatchedEffects.m_DestroyedBlockEntities.size(), InitialBlockEntities.size());
+	TEST_TRUE(uniquePositions(BatchedEffects.m_DestroyedBlockEntities) == InitialBlockEntities);
+
+	// The batch sends each changed block once, in its final state:
+	const auto OneByOneSent = lastSentStates(OneByOneEffects.m_SentBlocks);
+	const auto BatchedSent = lastSentStates(BatchedEffects.m_SentBlocks);
+	TEST_EQUAL(BatchedSent.size(), BatchedEffects.m_SentBlocks.size());
+	for (const auto & Sent: BatchedSent)
+	{
+		const auto Other = OneByOneSent.find(Sent.first);
+		TEST_TRUE(Other != OneByOneSent.end());
+		TEST_TRUE(Other->second == Sent.second);
+	}
+	for (const auto & Block: BatchedEffects.m_SentBlocks)
+	{
+		TEST_EQUAL(Block.m_ChunkX, ChunkX);
+		TEST_EQUAL(Block.m_ChunkZ, ChunkZ);
+		TEST_EQUAL(Block.m_BlockType, Batched.m_Chunk.GetBlock(Block.GetRelativePos()));
+		TEST_EQUAL(Block.m_BlockMeta, Batched.m_Chunk.GetMeta(Block.GetRelativePos()));
+	}
+	return BatchedEffects.m_SentBlocks.size();
+}
+
+
+
+
+
+static void testSetBlocks(void)
+{
+	LOGD("Test started");
+	cDeadlockDetect DeadlockDetect;
+	cWorld World("SetBlocksTest", "", DeadlockDetect, {}, dimOverworld, "");
+
+	{
+		// Changes spanning sections, unsorted, including the lowering and raising of the heightmap:
+		const sSetBlockVector Blocks =
+		{
+			{ 1,  15,  1, E_BLOCK_DIRT, 0 },
+			{ 1,  16,  1, E_BLOCK_WOOL, 3 },
+			{ 3, 200,  5, E_BLOCK_GLASS, 0 },
+			{ 1,   0,  1, E_BLOCK_BEDROCK, 0 },
+			{ 2,  63,  2, E_BLOCK_AIR, 0 },
+			{ 4,  63,  4, E_BLOCK_AIR, 0 },
+			{ 4,  62,  4, E_BLOCK_AIR, 0 },
+			{ 1, 255, 15, E_BLOCK_GLASS, 0 },
+		};
+		TEST_EQUAL(testBatch(World, {}, Blocks), Blocks.size());
+	}
+
+	{
+		// The same block changed several times in the batch is set once, to its final state:
+		const sSetBlockVector Blocks =
+		{
+			{ 2, 70, 2, E_BLOCK_CHEST, 2 },
+			{ 3, 70, 2, E_BLOCK_STONE, 0 },
+			{ 2, 70, 2, E_BLOCK_FURNACE, 3 },
+			{ 3, 70, 2, E_BLOCK_AIR, 0 },
+			{ 2, 90, 2, E_BLOCK_SIGN_POST, 4 },
+			{ 2, 90, 2, E_BLOCK_GLASS, 0 },
+		};
+		TEST_EQUAL(testBatch(World, {}, Blocks), 2U);  // The block at {3, 70, 2} ends up unchanged
+	}
+
+	{
+		// The existing block entities are replaced or removed, both within a section and across sections:
+		const sSetBlockVector Initial =
+		{
+			{ 5,  70, 5, E_BLOCK_CHEST, 2 },
+			{ 5, 100, 5, E_BLOCK_CHEST, 2 },
+			{ 5, 130, 5, E_BLOCK_FURNACE, 2 },
+		};
+		const sSetBlockVector Blocks =
+		{
+			{ 5, 130, 5, E_BLOCK_FURNACE, 4 },
+			{ 5,  70, 5, E_BLOCK_AIR, 0 },
+			{ 5, 100, 5, E_BLOCK_FURNACE, 3 },
+			{ 5, 101, 5, E_BLOCK_CHEST, 5 },
+		};
+		TEST_EQUAL(testBatch(World, Initial, Blocks), Blocks.size());
+	}
+
+	{
+		// A larger batch in a chunk with negative coords, touching every section:
+		sSetBlockVector Blocks;
+		for (int y = 0; y < cChunkDef::Height; y += 5)
+		{
+			for (int x = -16; x < 0; x += 3)
+			{
+				Blocks.emplace_back(x, y, -7, ((y % 2) == 0) ? E_BLOCK_CHEST : E_BLOCK_GLASS, static_cast<NIBBLETYPE>(y % 16));
+			}
+		}
+		TEST_EQUAL(testBatch(World, {}, Blocks), Blocks.size());
+	}
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("Chunk SetBlocks",
+	testSetBlocks()
+);
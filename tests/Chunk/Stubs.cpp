@@ -0,0 +1,1396 @@
+// Stubs.cpp
+
+// Implements stubs of various Cuberite methods that are needed for linking but not for runtime
+// This is required so that we don't bring in the entire Cuberite via dependencies
+
+#include "Globals.h"
+#include "BlockArea.h"
+#include "ClientHandle.h"
+#include "DeadlockDetect.h"
+#include "Item.h"
+#include "MapManager.h"
+#include "MobCensus.h"
+#include "MobSpawner.h"
+#include "Root.h"
+#include "SetChunkData.h"
+#include "World.h"
+#include "Bindings/PluginManager.h"
+#include "BlockEntities/BlockEntity.h"
+#include "Blocks/BlockHandler.h"
+#include "Blocks/ChunkInterface.h"
+#include "Generating/ChunkGenerator.h"
+#include "Simulator/FireSimulator.h"
+#include "Simulator/NoopFluidSimulator.h"
+#include "Simulator/NoopRedstoneSimulator.h"
+#include "Simulator/SandSimulator.h"
+#include "Simulator/SimulatorManager.h"
+
+
+
+
+
+/** Creates a world with no-op simulators and no threads, just enough for hosting chunks. */
+cWorld::cWorld(
+	const AString & a_WorldName, const AString & a_DataPath,
+	cDeadlockDetect & a_DeadlockDetect, const AStringVector & a_WorldNames,
+	eDimension a_Dimension, const AString & a_LinkedOverworldName
+):
+	m_WorldName(a_WorldName),
+	m_SimulatorManager(std::make_unique<cSimulatorManager>(*this)),
+	m_WaterSimulator(new cNoopFluidSimulator(*this, E_BLOCK_WATER, E_BLOCK_STATIONARY_WATER)),
+	m_LavaSimulator(new cNoopFluidSimulator(*this, E_BLOCK_LAVA, E_BLOCK_STATIONARY_LAVA)),
+	m_RedstoneSimulator(new cRedstoneNoopSimulator(*this)),
+	m_ChunkMap(this),
+	m_Scoreboard(this),
+	m_MapManager(this),
+	m_GeneratorCallbacks(*this),
+	m_ChunkSender(*this),
+	m_Lighting(*this),
+	m_TickThread(*this)
+{
+}
+
+
+
+
+
+cWorld::~cWorld()
+{
+	delete m_WaterSimulator;
+	delete m_LavaSimulator;
+	delete m_RedstoneSimulator;
+}
+
+
+
+
+
+cRoot * cRoot::s_Root = nullptr;
+
+
+
+
+
+cDeadlockDetect::cDeadlockDetect():
+	Super("Deadlock detector")
+{
+}
+
+
+
+
+
+cDeadlockDetect::~cDeadlockDetect()
+{
+}
+
+
+
+
+
+void cDeadlockDetect::Execute(void)
+{
+}
+
+
+
+
+
+void cDeadlockDetect::TrackCriticalSection(cCriticalSection & a_CS, const AString & a_Name)
+{
+}
+
+
+
+
+
+void cDeadlockDetect::UntrackCriticalSection(cCriticalSection & a_CS)
+{
+}
+
+
+
+
+
+cChunkMap::cChunkMap(cWorld * a_World):
+	m_World(a_World)
+{
+}
+
+
+
+
+
+cChunkMap::~cChunkMap()
+{
+}
+
+
+
+
+
+void cChunkMap::ChunkValidated(void)
+{
+}
+
+
+
+
+
+cChunk & cChunkMap::ConstructChunk(int a_ChunkX, int a_ChunkZ)
+{
+	UNREACHABLE("The tests don't construct chunks through the chunkmap");
+}
+
+
+
+
+
+cChunk * cChunkMap::FindChunk(int a_ChunkX, int a_ChunkZ)
+{
+	return nullptr;
+}
+
+
+
+
+
+void cChunkMap::AccessFarChunks(void)
+{
+}
+
+
+
+
+
+void cChunkMap::CompareChunkClients(cChunk * a_Chunk1, cChunk * a_Chunk2, cClientDiffCallback & a_Callback)
+{
+}
+
+
+
+
+
+void cChunkMap::DeferEntityMove(cChunk & a_Chunk, OwnedEntity a_Entity)
+{
+}
+
+
+
+
+
+bool cChunkInterface::ForEachChunkInRect(int a_MinChunkX, int a_MaxChunkX, int a_MinChunkZ, int a_MaxChunkZ, cChunkDataCallback & a_Callback)
+{
+	return false;
+}
+
+
+
+
+
+bool cChunkInterface::WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBlockY, int a_MinBlockZ, int a_DataTypes)
+{
+	return false;
+}
+
+
+
+
+
+cWorld::cTickThread::cTickThread(cWorld & a_World):
+	Super("World Ticker"),
+	m_World(a_World)
+{
+}
+
+
+
+
+
+void cWorld::cTickThread::Execute(void)
+{
+}
+
+
+
+
+
+cWorld::cChunkGeneratorCallbacks::cChunkGeneratorCallbacks(cWorld & a_World):
+	m_World(&a_World)
+{
+}
+
+
+
+
+
+void cWorld::cChunkGeneratorCallbacks::OnChunkGenerated(cChunkDesc & a_ChunkDesc)
+{
+}
+
+
+
+
+
+bool cWorld::cChunkGeneratorCallbacks::IsChunkValid(cChunkCoords a_Coords)
+{
+	return false;
+}
+
+
+
+
+
+bool cWorld::cChunkGeneratorCallbacks::HasChunkAnyClients(cChunkCoords a_Coords)
+{
+	return false;
+}
+
+
+
+
+
+bool cWorld::cChunkGeneratorCallbacks::IsChunkQueued(cChunkCoords a_Coords)
+{
+	return false;
+}
+
+
+
+
+
+void cWorld::cChunkGeneratorCallbacks::CallHookChunkGenerating(cChunkDesc & a_ChunkDesc)
+{
+}
+
+
+
+
+
+void cWorld::cChunkGeneratorCallbacks::CallHookChunkGenerated(cChunkDesc & a_ChunkDesc)
+{
+}
+
+
+
+
+
+void cWorld::ForceSendChunkTo(int a_ChunkX, int a_ChunkZ, cChunkSender::Priority a_Priority, cClientHandle * a_Client)
+{
+}
+
+
+
+
+
+int cWorld::GetTickRandomNumber(int a_Range)
+{
+	return 0;
+}
+
+
+
+
+
+bool cWorld::IsSlimeChunk(int a_ChunkX, int a_ChunkZ) const
+{
+	return false;
+}
+
+
+
+
+
+void cWorld::SpawnItemPickups(const cItems & a_Pickups, Vector3d a_Pos, double a_FlyAwaySpeed, bool a_IsPlayerCreated)
+{
+}
+
+
+
+
+
+void cWorld::SpawnItemPickups(const cItems & a_Pickups, Vector3d a_Pos, Vector3d a_Speed, bool a_IsPlayerCreated)
+{
+}
+
+
+
+
+
+UInt32 cWorld::SpawnItemPickup(Vector3d a_Pos, const cItem & a_Item, Vector3f a_Speed, int a_LifetimeTicks, bool a_CanCombine)
+{
+	return 0;
+}
+
+
+
+
+
+UInt32 cWorld::SpawnExperienceOrb(Vector3d a_Pos, int a_Reward)
+{
+	return 0;
+}
+
+
+
+
+
+cTickTime cWorld::GetTimeOfDay() const
+{
+	return {};
+}
+
+
+
+
+
+cTickTimeLong cWorld::GetWorldAge() const
+{
+	return {};
+}
+
+
+
+
+
+void cWorld::SetTimeOfDay(cTickTime a_TimeOfDay)
+{
+}
+
+
+
+
+
+std::optional<int> cWorld::GetHeight(int a_BlockX, int a_BlockZ)
+{
+	return {};
+}
+
+
+
+
+
+void cWorld::BroadcastAttachEntity(const cEntity & a_Entity, const cEntity & a_Vehicle)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastBlockAction(Vector3i a_BlockPos, Byte a_Byte1, Byte a_Byte2, BLOCKTYPE a_BlockType, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastBlockBreakAnimation(UInt32 a_EntityID, Vector3i a_BlockPos, Int8 a_Stage, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastBlockEntity(Vector3i a_BlockPos, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastBossBarUpdateHealth(const cEntity & a_Entity, UInt32 a_UniqueID, float a_FractionFilled)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastChat(const AString & a_Message, const cClientHandle * a_Exclude, eMessageType a_ChatPrefix)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastChat(const cCompositeChat & a_Message, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastCollectEntity(const cEntity & a_Collected, const cEntity & a_Collector, unsigned a_Count, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastDestroyEntity(const cEntity & a_Entity, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastDetachEntity(const cEntity & a_Entity, const cEntity & a_PreviousVehicle)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastEntityEffect(const cEntity & a_Entity, int a_EffectID, int a_Amplifier, int a_Duration, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastEntityEquipment(const cEntity & a_Entity, short a_SlotNum, const cItem & a_Item, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastEntityHeadLook(const cEntity & a_Entity, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastEntityLook(const cEntity & a_Entity, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastEntityMetadata(const cEntity & a_Entity, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastEntityPosition(const cEntity & a_Entity, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastEntityVelocity(const cEntity & a_Entity, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastEntityAnimation(const cEntity & a_Entity, EntityAnimation a_Animation, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastLeashEntity(const cEntity & a_Entity, const cEntity & a_EntityLeashedTo)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastParticleEffect(const AString & a_ParticleName, Vector3f a_Src, Vector3f a_Offset, float a_ParticleData, int a_ParticleAmount, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastParticleEffect(const AString & a_ParticleName, Vector3f a_Src, Vector3f a_Offset, float a_ParticleData, int a_ParticleAmount, std::array<int, 2> a_Data, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastPlayerListAddPlayer(const cPlayer & a_Player, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastPlayerListHeaderFooter(const cCompositeChat & a_Header, const cCompositeChat & a_Footer)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastPlayerListRemovePlayer(const cPlayer & a_Player, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastPlayerListUpdateDisplayName(const cPlayer & a_Player, const AString & a_CustomName, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastPlayerListUpdateGameMode(const cPlayer & a_Player, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastPlayerListUpdatePing()
+{
+}
+
+
+
+
+
+void cWorld::BroadcastRemoveEntityEffect(const cEntity & a_Entity, int a_EffectID, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastScoreboardObjective(const AString & a_Name, const AString & a_DisplayName, Byte a_Mode)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastScoreUpdate(const AString & a_Objective, const AString & a_Player, cObjective::Score a_Score, Byte a_Mode)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastDisplayObjective(const AString & a_Objective, cScoreboard::eDisplaySlot a_Display)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastSoundEffect(const AString & a_SoundName, Vector3d a_Position, float a_Volume, float a_Pitch, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastSoundParticleEffect(const EffectID a_EffectID, Vector3i a_SrcPos, int a_Data, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastSpawnEntity(cEntity & a_Entity, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastThunderbolt(Vector3i a_BlockPos, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastTimeUpdate(const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastUnleashEntity(const cEntity & a_Entity)
+{
+}
+
+
+
+
+
+void cWorld::BroadcastWeather(eWeather a_Weather, const cClientHandle * a_Exclude)
+{
+}
+
+
+
+
+
+bool cWorld::ForEachPlayer(cPlayerListCallback a_Callback)
+{
+	return false;
+}
+
+
+
+
+
+bool cWorld::ForEachEntityInBox(const cBoundingBox & a_Box, cEntityCallback a_Callback)
+{
+	return false;
+}
+
+
+
+
+
+bool cWorld::ForEachChunkInRect(int a_MinChunkX, int a_MaxChunkX, int a_MinChunkZ, int a_MaxChunkZ, cChunkDataCallback & a_Callback)
+{
+	return false;
+}
+
+
+
+
+
+bool cWorld::WriteBlockArea(cBlockArea & a_Area, int a_MinBlockX, int a_MinBlockY, int a_MinBlockZ, int a_DataTypes)
+{
+	return false;
+}
+
+
+
+
+
+std::vector<UInt32> cWorld::SpawnSplitExperienceOrbs(Vector3d a_Pos, int a_Reward)
+{
+	return {};
+}
+
+
+
+
+
+void cWorld::SendBlockTo(int a_X, int a_Y, int a_Z, const cPlayer & a_Player)
+{
+}
+
+
+
+
+
+void cWorld::WakeUpSimulators(Vector3i a_Block)
+{
+}
+
+
+
+
+
+void cWorld::DoExplosionAt(double a_ExplosionSize, double a_BlockX, double a_BlockY, double a_BlockZ, bool a_CanCauseFire, eExplosionSource a_Source, void * a_SourceData)
+{
+}
+
+
+
+
+
+bool cWorld::DoWithBlockEntityAt(Vector3i a_Position, cBlockEntityCallback a_Callback)
+{
+	return false;
+}
+
+
+
+
+
+bool cWorld::IsWeatherWetAt(int a_BlockX, int a_BlockZ)
+{
+	return false;
+}
+
+
+
+
+
+bool cWorld::IsWeatherWetAtXYZ(Vector3i a_Position)
+{
+	return false;
+}
+
+
+
+
+
+UInt32 cWorld::SpawnMob(double a_PosX, double a_PosY, double a_PosZ, eMonsterType a_MonsterType, bool a_Baby)
+{
+	return 0;
+}
+
+
+
+
+
+cChunkGeneratorThread::cChunkGeneratorThread(void):
+	m_Generator(nullptr),
+	m_Seed(0),
+	m_ShouldTerminate(false),
+	m_NumChunksGenerated(0),
+	m_NumTotalGenerated(0),
+	m_GenerationStart(std::chrono::steady_clock::now()),
+	m_LastReport(m_GenerationStart),
+	m_PluginInterface(nullptr),
+	m_ChunkSink(nullptr)
+{
+}
+
+
+
+
+
+cChunkGeneratorThread::~cChunkGeneratorThread()
+{
+}
+
+
+
+
+
+void cChunkGeneratorThread::QueueGenerateChunk(cChunkCoords a_Coords, bool a_ForceRegeneration, cChunkCoordCallback * a_Callback)
+{
+}
+
+
+
+
+
+cChunkSender::cChunkSender(cWorld & a_World):
+	Super("Chunk Sender"),
+	m_World(a_World),
+	m_Serializer(m_World.GetDimension())
+{
+}
+
+
+
+
+
+cChunkSender::~cChunkSender()
+{
+}
+
+
+
+
+
+void cChunkSender::Execute(void)
+{
+}
+
+
+
+
+
+void cChunkSender::BiomeMap(const cChunkDef::BiomeMap & a_BiomeMap)
+{
+}
+
+
+
+
+
+void cChunkSender::Entity(cEntity * a_Entity)
+{
+}
+
+
+
+
+
+void cChunkSender::BlockEntity(cBlockEntity * a_Entity)
+{
+}
+
+
+
+
+
+cChunkDataSerializer::cChunkDataSerializer(eDimension a_Dimension):
+	m_Packet(512 KiB),
+	m_Dimension(a_Dimension),
+	m_CurrentVersion(CacheVersion::v47)
+{
+}
+
+
+
+
+
+cLightingThread::cLightingThread(cWorld & a_World):
+	m_World(a_World)
+{
+}
+
+
+
+
+
+cLightingThread::~cLightingThread()
+{
+}
+
+
+
+
+
+cWorldStorage::cWorldStorage(void):
+	Super("World Storage Executor"),
+	m_World(nullptr),
+	m_Decoders("World Storage Decoder"),
+	m_Savers("World Storage Saver"),
+	m_NumLoadThreads(1),
+	m_NumSaveThreads(1),
+	m_SaveSchema(nullptr),
+	m_NumSaved(0)
+{
+}
+
+
+
+
+
+cWorldStorage::~cWorldStorage()
+{
+}
+
+
+
+
+
+void cWorldStorage::Execute(void)
+{
+}
+
+
+
+
+
+cWorldStorage::cWorkerPool::cWorkerPool(const AString & a_Name)
+{
+}
+
+
+
+
+
+cWorldStorage::cWorkerPool::~cWorkerPool()
+{
+}
+
+
+
+
+
+cMapManager::cMapManager(cWorld * a_World):
+	m_World(a_World)
+{
+}
+
+
+
+
+
+cScoreboard::cScoreboard(cWorld * a_World):
+	m_World(a_World)
+{
+}
+
+
+
+
+
+cSimulatorManager::cSimulatorManager(cWorld & a_World):
+	m_World(a_World)
+{
+}
+
+
+
+
+
+cSimulatorManager::~cSimulatorManager()
+{
+}
+
+
+
+
+
+void cSimulatorManager::SimulateChunk(std::chrono::milliseconds a_Dt, int a_ChunkX, int a_ChunkZ, cChunk * a_Chunk)
+{
+}
+
+
+
+
+
+void cSimulator::Simulate(float a_Dt)
+{
+}
+
+
+
+
+
+void cSimulator::WakeUp(cChunk & a_Chunk, Vector3i a_Position, BLOCKTYPE a_Block)
+{
+}
+
+
+
+
+
+void cSimulator::WakeUp(cChunk & a_Chunk, Vector3i a_Position, Vector3i a_Offset, BLOCKTYPE a_Block)
+{
+}
+
+
+
+
+
+cFluidSimulator::cFluidSimulator(cWorld & a_World, BLOCKTYPE a_Fluid, BLOCKTYPE a_StationaryFluid):
+	Super(a_World),
+	m_FluidBlock(a_Fluid),
+	m_StationaryFluidBlock(a_StationaryFluid)
+{
+}
+
+
+
+
+
+Vector3f cFluidSimulator::GetFlowingDirection(Vector3i a_Pos)
+{
+	return {};
+}
+
+
+
+
+
+cBlockEntity::cBlockEntity(BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta, Vector3i a_Pos, cWorld * a_World):
+	m_Pos(a_Pos),
+	m_RelX(a_Pos.x - cChunkDef::Width * FAST_FLOOR_DIV(a_Pos.x, cChunkDef::Width)),
+	m_RelZ(a_Pos.z - cChunkDef::Width * FAST_FLOOR_DIV(a_Pos.z, cChunkDef::Width)),
+	m_BlockType(a_BlockType),
+	m_BlockMeta(a_BlockMeta),
+	m_World(a_World)
+{
+}
+
+
+
+
+
+OwnedBlockEntity cBlockEntity::Clone(Vector3i a_Pos)
+{
+	return nullptr;
+}
+
+
+
+
+
+cItems cBlockEntity::ConvertToPickups() const
+{
+	return {};
+}
+
+
+
+
+
+void cBlockEntity::CopyFrom(const cBlockEntity & a_Src)
+{
+}
+
+
+
+
+
+void cBlockEntity::Destroy()
+{
+}
+
+
+
+
+
+void cBlockEntity::OnAddToWorld(cWorld & a_World, cChunk & a_Chunk)
+{
+	m_World = &a_World;
+}
+
+
+
+
+
+void cBlockEntity::OnRemoveFromWorld()
+{
+}
+
+
+
+
+
+void cBlockEntity::SetPos(Vector3i a_NewPos)
+{
+	m_Pos = a_NewPos;
+}
+
+
+
+
+
+void cBlockEntity::SetWorld(cWorld * a_World)
+{
+	m_World = a_World;
+}
+
+
+
+
+
+bool cBlockEntity::Tick(std::chrono::milliseconds a_Dt, cChunk & a_Chunk)
+{
+	return false;
+}
+
+
+
+
+
+const cBlockHandler & cBlockHandler::For(BLOCKTYPE a_BlockType)
+{
+	// Dummy handler.
+	static cBlockHandler Handler(E_BLOCK_AIR);
+	return Handler;
+}
+
+
+
+
+
+cBoundingBox cBlockHandler::GetPlacementCollisionBox(BLOCKTYPE a_XM, BLOCKTYPE a_XP, BLOCKTYPE a_YM, BLOCKTYPE a_YP, BLOCKTYPE a_ZM, BLOCKTYPE a_ZP) const
+{
+	return cBoundingBox(0, 0, 0, 0, 0, 0);
+}
+
+
+
+
+
+void cBlockHandler::OnUpdate(cChunkInterface & a_ChunkInterface, cWorldInterface & a_WorldInterface, cBlockPluginInterface & a_PluginInterface, cChunk & a_Chunk, const Vector3i a_RelPos) const
+{
+}
+
+
+
+
+
+void cBlockHandler::OnNeighborChanged(cChunkInterface & a_ChunkInterface, Vector3i a_BlockPos, eBlockFace a_WhichNeighbor) const
+{
+}
+
+
+
+
+
+void cBlockHandler::NeighborChanged(cChunkInterface & a_ChunkInterface, Vector3i a_BlockPos, eBlockFace a_WhichNeighbor)
+{
+}
+
+
+
+
+
+cItems cBlockHandler::ConvertToPickups(const NIBBLETYPE a_BlockMeta, const cItem * const a_Tool) const
+{
+	return cItems();
+}
+
+
+
+
+
+bool cBlockHandler::CanBeAt(const cChunk & a_Chunk, const Vector3i a_Position, const NIBBLETYPE a_Meta) const
+{
+	return true;
+}
+
+
+
+
+
+bool cBlockHandler::IsUseable() const
+{
+	return false;
+}
+
+
+
+
+
+bool cBlockHandler::DoesIgnoreBuildCollision(const cWorld & a_World, const cItem & a_HeldItem, Vector3i a_Position, NIBBLETYPE a_Meta, eBlockFace a_ClickedBlockFace, bool a_ClickedDirectly) const
+{
+	return m_BlockType == E_BLOCK_AIR;
+}
+
+
+
+
+
+void cBlockHandler::Check(cChunkInterface & a_ChunkInterface, cBlockPluginInterface & a_PluginInterface, Vector3i a_RelPos, cChunk & a_Chunk) const
+{
+}
+
+
+
+
+
+ColourID cBlockHandler::GetMapBaseColourID(NIBBLETYPE a_Meta) const
+{
+	return 0;
+}
+
+
+
+
+
+bool cBlockHandler::IsInsideBlock(Vector3d a_Position, const NIBBLETYPE a_BlockMeta) const
+{
+	return true;
+}
+
+
+
+
+
+size_t cBlockArea::MakeIndexForSize(Vector3i a_RelPos, Vector3i a_Size)
+{
+	return 0;
+}
+
+
+
+
+
+void cClientHandle::AddWantedChunk(int a_ChunkX, int a_ChunkZ)
+{
+}
+
+
+
+
+
+void cClientHandle::SendBlockChange(Vector3i a_BlockPos, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta)
+{
+}
+
+
+
+
+
+void cClientHandle::SendDestroyEntity(const cEntity & a_Entity)
+{
+}
+
+
+
+
+
+void cUUID::FromRaw(const std::array<Byte, 16> & a_Raw)
+{
+}
+
+
+
+
+
+bool cEntity::IsTicking(void) const
+{
+	return false;
+}
+
+
+
+
+
+void cEntity::SetIsTicking(bool a_IsTicking)
+{
+}
+
+
+
+
+
+void cEntity::SetParentChunk(cChunk * a_Chunk)
+{
+}
+
+
+
+
+
+void cEntity::SetPosition(const Vector3d & a_Position)
+{
+}
+
+
+
+
+
+const cItemHandler & cItem::GetHandler(void) const
+{
+	UNREACHABLE("The tests have no items");
+}
+
+
+
+
+
+void cMobCensus::CollectMob(cMonster & a_Monster, cChunk & a_Chunk, double a_Distance)
+{
+}
+
+
+
+
+
+void cMobCensus::CollectSpawnableChunk(cChunk & a_Chunk)
+{
+}
+
+
+
+
+
+bool cMobSpawner::CheckPackCenter(BLOCKTYPE a_BlockType)
+{
+	return false;
+}
+
+
+
+
+
+cMonster * cMobSpawner::TryToSpawnHere(cChunk * a_Chunk, Vector3i a_RelPos, EMCSBiome a_Biome, int & a_MaxPackSize)
+{
+	return nullptr;
+}
+
+
+
+
+
+void cMobSpawner::NewPack(void)
+{
+}
+
+
+
+
+
+cPluginManager * cPluginManager::Get(void)
+{
+	return nullptr;
+}
+
+
+
+
+
+bool cPluginManager::CallHookBlockSpread(cWorld & a_World, Vector3i a_BlockPos, eSpreadSource a_Source)
+{
+	return false;
+}
+
+
+
+
+
+bool cPluginManager::CallHookBlockToPickups(cWorld & a_World, Vector3i a_BlockPos, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta, const cBlockEntity * a_BlockEntity, const cEntity * a_Digger, const cItem * a_Tool, cItems & a_Pickups)
+{
+	return false;
+}
+
+
+
+
+
+bool cPluginManager::CallHookPlayerBreakingBlock(cPlayer & a_Player, Vector3i a_BlockPos, eBlockFace a_BlockFace, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta)
+{
+	return false;
+}
+
+
+
+
+
+bool cPluginManager::CallHookPlayerBrokenBlock(cPlayer & a_Player, Vector3i a_BlockPos, eBlockFace a_BlockFace, BLOCKTYPE a_BlockType, NIBBLETYPE a_BlockMeta)
+{
+	return false;
+}
+
+
+
+
+
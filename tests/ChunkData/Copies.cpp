@@ -16,7 +16,6 @@ static void CopyAll(const StoreType & Data, GetType Getter, DefaultType Default,
 	for (size_t Y = 0; Y != 16; Y++)
 	{
 		const auto Section = (Data.*Getter)(Y);
-		static_assert(SectionCount == std::tuple_size<std::remove_pointer_t<decltype(Section)>>::value, "Output array has wrong size");
 
 		if (Section == nullptr)
 		{
@@ -24,7 +23,12 @@ static void CopyAll(const StoreType & Data, GetType Getter, DefaultType Default,
 		}
 		else
 		{
-			std::copy(Section->begin(), Section->end(), Out + Y * SectionCount);
+			// Block sections are paletted, so copy element-wise rather than by iterators:
+			TEST_EQUAL(Section->size(), SectionCount);
+			for (size_t i = 0; i != SectionCount; i++)
+			{
+				Out[Y * SectionCount + i] = (*Section)[i];
+			}
 		}
 	}
 }
@@ -49,6 +53,27 @@ static void Test()
 		TEST_EQUAL(copy.GetBlock({ 3, 1, 4 }), 0xDE);
 		TEST_EQUAL(copy.GetMeta({ 3, 1, 4 }), 0xA);
 
+		// The copy shares the sections until either side writes to them:
+		TEST_EQUAL(copy.GetSection(0), buffer.GetSection(0));
+		buffer.SetBlock({ 3, 1, 4 }, 0xEF);
+		buffer.SetMeta({ 3, 1, 4 }, 0xB);
+		TEST_NOTEQUAL(copy.GetSection(0), buffer.GetSection(0));
+		TEST_EQUAL(copy.GetBlock({ 3, 1, 4 }), 0xDE);
+		TEST_EQUAL(copy.GetMeta({ 3, 1, 4 }), 0xA);
+		TEST_EQUAL(buffer.GetBlock({ 3, 1, 4 }), 0xEF);
+		TEST_EQUAL(buffer.GetMeta({ 3, 1, 4 }), 0xB);
+
+		ChunkLightData::SectionType SrcLight;
+		ChunkLightData::SectionType ZeroLight{};
+		std::fill(std::begin(SrcLight), std::end(SrcLight), 0x55);
+		ChunkLightData light;
+		light.SetSection(SrcLight, SrcLight, 1);
+		ChunkLightData lightCopy;
+		lightCopy.Assign(light);
+		light.SetSection(ZeroLight, ZeroLight, 1);
+		TEST_EQUAL(lightCopy.GetBlockLight({ 0, 16, 0 }), 0x5);
+		TEST_EQUAL(light.GetBlockLight({ 0, 16, 0 }), 0x0);
+
 		BLOCKTYPE SrcBlockBuffer[16 * 16 * 256];
 		NIBBLETYPE SrcNibbleBuffer[16 * 16 * 256 / 2]{};
 		for (int i = 0; i < 16 * 16 * 256; i += 4)
@@ -0,0 +1,91 @@
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "NibbleKernels.h"
+
+
+
+
+
+/** Checks the selected implementation against the scalar one, for all lengths up to a few vectors and unaligned buffers. */
+static void TestExpandCompress()
+{
+	LOGD("Using the %s implementation", NibbleKernels::GetImplementationName());
+
+	std::minstd_rand Random(42);
+	std::vector<NIBBLETYPE> Packed(300), Expanded(600), Reference(600);
+	for (auto & Byte : Packed)
+	{
+		Byte = static_cast<NIBBLETYPE>(Random());
+	}
+
+	for (size_t Offset = 0; Offset < 3; Offset++)
+	{
+		for (size_t NumNibbles = 0; NumNibbles <= 260; NumNibbles += 2)
+		{
+			std::fill(Expanded.begin(), Expanded.end(), NIBBLETYPE(0xaa));
+			std::fill(Reference.begin(), Reference.end(), NIBBLETYPE(0xaa));
+			NibbleKernels::Expand(Packed.data() + Offset, Expanded.data() + Offset, NumNibbles);
+			NibbleKernels::Scalar::Expand(Packed.data() + Offset, Reference.data() + Offset, NumNibbles);
+			TEST_EQUAL(Expanded, Reference);
+
+			// Compressing takes only the low nibbles, make sure the high ones are ignored:
+			for (auto & Value : Expanded)
+			{
+				Value = static_cast<NIBBLETYPE>(Random());
+			}
+			std::vector<NIBBLETYPE> Result(300, 0x55), ResultReference(300, 0x55);
+			NibbleKernels::Compress(Expanded.data() + Offset, Result.data() + Offset, NumNibbles);
+			NibbleKernels::Scalar::Compress(Expanded.data() + Offset, ResultReference.data() + Offset, NumNibbles);
+			TEST_EQUAL(Result, ResultReference);
+		}
+	}
+
+	// The round trip keeps the data:
+	NibbleKernels::Expand(Packed.data(), Expanded.data(), 512);
+	std::vector<NIBBLETYPE> RoundTrip(256);
+	NibbleKernels::Compress(Expanded.data(), RoundTrip.data(), 512);
+	TEST_TRUE(std::equal(RoundTrip.begin(), RoundTrip.end(), Packed.begin()));
+}
+
+
+
+
+
+/** Checks the strided row variants on a 3x3-chunk-like layout: 16-value rows with a stride of 48. */
+static void TestGatherScatter()
+{
+	const size_t RowLength = 16, RowStride = 48, NumRows = 20;
+	std::vector<NIBBLETYPE> Blob(RowStride * NumRows);
+	for (size_t i = 0; i < Blob.size(); i++)
+	{
+		Blob[i] = static_cast<NIBBLETYPE>((i * 7) % 16);
+	}
+
+	std::vector<NIBBLETYPE> Packed(RowLength * NumRows / 2);
+	NibbleKernels::GatherCompress(Blob.data() + 16, RowLength, RowStride, NumRows, Packed.data());
+	for (size_t Row = 0; Row < NumRows; Row++)
+	{
+		for (size_t i = 0; i < RowLength; i++)
+		{
+			TEST_EQUAL(cChunkDef::ExpandNibble(Packed.data(), Row * RowLength + i), Blob[16 + Row * RowStride + i]);
+		}
+	}
+
+	// Scattering back only writes the rows:
+	std::vector<NIBBLETYPE> Scattered(Blob.size(), 0xff);
+	NibbleKernels::ExpandScatter(Packed.data(), RowLength, RowStride, NumRows, Scattered.data() + 16);
+	for (size_t i = 0; i < Blob.size(); i++)
+	{
+		const bool IsInRow = (i >= 16) && (((i - 16) % RowStride) < RowLength);
+		TEST_EQUAL(Scattered[i], (IsInRow ? Blob[i] : 0xff));
+	}
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ChunkData Nibbles",
+	TestExpandCompress();
+	TestGatherScatter();
+);
@@ -0,0 +1,90 @@
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "ChunkData.h"
+
+
+
+
+
+/** Performs the entire paletted block section test. */
+static void Test()
+{
+	LOGD("Test started");
+
+	{
+		// A fresh section uses a single bit per block and widens as more block types are added:
+		PalettedBlockSection Section(0);
+		TEST_EQUAL(Section.GetBitsPerEntry(), 1);
+		TEST_EQUAL(Section[0], 0);
+
+		Section.Set(1, 1);
+		TEST_EQUAL(Section.GetBitsPerEntry(), 1);
+		Section.Set(2, 2);
+		TEST_EQUAL(Section.GetBitsPerEntry(), 2);
+		for (BLOCKTYPE Block = 3; Block != 16; Block++)
+		{
+			Section.Set(Block, Block);
+		}
+		TEST_EQUAL(Section.GetBitsPerEntry(), 4);
+		Section.Set(4095, 0xff);
+		TEST_EQUAL(Section.GetBitsPerEntry(), 8);
+
+		for (size_t i = 0; i != 16; i++)
+		{
+			TEST_EQUAL(Section[i], i);
+		}
+		TEST_EQUAL(Section[16], 0);
+		TEST_EQUAL(Section[4095], 0xff);
+	}
+
+	{
+		// Assign re-packs into the narrowest representation:
+		ChunkBlockData::SectionType Blocks;
+		for (size_t i = 0; i != ARRAYCOUNT(Blocks); i++)
+		{
+			Blocks[i] = static_cast<BLOCKTYPE>(i % 3);
+		}
+
+		PalettedBlockSection Section(Blocks);
+		TEST_EQUAL(Section.GetBitsPerEntry(), 2);
+
+		for (size_t i = 0; i != ARRAYCOUNT(Blocks); i++)
+		{
+			Blocks[i] = static_cast<BLOCKTYPE>(i);
+		}
+		Section.Assign(Blocks);
+		TEST_EQUAL(Section.GetBitsPerEntry(), 8);
+
+		ChunkBlockData::SectionType Out;
+		PalettedBlockSection Copy(Section);
+		Copy.CopyTo(Out);
+		TEST_EQUAL(memcmp(Blocks, Out, sizeof(Blocks)), 0);
+
+		std::fill(std::begin(Blocks), std::end(Blocks), 7);
+		Section.Assign(Blocks);
+		TEST_EQUAL(Section.GetBitsPerEntry(), 1);
+		TEST_EQUAL(Section[1234], 7);
+	}
+
+	{
+		// The chunk data stores widen sections transparently:
+		ChunkBlockData Buffer;
+		for (int X = 0; X != cChunkDef::Width; X++)
+		{
+			Buffer.SetBlock({ X, 0, 0 }, static_cast<BLOCKTYPE>(X * 16 + 1));
+		}
+		TEST_EQUAL(Buffer.GetSection(0)->GetBitsPerEntry(), 8);
+		for (int X = 0; X != cChunkDef::Width; X++)
+		{
+			TEST_EQUAL(Buffer.GetBlock({ X, 0, 0 }), X * 16 + 1);
+		}
+	}
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ChunkData Palette",
+	Test()
+);
@@ -0,0 +1,104 @@
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "ChunkData.h"
+
+
+
+
+
+/** Performs the entire uniform section test. */
+static void Test()
+{
+	LOGD("Test started");
+
+	{
+		// Sections filled with a single value are stored without any array:
+		ChunkBlockData::SectionType Stone;
+		std::fill(std::begin(Stone), std::end(Stone), BLOCKTYPE(1));
+		ChunkBlockData::SectionMetaType Metas;
+		std::fill(std::begin(Metas), std::end(Metas), NIBBLETYPE(0x33));
+
+		ChunkBlockData Buffer;
+		Buffer.SetSection(Stone, Metas, 2);
+		TEST_EQUAL(Buffer.GetSection(2), nullptr);
+		TEST_EQUAL(Buffer.GetMetaSection(2), nullptr);
+		TEST_EQUAL(Buffer.GetSectionFill(2), 1);
+		TEST_EQUAL(Buffer.GetMetaSectionFill(2), 0x33);
+		TEST_EQUAL(Buffer.GetBlock({ 5, 40, 5 }), 1);
+		TEST_EQUAL(Buffer.GetMeta({ 5, 40, 5 }), 3);
+		TEST_FALSE(Buffer.IsSectionDefault(2));
+		TEST_TRUE(Buffer.IsSectionDefault(3));
+
+		// Writing the fill value doesn't expand the section:
+		Buffer.SetBlock({ 0, 32, 0 }, 1);
+		TEST_EQUAL(Buffer.GetSection(2), nullptr);
+
+		// A differing write does, keeping the rest of the fill:
+		Buffer.SetBlock({ 0, 32, 0 }, 4);
+		Buffer.SetMeta({ 0, 32, 0 }, 7);
+		TEST_NOTEQUAL(Buffer.GetSection(2), nullptr);
+		TEST_NOTEQUAL(Buffer.GetMetaSection(2), nullptr);
+		TEST_EQUAL(Buffer.GetBlock({ 0, 32, 0 }), 4);
+		TEST_EQUAL(Buffer.GetMeta({ 0, 32, 0 }), 7);
+		TEST_EQUAL(Buffer.GetBlock({ 1, 32, 0 }), 1);
+		TEST_EQUAL(Buffer.GetMeta({ 1, 32, 0 }), 3);
+
+		// Compacting only collapses sections that are uniform again:
+		Buffer.Compact();
+		TEST_NOTEQUAL(Buffer.GetSection(2), nullptr);
+		Buffer.SetBlock({ 0, 32, 0 }, 1);
+		Buffer.SetMeta({ 0, 32, 0 }, 3);
+		Buffer.Compact();
+		TEST_EQUAL(Buffer.GetSection(2), nullptr);
+		TEST_EQUAL(Buffer.GetMetaSection(2), nullptr);
+		TEST_EQUAL(Buffer.GetSectionFill(2), 1);
+		TEST_EQUAL(Buffer.GetMetaSectionFill(2), 0x33);
+
+		// Copies carry the fill values over:
+		ChunkBlockData Copy;
+		Copy.Assign(Buffer);
+		TEST_EQUAL(Copy.GetBlock({ 15, 47, 15 }), 1);
+		TEST_EQUAL(Copy.GetMeta({ 15, 47, 15 }), 3);
+	}
+
+	{
+		// Compacting a section of a single widened block type:
+		ChunkBlockData Buffer;
+		for (int X = 0; X != cChunkDef::Width; X++)
+		{
+			Buffer.SetBlock({ X, 0, 0 }, static_cast<BLOCKTYPE>(X * 16 + 1));
+		}
+		for (int X = 0; X != cChunkDef::Width; X++)
+		{
+			Buffer.SetBlock({ X, 0, 0 }, 0);
+		}
+		TEST_NOTEQUAL(Buffer.GetSection(0), nullptr);
+		Buffer.Compact();
+		TEST_EQUAL(Buffer.GetSection(0), nullptr);
+		TEST_TRUE(Buffer.IsSectionDefault(0));
+	}
+
+	{
+		// Nibble sections with differing halves of a byte are not uniform:
+		ChunkLightData::SectionType Mixed, Full;
+		std::fill(std::begin(Mixed), std::end(Mixed), NIBBLETYPE(0xf0));
+		std::fill(std::begin(Full), std::end(Full), NIBBLETYPE(0xff));
+
+		ChunkLightData Buffer;
+		Buffer.SetSection(Mixed, Full, 0);
+		TEST_NOTEQUAL(Buffer.GetBlockLightSection(0), nullptr);
+		TEST_EQUAL(Buffer.GetSkyLightSection(0), nullptr);
+		TEST_EQUAL(Buffer.GetSkyLightSectionFill(0), 0xff);
+		TEST_EQUAL(Buffer.GetBlockLight({ 0, 0, 0 }), 0);
+		TEST_EQUAL(Buffer.GetBlockLight({ 1, 0, 0 }), 0xf);
+		TEST_FALSE(Buffer.IsSectionDefault(0));
+	}
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ChunkData Uniform",
+	Test()
+);
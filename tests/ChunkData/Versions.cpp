@@ -0,0 +1,107 @@
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "ChunkData.h"
+
+
+
+
+
+/** Performs the entire section version test. */
+static void Test()
+{
+	LOGD("Test started");
+
+	{
+		// Each write changes the version of its section only:
+		ChunkBlockData Buffer;
+		const auto Before0 = Buffer.GetSectionVersion(0);
+		const auto Before1 = Buffer.GetSectionVersion(1);
+		Buffer.SetBlock({ 0, 0, 0 }, 1);
+		TEST_NOTEQUAL(Buffer.GetSectionVersion(0), Before0);
+		TEST_EQUAL(Buffer.GetSectionVersion(1), Before1);
+
+		const auto AfterBlock = Buffer.GetSectionVersion(0);
+		Buffer.SetMeta({ 0, 0, 0 }, 5);
+		TEST_NOTEQUAL(Buffer.GetSectionVersion(0), AfterBlock);
+
+		// Compacting doesn't change the contents, so it keeps the versions:
+		const auto BeforeCompact = Buffer.GetSectionVersion(0);
+		Buffer.Compact();
+		TEST_EQUAL(Buffer.GetSectionVersion(0), BeforeCompact);
+
+		// Separate objects never share versions:
+		ChunkBlockData Other;
+		TEST_NOTEQUAL(Other.GetSectionVersion(1), Buffer.GetSectionVersion(1));
+	}
+
+	{
+		// Copies keep the versions of their source until either is modified:
+		ChunkBlockData Buffer;
+		Buffer.SetBlock({ 0, 0, 0 }, 1);
+		Buffer.SetBlock({ 0, 16, 0 }, 1);
+
+		ChunkBlockData Copy;
+		Copy.Assign(Buffer);
+		TEST_EQUAL(Copy.GetSectionVersion(0), Buffer.GetSectionVersion(0));
+		TEST_EQUAL(Copy.GetSectionVersion(1), Buffer.GetSectionVersion(1));
+
+		// The source moves on, the copy keeps describing the old contents:
+		Buffer.SetBlock({ 1, 0, 0 }, 2);
+		TEST_NOTEQUAL(Copy.GetSectionVersion(0), Buffer.GetSectionVersion(0));
+		TEST_EQUAL(Copy.GetSectionVersion(1), Buffer.GetSectionVersion(1));
+
+		// A modified copy must not reach a version its source already used for different contents:
+		ChunkBlockData Copy2;
+		Copy2.Assign(Copy);
+		Copy2.SetBlock({ 2, 0, 0 }, 3);
+		TEST_NOTEQUAL(Copy2.GetSectionVersion(0), Buffer.GetSectionVersion(0));
+		TEST_NOTEQUAL(Copy2.GetSectionVersion(1), Buffer.GetSectionVersion(1));
+	}
+
+	{
+		// Light data tracks its versions the same way:
+		ChunkLightData::SectionType Dark, Full;
+		std::fill(std::begin(Dark), std::end(Dark), NIBBLETYPE(0x00));
+		std::fill(std::begin(Full), std::end(Full), NIBBLETYPE(0xff));
+
+		ChunkLightData Buffer;
+		const auto Before = Buffer.GetSectionVersion(3);
+		Buffer.SetSection(Dark, Full, 3);
+		TEST_NOTEQUAL(Buffer.GetSectionVersion(3), Before);
+
+		ChunkLightData Copy;
+		Copy.Assign(Buffer);
+		TEST_EQUAL(Copy.GetSectionVersion(3), Buffer.GetSectionVersion(3));
+	}
+
+	{
+		// The chunk data must be nothrow-movable, so that the containers move it instead of copying:
+		static_assert(std::is_nothrow_move_constructible_v<ChunkBlockData>);
+		static_assert(std::is_nothrow_move_assignable_v<ChunkBlockData>);
+		static_assert(std::is_nothrow_move_constructible_v<ChunkLightData>);
+		static_assert(std::is_nothrow_move_assignable_v<ChunkLightData>);
+
+		// A moved-to object takes over the versions, the moved-from one never reaches them again:
+		ChunkBlockData Buffer;
+		Buffer.SetBlock({ 0, 0, 0 }, 1);
+		const auto Before = Buffer.GetSectionVersion(0);
+		ChunkBlockData Moved(std::move(Buffer));
+		TEST_EQUAL(Moved.GetSectionVersion(0), Before);
+		Buffer.SetBlock({ 0, 0, 0 }, 2);  // Reuse the moved-from object
+		TEST_NOTEQUAL(Buffer.GetSectionVersion(0), Moved.GetSectionVersion(0));
+		Moved.SetBlock({ 1, 0, 0 }, 3);
+		TEST_NOTEQUAL(Buffer.GetSectionVersion(0), Moved.GetSectionVersion(0));
+
+		ChunkBlockData Assigned;
+		Assigned = std::move(Moved);
+		TEST_EQUAL(Assigned.GetBlock({ 1, 0, 0 }), 3);
+	}
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ChunkData Versions",
+	Test()
+);
@@ -0,0 +1,320 @@
+// ParallelTick.cpp
+
+// Tests ticking the chunks in parallel with cChunkTickWorkers, the way cChunkMap::Tick() does, with entities crossing the region borders
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "ChunkTickWorkers.h"
+
+
+
+
+
+/** Number of ticking threads, including the tick thread. */
+static const unsigned NUM_THREADS = 4;
+
+/** Number of ticks to run. */
+static const int NUM_TICKS = 40;
+
+
+
+
+
+class cTestChunkMap;
+
+
+
+
+
+/** An entity that moves by a whole chunk in each tick. */
+struct sEntity
+{
+	int m_ID;
+	cChunkCoords m_Coords;
+	int m_SpeedX, m_SpeedZ;
+};
+
+
+
+
+
+/** A chunk with the same ticking rules as cChunk: it touches only itself and its direct neighbours,
+defers the entities leaving it and locks the chunkmap CS before reaching any further. */
+class cTestChunk
+{
+public:
+
+	cTestChunk(cTestChunkMap & a_ChunkMap, cChunkCoords a_Coords) :
+		m_ChunkMap(a_ChunkMap),
+		m_Coords(a_Coords),
+		m_IsTicking(false),
+		m_NumTicks(0),
+		m_NumNeighborTouches(0)
+	{
+	}
+
+	void Tick(std::chrono::milliseconds a_Dt);
+
+	cTestChunkMap & m_ChunkMap;
+	cChunkCoords m_Coords;
+	std::vector<sEntity> m_Entities;
+
+	/** Set while the chunk is being ticked, checked by the neighbours. */
+	std::atomic<bool> m_IsTicking;
+
+	/** Number of times the chunk has been ticked. */
+	int m_NumTicks;
+
+	/** Number of times the neighbours' ticks touched this chunk, a non-atomic value that would race if the neighbours were ticked in parallel. */
+	int m_NumNeighborTouches;
+};
+
+
+
+
+
+/** The chunks and the parallel tick, with the merge phase of cChunkMap::TickInParallel(). */
+class cTestChunkMap
+{
+public:
+
+	cTestChunkMap(unsigned a_NumThreads):
+		m_IsTickingInParallel(false),
+		m_HasOverlapped(false),
+		m_NumConstructedInParallel(0),
+		m_NumFarAccesses(0)
+	{
+		if (a_NumThreads > 1)
+		{
+			m_TickWorkers = std::make_unique<cChunkTickWorkers<cTestChunk>>(m_CS, a_NumThreads);
+		}
+	}
+
+
+	cTestChunk & ConstructChunk(cChunkCoords a_Coords)
+	{
+		if (m_IsTickingInParallel)
+		{
+			m_NumConstructedInParallel += 1;
+		}
+		return m_Chunks.try_emplace(a_Coords, *this, a_Coords).first->second;
+	}
+
+
+	cTestChunk * FindChunk(cChunkCoords a_Coords)
+	{
+		const auto Chunk = m_Chunks.find(a_Coords);
+		return (Chunk == m_Chunks.end()) ? nullptr : &Chunk->second;
+	}
+
+
+	void AddEntity(const sEntity & a_Entity)
+	{
+		ConstructChunk(a_Entity.m_Coords).m_Entities.push_back(a_Entity);
+	}
+
+
+	void DeferEntityMove(const sEntity & a_Entity)
+	{
+		std::scoped_lock Lock(m_CSDeferred);
+		m_DeferredEntityMoves.push_back(a_Entity);
+	}
+
+
+	/** Ticks all the chunks once, in parallel if there are any workers. */
+	void Tick(void)
+	{
+		cCSLock Lock(m_CS);
+		cChunkTickWorkers<cTestChunk>::cChunks ChunksToTick;
+		for (auto & Chunk : m_Chunks)
+		{
+			ChunksToTick.emplace_back(Chunk.first, &Chunk.second);
+		}
+
+		if (m_TickWorkers == nullptr)
+		{
+			for (const auto & Chunk : ChunksToTick)
+			{
+				Chunk.second->Tick(std::chrono::milliseconds(50));
+			}
+		}
+		else
+		{
+			m_IsTickingInParallel = true;
+			m_TickWorkers->Tick(ChunksToTick, std::chrono::milliseconds(50));
+			m_IsTickingInParallel = false;
+		}
+
+		// Merge phase, the entities may move into chunks that don't exist yet:
+		for (const auto & Entity : m_DeferredEntityMoves)
+		{
+			AddEntity(Entity);
+		}
+		m_DeferredEntityMoves.clear();
+	}
+
+
+	/** Returns the coords of all the entities, indexed by their IDs. */
+	std::map<int, cChunkCoords> GetEntityCoords(void)
+	{
+		std::map<int, cChunkCoords> Res;
+		for (const auto & Chunk : m_Chunks)
+		{
+			for (const auto & Entity : Chunk.second.m_Entities)
+			{
+				TEST_TRUE(Entity.m_Coords == Chunk.first);
+				TEST_TRUE(Res.emplace(Entity.m_ID, Entity.m_Coords).second);
+			}
+		}
+		return Res;
+	}
+
+
+	cCriticalSection m_CS;
+	std::unordered_map<cChunkCoords, cTestChunk, cChunkCoordsHash> m_Chunks;
+	std::unique_ptr<cChunkTickWorkers<cTestChunk>> m_TickWorkers;
+	bool m_IsTickingInParallel;
+
+	std::mutex m_CSDeferred;
+	std::vector<sEntity> m_DeferredEntityMoves;
+
+	/** Set if two neighbouring chunks were ticked at the same time. */
+	std::atomic<bool> m_HasOverlapped;
+
+	/** Number of chunks constructed while the workers were running. */
+	std::atomic<int> m_NumConstructedInParallel;
+
+	/** Number of accesses to the far chunks, non-atomic, counted only with the CS locked. */
+	int m_NumFarAccesses;
+};
+
+
+
+
+
+void cTestChunk::Tick(std::chrono::milliseconds a_Dt)
+{
+	m_IsTicking = true;
+	m_NumTicks += 1;
+
+	// Take a while, so that the neighbours would overlap if they were ticked in parallel:
+	std::this_thread::sleep_for(std::chrono::microseconds(20));
+
+	// Touch the direct neighbours, no other thread may be ticking them:
+	for (int x = -1; x <= 1; x++)
+	{
+		for (int z = -1; z <= 1; z++)
+		{
+			const auto Neighbor = m_ChunkMap.FindChunk({ m_Coords.m_ChunkX + x, m_Coords.m_ChunkZ + z });
+			if ((Neighbor == nullptr) || (Neighbor == this))
+			{
+				continue;
+			}
+			if (Neighbor->m_IsTicking)
+			{
+				m_ChunkMap.m_HasOverlapped = true;
+			}
+			Neighbor->m_NumNeighborTouches += 1;
+		}
+	}
+
+	// Reach a far chunk under the lock, as with cChunkMap::AccessFarChunks():
+	if (((m_Coords.m_ChunkX + m_Coords.m_ChunkZ) % 3) == 0)
+	{
+		cCSLock Lock(m_ChunkMap.m_CS);
+		m_ChunkMap.m_NumFarAccesses += 1;
+	}
+
+	// Move the entities, deferring them like cChunk::Tick() does while ticking in parallel.
+	// Deferred in the serial tick, too, so that no entity moves twice in a tick and the results can be compared:
+	for (auto itr = m_Entities.begin(); itr != m_Entities.end();)
+	{
+		itr->m_Coords.m_ChunkX += itr->m_SpeedX;
+		itr->m_Coords.m_ChunkZ += itr->m_SpeedZ;
+		if (itr->m_Coords == m_Coords)
+		{
+			++itr;
+			continue;
+		}
+		m_ChunkMap.DeferEntityMove(*itr);
+		itr = m_Entities.erase(itr);
+	}
+
+	m_IsTicking = false;
+}
+
+
+
+
+
+/** Creates the chunks and the entities that move across the region borders in all directions. */
+static void InitChunkMap(cTestChunkMap & a_ChunkMap)
+{
+	int ID = 0;
+	for (int x = -6; x < 6; x++)
+	{
+		for (int z = -6; z < 6; z++)
+		{
+			a_ChunkMap.ConstructChunk({ x, z });
+			if (((x + z) & 1) == 0)
+			{
+				// Entities moving in all directions, some of them staying put, and entities moving towards +X that construct new chunks:
+				a_ChunkMap.AddEntity({ ID++, { x, z }, (x % 3) - 1, (z % 3) - 1 });
+				a_ChunkMap.AddEntity({ ID++, { x, z }, 1, 0 });
+			}
+		}
+	}
+}
+
+
+
+
+
+/** Ticks the chunks in parallel, checks that no neighbours were ticked at the same time, no chunk was constructed by the workers,
+and the entities moved the same way as with the serial tick. */
+static void TestAgainstSerialTick(void)
+{
+	cTestChunkMap Serial(1), Parallel(NUM_THREADS);
+	InitChunkMap(Serial);
+	InitChunkMap(Parallel);
+
+	int ExpectedFarAccesses = 0;
+	for (int i = 0; i < NUM_TICKS; i++)
+	{
+		const auto NumChunksBefore = Parallel.m_Chunks.size();
+		for (const auto & Chunk : Parallel.m_Chunks)
+		{
+			if (((Chunk.first.m_ChunkX + Chunk.first.m_ChunkZ) % 3) == 0)
+			{
+				ExpectedFarAccesses += 1;
+			}
+		}
+
+		Serial.Tick();
+		Parallel.Tick();
+
+		TEST_FALSE(Parallel.m_HasOverlapped.load());
+		TEST_EQUAL(Parallel.m_NumConstructedInParallel.load(), 0);
+		TEST_EQUAL(Parallel.m_NumFarAccesses, ExpectedFarAccesses);
+		TEST_GREATER_THAN_OR_EQUAL(Parallel.m_Chunks.size(), NumChunksBefore);
+		TEST_TRUE(Serial.GetEntityCoords() == Parallel.GetEntityCoords());
+	}
+
+	// The moving entities have constructed new chunks, all of them have been ticked since:
+	TEST_GREATER_THAN_OR_EQUAL(Parallel.m_Chunks.size(), 12U * 12U + NUM_TICKS);
+	for (const auto & Chunk : Parallel.m_Chunks)
+	{
+		const auto Other = Serial.m_Chunks.find(Chunk.first);
+		TEST_TRUE(Other != Serial.m_Chunks.end());
+		TEST_EQUAL(Chunk.second.m_NumTicks, Other->second.m_NumTicks);
+		TEST_EQUAL(Chunk.second.m_NumNeighborTouches, Other->second.m_NumNeighborTouches);
+	}
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ParallelTick",
+	TestAgainstSerialTick();
+)
@@ -1,4 +1,6 @@
 #include "Globals.h"
+#include "ChunkGeneratorThread.h"
+#include "Generating/ChunkDataCache.h"
 #include "Generating/ChunkGenerator.h"
 #include "Generating/ChunkDesc.h"
 #include "../TestHelpers.h"
@@ -305,6 +307,241 @@ static void testRepeatability(cChunkGenerator & aDefaultOverworldGenerator, cChu
 
 
 
+/** Returns the coords of the chunks generated by the multi-generator tests, an 8 * 8 area around the origin. */
+static std::vector<cChunkCoords> testAreaCoords(void)
+{
+	std::vector<cChunkCoords> coords;
+	for (int chunkZ = -4; chunkZ < 4; ++chunkZ)
+	{
+		for (int chunkX = -4; chunkX < 4; ++chunkX)
+		{
+			coords.emplace_back(chunkX, chunkZ);
+		}
+	}
+	return coords;
+}
+
+
+
+
+
+/** Creates a new full default Overworld generator, including the finishers and structures,
+and generates the chunks in the order given by the iterators.
+The generator uses aCaches if given, its own caches otherwise.
+Returns the SHA1 checksums of the generated chunks. */
+template <typename Iterator>
+static std::map<cChunkCoords, AString> generateChecksums(std::shared_ptr<cGeneratorCaches> aCaches, Iterator aBegin, Iterator aEnd)
+{
+	cIniFile ini;
+	ini.AddValue("General", "Dimension", "Overworld");
+	ini.AddValueI("Seed", "Seed", 1);
+	auto gen = cChunkGenerator::CreateFromIniFile(ini, std::move(aCaches));
+	TEST_NOTEQUAL(gen, nullptr);
+
+	std::map<cChunkCoords, AString> checksums;
+	for (auto itr = aBegin; itr != aEnd; ++itr)
+	{
+		cChunkDesc chd(*itr);
+		gen->Generate(chd);
+		checksums[*itr] = chunkSHA1(chd);
+	}
+	return checksums;
+}
+
+
+
+
+
+/** Checks that separate generator instances, created from the same settings, generate the same chunks
+regardless of the order in which the chunks are generated.
+The chunk generator threads rely on this to produce the same world with any number of workers. */
+static void testOrderIndependence(void)
+{
+	LOG("Testing the order independence of the Overworld generator");
+
+	const auto coords = testAreaCoords();
+	auto forwardChecksums = generateChecksums(nullptr, coords.begin(), coords.end());
+	auto backwardChecksums = generateChecksums(nullptr, coords.rbegin(), coords.rend());
+
+	for (const auto & chunkCoords: coords)
+	{
+		TEST_EQUAL_MSG(backwardChecksums[chunkCoords], forwardChecksums[chunkCoords],
+			fmt::format(FMT_STRING("Chunk {} SHA1 differs when generated in reverse order"), chunkCoords.ToString())
+		);
+	}
+}
+
+
+
+
+
+/** Checks that generators sharing their caches, generating at the same time in separate threads,
+generate the same chunks as a generator with caches of its own. */
+static void testSharedCaches(void)
+{
+	LOG("Testing the generators with shared caches");
+
+	const auto coords = testAreaCoords();
+	auto referenceChecksums = generateChecksums(nullptr, coords.begin(), coords.end());
+
+	// Generate the chunks in both orders at the same time, the threads meet in the middle and share the cached data:
+	auto caches = std::make_shared<cGeneratorCaches>();
+	std::map<cChunkCoords, AString> forwardChecksums;
+	std::thread forwardThread([&]()
+		{
+			forwardChecksums = generateChecksums(caches, coords.begin(), coords.end());
+		}
+	);
+	auto backwardChecksums = generateChecksums(caches, coords.rbegin(), coords.rend());
+	forwardThread.join();
+
+	for (const auto & chunkCoords: coords)
+	{
+		TEST_EQUAL_MSG(forwardChecksums[chunkCoords], referenceChecksums[chunkCoords],
+			fmt::format(FMT_STRING("Chunk {} SHA1 differs when generated with shared caches"), chunkCoords.ToString())
+		);
+		TEST_EQUAL_MSG(backwardChecksums[chunkCoords], referenceChecksums[chunkCoords],
+			fmt::format(FMT_STRING("Chunk {} SHA1 differs when generated with shared caches"), chunkCoords.ToString())
+		);
+	}
+
+	// The second generator to reach a chunk should have found its biomes in the cache:
+	TEST_GREATER_THAN_OR_EQUAL(caches->GetStatistics().m_Biomes.m_NumHits, coords.size());
+}
+
+
+
+
+
+/** The chunk sink and the plugin interface for the generator thread tests.
+Stores the checksums of the generated chunks and checks that the plugin hooks are never called in parallel. */
+class cTestChunkSink:
+	public cChunkGeneratorThread::cChunkSink,
+	public cChunkGeneratorThread::cPluginInterface
+{
+public:
+
+	cTestChunkSink(size_t aNumExpected):
+		mNumExpected(aNumExpected),
+		mNumInHooks(0),
+		mHaveHooksOverlapped(false)
+	{
+	}
+
+	/** Waits until all the expected chunks have been generated. */
+	void waitForAll(void)
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mAllGenerated.wait(lock, [this]() { return mChecksums.size() >= mNumExpected; });
+	}
+
+	/** Number of the chunks to be generated. */
+	size_t mNumExpected;
+
+	/** Protects mChecksums. */
+	std::mutex mMutex;
+
+	/** Signalled when all the expected chunks have been generated. */
+	std::condition_variable mAllGenerated;
+
+	/** The checksums of the generated chunks. */
+	std::map<cChunkCoords, AString> mChecksums;
+
+	/** Number of the threads currently inside a plugin hook. */
+	std::atomic<int> mNumInHooks;
+
+	/** Set if two threads were inside the plugin hooks at the same time. */
+	std::atomic<bool> mHaveHooksOverlapped;
+
+
+	/** Simulates a plugin hook that takes a while, so that the generator threads would overlap in it if it wasn't serialized. */
+	void callHook(void)
+	{
+		if (++mNumInHooks > 1)
+		{
+			mHaveHooksOverlapped = true;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+		--mNumInHooks;
+	}
+
+	// cChunkGeneratorThread::cPluginInterface overrides:
+	virtual void CallHookChunkGenerating(cChunkDesc &) override { callHook(); }
+	virtual void CallHookChunkGenerated(cChunkDesc &) override { callHook(); }
+
+	// cChunkGeneratorThread::cChunkSink overrides:
+	virtual void OnChunkGenerated(cChunkDesc & aChunkDesc) override
+	{
+		auto checksum = chunkSHA1(aChunkDesc);
+		std::lock_guard<std::mutex> lock(mMutex);
+		mChecksums[{aChunkDesc.GetChunkX(), aChunkDesc.GetChunkZ()}] = checksum;
+		if (mChecksums.size() >= mNumExpected)
+		{
+			mAllGenerated.notify_all();
+		}
+	}
+	virtual bool IsChunkValid(cChunkCoords) override { return false; }
+	virtual bool HasChunkAnyClients(cChunkCoords) override { return true; }
+	virtual bool IsChunkQueued(cChunkCoords) override { return true; }
+};
+
+
+
+
+
+/** Generates the test area chunks in a cChunkGeneratorThread with the specified number of workers.
+Returns the SHA1 checksums of the generated chunks. */
+static std::map<cChunkCoords, AString> generateChecksumsInThread(unsigned aNumWorkers)
+{
+	const auto coords = testAreaCoords();
+	cTestChunkSink sink(coords.size());
+	cIniFile ini;
+	ini.AddValue("General", "Dimension", "Overworld");
+	ini.AddValueI("Seed", "Seed", 1);
+	cChunkGeneratorThread generator;
+	TEST_TRUE(generator.Initialize(sink, sink, ini, aNumWorkers));
+	TEST_EQUAL(generator.GetNumWorkers(), aNumWorkers);
+	generator.Start();
+	for (const auto & chunkCoords: coords)
+	{
+		generator.QueueGenerateChunk(chunkCoords, false);
+	}
+	sink.waitForAll();
+	generator.Stop();
+
+	// The seed is still available after the generators have been destroyed:
+	TEST_EQUAL(generator.GetSeed(), 1);
+	TEST_FALSE(sink.mHaveHooksOverlapped.load());
+	return sink.mChecksums;
+}
+
+
+
+
+
+/** Checks that the generator thread generates the same chunks with several workers as with a single one,
+and that the workers never call the plugin hooks in parallel. */
+static void testGeneratorThread(void)
+{
+	LOG("Testing the generator thread with multiple workers");
+
+	const auto coords = testAreaCoords();
+	auto singleChecksums = generateChecksumsInThread(1);
+	auto multiChecksums = generateChecksumsInThread(4);
+	TEST_EQUAL(singleChecksums.size(), coords.size());
+	TEST_EQUAL(multiChecksums.size(), coords.size());
+	for (const auto & chunkCoords: coords)
+	{
+		TEST_EQUAL_MSG(multiChecksums[chunkCoords], singleChecksums[chunkCoords],
+			fmt::format(FMT_STRING("Chunk {} SHA1 differs when generated by multiple workers"), chunkCoords.ToString())
+		);
+	}
+}
+
+
+
+
+
 IMPLEMENT_TEST_MAIN("BasicGeneratorTest",
 	// Create a default Overworld generator:
 	cIniFile iniOverworld;
@@ -325,4 +562,7 @@ IMPLEMENT_TEST_MAIN("BasicGeneratorTest",
 	testGenerateOverworld(*defaultOverworldGen);
 	testGenerateNether(*defaultNetherGen);
 	testRepeatability(*defaultOverworldGen, *defaultNetherGen);
+	testOrderIndependence();
+	testSharedCaches();
+	testGeneratorThread();
 )
@@ -40,6 +40,90 @@ static int DoLoaderTest(void)
 
 
 
+/** Checks that the pool loaded from the binary cache is the same as the pool loaded from the cubeset. */
+static int DoCacheTest(void)
+{
+	const AString FileName = "TestCached.cubeset";
+	const AString CacheFileName = FileName + ".cache";
+	cFile::DeleteFile(CacheFileName);
+
+	// The first load parses the cubeset and creates the cache:
+	cPrefabPiecePool source;
+	TEST_TRUE(source.LoadFromFile(FileName, true));
+	TEST_TRUE(cFile::IsFile(CacheFileName));
+
+	// The second load uses the cache:
+	cPrefabPiecePool cached;
+	TEST_TRUE(cached.LoadFromFile(FileName, true));
+	cFile::DeleteFile(CacheFileName);
+
+	TEST_EQUAL(cached.GetAllPiecesCount(), source.GetAllPiecesCount());
+	TEST_EQUAL(cached.GetStartingPiecesCount(), source.GetStartingPiecesCount());
+	TEST_EQUAL(cached.GetIntendedUse(), "Test");
+	TEST_EQUAL(cached.GetPiecesWithConnector(2).size(), source.GetPiecesWithConnector(2).size());
+
+	// Compare the pieces:
+	auto sourcePieces = source.GetStartingPieces();
+	auto cachedPieces = cached.GetStartingPieces();
+	auto sourceRegular = source.GetPiecesWithConnector(2);
+	auto cachedRegular = cached.GetPiecesWithConnector(2);
+	sourcePieces.insert(sourcePieces.end(), sourceRegular.begin(), sourceRegular.end());
+	cachedPieces.insert(cachedPieces.end(), cachedRegular.begin(), cachedRegular.end());
+	for (size_t i = 0; i < sourcePieces.size(); i++)
+	{
+		const auto & sourcePrefab = static_cast<const cPrefab &>(*sourcePieces[i]);
+		const auto & cachedPrefab = static_cast<const cPrefab &>(*cachedPieces[i]);
+		TEST_EQUAL(cachedPrefab.GetDefaultWeight(), sourcePrefab.GetDefaultWeight());
+		TEST_EQUAL(cachedPrefab.ShouldMoveToGround(), sourcePrefab.ShouldMoveToGround());
+		TEST_EQUAL(cachedPieces[i]->GetHitBox(), sourcePieces[i]->GetHitBox());  // GetHitBox() and GetConnectors() are private in cPrefab
+		TEST_EQUAL(cachedPieces[i]->GetConnectors().size(), sourcePieces[i]->GetConnectors().size());
+		TEST_EQUAL((cachedPrefab.GetVerticalStrategy() == nullptr), (sourcePrefab.GetVerticalStrategy() == nullptr));
+
+		const auto & sourceArea = sourcePrefab.GetBlockArea();
+		const auto & cachedArea = cachedPrefab.GetBlockArea();
+		TEST_EQUAL(cachedArea.GetSize(), sourceArea.GetSize());
+		auto numBlocks = sourceArea.GetBlockCount();
+		TEST_TRUE(std::equal(sourceArea.GetBlockTypes(), sourceArea.GetBlockTypes() + numBlocks, cachedArea.GetBlockTypes()));
+		TEST_TRUE(std::equal(sourceArea.GetBlockMetas(), sourceArea.GetBlockMetas() + numBlocks, cachedArea.GetBlockMetas()));
+	}
+	return 0;
+}
+
+
+
+
+
+/** Checks that a copied pool shares the block data with its source, but has its own placement strategies. */
+static int DoCopyTest(void)
+{
+	cPrefabPiecePool source;
+	TEST_TRUE(source.LoadFromFile("TestCached.cubeset", true));
+	cPrefabPiecePool copy;
+	copy.CopyFrom(source);
+
+	TEST_EQUAL(copy.GetAllPiecesCount(), source.GetAllPiecesCount());
+	TEST_EQUAL(copy.GetStartingPiecesCount(), source.GetStartingPiecesCount());
+	TEST_EQUAL(copy.GetIntendedUse(), source.GetIntendedUse());
+	TEST_EQUAL(copy.GetPiecesWithConnector(2).size(), source.GetPiecesWithConnector(2).size());
+
+	auto sourcePieces = source.GetStartingPieces();
+	auto copyPieces = copy.GetStartingPieces();
+	TEST_EQUAL(copyPieces.size(), sourcePieces.size());
+	for (size_t i = 0; i < sourcePieces.size(); i++)
+	{
+		const auto & sourcePrefab = static_cast<const cPrefab &>(*sourcePieces[i]);
+		const auto & copyPrefab = static_cast<const cPrefab &>(*copyPieces[i]);
+		TEST_EQUAL(&copyPrefab.GetBlockArea(), &sourcePrefab.GetBlockArea());
+		TEST_NOTEQUAL(copyPrefab.GetVerticalStrategy(), nullptr);
+		TEST_NOTEQUAL(copyPrefab.GetVerticalStrategy(), sourcePrefab.GetVerticalStrategy());
+	}
+	return 0;
+}
+
+
+
+
+
 static int DoParserTest(void)
 {
 	// Create one static prefab to test the parser:
@@ -168,6 +252,22 @@ int main(int argc, char * argv[])
 		return res;
 	}
 
+	// Run the Cache test:
+	res = DoCacheTest();
+	LOG("cPrefabPiecePool cache test done: %s", (res == 0) ? "success" : "failure");
+	if (res != 0)
+	{
+		return res;
+	}
+
+	// Run the Copy test:
+	res = DoCopyTest();
+	LOG("cPrefabPiecePool copy test done: %s", (res == 0) ? "success" : "failure");
+	if (res != 0)
+	{
+		return res;
+	}
+
 	// Run the Parser test:
 	res = DoParserTest();
 	LOG("cPrefab parser test done: %s", (res == 0) ? "success" : "failure");
@@ -0,0 +1,331 @@
+// IncrementalLighting.cpp
+
+// Tests the cIncrementalLighting class by comparing its results to the full relight done by cChunkLighter
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "BlockType.h"
+#include "ChunkDataCallback.h"
+#include "ChunkLighter.h"
+#include "IncrementalLighting.h"
+
+
+
+
+
+/** The chunks of a small world, 5 * 5 chunks around the chunk [0, 0], so that all the 3x3 chunks around [0, 0]
+have all their neighbors for the full relight. */
+class cTestWorld
+{
+public:
+
+	static constexpr int Radius = 2;
+	static constexpr int Size = 2 * Radius + 1;
+
+
+	cTestWorld(void):
+		m_Lighter(std::make_unique<cChunkLighter>())
+	{
+		// Stone ground up to Y 60, with a stone roof at Y 70 over an open-sided area spanning the border of the chunks [0, 0] and [1, 0]:
+		for (auto & Chunk : m_Chunks)
+		{
+			for (int y = 0; y <= 60; y++)
+			{
+				for (int z = 0; z < cChunkDef::Width; z++)
+				{
+					for (int x = 0; x < cChunkDef::Width; x++)
+					{
+						Chunk.m_BlockData.SetBlock({ x, y, z }, E_BLOCK_STONE);
+					}
+				}
+			}
+		}
+		for (int z = 4; z < 12; z++)
+		{
+			for (int x = 8; x < 24; x++)
+			{
+				SetBlock({ x, 70, z }, E_BLOCK_STONE);
+			}
+		}
+		RelightAll();
+	}
+
+
+	/** Sets the block at the position relative to the chunk [0, 0]. */
+	void SetBlock(Vector3i a_RelPos, BLOCKTYPE a_BlockType)
+	{
+		auto & Chunk = GetChunk(a_RelPos);
+		Chunk.m_BlockData.SetBlock(a_RelPos, a_BlockType);
+	}
+
+
+	/** Calculates the full light of the 3x3 chunks around the chunk [0, 0]. */
+	void RelightAll(void)
+	{
+		for (int z = -1; z <= 1; z++)
+		{
+			for (int x = -1; x <= 1; x++)
+			{
+				auto Light = std::make_unique<sLight>();
+				m_Lighter->Light({ x, z }, [this](cChunkCoords a_Coords, cChunkDataCallback & a_Callback)
+					{
+						return GetChunkData(a_Coords, a_Callback);
+					},
+					Light->m_BlockLight, Light->m_SkyLight
+				);
+				GetChunk(x, z).m_LightData.SetAll(Light->m_BlockLight, Light->m_SkyLight);
+			}
+		}
+	}
+
+
+	/** Returns the 3x3 chunks around the chunk [0, 0], for the incremental update. */
+	cIncrementalLighting::cNeighborhood GetNeighborhood(void)
+	{
+		cIncrementalLighting::cNeighborhood Res;
+		for (size_t x = 0; x < 3; x++)
+		{
+			for (size_t z = 0; z < 3; z++)
+			{
+				auto & Chunk = GetChunk(static_cast<int>(x) - 1, static_cast<int>(z) - 1);
+				Res[x][z] = { &Chunk.m_BlockData, &Chunk.m_LightData, false };
+			}
+		}
+		return Res;
+	}
+
+
+	/** Returns a copy of the light of the 3x3 chunks around the chunk [0, 0], indexed by [OffsetX + 1][OffsetZ + 1]. */
+	std::array<std::array<ChunkLightData, 3>, 3> CopyLight(void)
+	{
+		std::array<std::array<ChunkLightData, 3>, 3> Res;
+		for (size_t x = 0; x < 3; x++)
+		{
+			for (size_t z = 0; z < 3; z++)
+			{
+				Res[x][z].Assign(GetChunk(static_cast<int>(x) - 1, static_cast<int>(z) - 1).m_LightData);
+			}
+		}
+		return Res;
+	}
+
+
+protected:
+
+	struct sChunk
+	{
+		ChunkBlockData m_BlockData;
+		ChunkLightData m_LightData;
+	};
+
+	/** The light calculated by cChunkLighter, too large for the stack. */
+	struct sLight
+	{
+		cChunkDef::BlockNibbles m_BlockLight;
+		cChunkDef::BlockNibbles m_SkyLight;
+	};
+
+	sChunk m_Chunks[Size * Size];
+
+	std::unique_ptr<cChunkLighter> m_Lighter;
+
+
+	sChunk & GetChunk(int a_ChunkX, int a_ChunkZ)
+	{
+		ASSERT((std::abs(a_ChunkX) <= Radius) && (std::abs(a_ChunkZ) <= Radius));
+		return m_Chunks[(a_ChunkX + Radius) + (a_ChunkZ + Radius) * Size];
+	}
+
+
+	/** Returns the chunk containing the position relative to the chunk [0, 0], and adjusts the position to be relative to it. */
+	sChunk & GetChunk(Vector3i & a_RelPos)
+	{
+		const auto Coords = cChunkDef::BlockToChunk(a_RelPos);
+		a_RelPos.x -= Coords.m_ChunkX * cChunkDef::Width;
+		a_RelPos.z -= Coords.m_ChunkZ * cChunkDef::Width;
+		return GetChunk(Coords.m_ChunkX, Coords.m_ChunkZ);
+	}
+
+
+	/** Provides the chunk's blocks and heightmap to cChunkLighter. */
+	bool GetChunkData(cChunkCoords a_Coords, cChunkDataCallback & a_Callback)
+	{
+		const auto & Chunk = GetChunk(a_Coords.m_ChunkX, a_Coords.m_ChunkZ);
+		cChunkDef::HeightMap HeightMap;
+		for (int z = 0; z < cChunkDef::Width; z++)
+		{
+			for (int x = 0; x < cChunkDef::Width; x++)
+			{
+				int y = cChunkDef::Height - 1;
+				while ((y > 0) && (Chunk.m_BlockData.GetBlock({ x, y, z }) == E_BLOCK_AIR))
+				{
+					y--;
+				}
+				cChunkDef::SetHeight(HeightMap, x, z, static_cast<HEIGHTTYPE>(y));
+			}
+		}
+		a_Callback.ChunkData(Chunk.m_BlockData, Chunk.m_LightData);
+		a_Callback.HeightMap(HeightMap);
+		return true;
+	}
+};
+
+
+
+
+
+/** Checks that the light of the 3x3 chunks around the chunk [0, 0] is the same in a_Expected and a_Actual. */
+static void CompareLight(
+	const std::array<std::array<ChunkLightData, 3>, 3> & a_Expected,
+	const std::array<std::array<ChunkLightData, 3>, 3> & a_Actual,
+	const char * a_Description
+)
+{
+	for (size_t cx = 0; cx < 3; cx++)
+	{
+		for (size_t cz = 0; cz < 3; cz++)
+		{
+			for (int y = 0; y < cChunkDef::Height; y++)
+			{
+				for (int z = 0; z < cChunkDef::Width; z++)
+				{
+					for (int x = 0; x < cChunkDef::Width; x++)
+					{
+						const Vector3i Pos(x, y, z);
+						TEST_EQUAL_MSG(a_Actual[cx][cz].GetBlockLight(Pos), a_Expected[cx][cz].GetBlockLight(Pos),
+							fmt::format(FMT_STRING("{}: block light differs in chunk [{}, {}] at {}"), a_Description, static_cast<int>(cx) - 1, static_cast<int>(cz) - 1, Pos)
+						);
+						TEST_EQUAL_MSG(a_Actual[cx][cz].GetSkyLight(Pos), a_Expected[cx][cz].GetSkyLight(Pos),
+							fmt::format(FMT_STRING("{}: skylight differs in chunk [{}, {}] at {}"), a_Description, static_cast<int>(cx) - 1, static_cast<int>(cz) - 1, Pos)
+						);
+					}
+				}
+			}
+		}
+	}
+}
+
+
+
+
+
+/** Applies the block changes to the world, updates the light incrementally and compares it to the full relight. */
+static void TestChanges(
+	cTestWorld & a_World,
+	cIncrementalLighting & a_Lighting,
+	const std::vector<std::pair<Vector3i, BLOCKTYPE>> & a_Changes,
+	const char * a_Description
+)
+{
+	LOGD("Testing %s", a_Description);
+	std::vector<Vector3i> Positions;
+	for (const auto & Change : a_Changes)
+	{
+		a_World.SetBlock(Change.first, Change.second);
+		Positions.push_back(Change.first);
+	}
+
+	auto Chunks = a_World.GetNeighborhood();
+	TEST_TRUE(a_Lighting.Relight(Chunks, Positions));
+	const auto Incremental = a_World.CopyLight();
+
+	a_World.RelightAll();
+	CompareLight(a_World.CopyLight(), Incremental, a_Description);
+}
+
+
+
+
+
+/** Places and removes blocks across the chunk borders, checks that the light is the same as after a full relight. */
+static void TestAgainstFullRelight(void)
+{
+	cTestWorld World;
+	cIncrementalLighting Lighting;
+
+	// A torch under the roof, next to the border of the chunks [0, 0] and [1, 0]:
+	TestChanges(World, Lighting, {{{ 15, 61, 8 }, E_BLOCK_TORCH }}, "placing a torch");
+	TestChanges(World, Lighting, {{{ 15, 61, 8 }, E_BLOCK_AIR }}, "removing a torch");
+
+	// A torch in the corner of the chunk, its light spreads into three neighbors:
+	TestChanges(World, Lighting, {{{ 0, 61, 0 }, E_BLOCK_TORCH }}, "placing a torch in a corner");
+
+	// An opaque block next to the torch, blocking both the torch's light and the skylight from above:
+	TestChanges(World, Lighting, {{{ 0, 61, 1 }, E_BLOCK_STONE }}, "placing an opaque block");
+	TestChanges(World, Lighting, {{{ 0, 61, 1 }, E_BLOCK_AIR }}, "removing an opaque block");
+
+	// An opaque block in the open sky, casting a shadow across the border:
+	TestChanges(World, Lighting, {{{ 0, 62, 15 }, E_BLOCK_STONE }}, "placing an opaque block in the sky");
+
+	// Closing the side of the roofed area, both kinds of light change at once:
+	std::vector<std::pair<Vector3i, BLOCKTYPE>> Wall;
+	for (int y = 61; y < 70; y++)
+	{
+		for (int z = 4; z < 12; z++)
+		{
+			Wall.push_back({{ 15, y, z }, E_BLOCK_STONE });
+		}
+	}
+	Wall.push_back({{ 14, 61, 8 }, E_BLOCK_GLOWSTONE });
+	TestChanges(World, Lighting, Wall, "building a wall");
+
+	for (auto & Change : Wall)
+	{
+		Change.second = E_BLOCK_AIR;
+	}
+	TestChanges(World, Lighting, Wall, "removing a wall");
+}
+
+
+
+
+
+/** Checks that the changes that cannot be handled incrementally are refused without changing any light. */
+static void TestFallbacks(void)
+{
+	cTestWorld World;
+	cIncrementalLighting Lighting;
+	const auto Before = World.CopyLight();
+
+	// A neighbor that isn't lit:
+	World.SetBlock({ 15, 61, 8 }, E_BLOCK_TORCH);
+	auto Chunks = World.GetNeighborhood();
+	Chunks[2][1].m_BlockData = nullptr;
+	Chunks[2][1].m_LightData = nullptr;
+	TEST_FALSE(Lighting.Relight(Chunks, {{ 15, 61, 8 }}));
+	CompareLight(Before, World.CopyLight(), "missing neighbor");
+
+	// Too many changes:
+	std::vector<Vector3i> Changes;
+	for (int y = 61; y < 70; y++)
+	{
+		for (int z = 0; z < cChunkDef::Width; z++)
+		{
+			for (int x = 0; x < cChunkDef::Width; x++)
+			{
+				World.SetBlock({ x, y, z }, E_BLOCK_GLOWSTONE);
+				Changes.emplace_back(x, y, z);
+			}
+		}
+	}
+	TEST_GREATER_THAN_OR_EQUAL(Changes.size(), cIncrementalLighting::MaxChanges + 1);
+	Chunks = World.GetNeighborhood();
+	TEST_FALSE(Lighting.Relight(Chunks, Changes));
+	CompareLight(Before, World.CopyLight(), "too many changes");
+	for (const auto & Row : Chunks)
+	{
+		for (const auto & Chunk : Row)
+		{
+			TEST_FALSE(Chunk.m_IsChanged);
+		}
+	}
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("IncrementalLighting",
+	TestAgainstFullRelight();
+	TestFallbacks();
+)
@@ -0,0 +1,132 @@
+
+// BorrowedLock.cpp
+
+// Tests lending a cCriticalSection to other threads, as done by the parallel chunk tick
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+
+
+
+
+
+/** Number of borrowing threads, besides the owner. */
+const int NUM_BORROWERS = 4;
+
+/** Number of repetitions of the borrowers' loops. */
+const int NUM_REPETITIONS = 20000;
+
+
+
+
+
+/** Checks that the borrowers locking the CS exclude each other, until they yield. */
+static void TestExclusion()
+{
+	cCriticalSection CS;
+	cCSLock OwnerLock(CS);
+
+	// Values that must never be seen half-updated, and a flag set by a borrower that keeps running alone after unlocking:
+	int Values[2] = { 0, 0 };
+	bool IsRunningAlone = false;
+	std::atomic<bool> IsTorn(false);
+	std::atomic<bool> HasOverlapped(false);
+	std::atomic<int> NumUnlockedAccesses(0);
+
+	auto Borrower = [&]()
+	{
+		CS.BorrowFromOwner();
+		if (CS.IsLockedByCurrentThread())
+		{
+			// Not locked yet, must not count as locking:
+			IsTorn = true;
+		}
+		for (int i = 0; i < NUM_REPETITIONS; ++i)
+		{
+			if ((i % 4) == 0)
+			{
+				// Work that doesn't lock the CS runs in parallel with the other borrowers:
+				NumUnlockedAccesses += 1;
+				continue;
+			}
+			{
+				cCSLock Lock(CS);
+				if (IsRunningAlone)
+				{
+					HasOverlapped = true;
+				}
+				Values[0] += 1;
+				Values[1] += 1;
+				if (Values[0] != Values[1])
+				{
+					IsTorn = true;
+				}
+			}
+
+			// Still running alone until yielding, the other borrowers must not get in:
+			IsRunningAlone = true;
+			if (!CS.IsLockedByCurrentThread())
+			{
+				IsTorn = true;
+			}
+			IsRunningAlone = false;
+			CS.YieldToBorrowers();
+		}
+		CS.ReturnToOwner();
+	};
+
+	std::vector<std::thread> Threads;
+	for (int i = 0; i < NUM_BORROWERS; ++i)
+	{
+		Threads.emplace_back(Borrower);
+	}
+
+	// The owner borrows its own CS, too:
+	Borrower();
+	for (auto & Thread : Threads)
+	{
+		Thread.join();
+	}
+
+	TEST_FALSE(IsTorn.load());
+	TEST_FALSE(HasOverlapped.load());
+	TEST_EQUAL(Values[0], (NUM_BORROWERS + 1) * NUM_REPETITIONS * 3 / 4);
+	TEST_EQUAL(NumUnlockedAccesses.load(), (NUM_BORROWERS + 1) * NUM_REPETITIONS / 4);
+
+	// After the borrowing, the owner still holds the CS:
+	TEST_TRUE(CS.IsLockedByCurrentThread());
+}
+
+
+
+
+
+/** Checks the recursion of the borrowed locks, and the shared locks acting as exclusive for the borrowers. */
+static void TestRecursion()
+{
+	cCriticalSection CS;
+	cCSLock OwnerLock(CS);
+	std::thread Borrower([&CS]()
+	{
+		CS.BorrowFromOwner();
+		{
+			cCSSharedLock Outer(CS);
+			cCSLock Inner(CS);
+			TEST_TRUE(CS.IsLockedByCurrentThread());
+		}
+		TEST_TRUE(CS.IsLockedByCurrentThread());
+		CS.YieldToBorrowers();
+		TEST_FALSE(CS.IsLockedByCurrentThread());
+		CS.ReturnToOwner();
+	});
+	Borrower.join();
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("BorrowedLock",
+	TestExclusion();
+	TestRecursion();
+)
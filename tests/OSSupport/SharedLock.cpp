@@ -0,0 +1,141 @@
+// SharedLock.cpp
+
+// Tests the shared (reader) locking of cCriticalSection
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+
+
+
+
+
+/** Number of repetitions of the thread loops. */
+const int NUM_REPETITIONS = 20000;
+
+
+
+
+
+/** Checks the recursion rules on a single thread. */
+static void TestRecursion()
+{
+	cCriticalSection CS;
+
+	// Shared recursion:
+	{
+		cCSSharedLock Outer(CS);
+		cCSSharedLock Inner(CS);
+		TEST_TRUE(CS.IsLocked());
+		TEST_TRUE(CS.IsLockedByCurrentThread());
+	}
+	TEST_FALSE(CS.IsLocked());
+
+	// Shared inside exclusive acts as a recursive exclusive lock:
+	{
+		cCSLock Outer(CS);
+		cCSSharedLock Inner(CS);
+		TEST_TRUE(CS.IsLockedByCurrentThread());
+	}
+	TEST_FALSE(CS.IsLocked());
+}
+
+
+
+
+
+/** Checks that readers can hold the CS at the same time, while writers exclude everyone. */
+static void TestConcurrency()
+{
+	cCriticalSection CS;
+	CS.EnableStatistics();
+
+	// Two readers at once; the second one would hang if shared locks excluded each other:
+	{
+		cCSSharedLock Lock(CS);
+		std::thread Reader([&CS]()
+		{
+			cCSSharedLock Inner(CS);
+		});
+		Reader.join();
+	}
+
+	// Writers and readers hammering a value that must never be seen half-updated:
+	int Values[2] = { 0, 0 };
+	std::atomic<bool> IsTorn(false);
+	auto Writer = [&]()
+	{
+		for (int i = 0; i < NUM_REPETITIONS; ++i)
+		{
+			cCSLock Lock(CS);
+			Values[0] += 1;
+			Values[1] += 1;
+		}
+	};
+	auto Reader = [&]()
+	{
+		for (int i = 0; i < NUM_REPETITIONS; ++i)
+		{
+			cCSSharedLock Lock(CS);
+			if (Values[0] != Values[1])
+			{
+				IsTorn = true;
+			}
+		}
+	};
+	std::thread Threads[] = { std::thread(Writer), std::thread(Writer), std::thread(Reader), std::thread(Reader) };
+	for (auto & Thread : Threads)
+	{
+		Thread.join();
+	}
+	TEST_FALSE(IsTorn.load());
+	TEST_EQUAL(Values[0], 2 * NUM_REPETITIONS);
+
+	const auto Stats = CS.GetStatistics();
+	TEST_EQUAL(Stats.m_NumExclusiveLocks, 2 * NUM_REPETITIONS);
+	TEST_EQUAL(Stats.m_NumSharedLocks, 2 * NUM_REPETITIONS + 2);
+}
+
+
+
+
+
+/** Checks that a writer gets the CS even while the readers keep overlapping, so that it's never free of readers. */
+static void TestWriterPreference()
+{
+	cCriticalSection CS;
+	std::atomic<bool> HasWriterLocked(false);
+	const auto Deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+	// Each reader holds the CS for a while and relocks right away; with readers preferred, the writer would wait until the deadline:
+	auto Reader = [&]()
+	{
+		while (!HasWriterLocked && (std::chrono::steady_clock::now() < Deadline))
+		{
+			cCSSharedLock Lock(CS);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	};
+	std::thread Readers[] = { std::thread(Reader), std::thread(Reader), std::thread(Reader), std::thread(Reader) };
+
+	// Let the readers get going, then lock exclusively:
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	{
+		cCSLock Lock(CS);
+		HasWriterLocked = (std::chrono::steady_clock::now() < Deadline);
+	}
+	for (auto & Thread : Readers)
+	{
+		Thread.join();
+	}
+	TEST_TRUE(HasWriterLocked.load());
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("SharedLock",
+	TestRecursion();
+	TestConcurrency();
+	TestWriterPreference();
+)
@@ -0,0 +1,508 @@
+// AnvilRegionFiles.cpp
+
+// Tests writing the chunk data into the Anvil region files and reading it back
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "WorldStorage/AnvilRegionFiles.h"
+#include "Endianness.h"
+
+
+
+
+
+/** The folder where the tests create their region files. */
+static const AString g_Folder = "AnvilRegionFilesTest";
+
+/** The region file that holds chunks [0 .. 31, 0 .. 31]. */
+static const AString g_FileName = g_Folder + "/r.0.0.mca";
+
+/** A flush interval long enough that the writer thread never writes during a test. */
+static const unsigned LONG_INTERVAL_MSEC = 3600 * 1000;
+
+
+
+
+
+/** Returns a buffer of the specified size filled with a pattern specific to a_Seed. */
+static ContiguousByteBuffer MakeData(int a_Seed, size_t a_Size)
+{
+	ContiguousByteBuffer Res(a_Size, std::byte(0));
+	for (size_t i = 0; i < a_Size; i++)
+	{
+		Res[i] = static_cast<std::byte>((i * 7 + static_cast<size_t>(a_Seed) * 31) & 0xff);
+	}
+	return Res;
+}
+
+
+
+
+
+/** Creates the storage for g_Folder; its load failures fail the test. */
+static std::unique_ptr<cAnvilRegionFiles> CreateStorage(unsigned a_FlushIntervalMSec, bool a_UseMemoryMap = false)
+{
+	return std::make_unique<cAnvilRegionFiles>(
+		g_Folder, 4, a_FlushIntervalMSec, cAnvilRegionFiles::eSyncPolicy::None, a_UseMemoryMap,
+		[](const cChunkCoords & a_Chunk, const AString & a_Reason, ContiguousByteBufferView)
+		{
+			throw TestException(__FILE__, __LINE__, __FUNCTION__, fmt::format(FMT_STRING("Chunk {} failed to load: {}"), a_Chunk, a_Reason));
+		}
+	);
+}
+
+
+
+
+
+/** Reads the chunk's data through the storage, returns an empty buffer if it's not there. */
+static ContiguousByteBuffer ReadChunk(cAnvilRegionFiles & a_Storage, int a_ChunkX, int a_ChunkZ)
+{
+	cAnvilRegionFiles::sChunkData Data;
+	if (!a_Storage.GetChunkData({ a_ChunkX, a_ChunkZ }, Data))
+	{
+		return {};
+	}
+	const auto View = Data.GetView();
+	return ContiguousByteBuffer(View.begin(), View.end());
+}
+
+
+
+
+
+/** The contents of a region file, parsed directly. */
+struct sRegionFile
+{
+	AString m_Contents;
+
+	sRegionFile():
+		m_Contents(cFile::ReadWholeFile(g_FileName))
+	{
+	}
+
+	/** Returns the big-endian number at the specified offset in the file. */
+	UInt32 GetUInt32(size_t a_Offset) const
+	{
+		TEST_LESS_THAN_OR_EQUAL(a_Offset + 4, m_Contents.size());
+		return NetworkBufToHost<UInt32>(reinterpret_cast<const std::byte *>(m_Contents.data() + a_Offset));
+	}
+
+	/** Returns the first sector of the chunk, as stored in the header. */
+	unsigned GetSector(int a_ChunkX, int a_ChunkZ) const
+	{
+		return GetUInt32(GetIndex(a_ChunkX, a_ChunkZ) * 4) >> 8;
+	}
+
+	/** Returns the number of the chunk's sectors, as stored in the header. */
+	unsigned GetNumSectors(int a_ChunkX, int a_ChunkZ) const
+	{
+		return GetUInt32(GetIndex(a_ChunkX, a_ChunkZ) * 4) & 0xff;
+	}
+
+	UInt32 GetTimeStamp(int a_ChunkX, int a_ChunkZ) const
+	{
+		return GetUInt32(4096 + GetIndex(a_ChunkX, a_ChunkZ) * 4);
+	}
+
+	/** Returns the chunk's data at its location in the file, after checking the length and compression prefix. */
+	ContiguousByteBuffer GetData(int a_ChunkX, int a_ChunkZ) const
+	{
+		const size_t Start = GetSector(a_ChunkX, a_ChunkZ) * 4096;
+		const size_t Length = GetUInt32(Start);
+		TEST_GREATER_THAN_OR_EQUAL(Length, 1);
+		TEST_LESS_THAN_OR_EQUAL(Start + 4 + Length, m_Contents.size());
+		TEST_EQUAL(m_Contents[Start + 4], 2);  // zlib
+		const auto Data = reinterpret_cast<const std::byte *>(m_Contents.data() + Start + 5);
+		return ContiguousByteBuffer(Data, Data + Length - 1);
+	}
+
+	static size_t GetIndex(int a_ChunkX, int a_ChunkZ)
+	{
+		return static_cast<size_t>(a_ChunkX + 32 * a_ChunkZ);
+	}
+};
+
+
+
+
+
+/** Removes the test's region files. */
+static void CleanUp()
+{
+	if (!cFile::IsFolder(g_Folder))
+	{
+		return;
+	}
+	if (cFile::IsFolder(g_FileName))
+	{
+		cFile::DeleteFolder(g_FileName);
+	}
+	cFile::DeleteFolderContents(g_Folder);
+	cFile::DeleteFolder(g_Folder);
+}
+
+
+
+
+
+/** With a zero flush interval, each saved chunk is in the file as soon as it's saved. */
+static void TestImmediateWrite()
+{
+	LOGD("Testing the immediate writes...");
+	CleanUp();
+	{
+		auto Storage = CreateStorage(0);
+		TEST_TRUE(Storage->SetChunkData({ 0, 0 }, MakeData(1, 100)));
+		TEST_TRUE(cFile::IsFile(g_FileName));
+		TEST_EQUAL(sRegionFile().GetData(0, 0), MakeData(1, 100));
+
+		TEST_TRUE(Storage->SetChunkData({ 3, 1 }, MakeData(2, 5000)));
+		sRegionFile File;
+		TEST_EQUAL(File.GetData(3, 1), MakeData(2, 5000));
+		TEST_EQUAL(File.GetSector(0, 0), 2);
+		TEST_EQUAL(File.GetSector(3, 1), 3);
+		TEST_EQUAL(File.GetNumSectors(3, 1), 2);
+
+		const auto Stats = Storage->GetWriteStatistics();
+		TEST_EQUAL(Stats.m_NumFlushes, 2);
+		TEST_EQUAL(Stats.m_NumChunksWritten, 2);
+	}
+
+	// A new storage object reads the chunks back from the file:
+	auto Storage = CreateStorage(0);
+	TEST_EQUAL(ReadChunk(*Storage, 0, 0), MakeData(1, 100));
+	TEST_EQUAL(ReadChunk(*Storage, 3, 1), MakeData(2, 5000));
+	TEST_TRUE(ReadChunk(*Storage, 1, 0).empty());
+}
+
+
+
+
+
+/** With a flush interval, the saved chunks are kept in memory and written together on flush. */
+static void TestBatchedWrite()
+{
+	LOGD("Testing the batched writes...");
+	CleanUp();
+	const auto Start = static_cast<UInt32>(time(nullptr));
+	{
+		auto Storage = CreateStorage(LONG_INTERVAL_MSEC);
+		TEST_TRUE(Storage->SetChunkData({ 5, 3 }, MakeData(1, 100)));
+		TEST_TRUE(Storage->SetChunkData({ 0, 0 }, MakeData(2, 100)));
+		TEST_TRUE(Storage->SetChunkData({ 1, 0 }, MakeData(3, 5000)));
+		TEST_TRUE(Storage->SetChunkData({ 2, 0 }, MakeData(4, 100)));
+		TEST_TRUE(Storage->SetChunkData({ 2, 0 }, MakeData(5, 200)));  // Replaces the queued data
+
+		// Nothing is written yet, the reads are served from the queue:
+		TEST_FALSE(cFile::IsFile(g_FileName));
+		TEST_EQUAL(ReadChunk(*Storage, 5, 3), MakeData(1, 100));
+		TEST_EQUAL(ReadChunk(*Storage, 2, 0), MakeData(5, 200));
+		TEST_EQUAL(Storage->GetWriteStatistics().m_NumFlushes, 0);
+
+		Storage->Flush();
+		const auto Stats = Storage->GetWriteStatistics();
+		TEST_EQUAL(Stats.m_NumFlushes, 1);
+		TEST_EQUAL(Stats.m_NumChunksWritten, 4);
+	}
+	const auto End = static_cast<UInt32>(time(nullptr));
+
+	// The chunks are laid out contiguously after the header, in the order of their header entries:
+	sRegionFile File;
+	TEST_EQUAL(File.m_Contents.size(), 7 * 4096);
+	TEST_EQUAL(File.GetSector(0, 0), 2);
+	TEST_EQUAL(File.GetSector(1, 0), 3);
+	TEST_EQUAL(File.GetNumSectors(1, 0), 2);
+	TEST_EQUAL(File.GetSector(2, 0), 5);
+	TEST_EQUAL(File.GetSector(5, 3), 6);
+	TEST_EQUAL(File.GetData(1, 0), MakeData(3, 5000));
+	TEST_EQUAL(File.GetData(2, 0), MakeData(5, 200));
+
+	// The written chunks are timestamped, the rest of the header is empty:
+	for (const auto & Chunk : { cChunkCoords(0, 0), cChunkCoords(1, 0), cChunkCoords(2, 0), cChunkCoords(5, 3) })
+	{
+		TEST_GREATER_THAN_OR_EQUAL(File.GetTimeStamp(Chunk.m_ChunkX, Chunk.m_ChunkZ), Start);
+		TEST_LESS_THAN_OR_EQUAL(File.GetTimeStamp(Chunk.m_ChunkX, Chunk.m_ChunkZ), End);
+	}
+	TEST_EQUAL(File.GetUInt32(sRegionFile::GetIndex(3, 0) * 4), 0);
+	TEST_EQUAL(File.GetTimeStamp(3, 0), 0);
+}
+
+
+
+
+
+/** The rewritten chunks stay in place if they fit, otherwise they're appended when there's no gap; the header keeps the other chunks. */
+static void TestRewrite()
+{
+	LOGD("Testing the rewrites...");
+
+	// Mark the timestamps written by TestBatchedWrite(), so that the rewritten ones can be told apart:
+	{
+		cFile f;
+		TEST_TRUE(f.Open(g_FileName, cFile::fmReadWrite));
+		const UInt32 OldTimeStamp = htonl(1);
+		for (const auto & Chunk : { cChunkCoords(0, 0), cChunkCoords(1, 0), cChunkCoords(2, 0), cChunkCoords(5, 3) })
+		{
+			const auto Offset = static_cast<int>(4096 + sRegionFile::GetIndex(Chunk.m_ChunkX, Chunk.m_ChunkZ) * 4);
+			TEST_EQUAL(f.Seek(Offset), Offset);
+			TEST_EQUAL(f.Write(&OldTimeStamp, 4), 4);
+		}
+	}
+
+	{
+		auto Storage = CreateStorage(LONG_INTERVAL_MSEC);
+		TEST_TRUE(Storage->SetChunkData({ 0, 0 }, MakeData(6, 4000)));  // Still fits its single sector
+		TEST_TRUE(Storage->SetChunkData({ 2, 0 }, MakeData(7, 6000)));  // Needs two sectors, had one
+		Storage->Flush();
+	}
+
+	sRegionFile File;
+	TEST_EQUAL(File.m_Contents.size(), 9 * 4096);
+	TEST_EQUAL(File.GetSector(0, 0), 2);
+	TEST_EQUAL(File.GetData(0, 0), MakeData(6, 4000));
+	TEST_EQUAL(File.GetSector(2, 0), 7);
+	TEST_EQUAL(File.GetNumSectors(2, 0), 2);
+	TEST_EQUAL(File.GetData(2, 0), MakeData(7, 6000));
+
+	// The chunks that weren't saved keep their location, data and timestamp:
+	TEST_EQUAL(File.GetSector(1, 0), 3);
+	TEST_EQUAL(File.GetData(1, 0), MakeData(3, 5000));
+	TEST_EQUAL(File.GetSector(5, 3), 6);
+	TEST_EQUAL(File.GetTimeStamp(1, 0), 1);
+	TEST_EQUAL(File.GetTimeStamp(5, 3), 1);
+	TEST_NOTEQUAL(File.GetTimeStamp(0, 0), 1);
+	TEST_NOTEQUAL(File.GetTimeStamp(2, 0), 1);
+
+	auto Storage = CreateStorage(0);
+	TEST_EQUAL(ReadChunk(*Storage, 0, 0), MakeData(6, 4000));
+	TEST_EQUAL(ReadChunk(*Storage, 1, 0), MakeData(3, 5000));
+	TEST_EQUAL(ReadChunk(*Storage, 2, 0), MakeData(7, 6000));
+	TEST_EQUAL(ReadChunk(*Storage, 5, 3), MakeData(1, 100));
+}
+
+
+
+
+
+/** The batches that move or shrink chunks leave gaps in the file, the later batches fill them before growing the file. */
+static void TestSectorReuse()
+{
+	LOGD("Testing the sector reuse...");
+	CleanUp();
+	auto Storage = CreateStorage(LONG_INTERVAL_MSEC);
+	for (int x = 0; x < 4; x++)
+	{
+		TEST_TRUE(Storage->SetChunkData({ x, 0 }, MakeData(20 + x, 100)));
+	}
+	Storage->Flush();
+	TEST_EQUAL(sRegionFile().m_Contents.size(), 6 * 4096);
+
+	// Two neighbours grow and move to the end, their sectors stay in the header until this batch is written:
+	TEST_TRUE(Storage->SetChunkData({ 1, 0 }, MakeData(24, 6000)));
+	TEST_TRUE(Storage->SetChunkData({ 2, 0 }, MakeData(25, 6000)));
+	Storage->Flush();
+	{
+		sRegionFile File;
+		TEST_EQUAL(File.m_Contents.size(), 10 * 4096);
+		TEST_EQUAL(File.GetSector(1, 0), 6);
+		TEST_EQUAL(File.GetSector(2, 0), 8);
+	}
+
+	// A new chunk fills the gap they left, another one no longer fits it; a chunk shrinks in place:
+	TEST_TRUE(Storage->SetChunkData({ 5, 3 }, MakeData(26, 6000)));
+	TEST_TRUE(Storage->SetChunkData({ 6, 3 }, MakeData(27, 100)));
+	TEST_TRUE(Storage->SetChunkData({ 1, 0 }, MakeData(28, 100)));
+	Storage->Flush();
+	{
+		sRegionFile File;
+		TEST_EQUAL(File.m_Contents.size(), 11 * 4096);
+		TEST_EQUAL(File.GetSector(5, 3), 3);
+		TEST_EQUAL(File.GetNumSectors(5, 3), 2);
+		TEST_EQUAL(File.GetSector(6, 3), 10);
+		TEST_EQUAL(File.GetSector(1, 0), 6);
+		TEST_EQUAL(File.GetNumSectors(1, 0), 1);
+	}
+
+	// The sector freed by the shrinking is reused:
+	TEST_TRUE(Storage->SetChunkData({ 7, 3 }, MakeData(29, 100)));
+	Storage->Flush();
+	sRegionFile File;
+	TEST_EQUAL(File.m_Contents.size(), 11 * 4096);
+	TEST_EQUAL(File.GetSector(7, 3), 7);
+
+	// All the chunks read back:
+	TEST_EQUAL(File.GetData(0, 0), MakeData(20, 100));
+	TEST_EQUAL(File.GetData(1, 0), MakeData(28, 100));
+	TEST_EQUAL(File.GetData(2, 0), MakeData(25, 6000));
+	TEST_EQUAL(File.GetData(3, 0), MakeData(23, 100));
+	TEST_EQUAL(File.GetData(5, 3), MakeData(26, 6000));
+	TEST_EQUAL(File.GetData(6, 3), MakeData(27, 100));
+	TEST_EQUAL(File.GetData(7, 3), MakeData(29, 100));
+}
+
+
+
+
+
+/** The writer thread writes the saved chunks once the interval elapses, without an explicit flush. */
+static void TestWriterThread()
+{
+	LOGD("Testing the writer thread...");
+	CleanUp();
+	auto Storage = CreateStorage(20);
+	TEST_TRUE(Storage->SetChunkData({ 4, 4 }, MakeData(8, 300)));
+	for (int i = 0; (i < 500) && (Storage->GetWriteStatistics().m_NumChunksWritten == 0); i++)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	TEST_EQUAL(Storage->GetWriteStatistics().m_NumChunksWritten, 1);
+	TEST_EQUAL(sRegionFile().GetData(4, 4), MakeData(8, 300));
+}
+
+
+
+
+
+/** A failed write keeps the chunks queued, the next flush writes them. */
+static void TestWriteFailure()
+{
+	LOGD("Testing the write failures...");
+	CleanUp();
+
+	// A folder in place of the region file makes opening the file fail:
+	TEST_TRUE(cFile::CreateFolderRecursive(g_FileName));
+	{
+		auto Storage = CreateStorage(0);
+		TEST_FALSE(Storage->SetChunkData({ 0, 0 }, MakeData(9, 100)));
+		TEST_FALSE(Storage->SetChunkData({ 1, 1 }, MakeData(10, 100)));
+		Storage->Flush();
+		TEST_EQUAL(Storage->GetWriteStatistics().m_NumChunksWritten, 0);
+
+		// The chunks are still queued:
+		TEST_EQUAL(ReadChunk(*Storage, 0, 0), MakeData(9, 100));
+		TEST_EQUAL(ReadChunk(*Storage, 1, 1), MakeData(10, 100));
+
+		TEST_TRUE(cFile::DeleteFolder(g_FileName));
+		Storage->Flush();
+		TEST_EQUAL(Storage->GetWriteStatistics().m_NumChunksWritten, 2);
+	}
+
+	auto Storage = CreateStorage(0);
+	TEST_EQUAL(ReadChunk(*Storage, 0, 0), MakeData(9, 100));
+	TEST_EQUAL(ReadChunk(*Storage, 1, 1), MakeData(10, 100));
+}
+
+
+
+
+
+/** The MemoryMapped backend reads the chunks written through the File backend.
+The chunk data still being read through a mapping is never overwritten, and a mapping too small for the grown file is replaced. */
+static void TestMemoryMapped()
+{
+	LOGD("Testing the memory mapped reads...");
+	CleanUp();
+	{
+		auto Storage = CreateStorage(0);
+		TEST_TRUE(Storage->SetChunkData({ 0, 0 }, MakeData(11, 100)));
+		TEST_TRUE(Storage->SetChunkData({ 1, 0 }, MakeData(12, 5000)));
+	}
+	const auto OldSize = sRegionFile().m_Contents.size();
+	TEST_EQUAL(OldSize, 5 * 4096);
+
+	auto Storage = CreateStorage(0, true);
+	TEST_EQUAL(ReadChunk(*Storage, 0, 0), MakeData(11, 100));
+	TEST_EQUAL(ReadChunk(*Storage, 1, 0), MakeData(12, 5000));
+	TEST_TRUE(ReadChunk(*Storage, 2, 0).empty());
+
+	// Rewrite a chunk while its old data is held; the new data would fit in place, but is appended instead:
+	cAnvilRegionFiles::sChunkData Old;
+	TEST_TRUE(Storage->GetChunkData({ 0, 0 }, Old));
+	TEST_TRUE(Old.m_Mapping != nullptr);
+	TEST_TRUE(Storage->SetChunkData({ 0, 0 }, MakeData(13, 100)));
+	{
+		sRegionFile File;
+		TEST_EQUAL(File.m_Contents.size(), OldSize + 4096);
+		TEST_EQUAL(File.GetSector(0, 0), 5);
+		TEST_EQUAL(File.GetData(0, 0), MakeData(13, 100));
+		TEST_EQUAL(File.GetSector(1, 0), 3);
+	}
+	const auto OldView = Old.GetView();
+	TEST_EQUAL(ContiguousByteBuffer(OldView.begin(), OldView.end()), MakeData(11, 100));
+
+	// The file has grown past the held mapping, the next read maps it anew and sees the new data:
+	cAnvilRegionFiles::sChunkData New;
+	TEST_TRUE(Storage->GetChunkData({ 0, 0 }, New));
+	TEST_TRUE(New.m_Mapping != nullptr);
+	TEST_TRUE(New.m_Mapping != Old.m_Mapping);
+	const auto NewView = New.GetView();
+	TEST_EQUAL(ContiguousByteBuffer(NewView.begin(), NewView.end()), MakeData(13, 100));
+	TEST_EQUAL(ReadChunk(*Storage, 1, 0), MakeData(12, 5000));
+
+	// Once no data is held, a chunk that fits is rewritten in place and read through the existing mapping:
+	Old = {};
+	New = {};
+	TEST_TRUE(Storage->SetChunkData({ 1, 0 }, MakeData(14, 6000)));
+	{
+		sRegionFile File;
+		TEST_EQUAL(File.m_Contents.size(), OldSize + 4096);
+		TEST_EQUAL(File.GetSector(1, 0), 3);
+		TEST_EQUAL(File.GetData(1, 0), MakeData(14, 6000));
+	}
+	TEST_EQUAL(ReadChunk(*Storage, 1, 0), MakeData(14, 6000));
+	TEST_EQUAL(ReadChunk(*Storage, 0, 0), MakeData(13, 100));
+}
+
+
+
+
+
+/** Rewriting a chunk over and over while its old data is held through a mapping reuses the freed sectors, the file stays bounded. */
+static void TestMemoryMappedRewrites()
+{
+	LOGD("Testing the memory mapped rewrites...");
+	CleanUp();
+	{
+		auto Storage = CreateStorage(0);
+		TEST_TRUE(Storage->SetChunkData({ 0, 0 }, MakeData(15, 100)));
+		TEST_TRUE(Storage->SetChunkData({ 1, 0 }, MakeData(16, 5000)));
+	}
+	const auto OldSize = sRegionFile().m_Contents.size();
+
+	auto Storage = CreateStorage(0, true);
+	cAnvilRegionFiles::sChunkData Old;
+	TEST_TRUE(Storage->GetChunkData({ 0, 0 }, Old));
+	for (int i = 0; i < 50; i++)
+	{
+		// Alternate between one and two sectors, so that the chunk keeps moving:
+		const auto Data = MakeData(100 + i, ((i % 2) == 0) ? 100 : 6000);
+		TEST_TRUE(Storage->SetChunkData({ 0, 0 }, Data));
+		sRegionFile File;
+		TEST_LESS_THAN_OR_EQUAL(File.m_Contents.size(), OldSize + 6 * 4096);
+		TEST_NOTEQUAL(File.GetSector(0, 0), 2);
+		TEST_EQUAL(File.GetData(0, 0), Data);
+		TEST_EQUAL(ReadChunk(*Storage, 0, 0), Data);
+	}
+
+	// The held data is intact, and so is the other chunk:
+	const auto OldView = Old.GetView();
+	TEST_EQUAL(ContiguousByteBuffer(OldView.begin(), OldView.end()), MakeData(15, 100));
+	TEST_EQUAL(ReadChunk(*Storage, 1, 0), MakeData(16, 5000));
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("AnvilRegionFiles",
+	TestImmediateWrite();
+	TestBatchedWrite();
+	TestRewrite();
+	TestSectorReuse();
+	TestWriterThread();
+	TestWriteFailure();
+	TestMemoryMapped();
+	TestMemoryMappedRewrites();
+	CleanUp();
+)
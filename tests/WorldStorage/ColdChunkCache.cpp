@@ -0,0 +1,202 @@
+// ColdChunkCache.cpp
+
+// Tests the cColdChunkCache class that keeps the compressed data of the recently unloaded chunks
+
+#include "Globals.h"
+#include "../TestHelpers.h"
+#include "WorldStorage/ColdChunkCache.h"
+
+
+
+
+
+/** Returns a blob of the specified size, filled with a_Value. */
+static ContiguousByteBuffer MakeBlob(size_t a_Size, int a_Value)
+{
+	return ContiguousByteBuffer(a_Size, static_cast<std::byte>(a_Value));
+}
+
+
+
+
+
+/** Keeps the blob of the specified chunk and unloads the chunk, the way the storage does for a chunk saved and then unloaded. */
+static void StoreCold(cColdChunkCache & a_Cache, cChunkCoords a_Chunk, size_t a_Size, int a_Value)
+{
+	a_Cache.Keep(a_Chunk, MakeBlob(a_Size, a_Value));
+	a_Cache.ChunkUnloaded(a_Chunk);
+}
+
+
+
+
+
+/** Returns true if the cache has a cold blob for the chunk, leaving the blob in the cache. */
+static bool HasCold(cColdChunkCache & a_Cache, cChunkCoords a_Chunk)
+{
+	ContiguousByteBuffer Data;
+	if (!a_Cache.Take(a_Chunk, Data))
+	{
+		return false;
+	}
+	a_Cache.Keep(a_Chunk, Data);
+	a_Cache.ChunkUnloaded(a_Chunk);
+	return true;
+}
+
+
+
+
+
+/** Tests that only the unloaded chunks' blobs are returned, and that loading a chunk takes its blob out of the cache. */
+static void TestKeepAndTake(void)
+{
+	cColdChunkCache Cache(1000);
+	ContiguousByteBuffer Data;
+
+	// A kept blob is not returned while its chunk is in memory:
+	Cache.Keep({ 0, 0 }, MakeBlob(100, 1));
+	TEST_FALSE(Cache.Take({ 0, 0 }, Data));
+	TEST_EQUAL(Cache.GetStatistics().m_NumKeptChunks, 1);
+	TEST_EQUAL(Cache.GetStatistics().m_NumKeptBytes, 100);
+
+	// A newer save replaces the blob:
+	Cache.Keep({ 0, 0 }, MakeBlob(200, 2));
+	TEST_EQUAL(Cache.GetStatistics().m_NumKeptBytes, 200);
+
+	// Once the chunk is unloaded, its last blob is returned and dropped from the cache:
+	Cache.ChunkUnloaded({ 0, 0 });
+	TEST_EQUAL(Cache.GetStatistics().m_NumChunks, 1);
+	TEST_EQUAL(Cache.GetStatistics().m_NumKeptChunks, 0);
+	TEST_TRUE(Cache.Take({ 0, 0 }, Data));
+	TEST_EQUAL(Data, MakeBlob(200, 2));
+	TEST_FALSE(Cache.Take({ 0, 0 }, Data));
+	const auto Stats = Cache.GetStatistics();
+	TEST_EQUAL(Stats.m_NumChunks, 0);
+	TEST_EQUAL(Stats.m_NumBytes, 0);
+	TEST_EQUAL(Stats.m_NumHits, 1);
+	TEST_EQUAL(Stats.m_NumMisses, 2);
+
+	// Unloading a chunk that has no blob does nothing:
+	Cache.ChunkUnloaded({ 1, 0 });
+	TEST_FALSE(Cache.Take({ 1, 0 }, Data));
+
+	// Saving a chunk that was reloaded before its unload was processed replaces the cold blob:
+	StoreCold(Cache, { 2, 0 }, 100, 3);
+	Cache.Keep({ 2, 0 }, MakeBlob(100, 4));
+	TEST_FALSE(Cache.Take({ 2, 0 }, Data));
+	Cache.ChunkUnloaded({ 2, 0 });
+	TEST_TRUE(Cache.Take({ 2, 0 }, Data));
+	TEST_EQUAL(Data, MakeBlob(100, 4));
+
+	// Removing drops both kinds of blobs:
+	StoreCold(Cache, { 3, 0 }, 100, 5);
+	Cache.Keep({ 4, 0 }, MakeBlob(100, 6));
+	Cache.Remove({ 3, 0 });
+	Cache.Remove({ 4, 0 });
+	Cache.ChunkUnloaded({ 4, 0 });
+	TEST_FALSE(Cache.Take({ 3, 0 }, Data));
+	TEST_FALSE(Cache.Take({ 4, 0 }, Data));
+	TEST_EQUAL(Cache.GetStatistics().m_NumBytes, 0);
+	TEST_EQUAL(Cache.GetStatistics().m_NumKeptBytes, 0);
+}
+
+
+
+
+
+/** Tests that the least recently unloaded blobs are evicted first. */
+static void TestLRUOrder(void)
+{
+	cColdChunkCache Cache(300);
+	StoreCold(Cache, { 0, 0 }, 100, 0);
+	StoreCold(Cache, { 1, 0 }, 100, 1);
+	StoreCold(Cache, { 2, 0 }, 100, 2);
+
+	// Reloading and unloading the oldest chunk makes it the most recent one:
+	TEST_TRUE(HasCold(Cache, { 0, 0 }));
+
+	// Evicts [1, 0]:
+	StoreCold(Cache, { 3, 0 }, 100, 3);
+	TEST_FALSE(HasCold(Cache, { 1, 0 }));
+	TEST_TRUE(HasCold(Cache, { 2, 0 }));
+	TEST_TRUE(HasCold(Cache, { 0, 0 }));
+	TEST_TRUE(HasCold(Cache, { 3, 0 }));
+	TEST_EQUAL(Cache.GetStatistics().m_NumEvictions, 1);
+
+	// Now [2, 0] is the oldest, a larger blob evicts it and [0, 0]:
+	StoreCold(Cache, { 4, 0 }, 200, 4);
+	TEST_FALSE(HasCold(Cache, { 2, 0 }));
+	TEST_FALSE(HasCold(Cache, { 0, 0 }));
+	TEST_TRUE(HasCold(Cache, { 3, 0 }));
+	TEST_TRUE(HasCold(Cache, { 4, 0 }));
+	TEST_EQUAL(Cache.GetStatistics().m_NumEvictions, 3);
+}
+
+
+
+
+
+/** Tests that each kind of blobs fits the byte budget, and that the blobs of the chunks in memory don't push out the cold ones. */
+static void TestBudget(void)
+{
+	cColdChunkCache Cache(1000);
+	ContiguousByteBuffer Data;
+
+	// A blob larger than the whole budget isn't stored, and drops the previous blob of the chunk:
+	Cache.Keep({ 0, 0 }, MakeBlob(100, 0));
+	Cache.Keep({ 0, 0 }, MakeBlob(1001, 1));
+	Cache.ChunkUnloaded({ 0, 0 });
+	TEST_FALSE(Cache.Take({ 0, 0 }, Data));
+	TEST_EQUAL(Cache.GetStatistics().m_NumKeptBytes, 0);
+
+	// The kept blobs evict only the older kept blobs:
+	StoreCold(Cache, { 1, 0 }, 400, 1);
+	StoreCold(Cache, { 2, 0 }, 400, 2);
+	Cache.Keep({ 3, 0 }, MakeBlob(600, 3));
+	Cache.Keep({ 4, 0 }, MakeBlob(600, 4));
+	auto Stats = Cache.GetStatistics();
+	TEST_EQUAL(Stats.m_NumChunks, 2);
+	TEST_EQUAL(Stats.m_NumBytes, 800);
+	TEST_EQUAL(Stats.m_NumKeptChunks, 1);
+	TEST_EQUAL(Stats.m_NumKeptBytes, 600);
+	TEST_EQUAL(Stats.m_NumEvictions, 0);
+
+	// Unloading the chunks evicts the least recently unloaded cold blob; the evicted kept blob doesn't become cold:
+	Cache.ChunkUnloaded({ 3, 0 });
+	Cache.ChunkUnloaded({ 4, 0 });
+	Stats = Cache.GetStatistics();
+	TEST_EQUAL(Stats.m_NumChunks, 2);
+	TEST_EQUAL(Stats.m_NumBytes, 1000);
+	TEST_EQUAL(Stats.m_NumKeptBytes, 0);
+	TEST_EQUAL(Stats.m_NumEvictions, 1);
+	TEST_FALSE(HasCold(Cache, { 1, 0 }));
+	TEST_FALSE(HasCold(Cache, { 3, 0 }));
+	TEST_TRUE(HasCold(Cache, { 2, 0 }));
+	TEST_TRUE(HasCold(Cache, { 4, 0 }));
+
+	// Lowering the budget evicts the oldest blobs:
+	Cache.SetBudget(600);
+	Stats = Cache.GetStatistics();
+	TEST_EQUAL(Stats.m_NumChunks, 1);
+	TEST_EQUAL(Stats.m_NumBytes, 600);
+	TEST_EQUAL(Stats.m_NumEvictions, 2);
+	TEST_TRUE(HasCold(Cache, { 4, 0 }));
+
+	// A zero budget disables the cache:
+	Cache.SetBudget(0);
+	TEST_FALSE(Cache.IsEnabled());
+	TEST_EQUAL(Cache.GetStatistics().m_NumBytes, 0);
+	StoreCold(Cache, { 5, 0 }, 1, 5);
+	TEST_FALSE(Cache.Take({ 5, 0 }, Data));
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ColdChunkCache",
+	TestKeepAndTake();
+	TestLRUOrder();
+	TestBudget();
+)